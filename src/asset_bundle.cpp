@@ -0,0 +1,56 @@
+#include "asset_bundle.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const EmbeddedAsset* findEmbeddedAsset(const char* path) {
+  if (!path) return nullptr;
+  size_t lo = 0;
+  size_t hi = kEmbeddedAssetCount;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int cmp = strcmp(path, kEmbeddedAssets[mid].path);
+    if (cmp == 0) return &kEmbeddedAssets[mid];
+    if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return nullptr;
+}
+
+bool selectEmbeddedVariant(const EmbeddedAsset& asset, const char* acceptEncoding,
+                           ContentCoding& coding, bool& inflate) {
+  ContentCoding order[3];
+  size_t n = rankContentCodings(acceptEncoding, order);
+  for (size_t i = 0; i < n; ++i) {
+    if (asset.data[static_cast<uint8_t>(order[i])]) {
+      coding = order[i];
+      inflate = false;
+      return true;
+    }
+  }
+  if (asset.data[static_cast<uint8_t>(ContentCoding::Gzip)]) {
+    coding = ContentCoding::Gzip;
+    inflate = true;
+    return true;
+  }
+  // A client refusing identity still gets the plain bytes if they are stored
+  if (asset.data[static_cast<uint8_t>(ContentCoding::Identity)]) {
+    coding = ContentCoding::Identity;
+    inflate = false;
+    return true;
+  }
+  return false;
+}
+
+bool formatEmbeddedEtag(const EmbeddedAsset& asset, ContentCoding coding, char* out, size_t outSize) {
+  int n;
+  if (coding == ContentCoding::Identity) {
+    n = snprintf(out, outSize, "\"%s\"", asset.hash);
+  } else {
+    n = snprintf(out, outSize, "\"%s-%s\"", asset.hash, contentCodingName(coding));
+  }
+  return n > 0 && (size_t)n < outSize;
+}
@@ -0,0 +1,54 @@
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http_encoding.h"
+
+/**
+ * One static asset compiled into the firmware by tools/embed_assets.py.
+ *
+ * The bytes are const data in the app partition, read through the flash
+ * cache, so serving one needs neither a filesystem open nor a heap copy.
+ * Variants are indexed by ContentCoding; text assets are stored compressed
+ * only, other files as-is.
+ */
+struct EmbeddedAsset {
+  const char* path;        // "/dashboard.html"
+  const char* hash;        // content hash of the plain bytes, hex
+  const uint8_t* data[3];  // by ContentCoding; nullptr when not stored
+  uint32_t length[3];
+};
+
+// Generated into src/generated/asset_bundle_data.cpp, sorted by path
+extern const EmbeddedAsset kEmbeddedAssets[];
+extern const size_t kEmbeddedAssetCount;
+// Hash over every asset's path and hash; "" when nothing was embedded
+extern const char kEmbeddedBundleId[];
+
+/** Embedded asset for a request path, or nullptr. */
+const EmbeddedAsset* findEmbeddedAsset(const char* path);
+
+/**
+ * @brief Stored variant to send for a request's Accept-Encoding
+ *
+ * Picks the best-ranked coding the asset has. When the client accepts
+ * nothing that is stored but gzip exists, returns Gzip with `inflate` set:
+ * the caller decompresses it, and the body is the plain content.
+ * @return false if the asset stores nothing usable for this client
+ */
+bool selectEmbeddedVariant(const EmbeddedAsset& asset, const char* acceptEncoding,
+                           ContentCoding& coding, bool& inflate);
+
+/**
+ * @brief Strong ETag for one representation of an embedded asset
+ *
+ * Content-addressed: "<hash>" for the plain body (stored or inflated) and
+ * "<hash>-<coding>" otherwise, so the tag changes exactly when the bytes do
+ * and never depends on the UI version file on LittleFS.
+ * @return false if `out` is too small
+ */
+bool formatEmbeddedEtag(const EmbeddedAsset& asset, ContentCoding coding, char* out, size_t outSize);
+
+#endif // ASSET_BUNDLE_H
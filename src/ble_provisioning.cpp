@@ -2,6 +2,7 @@
 
 #include "config.h"
 #include "device_identity.h"
+#include "fixed_string.h"
 #include "grid_layout.h"
 #include "led_controller.h"
 #include "led_events.h"
@@ -63,51 +64,48 @@ bool g_passkeyShowing = false;
 unsigned long g_passkeyLastToggleMs = 0;
 
 const char* bleReasonToString(BleProvisioningReason reason);
-String wifiStatusToReason(wl_status_t status);
-
-String jsonEscape(const String& input) {
-  String out;
-  out.reserve(input.length() + 8);
-  for (size_t i = 0; i < input.length(); ++i) {
-    char c = input[i];
-    switch (c) {
-      case '\\': out += "\\\\"; break;
-      case '"': out += "\\\""; break;
-      case '\n': out += "\\n"; break;
-      case '\r': out += "\\r"; break;
-      case '\t': out += "\\t"; break;
-      default: out += c; break;
-    }
-  }
-  return out;
-}
+const char* wifiStatusToReason(wl_status_t status);
 
-void notifyStatus(const String& status) {
+void notifyStatus(const char* status) {
   if (!g_statusChar) return;
-  g_statusChar->setValue(status.c_str());
+  // The byte overload copies straight in; the std::string one allocates first
+  g_statusChar->setValue(reinterpret_cast<uint8_t*>(const_cast<char*>(status)), strlen(status));
   if (g_hasClient) {
     g_statusChar->notify();
   }
 }
 
-void notifyStatusJson(const String& state, const String& detailKey = "", const String& detailValue = "") {
-  String payload = String("{\"state\":\"") + jsonEscape(state) + "\"";
-  payload += String(",\"hardware_id\":\"") + jsonEscape(get_hardware_id()) + "\"";
-  payload += String(",\"uptime_ms\":\"") + String(millis()) + "\"";
-  payload += String(",\"wifi_status\":\"") + String(WiFi.status()) + "\"";
-  payload += String(",\"rssi\":\"") + String(WiFi.RSSI()) + "\"";
-  payload += String(",\"attempt\":\"") + String(g_wifiAttempt) + "\"";
+// Sent every second while WiFi connects; built on the stack
+void notifyStatusJson(const char* state, const char* detailKey = nullptr, const char* detailValue = nullptr) {
+  FixedString<BLE_STATUS_JSON_BYTES> payload;
+  payload += "{\"state\":\"";
+  payload.appendJsonEscaped(state);
+  payload += "\",\"hardware_id\":\"";
+  payload.appendJsonEscaped(get_hardware_id().c_str());
+  payload.appendf("\",\"uptime_ms\":\"%lu\",\"wifi_status\":\"%d\",\"rssi\":\"%d\",\"attempt\":\"%lu\"",
+                  (unsigned long)millis(), (int)WiFi.status(), (int)WiFi.RSSI(), (unsigned long)g_wifiAttempt);
   if (g_bleReason.length() > 0) {
-    payload += String(",\"ble_reason\":\"") + jsonEscape(g_bleReason) + "\"";
+    payload += ",\"ble_reason\":\"";
+    payload.appendJsonEscaped(g_bleReason.c_str());
+    payload += "\"";
   }
   if (g_ssid.length() > 0) {
-    payload += String(",\"ssid\":\"") + jsonEscape(g_ssid) + "\"";
+    payload += ",\"ssid\":\"";
+    payload.appendJsonEscaped(g_ssid.c_str());
+    payload += "\"";
   }
-  if (detailKey.length() > 0) {
-    payload += String(",\"") + jsonEscape(detailKey) + "\":\"" + jsonEscape(detailValue) + "\"";
+  if (detailKey && *detailKey) {
+    payload += ",\"";
+    payload.appendJsonEscaped(detailKey);
+    payload += "\":\"";
+    payload.appendJsonEscaped(detailValue);
+    payload += "\"";
   }
   payload += "}";
-  notifyStatus(payload);
+  if (payload.truncated()) {
+    logWarnf("🔵 BLE status truncated at %u bytes", (unsigned)payload.length());
+  }
+  notifyStatus(payload.c_str());
 }
 
 String buildDeviceName() {
@@ -318,7 +316,7 @@ const char* bleReasonToString(BleProvisioningReason reason) {
   }
 }
 
-String wifiStatusToReason(wl_status_t status) {
+const char* wifiStatusToReason(wl_status_t status) {
   switch (status) {
     case WL_NO_SSID_AVAIL:
       return "no_ssid";
@@ -368,14 +366,14 @@ void processBleProvisioning() {
   if (g_state == BleState::WifiConnecting) {
     static wl_status_t lastWifiStatus = WL_IDLE_STATUS;
     if (WiFi.status() == WL_CONNECTED) {
-      notifyStatusJson("wifi_ok", "ip", WiFi.localIP().toString());
+      notifyStatusJson("wifi_ok", "ip", WiFi.localIP().toString().c_str());
       g_state = BleState::Active;
       lastWifiStatus = WL_CONNECTED;
       return;
     }
     wl_status_t statusNow = WiFi.status();
     if (statusNow != lastWifiStatus) {
-      logInfo(String("🔵 BLE WiFi status change: ") + wifiStatusToReason(statusNow) + " (" + statusNow + ")");
+      logInfof("🔵 BLE WiFi status change: %s (%d)", wifiStatusToReason(statusNow), (int)statusNow);
       lastWifiStatus = statusNow;
     }
     if (now - g_lastStatusNotifyMs >= 1000) {
@@ -0,0 +1,72 @@
+#include "boot_orchestrator.h"
+
+#include <Arduino.h>
+
+BootOrchestrator bootOrchestrator;
+
+void BootOrchestrator::add(BootPhase phase, BootStepMask needs, StartFn start, PollFn poll) {
+  if (static_cast<uint8_t>(phase) >= BOOT_PHASE_COUNT || (added_ & bootStep(phase))) return;
+  if (count_ >= BOOT_PHASE_COUNT) return;
+  steps_[count_++] = {phase, needs, start, poll};
+  added_ |= bootStep(phase);
+}
+
+bool BootOrchestrator::run() {
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (uint8_t i = 0; i < count_; ++i) {
+      const Step& s = steps_[i];
+      BootStepMask bit = bootStep(s.phase);
+      if (running_ & bit) {
+        if (s.poll(millis())) {
+          running_ &= ~bit;
+          finish(s);
+          progress = true;
+        }
+        continue;
+      }
+      if ((started_ & bit) || (s.needs & ~finished_) != 0) continue;
+      started_ |= bit;
+      bootPhaseBegin(s.phase);
+      if (s.start) s.start();
+      if (s.poll) {
+        running_ |= bit;
+      } else {
+        finish(s);
+      }
+      progress = true;
+    }
+  }
+  return done();
+}
+
+void BootOrchestrator::finish(const Step& s) {
+  bootPhaseEnd(s.phase);
+  finished_ |= bootStep(s.phase);
+  if (done()) bootMilestone(BootMilestone::BootDone);
+}
+
+bool BootOrchestrator::valid() const {
+  // Finish steps on paper until none can; whatever is left never starts
+  BootStepMask reachable = 0;
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (uint8_t i = 0; i < count_; ++i) {
+      BootStepMask bit = bootStep(steps_[i].phase);
+      if (!(reachable & bit) && (steps_[i].needs & ~reachable) == 0) {
+        reachable |= bit;
+        progress = true;
+      }
+    }
+  }
+  return reachable == added_;
+}
+
+#ifdef PIO_UNIT_TESTING
+void BootOrchestrator::test_reset() {
+  count_ = 0;
+  added_ = started_ = running_ = finished_ = 0;
+}
+#endif
@@ -0,0 +1,72 @@
+#ifndef BOOT_ORCHESTRATOR_H
+#define BOOT_ORCHESTRATOR_H
+
+#include <stdint.h>
+
+#include "boot_profile.h"
+
+/** A set of boot steps, a bit per BootPhase. */
+typedef uint32_t BootStepMask;
+
+constexpr BootStepMask bootStep(BootPhase phase) {
+  return 1u << static_cast<uint8_t>(phase);
+}
+
+/**
+ * @brief Runs the boot steps in dependency order
+ *
+ * Each step is a BootPhase with the steps it needs. run() starts every step
+ * whose needs have finished, in the order they were added, until nothing
+ * more can start. A step without a poll function finishes when its start
+ * function returns. A background step (network, NTP) keeps running until
+ * its poll returns true; loop() calls run() again until done(), so the
+ * clock face does not wait for WiFi.
+ *
+ * Every step is profiled as its phase (boot_profile.h).
+ */
+class BootOrchestrator {
+public:
+  typedef void (*StartFn)();
+  typedef bool (*PollFn)(unsigned long nowMs);
+
+  /** Declares a step; `poll` is null for one that is done when `start` returns. */
+  void add(BootPhase phase, BootStepMask needs, StartFn start, PollFn poll = nullptr);
+
+  /** Starts and polls steps until nothing changes. True when every step has finished. */
+  bool run();
+
+  bool done() const { return added_ != 0 && finished_ == added_; }
+  bool finished(BootPhase phase) const { return finished_ & bootStep(phase); }
+  bool running(BootPhase phase) const { return running_ & bootStep(phase); }
+
+  /**
+   * Every step can eventually start: its needs were all added and
+   * there is no cycle. Steps that fail this would wait forever.
+   */
+  bool valid() const;
+
+#ifdef PIO_UNIT_TESTING
+  void test_reset();
+#endif
+
+private:
+  struct Step {
+    BootPhase phase;
+    BootStepMask needs;
+    StartFn start;
+    PollFn poll;
+  };
+
+  void finish(const Step& s);
+
+  Step steps_[BOOT_PHASE_COUNT];
+  uint8_t count_ = 0;
+  BootStepMask added_ = 0;
+  BootStepMask started_ = 0;
+  BootStepMask running_ = 0;
+  BootStepMask finished_ = 0;
+};
+
+extern BootOrchestrator bootOrchestrator;
+
+#endif // BOOT_ORCHESTRATOR_H
@@ -0,0 +1,129 @@
+#include "boot_profile.h"
+
+#include <string.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#else
+#include <Arduino.h>
+#endif
+
+namespace {
+
+// The layout is part of the magic: a record written by a build with other
+// phases is not read back as this one's
+const uint32_t kMagic = 0xB0070000u | static_cast<uint32_t>(sizeof(BootTimeline) & 0xFFFF);
+
+const char* const kPhaseNames[] = {
+  "early", "start_delay", "settings", "migration", "ble", "network", "ota",
+  "display_settings", "language", "night_mode", "filesystem", "services",
+  "time_sync", "display", "wordclock", "startup_sequence",
+};
+static_assert(sizeof(kPhaseNames) / sizeof(kPhaseNames[0]) == BOOT_PHASE_COUNT,
+              "a name per BootPhase");
+static_assert(BOOT_PHASE_COUNT <= 32, "BootTimeline::ran has a bit per phase");
+
+const char* const kMilestoneNames[] = {"setup_done", "wifi", "ntp", "first_frame", "boot_done"};
+static_assert(sizeof(kMilestoneNames) / sizeof(kMilestoneNames[0]) == BOOT_MILESTONE_COUNT,
+              "a name per BootMilestone");
+
+#ifndef PIO_UNIT_TESTING
+RTC_NOINIT_ATTR BootTimeline s_retained;
+#else
+BootTimeline s_retained;
+#endif
+BootTimeline s_previous;
+bool s_hasPrevious = false;
+
+uint64_t nowUs() {
+#ifndef PIO_UNIT_TESTING
+  return static_cast<uint64_t>(esp_timer_get_time());
+#else
+  return static_cast<uint64_t>(millis()) * 1000ULL;
+#endif
+}
+
+bool retainedValid() {
+#ifndef PIO_UNIT_TESTING
+  if (esp_reset_reason() == ESP_RST_POWERON) return false;
+#endif
+  return s_retained.magic == kMagic && (s_retained.open >> BOOT_PHASE_COUNT) == 0;
+}
+
+}  // namespace
+
+uint8_t BootTimeline::stuckPhase() const {
+  uint8_t latest = BOOT_PHASE_NONE;
+  for (uint8_t p = 0; p < BOOT_PHASE_COUNT; ++p) {
+    if (!phaseOpen(p)) continue;
+    if (latest == BOOT_PHASE_NONE || startUs[p] >= startUs[latest]) latest = p;
+  }
+  return latest;
+}
+
+void bootProfileBegin() {
+  s_hasPrevious = retainedValid();
+  if (s_hasPrevious) s_previous = s_retained;
+  memset(&s_retained, 0, sizeof(s_retained));
+  s_retained.magic = kMagic;
+  s_retained.bootCount = s_hasPrevious ? s_previous.bootCount + 1 : 1;
+}
+
+void bootPhaseBegin(BootPhase phase) {
+  uint8_t p = static_cast<uint8_t>(phase);
+  if (p >= BOOT_PHASE_COUNT) return;
+  s_retained.startUs[p] = static_cast<uint32_t>(nowUs());
+  s_retained.durationUs[p] = 0;
+  s_retained.ran |= 1u << p;
+  s_retained.open |= 1u << p;
+}
+
+void bootPhaseEnd(BootPhase phase) {
+  uint8_t p = static_cast<uint8_t>(phase);
+  if (!s_retained.phaseOpen(p)) return;
+  s_retained.durationUs[p] = static_cast<uint32_t>(nowUs()) - s_retained.startUs[p];
+  s_retained.open &= ~(1u << p);
+}
+
+void bootMilestone(BootMilestone m) {
+  uint8_t i = static_cast<uint8_t>(m);
+  if (i >= BOOT_MILESTONE_COUNT || s_retained.milestoneMs[i] != 0) return;
+  uint32_t ms = static_cast<uint32_t>(nowUs() / 1000ULL);
+  s_retained.milestoneMs[i] = ms ? ms : 1;  // 0 means not reached
+}
+
+const BootTimeline& bootTimeline() { return s_retained; }
+
+const BootTimeline* previousBootTimeline() { return s_hasPrevious ? &s_previous : nullptr; }
+
+bool previousBootIncomplete() {
+  return s_hasPrevious && s_previous.milestone(BootMilestone::BootDone) == 0;
+}
+
+uint8_t bootSlowestPhase() {
+  uint8_t slowest = BOOT_PHASE_NONE;
+  for (uint8_t p = 0; p < BOOT_PHASE_COUNT; ++p) {
+    if (!(s_retained.ran & (1u << p))) continue;
+    if (slowest == BOOT_PHASE_NONE || s_retained.durationUs[p] > s_retained.durationUs[slowest]) {
+      slowest = p;
+    }
+  }
+  return slowest;
+}
+
+const char* bootPhaseName(uint8_t phase) {
+  return phase < BOOT_PHASE_COUNT ? kPhaseNames[phase] : "none";
+}
+
+const char* bootMilestoneName(uint8_t milestone) {
+  return milestone < BOOT_MILESTONE_COUNT ? kMilestoneNames[milestone] : "none";
+}
+
+#ifdef PIO_UNIT_TESTING
+void test_bootPowerOn() {
+  memset(&s_retained, 0xA5, sizeof(s_retained));
+  s_hasPrevious = false;
+}
+#endif
@@ -0,0 +1,106 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdint.h>
+
+/*
+ * Span profiler for the boot steps, kept in RTC memory across resets
+ *
+ * Steps run one after the other or, for the network, NTP and the start
+ * delay, in the background while others run; spans may overlap.
+ *
+ * The timeline lives in RTC_NOINIT memory, which keeps its contents across
+ * software resets, panics and watchdog resets. A boot that never finished
+ * boot therefore shows on the next boot which phase it was stuck in.
+ * On power-on the memory holds garbage; the magic and the reset reason
+ * decide whether there is a previous boot to report.
+ *
+ * Markers cost one esp_timer read and a few stores; no allocation, no log.
+ */
+
+/**
+ * Boot steps, in the order they are declared. Values are stored in the
+ * retained record, so only ever append.
+ */
+enum class BootPhase : uint8_t {
+  Early,            // serial, LED clear, time zone
+  StartDelay,       // MDNS_START_DELAY_MS before mDNS and the web server
+  Settings,         // settings snapshot, log settings
+  Migration,
+  Ble,
+  Network,          // stored-credentials connect window, then the fallback
+  Ota,
+  DisplaySettings,
+  Language,
+  NightMode,
+  Filesystem,
+  Services,         // web server, mDNS, MQTT
+  TimeSync,         // NTP, until synced or TIME_SYNC_TIMEOUT_MS
+  Display,
+  Wordclock,
+  StartupSequence,
+  Count
+};
+
+/** Moments after reset worth tracking across the fleet; each is kept once. */
+enum class BootMilestone : uint8_t {
+  SetupDone,
+  WifiConnected,
+  TimeSynced,
+  FirstFrame,  // first clock face on the LEDs, after the startup sweep
+  BootDone,    // every boot step finished, background ones included
+  Count
+};
+
+static const uint8_t BOOT_PHASE_COUNT = static_cast<uint8_t>(BootPhase::Count);
+static const uint8_t BOOT_MILESTONE_COUNT = static_cast<uint8_t>(BootMilestone::Count);
+static const uint8_t BOOT_PHASE_NONE = 0xFF;
+
+/**
+ * @brief Where the time of one boot went
+ *
+ * Phase times are microseconds of esp_timer, which starts early in the
+ * ROM-to-app startup; milestones are milliseconds on the same clock.
+ * A phase or milestone that was not reached is 0 in `ran`/`milestoneMs`.
+ * A phase that is still running has its bit in `open`.
+ */
+struct BootTimeline {
+  uint32_t magic;
+  uint32_t bootCount;                          // boots since power-on
+  uint32_t ran;                                // bit per BootPhase
+  uint32_t open;                               // bit per BootPhase
+  uint32_t startUs[BOOT_PHASE_COUNT];
+  uint32_t durationUs[BOOT_PHASE_COUNT];
+  uint32_t milestoneMs[BOOT_MILESTONE_COUNT];
+
+  bool phaseRan(BootPhase p) const { return ran & (1u << static_cast<uint8_t>(p)); }
+  bool phaseOpen(uint8_t p) const { return p < BOOT_PHASE_COUNT && (open & (1u << p)); }
+  uint32_t milestone(BootMilestone m) const { return milestoneMs[static_cast<uint8_t>(m)]; }
+  /** The running phase that started last, or BOOT_PHASE_NONE. */
+  uint8_t stuckPhase() const;
+};
+
+/** First thing in setup(): keeps the previous boot's record, starts a new one. */
+void bootProfileBegin();
+void bootPhaseBegin(BootPhase phase);
+void bootPhaseEnd(BootPhase phase);
+/** Records when `m` was first reached; later calls are ignored. */
+void bootMilestone(BootMilestone m);
+
+const BootTimeline& bootTimeline();
+/** The boot before this one, or null after power-on. */
+const BootTimeline* previousBootTimeline();
+/** The previous boot reset before every boot step had finished. */
+bool previousBootIncomplete();
+/** The longest phase of this boot, BOOT_PHASE_NONE when none ran. */
+uint8_t bootSlowestPhase();
+
+const char* bootPhaseName(uint8_t phase);
+const char* bootMilestoneName(uint8_t milestone);
+
+#ifdef PIO_UNIT_TESTING
+/** A power cycle: the retained record is lost. */
+void test_bootPowerOn();
+#endif
+
+#endif // BOOT_PROFILE_H
@@ -131,6 +131,8 @@ void selfUpdateTaskFn(void* /*params*/) {
 // ───────────────────────────────────────────────────────────────────────
 void handleRoot() {
   File f = FS_IMPL.open("/bootstrap.html", "r");
+  // fs images ship text assets gzip-only; streamFile() labels a .gz itself
+  if (!f) f = FS_IMPL.open("/bootstrap.html.gz", "r");
   if (!f) {
     server.send(404, "text/plain",
                 "bootstrap.html not found — fs may not be flashed");
@@ -1,4 +1,6 @@
 #include "clock_display.h"
+#include "boot_profile.h"
+#include "retained_clock.h"
 #include "led_controller.h"
 #include "led_events.h"
 #include "led_state.h"
@@ -66,6 +68,7 @@ bool ClockDisplay::update() {
     } else {
         displayStaticTime(dt);
     }
+    bootMilestone(BootMilestone::FirstFrame);
     
     return true;
 }
@@ -93,13 +96,22 @@ bool ClockDisplay::updateTimeCache(unsigned long nowMs) {
     // Refresh cached time at most once per second
     if (!time_.valid || (nowMs - time_.lastFetchMs) >= 1000UL) {
         struct tm t = {};
-        if (getLocalTime(&t)) {
+        // No wait: until NTP answers this runs every pass of the loop
+        if (getLocalTime(&t, 0)) {
             time_.cached = t;
             time_.valid = true;
             time_.lastFetchMs = nowMs;
-            g_initialTimeSyncSucceeded = true;
+            // Kept for a warm restart. Time carried over one only counts as
+            // synced once SNTP confirms it.
+            retainTime();
+            if (!g_initialTimeSyncSucceeded && timeConfidence() == TimeConfidence::Synced) {
+                // NTP came through after boot gave up on it
+                logRewriteUnsynced();
+                g_initialTimeSyncSucceeded = true;
+                bootMilestone(BootMilestone::TimeSynced);
+                ledEventStop(LedEvent::NtpFailed);
+            }
             loggedInitialTimeFailure_ = false;
-            ledEventStop(LedEvent::NtpFailed);
             nightMode.updateFromTime(time_.cached);
             resetNoTimeIndicator();
             return true;
@@ -113,7 +125,8 @@ bool ClockDisplay::updateTimeCache(unsigned long nowMs) {
 }
 
 void ClockDisplay::handleNoTime(unsigned long nowMs) {
-    if (!loggedInitialTimeFailure_) {
+    // While boot still waits for NTP, no time is expected yet
+    if (!loggedInitialTimeFailure_ && !timeSyncPending()) {
         logWarn("❗ Unable to fetch time; showing no-time indicator");
         loggedInitialTimeFailure_ = true;
     }
@@ -199,12 +212,11 @@ void ClockDisplay::buildAnimationFrames(const DisplayTime& dt, unsigned long now
     bool animate = displaySettings.getAnimateWords();
     
     if (animate) {
-        buildClassicFrames(targetSegments_, animation_.frames);
+        buildClassicFrames(targetSegments_, animation_.leds, animation_.frameEnds);
         
         // Add extra minute LEDs to final frame
-        if (!animation_.frames.empty() && dt.extra > 0) {
+        if (animation_.frameCount() > 0 && dt.extra > 0) {
 #if SUPPORT_MINUTE_LEDS
-            auto& finalFrame = animation_.frames.back();
             if (EXTRA_MINUTE_LED_GROUP_SIZE > 0) {
 #if LED_STATUS_EVENTS_ENABLED && LED_STATUS_EVENT_USE_MINUTE_LEDS
                 if (!ledEventIsActive())
@@ -214,15 +226,16 @@ void ClockDisplay::buildAnimationFrames(const DisplayTime& dt, unsigned long now
                     for (int i = 0; i < dt.extra && i < 4 && i < static_cast<int>(symbolCount); ++i) {
                         size_t base = static_cast<size_t>(i) * EXTRA_MINUTE_LED_GROUP_SIZE;
                         for (size_t j = 0; j < EXTRA_MINUTE_LED_GROUP_SIZE; ++j) {
-                            finalFrame.push_back(EXTRA_MINUTE_LEDS[base + j]);
+                            animation_.leds.push_back(EXTRA_MINUTE_LEDS[base + j]);
                         }
                     }
+                    animation_.frameEnds.back() = static_cast<uint16_t>(animation_.leds.size());
                 }
             }
 #endif
         }
         
-        if (!animation_.frames.empty()) {
+        if (animation_.frameCount() > 0) {
             animation_.active = true;
             animation_.currentStep = 0;
             animation_.lastStepAt = millis();
@@ -248,45 +261,36 @@ void ClockDisplay::executeAnimationStep(unsigned long nowMs) {
     const uint16_t frameDelayMs = 500;
     
     if (animation_.currentStep == 0 || deltaMs >= frameDelayMs) {
-        if (animation_.currentStep < (int)animation_.frames.size()) {
-            const auto& frame = animation_.frames[animation_.currentStep];
+        if (animation_.currentStep < (int)animation_.frameCount()) {
+            size_t frameSize = animation_.frameSize(animation_.currentStep);
             
             // Logging
-            size_t prevSize = (animation_.currentStep == 0) ? 0 
-                            : animation_.frames[animation_.currentStep - 1].size();
+            size_t prevSize = animation_.frameSize(animation_.currentStep - 1);
             int stepIndex = animation_.currentStep; // capture before increment
             animation_.currentStep++;
             
             // Warn if actual delay is > 20% longer than configured delay
             uint16_t thresholdMs = frameDelayMs + (frameDelayMs / 5); // frameDelayMs * 1.2
             if (deltaMs > thresholdMs) {
-                String msg = "Anim step ";
-                msg += (stepIndex + 1);
-                msg += "/";
-                msg += animation_.frames.size();
-                msg += " dt=";
-                msg += deltaMs;
-                msg += "ms (Δ";
-                msg += (int)frame.size() - (int)prevSize;
-                msg += " leds)";
-                msg += " ⚠️ slow";
-                logWarn(msg);
+                logWarnf("Anim step %d/%u dt=%lums (Δ%d leds) ⚠️ slow", stepIndex + 1,
+                         (unsigned)animation_.frameCount(), (unsigned long)deltaMs,
+                         (int)frameSize - (int)prevSize);
             }
             
             // Instant display (no fade effects)
-            showLeds(frame);
+            showLeds(animation_.leds.data(), frameSize);
             
             animation_.lastStepAt = nowMs;
         }
         
-        if (animation_.currentStep >= (int)animation_.frames.size()) {
+        if (animation_.currentStep >= (int)animation_.frameCount()) {
             animation_.active = false;
             updateHetIsVisibility(nowMs);
             lastSegments_ = targetSegments_;
         }
-    } else if (animation_.currentStep > 0 && animation_.currentStep <= (int)animation_.frames.size()) {
+    } else if (animation_.currentStep > 0 && animation_.currentStep <= (int)animation_.frameCount()) {
         // Re-display current frame (called between animation steps)
-        showLeds(animation_.frames[animation_.currentStep - 1]);
+        showLeds(animation_.leds.data(), animation_.frameSize(animation_.currentStep - 1));
     }
 }
 
@@ -411,12 +415,13 @@ bool ClockDisplay::hetIsCurrentlyVisible(uint16_t hetIsDurationSec, unsigned lon
     return nowMs < hetIsVisibleUntil;
 }
 
-void ClockDisplay::buildClassicFrames(const std::vector<WordSegment>& segs, 
-                                     std::vector<std::vector<uint16_t>>& frames) {
-    frames.clear();
-    std::vector<uint16_t> cumulative;
+void ClockDisplay::buildClassicFrames(const std::vector<WordSegment>& segs, BulkVector<uint16_t>& leds,
+                                     BulkVector<uint16_t>& frameEnds) {
+    leds.clear();
+    frameEnds.clear();
+    frameEnds.reserve(segs.size());
     for (const auto& seg : segs) {
-        cumulative.insert(cumulative.end(), seg.leds.begin(), seg.leds.end());
-        frames.push_back(cumulative);
+        leds.insert(leds.end(), seg.leds.begin(), seg.leds.end());
+        frameEnds.push_back(static_cast<uint16_t>(leds.size()));
     }
 }
@@ -5,6 +5,7 @@
 #include <vector>
 #include "time_mapper.h"
 #include "display_settings.h"
+#include "mem_pool.h"
 
 /**
  * @brief Manages word clock display state and animation
@@ -49,7 +50,9 @@ public:
     static const WordSegment* findSegment(const std::vector<WordSegment>& segs, const char* key);
     static void removeLeds(std::vector<uint16_t>& base, const std::vector<uint16_t>& toRemove);
     static bool hetIsCurrentlyVisible(uint16_t hetIsDurationSec, unsigned long hetIsVisibleUntil, unsigned long nowMs);
-    static void buildClassicFrames(const std::vector<WordSegment>& segs, std::vector<std::vector<uint16_t>>& frames);
+    /** Frame k of the word-by-word animation shows leds[0, frameEnds[k]). */
+    static void buildClassicFrames(const std::vector<WordSegment>& segs, BulkVector<uint16_t>& leds,
+                                   BulkVector<uint16_t>& frameEnds);
     
 private:
     // State management structures
@@ -57,7 +60,11 @@ private:
         bool active = false;
         unsigned long lastStepAt = 0;
         int currentStep = 0;
-        std::vector<std::vector<uint16_t>> frames;
+        // Each frame adds to the one before, so one list holds them all
+        BulkVector<uint16_t> leds;
+        BulkVector<uint16_t> frameEnds;
+        size_t frameCount() const { return frameEnds.size(); }
+        size_t frameSize(int step) const { return step < 0 ? 0 : frameEnds[step]; }
     };
     
     struct TimeState {
@@ -14,7 +14,25 @@
 #define DEFAULT_LOG_LEVEL LOG_LEVEL_ERROR
 #endif
 #ifndef LOG_BUFFER_SIZE
-#define LOG_BUFFER_SIZE 50  // Reduced from 150 to save flash space
+#define LOG_BUFFER_SIZE 64  // Records in the binary log ring (x LOG_RECORD_SIZE bytes, Bulk pool)
+#endif
+#ifndef LOG_BOOT_RECORDS
+#define LOG_BOOT_RECORDS 8  // Static ring used until initLogSettings() moves it to the Bulk pool
+#endif
+// Log calls below this level are compiled out (0 = DEBUG ... 3 = ERROR).
+// Release envs raise it in platformio.ini; setting a lower runtime level
+// then has no effect for the removed calls.
+#ifndef LOG_COMPILE_MIN_LEVEL
+#define LOG_COMPILE_MIN_LEVEL 0
+#endif
+
+// Settings store (settings_store.h): room for every registered key, and how
+// long the oldest unsaved change waits before one batched NVS commit
+#ifndef SETTINGS_MAX_KEYS
+#define SETTINGS_MAX_KEYS 40
+#endif
+#ifndef SETTINGS_COMMIT_DELAY_MS
+#define SETTINGS_COMMIT_DELAY_MS 5000
 #endif
 
 // Default update channel (can be overridden by product_config.h)
@@ -44,6 +62,13 @@
 #define OTA2_NO_CACHE_HEADERS 1
 #endif
 
+// The web UI is compiled into the firmware (tools/embed_assets.py). A file at
+// ASSET_OVERRIDE_DIR + path on LittleFS (plain, .gz or .br) replaces the
+// embedded copy; overrides are found once at boot.
+#ifndef ASSET_OVERRIDE_DIR
+#define ASSET_OVERRIDE_DIR "/override"
+#endif
+
 #ifndef BLE_PROVISIONING_ENABLED
 #define BLE_PROVISIONING_ENABLED 0
 #endif
@@ -60,6 +85,10 @@
 #define BLE_DEVICE_NAME_PREFIX PRODUCT_ID "-"
 #endif
 
+#ifndef BLE_STATUS_JSON_BYTES
+#define BLE_STATUS_JSON_BYTES 320  // Status notify payload, built in a FixedString
+#endif
+
 #ifndef BLE_PASSKEY_DISPLAY_ENABLED
 #define BLE_PASSKEY_DISPLAY_ENABLED 0
 #endif
@@ -124,6 +153,10 @@
 #define WIFI_PORTAL_FALLBACK_MS (WIFI_CONFIG_PORTAL_TIMEOUT * 1000UL) // ms without WiFi before opening portal
 #define WIFI_CONNECT_MAX_RETRIES 20
 #define WIFI_CONNECT_RETRY_DELAY_MS 500
+// Boot connect window when WiFiManager owns the fallback: what its
+// autoConnect() waited (WiFi.waitForConnectResult()'s default) before it
+// opened the portal
+#define WIFI_MANAGER_CONNECT_WAIT_MS 60000UL
 #define MDNS_HOSTNAME "wordclock"
 #define MDNS_START_DELAY_MS 1000
 // How long to wait before retrying a failed mDNS registration. Registration
@@ -133,6 +166,38 @@
 #define MDNS_RETRY_INTERVAL_MS 10000
 #define TIME_SYNC_TIMEOUT_MS 15000
 
+// MQTT state publishing. Retained state is only re-sent when its payload
+// changes; the full set goes out on connect and once per refresh interval so
+// a broker that lost its retained store recovers. Noisy sensors publish only
+// when they move by at least their deadband.
+#ifndef MQTT_STATE_REFRESH_MS
+#define MQTT_STATE_REFRESH_MS (15UL * 60UL * 1000UL)
+#endif
+#ifndef MQTT_RSSI_DEADBAND_DB
+#define MQTT_RSSI_DEADBAND_DB 3
+#endif
+#ifndef MQTT_HEAP_DEADBAND_BYTES
+#define MQTT_HEAP_DEADBAND_BYTES 4096
+#endif
+// Session setup after CONNECT (subscribe, state, discovery) runs from the
+// loop: per tick, stop starting new items after this long or this many.
+#ifndef MQTT_SETUP_TICK_BUDGET_MS
+#define MQTT_SETUP_TICK_BUDGET_MS 15
+#endif
+#ifndef MQTT_SETUP_ITEMS_PER_TICK
+#define MQTT_SETUP_ITEMS_PER_TICK 4
+#endif
+// Upper bound on waiting for CONNACK and other broker replies
+// (PubSubClient's default is 15 s, all of it inside one loop tick)
+#ifndef MQTT_SOCKET_TIMEOUT_S
+#define MQTT_SOCKET_TIMEOUT_S 5
+#endif
+// Offline outbox: one slot per state topic (last value wins), allocated
+// from PSRAM. Drained this many messages per loop.
+#ifndef MQTT_OUTBOX_DRAIN_PER_TICK
+#define MQTT_OUTBOX_DRAIN_PER_TICK 4
+#endif
+
 #define OTA_UPDATE_COMPLETE_DELAY_MS 1000
 #define EEPROM_WRITE_DELAY_MS 500
 
@@ -7,6 +7,7 @@
 #include "config.h"
 #include "device_identity.h"
 #include "display_settings.h"
+#include "json_arena.h"
 #include "log.h"
 #include "ota_updater.h"
 #include "secrets.h"
@@ -34,7 +35,8 @@ bool register_device_with_fleet(String& outDeviceId, String& outToken, String& o
   http.addHeader("Content-Type", "application/json");
   http.addHeader(PROVISIONING_KEY_HEADER, REGISTER_API_TOKEN);
 
-  JsonDocument req;
+  JSON_SCOPE(json, "device registration");
+  JsonDocument req(json.allocator());
   req["hardwareId"] = get_hardware_id();
   req["productId"] = PRODUCT_ID;
   req["firmware"] = FIRMWARE_VERSION;
@@ -43,10 +45,16 @@ bool register_device_with_fleet(String& outDeviceId, String& outToken, String& o
   req["otaChannel"] = displaySettings.getUpdateChannel();
 #endif
 
-  String payload;
-  serializeJson(req, payload);
+  size_t length = measureJson(req);
+  char* payload = json.buffer(length + 1);
+  if (!payload) {
+    outError = "Out of memory";
+    http.end();
+    return false;
+  }
+  length = serializeJson(req, payload, length + 1);
 
-  int code = http.POST(payload);
+  int code = http.POST(reinterpret_cast<uint8_t*>(payload), length);
   if (code <= 0) {
     outError = String("HTTP error: ") + http.errorToString(code);
     http.end();
@@ -58,7 +66,7 @@ bool register_device_with_fleet(String& outDeviceId, String& outToken, String& o
 
   if (code < 200 || code >= 300) {
     String apiError;
-    JsonDocument errDoc;
+    JsonDocument errDoc(json.allocator());
     if (deserializeJson(errDoc, body) == DeserializationError::Ok &&
         errDoc["error"].is<const char*>()) {
       apiError = errDoc["error"].as<const char*>();
@@ -88,7 +96,7 @@ bool register_device_with_fleet(String& outDeviceId, String& outToken, String& o
     return false;
   }
 
-  JsonDocument resDoc;
+  JsonDocument resDoc(json.allocator());
   DeserializationError err = deserializeJson(resDoc, body);
   if (err) {
     outError = String("JSON parse error: ") + err.c_str();
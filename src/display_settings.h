@@ -2,29 +2,41 @@
 #include <Preferences.h>
 
 #include "log.h"
+#include "settings_store.h"
+#include "state_events.h"
 
 enum class WordAnimationMode : uint8_t { Classic = 0 };
 
 class DisplaySettings {
 public:
   void begin() {
-    prefs_.begin("wc_display", false);  // Note: renamed namespace for safety
-    hetIsDurationSec_ = prefs_.getUShort("his_sec", 360); // default ALWAYS (360s)
+    // "wc_display": renamed namespace for safety
+    hetIsKey_ = settingsStore.addU16(PREF_NAMESPACE, "his_sec", 360); // default ALWAYS (360s)
+    sellKey_ = settingsStore.addBool(PREF_NAMESPACE, "sell_on", false);
+    animateKey_ = settingsStore.addBool(PREF_NAMESPACE, "anim_on", false); // default OFF unless enabled via UI
+    autoUpdateKey_ = settingsStore.addBool(PREF_NAMESPACE, "auto_upd", true);
+
+    hetIsDurationSec_ = settingsStore.getU16(hetIsKey_);
     if (hetIsDurationSec_ > 360) hetIsDurationSec_ = 360;
-    sellMode_ = prefs_.getBool("sell_on", false);
-    animateWords_ = prefs_.getBool("anim_on", false); // default OFF unless enabled via UI
+    sellMode_ = settingsStore.getBool(sellKey_);
+    animateWords_ = settingsStore.getBool(animateKey_);
     animationMode_ = WordAnimationMode::Classic; // Only Classic mode available
 
-    autoUpdate_ = prefs_.getBool("auto_upd", true);
+    autoUpdate_ = settingsStore.getBool(autoUpdateKey_);
 
     // Legacy NVS hygiene: older firmwares persisted a runtime grid_id under
     // this namespace. The grid is now compile-time only (one variant per
     // product, see grid_layout.cpp::GRID_VARIANTS), so the key is dead and
-    // removed if present. Safe to call when the key doesn't exist.
-    if (prefs_.isKey("grid_id")) {
-      prefs_.remove("grid_id");
+    // removed if present. Safe to call when the key doesn't exist. A boot
+    // from the settings snapshot has done this before and skips it.
+    if (!settingsStore.snapshotLoaded()) {
+      Preferences prefs;
+      prefs.begin(PREF_NAMESPACE, false);
+      if (prefs.isKey("grid_id")) {
+        prefs.remove("grid_id");
+      }
+      prefs.end();
     }
-    prefs_.end();
 
     // Update channel: persisted user choice wins. On first boot (no
     // stored value yet) derive the default from FIRMWARE_VERSION rather
@@ -34,13 +46,10 @@ public:
     // "26.5.10-rc.3" because the suffix differs). The user can still
     // change the channel via the admin UI; once stored, that choice
     // survives reboots and any future re-flash leaves it untouched.
-    prefs_.begin("wc_display", true);
-    hasStoredUpdateChannel_ = prefs_.isKey("upd_ch");
     const String buildChannel = detectBuildChannel();
-    String ch = hasStoredUpdateChannel_
-                  ? prefs_.getString("upd_ch", buildChannel)
-                  : buildChannel;
-    prefs_.end();
+    channelKey_ = settingsStore.addString(PREF_NAMESPACE, "upd_ch", buildChannel.c_str());
+    hasStoredUpdateChannel_ = settingsStore.isStored(channelKey_);
+    String ch = settingsStore.getString(channelKey_);
     ch.toLowerCase();
     if (ch != "stable" && ch != "early" && ch != "develop") ch = "stable";
     updateChannel_ = ch;
@@ -50,15 +59,10 @@ public:
     }
     if (updateChannel_ == "develop" && autoUpdate_) {
       autoUpdate_ = false;
-      prefs_.begin("wc_display", false);
-      prefs_.putBool("auto_upd", autoUpdate_);
-      prefs_.end();
+      settingsStore.setBool(autoUpdateKey_, autoUpdate_);
       logInfo("🔁 Automatic updates disabled for develop channel");
     }
     initialized_ = true;
-
-    dirty_ = false;
-    lastFlush_ = millis();
   }
 
   uint16_t getHetIsDurationSec() const { return hetIsDurationSec_; }
@@ -67,7 +71,7 @@ public:
   WordAnimationMode getAnimationMode() const { return animationMode_; }
   uint8_t getAnimationModeId() const { return static_cast<uint8_t>(animationMode_); }
   bool getAutoUpdate() const { return autoUpdate_; }
-  String getUpdateChannel() const { return updateChannel_; }
+  const String& getUpdateChannel() const { return updateChannel_; }
   bool hasStoredChannel() const { return hasStoredUpdateChannel_; }
 
   void setHetIsDurationSec(uint16_t s) {
@@ -127,39 +131,20 @@ public:
 
   /**
    * @brief Force immediate write to persistent storage
-   * @note Call before critical operations (OTA, deep sleep, restart)
+   * @note Commits every pending setting, not only these (settings_store.h)
    */
-  void flush() {
-    if (!dirty_) return;
-
-    prefs_.begin("wc_display", false);
-    // Batch write all settings
-    prefs_.putUShort("his_sec", hetIsDurationSec_);
-    prefs_.putBool("sell_on", sellMode_);
-    prefs_.putBool("anim_on", animateWords_);
-    prefs_.putUChar("anim_mode", static_cast<uint8_t>(animationMode_));
-    prefs_.putBool("auto_upd", autoUpdate_);
-    prefs_.putString("upd_ch", updateChannel_);
-    prefs_.end();
-
-    dirty_ = false;
-    lastFlush_ = millis();
-  }
+  void flush() { settingsStore.commit(); }
 
   /**
-   * @brief Automatic flush if dirty and sufficient time passed
-   * @note Call periodically from main loop (every 1-5 seconds)
+   * @brief Automatic flush once the oldest unsaved change is old enough
+   * @note Same as settingsStore.loop(); the runtime calls that directly
    */
-  void loop() {
-    if (dirty_ && (millis() - lastFlush_) >= AUTO_FLUSH_DELAY_MS) {
-      flush();
-    }
-  }
+  void loop() { settingsStore.loop(millis()); }
 
   // Query persistence state
-  bool isDirty() const { return dirty_; }
+  bool isDirty() const { return settingsStore.pending(PREF_NAMESPACE); }
   unsigned long millisSinceLastFlush() const {
-    return millis() - lastFlush_;
+    return millis() - settingsStore.pendingSinceMs();
   }
 
 private:
@@ -177,11 +162,17 @@ private:
     return String("stable");
   }
 
+  static constexpr const char* PREF_NAMESPACE = "wc_display";
+
   void markDirty() {
-    if (!dirty_) {
-      dirty_ = true;
-      lastFlush_ = millis();
-    }
+    // Only the values that differ from the store's shadow become pending.
+    // The animation mode is not persisted: Classic is the only one.
+    settingsStore.setU16(hetIsKey_, hetIsDurationSec_);
+    settingsStore.setBool(sellKey_, sellMode_);
+    settingsStore.setBool(animateKey_, animateWords_);
+    settingsStore.setBool(autoUpdateKey_, autoUpdate_);
+    settingsStore.setString(channelKey_, updateChannel_.c_str());
+    notifyStateChanged(StateChange::Display);
   }
 
   uint16_t hetIsDurationSec_ = 360; // default ALWAYS
@@ -192,12 +183,12 @@ private:
   String updateChannel_ = "stable";
   bool hasStoredUpdateChannel_ = false;
   bool initialized_ = false;
-  bool dirty_ = false;
-  unsigned long lastFlush_ = 0;
-
-  Preferences prefs_;
 
-  static const unsigned long AUTO_FLUSH_DELAY_MS = 5000;  // 5 seconds
+  SettingKey hetIsKey_ = SETTING_NONE;
+  SettingKey sellKey_ = SETTING_NONE;
+  SettingKey animateKey_ = SETTING_NONE;
+  SettingKey autoUpdateKey_ = SETTING_NONE;
+  SettingKey channelKey_ = SETTING_NONE;
 };
 
 extern DisplaySettings displaySettings;
@@ -0,0 +1,173 @@
+#include "event_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// Sent first: how long the browser waits before reconnecting
+const char kPreamble[] = "retry: 3000\n\n";
+const char kKeepalive[] = ": ping\n\n";
+
+size_t trimmedLength(const char* data, size_t length) {
+  if (length > 0 && data[length - 1] == '\n') length--;
+  if (length > 0 && data[length - 1] == '\r') length--;
+  return length;
+}
+
+}  // namespace
+
+size_t EventStreamHub::frameSize(const char* event, const char* data, size_t length) {
+  length = trimmedLength(data, length);
+  size_t size = 7 + strlen(event) + 1 + 1;  // "event: " name "\n" ... "\n"
+  size_t start = 0;
+  while (true) {
+    const char* nl = (const char*)memchr(data + start, '\n', length - start);
+    size_t end = nl ? (size_t)(nl - data) : length;
+    size += 6 + (end - start) + 1;  // "data: " line "\n"
+    if (!nl) break;
+    start = end + 1;
+  }
+  return size;
+}
+
+void EventStreamHub::writeFrame(uint8_t* out, const char* event, const char* data, size_t length) {
+  length = trimmedLength(data, length);
+  char* p = reinterpret_cast<char*>(out);
+  memcpy(p, "event: ", 7);
+  p += 7;
+  size_t n = strlen(event);
+  memcpy(p, event, n);
+  p += n;
+  *p++ = '\n';
+  size_t start = 0;
+  while (true) {
+    const char* nl = (const char*)memchr(data + start, '\n', length - start);
+    size_t end = nl ? (size_t)(nl - data) : length;
+    memcpy(p, "data: ", 6);
+    p += 6;
+    memcpy(p, data + start, end - start);
+    p += end - start;
+    *p++ = '\n';
+    if (!nl) break;
+    start = end + 1;
+  }
+  *p = '\n';
+}
+
+bool EventStreamHub::enqueue(Slot& slot, const char* event, const char* data, size_t length,
+                             unsigned long nowMs) {
+  size_t need = frameSize(event, data, length);
+  char note[16] = "";
+  size_t noteLen = 0;
+  size_t noteNeed = 0;
+  if (slot.dropped) {
+    int n = snprintf(note, sizeof(note), "%lu", (unsigned long)slot.dropped);
+    noteLen = n > 0 ? (size_t)n : 0;
+    noteNeed = frameSize("dropped", note, noteLen);
+  }
+  if (slot.used + noteNeed + need > sizeof(slot.queue)) {
+    slot.dropped++;
+    stats_.dropped++;
+    return false;
+  }
+  // The stall clock runs from when the queue stopped being empty
+  if (slot.used == 0) slot.lastProgressMs = nowMs;
+  if (noteNeed) {
+    writeFrame(slot.queue + slot.used, "dropped", note, noteLen);
+    slot.used += noteNeed;
+    slot.dropped = 0;
+  }
+  writeFrame(slot.queue + slot.used, event, data, length);
+  slot.used += need;
+  slot.lastQueuedMs = nowMs;
+  return true;
+}
+
+bool EventStreamHub::subscribe(std::unique_ptr<EventStreamTransport> transport, unsigned long nowMs) {
+  if (!transport) return false;
+  nowMs_ = nowMs;
+  for (Slot& slot : slots_) {
+    if (slot.transport) continue;
+    slot.transport = std::move(transport);
+    memcpy(slot.queue, kPreamble, sizeof(kPreamble) - 1);
+    slot.used = sizeof(kPreamble) - 1;
+    slot.dropped = 0;
+    slot.lastProgressMs = nowMs;
+    slot.lastQueuedMs = nowMs;
+    return true;
+  }
+  stats_.rejected++;
+  transport->close();
+  return false;
+}
+
+void EventStreamHub::publish(const char* event, const char* data, size_t length) {
+  bool any = false;
+  for (Slot& slot : slots_) {
+    if (!slot.transport) continue;
+    any = true;
+    enqueue(slot, event, data, length, nowMs_);
+  }
+  if (any) stats_.published++;
+}
+
+void EventStreamHub::release(Slot& slot) {
+  if (slot.transport) slot.transport->close();
+  slot.transport.reset();
+  slot.used = 0;
+  slot.dropped = 0;
+}
+
+void EventStreamHub::service(unsigned long nowMs) {
+  nowMs_ = nowMs;
+  for (Slot& slot : slots_) {
+    if (!slot.transport) continue;
+    if (slot.used == 0 && slot.dropped) {
+      // Caught up after losing frames: say so even if nothing new is coming
+      char note[16];
+      int n = snprintf(note, sizeof(note), "%lu", (unsigned long)slot.dropped);
+      size_t noteLen = n > 0 ? (size_t)n : 0;
+      writeFrame(slot.queue, "dropped", note, noteLen);
+      slot.used = frameSize("dropped", note, noteLen);
+      slot.dropped = 0;
+      slot.lastProgressMs = nowMs;
+      slot.lastQueuedMs = nowMs;
+    }
+    if (slot.used == 0 && nowMs - slot.lastQueuedMs >= EVENT_STREAM_KEEPALIVE_MS) {
+      memcpy(slot.queue, kKeepalive, sizeof(kKeepalive) - 1);
+      slot.used = sizeof(kKeepalive) - 1;
+      slot.lastProgressMs = nowMs;
+      slot.lastQueuedMs = nowMs;
+    }
+    if (slot.used == 0) continue;
+
+    int sent = slot.transport->trySend(slot.queue, slot.used);
+    if (sent < 0) {
+      stats_.disconnects++;
+      release(slot);
+      continue;
+    }
+    if (sent > 0) {
+      size_t n = (size_t)sent < slot.used ? (size_t)sent : slot.used;
+      memmove(slot.queue, slot.queue + n, slot.used - n);
+      slot.used -= n;
+      slot.lastProgressMs = nowMs;
+    } else if (nowMs - slot.lastProgressMs >= EVENT_STREAM_STALL_MS) {
+      stats_.disconnects++;
+      release(slot);
+    }
+  }
+}
+
+void EventStreamHub::closeAll() {
+  for (Slot& slot : slots_) release(slot);
+}
+
+size_t EventStreamHub::subscriberCount() const {
+  size_t n = 0;
+  for (const Slot& slot : slots_) {
+    if (slot.transport) n++;
+  }
+  return n;
+}
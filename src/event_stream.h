@@ -0,0 +1,104 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// Concurrent /api/events subscribers; the next one gets 503.
+#ifndef EVENT_STREAM_MAX_CLIENTS
+#define EVENT_STREAM_MAX_CLIENTS 3
+#endif
+// Bytes queued per subscriber while its socket is not taking data.
+#ifndef EVENT_STREAM_QUEUE_BYTES
+#define EVENT_STREAM_QUEUE_BYTES 2048
+#endif
+// A subscriber whose queue has not moved for this long is disconnected.
+#ifndef EVENT_STREAM_STALL_MS
+#define EVENT_STREAM_STALL_MS 15000
+#endif
+// Comment line sent after this much silence, to find dead connections.
+#ifndef EVENT_STREAM_KEEPALIVE_MS
+#define EVENT_STREAM_KEEPALIVE_MS 20000
+#endif
+
+/** Non-blocking byte sink for one subscriber (a TCP socket on the device). */
+class EventStreamTransport {
+public:
+  virtual ~EventStreamTransport() = default;
+  /** Write what fits without blocking: bytes taken, 0 when full, -1 when closed. */
+  virtual int trySend(const uint8_t* data, size_t length) = 0;
+  virtual void close() = 0;
+};
+
+/**
+ * @brief Server-Sent Events fan-out with per-subscriber backpressure
+ *
+ * publish() formats one SSE frame ("event: x\ndata: ...\n\n") into every
+ * subscriber's queue; service() pushes queued bytes to the sockets without
+ * blocking. A frame that does not fit in a subscriber's queue is dropped
+ * for that subscriber only; once it drains, it gets an "event: dropped"
+ * frame with the count so the page can reload what it missed. Subscribers
+ * that stop reading for EVENT_STREAM_STALL_MS are closed.
+ *
+ * Storage is fixed: EVENT_STREAM_MAX_CLIENTS queues of
+ * EVENT_STREAM_QUEUE_BYTES. Not thread-safe; the firmware drives it from
+ * loop().
+ */
+class EventStreamHub {
+public:
+  struct Stats {
+    uint32_t published = 0;    // publish() calls with at least one subscriber
+    uint32_t dropped = 0;      // frames dropped for a full queue, summed over subscribers
+    uint32_t rejected = 0;     // subscribe() refused: all slots taken
+    uint32_t disconnects = 0;  // closed by the peer or for stalling
+  };
+
+  EventStreamHub() = default;
+  EventStreamHub(const EventStreamHub&) = delete;
+  EventStreamHub& operator=(const EventStreamHub&) = delete;
+
+  /**
+   * @brief Add a subscriber; the hub owns the transport from here on
+   * @return false (transport closed and released) when all slots are taken
+   */
+  bool subscribe(std::unique_ptr<EventStreamTransport> transport, unsigned long nowMs);
+
+  /**
+   * @brief Queue an event for every subscriber
+   * @param data payload; each '\n'-separated line becomes a data: line, and
+   *        a trailing newline is ignored
+   */
+  void publish(const char* event, const char* data, size_t length);
+
+  /** Send queued bytes, keepalives and drop notices; close dead or stalled subscribers. */
+  void service(unsigned long nowMs);
+
+  /** Close every subscriber. */
+  void closeAll();
+
+  size_t subscriberCount() const;
+  bool hasSubscribers() const { return subscriberCount() > 0; }
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Slot {
+    std::unique_ptr<EventStreamTransport> transport;
+    uint8_t queue[EVENT_STREAM_QUEUE_BYTES];
+    size_t used = 0;
+    uint32_t dropped = 0;          // frames lost since the last drop notice
+    unsigned long lastProgressMs = 0;
+    unsigned long lastQueuedMs = 0;
+  };
+
+  static size_t frameSize(const char* event, const char* data, size_t length);
+  static void writeFrame(uint8_t* out, const char* event, const char* data, size_t length);
+  bool enqueue(Slot& slot, const char* event, const char* data, size_t length, unsigned long nowMs);
+  void release(Slot& slot);
+
+  Slot slots_[EVENT_STREAM_MAX_CLIENTS];
+  unsigned long nowMs_ = 0;
+  Stats stats_;
+};
+
+#endif // EVENT_STREAM_H
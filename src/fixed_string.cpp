@@ -0,0 +1,148 @@
+#include "fixed_string.h"
+#include "heap_tracker.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+namespace {
+
+std::atomic<uint32_t> g_truncations{0};
+std::atomic<uint32_t> g_reallocs{0};
+
+}  // namespace
+
+#ifndef PIO_UNIT_TESTING
+// realloc() as the rest of the link sees it; see reallocCount()
+extern "C" void* __real_realloc(void* ptr, size_t size);
+
+extern "C" void* __wrap_realloc(void* ptr, size_t size) {
+  g_reallocs.fetch_add(1, std::memory_order_relaxed);
+#if HEAP_TRACKING
+  return heapTrackedRealloc(ptr, size);
+#else
+  return __real_realloc(ptr, size);
+#endif
+}
+#endif
+
+void StringBuilder::cut() {
+  if (!truncated_) g_truncations.fetch_add(1, std::memory_order_relaxed);
+  truncated_ = true;
+}
+
+StringBuilder& StringBuilder::append(const char* s) {
+  return s ? append(s, strlen(s)) : *this;
+}
+
+StringBuilder& StringBuilder::append(const char* s, size_t n) {
+  // Once something is cut, later pieces are dropped too, never spliced on
+  if (truncated_) return *this;
+  size_t room = size_ - 1 - len_;
+  if (n > room) {
+    n = room;
+    cut();
+  }
+  memcpy(buf_ + len_, s, n);
+  len_ += n;
+  buf_[len_] = '\0';
+  return *this;
+}
+
+StringBuilder& StringBuilder::append(char c) {
+  return append(&c, 1);
+}
+
+StringBuilder& StringBuilder::append(long v) {
+  char tmp[24];
+  int n = snprintf(tmp, sizeof(tmp), "%ld", v);
+  return append(tmp, static_cast<size_t>(n));
+}
+
+StringBuilder& StringBuilder::append(unsigned long v) {
+  char tmp[24];
+  int n = snprintf(tmp, sizeof(tmp), "%lu", v);
+  return append(tmp, static_cast<size_t>(n));
+}
+
+StringBuilder& StringBuilder::appendf(const char* fmt, ...) {
+  if (truncated_) return *this;
+  size_t room = size_ - len_;
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf_ + len_, room, fmt, args);
+  va_end(args);
+  if (n < 0) {
+    buf_[len_] = '\0';
+    return *this;
+  }
+  if (static_cast<size_t>(n) >= room) {
+    len_ = size_ - 1;
+    cut();
+  } else {
+    len_ += static_cast<size_t>(n);
+  }
+  return *this;
+}
+
+StringBuilder& StringBuilder::appendJsonEscaped(const char* s) {
+  if (!s) return *this;
+  for (; *s && !truncated_; ++s) {
+    char c = *s;
+    char esc[8];
+    size_t n = 2;
+    esc[0] = '\\';
+    switch (c) {
+      case '\\': esc[1] = '\\'; break;
+      case '"': esc[1] = '"'; break;
+      case '\n': esc[1] = 'n'; break;
+      case '\r': esc[1] = 'r'; break;
+      case '\t': esc[1] = 't'; break;
+      default:
+        if (static_cast<unsigned char>(c) >= 0x20) {
+          append(c);
+          continue;
+        }
+        n = static_cast<size_t>(snprintf(esc, sizeof(esc), "\\u%04x", static_cast<unsigned>(c)));
+        break;
+    }
+    // An escape is written whole or not at all, so a cut never leaves a
+    // dangling backslash
+    if (n > size_ - 1 - len_) {
+      cut();
+    } else {
+      append(esc, n);
+    }
+  }
+  return *this;
+}
+
+void StringBuilder::clear() {
+  len_ = 0;
+  truncated_ = false;
+  buf_[0] = '\0';
+}
+
+uint32_t fixedStringTruncations() {
+  return g_truncations.load(std::memory_order_relaxed);
+}
+
+uint32_t reallocCount() {
+  return g_reallocs.load(std::memory_order_relaxed);
+}
+
+float ReallocMeter::perSecond(unsigned long nowMs) {
+  uint32_t count = reallocCount();
+  unsigned long elapsed = nowMs - lastMs_;
+  float rate = elapsed > 0 ? (count - lastCount_) * 1000.0f / elapsed : 0.0f;
+  lastCount_ = count;
+  lastMs_ = nowMs;
+  return rate;
+}
+
+#ifdef PIO_UNIT_TESTING
+void test_noteRealloc() {
+  g_reallocs.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
@@ -0,0 +1,124 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Text built in a fixed buffer, never on the heap
+ *
+ * The append calls cover what the String concatenations on periodic paths
+ * did: text, numbers, printf-style pieces and JSON-escaped values. What does
+ * not fit is cut off at the capacity, and so is everything appended after
+ * it until clear(). The string stays NUL-terminated and remembers that it
+ * was cut. The first cut of each string is counted in
+ * fixedStringTruncations(), so an undersized buffer shows up in the numbers
+ * instead of as a short topic or payload.
+ *
+ * Use FixedString<N>; this base is what functions take so they work with any N.
+ */
+class StringBuilder {
+public:
+  StringBuilder(const StringBuilder&) = delete;
+  StringBuilder& operator=(const StringBuilder&) = delete;
+
+  StringBuilder& append(const char* s);
+  StringBuilder& append(const char* s, size_t n);
+  StringBuilder& append(const String& s) { return append(s.c_str(), s.length()); }
+  StringBuilder& append(char c);
+  StringBuilder& append(int v) { return append(static_cast<long>(v)); }
+  StringBuilder& append(unsigned v) { return append(static_cast<unsigned long>(v)); }
+  StringBuilder& append(long v);
+  StringBuilder& append(unsigned long v);
+  StringBuilder& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  /** `s` with JSON string escaping, without the surrounding quotes. */
+  StringBuilder& appendJsonEscaped(const char* s);
+
+  template <typename T>
+  StringBuilder& operator+=(const T& v) { return append(v); }
+
+  const char* c_str() const { return buf_; }
+  size_t length() const { return len_; }
+  bool empty() const { return len_ == 0; }
+  /** Most characters it holds, not counting the terminator. */
+  size_t capacity() const { return size_ - 1; }
+  /** Something appended since the last clear() did not fit. */
+  bool truncated() const { return truncated_; }
+  void clear();
+
+protected:
+  StringBuilder(char* buf, size_t size) : buf_(buf), size_(size) { buf_[0] = '\0'; }
+
+private:
+  void cut();
+
+  char* buf_;
+  size_t size_;
+  size_t len_ = 0;
+  bool truncated_ = false;
+};
+
+/**
+ * @brief StringBuilder with its own N-byte buffer (N - 1 characters)
+ */
+template <size_t N>
+class FixedString : public StringBuilder {
+  static_assert(N >= 2, "FixedString needs room for a character and the terminator");
+
+public:
+  FixedString() : StringBuilder(buf_, N) {}
+  explicit FixedString(const char* s) : FixedString() { append(s); }
+  FixedString(const FixedString& other) : FixedString() { append(other.c_str(), other.length()); }
+
+  FixedString& operator=(const FixedString& other) {
+    if (this != &other) {
+      clear();
+      append(other.c_str(), other.length());
+    }
+    return *this;
+  }
+  FixedString& operator=(const char* s) {
+    clear();
+    append(s);
+    return *this;
+  }
+
+private:
+  char buf_[N];
+};
+
+/** Strings that were cut off since boot. */
+uint32_t fixedStringTruncations();
+
+/**
+ * realloc() calls since boot, from any caller.
+ *
+ * The firmware build wraps realloc (-Wl,--wrap=realloc) to count them.
+ * Arduino String grows its buffer this way, but so do ArduinoJson's default
+ * allocator and a JsonArena that spilled to the heap, so this is an upper
+ * bound on String churn, not a measure of it. Always 0 on native builds.
+ */
+uint32_t reallocCount();
+
+/**
+ * @brief realloc() calls per second between two reads
+ *
+ * Each reader (heartbeat, /api/perf/strings) keeps its own meter, so one
+ * does not reset the other's window.
+ */
+class ReallocMeter {
+public:
+  /** Calls per second since the previous call (since boot on the first). */
+  float perSecond(unsigned long nowMs);
+
+private:
+  uint32_t lastCount_ = 0;
+  unsigned long lastMs_ = 0;
+};
+
+#ifdef PIO_UNIT_TESTING
+void test_noteRealloc();
+#endif
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,228 @@
+#include "heap_tracker.h"
+
+#include <atomic>
+
+#ifndef PIO_UNIT_TESTING
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace {
+
+const char* const kTagNames[] = {"other", "web", "mqtt", "heartbeat", "log", "ota"};
+static_assert(sizeof(kTagNames) / sizeof(kTagNames[0]) == HEAP_TAG_COUNT, "a name per HeapTag");
+
+struct TagCounters {
+  std::atomic<uint32_t> allocs{0};
+  std::atomic<uint32_t> bytes{0};
+  std::atomic<uint32_t> failures{0};
+  std::atomic<uint32_t> largest{0};
+};
+
+// The tag of each task inside a scope. A slot's tag is only written by the
+// task that holds it, and a task only reads its own slot.
+struct TaskSlot {
+  std::atomic<uintptr_t> task{0};
+  std::atomic<uint8_t> tag{0};
+};
+
+TagCounters s_tags[HEAP_TAG_COUNT];
+TaskSlot s_slots[HEAP_TAG_TASKS];
+std::atomic<uint32_t> s_frees{0};
+std::atomic<uint32_t> s_freedBytes{0};
+std::atomic<uint32_t> s_scopeMisses{0};
+
+#ifdef PIO_UNIT_TESTING
+uintptr_t s_testTask = 1;
+#endif
+
+// 0 before the scheduler runs; such allocations are always `other`
+uintptr_t currentTask() {
+#ifndef PIO_UNIT_TESTING
+  return reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle());
+#else
+  return s_testTask;
+#endif
+}
+
+int8_t findSlot(uintptr_t task) {
+  if (task == 0) return -1;
+  for (uint8_t i = 0; i < HEAP_TAG_TASKS; ++i) {
+    if (s_slots[i].task.load(std::memory_order_relaxed) == task) return static_cast<int8_t>(i);
+  }
+  return -1;
+}
+
+}  // namespace
+
+HeapTag heapCurrentTag() {
+  int8_t slot = findSlot(currentTask());
+  return slot < 0 ? HeapTag::Other
+                  : static_cast<HeapTag>(s_slots[slot].tag.load(std::memory_order_relaxed));
+}
+
+void heapNoteAlloc(size_t size, bool ok) {
+  TagCounters& c = s_tags[static_cast<uint8_t>(heapCurrentTag())];
+  c.allocs.fetch_add(1, std::memory_order_relaxed);
+  c.bytes.fetch_add(static_cast<uint32_t>(size), std::memory_order_relaxed);
+  if (!ok) c.failures.fetch_add(1, std::memory_order_relaxed);
+  uint32_t largest = c.largest.load(std::memory_order_relaxed);
+  while (size > largest &&
+         !c.largest.compare_exchange_weak(largest, static_cast<uint32_t>(size),
+                                          std::memory_order_relaxed)) {
+  }
+}
+
+void heapNoteFree(size_t size) {
+  s_frees.fetch_add(1, std::memory_order_relaxed);
+  s_freedBytes.fetch_add(static_cast<uint32_t>(size), std::memory_order_relaxed);
+}
+
+HeapTagStats heapTagStats(HeapTag tag) {
+  HeapTagStats st = {};
+  uint8_t i = static_cast<uint8_t>(tag);
+  if (i >= HEAP_TAG_COUNT) return st;
+  st.allocs = s_tags[i].allocs.load(std::memory_order_relaxed);
+  st.bytes = s_tags[i].bytes.load(std::memory_order_relaxed);
+  st.failures = s_tags[i].failures.load(std::memory_order_relaxed);
+  st.largest = s_tags[i].largest.load(std::memory_order_relaxed);
+  return st;
+}
+
+HeapTotals heapTotals() {
+  HeapTotals t = {};
+  for (uint8_t i = 0; i < HEAP_TAG_COUNT; ++i) {
+    t.allocs += s_tags[i].allocs.load(std::memory_order_relaxed);
+    t.bytes += s_tags[i].bytes.load(std::memory_order_relaxed);
+  }
+  t.frees = s_frees.load(std::memory_order_relaxed);
+  t.freedBytes = s_freedBytes.load(std::memory_order_relaxed);
+  t.scopeMisses = s_scopeMisses.load(std::memory_order_relaxed);
+  return t;
+}
+
+const char* heapTagName(HeapTag tag) {
+  uint8_t i = static_cast<uint8_t>(tag);
+  return i < HEAP_TAG_COUNT ? kTagNames[i] : "none";
+}
+
+size_t heapInternalFree() {
+#ifndef PIO_UNIT_TESTING
+  return heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  return 0;
+#endif
+}
+
+size_t heapLargestFreeBlock() {
+#ifndef PIO_UNIT_TESTING
+  return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  return 0;
+#endif
+}
+
+uint8_t heapFragmentationPct(size_t freeBytes, size_t largestBlock) {
+  if (freeBytes == 0 || largestBlock >= freeBytes) return 0;
+  return static_cast<uint8_t>(100 - (static_cast<uint64_t>(largestBlock) * 100) / freeBytes);
+}
+
+#if HEAP_TRACKING
+HeapTagScope::HeapTagScope(HeapTag tag) {
+  uintptr_t me = currentTask();
+  slot_ = findSlot(me);
+  if (slot_ < 0 && me != 0) {
+    for (uint8_t i = 0; i < HEAP_TAG_TASKS && slot_ < 0; ++i) {
+      uintptr_t expected = 0;
+      if (s_slots[i].task.compare_exchange_strong(expected, me, std::memory_order_relaxed)) {
+        s_slots[i].tag.store(static_cast<uint8_t>(HeapTag::Other), std::memory_order_relaxed);
+        slot_ = static_cast<int8_t>(i);
+        claimed_ = true;
+      }
+    }
+  }
+  if (slot_ < 0) {
+    s_scopeMisses.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  previous_ = static_cast<HeapTag>(s_slots[slot_].tag.load(std::memory_order_relaxed));
+  s_slots[slot_].tag.store(static_cast<uint8_t>(tag), std::memory_order_relaxed);
+}
+
+HeapTagScope::~HeapTagScope() {
+  if (slot_ < 0) return;
+  s_slots[slot_].tag.store(static_cast<uint8_t>(previous_), std::memory_order_relaxed);
+  if (claimed_) s_slots[slot_].task.store(0, std::memory_order_relaxed);
+}
+#endif
+
+void HeapTagMeter::perSecond(unsigned long nowMs, float out[HEAP_TAG_COUNT]) {
+  unsigned long elapsed = nowMs - lastMs_;
+  for (uint8_t i = 0; i < HEAP_TAG_COUNT; ++i) {
+    uint32_t allocs = s_tags[i].allocs.load(std::memory_order_relaxed);
+    out[i] = elapsed > 0 ? (allocs - lastAllocs_[i]) * 1000.0f / elapsed : 0.0f;
+    lastAllocs_[i] = allocs;
+  }
+  lastMs_ = nowMs;
+}
+
+#if HEAP_TRACKING && !defined(PIO_UNIT_TESTING)
+// The allocator as the rest of the link sees it, with -Wl,--wrap=...
+extern "C" void* __real_malloc(size_t size);
+extern "C" void* __real_calloc(size_t n, size_t size);
+extern "C" void* __real_realloc(void* ptr, size_t size);
+extern "C" void __real_free(void* ptr);
+
+extern "C" void* __wrap_malloc(size_t size) {
+  void* p = __real_malloc(size);
+  heapNoteAlloc(size, p != nullptr);
+  return p;
+}
+
+extern "C" void* __wrap_calloc(size_t n, size_t size) {
+  void* p = __real_calloc(n, size);
+  heapNoteAlloc(n * size, p != nullptr);
+  return p;
+}
+
+extern "C" void __wrap_free(void* ptr) {
+  if (ptr) heapNoteFree(heap_caps_get_allocated_size(ptr));
+  __real_free(ptr);
+}
+
+void* heapTrackedRealloc(void* ptr, size_t size) {
+  size_t oldSize = ptr ? heap_caps_get_allocated_size(ptr) : 0;
+  void* p = __real_realloc(ptr, size);
+  if (ptr && size == 0) {
+    heapNoteFree(oldSize);
+  } else if (p) {
+    if (ptr) heapNoteFree(oldSize);
+    heapNoteAlloc(size, true);
+  } else {
+    heapNoteAlloc(size, false);  // the old block stays
+  }
+  return p;
+}
+#endif
+
+#ifdef PIO_UNIT_TESTING
+void test_heapSetTask(uintptr_t task) { s_testTask = task; }
+
+void test_heapReset() {
+  for (TagCounters& c : s_tags) {
+    c.allocs = 0;
+    c.bytes = 0;
+    c.failures = 0;
+    c.largest = 0;
+  }
+  for (TaskSlot& s : s_slots) {
+    s.task = 0;
+    s.tag = 0;
+  }
+  s_frees = 0;
+  s_freedBytes = 0;
+  s_scopeMisses = 0;
+  s_testTask = 1;
+}
+#endif
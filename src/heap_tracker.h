@@ -0,0 +1,130 @@
+#ifndef HEAP_TRACKER_H
+#define HEAP_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Opt-in allocation tracker. Enabling it takes the define and the wraps
+// together (see platformio.ini):
+//   -DHEAP_TRACKING=1 -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=free
+// realloc is wrapped on every build already (fixed_string.cpp).
+#ifndef HEAP_TRACKING
+#define HEAP_TRACKING 0
+#endif
+
+/*
+ * Who allocates, and how fragmented the internal heap is
+ *
+ * With HEAP_TRACKING, every malloc/calloc/realloc/free (and so every
+ * new/delete and String growth) is counted. An allocation is charged to the
+ * tag of the innermost HeapTagScope on the task that makes it, or to
+ * `other`. Pool blocks (mem_pool.h) are taken with heap_caps_malloc() and
+ * given back with heap_caps_free(), both past the wraps, so they are left
+ * out on both sides; the pools keep their own counters. Other direct
+ * heap_caps_* calls are missed the same way, so net bytes are an estimate.
+ *
+ * The largest free internal block is read on every build: TLS needs one
+ * contiguous block of ~16 KB for its record buffer, and free heap alone
+ * does not say whether one exists.
+ */
+
+/** Subsystems allocations are charged to. Names in heap_tracker.cpp, same order. */
+enum class HeapTag : uint8_t {
+  Other,      // no scope on this task
+  Web,        // route handlers
+  Mqtt,
+  Heartbeat,
+  Log,
+  Ota,        // firmware and UI updates, ArduinoOTA
+  Count
+};
+
+static const uint8_t HEAP_TAG_COUNT = static_cast<uint8_t>(HeapTag::Count);
+// Tasks that can be inside a scope at the same time; more fall back to `other`
+static const uint8_t HEAP_TAG_TASKS = 4;
+
+struct HeapTagStats {
+  uint32_t allocs;
+  uint32_t bytes;     // requested, since boot
+  uint32_t failures;  // allocations that returned null
+  uint32_t largest;   // largest single request
+};
+
+struct HeapTotals {
+  uint32_t allocs;
+  uint32_t bytes;
+  uint32_t frees;
+  uint32_t freedBytes;
+  uint32_t scopeMisses;  // scopes that found no free task slot
+};
+
+constexpr bool heapTrackingEnabled() { return HEAP_TRACKING != 0; }
+
+/** Charges one allocation to the calling task's tag. Safe from any task; never allocates. */
+void heapNoteAlloc(size_t size, bool ok);
+void heapNoteFree(size_t size);
+
+HeapTagStats heapTagStats(HeapTag tag);
+HeapTotals heapTotals();
+const char* heapTagName(HeapTag tag);
+/** The calling task's tag. */
+HeapTag heapCurrentTag();
+
+/** Free bytes and the largest free block of internal (non-PSRAM) RAM. */
+size_t heapInternalFree();
+size_t heapLargestFreeBlock();
+/** 0 when all free memory is one block, towards 100 as it splinters. */
+uint8_t heapFragmentationPct(size_t freeBytes, size_t largestBlock);
+
+/**
+ * @brief Charges the allocations of this scope's task to `tag`
+ *
+ * Scopes nest; the outer tag comes back when the inner scope ends. Other
+ * tasks are not affected. Compiles to nothing without HEAP_TRACKING.
+ */
+class HeapTagScope {
+public:
+#if HEAP_TRACKING
+  explicit HeapTagScope(HeapTag tag);
+  ~HeapTagScope();
+#else
+  explicit HeapTagScope(HeapTag) {}
+#endif
+  HeapTagScope(const HeapTagScope&) = delete;
+  HeapTagScope& operator=(const HeapTagScope&) = delete;
+
+private:
+#if HEAP_TRACKING
+  int8_t slot_ = -1;
+  bool claimed_ = false;  // took the slot, so gives it back
+  HeapTag previous_ = HeapTag::Other;
+#endif
+};
+
+/**
+ * @brief Allocations per second per tag between two reads
+ *
+ * Each reader keeps its own meter, as with ReallocMeter.
+ */
+class HeapTagMeter {
+public:
+  /** Fills `out` with each tag's allocations per second since the previous call. */
+  void perSecond(unsigned long nowMs, float out[HEAP_TAG_COUNT]);
+
+private:
+  uint32_t lastAllocs_[HEAP_TAG_COUNT] = {};
+  unsigned long lastMs_ = 0;
+};
+
+#if HEAP_TRACKING && !defined(PIO_UNIT_TESTING)
+/** realloc() with accounting; called by the realloc wrap in fixed_string.cpp. */
+void* heapTrackedRealloc(void* ptr, size_t size);
+#endif
+
+#ifdef PIO_UNIT_TESTING
+/** Makes the calling "task" `task` (any non-zero id). */
+void test_heapSetTask(uintptr_t task);
+void test_heapReset();
+#endif
+
+#endif // HEAP_TRACKER_H
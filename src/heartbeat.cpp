@@ -7,17 +7,25 @@
 #include <esp_system.h>
 #include <time.h>
 
+#include "boot_profile.h"
 #include "config.h"
 #include "device_identity.h"
 #include "device_registration.h"
 #include "display_settings.h"
+#include "fixed_string.h"
 #include "grid_layout.h"
+#include "heap_tracker.h"
+#include "json_arena.h"
 #include "language_settings.h"
 #include "led_state.h"
 #include "log.h"
+#include "loop_profile.h"
+#include "mem_pool.h"
 #include "night_mode.h"
+#include "retained_clock.h"
 #include "ota_updater.h"
 #include "secrets.h"
+#include "settings_store.h"
 
 // Retry interval after failure (5 minutes)
 #define HEARTBEAT_RETRY_INTERVAL_MS (5 * 60 * 1000UL)
@@ -177,13 +185,15 @@ bool sendHeartbeat() {
     return false;
   }
   
-  const String url = String(API_BASE_URL) + "/api/v1/devices/heartbeat";
+  FixedString<128> url;
+  url += API_BASE_URL;
+  url += "/api/v1/devices/heartbeat";
   
   WiFiClientSecure client;
   client.setInsecure();  // Skip certificate validation (same as registration)
   
   HTTPClient http;
-  if (!http.begin(client, url)) {
+  if (!http.begin(client, url.c_str())) {
     logWarn("💓 http.begin failed");
     return false;
   }
@@ -194,7 +204,8 @@ bool sendHeartbeat() {
   http.setTimeout(HEARTBEAT_READ_TIMEOUT_MS);
   
   // Build payload
-  JsonDocument req;
+  JSON_SCOPE(json, "heartbeat");
+  JsonDocument req(json.allocator());
   req["deviceId"] = deviceId;
   req["firmware"] = FIRMWARE_VERSION;
   req["ui"] = getUiVersion();
@@ -226,6 +237,91 @@ bool sendHeartbeat() {
   // Extended system diagnostics
   req["minFreeHeap"] = (long)ESP.getMinFreeHeap();
   req["heapSize"] = (long)ESP.getHeapSize();
+  // TLS needs one contiguous block; free heap alone hides fragmentation
+  size_t freeInternal = heapInternalFree();
+  size_t largestBlock = heapLargestFreeBlock();
+  req["largestFreeBlock"] = (long)largestBlock;
+  req["heapFragPct"] = heapFragmentationPct(freeInternal, largestBlock);
+  if (heapTrackingEnabled()) {
+    // Allocations per second per tag since the previous heartbeat
+    static HeapTagMeter heapMeter;
+    float perSec[HEAP_TAG_COUNT];
+    heapMeter.perSecond(millis(), perSec);
+    JsonObject heapTags = req["heapAllocsPerSec"].to<JsonObject>();
+    uint32_t failures = 0;
+    for (uint8_t i = 0; i < HEAP_TAG_COUNT; ++i) {
+      HeapTag tag = static_cast<HeapTag>(i);
+      heapTags[heapTagName(tag)] = perSec[i];
+      failures += heapTagStats(tag).failures;
+    }
+    req["heapAllocFailures"] = failures;
+  }
+  // Per-pool placement (mem_pool.h). Bulk fallbacks are large buffers that
+  // PSRAM could not take and that landed in internal SRAM instead.
+  JsonObject pools = req["pools"].to<JsonObject>();
+  for (MemPool pool : {MemPool::Hot, MemPool::Bulk}) {
+    MemPoolStats st = poolStats(pool);
+    JsonObject p = pools[poolName(pool)].to<JsonObject>();
+    p["peak"] = (long)st.highWater;
+    p["inUse"] = (long)st.inUse;
+    p["free"] = (long)st.freeBytes;
+    p["fallbacks"] = st.fallbacks;
+    p["failures"] = st.failures;
+  }
+  // realloc() rate since the previous heartbeat (String growth among
+  // others), next to minFreeHeap to see fragmentation pressure drop as hot
+  // paths move to FixedString
+  static ReallocMeter reallocMeter;
+  req["reallocsPerSec"] = reallocMeter.perSecond(millis());
+  req["fixedStringTruncations"] = fixedStringTruncations();
+  // NVS wear from settings (settings_store.h): commits and entry bytes in
+  // the current and previous 24 h window
+  SettingsStoreStats settings = settingsStore.stats(millis());
+  JsonObject nvs = req["settings"].to<JsonObject>();
+  nvs["commitsDay"] = settings.commitsDay;
+  nvs["bytesDay"] = settings.bytesDay;
+  nvs["commitsPrevDay"] = settings.commitsPrevDay;
+  nvs["bytesPrevDay"] = settings.bytesPrevDay;
+  nvs["failures"] = settings.failures;
+  // Boot latency (boot_profile.h) in ms since reset; a milestone not reached
+  // yet is left out. prevStuckIn names the step a boot reset during.
+  const BootTimeline& boot = bootTimeline();
+  JsonObject bootInfo = req["boot"].to<JsonObject>();
+  bootInfo["setupMs"] = boot.milestone(BootMilestone::SetupDone);
+  uint32_t firstFrameMs = boot.milestone(BootMilestone::FirstFrame);
+  uint32_t wifiMs = boot.milestone(BootMilestone::WifiConnected);
+  uint32_t ntpMs = boot.milestone(BootMilestone::TimeSynced);
+  if (firstFrameMs) bootInfo["firstFrameMs"] = firstFrameMs;
+  if (wifiMs) bootInfo["wifiMs"] = wifiMs;
+  if (ntpMs) bootInfo["ntpMs"] = ntpMs;
+  uint8_t slowest = bootSlowestPhase();
+  if (slowest < BOOT_PHASE_COUNT) {
+    bootInfo["slowest"] = bootPhaseName(slowest);
+    bootInfo["slowestMs"] = boot.durationUs[slowest] / 1000;
+  }
+  // "retained" until SNTP confirms a time carried over a warm restart
+  bootInfo["time"] = timeConfidenceName(timeConfidence());
+  if (previousBootIncomplete()) {
+    bootInfo["prevStuckIn"] = bootPhaseName(previousBootTimeline()->stuckPhase());
+  }
+  // loop() latency since boot (loop_profile.h) in us, per stage that ran;
+  // /api/perf/loop has the rest of the distribution
+  JsonObject loopInfo = req["loop"].to<JsonObject>();
+  auto addLoop = [&loopInfo](const char* name, const LatencyHistogram& h) {
+    if (h.count() == 0) return;
+    JsonObject o = loopInfo[name].to<JsonObject>();
+    o["p50"] = h.percentile(500);
+    o["p99"] = h.percentile(990);
+    o["max"] = h.maxUs();
+  };
+  for (uint8_t i = 0; i < LOOP_STAGE_COUNT; ++i) {
+    LoopStage stage = static_cast<LoopStage>(i);
+    addLoop(loopStageName(stage), loopStageHistogram(stage));
+  }
+  static const char* const kShowKeys[] = {"show0", "show1", "show2", "show3"};
+  static_assert(sizeof(kShowKeys) / sizeof(kShowKeys[0]) == LOOP_SHOW_SEGMENTS,
+                "a key per LED data line");
+  for (uint8_t s = 0; s < LOOP_SHOW_SEGMENTS; ++s) addLoop(kShowKeys[s], loopShowHistogram(s));
   req["cpuFreqMhz"] = ESP.getCpuFreqMHz();
   req["chipTemp"] = temperatureRead();
   // resetReason: esp_reset_reason_t as int. 0=UNKNOWN, 1=POWERON, 2=EXT, 3=SW, 4=PANIC,
@@ -239,16 +335,24 @@ bool sendHeartbeat() {
   // Drop the field once the heartbeat server tolerates its absence.
   req["setupComplete"] = true;
   
-  String payload;
-  serializeJson(req, payload);
+  size_t length = measureJson(req);
+  char* payload = json.buffer(length + 1);
+  if (!payload) {
+    logWarn("💓 No memory for the heartbeat payload");
+    http.end();
+    return false;
+  }
+  length = serializeJson(req, payload, length + 1);
   
-  logDebug("💓 Sending heartbeat to " + url);
+  logDebugf("💓 Sending heartbeat to %s", url.c_str());
   
-  int code = http.POST(payload);
+  int code = http.POST(reinterpret_cast<uint8_t*>(payload), length);
   s_lastHeartbeatHttpCode = (code > 0) ? code : 0;
   
   if (code <= 0) {
-    logWarn("💓 HTTP error: " + http.errorToString(code));
+    // A failed TLS handshake is often no contiguous block for its buffers
+    logWarnf("💓 HTTP error: %s (largest free block %u)", http.errorToString(code).c_str(),
+             (unsigned)heapLargestFreeBlock());
     http.end();
     return false;
   }
@@ -257,7 +361,7 @@ bool sendHeartbeat() {
   http.end();
   
   if (code < 200 || code >= 300) {
-    logWarn("💓 Heartbeat failed: HTTP " + String(code) + " - " + body);
+    logWarnf("💓 Heartbeat failed: HTTP %d - %s", code, body.c_str());
     return false;
   }
   
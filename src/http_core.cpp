@@ -0,0 +1,642 @@
+#include "http_core.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+#else
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+unsigned long nowMs() {
+#if defined(ESP_PLATFORM)
+  return (unsigned long)(esp_timer_get_time() / 1000);
+#else
+  using namespace std::chrono;
+  return (unsigned long)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, (flags < 0 ? 0 : flags) | O_NONBLOCK);
+}
+
+bool wouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+// Statuses whose responses never carry a body (RFC 9110 §6.4.1)
+bool statusHasNoBody(int status) {
+  return status < 200 || status == 204 || status == 304;
+}
+
+}  // namespace
+
+// --- HttpResponse ------------------------------------------------------------
+
+void HttpResponse::addHeader(const std::string& name, const std::string& value) {
+  headers_.emplace_back(name, value);
+}
+
+void HttpResponse::writeHead(int status, const char* contentType, long length, bool chunked) {
+  std::string& out = core_->conns_[slot_].out;
+  noBody_ = statusHasNoBody(status);
+  char line[64];
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", status, httpReasonPhrase(status));
+  out += line;
+  if (contentType && *contentType && !noBody_) {
+    out += "Content-Type: ";
+    out += contentType;
+    out += "\r\n";
+  }
+  if (!noBody_) {
+    if (chunked) {
+      out += "Transfer-Encoding: chunked\r\n";
+    } else if (length >= 0) {
+      snprintf(line, sizeof(line), "Content-Length: %ld\r\n", length);
+      out += line;
+    }
+  }
+  for (const auto& h : headers_) {
+    out += h.first;
+    out += ": ";
+    out += h.second;
+    out += "\r\n";
+  }
+  // Without a length or chunking, only closing the connection ends the body
+  bool keep = keepAlive_ && (noBody_ || chunked || length >= 0);
+  out += keep ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+  core_->conns_[slot_].closeAfter = !keep;
+  started_ = true;
+}
+
+void HttpResponse::send(int status, const char* contentType, const char* data, size_t length) {
+  if (started_ || detached_) return;
+  writeHead(status, contentType, (long)length, false);
+  if (!headOnly_ && !noBody_) core_->conns_[slot_].out.append(data, length);
+  flush();
+}
+
+// Written as far as the socket takes it right away, as WebServer did: a
+// handler that answers and then restarts the device still gets its answer out.
+void HttpResponse::flush() {
+  if (core_->conns_[slot_].fd >= 0) core_->writePending(slot_, nowMs());
+}
+
+void HttpResponse::sendStatic(int status, const char* contentType, const uint8_t* data, size_t length) {
+  if (started_ || detached_) return;
+  writeHead(status, contentType, (long)length, false);
+  if (headOnly_ || noBody_) return;
+  HttpServerCore::Connection& c = core_->conns_[slot_];
+  c.staticBody = data;
+  c.staticLength = length;
+  flush();
+}
+
+void HttpResponse::sendSource(int status, const char* contentType, std::unique_ptr<HttpBodySource> source,
+                              long length) {
+  if (started_ || detached_) return;
+  bool chunked = length < 0 && !http10_;
+  writeHead(status, contentType, length, chunked);
+  if (headOnly_ || noBody_) return;
+  HttpServerCore::Connection& c = core_->conns_[slot_];
+  c.source = std::move(source);
+  c.sourceChunked = chunked;
+  flush();
+}
+
+void HttpResponse::beginChunked(int status, const char* contentType) {
+  if (started_ || detached_) return;
+  chunked_ = !http10_;
+  writeHead(status, contentType, -1, chunked_);
+  flush();
+}
+
+bool HttpResponse::writeChunk(const char* data, size_t length) {
+  if (!started_ || detached_ || ended_ || failed_) return false;
+  if (headOnly_ || noBody_ || length == 0) return true;
+  HttpServerCore::Connection& c = core_->conns_[slot_];
+  if (chunked_) {
+    char size[2 * sizeof(unsigned long) + 3];  // hex digits, CRLF, NUL
+    snprintf(size, sizeof(size), "%lx\r\n", (unsigned long)length);
+    c.out += size;
+    c.out.append(data, length);
+    c.out += "\r\n";
+  } else {
+    c.out.append(data, length);
+  }
+  // Whatever the socket takes now; the rest drains from poll() once the
+  // handler has returned. A client that far behind is not waited for.
+  if (c.fd < 0 || core_->writePending(slot_, nowMs()) < 0 || c.out.size() - c.outAt > HTTP_CORE_CHUNK_QUEUE) {
+    failed_ = true;
+  }
+  return !failed_;
+}
+
+void HttpResponse::endChunked() {
+  if (!started_ || detached_ || ended_) return;
+  ended_ = true;
+  if (chunked_ && !headOnly_ && !noBody_) core_->conns_[slot_].out += "0\r\n\r\n";
+  flush();
+}
+
+int HttpResponse::detach() {
+  if (started_ || detached_) return -1;
+  detached_ = true;
+  HttpServerCore::Connection& c = core_->conns_[slot_];
+  int fd = c.fd;
+  c.fd = -1;
+  return fd;
+}
+
+// --- HttpServerCore ----------------------------------------------------------
+
+HttpServerCore::HttpServerCore() {}
+
+HttpServerCore::~HttpServerCore() {
+  end();
+}
+
+bool HttpServerCore::begin(uint16_t port, bool loopbackOnly) {
+  end();
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, HTTP_CORE_MAX_CONNECTIONS) != 0) {
+    close(fd);
+    return false;
+  }
+  setNonBlocking(fd);
+
+  socklen_t len = sizeof(addr);
+  if (getsockname(fd, (sockaddr*)&addr, &len) == 0) {
+    port_ = ntohs(addr.sin_port);
+  } else {
+    port_ = port;
+  }
+  listenFd_ = fd;
+  return true;
+}
+
+void HttpServerCore::end() {
+  for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS; ++i) {
+    if (conns_[i].phase != Phase::Free) closeConnection(i);
+  }
+  if (listenFd_ >= 0) close(listenFd_);
+  listenFd_ = -1;
+  port_ = 0;
+}
+
+void HttpServerCore::on(const char* path, uint16_t methods, HttpHandler handler, HttpUploadHandler upload) {
+  routes_.push_back(Route{path, methods, std::move(handler), std::move(upload)});
+}
+
+size_t HttpServerCore::connectionCount() const {
+  size_t n = 0;
+  for (const Connection& c : conns_) {
+    if (c.phase != Phase::Free) n++;
+  }
+  return n;
+}
+
+const HttpServerCore::Route* HttpServerCore::findRoute(const std::string& path, HttpMethod method) const {
+  uint16_t bit = httpMethodBit(method);
+  for (const Route& route : routes_) {
+    if ((route.methods & bit) && route.path == path) return &route;
+  }
+  return nullptr;
+}
+
+void HttpServerCore::poll(unsigned timeoutMs) {
+  if (listenFd_ < 0) return;
+
+  fd_set readable;
+  fd_set writable;
+  FD_ZERO(&readable);
+  FD_ZERO(&writable);
+  int maxFd = -1;
+
+  // Only listen while a slot is free or an idle connection can make room;
+  // otherwise new clients wait in the backlog rather than being refused
+  bool room = false;
+  for (const Connection& c : conns_) {
+    if (c.phase == Phase::Free || evictable(c)) room = true;
+  }
+  if (room) {
+    FD_SET(listenFd_, &readable);
+    maxFd = listenFd_;
+  }
+  for (const Connection& c : conns_) {
+    if (c.phase == Phase::Free) continue;
+    FD_SET(c.fd, c.phase == Phase::Writing ? &writable : &readable);
+    if (c.fd > maxFd) maxFd = c.fd;
+  }
+
+  timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+  int ready = select(maxFd + 1, &readable, &writable, nullptr, &tv);
+  unsigned long now = nowMs();
+
+  if (ready > 0) {
+    for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS; ++i) {
+      Connection& c = conns_[i];
+      if (c.phase == Phase::Free) continue;
+      if (c.phase == Phase::Writing) {
+        if (!FD_ISSET(c.fd, &writable)) continue;
+        int w = writePending(i, now);
+        if (w < 0) {
+          closeConnection(i);
+        } else if (w > 0 && completeResponse(i, now)) {
+          process(i, now);
+        }
+      } else if (FD_ISSET(c.fd, &readable)) {
+        readFrom(i, now);
+      }
+    }
+    // After the reads, so a slot freed by a peer's close is reused first
+    if (room && FD_ISSET(listenFd_, &readable)) acceptClients(now);
+  }
+
+  for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS; ++i) {
+    Connection& c = conns_[i];
+    switch (c.phase) {
+      case Phase::Idle:
+        if (c.in.empty() && now - c.progressMs > HTTP_CORE_IDLE_MS) closeConnection(i);
+        break;
+      case Phase::Head:
+      case Phase::Body:
+        if (now - c.startedMs > HTTP_CORE_REQUEST_MS) {
+          stats_.timeouts++;
+          reject(i, 408, "Request timeout");
+        }
+        break;
+      case Phase::Writing:
+        if (now - c.progressMs > HTTP_CORE_STALL_MS) {
+          stats_.timeouts++;
+          closeConnection(i);
+        }
+        break;
+      case Phase::Free:
+        break;
+    }
+  }
+}
+
+// Kept alive between requests. A client that has connected but not sent
+// its first request yet is not evicted: it is about to.
+bool HttpServerCore::evictable(const Connection& c) {
+  return c.phase == Phase::Idle && c.in.empty() && c.served > 0;
+}
+
+void HttpServerCore::acceptClients(unsigned long now) {
+  while (true) {
+    int slot = -1;
+    for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS && slot < 0; ++i) {
+      if (conns_[i].phase == Phase::Free) slot = i;
+    }
+    if (slot < 0) {
+      // Pool full: the connection idle the longest makes room
+      unsigned long idlest = 0;
+      for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS; ++i) {
+        const Connection& c = conns_[i];
+        if (!evictable(c)) continue;
+        if (slot < 0 || now - c.progressMs > idlest) {
+          slot = i;
+          idlest = now - c.progressMs;
+        }
+      }
+      if (slot < 0) return;  // the rest wait in the backlog
+    }
+
+    int fd = accept(listenFd_, nullptr, nullptr);
+    if (fd < 0) return;
+    if (conns_[slot].phase != Phase::Free) {
+      closeConnection(slot);
+      stats_.evicted++;
+    }
+
+    setNonBlocking(fd);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    Connection& c = conns_[slot];
+    c.fd = fd;
+    c.phase = Phase::Idle;
+    c.startedMs = now;
+    c.progressMs = now;
+    stats_.accepted++;
+  }
+}
+
+void HttpServerCore::readFrom(int slot, unsigned long now) {
+  Connection& c = conns_[slot];
+  char buf[1460];
+  // A few segments per wakeup keeps uploads moving without starving the rest
+  for (int round = 0; round < 4; ++round) {
+    ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && !wouldBlock())) {
+      closeConnection(slot);
+      return;
+    }
+    if (n < 0) return;
+    c.progressMs = now;
+    c.in.append(buf, (size_t)n);
+    process(slot, now);
+    if (c.phase == Phase::Free || c.phase == Phase::Writing || (size_t)n < sizeof(buf)) return;
+  }
+}
+
+void HttpServerCore::process(int slot, unsigned long now) {
+  Connection& c = conns_[slot];
+  while (true) {
+    if (c.phase == Phase::Idle) {
+      if (c.in.empty()) return;
+      c.phase = Phase::Head;
+      c.startedMs = now;
+    }
+
+    if (c.phase == Phase::Head) {
+      size_t headLength = 0;
+      int errorStatus = 400;
+      HttpHeadStatus status = parseHttpHead(c.in.data(), c.in.size(), c.request, headLength, errorStatus);
+      if (status == HttpHeadStatus::NeedMore) return;
+      if (status == HttpHeadStatus::Error) {
+        reject(slot, errorStatus, httpReasonPhrase(errorStatus));
+        return;
+      }
+      c.in.erase(0, headLength);
+      if (!startBody(slot)) return;
+    }
+
+    if (c.phase != Phase::Body) return;
+    size_t n = c.bodyRemaining < c.in.size() ? c.bodyRemaining : c.in.size();
+    if (n > 0) {
+      bool ok = feedBody(slot, c.in.data(), n);
+      if (!ok) return;
+      c.in.erase(0, n);
+      c.bodyRemaining -= n;
+    }
+    if (c.bodyRemaining > 0) return;
+    if (c.streaming && !c.multipart.finished()) {
+      reject(slot, 400, "Truncated multipart body");
+      return;
+    }
+
+    dispatch(slot);
+    if (c.phase == Phase::Free) return;  // detached
+    int w = writePending(slot, now);
+    if (w < 0) {
+      closeConnection(slot);
+      return;
+    }
+    if (w == 0 || !completeResponse(slot, now)) return;
+    // Loop for a pipelined request already in `in`
+  }
+}
+
+bool HttpServerCore::startBody(int slot) {
+  Connection& c = conns_[slot];
+  HttpRequest& r = c.request;
+  if (r.chunkedBody) {
+    reject(slot, 501, "Chunked request bodies are not supported");
+    return false;
+  }
+  c.route = findRoute(r.path, r.method);
+  c.bodyRemaining = r.contentLength;
+  c.streaming = false;
+  c.partBytes = 0;
+  c.uploadOpen = false;
+
+  if (c.route && c.route->upload && r.contentLength > 0 && r.mediaType() == "multipart/form-data") {
+    if (!c.multipart.begin(*r.header("Content-Type"), onMultipart, this)) {
+      reject(slot, 400, "Missing multipart boundary");
+      return false;
+    }
+    c.streaming = true;
+  } else if (r.contentLength > HTTP_MAX_BODY_BYTES) {
+    reject(slot, 413, "Request body too large");
+    return false;
+  } else {
+    r.body.reserve(r.contentLength);
+  }
+
+  // Only once the request is known to be acceptable, and only when the
+  // client is still waiting for it
+  if (r.expectContinue && !r.http10 && r.contentLength > c.in.size()) {
+    static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+    ::send(c.fd, kContinue, sizeof(kContinue) - 1, MSG_NOSIGNAL);
+  }
+  c.phase = Phase::Body;
+  return true;
+}
+
+bool HttpServerCore::feedBody(int slot, const char* data, size_t length) {
+  Connection& c = conns_[slot];
+  if (!c.streaming) {
+    c.request.body.append(data, length);
+    return true;
+  }
+  feedingSlot_ = slot;
+  bool ok = c.multipart.feed(data, length);
+  feedingSlot_ = -1;
+  if (!ok) reject(slot, 400, "Malformed multipart body");
+  return ok;
+}
+
+void HttpServerCore::onMultipart(void* ctx, MultipartParser::Event event, const MultipartPart& part,
+                                 const char* data, size_t length) {
+  HttpServerCore* self = static_cast<HttpServerCore*>(ctx);
+  Connection& c = self->conns_[self->feedingSlot_];
+  HttpRequest& r = c.request;
+
+  if (part.filename.empty()) {
+    // Ordinary form field: becomes an argument, as with urlencoded forms
+    if (event == MultipartParser::Event::PartBegin) {
+      r.args.emplace_back(part.name, std::string());
+    } else if (event == MultipartParser::Event::PartData && r.args.back().second.size() < HTTP_MAX_BODY_BYTES) {
+      r.args.back().second.append(data, length);
+    }
+    return;
+  }
+
+  HttpUploadEvent ev{HttpUploadEvent::Phase::Data, &part, reinterpret_cast<const uint8_t*>(data), length, 0};
+  switch (event) {
+    case MultipartParser::Event::PartBegin:
+      c.partBytes = 0;
+      c.uploadOpen = true;
+      ev.phase = HttpUploadEvent::Phase::Start;
+      ev.length = 0;
+      break;
+    case MultipartParser::Event::PartData:
+      c.partBytes += length;
+      break;
+    case MultipartParser::Event::PartEnd:
+      c.uploadOpen = false;
+      ev.phase = HttpUploadEvent::Phase::End;
+      ev.length = 0;
+      break;
+  }
+  ev.total = c.partBytes;
+  c.route->upload(r, ev);
+}
+
+void HttpServerCore::dispatch(int slot) {
+  Connection& c = conns_[slot];
+  HttpRequest& r = c.request;
+  if (!c.streaming) finishHttpBody(r);
+
+  c.served++;
+  if (c.served > 1) stats_.reused++;
+  stats_.requests++;
+
+  HttpResponse res;
+  res.core_ = this;
+  res.slot_ = slot;
+  res.headOnly_ = r.method == HttpMethod::Head;
+  res.http10_ = r.http10;
+  res.keepAlive_ = r.keepAlive && c.served < HTTP_CORE_MAX_KEEPALIVE_REQUESTS;
+
+  if (c.route) {
+    c.route->handler(r, res);
+  } else if (notFound_) {
+    notFound_(r, res);
+  } else {
+    res.send(404, "text/plain", "Not found: " + r.path);
+  }
+
+  if (res.detached_) {
+    // The handler owns the socket now: forget it without closing
+    stats_.detached++;
+    c = Connection();
+    return;
+  }
+  if (!res.started_) {
+    res.send(500, "text/plain", "Handler sent no response");
+  } else if (res.chunked_ && !res.ended_) {
+    res.endChunked();
+  }
+  if (res.failed_) c.closeAfter = true;
+  c.phase = Phase::Writing;
+}
+
+void HttpServerCore::reject(int slot, int status, const char* message) {
+  Connection& c = conns_[slot];
+  abortUpload(slot);
+  c.out.clear();
+  c.outAt = 0;
+  c.staticLength = 0;
+  c.source.reset();
+
+  HttpResponse res;
+  res.core_ = this;
+  res.slot_ = slot;
+  res.keepAlive_ = false;
+  std::string body(message);
+  body += "\n";
+  res.send(status, "text/plain", body);
+  stats_.rejected++;
+
+  // Whatever else the client sent is not going to be read
+  c.in.clear();
+  c.phase = Phase::Writing;
+  if (writePending(slot, nowMs()) != 0) closeConnection(slot);
+}
+
+int HttpServerCore::writePending(int slot, unsigned long now) {
+  Connection& c = conns_[slot];
+  while (true) {
+    if (c.outAt < c.out.size()) {
+      ssize_t n = ::send(c.fd, c.out.data() + c.outAt, c.out.size() - c.outAt, MSG_NOSIGNAL);
+      if (n < 0) return wouldBlock() ? 0 : -1;
+      c.outAt += (size_t)n;
+      c.progressMs = now;
+      if (c.outAt < c.out.size()) return 0;
+      c.out.clear();
+      c.outAt = 0;
+      continue;
+    }
+    if (c.staticLength > 0) {
+      ssize_t n = ::send(c.fd, c.staticBody, c.staticLength, MSG_NOSIGNAL);
+      if (n < 0) return wouldBlock() ? 0 : -1;
+      c.staticBody += n;
+      c.staticLength -= (size_t)n;
+      c.progressMs = now;
+      if (c.staticLength > 0) return 0;
+      continue;
+    }
+    if (c.source) {
+      // Refill from the source one segment at a time
+      uint8_t buf[1024];
+      long n = c.source->read(buf, sizeof(buf));
+      if (n < 0) return -1;  // the head is out, so there is no way to report it
+      if (n == 0) {
+        if (c.sourceChunked) c.out = "0\r\n\r\n";
+        c.source.reset();
+        continue;
+      }
+      if (c.sourceChunked) {
+        char size[2 * sizeof(unsigned long) + 3];
+        snprintf(size, sizeof(size), "%lx\r\n", (unsigned long)n);
+        c.out += size;
+        c.out.append(reinterpret_cast<const char*>(buf), (size_t)n);
+        c.out += "\r\n";
+      } else {
+        c.out.append(reinterpret_cast<const char*>(buf), (size_t)n);
+      }
+      continue;
+    }
+    return 1;
+  }
+}
+
+bool HttpServerCore::completeResponse(int slot, unsigned long now) {
+  Connection& c = conns_[slot];
+  if (c.closeAfter) {
+    closeConnection(slot);
+    return false;
+  }
+  c.phase = Phase::Idle;
+  c.route = nullptr;
+  c.streaming = false;
+  c.progressMs = now;
+  return true;
+}
+
+void HttpServerCore::abortUpload(int slot) {
+  Connection& c = conns_[slot];
+  if (!c.uploadOpen || !c.route || !c.route->upload) return;
+  c.uploadOpen = false;
+  HttpUploadEvent ev{HttpUploadEvent::Phase::Aborted, &c.multipart.part(), nullptr, 0, c.partBytes};
+  c.route->upload(c.request, ev);
+}
+
+void HttpServerCore::closeConnection(int slot) {
+  Connection& c = conns_[slot];
+  abortUpload(slot);
+  if (c.fd >= 0) close(c.fd);
+  c = Connection();
+}
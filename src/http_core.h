@@ -0,0 +1,239 @@
+#ifndef HTTP_CORE_H
+#define HTTP_CORE_H
+
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "http_request.h"
+
+// Connections served at once. When all are taken, the longest-idle
+// keep-alive connection is closed to make room; if none is idle, new
+// clients wait in the listen backlog.
+#ifndef HTTP_CORE_MAX_CONNECTIONS
+#define HTTP_CORE_MAX_CONNECTIONS 6
+#endif
+// An idle keep-alive connection is closed after this long.
+#ifndef HTTP_CORE_IDLE_MS
+#define HTTP_CORE_IDLE_MS 5000
+#endif
+// A request must arrive in full within this long of its first byte (408).
+#ifndef HTTP_CORE_REQUEST_MS
+#define HTTP_CORE_REQUEST_MS 10000
+#endif
+// A response that has not moved for this long is abandoned.
+#ifndef HTTP_CORE_STALL_MS
+#define HTTP_CORE_STALL_MS 15000
+#endif
+// Bytes writeChunk() holds for a client that is not keeping up. Handlers
+// never wait for the socket, so past this the response is abandoned; a body
+// that can be larger belongs in an HttpBodySource.
+#ifndef HTTP_CORE_CHUNK_QUEUE
+#define HTTP_CORE_CHUNK_QUEUE 16384
+#endif
+// Requests per connection before the server asks the client to reconnect.
+#ifndef HTTP_CORE_MAX_KEEPALIVE_REQUESTS
+#define HTTP_CORE_MAX_KEEPALIVE_REQUESTS 100
+#endif
+
+/** Response body produced while the socket drains (files, decompression). */
+class HttpBodySource {
+public:
+  virtual ~HttpBodySource() = default;
+  /** Fill up to `length` bytes: count written, 0 at the end, -1 on error. */
+  virtual long read(uint8_t* buffer, size_t length) = 0;
+};
+
+/** Streamed multipart upload, delivered to a route's upload handler. */
+struct HttpUploadEvent {
+  enum class Phase : uint8_t { Start, Data, End, Aborted };
+  Phase phase;
+  const MultipartPart* part;
+  const uint8_t* data;  // Data only
+  size_t length;
+  size_t total;         // bytes of this part so far
+};
+
+class HttpServerCore;
+
+/**
+ * @brief The answer to one request, bound to its connection
+ *
+ * Exactly one of the send*() calls (or beginChunked() ... endChunked(), or
+ * detach()) is used per request. The head and as much of the body as the
+ * socket takes are written right away; the rest drains from the server's
+ * poll loop, so a slow client holds only its own connection.
+ */
+class HttpResponse {
+public:
+  void addHeader(const std::string& name, const std::string& value);
+
+  /** Body copied from `data`. */
+  void send(int status, const char* contentType, const char* data, size_t length);
+  void send(int status, const char* contentType, const std::string& body) {
+    send(status, contentType, body.data(), body.size());
+  }
+
+  /** Body that outlives the response (flash, literals): sent without a copy. */
+  void sendStatic(int status, const char* contentType, const uint8_t* data, size_t length);
+
+  /** Body pulled from `source` as the socket drains; length < 0 when unknown (chunked). */
+  void sendSource(int status, const char* contentType, std::unique_ptr<HttpBodySource> source, long length);
+
+  /**
+   * Body written piecewise by the handler, chunked. writeChunk() never
+   * waits: what the socket does not take is queued, up to
+   * HTTP_CORE_CHUNK_QUEUE bytes.
+   * @return false once the client is gone or that much is queued
+   */
+  void beginChunked(int status, const char* contentType);
+  bool writeChunk(const char* data, size_t length);
+  void endChunked();
+
+  /**
+   * Take the socket over (event streams, parked long-polls): the server
+   * forgets it without closing it and sends nothing more.
+   * @return the socket, or -1 if part of a response was already sent
+   */
+  int detach();
+
+  bool started() const { return started_; }
+  bool detached() const { return detached_; }
+
+private:
+  friend class HttpServerCore;
+
+  void writeHead(int status, const char* contentType, long length, bool chunked);
+  void flush();
+
+  HttpServerCore* core_ = nullptr;
+  int slot_ = -1;
+  std::vector<std::pair<std::string, std::string>> headers_;
+  bool headOnly_ = false;   // HEAD request
+  bool http10_ = false;     // no chunked encoding: the body ends at close
+  bool keepAlive_ = true;
+  bool noBody_ = false;     // 1xx, 204, 304
+  bool started_ = false;
+  bool chunked_ = false;    // beginChunked() used
+  bool ended_ = false;      // endChunked() done
+  bool failed_ = false;     // client gone or too far behind writeChunk()
+  bool detached_ = false;
+};
+
+using HttpHandler = std::function<void(HttpRequest&, HttpResponse&)>;
+using HttpUploadHandler = std::function<void(HttpRequest&, const HttpUploadEvent&)>;
+
+/**
+ * @brief Event-driven HTTP/1.1 server over non-blocking BSD sockets
+ *
+ * One poll() call waits in select() for any listener or connection to be
+ * ready, then reads what arrived, runs the handler of every request that
+ * is now complete, and writes what the sockets take. Handlers run on the
+ * thread that calls poll(); the network I/O never waits for a slow client.
+ *
+ * Fixed pool of HTTP_CORE_MAX_CONNECTIONS with keep-alive and pipelining,
+ * head and body size limits (431 / 413), a request timeout (408) and
+ * streamed multipart uploads. Compiles against lwIP on the device and the
+ * host's sockets natively, so routes can be load-tested off-target.
+ */
+class HttpServerCore {
+public:
+  struct Stats {
+    uint32_t accepted = 0;
+    uint32_t requests = 0;     // handlers run
+    uint32_t reused = 0;       // requests on an already-used connection
+    uint32_t rejected = 0;     // answered with 4xx/5xx by the core itself
+    uint32_t timeouts = 0;     // requests or responses that stalled
+    uint32_t evicted = 0;      // idle connections closed to make room
+    uint32_t detached = 0;
+  };
+
+  HttpServerCore();
+  ~HttpServerCore();
+  HttpServerCore(const HttpServerCore&) = delete;
+  HttpServerCore& operator=(const HttpServerCore&) = delete;
+
+  /**
+   * @brief Start listening
+   * @param port 0 picks a free port (see port())
+   * @param loopbackOnly bind 127.0.0.1 instead of every interface
+   */
+  bool begin(uint16_t port, bool loopbackOnly = false);
+  void end();
+  uint16_t port() const { return port_; }
+
+  /** Route `path` (exact match) for the methods in `methods` (httpMethodBit()s). */
+  void on(const char* path, uint16_t methods, HttpHandler handler, HttpUploadHandler upload = nullptr);
+  void onNotFound(HttpHandler handler) { notFound_ = std::move(handler); }
+
+  /** Wait up to `timeoutMs` for activity, then serve whatever is ready. */
+  void poll(unsigned timeoutMs);
+
+  Stats stats() const { return stats_; }
+  size_t connectionCount() const;
+
+private:
+  friend class HttpResponse;
+
+  enum class Phase : uint8_t { Free, Idle, Head, Body, Writing };
+
+  struct Route {
+    std::string path;
+    uint16_t methods;
+    HttpHandler handler;
+    HttpUploadHandler upload;
+  };
+
+  struct Connection {
+    int fd = -1;
+    Phase phase = Phase::Free;
+    std::string in;
+    HttpRequest request;
+    const Route* route = nullptr;
+    size_t bodyRemaining = 0;
+    bool streaming = false;  // multipart body goes to the upload handler
+    MultipartParser multipart;
+    size_t partBytes = 0;
+    bool uploadOpen = false;
+    // Pending output, in order: out[outAt..], then staticBody, then source
+    std::string out;
+    size_t outAt = 0;
+    const uint8_t* staticBody = nullptr;
+    size_t staticLength = 0;
+    std::unique_ptr<HttpBodySource> source;
+    bool sourceChunked = false;
+    bool closeAfter = false;
+    unsigned long startedMs = 0;    // first byte of the current request
+    unsigned long progressMs = 0;   // last byte moved either way
+    uint32_t served = 0;
+  };
+
+  static bool evictable(const Connection& c);
+  void acceptClients(unsigned long now);
+  void readFrom(int slot, unsigned long now);
+  void process(int slot, unsigned long now);
+  bool startBody(int slot);
+  bool feedBody(int slot, const char* data, size_t length);
+  void dispatch(int slot);
+  void reject(int slot, int status, const char* message);
+  int writePending(int slot, unsigned long now);
+  bool completeResponse(int slot, unsigned long now);
+  void abortUpload(int slot);
+  void closeConnection(int slot);
+  const Route* findRoute(const std::string& path, HttpMethod method) const;
+  static void onMultipart(void* ctx, MultipartParser::Event event, const MultipartPart& part,
+                          const char* data, size_t length);
+
+  int listenFd_ = -1;
+  uint16_t port_ = 0;
+  std::vector<Route> routes_;
+  HttpHandler notFound_;
+  Connection conns_[HTTP_CORE_MAX_CONNECTIONS];
+  Stats stats_;
+  int feedingSlot_ = -1;  // slot whose multipart body is being parsed
+};
+
+#endif // HTTP_CORE_H
@@ -0,0 +1,135 @@
+#include "http_encoding.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace {
+
+bool tokenEquals(const char* token, size_t length, const char* name) {
+  size_t n = strlen(name);
+  if (length != n) return false;
+  for (size_t i = 0; i < n; ++i) {
+    if (tolower((unsigned char)token[i]) != name[i]) return false;
+  }
+  return true;
+}
+
+// "q=0.8" parameters -> 0..1000; anything malformed counts as 1
+uint16_t parseQuality(const char* p, const char* end) {
+  while (p < end) {
+    while (p < end && (*p == ';' || *p == ' ' || *p == '\t')) p++;
+    const char* name = p;
+    while (p < end && *p != '=' && *p != ';') p++;
+    bool isQ = (p - name == 1) && (name[0] == 'q' || name[0] == 'Q');
+    if (p >= end || *p != '=') continue;
+    p++;
+    if (!isQ) {
+      while (p < end && *p != ';') p++;
+      continue;
+    }
+    if (p < end && *p == '1') return 1000;
+    if (p >= end || *p != '0') return 1000;
+    p++;
+    uint16_t q = 0;
+    if (p < end && *p == '.') {
+      p++;
+      uint16_t scale = 100;
+      while (p < end && isdigit((unsigned char)*p) && scale > 0) {
+        q += (uint16_t)(*p - '0') * scale;
+        scale /= 10;
+        p++;
+      }
+    }
+    return q;
+  }
+  return 1000;
+}
+
+}  // namespace
+
+const char* contentCodingName(ContentCoding coding) {
+  switch (coding) {
+    case ContentCoding::Gzip:   return "gzip";
+    case ContentCoding::Brotli: return "br";
+    case ContentCoding::Identity:
+    default:                    return "identity";
+  }
+}
+
+const char* contentCodingSuffix(ContentCoding coding) {
+  switch (coding) {
+    case ContentCoding::Gzip:   return ".gz";
+    case ContentCoding::Brotli: return ".br";
+    case ContentCoding::Identity:
+    default:                    return "";
+  }
+}
+
+uint16_t acceptEncodingQuality(const char* header, ContentCoding coding) {
+  if (!header || !*header) return coding == ContentCoding::Identity ? 1000 : 0;
+  const char* name = contentCodingName(coding);
+  int exact = -1;
+  int star = -1;
+  const char* p = header;
+  while (*p) {
+    while (*p == ',' || *p == ' ' || *p == '\t') p++;
+    if (!*p) break;
+    const char* end = p;
+    while (*end && *end != ',') end++;
+    const char* tokenEnd = p;
+    while (tokenEnd < end && *tokenEnd != ';' && *tokenEnd != ' ' && *tokenEnd != '\t') tokenEnd++;
+    size_t len = (size_t)(tokenEnd - p);
+    uint16_t q = parseQuality(tokenEnd, end);
+    if (tokenEquals(p, len, name) ||
+        (coding == ContentCoding::Gzip && tokenEquals(p, len, "x-gzip"))) {
+      exact = q;
+    } else if (len == 1 && *p == '*') {
+      star = q;
+    }
+    p = end;
+  }
+  if (exact >= 0) return (uint16_t)exact;
+  if (star >= 0) return (uint16_t)star;
+  return coding == ContentCoding::Identity ? 1000 : 0;
+}
+
+size_t rankContentCodings(const char* acceptEncoding, ContentCoding out[3]) {
+  // Preference on equal quality: smallest first
+  static const ContentCoding kBySize[3] = {ContentCoding::Brotli, ContentCoding::Gzip,
+                                           ContentCoding::Identity};
+  uint16_t q[3];
+  size_t n = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    uint16_t qi = acceptEncodingQuality(acceptEncoding, kBySize[i]);
+    if (qi == 0) continue;
+    // Insertion sort, stable so equal qualities keep size order
+    size_t at = n;
+    while (at > 0 && q[at - 1] < qi) {
+      q[at] = q[at - 1];
+      out[at] = out[at - 1];
+      at--;
+    }
+    q[at] = qi;
+    out[at] = kBySize[i];
+    n++;
+  }
+  return n;
+}
+
+size_t gzipHeaderLength(const uint8_t* data, size_t length) {
+  if (length < 10 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8) return 0;
+  uint8_t flags = data[3];
+  size_t at = 10;
+  if (flags & 0x04) {  // FEXTRA
+    if (at + 2 > length) return 0;
+    at += 2 + (data[at] | (data[at + 1] << 8));
+  }
+  const uint8_t zeroTerminated[2] = {0x08, 0x10};  // FNAME, FCOMMENT
+  for (uint8_t flag : zeroTerminated) {
+    if (!(flags & flag)) continue;
+    while (at < length && data[at] != 0) at++;
+    at++;
+  }
+  if (flags & 0x02) at += 2;  // FHCRC
+  return at <= length ? at : 0;
+}
@@ -0,0 +1,52 @@
+#ifndef HTTP_ENCODING_H
+#define HTTP_ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Encodings a static asset can be stored in on the filesystem. */
+enum class ContentCoding : uint8_t {
+  Identity = 0,  // "/x.html"
+  Gzip,          // "/x.html.gz"
+  Brotli         // "/x.html.br"
+};
+
+/** Content-Encoding token ("gzip", "br"); "identity" for the plain file. */
+const char* contentCodingName(ContentCoding coding);
+
+/** Filename suffix of the stored variant ("", ".gz", ".br"). */
+const char* contentCodingSuffix(ContentCoding coding);
+
+/**
+ * @brief Quality the client gives a coding in its Accept-Encoding header
+ *
+ * Follows RFC 9110 §12.5.3: tokens are case-insensitive, "q=0" refuses,
+ * "*" covers codings not listed, and identity is acceptable unless refused
+ * explicitly or through "*;q=0". "x-gzip" counts as gzip.
+ * @param header header value; nullptr or "" means no header was sent
+ * @return quality scaled to 0..1000 (0 = not acceptable)
+ */
+uint16_t acceptEncodingQuality(const char* header, ContentCoding coding);
+
+/**
+ * @brief Order in which to try the stored variants for this client
+ *
+ * Only acceptable codings are listed, best quality first; on equal quality
+ * the smaller encoding wins (br, then gzip, then identity). Without an
+ * Accept-Encoding header only identity is listed, as the header is how a
+ * client says it can decode anything at all.
+ * @return number of entries written to out (0..3)
+ */
+size_t rankContentCodings(const char* acceptEncoding, ContentCoding out[3]);
+
+/**
+ * @brief Length of the RFC 1952 member header at the start of a .gz
+ *
+ * Skips the optional FEXTRA, FNAME, FCOMMENT and FHCRC fields, so the
+ * deflate stream starts at the returned offset.
+ * @return header length, or 0 if `data` is not a deflate-compressed gzip
+ *         member or the header does not fit in `length` bytes
+ */
+size_t gzipHeaderLength(const uint8_t* data, size_t length);
+
+#endif // HTTP_ENCODING_H
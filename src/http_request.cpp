@@ -0,0 +1,447 @@
+#include "http_request.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace {
+
+bool equalsIgnoreCase(const std::string& a, const char* b) {
+  size_t n = strlen(b);
+  if (a.size() != n) return false;
+  for (size_t i = 0; i < n; ++i) {
+    if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+  }
+  return true;
+}
+
+std::string lowercase(std::string s) {
+  for (char& c : s) c = (char)tolower((unsigned char)c);
+  return s;
+}
+
+std::string trim(const char* begin, const char* end) {
+  while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+  while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+  return std::string(begin, end);
+}
+
+// Comma-separated header value contains `token` (Connection: keep-alive, Upgrade)
+bool hasToken(const std::string& value, const char* token) {
+  const char* p = value.c_str();
+  const char* end = p + value.size();
+  while (p < end) {
+    const char* comma = (const char*)memchr(p, ',', (size_t)(end - p));
+    const char* itemEnd = comma ? comma : end;
+    if (equalsIgnoreCase(trim(p, itemEnd), token)) return true;
+    p = comma ? comma + 1 : end;
+  }
+  return false;
+}
+
+HttpMethod methodFromToken(const char* p, size_t n) {
+  struct Name { const char* token; HttpMethod method; };
+  static const Name kNames[] = {
+    {"GET", HttpMethod::Get},     {"HEAD", HttpMethod::Head},     {"POST", HttpMethod::Post},
+    {"PUT", HttpMethod::Put},     {"PATCH", HttpMethod::Patch},   {"DELETE", HttpMethod::Delete},
+    {"OPTIONS", HttpMethod::Options},
+  };
+  for (const Name& name : kNames) {
+    if (strlen(name.token) == n && memcmp(name.token, p, n) == 0) return name.method;
+  }
+  return HttpMethod::Other;
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// `key=value; key="quoted value"` parameters after a header's first item
+std::string headerParam(const std::string& value, const char* key) {
+  const char* p = value.c_str();
+  const char* end = p + value.size();
+  const char* semi = (const char*)memchr(p, ';', (size_t)(end - p));
+  while (semi) {
+    p = semi + 1;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    const char* eq = p;
+    while (eq < end && *eq != '=' && *eq != ';') eq++;
+    if (eq < end && *eq == '=' && equalsIgnoreCase(trim(p, eq), key)) {
+      const char* v = eq + 1;
+      if (v < end && *v == '"') {
+        std::string out;
+        for (v++; v < end && *v != '"'; ++v) {
+          if (*v == '\\' && v + 1 < end) v++;
+          out += *v;
+        }
+        return out;
+      }
+      const char* vEnd = (const char*)memchr(v, ';', (size_t)(end - v));
+      return trim(v, vEnd ? vEnd : end);
+    }
+    semi = (const char*)memchr(p, ';', (size_t)(end - p));
+  }
+  return std::string();
+}
+
+}  // namespace
+
+const std::string* HttpRequest::header(const char* name) const {
+  for (const auto& h : headers) {
+    if (equalsIgnoreCase(h.first, name)) return &h.second;
+  }
+  return nullptr;
+}
+
+const std::string* HttpRequest::arg(const char* name) const {
+  for (const auto& a : args) {
+    if (a.first == name) return &a.second;
+  }
+  return nullptr;
+}
+
+std::string HttpRequest::mediaType() const {
+  const std::string* type = header("Content-Type");
+  if (!type) return std::string();
+  size_t semi = type->find(';');
+  const char* begin = type->c_str();
+  return lowercase(trim(begin, begin + (semi == std::string::npos ? type->size() : semi)));
+}
+
+void HttpRequest::reset() {
+  method = HttpMethod::Other;
+  path.clear();
+  query.clear();
+  http10 = false;
+  keepAlive = true;
+  expectContinue = false;
+  chunkedBody = false;
+  contentLength = 0;
+  headers.clear();
+  args.clear();
+  body.clear();
+}
+
+HttpHeadStatus parseHttpHead(const char* data, size_t length, HttpRequest& out,
+                             size_t& headLength, int& errorStatus) {
+  // Stray line ends between pipelined requests are allowed (RFC 9112 §2.2)
+  size_t start = 0;
+  while (start < length && (data[start] == '\r' || data[start] == '\n')) start++;
+
+  size_t end = 0;
+  for (size_t i = start; i < length; ++i) {
+    if (data[i] != '\n') continue;
+    if (i + 1 < length && data[i + 1] == '\n') { end = i + 2; break; }
+    if (i + 2 < length && data[i + 1] == '\r' && data[i + 2] == '\n') { end = i + 3; break; }
+  }
+  if (end == 0 || end > HTTP_MAX_HEADER_BYTES) {
+    if (length - start >= HTTP_MAX_HEADER_BYTES) {
+      errorStatus = 431;
+      return HttpHeadStatus::Error;
+    }
+    return HttpHeadStatus::NeedMore;
+  }
+
+  out.reset();
+  headLength = end;
+  errorStatus = 400;
+
+  // Request line: METHOD SP target SP HTTP/x.y
+  const char* p = data + start;
+  const char* headEnd = data + end;
+  const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(headEnd - p));
+  const char* sp1 = (const char*)memchr(p, ' ', (size_t)(lineEnd - p));
+  if (!sp1) return HttpHeadStatus::Error;
+  const char* sp2 = (const char*)memchr(sp1 + 1, ' ', (size_t)(lineEnd - sp1 - 1));
+  if (!sp2 || sp2 == sp1 + 1) return HttpHeadStatus::Error;
+  out.method = methodFromToken(p, (size_t)(sp1 - p));
+  std::string version = trim(sp2 + 1, lineEnd);
+  if (version == "HTTP/1.1") {
+    out.http10 = false;
+  } else if (version == "HTTP/1.0") {
+    out.http10 = true;
+  } else {
+    if (version.compare(0, 5, "HTTP/") == 0) errorStatus = 505;
+    return HttpHeadStatus::Error;
+  }
+
+  const char* target = sp1 + 1;
+  const char* targetEnd = sp2;
+  // Absolute form (proxies): drop scheme and authority
+  if ((size_t)(targetEnd - target) > 7 && (memcmp(target, "http://", 7) == 0)) {
+    const char* slash = (const char*)memchr(target + 7, '/', (size_t)(targetEnd - target - 7));
+    target = slash ? slash : targetEnd;
+  }
+  const char* q = (const char*)memchr(target, '?', (size_t)(targetEnd - target));
+  out.path = urlDecode(target, (size_t)((q ? q : targetEnd) - target), false);
+  if (out.path.empty()) out.path = "/";
+  if (out.path[0] != '/') return HttpHeadStatus::Error;
+  if (q) {
+    out.query.assign(q + 1, targetEnd);
+    parseUrlEncoded(q + 1, (size_t)(targetEnd - q - 1), out.args);
+  }
+
+  // Header fields
+  p = lineEnd + 1;
+  while (p < headEnd) {
+    lineEnd = (const char*)memchr(p, '\n', (size_t)(headEnd - p));
+    if (!lineEnd) lineEnd = headEnd;
+    if (lineEnd == p || (lineEnd == p + 1 && *p == '\r')) break;  // blank line
+    if (*p == ' ' || *p == '\t') return HttpHeadStatus::Error;     // obsolete line folding
+    const char* colon = (const char*)memchr(p, ':', (size_t)(lineEnd - p));
+    if (!colon || colon == p) return HttpHeadStatus::Error;
+    out.headers.emplace_back(std::string(p, colon), trim(colon + 1, lineEnd));
+    p = lineEnd + 1;
+  }
+
+  const std::string* connection = out.header("Connection");
+  if (out.http10) {
+    out.keepAlive = connection && hasToken(*connection, "keep-alive");
+  } else {
+    out.keepAlive = !(connection && hasToken(*connection, "close"));
+  }
+
+  if (const std::string* te = out.header("Transfer-Encoding")) {
+    out.chunkedBody = hasToken(lowercase(*te), "chunked");
+    if (!out.chunkedBody) {
+      errorStatus = 501;
+      return HttpHeadStatus::Error;
+    }
+  }
+  if (const std::string* cl = out.header("Content-Length")) {
+    if (cl->empty() || cl->size() > 10) return HttpHeadStatus::Error;
+    size_t n = 0;
+    for (char c : *cl) {
+      if (c < '0' || c > '9') return HttpHeadStatus::Error;
+      n = n * 10 + (size_t)(c - '0');
+    }
+    out.contentLength = n;
+  }
+  if (const std::string* expect = out.header("Expect")) {
+    out.expectContinue = equalsIgnoreCase(*expect, "100-continue");
+  }
+  return HttpHeadStatus::Complete;
+}
+
+void finishHttpBody(HttpRequest& request) {
+  if (request.mediaType() == "application/x-www-form-urlencoded") {
+    parseUrlEncoded(request.body.data(), request.body.size(), request.args);
+  } else if (!request.body.empty()) {
+    request.args.emplace_back("plain", request.body);
+  }
+}
+
+void parseUrlEncoded(const char* data, size_t length, HttpFields& out) {
+  const char* p = data;
+  const char* end = data + length;
+  while (p < end) {
+    const char* amp = (const char*)memchr(p, '&', (size_t)(end - p));
+    const char* itemEnd = amp ? amp : end;
+    if (itemEnd > p) {
+      const char* eq = (const char*)memchr(p, '=', (size_t)(itemEnd - p));
+      const char* nameEnd = eq ? eq : itemEnd;
+      std::string name = urlDecode(p, (size_t)(nameEnd - p), true);
+      std::string value = eq ? urlDecode(eq + 1, (size_t)(itemEnd - eq - 1), true) : std::string();
+      out.emplace_back(std::move(name), std::move(value));
+    }
+    p = amp ? amp + 1 : end;
+  }
+}
+
+std::string urlDecode(const char* data, size_t length, bool plusIsSpace) {
+  std::string out;
+  out.reserve(length);
+  for (size_t i = 0; i < length; ++i) {
+    char c = data[i];
+    if (c == '%' && i + 2 < length) {
+      int hi = hexValue(data[i + 1]);
+      int lo = hexValue(data[i + 2]);
+      if (hi >= 0 && lo >= 0) {
+        out += (char)((hi << 4) | lo);
+        i += 2;
+        continue;
+      }
+    }
+    out += (plusIsSpace && c == '+') ? ' ' : c;
+  }
+  return out;
+}
+
+bool base64Decode(const std::string& in, std::string& out) {
+  out.clear();
+  uint32_t acc = 0;
+  int bits = 0;
+  for (char c : in) {
+    int v;
+    if (c >= 'A' && c <= 'Z') v = c - 'A';
+    else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') v = c - '0' + 52;
+    else if (c == '+') v = 62;
+    else if (c == '/') v = 63;
+    else if (c == '=') break;
+    else return false;
+    acc = (acc << 6) | (uint32_t)v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out += (char)((acc >> bits) & 0xFF);
+    }
+  }
+  return true;
+}
+
+const char* httpReasonPhrase(int status) {
+  switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 303: return "See Other";
+    case 304: return "Not Modified";
+    case 307: return "Temporary Redirect";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 408: return "Request Timeout";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Content Too Large";
+    case 415: return "Unsupported Media Type";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    default:  return "";
+  }
+}
+
+bool MultipartParser::begin(const std::string& contentType, Callback callback, void* ctx) {
+  std::string boundary = headerParam(contentType, "boundary");
+  if (boundary.empty() || boundary.size() > 70) {
+    state_ = State::Error;
+    return false;
+  }
+  delimiter_ = "\r\n--" + boundary;
+  // The first boundary has no line end before it; pretend it does so every
+  // boundary is found by the same search
+  buf_ = "\r\n";
+  part_ = MultipartPart();
+  callback_ = callback;
+  ctx_ = ctx;
+  state_ = State::Preamble;
+  return true;
+}
+
+bool MultipartParser::parsePartHeaders(const std::string& head) {
+  part_ = MultipartPart();
+  size_t p = 0;
+  while (p < head.size()) {
+    size_t eol = head.find("\r\n", p);
+    if (eol == std::string::npos) eol = head.size();
+    size_t colon = head.find(':', p);
+    if (colon != std::string::npos && colon < eol) {
+      std::string name(head, p, colon - p);
+      std::string value = trim(head.c_str() + colon + 1, head.c_str() + eol);
+      if (equalsIgnoreCase(name, "Content-Disposition")) {
+        part_.name = headerParam(value, "name");
+        part_.filename = headerParam(value, "filename");
+      } else if (equalsIgnoreCase(name, "Content-Type")) {
+        part_.contentType = value;
+      }
+    }
+    p = eol + 2;
+  }
+  return true;
+}
+
+bool MultipartParser::feed(const char* data, size_t length) {
+  if (state_ == State::Error) return false;
+  if (state_ == State::Done) return true;  // epilogue is ignored
+  buf_.append(data, length);
+  while (true) {
+    switch (state_) {
+      case State::Preamble: {
+        size_t at = buf_.find(delimiter_);
+        if (at == std::string::npos) {
+          // Keep just enough to match a delimiter split across feeds
+          if (buf_.size() >= delimiter_.size()) buf_.erase(0, buf_.size() - delimiter_.size() + 1);
+          return true;
+        }
+        buf_.erase(0, at + delimiter_.size());
+        state_ = State::AfterBoundary;
+        break;
+      }
+      case State::AfterBoundary:
+        if (buf_.size() < 2) return true;
+        if (buf_.compare(0, 2, "--") == 0) {
+          buf_.clear();
+          state_ = State::Done;
+          return true;
+        }
+        if (buf_.compare(0, 2, "\r\n") != 0) {
+          state_ = State::Error;
+          return false;
+        }
+        buf_.erase(0, 2);
+        state_ = State::Headers;
+        break;
+      case State::Headers: {
+        size_t at;
+        size_t skip;
+        if (buf_.compare(0, 2, "\r\n") == 0) {
+          at = 0;  // no headers at all
+          skip = 2;
+        } else {
+          at = buf_.find("\r\n\r\n");
+          skip = 4;
+        }
+        if (at == std::string::npos) {
+          if (buf_.size() > HTTP_MAX_HEADER_BYTES) {
+            state_ = State::Error;
+            return false;
+          }
+          return true;
+        }
+        parsePartHeaders(buf_.substr(0, at));
+        buf_.erase(0, at + skip);
+        state_ = State::Data;
+        callback_(ctx_, Event::PartBegin, part_, nullptr, 0);
+        break;
+      }
+      case State::Data: {
+        size_t at = buf_.find(delimiter_);
+        if (at == std::string::npos) {
+          size_t keep = delimiter_.size() - 1;
+          if (buf_.size() > keep) {
+            size_t n = buf_.size() - keep;
+            callback_(ctx_, Event::PartData, part_, buf_.data(), n);
+            buf_.erase(0, n);
+          }
+          return true;
+        }
+        if (at > 0) callback_(ctx_, Event::PartData, part_, buf_.data(), at);
+        callback_(ctx_, Event::PartEnd, part_, nullptr, 0);
+        buf_.erase(0, at + delimiter_.size());
+        state_ = State::AfterBoundary;
+        break;
+      }
+      case State::Done:
+        buf_.clear();
+        return true;
+      case State::Error:
+      default:
+        return false;
+    }
+  }
+}
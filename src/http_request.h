@@ -0,0 +1,129 @@
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Request line plus headers; a longer head gets 431.
+#ifndef HTTP_MAX_HEADER_BYTES
+#define HTTP_MAX_HEADER_BYTES 4096
+#endif
+// Buffered request body (forms, JSON); a longer one gets 413. Streamed
+// multipart uploads are not buffered and not limited by this.
+#ifndef HTTP_MAX_BODY_BYTES
+#define HTTP_MAX_BODY_BYTES 16384
+#endif
+
+enum class HttpMethod : uint8_t { Get, Head, Post, Put, Patch, Delete, Options, Other };
+
+/** Bit for a method in a route's method mask. */
+inline uint16_t httpMethodBit(HttpMethod method) {
+  return (uint16_t)(1u << static_cast<uint8_t>(method));
+}
+#define HTTP_METHODS_ANY 0xFFFF
+
+using HttpFields = std::vector<std::pair<std::string, std::string>>;
+
+/** One parsed request. Header and argument lookups are by exact name, headers case-insensitively. */
+struct HttpRequest {
+  HttpMethod method = HttpMethod::Other;
+  std::string path;   // percent-decoded, without the query
+  std::string query;  // as received
+  bool http10 = false;
+  bool keepAlive = true;
+  bool expectContinue = false;
+  bool chunkedBody = false;  // Transfer-Encoding: chunked (not supported)
+  size_t contentLength = 0;
+  HttpFields headers;
+  // Query arguments, then urlencoded or multipart form fields; any other
+  // body is also available as the argument "plain", as WebServer did
+  HttpFields args;
+  std::string body;
+
+  const std::string* header(const char* name) const;
+  const std::string* arg(const char* name) const;
+  /** Media type of the body, lowercased, without parameters. */
+  std::string mediaType() const;
+  void reset();
+};
+
+enum class HttpHeadStatus : uint8_t { NeedMore, Complete, Error };
+
+/**
+ * @brief Parse the request line and headers at the start of `data`
+ *
+ * Accepts CRLF or bare LF line ends. On Complete, `headLength` is the number
+ * of bytes the head took (the body, or a pipelined request, follows) and
+ * `out` holds method, path, query arguments, headers and the keep-alive
+ * decision. On Error, `errorStatus` is the status to answer with (400, 431,
+ * 501 or 505).
+ */
+HttpHeadStatus parseHttpHead(const char* data, size_t length, HttpRequest& out,
+                             size_t& headLength, int& errorStatus);
+
+/** Turn a complete buffered body into arguments: urlencoded fields, or "plain". */
+void finishHttpBody(HttpRequest& request);
+
+/** Decode "a=1&b=x%20y" into `out` ('+' is a space). */
+void parseUrlEncoded(const char* data, size_t length, HttpFields& out);
+
+/** Percent-decode; '+' becomes a space only when `plusIsSpace`. */
+std::string urlDecode(const char* data, size_t length, bool plusIsSpace);
+
+/** Standard base64 (padding optional); false on any other character. */
+bool base64Decode(const std::string& in, std::string& out);
+
+/** Reason phrase for a status code ("OK", "Not Found", ...). */
+const char* httpReasonPhrase(int status);
+
+/** One part of a multipart/form-data body, as described by its headers. */
+struct MultipartPart {
+  std::string name;
+  std::string filename;  // empty for an ordinary form field
+  std::string contentType;
+};
+
+/**
+ * @brief Incremental multipart/form-data parser
+ *
+ * Bytes can arrive split anywhere, including inside a boundary. Part data
+ * is delivered as it is found, holding back only enough to recognise a
+ * boundary, so a firmware image passes through in fixed memory.
+ */
+class MultipartParser {
+public:
+  enum class Event : uint8_t { PartBegin, PartData, PartEnd };
+  using Callback = void (*)(void* ctx, Event event, const MultipartPart& part,
+                            const char* data, size_t length);
+
+  /** Take the boundary from a Content-Type header; false if it has none. */
+  bool begin(const std::string& contentType, Callback callback, void* ctx);
+
+  /** Consume body bytes; false once the body is malformed. */
+  bool feed(const char* data, size_t length);
+
+  /** The closing boundary has been seen. */
+  bool finished() const { return state_ == State::Done; }
+
+  /** A part was open when the body ended. */
+  bool inPart() const { return state_ == State::Data; }
+
+  const MultipartPart& part() const { return part_; }
+
+private:
+  enum class State : uint8_t { Preamble, Headers, Data, AfterBoundary, Done, Error };
+
+  bool parsePartHeaders(const std::string& head);
+
+  State state_ = State::Error;
+  std::string delimiter_;  // "\r\n--" + boundary
+  std::string buf_;
+  MultipartPart part_;
+  Callback callback_ = nullptr;
+  void* ctx_ = nullptr;
+};
+
+#endif // HTTP_REQUEST_H
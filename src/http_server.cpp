@@ -0,0 +1,302 @@
+#include "http_server.h"
+
+#include "heap_tracker.h"
+#include "log.h"
+#include "loop_profile.h"
+
+#if defined(PIO_UNIT_TESTING)
+#include <mutex>
+#else
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+namespace {
+
+uint16_t methodMask(HTTPMethod method) {
+  if (method == HTTP_ANY) return HTTP_METHODS_ANY;
+  switch (method) {
+    case HTTP_GET: return httpMethodBit(HttpMethod::Get) | httpMethodBit(HttpMethod::Head);
+    case HTTP_HEAD: return httpMethodBit(HttpMethod::Head);
+    case HTTP_POST: return httpMethodBit(HttpMethod::Post);
+    case HTTP_PUT: return httpMethodBit(HttpMethod::Put);
+    case HTTP_PATCH: return httpMethodBit(HttpMethod::Patch);
+    case HTTP_DELETE: return httpMethodBit(HttpMethod::Delete);
+    case HTTP_OPTIONS: return httpMethodBit(HttpMethod::Options);
+    default: return 0;
+  }
+}
+
+String toString(const std::string* value) {
+  return value ? String(value->c_str(), (unsigned int)value->size()) : String();
+}
+
+#if defined(PIO_UNIT_TESTING)
+std::recursive_mutex& appMutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+#else
+SemaphoreHandle_t appMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+  return mutex;
+}
+#endif
+
+}  // namespace
+
+void httpAppLock() {
+#if defined(PIO_UNIT_TESTING)
+  appMutex().lock();
+#else
+  xSemaphoreTakeRecursive(appMutex(), portMAX_DELAY);
+#endif
+}
+
+void httpAppUnlock() {
+#if defined(PIO_UNIT_TESTING)
+  appMutex().unlock();
+#else
+  xSemaphoreGiveRecursive(appMutex());
+#endif
+}
+
+HttpServer::HttpServer(uint16_t port) : listenPort_(port), upload_(new HTTPUpload()) {}
+
+HttpServer::~HttpServer() {}
+
+void HttpServer::begin() {
+#if defined(PIO_UNIT_TESTING)
+  const bool loopbackOnly = true;
+#else
+  const bool loopbackOnly = false;
+#endif
+  if (!core_.begin(listenPort_, loopbackOnly)) {
+    logError(String("HTTP server: cannot listen on port ") + String((unsigned)listenPort_));
+    return;
+  }
+#if !defined(PIO_UNIT_TESTING)
+  if (taskStarted_) return;
+  // Same core as loopTask, so the app lock changes hands by preemption
+  BaseType_t ok = xTaskCreatePinnedToCore(
+    serverTask,
+    "http",
+    HTTP_SERVER_TASK_STACK,
+    this,
+    HTTP_SERVER_TASK_PRIORITY,
+    nullptr,
+    ARDUINO_RUNNING_CORE
+  );
+  taskStarted_ = (ok == pdPASS);
+  if (!taskStarted_) logError("HTTP server: failed to start server task");
+#endif
+}
+
+#if !defined(PIO_UNIT_TESTING)
+void HttpServer::serverTask(void* arg) {
+  HttpServer* self = static_cast<HttpServer*>(arg);
+  for (;;) self->core_.poll(HTTP_SERVER_POLL_MS);
+}
+#endif
+
+void HttpServer::on(const char* uri, THandlerFunction handler) {
+  on(uri, HTTP_ANY, std::move(handler));
+}
+
+void HttpServer::on(const char* uri, HTTPMethod method, THandlerFunction handler) {
+  core_.on(uri, methodMask(method), wrap(std::move(handler)));
+}
+
+void HttpServer::on(const char* uri, HTTPMethod method, THandlerFunction handler, THandlerFunction upload) {
+  core_.on(uri, methodMask(method), wrap(std::move(handler)),
+           [this, upload](HttpRequest& request, const HttpUploadEvent& event) { onUpload(upload, request, event); });
+}
+
+void HttpServer::onNotFound(THandlerFunction handler) {
+  core_.onNotFound(wrap(std::move(handler)));
+}
+
+HttpHandler HttpServer::wrap(THandlerFunction handler) {
+  return [this, handler](HttpRequest& request, HttpResponse& response) {
+    HttpAppLock lock;
+    // The time loop() is held off, as handleClient() used to cost it
+    LoopStageTimer timer(LoopStage::Http);
+    HeapTagScope heapTag(HeapTag::Web);
+    beginRequest(&request, &response);
+    handler();
+    endRequest();
+  };
+}
+
+void HttpServer::beginRequest(HttpRequest* request, HttpResponse* response) {
+  request_ = request;
+  response_ = response;
+  chunkedNext_ = false;
+}
+
+void HttpServer::endRequest() {
+  request_ = nullptr;
+  response_ = nullptr;
+  chunkedNext_ = false;
+#if !defined(PIO_UNIT_TESTING)
+  // Only drops our reference; the route keeps its own copy
+  client_ = WiFiClient();
+#endif
+}
+
+// WebServer hands uploads over in HTTP_UPLOAD_BUFLEN pieces; so does this,
+// whatever sizes the parts arrive in.
+void HttpServer::onUpload(const THandlerFunction& handler, HttpRequest& request, const HttpUploadEvent& event) {
+  HttpAppLock lock;
+  HeapTagScope heapTag(HeapTag::Web);
+  beginRequest(&request, nullptr);
+  HTTPUpload& up = *upload_;
+  switch (event.phase) {
+    case HttpUploadEvent::Phase::Start:
+      up.status = UPLOAD_FILE_START;
+      up.filename = String(event.part->filename.c_str());
+      up.name = String(event.part->name.c_str());
+      up.type = String(event.part->contentType.c_str());
+      up.totalSize = 0;
+      up.currentSize = 0;
+      handler();
+      break;
+    case HttpUploadEvent::Phase::Data: {
+      const uint8_t* data = event.data;
+      size_t left = event.length;
+      while (left > 0) {
+        size_t n = HTTP_UPLOAD_BUFLEN - up.currentSize;
+        if (n > left) n = left;
+        memcpy(up.buf + up.currentSize, data, n);
+        up.currentSize += n;
+        data += n;
+        left -= n;
+        if (up.currentSize == HTTP_UPLOAD_BUFLEN) {
+          up.status = UPLOAD_FILE_WRITE;
+          handler();
+          up.totalSize += up.currentSize;
+          up.currentSize = 0;
+        }
+      }
+      break;
+    }
+    case HttpUploadEvent::Phase::End:
+      if (up.currentSize > 0) {
+        up.status = UPLOAD_FILE_WRITE;
+        handler();
+        up.totalSize += up.currentSize;
+        up.currentSize = 0;
+      }
+      up.status = UPLOAD_FILE_END;
+      handler();
+      break;
+    case HttpUploadEvent::Phase::Aborted:
+      up.status = UPLOAD_FILE_ABORTED;
+      up.currentSize = 0;
+      handler();
+      break;
+  }
+  endRequest();
+}
+
+String HttpServer::uri() const {
+  return request_ ? String(request_->path.c_str()) : String();
+}
+
+HTTPMethod HttpServer::method() const {
+  if (!request_) return HTTP_ANY;
+  switch (request_->method) {
+    case HttpMethod::Get: return HTTP_GET;
+    case HttpMethod::Head: return HTTP_HEAD;
+    case HttpMethod::Post: return HTTP_POST;
+    case HttpMethod::Put: return HTTP_PUT;
+    case HttpMethod::Patch: return HTTP_PATCH;
+    case HttpMethod::Delete: return HTTP_DELETE;
+    case HttpMethod::Options: return HTTP_OPTIONS;
+    case HttpMethod::Other: break;
+  }
+  return HTTP_ANY;
+}
+
+String HttpServer::arg(const String& name) const {
+  return toString(request_ ? request_->arg(name.c_str()) : nullptr);
+}
+
+bool HttpServer::hasArg(const String& name) const {
+  return request_ && request_->arg(name.c_str()) != nullptr;
+}
+
+String HttpServer::header(const String& name) const {
+  return toString(request_ ? request_->header(name.c_str()) : nullptr);
+}
+
+bool HttpServer::hasHeader(const String& name) const {
+  return request_ && request_->header(name.c_str()) != nullptr;
+}
+
+bool HttpServer::authenticate(const char* username, const char* password) const {
+  const std::string* authorization = request_ ? request_->header("Authorization") : nullptr;
+  if (!authorization || authorization->compare(0, 6, "Basic ") != 0) return false;
+  std::string credentials;
+  if (!base64Decode(authorization->substr(6), credentials)) return false;
+  return credentials == std::string(username) + ":" + password;
+}
+
+void HttpServer::requestAuthentication(HTTPAuthMethod mode, const char* realm, const String& authFailMsg) {
+  (void)mode;  // Basic only
+  sendHeader("WWW-Authenticate", String("Basic realm=\"") + (realm ? realm : "Login Required") + "\"");
+  send(401, "text/html", authFailMsg);
+}
+
+void HttpServer::sendHeader(const String& name, const String& value, bool first) {
+  (void)first;  // header order carries no meaning
+  if (response_) response_->addHeader(name.c_str(), value.c_str());
+}
+
+void HttpServer::send(int code, const char* contentType, const String& content) {
+  if (!response_) return;
+  send(code, contentType, content.c_str(), content.length());
+}
+
+void HttpServer::send(int code, const char* contentType, const char* content, size_t length) {
+  if (!response_) return;
+  if (!contentType) contentType = "text/html";
+  if (chunkedNext_) {
+    chunkedNext_ = false;
+    response_->beginChunked(code, contentType);
+    if (length) response_->writeChunk(content, length);
+    return;
+  }
+  response_->send(code, contentType, content, length);
+}
+
+void HttpServer::send_P(int code, const char* contentType, const char* content, size_t length) {
+  if (!response_) return;
+  response_->sendStatic(code, contentType, reinterpret_cast<const uint8_t*>(content), length);
+}
+
+void HttpServer::sendContent(const char* content, size_t length) {
+  if (!response_) return;
+  if (length == 0) {
+    response_->endChunked();
+    return;
+  }
+  response_->writeChunk(content, length);
+}
+
+void HttpServer::sendSource(int code, const char* contentType, std::unique_ptr<HttpBodySource> source, long length) {
+  if (!response_) return;
+  chunkedNext_ = false;
+  response_->sendSource(code, contentType ? contentType : "text/html", std::move(source), length);
+}
+
+#if !defined(PIO_UNIT_TESTING)
+WiFiClient HttpServer::client() {
+  if (response_ && !response_->detached()) {
+    int fd = response_->detach();
+    if (fd >= 0) client_ = WiFiClient(fd);
+  }
+  return client_;
+}
+#endif
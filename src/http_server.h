@@ -0,0 +1,190 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+#include <WebServer.h>  // HTTPMethod, HTTPUpload, HTTPAuthMethod, CONTENT_LENGTH_UNKNOWN
+#include <functional>
+#include <memory>
+#include <string.h>
+#if !defined(PIO_UNIT_TESTING)
+#include <WiFiClient.h>
+#endif
+
+#include "http_core.h"
+
+// Stack of the server task, which also runs the route handlers.
+#ifndef HTTP_SERVER_TASK_STACK
+#define HTTP_SERVER_TASK_STACK 10240
+#endif
+// Above loopTask (1), so a request waiting for the app lock gets it as soon
+// as loop() finishes its current pass.
+#ifndef HTTP_SERVER_TASK_PRIORITY
+#define HTTP_SERVER_TASK_PRIORITY 2
+#endif
+// Longest the task sleeps in select(); bounds how late timeouts are noticed.
+#ifndef HTTP_SERVER_POLL_MS
+#define HTTP_SERVER_POLL_MS 250
+#endif
+
+/**
+ * @brief The lock that serializes route handlers with loop()
+ *
+ * Handlers used to run inside loop() and still assume they do: they touch
+ * settings, LEDs and MQTT without locks of their own. The server task takes
+ * this lock around every handler and loop() holds it for each pass, so the
+ * two never overlap. Recursive. Socket I/O happens outside it, and so do
+ * body sources (sendSource(), streamFile()): they are read as the client
+ * takes the body, after the handler has returned, and touch only what they own.
+ */
+void httpAppLock();
+void httpAppUnlock();
+
+class HttpAppLock {
+public:
+  HttpAppLock() { httpAppLock(); }
+  ~HttpAppLock() { httpAppUnlock(); }
+  HttpAppLock(const HttpAppLock&) = delete;
+  HttpAppLock& operator=(const HttpAppLock&) = delete;
+};
+
+/**
+ * @brief The subset of the Arduino WebServer API the routes use, on HttpServerCore
+ *
+ * Routes are registered and answered exactly as before (`server.on()`,
+ * `server.arg()`, `server.send()` ...), but connections are served by the
+ * event-driven core from a task of their own: many clients at once,
+ * keep-alive, size limits, and file bodies that drain while loop() runs.
+ *
+ * Differences from WebServer: every request header is kept (collectHeaders()
+ * is a no-op), a GET route also answers HEAD, only Basic authentication is
+ * supported, and responses sent from an upload handler are ignored; the
+ * request handler that follows the upload answers instead.
+ */
+class HttpServer {
+public:
+  using THandlerFunction = std::function<void(void)>;
+
+  explicit HttpServer(uint16_t port = 80);
+  ~HttpServer();
+  HttpServer(const HttpServer&) = delete;
+  HttpServer& operator=(const HttpServer&) = delete;
+
+  /**
+   * Start listening. On the device this also starts the server task; on the
+   * host it binds 127.0.0.1 and the caller drives poll().
+   */
+  void begin();
+  /** Serve what is ready, waiting up to `timeoutMs` (host tests; the task does this on the device). */
+  void poll(unsigned timeoutMs) { core_.poll(timeoutMs); }
+  uint16_t port() const { return core_.port(); }
+  HttpServerCore::Stats stats() const { return core_.stats(); }
+
+  void on(const char* uri, THandlerFunction handler);
+  void on(const char* uri, HTTPMethod method, THandlerFunction handler);
+  void on(const char* uri, HTTPMethod method, THandlerFunction handler, THandlerFunction upload);
+  void onNotFound(THandlerFunction handler);
+  void collectHeaders(const char* headerKeys[], size_t count) {
+    (void)headerKeys;
+    (void)count;
+  }
+
+  // Current request
+  String uri() const;
+  HTTPMethod method() const;
+  String arg(const String& name) const;
+  bool hasArg(const String& name) const;
+  String header(const String& name) const;
+  bool hasHeader(const String& name) const;
+  bool authenticate(const char* username, const char* password) const;
+  HTTPUpload& upload() { return *upload_; }
+
+  // Response
+  void requestAuthentication(HTTPAuthMethod mode = BASIC_AUTH, const char* realm = nullptr,
+                             const String& authFailMsg = String(""));
+  void sendHeader(const String& name, const String& value, bool first = false);
+  /** Only CONTENT_LENGTH_UNKNOWN is supported: the next send() starts a chunked body for sendContent(). */
+  void setContentLength(size_t contentLength) { chunkedNext_ = contentLength == CONTENT_LENGTH_UNKNOWN; }
+  void send(int code, const char* contentType = nullptr, const String& content = String(""));
+  void send(int code, const String& contentType, const String& content) {
+    send(code, contentType.c_str(), content);
+  }
+  /** Body copied from `content`, which need not be a String or NUL-terminated. */
+  void send(int code, const char* contentType, const char* content, size_t length);
+  /** Body sent straight from flash (or any memory that outlives the response). */
+  void send_P(int code, const char* contentType, const char* content, size_t length);
+  /** Chunked body piece; at most HTTP_CORE_CHUNK_QUEUE bytes may wait for the client (see writeChunk()). */
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char* content, size_t length);
+
+  /**
+   * Body pulled from `source` as the client takes it, after the handler has
+   * returned, outside the app lock; for bodies too large to queue whole.
+   * @param length bytes to come, or -1 when unknown (chunked)
+   */
+  void sendSource(int code, const char* contentType, std::unique_ptr<HttpBodySource> source, long length = -1);
+
+  /**
+   * Answer with an open file. The response keeps its own handle and reads
+   * the file as the client takes it, after the handler has returned. A
+   * *.gz name gets "Content-Encoding: gzip", as WebServer did.
+   */
+  template <typename T>
+  size_t streamFile(T& file, const String& contentType, int code = 200);
+
+#if !defined(PIO_UNIT_TESTING)
+  /**
+   * The socket, taken over from the server (event streams, parked
+   * long-polls); nothing more is sent for this request.
+   */
+  WiFiClient client();
+#endif
+
+private:
+  template <typename T>
+  class FileBodySource : public HttpBodySource {
+  public:
+    explicit FileBodySource(const T& file) : file_(file) {}
+    ~FileBodySource() override { file_.close(); }
+    long read(uint8_t* buffer, size_t length) override { return (long)file_.read(buffer, length); }
+
+  private:
+    T file_;
+  };
+
+  HttpHandler wrap(THandlerFunction handler);
+  void beginRequest(HttpRequest* request, HttpResponse* response);
+  void endRequest();
+  void onUpload(const THandlerFunction& handler, HttpRequest& request, const HttpUploadEvent& event);
+#if !defined(PIO_UNIT_TESTING)
+  static void serverTask(void* arg);
+#endif
+
+  HttpServerCore core_;
+  uint16_t listenPort_;
+  HttpRequest* request_ = nullptr;
+  HttpResponse* response_ = nullptr;
+  bool chunkedNext_ = false;
+  std::unique_ptr<HTTPUpload> upload_;
+#if !defined(PIO_UNIT_TESTING)
+  WiFiClient client_;
+  bool taskStarted_ = false;
+#endif
+};
+
+template <typename T>
+size_t HttpServer::streamFile(T& file, const String& contentType, int code) {
+  if (!response_) return 0;
+  size_t size = file.size();
+  const char* name = file.name();
+  size_t nameLength = name ? strlen(name) : 0;
+  bool gzipType = strcmp(contentType.c_str(), "application/x-gzip") == 0 ||
+                  strcmp(contentType.c_str(), "application/octet-stream") == 0;
+  if (nameLength > 3 && strcmp(name + nameLength - 3, ".gz") == 0 && !gzipType) {
+    sendHeader("Content-Encoding", "gzip");
+  }
+  response_->sendSource(code, contentType.c_str(),
+                        std::unique_ptr<HttpBodySource>(new FileBodySource<T>(file)), (long)size);
+  return size;
+}
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,209 @@
+#include "json_arena.h"
+
+#include <stdlib.h>
+
+#include "mem_pool.h"
+
+#if defined(PIO_UNIT_TESTING)
+#include <functional>
+#include <thread>
+#else
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace {
+
+// Every block starts with its requested size; blocks are kAlign-aligned
+const size_t kAlign = 8;
+const size_t kHeader = 8;
+static_assert(sizeof(size_t) <= kHeader, "block header holds a size_t");
+
+size_t alignUp(size_t n) {
+  return (n + kAlign - 1) & ~(kAlign - 1);
+}
+
+size_t& blockSize(uint8_t* block) {
+  return *reinterpret_cast<size_t*>(block);
+}
+
+class HeapAllocator : public ArduinoJson::Allocator {
+public:
+  void* allocate(size_t size) override { return malloc(size); }
+  void deallocate(void* ptr) override { free(ptr); }
+  void* reallocate(void* ptr, size_t newSize) override { return realloc(ptr, newSize); }
+};
+
+HeapAllocator g_heap;
+
+std::atomic<JsonArenaSite*> g_sites{nullptr};
+
+// Task that holds the shared arena (0: none) and how many of its scopes are open
+std::atomic<uintptr_t> g_sharedOwner{0};
+uint32_t g_sharedDepth = 0;
+
+uintptr_t currentTask() {
+#if defined(PIO_UNIT_TESTING)
+  return std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+#else
+  return (uintptr_t)xTaskGetCurrentTaskHandle();
+#endif
+}
+
+}  // namespace
+
+JsonArena::JsonArena(size_t capacity) : capacity_(alignUp(capacity)) {}
+
+JsonArena::~JsonArena() {
+  poolFree(MemPool::Bulk, buffer_, capacity_);
+}
+
+bool JsonArena::ensureBuffer() {
+  if (buffer_ || failed_) return buffer_ != nullptr;
+  // Documents are parsed and serialized, never DMA'd
+  buffer_ = static_cast<uint8_t*>(poolAlloc(MemPool::Bulk, capacity_));
+  external_ = poolIsExternal(buffer_);
+  failed_ = buffer_ == nullptr;
+  return buffer_ != nullptr;
+}
+
+bool JsonArena::owns(const void* ptr) const {
+  const uint8_t* p = static_cast<const uint8_t*>(ptr);
+  return buffer_ && p >= buffer_ && p < buffer_ + capacity_;
+}
+
+bool JsonArena::isTop(const uint8_t* block) const {
+  return block + kHeader + alignUp(*reinterpret_cast<const size_t*>(block)) == buffer_ + top_;
+}
+
+void JsonArena::grew() {
+  if (top_ > peak_) peak_ = top_;
+  if (top_ > highWater_) highWater_ = top_;
+}
+
+void* JsonArena::allocate(size_t size) {
+  size_t need = kHeader + alignUp(size);
+  if (ensureBuffer() && need <= capacity_ - top_) {
+    uint8_t* block = buffer_ + top_;
+    blockSize(block) = size;
+    top_ += need;
+    grew();
+    return block + kHeader;
+  }
+  void* p = malloc(size);
+  if (p) spills_++;
+  return p;
+}
+
+void JsonArena::deallocate(void* ptr) {
+  if (!ptr) return;
+  if (!owns(ptr)) {
+    free(ptr);
+    return;
+  }
+  uint8_t* block = static_cast<uint8_t*>(ptr) - kHeader;
+  if (isTop(block)) top_ = block - buffer_;
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+  if (!ptr) return allocate(newSize);
+  if (!owns(ptr)) return realloc(ptr, newSize);
+  uint8_t* block = static_cast<uint8_t*>(ptr) - kHeader;
+  size_t oldSize = blockSize(block);
+  if (isTop(block)) {
+    size_t offset = block - buffer_;
+    if (kHeader + alignUp(newSize) <= capacity_ - offset) {
+      blockSize(block) = newSize;
+      top_ = offset + kHeader + alignUp(newSize);
+      grew();
+      return ptr;
+    }
+  } else if (newSize <= oldSize) {
+    // Keeps its footprint, so the blocks after it still line up
+    return ptr;
+  }
+  void* p = allocate(newSize);
+  if (!p) return nullptr;
+  memcpy(p, ptr, oldSize < newSize ? oldSize : newSize);
+  deallocate(ptr);
+  return p;
+}
+
+void JsonArena::rewind(size_t mark) {
+  if (mark < top_) top_ = mark;
+}
+
+JsonArenaSite::JsonArenaSite(const char* name) : name_(name) {
+  JsonArenaSite* head = g_sites.load(std::memory_order_relaxed);
+  do {
+    next_ = head;
+  } while (!g_sites.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+const JsonArenaSite* JsonArenaSite::first() {
+  return g_sites.load(std::memory_order_acquire);
+}
+
+void JsonArenaSite::record(size_t bytes, uint32_t spills) {
+  calls_.fetch_add(1, std::memory_order_relaxed);
+  if (spills > 0) spilledCalls_.fetch_add(1, std::memory_order_relaxed);
+  uint32_t peak = peak_.load(std::memory_order_relaxed);
+  while (bytes > peak && !peak_.compare_exchange_weak(peak, (uint32_t)bytes, std::memory_order_relaxed)) {
+  }
+}
+
+JsonArena& jsonSharedArena() {
+  static JsonArena arena(JSON_ARENA_BYTES);
+  return arena;
+}
+
+JsonScope::JsonScope(JsonArenaSite& site) : site_(site) {
+  uintptr_t me = currentTask();
+  uintptr_t owner = 0;
+  if (g_sharedOwner.load(std::memory_order_acquire) == me ||
+      g_sharedOwner.compare_exchange_strong(owner, me, std::memory_order_acquire)) {
+    g_sharedDepth++;
+    shared_ = true;
+    open(jsonSharedArena());
+  }
+}
+
+JsonScope::JsonScope(JsonArenaSite& site, JsonArena& arena) : site_(site) {
+  open(arena);
+}
+
+JsonScope::JsonScope(JsonArenaSite& site, size_t capacity) : site_(site), owned_(new JsonArena(capacity)) {
+  open(*owned_);
+}
+
+void JsonScope::open(JsonArena& arena) {
+  arena_ = &arena;
+  mark_ = arena.top_;
+  outerPeak_ = arena.peak_;
+  arena.peak_ = arena.top_;
+  spills_ = arena.spills_;
+}
+
+JsonScope::~JsonScope() {
+  if (buffer_) allocator()->deallocate(buffer_);
+  if (!arena_) {
+    site_.recordHeap();
+    return;
+  }
+  JsonArena& arena = *arena_;
+  site_.record(arena.peak_ - mark_, arena.spills_ - spills_);
+  arena.rewind(mark_);
+  if (arena.peak_ < outerPeak_) arena.peak_ = outerPeak_;
+  if (shared_ && --g_sharedDepth == 0) g_sharedOwner.store(0, std::memory_order_release);
+}
+
+ArduinoJson::Allocator* JsonScope::allocator() {
+  if (arena_) return arena_;
+  return &g_heap;
+}
+
+char* JsonScope::buffer(size_t size) {
+  if (buffer_) allocator()->deallocate(buffer_);
+  buffer_ = allocator()->allocate(size);
+  return static_cast<char*>(buffer_);
+}
@@ -0,0 +1,211 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+
+// Shared arena for documents built or parsed by route handlers, MQTT
+// commands and the heartbeat. Taken once, from the Bulk pool (mem_pool.h).
+#ifndef JSON_ARENA_BYTES
+#define JSON_ARENA_BYTES 16384
+#endif
+// Largest JSON response serialized in the arena; a larger body is measured
+// and serialized into the Bulk pool instead (sendJson()).
+#ifndef JSON_CHUNK_BYTES
+#define JSON_CHUNK_BYTES 1024
+#endif
+
+/**
+ * @brief Bump allocator for ArduinoJson documents
+ *
+ * allocate() moves a pointer through one fixed block. deallocate() only
+ * takes back the most recent block; the rest comes back in one go through
+ * rewind(). ArduinoJson grows strings with reallocate(), which the most
+ * recent block does in place.
+ *
+ * Allocations that do not fit spill to the heap instead of failing, and are
+ * counted so the block can be sized from the numbers in /api/perf/json.
+ */
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  /** The block itself is taken on first use. */
+  explicit JsonArena(size_t capacity);
+  ~JsonArena();
+  JsonArena(const JsonArena&) = delete;
+  JsonArena& operator=(const JsonArena&) = delete;
+
+  void* allocate(size_t size) override;
+  void deallocate(void* ptr) override;
+  void* reallocate(void* ptr, size_t newSize) override;
+
+  size_t capacity() const { return capacity_; }
+  size_t used() const { return top_; }
+  /** Drop every block allocated since used() returned `mark`. */
+  void rewind(size_t mark);
+  /** Most bytes ever in use at once. */
+  size_t highWater() const { return highWater_; }
+  /** Allocations that went to the heap because the block was full. */
+  uint32_t spills() const { return spills_; }
+  /** The block lives in PSRAM. */
+  bool external() const { return external_; }
+
+private:
+  friend class JsonScope;
+
+  bool ensureBuffer();
+  bool owns(const void* ptr) const;
+  bool isTop(const uint8_t* block) const;
+  void grew();
+
+  size_t capacity_;
+  uint8_t* buffer_ = nullptr;
+  bool failed_ = false;
+  bool external_ = false;
+  size_t top_ = 0;
+  size_t peak_ = 0;  // since the innermost JsonScope began
+  size_t highWater_ = 0;
+  uint32_t spills_ = 0;
+};
+
+/**
+ * @brief Arena use of one JSON call site, kept across calls
+ *
+ * Declared static next to the code it measures (see JSON_SCOPE), and
+ * registered in a list read by /api/perf/json.
+ */
+class JsonArenaSite {
+public:
+  explicit JsonArenaSite(const char* name);
+
+  /** One call: `bytes` taken from an arena, `spills` allocations that went to the heap. */
+  void record(size_t bytes, uint32_t spills);
+  /** One call that ran on the heap because another task held the shared arena. */
+  void recordHeap() { heapCalls_.fetch_add(1, std::memory_order_relaxed); }
+
+  const char* name() const { return name_; }
+  uint32_t calls() const { return calls_.load(std::memory_order_relaxed); }
+  uint32_t peakBytes() const { return peak_.load(std::memory_order_relaxed); }
+  uint32_t spilledCalls() const { return spilledCalls_.load(std::memory_order_relaxed); }
+  uint32_t heapCalls() const { return heapCalls_.load(std::memory_order_relaxed); }
+
+  const JsonArenaSite* next() const { return next_; }
+  static const JsonArenaSite* first();
+
+private:
+  const char* name_;
+  JsonArenaSite* next_ = nullptr;
+  std::atomic<uint32_t> calls_{0};
+  std::atomic<uint32_t> peak_{0};
+  std::atomic<uint32_t> spilledCalls_{0};
+  std::atomic<uint32_t> heapCalls_{0};
+};
+
+/** The arena JsonScope uses when it is not given one. */
+JsonArena& jsonSharedArena();
+
+/**
+ * @brief Arena memory for the documents of one request, publish or heartbeat
+ *
+ * Declare the scope before the documents that use its allocator, so they
+ * are destroyed first; the scope then records its peak against the site
+ * and rewinds the arena to where it found it. Scopes nest.
+ *
+ * The shared arena belongs to one task at a time. A scope opened while
+ * another task holds it runs on the heap instead, and is counted as such.
+ */
+class JsonScope {
+public:
+  explicit JsonScope(JsonArenaSite& site);
+  JsonScope(JsonArenaSite& site, JsonArena& arena);
+  /** An arena of its own, for work that runs off the app lock (OTA checks). */
+  JsonScope(JsonArenaSite& site, size_t capacity);
+  ~JsonScope();
+  JsonScope(const JsonScope&) = delete;
+  JsonScope& operator=(const JsonScope&) = delete;
+
+  ArduinoJson::Allocator* allocator();
+  /** Scratch memory (serializer output) that lasts until the scope ends. */
+  char* buffer(size_t size);
+
+private:
+  void open(JsonArena& arena);
+
+  JsonArenaSite& site_;
+  std::unique_ptr<JsonArena> owned_;
+  JsonArena* arena_ = nullptr;
+  bool shared_ = false;
+  size_t mark_ = 0;
+  size_t outerPeak_ = 0;
+  uint32_t spills_ = 0;
+  void* buffer_ = nullptr;
+};
+
+/**
+ * A JsonScope reported under `siteName`: on the shared arena, or on one of
+ * its own when a capacity follows.
+ */
+#define JSON_SCOPE(var, siteName, ...)          \
+  static JsonArenaSite var##Site(siteName);     \
+  JsonScope var(var##Site, ##__VA_ARGS__)
+
+/**
+ * @brief ArduinoJson writer that hands its output over in fixed pieces
+ *
+ * serializeJson(doc, writer) fills the buffer and passes it to the sink
+ * each time it is full; flush() passes on the rest. Nothing grows, so a
+ * document of any size goes out through the same few bytes.
+ */
+class JsonChunkWriter {
+public:
+  using Sink = void (*)(void* ctx, const char* data, size_t length);
+
+  JsonChunkWriter(char* buffer, size_t size, Sink sink, void* ctx)
+      : buffer_(buffer), size_(size), sink_(sink), ctx_(ctx) {}
+
+  size_t write(uint8_t c) {
+    if (length_ == size_) flush();
+    buffer_[length_++] = (char)c;
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t length) {
+    size_t left = length;
+    while (left > 0) {
+      if (length_ == size_) flush();
+      size_t n = size_ - length_;
+      if (n > left) n = left;
+      memcpy(buffer_ + length_, data, n);
+      length_ += n;
+      data += n;
+      left -= n;
+    }
+    return length;
+  }
+
+  void flush() {
+    if (length_ == 0) return;
+    sink_(ctx_, buffer_, length_);
+    flushed_ += length_;
+    length_ = 0;
+  }
+
+  /** Bytes written but not yet passed to the sink. */
+  size_t pending() const { return length_; }
+  const char* data() const { return buffer_; }
+  /** Bytes already passed to the sink. */
+  size_t flushed() const { return flushed_; }
+
+private:
+  char* buffer_;
+  size_t size_;
+  Sink sink_;
+  void* ctx_;
+  size_t length_ = 0;
+  size_t flushed_ = 0;
+};
+
+#endif // JSON_ARENA_H
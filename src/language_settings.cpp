@@ -3,6 +3,8 @@
 #include <Preferences.h>
 
 #include "log.h"
+#include "settings_store.h"
+#include "state_events.h"
 
 namespace {
 
@@ -24,6 +26,11 @@ String g_storedLanguage;
 String g_storedDialect;
 LanguageSettings::Source g_source = LanguageSettings::Source::Default;
 
+// Registered by begin(); user choices are committed with the other settings
+SettingKey g_langKey = SETTING_NONE;
+SettingKey g_dialectKey = SETTING_NONE;
+SettingKey g_sourceKey = SETTING_NONE;
+
 LanguageSettings::Source parseSource(const String& s) {
   if (s == SRC_USER) return LanguageSettings::Source::User;
   if (s == SRC_MIGRATED) return LanguageSettings::Source::Migrated;
@@ -38,6 +45,8 @@ const char* sourceKey(LanguageSettings::Source s) {
   }
 }
 
+// Only for the pin below, which runs from the settings migration before
+// begin() has registered the keys
 void writeChoice(const char* lang, const char* dialect, LanguageSettings::Source src) {
   Preferences prefs;
   prefs.begin(NS_DISPLAY, false);
@@ -87,12 +96,12 @@ bool hasPriorUseEvidence() {
 namespace LanguageSettings {
 
 void begin() {
-  Preferences prefs;
-  prefs.begin(NS_DISPLAY, true);
-  const String lang = prefs.getString(KEY_LANG, "");
-  const String dialect = prefs.getString(KEY_DIALECT, "");
-  const String src = prefs.getString(KEY_SOURCE, "");
-  prefs.end();
+  g_langKey = settingsStore.addString(NS_DISPLAY, KEY_LANG, "");
+  g_dialectKey = settingsStore.addString(NS_DISPLAY, KEY_DIALECT, "");
+  g_sourceKey = settingsStore.addString(NS_DISPLAY, KEY_SOURCE, "");
+  const String lang = settingsStore.getString(g_langKey);
+  const String dialect = settingsStore.getString(g_dialectKey);
+  const String src = settingsStore.getString(g_sourceKey);
 
   g_source = parseSource(src);
 
@@ -146,31 +155,31 @@ bool setLanguage(const char* code) {
   // must move the source off Default even though nothing visibly changes.
   const bool changing = String(code) != String(getActiveLanguage());
 
-  Preferences prefs;
-  prefs.begin(NS_DISPLAY, false);
-  prefs.putString(KEY_LANG, code);
-  prefs.putString(KEY_SOURCE, sourceKey(Source::User));
+  settingsStore.setString(g_langKey, code);
+  settingsStore.setString(g_sourceKey, sourceKey(Source::User));
   if (changing) {
     // A dialect belongs to one plate, so it does not survive a language
-    // switch. Drop it rather than leave a stale id that would warn on every
+    // switch. Clear it rather than leave a stale id that would warn on every
     // boot; the next boot falls back to the new variant's first dialect.
-    prefs.remove(KEY_DIALECT);
+    settingsStore.setString(g_dialectKey, "");
   }
-  prefs.end();
 
   if (changing) g_storedDialect = "";
   g_storedLanguage = code;
   g_source = Source::User;
   logInfo(String("🗣️ Language set to '") + code + "'" +
           (changing ? " — reboot required" : " (unchanged)"));
+  notifyStateChanged(StateChange::System);
   return true;
 }
 
 bool setDialect(const char* id) {
   if (!setActiveDialect(id)) return false;
-  writeChoice(nullptr, id, g_source);
+  settingsStore.setString(g_dialectKey, id);
+  settingsStore.setString(g_sourceKey, sourceKey(g_source));
   g_storedDialect = id;
   logInfo(String("🗣️ Dialect set to '") + id + "'");
+  notifyStateChanged(StateChange::System);
   return true;
 }
 
@@ -0,0 +1,52 @@
+#include "latency_histogram.h"
+
+#include <string.h>
+
+// Bucket b >= 4 holds [(4 + b % 4) << s, (5 + b % 4) << s) with s = b / 4 - 1
+static_assert(LatencyHistogram::kSubBuckets == 4, "bucketOf() splits by the top two bits");
+
+uint8_t LatencyHistogram::bucketOf(uint32_t us) {
+  if (us < kSubBuckets) return static_cast<uint8_t>(us);
+  uint8_t msb = static_cast<uint8_t>(31 - __builtin_clz(us));
+  uint8_t sub = static_cast<uint8_t>((us >> (msb - 2)) & 3u);
+  uint32_t bucket = (msb - 1u) * kSubBuckets + sub;
+  return bucket < kBuckets ? static_cast<uint8_t>(bucket) : kBuckets - 1;
+}
+
+uint32_t LatencyHistogram::bucketTop(uint8_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  uint8_t shift = static_cast<uint8_t>(bucket / kSubBuckets - 1);
+  uint32_t low = static_cast<uint32_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+  return low + (1u << shift) - 1;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+  counts_[bucketOf(us)]++;
+  count_++;
+  sum_ += us;
+  if (us > max_) max_ = us;
+}
+
+void LatencyHistogram::reset() {
+  memset(counts_, 0, sizeof(counts_));
+  count_ = 0;
+  max_ = 0;
+  sum_ = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint16_t permille) const {
+  if (count_ == 0) return 0;
+  if (permille > 1000) permille = 1000;
+  // Rank of the sample asked for, rounded up; at least the first one
+  uint64_t rank = (static_cast<uint64_t>(count_) * permille + 999) / 1000;
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (uint8_t b = 0; b < kBuckets; ++b) {
+    seen += counts_[b];
+    if (seen >= rank) {
+      uint32_t top = bucketTop(b);
+      return (b == kBuckets - 1 || top > max_) ? max_ : top;
+    }
+  }
+  return max_;
+}
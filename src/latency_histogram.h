@@ -0,0 +1,46 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Durations in microseconds, in a fixed set of log-linear buckets
+ *
+ * HDR-style layout: exact below 4 us, then every power of two split into
+ * four equal buckets, so a percentile read back is at most 25 % above the
+ * true value at any scale. 84 counters cover 1 us to about 4 s; longer
+ * samples land in the last bucket and still count towards maxUs().
+ *
+ * record() is a handful of instructions and never allocates. Not
+ * thread-safe; every recorder runs under the app lock (http_server.h).
+ */
+class LatencyHistogram {
+public:
+  static const uint8_t kSubBuckets = 4;  // per power of two
+  static const uint8_t kBuckets = 84;
+
+  void record(uint32_t us);
+  void reset();
+
+  uint32_t count() const { return count_; }
+  uint32_t maxUs() const { return max_; }
+  uint32_t meanUs() const { return count_ ? static_cast<uint32_t>(sum_ / count_) : 0; }
+
+  /**
+   * The value `permille`/1000 of the samples are at or below: the top of
+   * their bucket, never above maxUs(). 0 while empty.
+   */
+  uint32_t percentile(uint16_t permille) const;
+
+  static uint8_t bucketOf(uint32_t us);
+  /** Largest value that falls in `bucket`. */
+  static uint32_t bucketTop(uint8_t bucket);
+
+private:
+  uint32_t counts_[kBuckets] = {};
+  uint32_t count_ = 0;
+  uint32_t max_ = 0;
+  uint64_t sum_ = 0;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -8,6 +8,7 @@
 #endif
 
 #include "led_segments.h"
+#include "loop_profile.h"
 #include <vector>
 
 #if defined(PRODUCT_VARIANT_LOGO) && defined(LOGO_DATA_PIN)
@@ -52,6 +53,8 @@ static uint16_t g_cfgLogoCount = 0xFFFF;
 
 static bool g_ledsSuspended = false;
 
+static_assert(LED_MAX_SEGMENTS <= LOOP_SHOW_SEGMENTS, "a show() histogram per data line");
+
 #if defined(PRODUCT_VARIANT_LOGO)
 static const uint8_t DIAG_MAX = 4;
 static uint16_t g_diagIndices[DIAG_MAX] = {};
@@ -114,6 +117,14 @@ static void ensureSegments() {
   g_segmentsReady = true;
 }
 
+// Push one data line to the wire. show() holds interrupts off for ~30 us per
+// LED, so its time per line is profiled.
+static void showStrip(uint8_t s) {
+  uint32_t startUs = loopProfileNowUs();
+  g_strips[s].show();
+  loopShowRecord(s, loopProfileNowUs() - startUs);
+}
+
 // Route a logical CLOCK index to the strip that carries it (no-op if unmapped).
 static inline void clockSetPixel(uint16_t logicalIdx, uint32_t color) {
   for (uint8_t s = 0; s < g_segmentCount; ++s) {
@@ -135,7 +146,7 @@ static void clearClockStrips() {
 
 static void showClockStrips() {
   for (uint8_t s = 0; s < g_segmentCount; ++s) {
-    if (g_segments[s].source == LedBuffer::CLOCK) g_strips[s].show();
+    if (g_segments[s].source == LedBuffer::CLOCK) showStrip(s);
   }
 }
 
@@ -155,7 +166,7 @@ static void finalizeAndShow(uint8_t clockBrightness) {
 #endif
   }
   for (uint8_t s = 0; s < g_segmentCount; ++s) {
-    g_strips[s].show();
+    showStrip(s);
   }
 }
 
@@ -163,7 +174,7 @@ static void showSuspended() {
   for (uint8_t s = 0; s < g_segmentCount; ++s) {
     g_strips[s].clear();
     g_strips[s].setBrightness(0);
-    g_strips[s].show();
+    showStrip(s);
   }
 }
 
@@ -305,6 +316,10 @@ void setLedsSuspended(bool suspended) {
 }
 
 void showLeds(const std::vector<uint16_t> &ledIndices) {
+  showLeds(ledIndices.data(), ledIndices.size());
+}
+
+void showLeds(const uint16_t *ledIndices, size_t count) {
 #ifndef PIO_UNIT_TESTING
   ensureSegments();
   if (g_ledsSuspended) {
@@ -315,7 +330,8 @@ void showLeds(const std::vector<uint16_t> &ledIndices) {
   uint8_t clockBrightness = nightMode.applyToBrightness(ledState.getBrightness());
   uint8_t r, g, b, w;
   ledState.getRGBW(r, g, b, w);
-  for (uint16_t idx : ledIndices) {
+  for (size_t i = 0; i < count; ++i) {
+    uint16_t idx = ledIndices[i];
 #if defined(PRODUCT_VARIANT_LOGO)
     clockSetPixel(idx,
                   Adafruit_NeoPixel::Color(applyBrightness(r, clockBrightness),
@@ -332,7 +348,7 @@ void showLeds(const std::vector<uint16_t> &ledIndices) {
 #endif
   finalizeAndShow(clockBrightness);
 #else
-  lastShown = ledIndices;
+  lastShown.assign(ledIndices, ledIndices + count);
 #endif
 }
 
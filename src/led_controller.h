@@ -10,6 +10,7 @@
 void earlyLedClear();  // Call as early as possible in setup() to prevent garbage LED flashes
 void initLeds();
 void showLeds(const std::vector<uint16_t> &ledIndices);
+void showLeds(const uint16_t *ledIndices, size_t count);
 void showLedsColor(const std::vector<uint16_t> &ledIndices,
                    uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0);
 /** Set only the given LED indices to (r,g,b,w) and show; does not clear the strip. Use for overlaying event blink on top of the clock. */
@@ -1,7 +1,8 @@
 #ifndef LED_STATE_H
 #define LED_STATE_H
 
-#include <Preferences.h>
+#include "settings_store.h"
+#include "state_events.h"
 
 // Per-product clock-brightness cap (hardware/power limit). A product may override
 // via product_config.h to stay within its 5V budget; by default every product
@@ -18,19 +19,20 @@ public:
      * @note Call once during setup()
      */
     void begin() {
-        prefs_.begin("wc_led", false);  // Note: renamed namespace for safety
-        red_   = prefs_.getUChar("r", 0);
-        green_ = prefs_.getUChar("g", 0);
-        blue_  = prefs_.getUChar("b", 0);
-        white_ = prefs_.getUChar("w", 255);
-        brightness_ = prefs_.getUChar("br", 64);
+        // "wc_led": renamed namespace for safety
+        redKey_   = settingsStore.addU8(PREF_NAMESPACE, "r", 0);
+        greenKey_ = settingsStore.addU8(PREF_NAMESPACE, "g", 0);
+        blueKey_  = settingsStore.addU8(PREF_NAMESPACE, "b", 0);
+        whiteKey_ = settingsStore.addU8(PREF_NAMESPACE, "w", 255);
+        brightnessKey_ = settingsStore.addU8(PREF_NAMESPACE, "br", 64);
+        red_   = settingsStore.getU8(redKey_);
+        green_ = settingsStore.getU8(greenKey_);
+        blue_  = settingsStore.getU8(blueKey_);
+        white_ = settingsStore.getU8(whiteKey_);
+        brightness_ = settingsStore.getU8(brightnessKey_);
 #if MAX_BRIGHTNESS < 255
         if (brightness_ > MAX_BRIGHTNESS) brightness_ = MAX_BRIGHTNESS;  // clamp stale NVS to the cap
 #endif
-        prefs_.end();
-        
-        dirty_ = false;
-        lastFlush_ = millis();
     }
 
     /**
@@ -89,32 +91,15 @@ public:
 
     /**
      * @brief Force immediate write to persistent storage
-     * @note Call before critical operations (OTA, deep sleep, restart)
+     * @note Commits every pending setting, not only these (settings_store.h)
      */
-    void flush() {
-        if (!dirty_) return;
-        
-        prefs_.begin("wc_led", false);
-        prefs_.putUChar("r", red_);
-        prefs_.putUChar("g", green_);
-        prefs_.putUChar("b", blue_);
-        prefs_.putUChar("w", white_);
-        prefs_.putUChar("br", brightness_);
-        prefs_.end();
-        
-        dirty_ = false;
-        lastFlush_ = millis();
-    }
+    void flush() { settingsStore.commit(); }
 
     /**
-     * @brief Automatic flush if dirty and sufficient time passed
-     * @note Call periodically from main loop (every 1-5 seconds)
+     * @brief Automatic flush once the oldest unsaved change is old enough
+     * @note Same as settingsStore.loop(); the runtime calls that directly
      */
-    void loop() {
-        if (dirty_ && (millis() - lastFlush_) >= AUTO_FLUSH_DELAY_MS) {
-            flush();
-        }
-    }
+    void loop() { settingsStore.loop(millis()); }
 
     // Getters (unchanged)
     uint8_t getBrightness() const { return brightness_; }
@@ -122,28 +107,30 @@ public:
         r = red_; g = green_; b = blue_; w = white_;
     }
     
-    // New: Query persistence state
-    bool isDirty() const { return dirty_; }
+    // Query persistence state
+    bool isDirty() const { return settingsStore.pending(PREF_NAMESPACE); }
     unsigned long millisSinceLastFlush() const { 
-        return millis() - lastFlush_; 
+        return millis() - settingsStore.pendingSinceMs(); 
     }
 
 private:
+    static constexpr const char* PREF_NAMESPACE = "wc_led";
+
     void markDirty() {
-        if (!dirty_) {
-            dirty_ = true;
-            lastFlush_ = millis();  // Track when change occurred
-        }
+        // Only the values that differ from the store's shadow become pending
+        settingsStore.setU8(redKey_, red_);
+        settingsStore.setU8(greenKey_, green_);
+        settingsStore.setU8(blueKey_, blue_);
+        settingsStore.setU8(whiteKey_, white_);
+        settingsStore.setU8(brightnessKey_, brightness_);
+        notifyStateChanged(StateChange::Light);
     }
 
     uint8_t red_ = 0, green_ = 0, blue_ = 0, white_ = 255;
     uint8_t brightness_ = 64;
-    bool dirty_ = false;
-    unsigned long lastFlush_ = 0;
-    
-    Preferences prefs_;
-    
-    static const unsigned long AUTO_FLUSH_DELAY_MS = 5000;  // 5 seconds
+
+    SettingKey redKey_ = SETTING_NONE, greenKey_ = SETTING_NONE, blueKey_ = SETTING_NONE;
+    SettingKey whiteKey_ = SETTING_NONE, brightnessKey_ = SETTING_NONE;
 };
 
 extern LedState ledState;
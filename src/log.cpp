@@ -7,6 +7,9 @@ LogLevel LOG_LEVEL = DEFAULT_LOG_LEVEL;
 void log(String, int) {}
 
 void logln(String, int) {}
+void logln(const char*, int) {}
+
+void logPrintf(int, const char*, ...) {}
 
 void setLogLevel(LogLevel level) {
   LOG_LEVEL = level;
@@ -18,144 +21,194 @@ void logEnableFileSink() {}
 
 void logFlushFile() {}
 
-String logLatestFilePath() {
-  return String();
+void logClearFiles() {}
+
+size_t logQuery(uint32_t, uint32_t, uint8_t, LogLineFn, void*) {
+  return 0;
+}
+
+size_t logReadUnsynced(LogLineFn, void*) {
+  return 0;
+}
+
+size_t logQueryMore(LogCursor&, LogLineFn, void*, size_t) {
+  return 0;
+}
+
+size_t logReadUnsyncedAt(uint32_t, uint8_t*, size_t) {
+  return 0;
+}
+
+size_t logListDays(LogDayFn, void*) {
+  return 0;
+}
+
+LogStoreStats logStoreStats() {
+  return LogStoreStats{};
+}
+
+uint32_t logCursor() {
+  return 0;
+}
+
+uint32_t logReadSince(uint32_t cursor, LogLineFn, void*) {
+  return cursor;
 }
 
 void logRewriteUnsynced() {}
 
+LogSinkStats logSinkStats() {
+  return LogSinkStats{};
+}
+
+String logRecentText() {
+  return String();
+}
+
 #else
 
-#include <Preferences.h>
 #include <time.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include "fs_compat.h"
+#include "heap_tracker.h"
+#include "log_ring.h"
+#include "mem_pool.h"
+#include "log_rewriter.h"
+#include "log_sink.h"
+#include "settings_store.h"
 
 LogLevel LOG_LEVEL = DEFAULT_LOG_LEVEL;
 
-String logBuffer[LOG_BUFFER_SIZE];
-int logIndex = 0;
+// Records live here unformatted; /log and the file sink format on the way out.
+// Boot messages go to a small static block; initLogSettings() moves the ring
+// into the Bulk pool (PSRAM) at its full size.
+alignas(8) static uint8_t logBootArena[LOG_BOOT_RECORDS * LOG_RECORD_SIZE];
+static LogRing logRing(logBootArena, sizeof(logBootArena));
+static LogFileSink fileSink(logRing);
+
+// The sink task owns the file writes. fileMutex also covers the callers that
+// read, rewrite or clear logStore from other tasks (web handlers).
+static SemaphoreHandle_t fileMutex = nullptr;
+static SemaphoreHandle_t flushDone = nullptr;
+static TaskHandle_t sinkTask = nullptr;
+static std::atomic<bool> flushRequested{false};
+static const uint32_t LOG_FLUSH_WAIT_MS = 1000;
 
 static bool fileSinkEnabled = false;
-static File logFile;
-static String currentLogTag;
-static unsigned long lastFlushMs = 0;
-static const unsigned long LOG_FLUSH_INTERVAL_MS = 5000;
+static LogStore logStore(FS_IMPL);
+static UnsyncedLogRewriter unsyncedRewriter;
 static uint32_t LOG_RETENTION_DAYS = 1;
 static bool LOG_DELETE_ON_BOOT = true;
 
-static void closeLogFile() {
-  if (logFile) {
-    logFile.flush();
-    logFile.close();
-  }
+static bool timeIsSynced(time_t now) {
+  // Consider time unsynced if before 2022-01-01
+  return now >= 1640995200;
 }
 
-static String determineLogTag() {
-  time_t now = time(nullptr);
-  if (now < 1640995200) {
-    return String("unsynced");
-  }
-  struct tm lt = {};
-  localtime_r(&now, &lt);
-  char buf[16];
-  strftime(buf, sizeof(buf), "%Y-%m-%d", &lt);
-  return String(buf);
+static void lockFile() {
+  if (fileMutex) xSemaphoreTake(fileMutex, portMAX_DELAY);
 }
 
-static void ensureLogDirectory() {
-  if (!FS_IMPL.exists("/logs")) {
-    FS_IMPL.mkdir("/logs");
-  }
+static void unlockFile() {
+  if (fileMutex) xSemaphoreGive(fileMutex);
 }
 
-static void ensureLogFile() {
-  if (!fileSinkEnabled) return;
-  String tag = determineLogTag();
-  if (tag.length() == 0) return;
-  if (!logFile || tag != currentLogTag) {
-    closeLogFile();
-    ensureLogDirectory();
-    // Cleanup old logs before opening new file
-    File dir = FS_IMPL.open("/logs");
-    if (dir) {
-      time_t now = time(nullptr);
-      const time_t cutoff = (LOG_RETENTION_DAYS > 0) ? now - (LOG_RETENTION_DAYS * 86400UL) : 0;
-      while (true) {
-        File entry = dir.openNextFile();
-        if (!entry) break;
-        if (!entry.isDirectory()) {
-          String name = entry.name();
-          if (name.startsWith("/")) name = name.substring(1);
-          if (name.startsWith("logs/")) name = name.substring(5);
-          bool removeFile = false;
-          if (name.startsWith("unsynced")) {
-            // Remove unsynced logs older than 1 day
-            if (entry.getLastWrite() > 0 && now >= 86400UL && (now - entry.getLastWrite()) > 86400UL) {
-              removeFile = true;
-            }
-          } else if (cutoff > 0 && entry.getLastWrite() > 0) {
-            if (entry.getLastWrite() < cutoff) {
-              removeFile = true;
-            }
-          }
-          if (removeFile) {
-            String full = entry.name();
-            entry.close();
-            FS_IMPL.remove(full);
-            continue;
-          }
-        }
-        entry.close();
-      }
-      dir.close();
+static void drainToFile(bool flush) {
+  HeapTagScope heapTag(HeapTag::Log);
+  lockFile();
+  if (fileSinkEnabled && (fileSink.pending() || flush)) {
+    fileSink.drain(logStore, flush, millis());
+    time_t now = time(nullptr);
+    if (timeIsSynced(now)) {
+      logStore.enforceRetention((uint32_t)now, LOG_RETENTION_DAYS);
     }
-    String path = String("/logs/") + tag + ".log";
-    logFile = FS_IMPL.open(path, "a");
-    if (!logFile) {
-#ifdef ENABLE_DEBUG_LOGGING
-      Serial.println("[log] Failed to open log file for writing: " + path);
-#endif
-      fileSinkEnabled = false;
-      return;
+  }
+  unlockFile();
+}
+
+// One bounded step of moving unsynced.log into the store once the clock is
+// set. The mutex is released between steps, so web handlers and the drain
+// get in; a segment that takes both new and converted lines is marked
+// unordered and queried by full scan.
+static bool rewriteStep() {
+  bool more = false;
+  lockFile();
+  if (unsyncedRewriter.active()) {
+    UnsyncedLogRewriter::Step st = unsyncedRewriter.step(logStore, LOG_REWRITE_LINES_PER_STEP);
+    if (st.done) {
+      logStore.flush();
+      logStore.removeUnsynced();
+    } else {
+      more = true;
     }
-    currentLogTag = tag;
-    // Truncate overly large log directory by deleting files older than 7 days
   }
+  unlockFile();
+  return more;
 }
 
-static inline const char* levelToTag(int level) {
-  switch (level) {
-    case LOG_LEVEL_DEBUG: return "DEBUG";
-    case LOG_LEVEL_INFO:  return "INFO";
-    case LOG_LEVEL_WARN:  return "WARN";
-    case LOG_LEVEL_ERROR: return "ERROR";
-    default:              return "INFO";
+// Low priority: wakes on its interval, when log() sees the backlog reach
+// half the ring, or when logFlushFile() asks. Flash writes stay off the
+// loop task. While an unsynced rewrite is pending it runs a step per tick.
+static void sinkTaskFn(void*) {
+  TickType_t wait = pdMS_TO_TICKS(LOG_SINK_INTERVAL_MS);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, wait);
+    bool flush = flushRequested.exchange(false);
+    drainToFile(flush);
+    if (flush) xSemaphoreGive(flushDone);
+    wait = rewriteStep() ? 1 : pdMS_TO_TICKS(LOG_SINK_INTERVAL_MS);
   }
 }
 
-static String makeLogPrefix(int level) {
-  // Prefer localtime_r with TZ applied; fall back to uptime if RTC not set yet
-  time_t now = time(nullptr);
-  // Consider time unsynced if before 2022-01-01
-  if (now < 1640995200) {
-    unsigned long nowMs = millis();
-    char out[64];
-    snprintf(out, sizeof(out), "[uptime %lu.%03lus][%s] ", nowMs/1000UL, nowMs%1000UL, levelToTag(level));
-    return String(out);
+static void startSinkTask() {
+  if (sinkTask) return;
+  if (!fileMutex) fileMutex = xSemaphoreCreateMutex();
+  if (!flushDone) flushDone = xSemaphoreCreateBinary();
+  if (!fileMutex || !flushDone) return;
+  BaseType_t ok = xTaskCreatePinnedToCore(
+    sinkTaskFn,
+    "logSink",
+    4096,
+    nullptr,
+    1,
+    &sinkTask,
+    tskNO_AFFINITY
+  );
+  if (ok != pdPASS) {
+    sinkTask = nullptr;
+#ifdef ENABLE_DEBUG_LOGGING
+    Serial.println("[log] Failed to start log sink task; writing from logFlushFile() only");
+#endif
   }
+}
 
-  struct tm lt = {};
-  localtime_r(&now, &lt);
-  char datebuf[32];
-  char tzbuf[8];
-  strftime(datebuf, sizeof(datebuf), "%Y-%m-%d %H:%M:%S", &lt);
-  strftime(tzbuf, sizeof(tzbuf), "%Z", &lt);
-  unsigned long ms = millis() % 1000UL;
-  char out[80];
-  // Format: [YYYY-MM-DD HH:MM:SS.mmm TZ][LEVEL]
-  snprintf(out, sizeof(out), "[%s.%03lu %s][%s] ", datebuf, ms, tzbuf, levelToTag(level));
-  return String(out);
+static void logWrite(int level, const char* text, size_t length) {
+  HeapTagScope heapTag(HeapTag::Log);
+  int64_t uptimeUs = esp_timer_get_time();
+  time_t now = time(nullptr);
+  uint32_t epoch = timeIsSynced(now) ? (uint32_t)now : 0;
+  uint32_t seq = logRing.append((uint8_t)level, uptimeUs, epoch, text, length);
+
+#ifdef ENABLE_DEBUG_LOGGING
+  LogRecord rec = {seq, uptimeUs, epoch, (uint8_t)level, false, text, length};
+  char prefix[96];
+  logFormatPrefix(rec, prefix, sizeof(prefix));
+  Serial.print(prefix);
+  Serial.write(reinterpret_cast<const uint8_t*>(text), length);
+#else
+  (void)seq;
+#endif
+
+  // Wake the sink early rather than let a burst lap it
+  if (sinkTask && fileSink.backlog() >= logRing.capacity() / 2) {
+    xTaskNotifyGive(sinkTask);
+  }
 }
 
 void log(String msg, int level) {
@@ -166,49 +219,96 @@ void log(String msg, int level) {
   //   telnetClient.print(msg);
   // }
 
-  String line = makeLogPrefix(level) + msg;
-#ifdef ENABLE_DEBUG_LOGGING
-  Serial.print(line);
-#endif
+  logWrite(level, msg.c_str(), msg.length());
+}
 
-  if (fileSinkEnabled) {
-    ensureLogFile();
-    if (logFile) {
-      logFile.print(line);
-      unsigned long now = millis();
-      if (lastFlushMs == 0 || (now - lastFlushMs) >= LOG_FLUSH_INTERVAL_MS || line.endsWith("\n")) {
-        logFile.flush();
-        lastFlushMs = now;
-      }
-    }
-  }
+void logPrintf(int level, const char* fmt, ...) {
+  if (level < LOG_LEVEL) return;
+  // Anything longer than a ring record would be truncated there anyway
+  char buf[LOG_RECORD_SIZE];
+  size_t cap = LogRing::textCapacity();
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, cap, fmt, args);
+  va_end(args);
+  if (n < 0) return;
+  size_t len = (size_t)n < cap - 1 ? (size_t)n : cap - 1;
+  buf[len++] = '\n';
+  logWrite(level, buf, len);
+}
+
+LogSinkStats logSinkStats() {
+  LogSinkStats st;
+  st.written = fileSink.writtenCount();
+  st.dropped = fileSink.droppedCount();
+  st.batches = logStore.batchCount();
+  st.flushes = fileSink.flushCount();
+  st.backlog = fileSink.backlog();
+  return st;
+}
+
+String logRecentText() {
+  String out;
+  out.reserve(logRing.capacity() * 96);
+  char prefix[96];
+  logRing.forEach(logRing.tail(), [&](const LogRecord& rec) {
+    logFormatPrefix(rec, prefix, sizeof(prefix));
+    out += prefix;
+    out.concat(rec.text, rec.length);
+    if (rec.length == 0 || rec.text[rec.length - 1] != '\n') out += "\n";
+  });
+  return out;
+}
+
+uint32_t logCursor() {
+  return logRing.head();
+}
 
-  // Store in ring buffer any message that passes the filter
-  logBuffer[logIndex] = line;
-  logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
+uint32_t logReadSince(uint32_t cursor, LogLineFn fn, void* ctx) {
+  char line[96 + LOG_RECORD_SIZE];
+  return logRing.forEach(cursor, [&](const LogRecord& rec) {
+    size_t n = logFormatPrefix(rec, line, 96);
+    memcpy(line + n, rec.text, rec.length);
+    n += rec.length;
+    if (rec.length == 0 || rec.text[rec.length - 1] != '\n') line[n++] = '\n';
+    fn(ctx, line, n);
+  });
 }
 
 void logln(String msg, int level) {
-  log(msg + "\n", level);
+  logln(msg.c_str(), level);
 }
 
+void logln(const char* msg, int level) {
+  if (level < LOG_LEVEL) return;
+  size_t len = strlen(msg);
+  if (len >= LogRing::textCapacity()) {
+    // The ring cuts it and marks it truncated; readers add the newline
+    logWrite(level, msg, len);
+    return;
+  }
+  // The newline goes on in a stack copy instead of growing a String
+  char buf[LOG_RECORD_SIZE];
+  memcpy(buf, msg, len);
+  buf[len++] = '\n';
+  logWrite(level, buf, len);
+}
+
+// Registered by initLogSettings(); committed with the other settings
+static SettingKey logLevelKey = SETTING_NONE;
+static SettingKey logRetentionKey = SETTING_NONE;
+static SettingKey logDeleteOnBootKey = SETTING_NONE;
+
 void setLogLevel(LogLevel level) {
   LOG_LEVEL = level;
-  // Persist new level
-  Preferences prefs;
-  prefs.begin("wc_log", false);
-  prefs.putUChar("level", (uint8_t)level);
-  prefs.end();
+  settingsStore.setU8(logLevelKey, (uint8_t)level);
 }
 
 void setLogRetentionDays(uint32_t days) {
   if (days < 1) days = 1;
   if (days > 10) days = 10;
   LOG_RETENTION_DAYS = days;
-  Preferences prefs;
-  prefs.begin("wc_log", false);
-  prefs.putUInt("retention", days);
-  prefs.end();
+  settingsStore.setU32(logRetentionKey, days);
 }
 
 uint32_t getLogRetentionDays() {
@@ -217,10 +317,7 @@ uint32_t getLogRetentionDays() {
 
 void setLogDeleteOnBoot(bool enabled) {
   LOG_DELETE_ON_BOOT = enabled;
-  Preferences prefs;
-  prefs.begin("wc_log", false);
-  prefs.putBool("delOnBoot", enabled);
-  prefs.end();
+  settingsStore.setBool(logDeleteOnBootKey, enabled);
 }
 
 bool getLogDeleteOnBoot() {
@@ -228,13 +325,22 @@ bool getLogDeleteOnBoot() {
 }
 
 void initLogSettings() {
+  // Nothing else logs yet, so the ring can change blocks. Kept for the
+  // lifetime of the firmware; never freed.
+  static void* ringBlock = nullptr;
+  if (!ringBlock) {
+    const size_t bytes = LOG_BUFFER_SIZE * LOG_RECORD_SIZE;
+    ringBlock = poolAlloc(MemPool::Bulk, bytes);
+    if (ringBlock) logRing.moveTo(ringBlock, bytes);
+  }
+
   // Load persisted settings if available
-  Preferences prefs;
-  prefs.begin("wc_log", true);
-  uint8_t lvl = prefs.getUChar("level", (uint8_t)DEFAULT_LOG_LEVEL);
-  LOG_RETENTION_DAYS = prefs.getUInt("retention", 1);
-  LOG_DELETE_ON_BOOT = prefs.getBool("delOnBoot", true);
-  prefs.end();
+  logLevelKey = settingsStore.addU8("wc_log", "level", (uint8_t)DEFAULT_LOG_LEVEL);
+  logRetentionKey = settingsStore.addU32("wc_log", "retention", 1);
+  logDeleteOnBootKey = settingsStore.addBool("wc_log", "delOnBoot", true);
+  uint8_t lvl = settingsStore.getU8(logLevelKey);
+  LOG_RETENTION_DAYS = settingsStore.getU32(logRetentionKey);
+  LOG_DELETE_ON_BOOT = settingsStore.getBool(logDeleteOnBootKey);
 
   if (lvl <= LOG_LEVEL_ERROR) {
     LOG_LEVEL = (LogLevel)lvl;
@@ -265,131 +371,125 @@ static void wipeLogsDirectory() {
 }
 
 void logEnableFileSink() {
+  startSinkTask();
+  lockFile();
   if (LOG_DELETE_ON_BOOT) {
     wipeLogsDirectory();
 #ifdef ENABLE_DEBUG_LOGGING
     Serial.println("[log] Deleted all logs on boot as per settings.");
 #endif
   }
+  // Segments rotate under LOG_STORE_QUOTA_BYTES, so /logs can no longer
+  // fill the partition and needs no low-space wipe here.
+  logStore.begin();
+  fileSinkEnabled = true;
+  unlockFile();
+}
 
-  // Low-space recovery: if the filesystem is nearly full (e.g. wordclock-mini's
-  // 1.25 MB partition has filled with old logs because delete-on-boot was off),
-  // wipe /logs unconditionally so the device can recover on its own.
-  bool recoveredFromLowSpace = false;
-  size_t total = FS_IMPL.totalBytes();
-  size_t used = FS_IMPL.usedBytes();
-  if (total > 0 && (total - used) < (64UL * 1024UL)) {
-    wipeLogsDirectory();
-    recoveredFromLowSpace = true;
+void logCloseFile() {
+  lockFile();
+  logStore.close();
+  unlockFile();
+}
+
+void logClearFiles() {
+  lockFile();
+  unsyncedRewriter.cancel();
+  logStore.clear();
+  unlockFile();
+}
+
+// Hand the flush to the sink task and wait for it, so callers that read the
+// files afterwards see everything logged so far.
+void logFlushFile() {
+  if (!sinkTask || xTaskGetCurrentTaskHandle() == sinkTask) {
+    drainToFile(true);
+    return;
+  }
+  xSemaphoreTake(flushDone, 0);  // drop a completion nobody waited for
+  flushRequested = true;
+  xTaskNotifyGive(sinkTask);
+  if (xSemaphoreTake(flushDone, pdMS_TO_TICKS(LOG_FLUSH_WAIT_MS)) != pdTRUE) {
 #ifdef ENABLE_DEBUG_LOGGING
-    Serial.printf("[log] Low filesystem space (%u/%u bytes used); wiped /logs to recover.\n",
-                  (unsigned)used, (unsigned)total);
+    Serial.println("[log] Timed out waiting for the log sink to flush");
 #endif
   }
+}
 
-  fileSinkEnabled = true;
-  currentLogTag = "";
-  ensureLogFile();
-  if (recoveredFromLowSpace) {
-    logWarn("/logs wiped: filesystem was nearly full");
-  }
+// Readers hold the mutex while they stream, so the sink waits for them; the
+// ring absorbs what is logged meanwhile.
+size_t logQuery(uint32_t from, uint32_t to, uint8_t minLevel, LogLineFn fn, void* ctx) {
+  LogQuery q;
+  q.from = from;
+  q.to = to;
+  q.minLevel = minLevel;
+  lockFile();
+  size_t n = logStore.query(q, fn, ctx);
+  unlockFile();
+  return n;
 }
 
-void logCloseFile() {
-  closeLogFile();
+size_t logReadUnsynced(LogLineFn fn, void* ctx) {
+  lockFile();
+  size_t n = logStore.readUnsynced(fn, ctx);
+  unlockFile();
+  return n;
 }
 
-void logFlushFile() {
-  if (logFile) {
-    logFile.flush();
-    lastFlushMs = millis();
-  }
+size_t logQueryMore(LogCursor& cursor, LogLineFn fn, void* ctx, size_t maxBytes) {
+  lockFile();
+  size_t n = logStore.queryMore(cursor, fn, ctx, maxBytes);
+  unlockFile();
+  return n;
 }
 
-String logLatestFilePath() {
-  ensureLogFile();
-  if (!FS_IMPL.exists("/logs")) return "";
-  File dir = FS_IMPL.open("/logs");
-  if (!dir) return "";
-  String latest = "";
-  while (true) {
-    File entry = dir.openNextFile();
-    if (!entry) break;
-    if (!entry.isDirectory()) {
-      String name = entry.name();
-      if (name.length()) {
-        if (latest.length() == 0 || name.compareTo(latest) > 0) {
-          latest = name;
-        }
-      }
-    }
-    entry.close();
-  }
-  dir.close();
-  return latest;
+size_t logReadUnsyncedAt(uint32_t offset, uint8_t* buffer, size_t length) {
+  lockFile();
+  size_t n = logStore.readUnsynced(offset, buffer, length);
+  unlockFile();
+  return n;
+}
+
+size_t logListDays(LogDayFn fn, void* ctx) {
+  lockFile();
+  size_t n = logStore.forEachDay(fn, ctx);
+  unlockFile();
+  return n;
+}
+
+LogStoreStats logStoreStats() {
+  LogStoreStats st;
+  lockFile();
+  st.segments = logStore.segmentCount();
+  st.bytes = logStore.totalBytes();
+  st.unsyncedBytes = logStore.unsyncedBytes();
+  st.segmentsRemoved = logStore.segmentsRemoved();
+  unlockFile();
+  st.quotaBytes = LOG_STORE_QUOTA_BYTES;
+  return st;
 }
 
-// Rewrites unsynced (uptime-based) logs into a dated log once time is synced.
 void logRewriteUnsynced() {
-  const char* UNSYNCED = "/logs/unsynced.log";
   time_t now = time(nullptr);
   // Only run if time is valid and the unsynced log exists
-  if (now < 1640995200) return;
-  if (!FS_IMPL.exists(UNSYNCED)) return;
-
-  File in = FS_IMPL.open(UNSYNCED, "r");
-  if (!in) return;
-
-  String outPath = String("/logs/") + determineLogTag() + String(".log");
-  File out = FS_IMPL.open(outPath, "a");
-  if (!out) {
-    in.close();
-    return;
-  }
-
-  // Approximate boot epoch from current epoch minus uptime (millis)
-  uint64_t nowMs = millis();
-  uint64_t nowEpochMs = ((uint64_t)now) * 1000ULL;
-  uint64_t bootEpochMs = (nowEpochMs > nowMs) ? (nowEpochMs - nowMs) : 0;
-
-  bool converted = false;
-  while (in.available()) {
-    String line = in.readStringUntil('\n');
-    if (line.length() == 0) continue;
-    // Expected prefix: [uptime %lu.%03lus][LEVEL] ...
-    int upPos = line.indexOf("[uptime ");
-    if (upPos != 0) continue;
-    int dotPos = line.indexOf('.', upPos + 8);
-    int sPos = line.indexOf("s][", dotPos);
-    if (dotPos < 0 || sPos < 0) continue;
-    int lvlStart = sPos + 3;
-    int lvlEnd = line.indexOf(']', lvlStart);
-    if (lvlEnd < 0) continue;
-    String secStr = line.substring(upPos + 8, dotPos);
-    String msStr = line.substring(dotPos + 1, sPos);
-    String lvlStr = line.substring(lvlStart, lvlEnd);
-    String msg = line.substring(lvlEnd + 2); // skip "] "
-    uint64_t upSec = (uint64_t)secStr.toInt();
-    uint64_t upMs = (uint64_t)msStr.toInt();
-    uint64_t lineMs = bootEpochMs + (upSec * 1000ULL) + upMs;
-    time_t lineSec = (time_t)(lineMs / 1000ULL);
-    uint16_t lineMsPart = (uint16_t)(lineMs % 1000ULL);
-    struct tm lt = {};
-    localtime_r(&lineSec, &lt);
-    char datebuf[32];
-    char tzbuf[8];
-    strftime(datebuf, sizeof(datebuf), "%Y-%m-%d %H:%M:%S", &lt);
-    strftime(tzbuf, sizeof(tzbuf), "%Z", &lt);
-    char prefix[96];
-    snprintf(prefix, sizeof(prefix), "[%s.%03u %s][%s] ", datebuf, (unsigned)lineMsPart, tzbuf, lvlStr.c_str());
-    out.print(prefix);
-    out.println(msg);
-    converted = true;
+  if (!timeIsSynced(now)) return;
+  // Every record stamped before the sync has to be in the file first
+  logFlushFile();
+  lockFile();
+  if (!unsyncedRewriter.active() && FS_IMPL.exists(LogStore::kUnsyncedPath)) {
+    logStore.flush();
+    // Approximate boot epoch from current epoch minus uptime (millis)
+    uint64_t nowMs = millis();
+    uint64_t nowEpochMs = ((uint64_t)now) * 1000ULL;
+    uint64_t bootEpochMs = (nowEpochMs > nowMs) ? (nowEpochMs - nowMs) : 0;
+    unsyncedRewriter.begin(FS_IMPL, LogStore::kUnsyncedPath, bootEpochMs);
   }
-  out.flush();
-  in.close();
-  if (converted) {
-    FS_IMPL.remove(UNSYNCED);
+  unlockFile();
+  if (sinkTask) {
+    xTaskNotifyGive(sinkTask);
+  } else {
+    while (rewriteStep()) {
+    }
   }
 }
 
@@ -17,12 +17,27 @@ extern LogLevel LOG_LEVEL;
 // Basic log function
 void log(String msg, int level = LOG_LEVEL_INFO);
 void logln(String msg, int level = LOG_LEVEL_INFO);
+// Literals and FixedString::c_str() go through here and never become a String
+void logln(const char* msg, int level = LOG_LEVEL_INFO);
+
+// printf-style line (newline appended); formats on the stack, no String
+void logPrintf(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// True when a message at this level is kept. The convenience macros test it
+// before evaluating their arguments, so a filtered call builds no String;
+// levels below LOG_COMPILE_MIN_LEVEL fold to false and are removed entirely.
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_MIN_LEVEL && (level) >= LOG_LEVEL)
 
 // Convenience functions
-#define logDebug(msg) logln(msg, LOG_LEVEL_DEBUG)
-#define logInfo(msg)  logln(msg, LOG_LEVEL_INFO)
-#define logWarn(msg)  logln(msg, LOG_LEVEL_WARN)
-#define logError(msg) logln(msg, LOG_LEVEL_ERROR)
+#define logDebug(msg) (LOG_ENABLED(LOG_LEVEL_DEBUG) ? logln(msg, LOG_LEVEL_DEBUG) : (void)0)
+#define logInfo(msg)  (LOG_ENABLED(LOG_LEVEL_INFO) ? logln(msg, LOG_LEVEL_INFO) : (void)0)
+#define logWarn(msg)  (LOG_ENABLED(LOG_LEVEL_WARN) ? logln(msg, LOG_LEVEL_WARN) : (void)0)
+#define logError(msg) (LOG_ENABLED(LOG_LEVEL_ERROR) ? logln(msg, LOG_LEVEL_ERROR) : (void)0)
+
+#define logDebugf(...) (LOG_ENABLED(LOG_LEVEL_DEBUG) ? logPrintf(LOG_LEVEL_DEBUG, __VA_ARGS__) : (void)0)
+#define logInfof(...)  (LOG_ENABLED(LOG_LEVEL_INFO) ? logPrintf(LOG_LEVEL_INFO, __VA_ARGS__) : (void)0)
+#define logWarnf(...)  (LOG_ENABLED(LOG_LEVEL_WARN) ? logPrintf(LOG_LEVEL_WARN, __VA_ARGS__) : (void)0)
+#define logErrorf(...) (LOG_ENABLED(LOG_LEVEL_ERROR) ? logPrintf(LOG_LEVEL_ERROR, __VA_ARGS__) : (void)0)
 
 void setLogLevel(LogLevel level);
 
@@ -39,5 +54,46 @@ void initLogSettings();
 void logEnableFileSink();
 void logCloseFile();
 void logFlushFile();
-String logLatestFilePath();
+
+struct LogSinkStats {
+  uint32_t written;   // records that reached the file
+  uint32_t dropped;   // records lapped in the ring before the sink got to them
+  uint32_t batches;   // write() calls
+  uint32_t flushes;
+  uint32_t backlog;   // records waiting right now
+};
+LogSinkStats logSinkStats();
+// Formatted contents of the in-memory ring, oldest first
+String logRecentText();
 void logRewriteUnsynced();
+
+// Stored lines (segmented store under /logs); see log_store.h
+typedef void (*LogLineFn)(void* ctx, const char* data, size_t length);
+typedef void (*LogDayFn)(void* ctx, const char* date, uint32_t bytes);
+// Lines with from <= time <= to (epoch seconds) and level >= minLevel, oldest first
+size_t logQuery(uint32_t from, uint32_t to, uint8_t minLevel, LogLineFn fn, void* ctx);
+// Raw contents of the pre-sync file, in chunks
+size_t logReadUnsynced(LogLineFn fn, void* ctx);
+// The same a piece at a time, for downloads that go at the client's pace
+// and hold the file mutex only while a piece is read (see log_store.h)
+struct LogCursor;
+size_t logQueryMore(LogCursor& cursor, LogLineFn fn, void* ctx, size_t maxBytes);
+size_t logReadUnsyncedAt(uint32_t offset, uint8_t* buffer, size_t length);
+// Local dates with stored lines, newest first, with approximate sizes
+size_t logListDays(LogDayFn fn, void* ctx);
+void logClearFiles();
+
+// Follow the in-memory ring: logCursor() is where the next record will go;
+// logReadSince() hands each formatted line from cursor on (newline included,
+// records already overwritten skipped) to fn and returns the new cursor.
+uint32_t logCursor();
+uint32_t logReadSince(uint32_t cursor, LogLineFn fn, void* ctx);
+
+struct LogStoreStats {
+  uint32_t segments;
+  uint32_t bytes;            // across all segments
+  uint32_t quotaBytes;
+  uint32_t unsyncedBytes;
+  uint32_t segmentsRemoved;  // by quota or retention since boot
+};
+LogStoreStats logStoreStats();
@@ -0,0 +1,166 @@
+#include "log_rewriter.h"
+
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+const char kUptimeTag[] = "[uptime ";
+const size_t kUptimeTagLen = sizeof(kUptimeTag) - 1;
+
+// Digits at p (up to end) into v; returns the first non-digit
+const char* parseDigits(const char* p, const char* end, uint64_t& v) {
+  v = 0;
+  const char* start = p;
+  while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (uint64_t)(*p++ - '0');
+  return p == start ? nullptr : p;
+}
+
+uint8_t levelFromTag(const char* tag, size_t len) {
+  if (len == 5 && memcmp(tag, "DEBUG", 5) == 0) return 0;
+  if (len == 4 && memcmp(tag, "WARN", 4) == 0) return 2;
+  if (len == 5 && memcmp(tag, "ERROR", 5) == 0) return 3;
+  return 1;
+}
+
+}  // namespace
+
+bool UnsyncedLogRewriter::begin(fs::FS& fs, const char* path, uint64_t bootEpochMs) {
+  cancel();
+  in_ = fs.open(path, FILE_READ);
+  if (!in_) return false;
+  active_ = true;
+  eof_ = false;
+  bootEpochMs_ = bootEpochMs;
+  have_ = 0;
+  at_ = 0;
+  lastEpoch_ = (uint32_t)(bootEpochMs / 1000ULL);
+  lastLevel_ = 1;
+  converted_ = 0;
+  cachedMinute_ = UINT32_MAX;
+  return true;
+}
+
+void UnsyncedLogRewriter::cancel() {
+  if (in_) in_.close();
+  active_ = false;
+}
+
+bool UnsyncedLogRewriter::nextLine(const char*& line, size_t& length) {
+  while (true) {
+    const char* start = buf_ + at_;
+    const char* nl = (const char*)memchr(start, '\n', have_ - at_);
+    if (nl) {
+      line = start;
+      length = (size_t)(nl - start) + 1;
+      at_ += length;
+      return true;
+    }
+    if (eof_ || (at_ == 0 && have_ == sizeof(buf_))) {
+      // Last line without a newline, or one longer than the buffer
+      if (at_ == have_) return false;
+      line = start;
+      length = have_ - at_;
+      at_ = have_;
+      return true;
+    }
+    memmove(buf_, start, have_ - at_);
+    have_ -= at_;
+    at_ = 0;
+    size_t n = in_.read(reinterpret_cast<uint8_t*>(buf_ + have_), sizeof(buf_) - have_);
+    if (n == 0) eof_ = true;
+    have_ += n;
+  }
+}
+
+size_t UnsyncedLogRewriter::formatPrefix(uint64_t epochMs, const char* level, size_t levelLen, char* out) {
+  uint32_t sec = (uint32_t)(epochMs / 1000ULL);
+  uint32_t ms = (uint32_t)(epochMs % 1000ULL);
+  // Zone offsets and DST changes fall on whole minutes
+  uint32_t minute = sec / 60;
+  if (minute != cachedMinute_) {
+    time_t t = (time_t)minute * 60;
+    struct tm lt = {};
+    localtime_r(&t, &lt);
+    strftime(minuteStr_, sizeof(minuteStr_), "%Y-%m-%d %H:%M:", &lt);
+    strftime(tzStr_, sizeof(tzStr_), "%Z", &lt);
+    cachedMinute_ = minute;
+  }
+  uint32_t s = sec % 60;
+  char* p = out;
+  *p++ = '[';
+  size_t n = strlen(minuteStr_);
+  memcpy(p, minuteStr_, n);
+  p += n;
+  *p++ = (char)('0' + s / 10);
+  *p++ = (char)('0' + s % 10);
+  *p++ = '.';
+  *p++ = (char)('0' + ms / 100);
+  *p++ = (char)('0' + (ms / 10) % 10);
+  *p++ = (char)('0' + ms % 10);
+  *p++ = ' ';
+  n = strlen(tzStr_);
+  memcpy(p, tzStr_, n);
+  p += n;
+  *p++ = ']';
+  *p++ = '[';
+  memcpy(p, level, levelLen);
+  p += levelLen;
+  *p++ = ']';
+  *p++ = ' ';
+  return (size_t)(p - out);
+}
+
+void UnsyncedLogRewriter::convert(LogStore& store, const char* line, size_t length) {
+  const char* end = line + length;
+  // [uptime <sec>.<ms>s][<LEVEL>] <text>
+  if (length > kUptimeTagLen && memcmp(line, kUptimeTag, kUptimeTagLen) == 0) {
+    uint64_t upSec = 0;
+    uint64_t upMs = 0;
+    const char* p = parseDigits(line + kUptimeTagLen, end, upSec);
+    if (p && p < end && *p == '.') p = parseDigits(p + 1, end, upMs);
+    else p = nullptr;
+    if (p && end - p >= 3 && memcmp(p, "s][", 3) == 0) {
+      const char* level = p + 3;
+      const char* close = (const char*)memchr(level, ']', (size_t)(end - level));
+      size_t levelLen = close ? (size_t)(close - level) : 0;
+      if (close && levelLen <= 8) {
+        const char* text = close + 1;
+        if (text < end && *text == ' ') text++;
+        uint64_t epochMs = bootEpochMs_ + upSec * 1000ULL + upMs;
+        char prefix[64];
+        size_t n = formatPrefix(epochMs, level, levelLen, prefix);
+        lastEpoch_ = (uint32_t)(epochMs / 1000ULL);
+        lastLevel_ = levelFromTag(level, levelLen);
+        store.append(lastEpoch_, lastLevel_, prefix, n, text, (size_t)(end - text));
+        if (end[-1] != '\n') store.append(lastEpoch_, lastLevel_, "", 0, "\n", 1);
+        return;
+      }
+    }
+  }
+  // Continuation of the previous message
+  store.append(lastEpoch_, lastLevel_, "", 0, line, length);
+  if (end[-1] != '\n') store.append(lastEpoch_, lastLevel_, "", 0, "\n", 1);
+}
+
+UnsyncedLogRewriter::Step UnsyncedLogRewriter::step(LogStore& store, size_t maxLines) {
+  Step result;
+  if (!active_) {
+    result.done = true;
+    return result;
+  }
+  const char* line;
+  size_t length;
+  while (result.lines < maxLines) {
+    if (!nextLine(line, length)) {
+      cancel();
+      result.done = true;
+      break;
+    }
+    if (length == 1 && line[0] == '\n') continue;
+    convert(store, line, length);
+    result.lines++;
+    converted_++;
+  }
+  return result;
+}
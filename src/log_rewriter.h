@@ -0,0 +1,78 @@
+#ifndef LOG_REWRITER_H
+#define LOG_REWRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fs_compat.h"
+#include "log_store.h"
+
+// Lines converted per step; bounds how long one step holds the log file mutex.
+#ifndef LOG_REWRITE_LINES_PER_STEP
+#define LOG_REWRITE_LINES_PER_STEP 32
+#endif
+// Read buffer; longer lines are passed through in pieces.
+#ifndef LOG_REWRITE_BUFFER_BYTES
+#define LOG_REWRITE_BUFFER_BYTES 512
+#endif
+
+/**
+ * @brief Moves /logs/unsynced.log into the LogStore a few lines at a time
+ *
+ * Each "[uptime S.mmms][LEVEL] text" line gets a wall-clock prefix, from
+ * the boot epoch plus its uptime. Lines are parsed in place from a fixed
+ * buffer with integer math; localtime_r() runs once per wall-clock minute
+ * rather than per line. Lines without an uptime prefix (continuations of
+ * a multi-line message) keep the time and level of the line before them.
+ *
+ * begin() opens the file; each step() converts at most maxLines lines so
+ * the caller can interleave other work. Not thread-safe.
+ */
+class UnsyncedLogRewriter {
+public:
+  struct Step {
+    size_t lines = 0;   // lines appended to the store this step
+    bool done = false;  // the whole file has been converted
+  };
+
+  /**
+   * @brief Start converting a file
+   * @param bootEpochMs wall-clock milliseconds at uptime 0
+   * @return false if the file is missing
+   */
+  bool begin(fs::FS& fs, const char* path, uint64_t bootEpochMs);
+
+  /** Convert up to maxLines lines into store. */
+  Step step(LogStore& store, size_t maxLines);
+
+  /** Stop early; the source file is left alone. */
+  void cancel();
+
+  bool active() const { return active_; }
+  uint32_t convertedCount() const { return converted_; }
+
+private:
+  bool nextLine(const char*& line, size_t& length);
+  void convert(LogStore& store, const char* line, size_t length);
+  size_t formatPrefix(uint64_t epochMs, const char* level, size_t levelLen, char* out);
+
+  File in_;
+  bool active_ = false;
+  bool eof_ = false;
+  uint64_t bootEpochMs_ = 0;
+  char buf_[LOG_REWRITE_BUFFER_BYTES];
+  size_t have_ = 0;
+  size_t at_ = 0;
+
+  // Line before the current one, for continuation lines
+  uint32_t lastEpoch_ = 0;
+  uint8_t lastLevel_ = 1;
+  uint32_t converted_ = 0;
+
+  // "YYYY-MM-DD HH:MM:" and "%Z" of the minute the last line fell in
+  uint32_t cachedMinute_ = UINT32_MAX;
+  char minuteStr_[24];
+  char tzStr_[8];
+};
+
+#endif // LOG_REWRITER_H
@@ -0,0 +1,169 @@
+#include "log_ring.h"
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// state: 0 never written, 2*seq+1 while seq is being written, 2*seq+2 once
+// it is complete. Readers only trust a slot whose state is the committed
+// value for the seq they want, before and after copying it.
+struct LogRing::Slot {
+  std::atomic<uint32_t> state;
+  uint8_t level;
+  uint8_t truncated;
+  uint16_t length;
+  uint32_t epoch;
+  int64_t uptimeUs;
+  char text[LOG_RECORD_SIZE - 24];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == 4, "slot layout assumes a 4-byte atomic");
+static_assert(LOG_RECORD_SIZE >= 64 && LOG_RECORD_SIZE % 8 == 0,
+              "LOG_RECORD_SIZE must be a multiple of 8 and at least 64");
+
+static inline uint32_t writingState(uint32_t seq) { return seq * 2u + 1u; }
+static inline uint32_t committedState(uint32_t seq) { return seq * 2u + 2u; }
+
+LogRing::LogRing(void* storage, size_t bytes)
+    : base_(static_cast<uint8_t*>(storage)), slotCount_(storage ? bytes / sizeof(Slot) : 0) {
+  static_assert(sizeof(Slot) == LOG_RECORD_SIZE, "Slot must fill exactly one record");
+  clear();
+}
+
+size_t LogRing::textCapacity() {
+  return sizeof(Slot::text);
+}
+
+LogRing::Slot* LogRing::slot(uint32_t seq) const {
+  return reinterpret_cast<Slot*>(base_) + (seq % slotCount_);
+}
+
+void LogRing::clear() {
+  for (size_t i = 0; i < slotCount_; ++i) {
+    Slot* s = reinterpret_cast<Slot*>(base_) + i;
+    new (&s->state) std::atomic<uint32_t>(0);
+  }
+  floor_ = 0;
+  head_.store(0, std::memory_order_release);
+}
+
+void LogRing::moveTo(void* storage, size_t bytes) {
+  Slot* from = reinterpret_cast<Slot*>(base_);
+  Slot* to = reinterpret_cast<Slot*>(storage);
+  size_t count = storage ? bytes / sizeof(Slot) : 0;
+  for (size_t i = 0; i < count; ++i) new (&to[i].state) std::atomic<uint32_t>(0);
+
+  uint32_t end = head();
+  uint32_t start = tail();
+  if (end - start > count) start = end - static_cast<uint32_t>(count);
+  for (uint32_t seq = start; seq != end; ++seq) {
+    const Slot& s = from[seq % slotCount_];
+    Slot& d = to[seq % count];
+    d.level = s.level;
+    d.truncated = s.truncated;
+    d.length = s.length;
+    d.epoch = s.epoch;
+    d.uptimeUs = s.uptimeUs;
+    memcpy(d.text, s.text, sizeof(d.text));
+    d.state.store(s.state.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  base_ = static_cast<uint8_t*>(storage);
+  slotCount_ = count;
+  floor_ = start;
+}
+
+uint32_t LogRing::tail() const {
+  uint32_t h = head();
+  uint32_t t = h > slotCount_ ? h - static_cast<uint32_t>(slotCount_) : 0;
+  return static_cast<int32_t>(floor_ - t) > 0 ? floor_ : t;
+}
+
+uint32_t LogRing::append(uint8_t level, int64_t uptimeUs, uint32_t epoch,
+                         const char* text, size_t length) {
+  uint32_t seq = head_.fetch_add(1, std::memory_order_relaxed);
+  if (slotCount_ == 0) return seq;
+  Slot* s = slot(seq);
+
+  s->state.store(writingState(seq), std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  size_t cap = sizeof(s->text);
+  bool truncated = length > cap;
+  size_t n = truncated ? cap : length;
+  if (text && n) memcpy(s->text, text, n);
+  // Keep the line ending of a truncated line so the sink output stays line-based
+  if (truncated && text[length - 1] == '\n') s->text[n - 1] = '\n';
+  s->level = level;
+  s->truncated = truncated ? 1 : 0;
+  s->length = static_cast<uint16_t>(n);
+  s->epoch = epoch;
+  s->uptimeUs = uptimeUs;
+
+  s->state.store(committedState(seq), std::memory_order_release);
+  return seq;
+}
+
+bool LogRing::read(uint32_t seq, LogRecord& out, char* buf) const {
+  return readRecord(seq, out, buf) == ReadResult::Ok;
+}
+
+LogRing::ReadResult LogRing::readRecord(uint32_t seq, LogRecord& out, char* buf) const {
+  if (slotCount_ == 0) return ReadResult::Gone;
+  const Slot* s = slot(seq);
+  uint32_t before = s->state.load(std::memory_order_acquire);
+  if (before != committedState(seq)) {
+    // Claimed but not finished, or the slot still holds an older lap
+    int32_t ahead = static_cast<int32_t>(before - writingState(seq));
+    return (before == 0 || ahead <= 0) && static_cast<int32_t>(head() - seq) > 0
+               ? ReadResult::Pending : ReadResult::Gone;
+  }
+
+  size_t n = s->length;
+  if (n > sizeof(s->text)) return ReadResult::Gone;
+  memcpy(buf, s->text, n);
+  out.seq = seq;
+  out.level = s->level;
+  out.truncated = s->truncated != 0;
+  out.epoch = s->epoch;
+  out.uptimeUs = s->uptimeUs;
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (s->state.load(std::memory_order_relaxed) != before) return ReadResult::Gone;
+  out.text = buf;
+  out.length = n;
+  return ReadResult::Ok;
+}
+
+const char* logLevelTag(uint8_t level) {
+  switch (level) {
+    case 0: return "DEBUG";
+    case 1: return "INFO";
+    case 2: return "WARN";
+    case 3: return "ERROR";
+    default: return "INFO";
+  }
+}
+
+size_t logFormatPrefix(const LogRecord& rec, char* out, size_t cap) {
+  if (!out || cap == 0) return 0;
+  uint64_t upMs = rec.uptimeUs > 0 ? static_cast<uint64_t>(rec.uptimeUs) / 1000ULL : 0;
+  int n;
+  if (rec.epoch == 0) {
+    n = snprintf(out, cap, "[uptime %lu.%03lus][%s] ", (unsigned long)(upMs / 1000ULL),
+                 (unsigned long)(upMs % 1000ULL), logLevelTag(rec.level));
+  } else {
+    time_t t = static_cast<time_t>(rec.epoch);
+    struct tm lt = {};
+    localtime_r(&t, &lt);
+    char datebuf[32];
+    char tzbuf[8];
+    strftime(datebuf, sizeof(datebuf), "%Y-%m-%d %H:%M:%S", &lt);
+    strftime(tzbuf, sizeof(tzbuf), "%Z", &lt);
+    // Sub-second part comes from uptime, as it always has
+    n = snprintf(out, cap, "[%s.%03lu %s][%s] ", datebuf, (unsigned long)(upMs % 1000ULL),
+                 tzbuf, logLevelTag(rec.level));
+  }
+  if (n < 0) n = 0;
+  return static_cast<size_t>(n) < cap ? static_cast<size_t>(n) : cap - 1;
+}
@@ -0,0 +1,128 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of one record including its header. Longer messages are truncated.
+#ifndef LOG_RECORD_SIZE
+#define LOG_RECORD_SIZE 160
+#endif
+
+/**
+ * @brief One log record as read back from a LogRing
+ *
+ * text points at the reader's copy and is not NUL-terminated.
+ */
+struct LogRecord {
+  uint32_t seq;       // monotonically increasing record number
+  int64_t uptimeUs;   // esp_timer time when the record was written
+  uint32_t epoch;     // wall clock seconds, 0 while time is unsynced
+  uint8_t level;
+  bool truncated;
+  const char* text;
+  size_t length;
+};
+
+/**
+ * @brief Binary log ring: fixed slots in a caller-provided byte arena
+ *
+ * Writers store the raw message with a timestamp and level; nothing is
+ * formatted until a reader (web /log, the file sink) walks the ring. Any
+ * task may append concurrently: a slot is claimed with one atomic
+ * fetch_add on the head counter and published through a per-slot sequence
+ * word (seqlock), so there is no mutex and no allocation. Readers copy a
+ * slot and re-check its sequence word; a slot overwritten mid-copy is
+ * skipped rather than returned torn.
+ *
+ * When writers lap a reader the oldest records are lost; seq numbers let
+ * the reader see exactly how many.
+ */
+class LogRing {
+public:
+  static const size_t kRecordSize = LOG_RECORD_SIZE;
+
+  LogRing(void* storage, size_t bytes);
+
+  /** Append a record; returns its seq. Never blocks, never allocates. */
+  uint32_t append(uint8_t level, int64_t uptimeUs, uint32_t epoch,
+                  const char* text, size_t length);
+
+  /** Largest message stored without truncation. */
+  static size_t textCapacity();
+
+  size_t capacity() const { return slotCount_; }
+  /** seq the next append will get; records [head - capacity, head) may be readable. */
+  uint32_t head() const { return head_.load(std::memory_order_acquire); }
+  /** Oldest seq still in the ring. */
+  uint32_t tail() const;
+
+  /**
+   * @brief Copy record seq out of the ring
+   * @param buf receives the text (at least textCapacity() bytes)
+   * @return false if seq was overwritten, is not written yet, or is mid-write
+   */
+  bool read(uint32_t seq, LogRecord& out, char* buf) const;
+
+  /**
+   * @brief Visit every readable record from `from` (clamped to tail) to head
+   *
+   * Stops at a record that is still being written, so it is picked up on
+   * the next call instead of being skipped.
+   * @return the seq to continue from next time
+   */
+  template <typename Fn>
+  uint32_t forEach(uint32_t from, Fn fn) const {
+    char buf[kRecordSize];
+    uint32_t end = head();
+    uint32_t start = tail();
+    if (static_cast<int32_t>(from - start) > 0) start = from;
+    if (static_cast<int32_t>(end - start) < 0) start = end;
+    for (uint32_t seq = start; seq != end; ++seq) {
+      LogRecord rec;
+      ReadResult r = readRecord(seq, rec, buf);
+      if (r == ReadResult::Pending) return seq;
+      if (r == ReadResult::Ok) fn(rec);
+    }
+    return end;
+  }
+
+  void clear();
+
+  /**
+   * @brief Continue in a different block, keeping the records still readable
+   *
+   * For moving off a small boot block once a bigger one can be had. Only
+   * safe while nothing else appends or reads: early in setup().
+   */
+  void moveTo(void* storage, size_t bytes);
+
+private:
+  struct Slot;
+  enum class ReadResult : uint8_t { Ok, Gone, Pending };
+
+  ReadResult readRecord(uint32_t seq, LogRecord& out, char* buf) const;
+
+  Slot* slot(uint32_t seq) const;
+
+  uint8_t* base_;
+  size_t slotCount_;
+  uint32_t floor_ = 0;  // oldest seq kept by the last moveTo()
+  std::atomic<uint32_t> head_{0};
+};
+
+/** Upper-case level tag as written in log lines ("DEBUG", "INFO", ...). */
+const char* logLevelTag(uint8_t level);
+
+/**
+ * @brief Render the line prefix for a record into out
+ *
+ * "[YYYY-MM-DD HH:MM:SS.mmm TZ][LEVEL] " once the clock was synced when the
+ * record was written, "[uptime S.mmms][LEVEL] " before that. Uses the
+ * current TZ setting.
+ * @return characters written (excluding the terminator)
+ */
+size_t logFormatPrefix(const LogRecord& rec, char* out, size_t cap);
+
+#endif // LOG_RING_H
@@ -0,0 +1,56 @@
+#include "log_sink.h"
+
+#include <stdio.h>
+
+LogFileSink::Result LogFileSink::drain(LogStore& store, bool flush, unsigned long nowMs) {
+  Result result;
+  char prefix[96];
+
+  uint32_t cursor = cursor_.load(std::memory_order_relaxed);
+  uint32_t tail = ring_.tail();
+  uint32_t lost = 0;
+  if (static_cast<int32_t>(tail - cursor) > 0) {
+    lost = tail - cursor;
+    dropped_ += lost;
+    cursor = tail;
+  }
+
+  bool sawError = false;
+  cursor = ring_.forEach(cursor, [&](const LogRecord& rec) {
+    if (lost) {
+      // Stamped like the first surviving record, so it sorts next to it
+      LogRecord marker = rec;
+      marker.level = 2;  // LOG_LEVEL_WARN
+      size_t n = logFormatPrefix(marker, prefix, sizeof(prefix));
+      char text[64];
+      int t = snprintf(text, sizeof(text), "[log] %lu records dropped before reaching the file\n",
+                       (unsigned long)lost);
+      store.append(rec.epoch, marker.level, prefix, n, text, t > 0 ? (size_t)t : 0);
+      lost = 0;
+    }
+    size_t n = logFormatPrefix(rec, prefix, sizeof(prefix));
+    store.append(rec.epoch, rec.level, prefix, n, rec.text, rec.length);
+    result.records++;
+    result.bytes += n + rec.length;
+    if (rec.level >= 3) sawError = true;  // LOG_LEVEL_ERROR
+  });
+  cursor_.store(cursor, std::memory_order_relaxed);
+  written_ += result.records;
+
+  // One flush per interval; errors and explicit requests go out immediately
+  if (flush || sawError || !everFlushed_ || (nowMs - lastFlushMs_) >= LOG_SINK_INTERVAL_MS) {
+    if (result.records > 0 || flush) {
+      store.flush();
+      flushes_++;
+      result.flushed = true;
+      lastFlushMs_ = nowMs;
+      everFlushed_ = true;
+    }
+  }
+  return result;
+}
+
+void LogFileSink::skip() {
+  uint32_t head = ring_.head();
+  dropped_ += head - cursor_.exchange(head, std::memory_order_relaxed);
+}
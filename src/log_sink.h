@@ -0,0 +1,66 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_ring.h"
+#include "log_store.h"
+
+// The sink task wakes at least this often, and flushes at most this often
+// unless an ERROR record or logFlushFile() asks for it sooner.
+#ifndef LOG_SINK_INTERVAL_MS
+#define LOG_SINK_INTERVAL_MS 5000
+#endif
+
+/**
+ * @brief Drains a LogRing into the LogStore
+ *
+ * Keeps its own cursor into the ring and formats each new record on the
+ * way out; the store batches the bytes into page-sized writes. If writers
+ * lap the cursor the records are gone; the sink counts them and writes one
+ * marker line.
+ *
+ * Not thread-safe: the firmware only drives it from the sink task (or
+ * with that task's mutex held).
+ */
+class LogFileSink {
+public:
+  explicit LogFileSink(const LogRing& ring) : ring_(ring) {}
+
+  struct Result {
+    size_t records = 0;
+    size_t bytes = 0;
+    bool flushed = false;
+  };
+
+  /** Records waiting for the file (including ones already lapped). Any task may ask. */
+  uint32_t backlog() const { return ring_.head() - cursor_.load(std::memory_order_relaxed); }
+  bool pending() const { return backlog() != 0; }
+
+  /**
+   * @brief Append every new record to the store
+   * @param flush flush even if the interval has not elapsed
+   * @param nowMs millis(), for the flush interval
+   */
+  Result drain(LogStore& store, bool flush, unsigned long nowMs);
+
+  /** Forget the backlog (e.g. no file could be opened); counted as dropped. */
+  void skip();
+
+  uint32_t droppedCount() const { return dropped_; }
+  uint32_t writtenCount() const { return written_; }
+  uint32_t flushCount() const { return flushes_; }
+
+private:
+  const LogRing& ring_;
+  std::atomic<uint32_t> cursor_{0};
+  unsigned long lastFlushMs_ = 0;
+  bool everFlushed_ = false;
+  uint32_t dropped_ = 0;
+  uint32_t written_ = 0;
+  uint32_t flushes_ = 0;
+};
+
+#endif // LOG_SINK_H
@@ -0,0 +1,756 @@
+#include "log_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const char* const LogStore::kDir = "/logs";
+const char* const LogStore::kIndexPath = "/logs/index.bin";
+const char* const LogStore::kUnsyncedPath = "/logs/unsynced.log";
+
+namespace {
+
+const uint32_t kIndexMagic = 0x3149474C;  // "LGI1"
+const size_t kTimestampLen = 19;          // "YYYY-MM-DD HH:MM:SS"
+const size_t kQueryBufferBytes = 512;
+const size_t kMaxListedDays = 32;
+
+struct IndexHeader {
+  uint32_t magic;
+  uint32_t entrySize;
+  uint32_t count;
+  uint32_t nextId;
+};
+
+bool isDigits(const char* p, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if (p[i] < '0' || p[i] > '9') return false;
+  }
+  return true;
+}
+
+int toInt(const char* p, size_t n) {
+  int v = 0;
+  for (size_t i = 0; i < n; ++i) v = v * 10 + (p[i] - '0');
+  return v;
+}
+
+// "seg-000042.log" -> 42; 0 if the name is not a segment
+uint32_t segmentIdFromName(const char* name) {
+  const char* base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  if (strncmp(base, "seg-", 4) != 0 || strlen(base) != 14 || strcmp(base + 10, ".log") != 0) return 0;
+  if (!isDigits(base + 4, 6)) return 0;
+  return (uint32_t)toInt(base + 4, 6);
+}
+
+// The per-day files written before the segmented store: "YYYY-MM-DD.log"
+bool isLegacyDayFile(const char* name) {
+  const char* base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  return strlen(base) == 14 && isDigits(base, 4) && base[4] == '-' && isDigits(base + 5, 2) &&
+         base[7] == '-' && isDigits(base + 8, 2) && strcmp(base + 10, ".log") == 0;
+}
+
+void formatLocal(uint32_t epoch, char* out) {
+  time_t t = (time_t)epoch;
+  struct tm lt = {};
+  localtime_r(&t, &lt);
+  strftime(out, kTimestampLen + 1, "%Y-%m-%d %H:%M:%S", &lt);
+}
+
+// Noon of the local day containing epoch; stepping whole days from there
+// never skips or repeats a date across a DST change
+time_t localNoon(uint32_t epoch) {
+  time_t t = (time_t)epoch;
+  struct tm lt = {};
+  localtime_r(&t, &lt);
+  lt.tm_hour = 12;
+  lt.tm_min = 0;
+  lt.tm_sec = 0;
+  lt.tm_isdst = -1;
+  return mktime(&lt);
+}
+
+uint32_t parseLocal(const char* when) {
+  struct tm lt = {};
+  lt.tm_year = toInt(when, 4) - 1900;
+  lt.tm_mon = toInt(when + 5, 2) - 1;
+  lt.tm_mday = toInt(when + 8, 2);
+  lt.tm_hour = toInt(when + 11, 2);
+  lt.tm_min = toInt(when + 14, 2);
+  lt.tm_sec = toInt(when + 17, 2);
+  lt.tm_isdst = -1;
+  time_t t = mktime(&lt);
+  return t > 0 ? (uint32_t)t : 0;
+}
+
+}  // namespace
+
+bool logParseLinePrefix(const char* line, size_t length, const char*& when, uint8_t& level) {
+  // [YYYY-MM-DD HH:MM:SS.mmm TZ][LEVEL]
+  if (length < kTimestampLen + 4 || line[0] != '[') return false;
+  const char* t = line + 1;
+  if (!isDigits(t, 4) || t[4] != '-' || t[7] != '-' || t[10] != ' ' || t[13] != ':' || t[16] != ':') {
+    return false;
+  }
+  const char* close = (const char*)memchr(line, ']', length);
+  if (!close || (size_t)(close - line) + 2 >= length || close[1] != '[') return false;
+  const char* tag = close + 2;
+  size_t left = length - (size_t)(tag - line);
+  if (left >= 5 && memcmp(tag, "DEBUG", 5) == 0) level = 0;
+  else if (left >= 4 && memcmp(tag, "INFO", 4) == 0) level = 1;
+  else if (left >= 4 && memcmp(tag, "WARN", 4) == 0) level = 2;
+  else if (left >= 5 && memcmp(tag, "ERROR", 5) == 0) level = 3;
+  else return false;
+  when = t;
+  return true;
+}
+
+LogStore::LogStore(fs::FS& fs) : fs_(fs) {}
+
+void LogStore::segmentPath(uint32_t id, char* out, size_t cap) {
+  snprintf(out, cap, "%s/seg-%06lu.log", kDir, (unsigned long)id);
+}
+
+bool LogStore::begin() {
+  close();
+  if (!fs_.exists(kDir)) fs_.mkdir(kDir);
+
+  if (!loadIndex()) rebuildIndex();
+  importLegacyDays();
+
+  File unsynced = fs_.open(kUnsyncedPath, FILE_READ);
+  unsyncedBytes_ = unsynced ? (uint32_t)unsynced.size() : 0;
+  if (unsynced) unsynced.close();
+  return true;
+}
+
+// The per-day files written before segments use the same line prefix, so
+// their lines go in as they are, oldest day first, and each file is removed
+// once it is in. Only the newest days that fit the quota are read; older
+// ones would be rotated out again straight away. Runs once, on the first
+// boot after the upgrade.
+void LogStore::importLegacyDays() {
+  struct Legacy {
+    char name[15];  // "YYYY-MM-DD.log"
+    uint32_t bytes;
+  };
+  Legacy days[kMaxListedDays];
+  size_t found = 0;
+
+  File dir = fs_.open(kDir);
+  if (!dir) return;
+  while (true) {
+    File entry = dir.openNextFile();
+    if (!entry) break;
+    if (entry.isDirectory() || !isLegacyDayFile(entry.name())) {
+      entry.close();
+      continue;
+    }
+    Legacy day;
+    const char* base = strrchr(entry.name(), '/');
+    memcpy(day.name, base ? base + 1 : entry.name(), sizeof(day.name));
+    day.bytes = (uint32_t)entry.size();
+    entry.close();
+    if (found < kMaxListedDays) {
+      days[found++] = day;
+      continue;
+    }
+    // More days than fit the list: the oldest goes without being read
+    size_t oldest = 0;
+    for (size_t i = 1; i < found; ++i) {
+      if (strcmp(days[i].name, days[oldest].name) < 0) oldest = i;
+    }
+    if (strcmp(day.name, days[oldest].name) > 0) {
+      Legacy newer = day;
+      day = days[oldest];
+      days[oldest] = newer;
+    }
+    char path[32];
+    snprintf(path, sizeof(path), "%s/%s", kDir, day.name);
+    fs_.remove(path);
+  }
+  dir.close();
+  if (found == 0) return;
+
+  // Oldest first; dates sort as strings
+  for (size_t i = 1; i < found; ++i) {
+    Legacy v = days[i];
+    size_t j = i;
+    while (j > 0 && strcmp(days[j - 1].name, v.name) > 0) {
+      days[j] = days[j - 1];
+      j--;
+    }
+    days[j] = v;
+  }
+  uint32_t budget = LOG_STORE_QUOTA_BYTES;
+  size_t first = found;
+  while (first > 0 && days[first - 1].bytes <= budget) {
+    budget -= days[first - 1].bytes;
+    first--;
+  }
+  // Even a single day over the quota is worth its newest part
+  if (first == found) first = found - 1;
+
+  for (size_t i = 0; i < found; ++i) {
+    char path[32];
+    snprintf(path, sizeof(path), "%s/%s", kDir, days[i].name);
+    if (i >= first) importLegacyDay(path, days[i].name);
+    fs_.remove(path);
+  }
+  flush();
+}
+
+void LogStore::importLegacyDay(const char* path, const char* name) {
+  File f = fs_.open(path, FILE_READ);
+  if (!f) return;
+  // Lines before the first timestamped one belong to the start of the day
+  char midnight[kTimestampLen + 1];
+  memcpy(midnight, name, 10);
+  memcpy(midnight + 10, " 00:00:00", 10);
+  uint32_t lastEpoch = parseLocal(midnight);
+  uint8_t lastLevel = 1;
+
+  char buf[kQueryBufferBytes];
+  size_t have = 0;
+  while (true) {
+    size_t n = f.read(reinterpret_cast<uint8_t*>(buf + have), sizeof(buf) - have);
+    have += n;
+    if (have == 0) break;
+    size_t start = 0;
+    while (start < have) {
+      const char* nl = (const char*)memchr(buf + start, '\n', have - start);
+      size_t len;
+      if (nl) len = (size_t)(nl - (buf + start)) + 1;
+      else if (n == 0 || (start == 0 && have == sizeof(buf))) len = have - start;
+      else break;
+      const char* when;
+      uint8_t level = 1;
+      if (logParseLinePrefix(buf + start, len, when, level)) {
+        lastEpoch = parseLocal(when);
+        lastLevel = level;
+      }
+      append(lastEpoch, lastLevel, "", 0, buf + start, len);
+      if (n == 0 && !nl) append(lastEpoch, lastLevel, "", 0, "\n", 1);
+      start += len;
+    }
+    memmove(buf, buf + start, have - start);
+    have -= start;
+    if (n == 0) break;
+  }
+  f.close();
+}
+
+uint32_t LogStore::totalBytes() const {
+  uint32_t total = 0;
+  for (size_t i = 0; i < count_; ++i) total += segments_[i].bytes;
+  return total;
+}
+
+// ----------------------------------------------------------------------------
+// Writing
+// ----------------------------------------------------------------------------
+
+void LogStore::put(const char* data, size_t length) {
+  while (length > 0) {
+    size_t room = sizeof(batch_) - batchUsed_;
+    size_t n = length < room ? length : room;
+    memcpy(batch_ + batchUsed_, data, n);
+    batchUsed_ += n;
+    data += n;
+    length -= n;
+    if (batchUsed_ == sizeof(batch_)) commit();
+  }
+}
+
+void LogStore::commit() {
+  if (batchUsed_ == 0) return;
+  if (file_) {
+    file_.write(reinterpret_cast<const uint8_t*>(batch_), batchUsed_);
+    batches_++;
+  }
+  batchUsed_ = 0;
+}
+
+bool LogStore::openTarget(Target t) {
+  if (target_ == t && file_) return true;
+  commit();
+  if (file_) {
+    file_.flush();
+    file_.close();
+  }
+  target_ = Target::None;
+  if (t == Target::Segment) {
+    if (count_ == 0) startSegment();
+    char path[32];
+    segmentPath(segments_[count_ - 1].id, path, sizeof(path));
+    file_ = fs_.open(path, FILE_APPEND);
+  } else if (t == Target::Unsynced) {
+    file_ = fs_.open(kUnsyncedPath, FILE_APPEND);
+  }
+  if (!file_) return false;
+  target_ = t;
+  return true;
+}
+
+void LogStore::startSegment() {
+  // Make room for a full new segment before it exists
+  while (count_ > 0 && (count_ >= kLogStoreMaxSegments ||
+                        totalBytes() + LOG_SEGMENT_BYTES > LOG_STORE_QUOTA_BYTES)) {
+    removeOldest();
+  }
+  LogSegmentInfo& info = segments_[count_++];
+  memset(&info, 0, sizeof(info));
+  info.id = nextId_++;
+  info.ordered = true;
+  indexDirty_ = true;
+}
+
+void LogStore::removeOldest() {
+  if (count_ == 0) return;
+  char path[32];
+  segmentPath(segments_[0].id, path, sizeof(path));
+  fs_.remove(path);
+  memmove(&segments_[0], &segments_[1], (count_ - 1) * sizeof(LogSegmentInfo));
+  count_--;
+  removed_++;
+  indexDirty_ = true;
+}
+
+void LogStore::noteLine(LogSegmentInfo& info, uint32_t epoch, uint8_t level, size_t length) {
+  if (epoch != 0) {
+    if (info.firstEpoch == 0 || epoch < info.firstEpoch) info.firstEpoch = epoch;
+    if (epoch < info.lastEpoch) info.ordered = false;
+    if (epoch > info.lastEpoch) info.lastEpoch = epoch;
+  }
+  if (level > 3) level = 3;
+  if (info.levelCounts[level] < UINT16_MAX) info.levelCounts[level]++;
+  const uint32_t stride = LOG_SEGMENT_BYTES / LOG_INDEX_CHECKPOINTS;
+  if (info.checkpointCount < LOG_INDEX_CHECKPOINTS &&
+      info.bytes >= info.checkpointCount * stride) {
+    info.checkpoints[info.checkpointCount++] = LogCheckpoint{epoch, info.bytes};
+  }
+  info.bytes += (uint32_t)length;
+  indexDirty_ = true;
+}
+
+void LogStore::append(uint32_t epoch, uint8_t level, const char* prefix, size_t prefixLen,
+                      const char* text, size_t textLen) {
+  size_t length = prefixLen + textLen;
+  if (epoch == 0) {
+    if (!openTarget(Target::Unsynced)) return;
+    put(prefix, prefixLen);
+    put(text, textLen);
+    unsyncedBytes_ += (uint32_t)length;
+    return;
+  }
+
+  if (count_ > 0 && segments_[count_ - 1].bytes > 0 &&
+      segments_[count_ - 1].bytes + length > LOG_SEGMENT_BYTES) {
+    // Close the full segment so the new one starts on a line boundary
+    commit();
+    if (file_) {
+      file_.flush();
+      file_.close();
+    }
+    target_ = Target::None;
+    startSegment();
+  }
+  if (!openTarget(Target::Segment)) return;
+  noteLine(segments_[count_ - 1], epoch, level, length);
+  put(prefix, prefixLen);
+  put(text, textLen);
+}
+
+void LogStore::flush() {
+  commit();
+  if (file_) file_.flush();
+  if (indexDirty_) saveIndex();
+}
+
+void LogStore::close() {
+  flush();
+  if (file_) file_.close();
+  target_ = Target::None;
+}
+
+void LogStore::clear() {
+  batchUsed_ = 0;
+  if (file_) file_.close();
+  target_ = Target::None;
+  while (count_ > 0) removeOldest();
+  fs_.remove(kIndexPath);
+  fs_.remove(kUnsyncedPath);
+  unsyncedBytes_ = 0;
+  indexDirty_ = false;
+}
+
+void LogStore::removeUnsynced() {
+  if (target_ == Target::Unsynced) {
+    batchUsed_ = 0;
+    if (file_) file_.close();
+    target_ = Target::None;
+  }
+  fs_.remove(kUnsyncedPath);
+  unsyncedBytes_ = 0;
+}
+
+void LogStore::enforceRetention(uint32_t nowEpoch, uint32_t retentionDays) {
+  uint32_t maxAge = retentionDays * 86400UL;
+  // The active segment stays, however old its lines are
+  while (count_ > 1 && segments_[0].lastEpoch != 0 && nowEpoch > maxAge &&
+         segments_[0].lastEpoch < nowEpoch - maxAge) {
+    removeOldest();
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Index
+// ----------------------------------------------------------------------------
+
+bool LogStore::saveIndex() {
+  File f = fs_.open(kIndexPath, FILE_WRITE);
+  if (!f) return false;
+  IndexHeader h = {kIndexMagic, (uint32_t)sizeof(LogSegmentInfo), (uint32_t)count_, nextId_};
+  f.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h));
+  if (count_) f.write(reinterpret_cast<const uint8_t*>(segments_), count_ * sizeof(LogSegmentInfo));
+  f.close();
+  indexDirty_ = false;
+  return true;
+}
+
+bool LogStore::loadIndex() {
+  File f = fs_.open(kIndexPath, FILE_READ);
+  if (!f) return false;
+  IndexHeader h;
+  bool ok = f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) && h.magic == kIndexMagic &&
+            h.entrySize == sizeof(LogSegmentInfo) && h.count <= kLogStoreMaxSegments &&
+            f.size() == sizeof(h) + h.count * sizeof(LogSegmentInfo);
+  if (ok && h.count) {
+    ok = f.read(reinterpret_cast<uint8_t*>(segments_), h.count * sizeof(LogSegmentInfo)) ==
+         h.count * sizeof(LogSegmentInfo);
+  }
+  f.close();
+  if (!ok) return false;
+  count_ = h.count;
+  nextId_ = h.nextId;
+
+  // Drop entries whose file is gone; rescan one that grew after the last save
+  size_t kept = 0;
+  for (size_t i = 0; i < count_; ++i) {
+    char path[32];
+    segmentPath(segments_[i].id, path, sizeof(path));
+    File seg = fs_.open(path, FILE_READ);
+    if (!seg) {
+      indexDirty_ = true;
+      continue;
+    }
+    uint32_t size = (uint32_t)seg.size();
+    seg.close();
+    if (kept != i) segments_[kept] = segments_[i];
+    if (segments_[kept].bytes != size) {
+      scanSegment(segments_[kept]);
+      indexDirty_ = true;
+    }
+    if (segments_[kept].id >= nextId_) nextId_ = segments_[kept].id + 1;
+    kept++;
+  }
+  count_ = kept;
+  return true;
+}
+
+void LogStore::rebuildIndex() {
+  count_ = 0;
+  nextId_ = 1;
+  uint32_t ids[kLogStoreMaxSegments * 2];
+  size_t found = 0;
+  File dir = fs_.open(kDir);
+  if (dir) {
+    while (true) {
+      File entry = dir.openNextFile();
+      if (!entry) break;
+      uint32_t id = entry.isDirectory() ? 0 : segmentIdFromName(entry.name());
+      entry.close();
+      if (id && found < sizeof(ids) / sizeof(ids[0])) ids[found++] = id;
+    }
+    dir.close();
+  }
+  // Oldest first (ids only grow)
+  for (size_t i = 1; i < found; ++i) {
+    uint32_t v = ids[i];
+    size_t j = i;
+    while (j > 0 && ids[j - 1] > v) {
+      ids[j] = ids[j - 1];
+      j--;
+    }
+    ids[j] = v;
+  }
+  size_t skip = found > kLogStoreMaxSegments ? found - kLogStoreMaxSegments : 0;
+  for (size_t i = 0; i < found; ++i) {
+    if (i < skip) {
+      char path[32];
+      segmentPath(ids[i], path, sizeof(path));
+      fs_.remove(path);
+      continue;
+    }
+    LogSegmentInfo& info = segments_[count_++];
+    memset(&info, 0, sizeof(info));
+    info.id = ids[i];
+    scanSegment(info);
+    nextId_ = ids[i] + 1;
+  }
+  indexDirty_ = true;
+  saveIndex();
+}
+
+// Recreate a segment's index entry from its contents
+void LogStore::scanSegment(LogSegmentInfo& info) {
+  uint32_t id = info.id;
+  memset(&info, 0, sizeof(info));
+  info.id = id;
+  info.ordered = true;
+  char path[32];
+  segmentPath(id, path, sizeof(path));
+  File f = fs_.open(path, FILE_READ);
+  if (!f) return;
+
+  char buf[kQueryBufferBytes];
+  size_t have = 0;
+  uint32_t lastEpoch = 0;
+  while (true) {
+    size_t n = f.read(reinterpret_cast<uint8_t*>(buf + have), sizeof(buf) - have);
+    have += n;
+    if (have == 0) break;
+    size_t start = 0;
+    while (start < have) {
+      const char* nl = (const char*)memchr(buf + start, '\n', have - start);
+      size_t len;
+      if (nl) len = (size_t)(nl - (buf + start)) + 1;
+      else if (n == 0 || (start == 0 && have == sizeof(buf))) len = have - start;
+      else break;
+      const char* when;
+      uint8_t level = 1;
+      if (logParseLinePrefix(buf + start, len, when, level)) lastEpoch = parseLocal(when);
+      // Marker lines inherit the time of the line before them
+      noteLine(info, lastEpoch, level, len);
+      start += len;
+    }
+    memmove(buf, buf + start, have - start);
+    have -= start;
+    if (n == 0) break;
+  }
+  f.close();
+}
+
+// ----------------------------------------------------------------------------
+// Reading
+// ----------------------------------------------------------------------------
+
+size_t LogStore::query(const LogQuery& q, LineFn fn, void* ctx) {
+  LogCursor cur;
+  cur.query = q;
+  return queryMore(cur, fn, ctx, SIZE_MAX);
+}
+
+size_t LogStore::queryMore(LogCursor& cur, LineFn fn, void* ctx, size_t maxBytes) {
+  if (cur.done) return 0;
+  if (!cur.begun) {
+    // Readers only see what has reached the file
+    commit();
+    if (file_) file_.flush();
+    cur.begun = true;
+    if (count_ > 0) {
+      cur.endSegment = segments_[count_ - 1].id;
+      cur.endBytes = segments_[count_ - 1].bytes;
+    }
+  }
+
+  const LogQuery& q = cur.query;
+  bool timed = q.from > 0 || q.to != UINT32_MAX;
+  char fromStr[kTimestampLen + 1] = "";
+  char toStr[kTimestampLen + 1] = "";
+  if (q.from > 0) formatLocal(q.from, fromStr);
+  if (q.to != UINT32_MAX) formatLocal(q.to, toStr);
+
+  size_t emitted = 0;
+  size_t sent = 0;
+  for (size_t i = 0; i < count_ && sent < maxBytes; ++i) {
+    const LogSegmentInfo& info = segments_[i];
+    if (info.id > cur.endSegment) break;
+    if (info.id < cur.segment || (info.id == cur.segment && !cur.inSegment)) continue;
+    if (info.id != cur.segment) cur.inSegment = false;  // the one it paused in was removed
+    if (!cur.inSegment) {
+      cur.segment = info.id;
+      if (info.bytes == 0) continue;
+      if (timed && (info.firstEpoch == 0 || info.lastEpoch < q.from || info.firstEpoch > q.to)) continue;
+      uint32_t matching = 0;
+      for (uint8_t l = q.minLevel; l < 4; ++l) matching += info.levelCounts[l];
+      if (matching == 0) continue;
+    }
+    emitted += querySegment(info, cur, q.from > 0 ? fromStr : nullptr, q.to != UINT32_MAX ? toStr : nullptr,
+                            fn, ctx, maxBytes, sent);
+  }
+  if (sent < maxBytes) cur.done = true;
+  return emitted;
+}
+
+size_t LogStore::querySegment(const LogSegmentInfo& info, LogCursor& cur, const char* fromStr,
+                              const char* toStr, LineFn fn, void* ctx, size_t maxBytes, size_t& sent) {
+  const LogQuery& q = cur.query;
+  uint32_t start = 0;
+  uint32_t end = info.bytes;
+  if (info.id == cur.endSegment && cur.endBytes < end) end = cur.endBytes;
+  if (info.ordered) {
+    // Every line before a checkpoint is no newer than it, every line after no older
+    for (uint8_t c = 0; c < info.checkpointCount; ++c) {
+      const LogCheckpoint& cp = info.checkpoints[c];
+      if (cp.epoch < q.from) start = cp.offset;
+      if (cp.epoch > q.to) {
+        if (cp.offset < end) end = cp.offset;
+        break;
+      }
+    }
+  }
+  if (!cur.inSegment) {
+    cur.inSegment = true;
+    cur.offset = start;
+    cur.passing = !fromStr && !toStr && q.minLevel == 0;
+  }
+  if (cur.offset >= end) {
+    cur.inSegment = false;
+    return 0;
+  }
+
+  char path[32];
+  segmentPath(info.id, path, sizeof(path));
+  File f = fs_.open(path, FILE_READ);
+  if (!f || !f.seek(cur.offset)) {
+    cur.inSegment = false;
+    return 0;
+  }
+
+  char buf[kQueryBufferBytes];
+  size_t have = 0;
+  uint32_t pos = cur.offset;
+  size_t emitted = 0;
+  bool lastPass = cur.passing;
+  while (pos < end || have > 0) {
+    size_t want = sizeof(buf) - have;
+    if (want > end - pos) want = end - pos;
+    size_t n = want ? f.read(reinterpret_cast<uint8_t*>(buf + have), want) : 0;
+    pos += (uint32_t)n;
+    have += n;
+    bool eof = n == 0 || pos >= end;
+    size_t at = 0;
+    while (at < have) {
+      const char* nl = (const char*)memchr(buf + at, '\n', have - at);
+      size_t len;
+      if (nl) len = (size_t)(nl - (buf + at)) + 1;
+      else if (eof || (at == 0 && have == sizeof(buf))) len = have - at;
+      else break;
+      const char* line = buf + at;
+      const char* when;
+      uint8_t level;
+      if (logParseLinePrefix(line, len, when, level)) {
+        lastPass = level >= q.minLevel && (!fromStr || memcmp(when, fromStr, kTimestampLen) >= 0) &&
+                   (!toStr || memcmp(when, toStr, kTimestampLen) <= 0);
+      }
+      at += len;
+      if (!lastPass) continue;
+      fn(ctx, line, len);
+      emitted++;
+      sent += len;
+      if (sent >= maxBytes) {
+        // Resume right after this piece
+        cur.offset = pos - (uint32_t)(have - at);
+        cur.passing = lastPass;
+        f.close();
+        return emitted;
+      }
+    }
+    memmove(buf, buf + at, have - at);
+    have -= at;
+    if (n == 0) break;
+  }
+  f.close();
+  cur.inSegment = false;
+  return emitted;
+}
+
+size_t LogStore::forEachDay(DayFn fn, void* ctx) const {
+  struct Day {
+    char date[11];
+    uint32_t bytes;
+  };
+  Day days[kMaxListedDays];
+  size_t dayCount = 0;
+
+  for (size_t i = 0; i < count_; ++i) {
+    const LogSegmentInfo& info = segments_[i];
+    if (info.bytes == 0 || info.firstEpoch == 0) continue;
+    time_t first = localNoon(info.firstEpoch);
+    time_t last = localNoon(info.lastEpoch);
+    uint32_t span = (uint32_t)((last - first + 43200) / 86400) + 1;
+    for (time_t t = first; t <= last + 3600; t += 86400) {
+      struct tm lt = {};
+      localtime_r(&t, &lt);
+      char date[11];
+      strftime(date, sizeof(date), "%Y-%m-%d", &lt);
+      size_t d = 0;
+      while (d < dayCount && strcmp(days[d].date, date) != 0) ++d;
+      if (d == dayCount) {
+        if (dayCount == kMaxListedDays) continue;
+        memcpy(days[d].date, date, sizeof(date));
+        days[d].bytes = 0;
+        dayCount++;
+      }
+      days[d].bytes += info.bytes / span;
+    }
+  }
+
+  // Newest first; dates sort as strings
+  for (size_t i = 1; i < dayCount; ++i) {
+    Day v = days[i];
+    size_t j = i;
+    while (j > 0 && strcmp(days[j - 1].date, v.date) < 0) {
+      days[j] = days[j - 1];
+      j--;
+    }
+    days[j] = v;
+  }
+  for (size_t i = 0; i < dayCount; ++i) fn(ctx, days[i].date, days[i].bytes);
+  return dayCount;
+}
+
+size_t LogStore::readUnsynced(LineFn fn, void* ctx) {
+  if (target_ == Target::Unsynced) {
+    commit();
+    if (file_) file_.flush();
+  }
+  File f = fs_.open(kUnsyncedPath, FILE_READ);
+  if (!f) return 0;
+  char buf[kQueryBufferBytes];
+  size_t total = 0;
+  while (true) {
+    size_t n = f.read(reinterpret_cast<uint8_t*>(buf), sizeof(buf));
+    if (n == 0) break;
+    fn(ctx, buf, n);
+    total += n;
+  }
+  f.close();
+  return total;
+}
+
+size_t LogStore::readUnsynced(uint32_t offset, uint8_t* buffer, size_t length) {
+  if (target_ == Target::Unsynced) {
+    commit();
+    if (file_) file_.flush();
+  }
+  File f = fs_.open(kUnsyncedPath, FILE_READ);
+  if (!f) return 0;
+  size_t n = f.seek(offset) ? f.read(buffer, length) : 0;
+  f.close();
+  return n;
+}
@@ -0,0 +1,202 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fs_compat.h"
+
+// Size at which the active segment is closed and a new one started.
+#ifndef LOG_SEGMENT_BYTES
+#define LOG_SEGMENT_BYTES 32768
+#endif
+// Total bytes kept across all segments; the oldest segments go first.
+#ifndef LOG_STORE_QUOTA_BYTES
+#define LOG_STORE_QUOTA_BYTES (512UL * 1024UL)
+#endif
+// Seek points per segment in the index (one every LOG_SEGMENT_BYTES / N bytes).
+#ifndef LOG_INDEX_CHECKPOINTS
+#define LOG_INDEX_CHECKPOINTS 8
+#endif
+// Bytes per write() call to LittleFS; a multiple of its cache size.
+#ifndef LOG_SINK_BATCH_BYTES
+#define LOG_SINK_BATCH_BYTES 512
+#endif
+
+static const size_t kLogStoreMaxSegments = LOG_STORE_QUOTA_BYTES / LOG_SEGMENT_BYTES + 1;
+
+/** Wall-clock second and byte offset of a line in a segment. */
+struct LogCheckpoint {
+  uint32_t epoch;
+  uint32_t offset;
+};
+
+/** Index entry for one segment file. */
+struct LogSegmentInfo {
+  uint32_t id;
+  uint32_t firstEpoch;   // earliest / latest timestamp in the segment
+  uint32_t lastEpoch;
+  uint32_t bytes;
+  uint16_t levelCounts[4];
+  uint8_t checkpointCount;
+  bool ordered;          // timestamps never went backwards, so checkpoints can be seeked
+  LogCheckpoint checkpoints[LOG_INDEX_CHECKPOINTS];
+};
+
+/** Filter for LogStore::query(). Bounds are inclusive epoch seconds. */
+struct LogQuery {
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  uint8_t minLevel = 0;
+};
+
+/** Where a query paused; see LogStore::queryMore(). */
+struct LogCursor {
+  LogQuery query;
+  uint32_t segment = 0;     // id of the segment being read, or last read
+  uint32_t offset = 0;      // next byte of it
+  uint32_t endSegment = 0;  // newest segment and its size when the query began
+  uint32_t endBytes = 0;
+  bool inSegment = false;   // paused inside `segment`
+  bool passing = false;     // verdict on the line a continuation piece belongs to
+  bool begun = false;
+  bool done = false;
+};
+
+/**
+ * @brief Size-bounded log store: fixed-size segments plus a small index
+ *
+ * Synced log lines go to /logs/seg-NNNNNN.log. A new segment starts once
+ * the active one reaches LOG_SEGMENT_BYTES, and the oldest segments are
+ * removed to stay under LOG_STORE_QUOTA_BYTES and the retention period.
+ * /logs/index.bin holds one LogSegmentInfo per segment: time range, level
+ * counts and seek checkpoints. Listing and summary answers come from the
+ * index, and query() opens only the segments that match, starting at the
+ * closest checkpoint.
+ *
+ * Lines written before the clock is synced (epoch 0) have no place on the
+ * timeline and go to /logs/unsynced.log instead, until logRewriteUnsynced()
+ * moves them in.
+ *
+ * Writes are batched in LOG_SINK_BATCH_BYTES chunks. Not thread-safe; the
+ * firmware serialises access with the log file mutex.
+ */
+class LogStore {
+public:
+  using LineFn = void (*)(void* ctx, const char* line, size_t length);
+  using DayFn = void (*)(void* ctx, const char* date, uint32_t bytes);
+
+  explicit LogStore(fs::FS& fs);
+
+  /** Load (or rebuild) the index. Moves the old per-day log files into segments. */
+  bool begin();
+
+  /**
+   * @brief Append one formatted line (prefix + text, newline included)
+   * @param epoch wall-clock second of the line, 0 if the clock was unsynced
+   * @param level LogLevel of the line
+   */
+  void append(uint32_t epoch, uint8_t level, const char* prefix, size_t prefixLen,
+              const char* text, size_t textLen);
+
+  /** Write the pending batch to the file and flush; saves the index if it changed. */
+  void flush();
+  /** Flush and close the open files. The next append() reopens. */
+  void close();
+  /** Remove every segment, the index and the unsynced file. */
+  void clear();
+
+  /** Delete the unsynced file once its lines have been moved into segments. */
+  void removeUnsynced();
+
+  /** Drop segments whose newest line is older than retentionDays before nowEpoch. */
+  void enforceRetention(uint32_t nowEpoch, uint32_t retentionDays);
+
+  /**
+   * @brief Stream every stored line matching q to fn, oldest first
+   * @return lines emitted
+   */
+  size_t query(const LogQuery& q, LineFn fn, void* ctx);
+  template <typename Fn>
+  size_t query(const LogQuery& q, Fn&& fn) {
+    return query(q, [](void* c, const char* line, size_t n) { (*static_cast<Fn*>(c))(line, n); }, &fn);
+  }
+
+  /**
+   * @brief Continue a query, stopping once at least maxBytes went to fn
+   *
+   * For readers that go at a client's pace and must not hold the store in
+   * between. Covers what was stored when the query began; segments removed
+   * since are skipped. Lines longer than the read buffer arrive in pieces.
+   * @return lines emitted; cur.done once nothing is left
+   */
+  size_t queryMore(LogCursor& cur, LineFn fn, void* ctx, size_t maxBytes);
+
+  /**
+   * @brief Report each local date ("YYYY-MM-DD") the segments cover, newest first
+   *
+   * Comes from the index alone. A segment that spans midnight splits its
+   * bytes evenly between its days, so sizes are approximate.
+   * @return days reported
+   */
+  size_t forEachDay(DayFn fn, void* ctx) const;
+
+  /** Copy the unsynced file to fn in pieces (not line-aligned). */
+  size_t readUnsynced(LineFn fn, void* ctx);
+  /** Up to `length` bytes of the unsynced file from `offset`; 0 at its end. */
+  size_t readUnsynced(uint32_t offset, uint8_t* buffer, size_t length);
+
+  size_t segmentCount() const { return count_; }
+  /** Segment i, oldest first. */
+  const LogSegmentInfo& segment(size_t i) const { return segments_[i]; }
+  uint32_t totalBytes() const;
+  uint32_t unsyncedBytes() const { return unsyncedBytes_; }
+  uint32_t batchCount() const { return batches_; }
+  uint32_t segmentsRemoved() const { return removed_; }
+
+  static void segmentPath(uint32_t id, char* out, size_t cap);
+  static const char* const kDir;
+  static const char* const kIndexPath;
+  static const char* const kUnsyncedPath;
+
+private:
+  enum class Target : uint8_t { None, Segment, Unsynced };
+
+  void put(const char* data, size_t length);
+  void commit();
+  bool openTarget(Target t);
+  void startSegment();
+  void removeOldest();
+  void noteLine(LogSegmentInfo& info, uint32_t epoch, uint8_t level, size_t length);
+  bool loadIndex();
+  bool saveIndex();
+  void rebuildIndex();
+  void scanSegment(LogSegmentInfo& info);
+  void importLegacyDays();
+  void importLegacyDay(const char* path, const char* name);
+  size_t querySegment(const LogSegmentInfo& info, LogCursor& cur, const char* fromStr, const char* toStr,
+                      LineFn fn, void* ctx, size_t maxBytes, size_t& sent);
+
+  fs::FS& fs_;
+  LogSegmentInfo segments_[kLogStoreMaxSegments];
+  size_t count_ = 0;
+  uint32_t nextId_ = 1;
+  bool indexDirty_ = false;
+
+  File file_;
+  Target target_ = Target::None;
+  char batch_[LOG_SINK_BATCH_BYTES];
+  size_t batchUsed_ = 0;
+  uint32_t unsyncedBytes_ = 0;
+  uint32_t batches_ = 0;
+  uint32_t removed_ = 0;
+};
+
+/**
+ * @brief Parse the "[YYYY-MM-DD HH:MM:SS.mmm TZ][LEVEL] " prefix of a stored line
+ * @param when receives the 19-character local timestamp (not terminated)
+ * @return false if the line does not start with a timestamped prefix
+ */
+bool logParseLinePrefix(const char* line, size_t length, const char*& when, uint8_t& level);
+
+#endif // LOG_STORE_H
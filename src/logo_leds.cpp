@@ -7,10 +7,10 @@
 LogoLeds logoLeds;
 
 void LogoLeds::begin() {
-  prefs.begin("logo", false);
-  brightness = prefs.getUChar("br", 64);
-  size_t read = prefs.getBytes("clr", colors, sizeof(colors));
-  prefs.end();
+  brightnessKey = settingsStore.addU8("logo", "br", 64);
+  brightness = settingsStore.getU8(brightnessKey);
+  colorsKey = settingsStore.addBytes("logo", "clr", colors, sizeof(colors));
+  size_t read = settingsStore.storedLength(colorsKey);
   const uint16_t expectedCount = getLogoLedCount();
   const size_t expectedBytes = sizeof(LogoLedColor) * expectedCount;
   const size_t storageBytes = sizeof(LogoLedColor) * LOGO_LED_STORAGE_COUNT;
@@ -60,17 +60,14 @@ void LogoLeds::flushColors() {
   persistColors();
 }
 
+// Both are committed with the other settings (settings_store.h)
 void LogoLeds::persistBrightness() {
-  prefs.begin("logo", false);
-  prefs.putUChar("br", brightness);
-  prefs.end();
+  settingsStore.setU8(brightnessKey, brightness);
 }
 
 void LogoLeds::persistColors() {
-  prefs.begin("logo", false);
   uint16_t count = getLogoLedCount();
-  prefs.putBytes("clr", colors, sizeof(LogoLedColor) * count);
-  prefs.end();
+  settingsStore.bytesChanged(colorsKey, sizeof(LogoLedColor) * count);
 }
 
 uint16_t getLogoStartIndex() {
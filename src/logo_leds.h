@@ -3,9 +3,9 @@
 #if defined(PRODUCT_VARIANT_LOGO)
 
 #include <Arduino.h>
-#include <Preferences.h>
 
 #include "grid_layout.h"
+#include "settings_store.h"
 
 constexpr uint16_t LOGO_LED_STORAGE_COUNT = 52;
 
@@ -35,7 +35,8 @@ private:
 
   LogoLedColor colors[LOGO_LED_STORAGE_COUNT];
   uint8_t brightness = 64;
-  Preferences prefs;
+  SettingKey brightnessKey = SETTING_NONE;
+  SettingKey colorsKey = SETTING_NONE;  // `colors` is its shadow
 };
 
 extern LogoLeds logoLeds;
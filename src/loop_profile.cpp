@@ -0,0 +1,54 @@
+#include "loop_profile.h"
+
+#include <Arduino.h>
+
+namespace {
+
+const char* const kStageNames[] = {
+  "pass", "network", "http", "ota", "mqtt", "heartbeat", "wordclock", "led_events",
+};
+static_assert(sizeof(kStageNames) / sizeof(kStageNames[0]) == LOOP_STAGE_COUNT,
+              "a name per LoopStage");
+
+// ~4 KB of counters in all; fixed, so profiling never touches the heap
+LatencyHistogram s_stages[LOOP_STAGE_COUNT];
+LatencyHistogram s_show[LOOP_SHOW_SEGMENTS];
+const LatencyHistogram s_empty;
+
+}  // namespace
+
+void loopStageRecord(LoopStage stage, uint32_t us) {
+  uint8_t i = static_cast<uint8_t>(stage);
+  if (i < LOOP_STAGE_COUNT) s_stages[i].record(us);
+}
+
+void loopShowRecord(uint8_t segment, uint32_t us) {
+  if (segment < LOOP_SHOW_SEGMENTS) s_show[segment].record(us);
+}
+
+uint32_t loopProfileNowUs() {
+#ifndef PIO_UNIT_TESTING
+  return micros();
+#else
+  return static_cast<uint32_t>(millis() * 1000UL);
+#endif
+}
+
+const LatencyHistogram& loopStageHistogram(LoopStage stage) {
+  uint8_t i = static_cast<uint8_t>(stage);
+  return i < LOOP_STAGE_COUNT ? s_stages[i] : s_empty;
+}
+
+const LatencyHistogram& loopShowHistogram(uint8_t segment) {
+  return segment < LOOP_SHOW_SEGMENTS ? s_show[segment] : s_empty;
+}
+
+const char* loopStageName(LoopStage stage) {
+  uint8_t i = static_cast<uint8_t>(stage);
+  return i < LOOP_STAGE_COUNT ? kStageNames[i] : "none";
+}
+
+void loopProfileReset() {
+  for (LatencyHistogram& h : s_stages) h.reset();
+  for (LatencyHistogram& h : s_show) h.reset();
+}
@@ -0,0 +1,60 @@
+#ifndef LOOP_PROFILE_H
+#define LOOP_PROFILE_H
+
+#include <stdint.h>
+
+#include "latency_histogram.h"
+
+/*
+ * Where loop() time goes: a LatencyHistogram per runtime stage and per LED
+ * data line, since boot
+ *
+ * A stage is timed with a LoopStageTimer around its call. Route handlers
+ * run on the server task but under the same app lock as loop(), so the
+ * time they hold it is the `http` stage; `pass` is one whole loop() pass.
+ * Served at /api/perf/loop, summarized in the heartbeat and over MQTT.
+ */
+
+/** Timed stages. Names in loop_profile.cpp, in the same order. */
+enum class LoopStage : uint8_t {
+  Pass,       // one loop() pass, all stages included
+  Network,    // processNetwork()
+  Http,       // a route handler, on the server task
+  Ota,        // ArduinoOTA.handle()
+  Mqtt,       // mqttEventLoop()
+  Heartbeat,  // processHeartbeat()
+  Wordclock,  // runWordclockLoop()
+  LedEvents,  // ledEventsTick()
+  Count
+};
+
+static const uint8_t LOOP_STAGE_COUNT = static_cast<uint8_t>(LoopStage::Count);
+// One histogram per physical LED data line (led_controller.cpp)
+static const uint8_t LOOP_SHOW_SEGMENTS = 4;
+
+void loopStageRecord(LoopStage stage, uint32_t us);
+/** One Adafruit_NeoPixel::show() on data line `segment`. */
+void loopShowRecord(uint8_t segment, uint32_t us);
+/** The microsecond clock the timers use. */
+uint32_t loopProfileNowUs();
+
+const LatencyHistogram& loopStageHistogram(LoopStage stage);
+const LatencyHistogram& loopShowHistogram(uint8_t segment);
+const char* loopStageName(LoopStage stage);
+/** Starts every histogram over. */
+void loopProfileReset();
+
+/** Records the time from construction to the end of the scope as `stage`. */
+class LoopStageTimer {
+public:
+  explicit LoopStageTimer(LoopStage stage) : stage_(stage), startUs_(loopProfileNowUs()) {}
+  ~LoopStageTimer() { loopStageRecord(stage_, loopProfileNowUs() - startUs_); }
+  LoopStageTimer(const LoopStageTimer&) = delete;
+  LoopStageTimer& operator=(const LoopStageTimer&) = delete;
+
+private:
+  LoopStage stage_;
+  uint32_t startUs_;
+};
+
+#endif // LOOP_PROFILE_H
@@ -18,7 +18,7 @@
 #if OTA_ENABLED
 #include <ArduinoOTA.h>
 #endif
-#include <WebServer.h>
+#include "http_server.h"
 #include "wordclock.h"
 #include "network_init.h"
 #include "log.h"
@@ -29,6 +29,11 @@
 #include "night_mode.h"
 #include "language_settings.h"
 #include "settings_migration.h"
+#include "settings_store.h"
+#include "boot_orchestrator.h"
+#include "boot_profile.h"
+#include "loop_profile.h"
+#include "retained_clock.h"
 #include "system_utils.h"
 #include "ble_provisioning.h"
 #include "led_controller.h"
@@ -41,69 +46,181 @@ UiAuth uiAuth;
 bool g_wifiHadCredentialsAtBoot = false;
 
 
-// Webserver
-WebServer server(80);
+// Webserver (serves from its own task; see HttpAppLock)
+HttpServer server(80);
 
-// Setup: initialiseert hardware, netwerk, OTA, filesystem en start de hoofdservices
-void setup() {
+namespace {
+
+// Boot steps. Each runs once its needs have finished (boot_orchestrator.h);
+// the network, NTP and the start delay run in the background, so the clock
+// face comes up while WiFi connects.
+
+unsigned long g_startDelayFromMs = 0;
+
+void startEarly() {
   Serial.begin(SERIAL_BAUDRATE);
-  
   // Clear LEDs immediately to prevent garbage flash during boot
   earlyLedClear();
-  
-  delay(MDNS_START_DELAY_MS);
+  applyTimeZone(TZ_INFO);
+  // After a warm restart the first frame shows the time from before it
+  restoreRetainedTime();
+}
+
+// Held back from mDNS and the web server only; nothing else waits for it
+void startStartDelay() { g_startDelayFromMs = millis(); }
+bool pollStartDelay(unsigned long nowMs) { return nowMs - g_startDelayFromMs >= MDNS_START_DELAY_MS; }
+
+void startSettings() {
+  // Before anything registers settings: one blob read instead of a
+  // namespace lookup per key, when the snapshot is current
+  settingsStore.loadSnapshot();
   initLogSettings();
+}
 
-  // IMPORTANT: Migrate settings before initializing them
-  SettingsMigration::migrateIfNeeded();
+// IMPORTANT: Migrate settings before initializing them
+void startMigration() { SettingsMigration::migrateIfNeeded(); }
+
+void startBle() { initBleProvisioning(); }
+
+// WiFiManager (WiFi-instellingen en verbinding)
+void startNetworkStep() { startNetwork(); }
+bool pollNetworkStep(unsigned long nowMs) {
+  if (!pollNetworkStart(nowMs)) return false;
+  if (isWiFiConnected()) bootMilestone(BootMilestone::WifiConnected);
+  return true;
+}
 
-  initBleProvisioning();
-  initNetwork();              // WiFiManager (WiFi-instellingen en verbinding)
 #if OTA_ENABLED
+void startOta() {
   initOTA();                  // OTA (Over-the-air updates)
-  
+
   // Register flush handler for OTA start
   ArduinoOTA.onStart([]() {
     flushAllSettings();
   });
+}
 #endif
 
-  // mDNS is registered by runtimeInitOnSetup() below, together with the web
-  // server and the other services that need a live STA interface — and
-  // re-registered from the loop after a reconnect. It used to be started here,
-  // which meant a boot without WiFi left the clock nameless until someone
-  // power-cycled it. See runtime_services.cpp:startMdns().
+// Load persisted display settings (e.g. auto-update preference) before running dependent flows
+void startDisplaySettings() { displaySettings.begin(); }
 
-  // Load persisted display settings (e.g. auto-update preference) before running dependent flows
-  displaySettings.begin();
+// Selects the grid variant and phrase table. Must run before anything reads
+// ACTIVE_WORDS or the LED counts, i.e. before initDisplay().
+void startLanguage() { LanguageSettings::begin(); }
 
-  // Selects the grid variant and phrase table. Must run before anything reads
-  // ACTIVE_WORDS or the LED counts, i.e. before initDisplay() below.
-  LanguageSettings::begin();
+void startNightMode() { nightMode.begin(); }
 
-  nightMode.begin();
-
-  // Mount filesystem (LittleFS)
+// Mount filesystem (LittleFS)
+void startFilesystem() {
   if (!FS_IMPL.begin(true)) {
     logError("LittleFS mount failed.");
   } else {
     logDebug("LittleFS loaded successfully.");
     logEnableFileSink();
   }
+}
+
+// mDNS is registered by runtimeInitOnSetup(), together with the web server
+// and the other services that need a live STA interface — and re-registered
+// from the loop after a reconnect. See runtime_services.cpp:startMdns().
+void startServices() { runtimeInitOnSetup(isWiFiConnected(), server); }
+
+// Synchroniseer tijd via NTP
+void startTimeSyncStep() { startTimeSync(TZ_INFO, NTP_SERVER1, NTP_SERVER2); }
+
+void startDisplay() { initDisplay(); }
+void startWordclock() { initWordclockSystem(uiAuth); }
+void startStartupSequence() { initStartupSequence(startupSequence); }
+
+void declareBootSteps() {
+  const BootStepMask settings = bootStep(BootPhase::Migration);
+#if OTA_ENABLED
+  const BootStepMask ota = bootStep(BootPhase::Ota);
+#else
+  const BootStepMask ota = 0;
+#endif
+
+  BootOrchestrator& b = bootOrchestrator;
+  b.add(BootPhase::Early, 0, startEarly);
+  b.add(BootPhase::Settings, bootStep(BootPhase::Early), startSettings);
+  b.add(BootPhase::Migration, bootStep(BootPhase::Settings), startMigration);
+  b.add(BootPhase::Ble, settings, startBle);
+  b.add(BootPhase::Network, bootStep(BootPhase::Ble), startNetworkStep, pollNetworkStep);
+  b.add(BootPhase::StartDelay, bootStep(BootPhase::Early), startStartDelay, pollStartDelay);
+  b.add(BootPhase::DisplaySettings, settings, startDisplaySettings);
+  b.add(BootPhase::Language, settings, startLanguage);
+  b.add(BootPhase::NightMode, settings, startNightMode);
+  b.add(BootPhase::Filesystem, bootStep(BootPhase::Settings), startFilesystem);
+  // The clock face: LEDs need the layout, the layout needs the language
+  b.add(BootPhase::Display, bootStep(BootPhase::DisplaySettings) | bootStep(BootPhase::Language),
+        startDisplay);
+  b.add(BootPhase::Wordclock, bootStep(BootPhase::Display) | bootStep(BootPhase::NightMode),
+        startWordclock);
+  b.add(BootPhase::StartupSequence, bootStep(BootPhase::Wordclock), startStartupSequence);
+  // What needs the network
+#if OTA_ENABLED
+  b.add(BootPhase::Ota, bootStep(BootPhase::Network), startOta);
+#endif
+  b.add(BootPhase::TimeSync, bootStep(BootPhase::Network), startTimeSyncStep, pollTimeSync);
+  // The web routes check uiAuth (Wordclock) and serve from LittleFS
+  b.add(BootPhase::Services,
+        bootStep(BootPhase::Network) | bootStep(BootPhase::StartDelay) | ota |
+        bootStep(BootPhase::Filesystem) | bootStep(BootPhase::Wordclock),
+        startServices);
+}
+
+// The background boot steps; logs the boot once all have finished
+void runBootSteps() {
+  if (bootOrchestrator.done() || !bootOrchestrator.run()) return;
+  const BootTimeline& boot = bootTimeline();
+  uint8_t slowest = bootSlowestPhase();
+  logInfof("⏱️ Boot done at %lu ms (setup %lu ms), slowest step %s (%lu ms)",
+           (unsigned long)boot.milestone(BootMilestone::BootDone),
+           (unsigned long)boot.milestone(BootMilestone::SetupDone), bootPhaseName(slowest),
+           slowest < BOOT_PHASE_COUNT ? (unsigned long)(boot.durationUs[slowest] / 1000) : 0UL);
+}
+
+} // namespace
+
+// Setup: initialiseert hardware, netwerk, OTA, filesystem en start de hoofdservices
+void setup() {
+  // Route handlers wait until setup() is done
+  HttpAppLock appLock;
+  // Where boot time goes; see /api/perf/boot
+  bootProfileBegin();
+  declareBootSteps();
+  // Runs every step that does not wait for the network; loop() finishes the rest
+  bootOrchestrator.run();
+  if (!bootOrchestrator.valid()) {
+    logError("⏱️ Boot steps wait for a step that never runs");
+  }
 
-  bool wifiConnected = isWiFiConnected();
-  runtimeInitOnSetup(wifiConnected, server);
+  settingsStore.finishBoot();
+  SettingsStoreStats settings = settingsStore.stats(millis());
+  logInfof("⚙️ %u settings loaded in %lu us (%s)", (unsigned)settings.keys,
+           (unsigned long)settings.loadUs,
+           settings.snapshotLoaded ? "snapshot" : "per key");
 
-  // Synchroniseer tijd via NTP
-  initTimeSync(TZ_INFO, NTP_SERVER1, NTP_SERVER2);
-  initDisplay();
-  initWordclockSystem(uiAuth);
-  initStartupSequence(startupSequence);
+  bootMilestone(BootMilestone::SetupDone);
+  if (timeWasRestored()) {
+    logInfo("🕒 Clock carried over the restart; NTP to confirm");
+  }
+  if (previousBootIncomplete()) {
+    logWarnf("⏱️ Previous boot reset during %s",
+             bootPhaseName(previousBootTimeline()->stuckPhase()));
+  }
 }
 
 // Loop: hoofdprogramma, verwerkt webrequests, OTA, MQTT en kloklogica
 void loop() {
-  processNetwork();
+  // Route handlers run between passes, never during one
+  HttpAppLock appLock;
+  LoopStageTimer passTimer(LoopStage::Pass);
+  runBootSteps();
+  {
+    LoopStageTimer t(LoopStage::Network);
+    processNetwork();
+  }
   processBleProvisioning();
   const bool wifiConnected = isWiFiConnected();
   runtimeHandleWifiTransitionLogs(wifiConnected);
@@ -115,8 +232,10 @@ void loop() {
     // for ~30µs/LED — at 20fps for a 121-LED grid that's ~72ms/sec of
     // interrupt-disabled time, which chokes WiFi/lwIP. No useful clock
     // face to render anyway (no NTP yet). The LedEvents tick still runs so
-    // the WifiManagerPortal heartbeat indicator stays visible.
-    if (!isBleProvisioningActive() && !isInitialSetupMode()) {
+    // the WifiManagerPortal heartbeat indicator stays visible. At boot the
+    // startup sweep plays here while WiFi is still connecting.
+    if (!isBleProvisioningActive() && !isInitialSetupMode() &&
+        !runtimeHandleStartupSequence(startupSequence)) {
       runtimeHandleWordclockLoop(nowMs);
     }
     runtimeHandleLedEvents(nowMs);
@@ -0,0 +1,112 @@
+#include "mem_pool.h"
+
+#include <atomic>
+#include <string.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <esp_heap_caps.h>
+#include <soc/soc_memory_layout.h>
+#endif
+
+namespace {
+
+struct PoolCounters {
+  std::atomic<size_t> inUse{0};
+  std::atomic<size_t> highWater{0};
+  std::atomic<uint32_t> allocs{0};
+  std::atomic<uint32_t> failures{0};
+  std::atomic<uint32_t> fallbacks{0};
+};
+
+PoolCounters g_pools[2];
+
+PoolCounters& counters(MemPool pool) {
+  return g_pools[pool == MemPool::Bulk ? 1 : 0];
+}
+
+void recordAlloc(PoolCounters& c, size_t bytes) {
+  c.allocs.fetch_add(1, std::memory_order_relaxed);
+  size_t now = c.inUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = c.highWater.load(std::memory_order_relaxed);
+  while (now > peak && !c.highWater.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+  }
+}
+
+#ifndef PIO_UNIT_TESTING
+const uint32_t kInternalCaps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+const uint32_t kExternalCaps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+#endif
+
+}  // namespace
+
+void* poolAlloc(MemPool pool, size_t bytes) {
+  if (bytes == 0) return nullptr;
+  PoolCounters& c = counters(pool);
+  void* p = nullptr;
+#ifndef PIO_UNIT_TESTING
+  if (pool == MemPool::Bulk) {
+    p = heap_caps_malloc(bytes, kExternalCaps);
+    if (!p) {
+      p = heap_caps_malloc(bytes, kInternalCaps);
+      if (p) c.fallbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+  } else {
+    p = heap_caps_malloc(bytes, kInternalCaps);
+  }
+#else
+  p = malloc(bytes);
+#endif
+  if (!p) {
+    c.failures.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  recordAlloc(c, bytes);
+  return p;
+}
+
+void* poolCalloc(MemPool pool, size_t bytes) {
+  void* p = poolAlloc(pool, bytes);
+  if (p) memset(p, 0, bytes);
+  return p;
+}
+
+void poolFree(MemPool pool, void* ptr, size_t bytes) {
+  if (!ptr) return;
+  counters(pool).inUse.fetch_sub(bytes, std::memory_order_relaxed);
+#ifndef PIO_UNIT_TESTING
+  // Pairs with heap_caps_malloc(); plain free() would reach the tracker's
+  // free wrap for a block it never saw allocated
+  heap_caps_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+MemPoolStats poolStats(MemPool pool) {
+  const PoolCounters& c = counters(pool);
+  MemPoolStats s;
+  s.inUse = c.inUse.load(std::memory_order_relaxed);
+  s.highWater = c.highWater.load(std::memory_order_relaxed);
+  s.allocs = c.allocs.load(std::memory_order_relaxed);
+  s.failures = c.failures.load(std::memory_order_relaxed);
+  s.fallbacks = c.fallbacks.load(std::memory_order_relaxed);
+#ifndef PIO_UNIT_TESTING
+  s.freeBytes = heap_caps_get_free_size(pool == MemPool::Bulk ? kExternalCaps : kInternalCaps);
+#else
+  s.freeBytes = 0;
+#endif
+  return s;
+}
+
+const char* poolName(MemPool pool) {
+  return pool == MemPool::Bulk ? "bulk" : "hot";
+}
+
+bool poolIsExternal(const void* ptr) {
+#ifndef PIO_UNIT_TESTING
+  return ptr && esp_ptr_external_ram(ptr);
+#else
+  (void)ptr;
+  return false;
+#endif
+}
@@ -0,0 +1,108 @@
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * @brief Where a buffer should live
+ *
+ * Hot: internal SRAM. For memory touched from time-critical code and
+ * anything handed to DMA. Internal SRAM is also what WiFi and TLS allocate
+ * from, so only what has to be here should be.
+ *
+ * Bulk: PSRAM when the board has it. For large buffers that are filled once
+ * and read sequentially: the log ring, JSON arenas, the MQTT outbox, OTA
+ * download buffers, animation frames. A Bulk request the PSRAM cannot serve
+ * falls back to internal SRAM and is counted as a fallback.
+ *
+ * Native builds have one heap; both pools come from malloc and only the
+ * accounting differs.
+ */
+enum class MemPool : uint8_t { Hot, Bulk };
+
+/** Allocation counters of one pool, as reported in the heartbeat. */
+struct MemPoolStats {
+  size_t inUse;        // bytes currently allocated through the pool
+  size_t highWater;    // most bytes allocated at once since boot
+  uint32_t allocs;     // successful allocations
+  uint32_t failures;   // allocations nothing could serve
+  uint32_t fallbacks;  // Bulk allocations served from internal SRAM
+  size_t freeBytes;    // free bytes left in the pool's memory (0 on native)
+};
+
+/** Allocate from `pool`; nullptr when nothing could serve it. */
+void* poolAlloc(MemPool pool, size_t bytes);
+/** As poolAlloc, zero-filled. */
+void* poolCalloc(MemPool pool, size_t bytes);
+/** Give back a block; `bytes` is the size it was allocated with. */
+void poolFree(MemPool pool, void* ptr, size_t bytes);
+
+MemPoolStats poolStats(MemPool pool);
+/** "hot" or "bulk". */
+const char* poolName(MemPool pool);
+/** The block is in PSRAM (always false on native). */
+bool poolIsExternal(const void* ptr);
+
+/**
+ * @brief STL allocator drawing from one pool
+ *
+ * Runs out of memory the way std::allocator does in a build without
+ * exceptions: it aborts.
+ */
+template <typename T, MemPool P>
+struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U, P>&) {}
+
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U, P>;
+  };
+
+  T* allocate(size_t n) {
+    void* p = poolAlloc(P, n * sizeof(T));
+    if (!p) abort();
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, size_t n) { poolFree(P, p, n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U, P>&) const { return true; }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U, P>&) const { return false; }
+};
+
+/** A vector whose elements live in the Bulk pool. */
+template <typename T>
+using BulkVector = std::vector<T, PoolAllocator<T, MemPool::Bulk>>;
+
+/**
+ * @brief A fixed buffer from a pool, freed when it goes out of scope
+ *
+ * For the scratch buffers that used to be stack arrays or bare mallocs.
+ * Check data() before use; it is nullptr when the allocation failed.
+ */
+class PoolBuffer {
+public:
+  PoolBuffer(MemPool pool, size_t bytes)
+      : pool_(pool), data_(static_cast<uint8_t*>(poolAlloc(pool, bytes))), size_(data_ ? bytes : 0) {}
+  ~PoolBuffer() { poolFree(pool_, data_, size_); }
+  PoolBuffer(const PoolBuffer&) = delete;
+  PoolBuffer& operator=(const PoolBuffer&) = delete;
+
+  uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  MemPool pool_;
+  uint8_t* data_;
+  size_t size_;
+};
+
+#endif // MEM_POOL_H
@@ -3,13 +3,19 @@
 #include "led_events.h"
 #include "mqtt_command_handler.h"
 #include "mqtt_discovery_builder.h"
+#include "mqtt_outbox.h"
+#include "mqtt_publisher.h"
+#include "mqtt_setup.h"
+#include "mqtt_topics.h"
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include "config.h"
 #include "display_settings.h"
+#include "fixed_string.h"
 #include "led_state.h"
 #include "log.h"
+#include "loop_profile.h"
 #if OTA_ENABLED
 #include "ota_updater.h"
 #include "update_status.h"
@@ -20,8 +26,10 @@
 #include "mqtt_settings.h"
 #include <esp_system.h>
 #include <Preferences.h>
+#include <memory>
 #include "night_mode.h"
 #include "system_utils.h"
+#include "state_events.h"
 
 extern DisplaySettings displaySettings;
 extern bool clockEnabled;
@@ -32,35 +40,28 @@ static PubSubClient mqtt(espClient);
 
 static String uniqId;
 static MqttSettings g_mqttCfg;
-static String base;         // e.g., MQTT_BASE_TOPIC
-static String availTopic;   // base + "/availability"
-static String tBirth;
 static bool g_connected = false;
-static String g_lastErr;
-
-// Topics
-static String tLightState, tLightSet;
-static String tClockState, tClockSet;
-static String tAnimState, tAnimSet;
-static String tAutoUpdState, tAutoUpdSet;
-static String tHetIsState, tHetIsSet;
-static String tLogLvlState, tLogLvlSet;
-static String tRestartCmd, tSeqCmd, tUpdateCmd;
-static String tNightEnabledState, tNightEnabledSet;
-static String tNightOverrideState, tNightOverrideSet;
-static String tNightActiveState;
-static String tNightEffectState, tNightEffectSet;
-static String tNightDimState, tNightDimSet;
-static String tNightStartState, tNightStartSet;
-static String tNightEndState, tNightEndSet;
-static String tVersion, tUiVersion, tIp, tRssi, tUptime;
-static String tHeap, tWifiChan, tBootReason, tResetCount;
-static String tUpdateChannelState, tUpdateAutoAllowed, tUpdateAvailable;
-static String tUpdateRunning;
+static FixedString<96> g_lastErr;
+
+// Topics: rendered once per base into a fixed arena (see mqtt_topics.h)
+static MqttTopicTable g_topics;
+static MqttPublisher g_pub(mqtt, g_topics);
+// Publishes made while the broker is away; drained after the session is back
+static MqttOutbox g_outbox;
+static unsigned long g_outboxDrainStart = 0;
+static unsigned long g_outboxLastDrainMs = 0;
+// "<discovery prefix>/status", where Home Assistant announces online/offline
+static char g_haStatusTopic[96] = "";
 
 static unsigned long lastReconnectAttempt = 0;
 static unsigned long lastStateAt = 0;
+static unsigned long lastRefreshAt = 0;
 static const unsigned long STATE_INTERVAL_MS = 30000; // 30s
+// StateChange bits set by the settings classes (see state_events.h)
+static uint8_t g_dirtyGroups = 0;
+static unsigned long g_savedWindowStart = 0;
+static uint32_t g_savedAtWindowStart = 0;
+static uint32_t g_savedPerHour = 0;
 static const unsigned long RECONNECT_DELAY_MIN_MS = 2000;
 static const unsigned long RECONNECT_DELAY_MAX_MS = 60000;
 static const unsigned long RECONNECT_PAUSED_RETRY_MS = 300000;
@@ -70,160 +71,126 @@ static bool reconnectAborted = false;
 static unsigned long lastPausedRetryMs = 0;
 
 static void buildTopics() {
-  base = g_mqttCfg.baseTopic;
-  availTopic = base + "/availability";
-  tBirth        = base + "/birth";
-  tLightState   = base + "/light/state";
-  tLightSet     = base + "/light/set";
-  tClockState   = base + "/clock/state";
-  tClockSet     = base + "/clock/set";
-  tAnimState    = base + "/animate/state";
-  tAnimSet      = base + "/animate/set";
-  tHetIsState   = base + "/hetis/state";
-  tHetIsSet     = base + "/hetis/set";
-  tNightEnabledState = base + "/nightmode/enabled/state";
-  tNightEnabledSet   = base + "/nightmode/enabled/set";
-  tNightOverrideState = base + "/nightmode/override/state";
-  tNightOverrideSet   = base + "/nightmode/override/set";
-  tNightActiveState   = base + "/nightmode/active";
-  tNightEffectState = base + "/nightmode/effect/state";
-  tNightEffectSet   = base + "/nightmode/effect/set";
-  tNightDimState    = base + "/nightmode/dim/state";
-  tNightDimSet      = base + "/nightmode/dim/set";
-  tNightStartState  = base + "/nightmode/start/state";
-  tNightStartSet    = base + "/nightmode/start/set";
-  tNightEndState    = base + "/nightmode/end/state";
-  tNightEndSet      = base + "/nightmode/end/set";
-  tLogLvlState  = base + "/loglevel/state";
-  tLogLvlSet    = base + "/loglevel/set";
-  tRestartCmd   = base + "/restart/press";
-  tSeqCmd       = base + "/sequence/press";
-  tVersion      = base + "/version";
-  tUiVersion    = base + "/uiversion";
-  tIp           = base + "/ip";
-  tRssi         = base + "/rssi";
-  tUptime       = base + "/laststartup";
-  tHeap         = base + "/heap";
-  tWifiChan     = base + "/wifi_channel";
-  tBootReason   = base + "/boot_reason";
-  tResetCount   = base + "/reset_count";
-#if OTA_ENABLED
-  tAutoUpdState = base + "/autoupdate/state";
-  tAutoUpdSet   = base + "/autoupdate/set";
-  tUpdateCmd    = base + "/update/press";
-  tUpdateChannelState = base + "/update/channel";
-  tUpdateAutoAllowed  = base + "/update/auto_allowed";
-  tUpdateAvailable    = base + "/update/available";
-  tUpdateRunning      = base + "/update/running";
-#endif
+  if (!g_topics.build(g_mqttCfg.baseTopic.c_str())) {
+    logError(String("❌ MQTT base topic too long for topic table (") + MQTT_TOPIC_ARENA_SIZE + " bytes)");
+  }
+  int n = snprintf(g_haStatusTopic, sizeof(g_haStatusTopic), "%s/status",
+                   g_mqttCfg.discoveryPrefix.c_str());
+  if (n < 0 || (size_t)n >= sizeof(g_haStatusTopic)) g_haStatusTopic[0] = '\0';
 }
 
-static void publishDiscovery() {
+// Discovery set for the current session. Built on demand by the setup
+// sequence, published a few documents per tick and released once done; the
+// ~25 JsonDocuments only occupy the heap while a publish is in progress.
+static std::unique_ptr<MqttDiscoveryBuilder> g_discovery;
+static MqttDiscoveryCache g_discoveryCache;
+static uint32_t g_discoveryHash = 0;
+static bool g_discoveryPending = false;
+static bool g_discoveryRepublish = false;
+
+static void buildDiscovery() {
   String nodeId = uniqId;
   
-  MqttDiscoveryBuilder builder(mqtt, g_mqttCfg.discoveryPrefix, 
-                               nodeId, base, availTopic);
+  g_discovery.reset(new MqttDiscoveryBuilder(mqtt, g_mqttCfg.discoveryPrefix, 
+                                             nodeId, g_topics.base(),
+                                             g_topics.get(MqttTopic::Availability)));
+  MqttDiscoveryBuilder& builder = *g_discovery;
   
   // Set device information
   builder.setDeviceInfo(CLOCK_NAME, "Chronolett Wordclock", "Lumetric", FIRMWARE_VERSION);
   
   // Light entity
-  builder.addLight(tLightState, tLightSet);
+  builder.addLight(g_topics.get(MqttTopic::LightState), g_topics.get(MqttTopic::LightSet));
   
   // Switches
-  builder.addSwitch("Animate words", nodeId + "_anim", tAnimState, tAnimSet);
+  builder.addSwitch("Animate words", nodeId + "_anim", g_topics.get(MqttTopic::AnimState), g_topics.get(MqttTopic::AnimSet));
 #if OTA_ENABLED
-  builder.addSwitch("Auto update", nodeId + "_autoupd", tAutoUpdState, tAutoUpdSet);
+  builder.addSwitch("Auto update", nodeId + "_autoupd", g_topics.get(MqttTopic::AutoUpdateState), g_topics.get(MqttTopic::AutoUpdateSet));
 #endif
   builder.addSwitch("Night mode enabled", nodeId + "_night_enabled", 
-                   tNightEnabledState, tNightEnabledSet);
+                   g_topics.get(MqttTopic::NightEnabledState), g_topics.get(MqttTopic::NightEnabledSet));
   
   // Select entities
   builder.addSelect("Night mode effect", nodeId + "_night_effect",
-                   tNightEffectState, tNightEffectSet,
+                   g_topics.get(MqttTopic::NightEffectState), g_topics.get(MqttTopic::NightEffectSet),
                    {"DIM", "OFF"});
   builder.addSelect("Night mode override", nodeId + "_night_override",
-                   tNightOverrideState, tNightOverrideSet,
+                   g_topics.get(MqttTopic::NightOverrideState), g_topics.get(MqttTopic::NightOverrideSet),
                    {"AUTO", "ON", "OFF"});
   builder.addSelect("Log level", nodeId + "_loglevel",
-                   tLogLvlState, tLogLvlSet,
+                   g_topics.get(MqttTopic::LogLevelState), g_topics.get(MqttTopic::LogLevelSet),
                    {"DEBUG", "INFO", "WARN", "ERROR"});
   
   // Number entities
   builder.addNumber("Night mode dim %", nodeId + "_night_dim",
-                   tNightDimState, tNightDimSet,
+                   g_topics.get(MqttTopic::NightDimState), g_topics.get(MqttTopic::NightDimSet),
                    0, 100, 1, "%");
 #if !defined(PRODUCT_VARIANT_MINI)
   builder.addNumber("'HET IS' seconds", nodeId + "_hetis",
-                   tHetIsState, tHetIsSet,
+                   g_topics.get(MqttTopic::HetIsState), g_topics.get(MqttTopic::HetIsSet),
                    0, 360, 1, "s");
 #endif
   
   // Binary sensor
   builder.addBinarySensor("Night mode active", nodeId + "_night_active",
-                         tNightActiveState);
+                         g_topics.get(MqttTopic::NightActive));
 #if OTA_ENABLED
   builder.addBinarySensor("Update running", nodeId + "_update_running",
-                         tUpdateRunning);
+                         g_topics.get(MqttTopic::UpdateRunning));
 #endif
   
   // Buttons
-  builder.addButton("Restart", nodeId + "_restart", tRestartCmd, "restart");
-  builder.addButton("Start sequence", nodeId + "_sequence", tSeqCmd);
+  builder.addButton("Restart", nodeId + "_restart", g_topics.get(MqttTopic::RestartPress), "restart");
+  builder.addButton("Start sequence", nodeId + "_sequence", g_topics.get(MqttTopic::SequencePress));
 #if OTA_ENABLED
-  builder.addButton("Check for update", nodeId + "_update", tUpdateCmd, "update");
+  builder.addButton("Check for update", nodeId + "_update", g_topics.get(MqttTopic::UpdatePress), "update");
 #endif
   
   // Sensors
-  builder.addSensor("Firmware Version", nodeId + "_version", tVersion);
-  builder.addSensor("UI Version", nodeId + "_uiversion", tUiVersion);
-  builder.addSensor("IP Address", nodeId + "_ip", tIp);
-  builder.addSensor("WiFi RSSI", nodeId + "_rssi", tRssi, "dBm", "signal_strength");
-  builder.addSensor("Last Startup", nodeId + "_uptime", tUptime, "", "timestamp");
-  builder.addSensor("Free Heap (bytes)", nodeId + "_heap", tHeap, "bytes");
-  builder.addSensor("WiFi Channel", nodeId + "_wifichan", tWifiChan);
-  builder.addSensor("Boot Reason", nodeId + "_bootreason", tBootReason);
-  builder.addSensor("Reset Count", nodeId + "_resetcount", tResetCount);
+  builder.addSensor("Firmware Version", nodeId + "_version", g_topics.get(MqttTopic::Version));
+  builder.addSensor("UI Version", nodeId + "_uiversion", g_topics.get(MqttTopic::UiVersion));
+  builder.addSensor("IP Address", nodeId + "_ip", g_topics.get(MqttTopic::Ip));
+  builder.addSensor("WiFi RSSI", nodeId + "_rssi", g_topics.get(MqttTopic::Rssi), "dBm", "signal_strength");
+  builder.addSensor("Last Startup", nodeId + "_uptime", g_topics.get(MqttTopic::LastStartup), "", "timestamp");
+  builder.addSensor("Free Heap (bytes)", nodeId + "_heap", g_topics.get(MqttTopic::Heap), "bytes");
+  builder.addSensor("WiFi Channel", nodeId + "_wifichan", g_topics.get(MqttTopic::WifiChannel));
+  builder.addSensor("Boot Reason", nodeId + "_bootreason", g_topics.get(MqttTopic::BootReason));
+  builder.addSensor("Reset Count", nodeId + "_resetcount", g_topics.get(MqttTopic::ResetCount));
+  builder.addSensor("MQTT messages saved", nodeId + "_mqtt_saved",
+                   g_topics.get(MqttTopic::MqttSavedPerHour), "msg/h", "", "measurement");
+  builder.addSensor("Loop time p99", nodeId + "_loop_p99",
+                   g_topics.get(MqttTopic::LoopP99), "μs", "duration", "measurement");
+  builder.addSensor("Loop time max", nodeId + "_loop_max",
+                   g_topics.get(MqttTopic::LoopMax), "μs", "duration", "measurement");
   
   // Text entities (time inputs)
   builder.addText("Night mode start", nodeId + "_night_start",
-                 tNightStartState, tNightStartSet,
+                 g_topics.get(MqttTopic::NightStartState), g_topics.get(MqttTopic::NightStartSet),
                  5, 5, "^([01][0-9]|2[0-3]):[0-5][0-9]$");
   builder.addText("Night mode end", nodeId + "_night_end",
-                 tNightEndState, tNightEndSet,
+                 g_topics.get(MqttTopic::NightEndState), g_topics.get(MqttTopic::NightEndSet),
                  5, 5, "^([01][0-9]|2[0-3]):[0-5][0-9]$");
-  
-  // Publish all entities
-  builder.publish();
 }
 
 static void publishAvailability(const char* st) {
-  mqtt.publish(availTopic.c_str(), st, true);
+  g_pub.publish(MqttTopic::Availability, st, true);
 }
 
 // Publisher functions (now non-static so they can be accessed by command handlers)
 void publishLightState() {
-  JsonDocument doc;
   uint8_t r, g, b, w; ledState.getRGBW(r,g,b,w);
-  doc["state"] = clockEnabled ? "ON" : "OFF";
-  doc["brightness"] = ledState.getBrightness();
-  doc["color_mode"] = "rgbw";
-  JsonObject col = doc["color"].to<JsonObject>();
-  col["r"] = r; col["g"] = g; col["b"] = b; col["w"] = w;
-  String out; serializeJson(doc, out);
-  mqtt.publish(tLightState.c_str(), out.c_str(), true);
+  g_pub.publishLightState(clockEnabled, ledState.getBrightness(), r, g, b, w);
 }
 
-void publishSwitch(const String& topic, bool on) {
-  mqtt.publish(topic.c_str(), on ? "ON" : "OFF", true);
+void publishSwitch(MqttTopic topic, bool on) {
+  g_pub.publishSwitch(topic, on);
 }
 
-void publishNumber(const String& topic, int v) {
-  char buf[16]; snprintf(buf, sizeof(buf), "%d", v);
-  mqtt.publish(topic.c_str(), buf, true);
+void publishNumber(MqttTopic topic, int v) {
+  g_pub.publishInt(topic, v);
 }
 
-void publishSelect(const String& topic) {
+void publishSelect(MqttTopic topic) {
   extern LogLevel LOG_LEVEL;
   const char* s = "INFO";
   switch (LOG_LEVEL) {
@@ -232,7 +199,7 @@ void publishSelect(const String& topic) {
     case LOG_LEVEL_WARN:  s = "WARN";  break;
     case LOG_LEVEL_ERROR: s = "ERROR"; break;
   }
-  mqtt.publish(topic.c_str(), s, true);
+  g_pub.publish(topic, s, true);
 }
 
 void publishNightOverrideState() {
@@ -243,36 +210,45 @@ void publishNightOverrideState() {
     case NightModeOverride::Auto:
     default:                         s = "AUTO"; break;
   }
-  mqtt.publish(tNightOverrideState.c_str(), s, true);
+  g_pub.publish(MqttTopic::NightOverrideState, s, true);
 }
 
 void publishNightActiveState() {
-  mqtt.publish(tNightActiveState.c_str(), nightMode.isActive() ? "ON" : "OFF", true);
+  g_pub.publishSwitch(MqttTopic::NightActive, nightMode.isActive());
 }
 
 void publishNightEffectState() {
   const char* s = (nightMode.getEffect() == NightModeEffect::Off) ? "OFF" : "DIM";
-  mqtt.publish(tNightEffectState.c_str(), s, true);
+  g_pub.publish(MqttTopic::NightEffectState, s, true);
 }
 
 
 void publishNightDimState() {
-  publishNumber(tNightDimState, nightMode.getDimPercent());
+  publishNumber(MqttTopic::NightDimState, nightMode.getDimPercent());
+}
+
+static void publishMinutes(MqttTopic topic, uint16_t minutes) {
+  // Same "HH:MM" as NightMode::formatMinutes(), without the String
+  minutes %= (24 * 60);
+  char buf[6];
+  snprintf(buf, sizeof(buf), "%02u:%02u", (unsigned)(minutes / 60), (unsigned)(minutes % 60));
+  g_pub.publish(topic, buf, true);
 }
 
 void publishNightScheduleState() {
-  String start = nightMode.formatMinutes(nightMode.getStartMinutes());
-  String end = nightMode.formatMinutes(nightMode.getEndMinutes());
-  mqtt.publish(tNightStartState.c_str(), start.c_str(), true);
-  mqtt.publish(tNightEndState.c_str(), end.c_str(), true);
+  publishMinutes(MqttTopic::NightStartState, nightMode.getStartMinutes());
+  publishMinutes(MqttTopic::NightEndState, nightMode.getEndMinutes());
 }
 
 // Cache computed boot time string once NTP is synced
-static String g_bootTimeStr;
+static char g_bootTimeStr[32] = "unknown";
 static bool g_bootTimeSet = false;
-static String g_bootReasonStr;
+static const char* g_bootReasonStr = nullptr;
 static uint32_t g_resetCount = 0;
 static bool mqttConfiguredLogged = false;
+// getUiVersion() reads a file; the UI only changes with an fs.bin OTA, which
+// reboots, so read it once per connect rather than on every state round.
+static char g_uiVersion[32] = "";
 
 static bool mqtt_has_configuration() {
   if (g_mqttCfg.port == 0) return false;
@@ -297,54 +273,69 @@ static const char* reset_reason_to_str(esp_reset_reason_t r) {
   }
 }
 
-void mqtt_publish_state(bool force) {
-  unsigned long now = millis();
-  if (!force && (now - lastStateAt) < STATE_INTERVAL_MS) return;
-  lastStateAt = now;
-  if (!mqtt.connected()) return;
+static const char* boot_reason() {
+  if (!g_bootReasonStr) g_bootReasonStr = reset_reason_to_str(esp_reset_reason());
+  return g_bootReasonStr;
+}
 
-  publishLightState();
-  publishSwitch(tAnimState, displaySettings.getAnimateWords());
+static void cacheUiVersion() {
+#if OTA_ENABLED
+  String v = getUiVersion();
+  snprintf(g_uiVersion, sizeof(g_uiVersion), "%s", v.c_str());
+#else
+  snprintf(g_uiVersion, sizeof(g_uiVersion), "%s", UI_VERSION);
+#endif
+}
+
+static void onStateChanged(StateChange change) {
+  g_dirtyGroups |= (uint8_t)(1u << (uint8_t)change);
+}
+
+static void publishDisplayGroup() {
+  publishSwitch(MqttTopic::AnimState, displaySettings.getAnimateWords());
 #if OTA_ENABLED
-  publishSwitch(tAutoUpdState, displaySettings.getAutoUpdate());
+  publishSwitch(MqttTopic::AutoUpdateState, displaySettings.getAutoUpdate());
 #endif
 #if !defined(PRODUCT_VARIANT_MINI)
-  publishNumber(tHetIsState, displaySettings.getHetIsDurationSec());
+  publishNumber(MqttTopic::HetIsState, displaySettings.getHetIsDurationSec());
+#endif
+#if OTA_ENABLED
+  // Update channel / auto-update status
+  const String& updCh = displaySettings.getUpdateChannel();
+  g_pub.publish(MqttTopic::UpdateChannel, updCh.c_str(), updCh.length(), true);
+  bool autoAllowed = displaySettings.getAutoUpdate() && updCh != "develop";
+  g_pub.publishSwitch(MqttTopic::UpdateAutoAllowed, autoAllowed);
 #endif
-  publishSwitch(tNightEnabledState, nightMode.isEnabled());
+}
+
+static void publishNightGroup() {
+  publishSwitch(MqttTopic::NightEnabledState, nightMode.isEnabled());
   publishNightEffectState();
   publishNightDimState();
   publishNightScheduleState();
   publishNightOverrideState();
   publishNightActiveState();
-  publishSelect(tLogLvlState);
+}
 
+static void publishSystemGroup() {
+  publishSelect(MqttTopic::LogLevelState);
 #if OTA_ENABLED
-  // Update channel / auto-update status
-  String updCh = displaySettings.getUpdateChannel();
-  mqtt.publish(tUpdateChannelState.c_str(), updCh.c_str(), true);
-  bool autoAllowed = displaySettings.getAutoUpdate() && updCh != "develop";
-  mqtt.publish(tUpdateAutoAllowed.c_str(), autoAllowed ? "ON" : "OFF", true);
-  mqtt.publish(tUpdateAvailable.c_str(), "unknown", true); // placeholder until a remote check runs
-  mqtt.publish(tUpdateRunning.c_str(), is_update_running() ? "ON" : "OFF", true);
+  g_pub.publish(MqttTopic::UpdateAvailable, "unknown", true); // placeholder until a remote check runs
+  g_pub.publishSwitch(MqttTopic::UpdateRunning, is_update_running());
 #endif
 
-  mqtt.publish(tVersion.c_str(), FIRMWARE_VERSION, true);
-#if OTA_ENABLED
-  String uiVersion = getUiVersion();
-  mqtt.publish(tUiVersion.c_str(), uiVersion.c_str(), true);
-#else
-  mqtt.publish(tUiVersion.c_str(), UI_VERSION, true);
-#endif
-  mqtt.publish(tIp.c_str(), WiFi.localIP().toString().c_str(), true);
-  char rssi[16]; snprintf(rssi, sizeof(rssi), "%d", WiFi.RSSI()); mqtt.publish(tRssi.c_str(), rssi, true);
-  char heap[24]; snprintf(heap, sizeof(heap), "%u", (unsigned)esp_get_free_heap_size()); mqtt.publish(tHeap.c_str(), heap, true);
-  char ch[8]; snprintf(ch, sizeof(ch), "%d", WiFi.channel()); mqtt.publish(tWifiChan.c_str(), ch, true);
-  if (g_bootReasonStr.length() == 0) {
-    g_bootReasonStr = reset_reason_to_str(esp_reset_reason());
-  }
-  mqtt.publish(tBootReason.c_str(), g_bootReasonStr.c_str(), true);
-  char rc[16]; snprintf(rc, sizeof(rc), "%lu", (unsigned long)g_resetCount); mqtt.publish(tResetCount.c_str(), rc, true);
+  g_pub.publish(MqttTopic::Version, FIRMWARE_VERSION, true);
+  if (g_uiVersion[0] == '\0') cacheUiVersion();
+  g_pub.publish(MqttTopic::UiVersion, g_uiVersion, true);
+  IPAddress ip = WiFi.localIP();
+  char ipBuf[16];
+  snprintf(ipBuf, sizeof(ipBuf), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  g_pub.publish(MqttTopic::Ip, ipBuf, true);
+  g_pub.publishIntDeadband(MqttTopic::Rssi, WiFi.RSSI(), MQTT_RSSI_DEADBAND_DB);
+  g_pub.publishIntDeadband(MqttTopic::Heap, (long)esp_get_free_heap_size(), MQTT_HEAP_DEADBAND_BYTES);
+  g_pub.publishInt(MqttTopic::WifiChannel, WiFi.channel());
+  g_pub.publish(MqttTopic::BootReason, boot_reason(), true);
+  g_pub.publishUInt(MqttTopic::ResetCount, (unsigned long)g_resetCount);
 
   // Publish last startup timestamp (local time) once NTP is synced
   time_t nowEpoch = time(nullptr);
@@ -352,19 +343,91 @@ void mqtt_publish_state(bool force) {
     time_t boot = nowEpoch - (time_t)(millis() / 1000UL);
     struct tm lt = {};
     localtime_r(&boot, &lt);
-    char buf[32];
-    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", &lt);
-    g_bootTimeStr = String(buf);
+    strftime(g_bootTimeStr, sizeof(g_bootTimeStr), "%Y-%m-%dT%H:%M:%S%z", &lt);
     g_bootTimeSet = true;
   }
-  const char* bootOut = g_bootTimeSet ? g_bootTimeStr.c_str() : "unknown";
-  mqtt.publish(tUptime.c_str(), bootOut, true);
+  g_pub.publish(MqttTopic::LastStartup, g_bootTimeStr, true);
+}
+
+// Publish the groups whose setters fired since the last round. Runs every
+// loop, so a change from the web UI or a schedule edge reaches the broker
+// right away instead of waiting for the next sweep.
+static void publishDirtyGroups() {
+  uint8_t dirty = g_dirtyGroups;
+  if (!dirty) return;
+  g_dirtyGroups = 0;
+  if (dirty & (1u << (uint8_t)StateChange::Light)) publishLightState();
+  if (dirty & (1u << (uint8_t)StateChange::Display)) publishDisplayGroup();
+  if (dirty & (1u << (uint8_t)StateChange::NightMode)) publishNightGroup();
+}
+
+// Messages kept off the broker by the diff cache and deadbands, as a rate
+// over the last refresh window.
+static void updateSavedRate(unsigned long now) {
+  unsigned long elapsed = now - g_savedWindowStart;
+  if (elapsed == 0) return;
+  uint32_t saved = g_pub.suppressedCount() - g_savedAtWindowStart;
+  g_savedPerHour = (uint32_t)(((uint64_t)saved * 3600000ULL) / elapsed);
+  g_savedWindowStart = now;
+  g_savedAtWindowStart = g_pub.suppressedCount();
+}
+
+/**
+ * @brief Publish retained state that changed since it was last sent
+ *
+ * Every STATE_INTERVAL_MS (or immediately with force) all state is sampled,
+ * but MqttPublisher drops payloads identical to what the broker already
+ * retains, so an idle clock sends next to nothing. Once per
+ * MQTT_STATE_REFRESH_MS the cache is dropped and the full set goes out again.
+ */
+void mqtt_publish_state(bool force) {
+  unsigned long now = millis();
+  if (!force && (now - lastStateAt) < STATE_INTERVAL_MS) return;
+  lastStateAt = now;
+  if (!mqtt.connected()) return;
+
+  bool refresh = (now - lastRefreshAt) >= MQTT_STATE_REFRESH_MS;
+  if (refresh) {
+    updateSavedRate(now);
+    g_pub.invalidate();
+    lastRefreshAt = now;
+  }
+
+  g_dirtyGroups = 0;
+  publishLightState();
+  publishDisplayGroup();
+  publishNightGroup();
+  publishSystemGroup();
+  g_pub.publishUInt(MqttTopic::MqttSavedPerHour, (unsigned long)g_savedPerHour);
+  // One loop() pass since boot (loop_profile.h); p99 moves in bucket steps,
+  // so the diff cache keeps it quiet
+  const LatencyHistogram& pass = loopStageHistogram(LoopStage::Pass);
+  g_pub.publishUInt(MqttTopic::LoopP99, (unsigned long)pass.percentile(990));
+  g_pub.publishUInt(MqttTopic::LoopMax, (unsigned long)pass.maxUs());
+}
+
+uint32_t mqtt_saved_per_hour() {
+  return g_savedPerHour;
+}
+
+MqttOutboxStats mqtt_outbox_stats() {
+  MqttOutboxStats st;
+  st.depth = g_outbox.depth();
+  st.peakDepth = g_outbox.peakDepth();
+  st.capacity = g_outbox.capacity();
+  st.queued = g_pub.queuedCount();
+  st.dropped = g_outbox.droppedCount();
+  st.coalesced = g_outbox.coalescedCount();
+  st.lastDrainMs = g_outboxLastDrainMs;
+  return st;
 }
 
 void mqtt_publish_update_status(bool running) {
 #if OTA_ENABLED
-  if (!mqtt.connected()) return;
-  mqtt.publish(tUpdateRunning.c_str(), running ? "ON" : "OFF", true);
+  // Queued in the outbox while offline, so HA learns about an update that
+  // started during an outage
+  if (!g_topics.isBuilt()) return;
+  g_pub.publishSwitch(MqttTopic::UpdateRunning, running);
 #else
   (void)running;
 #endif
@@ -373,126 +436,163 @@ void mqtt_publish_update_status(bool running) {
 static void publishBirth() {
   // Publish a small JSON birth message with time and reason
   if (!mqtt.connected()) return;
-  String out = String("{\"time\":\"") + (g_bootTimeSet ? g_bootTimeStr : String("unknown")) +
-               "\",\"reason\":\"" + (g_bootReasonStr.length() ? g_bootReasonStr : String(reset_reason_to_str(esp_reset_reason()))) + "\"}";
-  mqtt.publish(tBirth.c_str(), out.c_str(), true);
+  char out[96];
+  int n = snprintf(out, sizeof(out), "{\"time\":\"%s\",\"reason\":\"%s\"}",
+                   g_bootTimeStr, boot_reason());
+  if (n > 0 && (size_t)n < sizeof(out)) g_pub.publishEvent(MqttTopic::Birth, out, (size_t)n, true);
 }
 
+// Command topics subscribed on every connect
+static const MqttTopic kCommandTopics[] = {
+  MqttTopic::LightSet,
+  MqttTopic::ClockSet,
+  MqttTopic::AnimSet,
+#if OTA_ENABLED
+  MqttTopic::AutoUpdateSet,
+#endif
+#if !defined(PRODUCT_VARIANT_MINI)
+  MqttTopic::HetIsSet,
+#endif
+  MqttTopic::NightEnabledSet,
+  MqttTopic::NightOverrideSet,
+  MqttTopic::NightEffectSet,
+  MqttTopic::NightDimSet,
+  MqttTopic::NightStartSet,
+  MqttTopic::NightEndSet,
+  MqttTopic::LogLevelSet,
+  MqttTopic::RestartPress,
+  MqttTopic::SequencePress,
+#if OTA_ENABLED
+  MqttTopic::UpdatePress,
+#endif
+};
+
+// Option tables for select handlers (referenced by the handlers, not copied)
+static const char* const kNightOverrideOptions[] = {"AUTO", "ON", "OFF"};
+static const char* const kNightEffectOptions[] = {"DIM", "OFF"};
+static const char* const kLogLevelOptions[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
 /**
  * @brief Initialize MQTT command handlers
  * 
  * Registers all command handlers with the command registry.
  * This replaces the large if-else chain that was in handleMessage().
+ * Runs once; the registry is sealed afterwards and survives reconnects.
  */
 static void initCommandHandlers() {
   auto& registry = MqttCommandRegistry::instance();
   
   // Light (complex JSON)
-  registry.registerHandler(tLightSet, new LightCommandHandler());
+  registry.emplace<LightCommandHandler>(MqttTopic::LightSet);
   
   // Simple switches
-  registry.registerHandler(tClockSet, new SwitchCommandHandler(
+  registry.emplace<SwitchCommandHandler>(MqttTopic::ClockSet,
     "clock",
-    [](bool on) { clockEnabled = on; },
-    []() { publishSwitch(tClockState, clockEnabled); }
-  ));
+    [](bool on) {
+      if (on == clockEnabled) return;
+      clockEnabled = on;
+      notifyStateChanged(StateChange::Light);
+    },
+    []() { publishSwitch(MqttTopic::ClockState, clockEnabled); }
+  );
   
-  registry.registerHandler(tAnimSet, new SwitchCommandHandler(
+  registry.emplace<SwitchCommandHandler>(MqttTopic::AnimSet,
     "animate",
     [](bool on) { displaySettings.setAnimateWords(on); },
-    []() { publishSwitch(tAnimState, displaySettings.getAnimateWords()); }
-  ));
+    []() { publishSwitch(MqttTopic::AnimState, displaySettings.getAnimateWords()); }
+  );
   
   
 #if OTA_ENABLED
-  registry.registerHandler(tAutoUpdSet, new SwitchCommandHandler(
+  registry.emplace<SwitchCommandHandler>(MqttTopic::AutoUpdateSet,
     "auto_update",
     [](bool on) { displaySettings.setAutoUpdate(on); },
-    []() { publishSwitch(tAutoUpdState, displaySettings.getAutoUpdate()); }
-  ));
+    []() { publishSwitch(MqttTopic::AutoUpdateState, displaySettings.getAutoUpdate()); }
+  );
 #endif
   
-  registry.registerHandler(tNightEnabledSet, new SwitchCommandHandler(
+  registry.emplace<SwitchCommandHandler>(MqttTopic::NightEnabledSet,
     "night_enabled",
     [](bool on) { nightMode.setEnabled(on); },
-    []() { publishSwitch(tNightEnabledState, nightMode.isEnabled()); }
-  ));
+    []() { publishSwitch(MqttTopic::NightEnabledState, nightMode.isEnabled()); }
+  );
   
   // Number handlers
 #if !defined(PRODUCT_VARIANT_MINI)
-  registry.registerHandler(tHetIsSet, new NumberCommandHandler(
+  registry.emplace<NumberCommandHandler>(MqttTopic::HetIsSet,
     0, 360,
     [](int v) { displaySettings.setHetIsDurationSec((uint16_t)v); },
-    []() { publishNumber(tHetIsState, displaySettings.getHetIsDurationSec()); }
-  ));
+    []() { publishNumber(MqttTopic::HetIsState, displaySettings.getHetIsDurationSec()); }
+  );
 #endif
   
-  registry.registerHandler(tNightDimSet, new NumberCommandHandler(
+  registry.emplace<NumberCommandHandler>(MqttTopic::NightDimSet,
     0, 100,
     [](int v) { nightMode.setDimPercent((uint8_t)v); },
     []() { publishNightDimState(); }
-  ));
+  );
   
   // Select handlers
-  registry.registerHandler(tNightOverrideSet, new SelectCommandHandler(
-    {"AUTO", "ON", "OFF"},
-    [](const String& val) {
-      if (val == "AUTO") nightMode.setOverride(NightModeOverride::Auto);
-      else if (val == "ON") nightMode.setOverride(NightModeOverride::ForceOn);
-      else if (val == "OFF") nightMode.setOverride(NightModeOverride::ForceOff);
+  registry.emplace<SelectCommandHandler>(MqttTopic::NightOverrideSet,
+    kNightOverrideOptions,
+    [](const char* val) {
+      if (strcmp(val, "AUTO") == 0) nightMode.setOverride(NightModeOverride::Auto);
+      else if (strcmp(val, "ON") == 0) nightMode.setOverride(NightModeOverride::ForceOn);
+      else if (strcmp(val, "OFF") == 0) nightMode.setOverride(NightModeOverride::ForceOff);
     },
     []() { publishNightOverrideState(); publishNightActiveState(); }
-  ));
+  );
   
-  registry.registerHandler(tNightEffectSet, new SelectCommandHandler(
-    {"DIM", "OFF"},
-    [](const String& val) {
-      if (val == "DIM") nightMode.setEffect(NightModeEffect::Dim);
-      else if (val == "OFF") nightMode.setEffect(NightModeEffect::Off);
+  registry.emplace<SelectCommandHandler>(MqttTopic::NightEffectSet,
+    kNightEffectOptions,
+    [](const char* val) {
+      if (strcmp(val, "DIM") == 0) nightMode.setEffect(NightModeEffect::Dim);
+      else if (strcmp(val, "OFF") == 0) nightMode.setEffect(NightModeEffect::Off);
     },
     []() { publishNightEffectState(); }
-  ));
+  );
   
-  registry.registerHandler(tLogLvlSet, new SelectCommandHandler(
-    {"DEBUG", "INFO", "WARN", "ERROR"},
-    [](const String& val) {
+  registry.emplace<SelectCommandHandler>(MqttTopic::LogLevelSet,
+    kLogLevelOptions,
+    [](const char* val) {
       LogLevel level = LOG_LEVEL_INFO;
-      if (val == "DEBUG") level = LOG_LEVEL_DEBUG;
-      else if (val == "INFO") level = LOG_LEVEL_INFO;
-      else if (val == "WARN") level = LOG_LEVEL_WARN;
-      else if (val == "ERROR") level = LOG_LEVEL_ERROR;
+      if (strcmp(val, "DEBUG") == 0) level = LOG_LEVEL_DEBUG;
+      else if (strcmp(val, "INFO") == 0) level = LOG_LEVEL_INFO;
+      else if (strcmp(val, "WARN") == 0) level = LOG_LEVEL_WARN;
+      else if (strcmp(val, "ERROR") == 0) level = LOG_LEVEL_ERROR;
       setLogLevel(level);
     },
-    []() { publishSelect(tLogLvlState); }
-  ));
+    []() { publishSelect(MqttTopic::LogLevelState); }
+  );
   
   // Time string handlers
-  registry.registerHandler(tNightStartSet, new TimeStringCommandHandler(
-    NightMode::parseTimeString,
+  const TimeStringCommandHandler::Parser parseTime = NightMode::parseTimeString;
+  registry.emplace<TimeStringCommandHandler>(MqttTopic::NightStartSet,
+    parseTime,
     [](uint16_t minutes) { nightMode.setSchedule(minutes, nightMode.getEndMinutes()); },
     []() { publishNightScheduleState(); },
     "night_start"
-  ));
+  );
   
-  registry.registerHandler(tNightEndSet, new TimeStringCommandHandler(
-    NightMode::parseTimeString,
+  registry.emplace<TimeStringCommandHandler>(MqttTopic::NightEndSet,
+    parseTime,
     [](uint16_t minutes) { nightMode.setSchedule(nightMode.getStartMinutes(), minutes); },
     []() { publishNightScheduleState(); },
     "night_end"
-  ));
+  );
   
   // Simple button commands (no response needed)
-  registry.registerLambda(tRestartCmd, [](const String&) {
+  registry.registerLambda(MqttTopic::RestartPress, [](const MqttPayload&) {
     safeRestart();
   });
   
-  registry.registerLambda(tSeqCmd, [](const String&) {
+  registry.registerLambda(MqttTopic::SequencePress, [](const MqttPayload&) {
     extern StartupSequence startupSequence;
     startupSequence.start();
   });
   
 #if OTA_ENABLED
-  registry.registerLambda(tUpdateCmd, [](const String&) {
+  registry.registerLambda(MqttTopic::UpdatePress, [](const MqttPayload&) {
     set_update_running(true);
     mqtt_publish_update_status(true);
     checkForFirmwareUpdate();
@@ -500,6 +600,10 @@ static void initCommandHandlers() {
     mqtt_publish_update_status(false);
   });
 #endif
+
+  registry.seal();
+  logDebugf("MQTT command handlers: %u in %u bytes", (unsigned)registry.handlerCount(),
+            (unsigned)registry.arenaUsed());
 }
 
 /**
@@ -509,16 +613,188 @@ static void initCommandHandlers() {
  * Replaced the 107-line if-else chain with this clean implementation.
  */
 static void handleMessage(char* topic, byte* payload, unsigned int length) {
-  String topicStr(topic);
-  String payloadStr;
-  for (unsigned int i = 0; i < length; i++) {
-    payloadStr += (char)payload[i];
+  // Home Assistant announces itself after a restart; its discovery state may
+  // be gone, so republish ours even if the broker-side hash still matches.
+  if (g_haStatusTopic[0] && strcmp(topic, g_haStatusTopic) == 0) {
+    if (length == 6 && memcmp(payload, "online", 6) == 0) {
+      logInfo("🏠 Home Assistant came online; republishing discovery");
+      g_discoveryCache.forget();
+      g_discoveryRepublish = true;
+    }
+    return;
   }
-  
-  MqttCommandRegistry::instance().handleMessage(topicStr, payloadStr);
+
+  MqttTopic id;
+  if (!g_topics.match(topic, id)) {
+    logWarnf("Unhandled MQTT topic: %s", topic);
+    return;
+  }
+  // Handlers read the payload in place from PubSubClient's buffer
+  MqttPayload view(reinterpret_cast<const char*>(payload), length);
+  if (!MqttCommandRegistry::instance().handleMessage(id, view)) {
+    logWarnf("Unhandled MQTT topic: %s", topic);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Session setup
+//
+// Bringing a session online used to be one blocking mqtt_connect() call. It
+// now runs as the steps below, driven a few items per loop tick by
+// MqttSetupSequence. The CONNECT itself still blocks inside PubSubClient
+// (TCP connect + CONNACK, bounded by MQTT_SOCKET_TIMEOUT_S) and therefore
+// gets a tick of its own; everything after it is split into small items,
+// with mqtt.loop() run before each tick as on a live session.
+// ---------------------------------------------------------------------------
+
+static MqttSetupSequence g_setup;
+static bool g_setupIsConnect = false;
+static size_t g_discoveryHashIndex = 0;
+static bool g_discoveryFailed = false;
+
+static const MqttSetupBudget kSetupBudget = {MQTT_SETUP_TICK_BUDGET_MS, MQTT_SETUP_ITEMS_PER_TICK};
+
+static size_t oneItem() { return 1; }
+
+static bool stepConnect(size_t) {
+  String clientId = uniqId;
+  bool ok;
+  if (g_mqttCfg.user.length() > 0) {
+    ok = mqtt.connect(clientId.c_str(), g_mqttCfg.user.c_str(), g_mqttCfg.pass.c_str(), g_topics.get(MqttTopic::Availability), 1, true, "offline");
+  } else {
+    ok = mqtt.connect(clientId.c_str());
+  }
+  if (!ok) {
+    int st = mqtt.state();
+    g_connected = false;
+    g_lastErr.clear();
+    g_lastErr.appendf("connect failed (state %d)", st);
+  }
+  return ok;
+}
+
+static bool stepAnnounce(size_t) {
+  cacheUiVersion();
+  // The broker may have lost retained state while we were away: send it all
+  g_pub.invalidate();
+  lastRefreshAt = millis();
+  publishAvailability("online");
+  publishBirth();
+  return mqtt.connected();
+}
+
+static bool stepHandlers(size_t) {
+  // Register all command topics once; the sealed registry outlives sessions
+  if (!MqttCommandRegistry::instance().sealed()) initCommandHandlers();
+  return true;
+}
+
+static const size_t kCommandTopicCount = sizeof(kCommandTopics) / sizeof(kCommandTopics[0]);
+
+static size_t subscribeCount() {
+  return kCommandTopicCount + (g_haStatusTopic[0] ? 1 : 0);
+}
+
+static bool stepSubscribe(size_t i) {
+  mqtt.subscribe(i < kCommandTopicCount ? g_topics.get(kCommandTopics[i]) : g_haStatusTopic);
+  return mqtt.connected();
+}
+
+static size_t stateCount() { return 4; }
+
+static bool stepState(size_t i) {
+  switch (i) {
+    case 0: publishLightState(); break;
+    case 1: publishDisplayGroup(); break;
+    case 2: publishNightGroup(); break;
+    default:
+      publishSystemGroup();
+      g_pub.publishUInt(MqttTopic::MqttSavedPerHour, (unsigned long)g_savedPerHour);
+      lastStateAt = millis();
+      g_dirtyGroups = 0;
+      break;
+  }
+  return mqtt.connected();
+}
+
+static bool stepDiscoveryBuild(size_t) {
+  buildDiscovery();
+  // Key the hash by broker too: a different broker has none of our configs
+  char port[8];
+  snprintf(port, sizeof(port), "%u", (unsigned)g_mqttCfg.port);
+  uint32_t h = MqttDiscoveryCache::kSeed;
+  h = MqttDiscoveryCache::hashString(h, g_mqttCfg.host.c_str());
+  h = MqttDiscoveryCache::hashString(h, port);
+  g_discoveryHash = h;
+  g_discoveryHashIndex = 0;
+  g_discoveryFailed = false;
+  return true;
+}
+
+static size_t discoveryHashCount() {
+  return g_discovery ? g_discovery->size() : 0;
+}
+
+static bool stepDiscoveryHash(size_t i) {
+  g_discoveryHash = g_discovery->entityHash(i, g_discoveryHash);
+  return true;
+}
+
+static size_t discoveryPublishCount() {
+  if (!g_discovery) return 0;
+  g_discoveryPending = !g_discoveryCache.matches(g_discoveryHash);
+  if (!g_discoveryPending) {
+    logDebug("MQTT discovery unchanged since last publish; skipped");
+    g_discovery.reset();
+    return 0;
+  }
+  return g_discovery->size();
+}
+
+static bool stepDiscoveryPublish(size_t i) {
+  if (!g_discovery->publishAt(i)) g_discoveryFailed = true;
+  return mqtt.connected();
+}
+
+static bool stepDiscoveryCommit(size_t) {
+  if (g_discoveryPending && g_discovery) {
+    if (!g_discoveryFailed) g_discoveryCache.store(g_discoveryHash);
+    logInfof("Published %u discovery entities", (unsigned)g_discovery->size());
+  }
+  g_discoveryPending = false;
+  g_discovery.reset();
+  return true;
+}
+
+static const MqttSetupStep kConnectSteps[] = {
+  {"connect",            oneItem,               stepConnect,          true},
+  {"announce",           oneItem,               stepAnnounce,         false},
+  {"handlers",           oneItem,               stepHandlers,         false},
+  {"subscribe",          subscribeCount,        stepSubscribe,        false},
+  {"state",              stateCount,            stepState,            false},
+  {"discovery_build",    oneItem,               stepDiscoveryBuild,   false},
+  {"discovery_hash",     discoveryHashCount,    stepDiscoveryHash,    false},
+  {"discovery_publish",  discoveryPublishCount, stepDiscoveryPublish, false},
+  {"discovery_commit",   oneItem,               stepDiscoveryCommit,  false},
+};
+
+// Discovery only, for a Home Assistant restart while we stay connected
+static const MqttSetupStep kDiscoverySteps[] = {
+  {"discovery_build",    oneItem,               stepDiscoveryBuild,   false},
+  {"discovery_hash",     discoveryHashCount,    stepDiscoveryHash,    false},
+  {"discovery_publish",  discoveryPublishCount, stepDiscoveryPublish, false},
+  {"discovery_commit",   oneItem,               stepDiscoveryCommit,  false},
+};
+
+static void abortSetup() {
+  g_setup.abort();
+  g_setupIsConnect = false;
+  g_discovery.reset();
+  g_discoveryPending = false;
 }
 
-static bool mqtt_connect() {
+// Checks that can fail without touching the network, then queue the steps
+static bool mqtt_connect_start() {
   if (mqtt.connected()) return true;
   if (WiFi.status() != WL_CONNECTED) {
     g_lastErr = "WiFi not connected";
@@ -536,52 +812,18 @@ static bool mqtt_connect() {
     uniqId = String("wordclock_") + buf;
     buildTopics();
   }
-
-  String clientId = uniqId;
-  bool ok;
-  if (g_mqttCfg.user.length() > 0) {
-    ok = mqtt.connect(clientId.c_str(), g_mqttCfg.user.c_str(), g_mqttCfg.pass.c_str(), availTopic.c_str(), 1, true, "offline");
-  } else {
-    ok = mqtt.connect(clientId.c_str());
-  }
-  if (!ok) {
-    int st = mqtt.state();
-    g_connected = false;
-    g_lastErr = String("connect failed (state ") + st + ")";
+  if (!g_topics.isBuilt()) {
+    g_lastErr = "MQTT base topic too long";
     return false;
   }
 
-  publishAvailability("online");
-  publishBirth();
-  publishDiscovery();
-  
-  // Initialize command handlers (register all topics)
-  initCommandHandlers();
-
-  // Subscriptions
-  mqtt.subscribe(tLightSet.c_str());
-  mqtt.subscribe(tClockSet.c_str());
-  mqtt.subscribe(tAnimSet.c_str());
-#if OTA_ENABLED
-  mqtt.subscribe(tAutoUpdSet.c_str());
-#endif
-#if !defined(PRODUCT_VARIANT_MINI)
-  mqtt.subscribe(tHetIsSet.c_str());
-#endif
-  mqtt.subscribe(tNightEnabledSet.c_str());
-  mqtt.subscribe(tNightOverrideSet.c_str());
-  mqtt.subscribe(tNightEffectSet.c_str());
-  mqtt.subscribe(tNightDimSet.c_str());
-  mqtt.subscribe(tNightStartSet.c_str());
-  mqtt.subscribe(tNightEndSet.c_str());
-  mqtt.subscribe(tLogLvlSet.c_str());
-  mqtt.subscribe(tRestartCmd.c_str());
-  mqtt.subscribe(tSeqCmd.c_str());
-#if OTA_ENABLED
-  mqtt.subscribe(tUpdateCmd.c_str());
-#endif
+  g_setup.begin(kConnectSteps, sizeof(kConnectSteps) / sizeof(kConnectSteps[0]), kSetupBudget);
+  g_setupIsConnect = true;
+  g_discoveryRepublish = false;
+  return true;
+}
 
-  mqtt_publish_state(true);
+static void onSessionOnline() {
   g_connected = true;
   ledEventStop(LedEvent::MqttDisconnected);
   
@@ -590,13 +832,59 @@ static bool mqtt_connect() {
   reconnectDelayMs = RECONNECT_DELAY_MIN_MS;
   reconnectAborted = false;
   
+  logInfof("✅ MQTT online in %u ticks (%lu ms busy, longest tick %lu ms)",
+           (unsigned)g_setup.ticks(), (unsigned long)g_setup.elapsedMs(),
+           (unsigned long)g_setup.longestTickMs());
   // Log successful recovery if there was a previous error
-  if (g_lastErr.length() > 0) {
-    logInfo(String("✅ MQTT reconnected successfully after error: ") + g_lastErr);
+  if (!g_lastErr.empty()) {
+    logInfof("✅ MQTT reconnected successfully after error: %s", g_lastErr.c_str());
   }
   g_lastErr = "";
-  
-  return true;
+}
+
+// Send what queued up while offline, a few messages per loop. The connect
+// sequence already republished full state, which discarded stale entries,
+// so this is mostly state nothing republishes (update status) and publishes
+// that hit the dead link.
+static void drainOutbox() {
+  if (g_outbox.empty()) return;
+  unsigned long now = millis();
+  if (g_outboxDrainStart == 0) g_outboxDrainStart = now ? now : 1;
+  g_pub.drainOutbox(MQTT_OUTBOX_DRAIN_PER_TICK);
+  if (g_outbox.empty()) {
+    g_outboxLastDrainMs = millis() - g_outboxDrainStart;
+    g_outboxDrainStart = 0;
+    logInfof("📤 MQTT outbox drained in %lu ms (dropped %lu, coalesced %lu so far)",
+             g_outboxLastDrainMs, (unsigned long)g_outbox.droppedCount(),
+             (unsigned long)g_outbox.coalescedCount());
+  }
+}
+
+// Exponential backoff with jitter after a failed attempt
+static void scheduleReconnect() {
+  g_connected = false;
+  if (reconnectDelayMs < RECONNECT_DELAY_MIN_MS) reconnectDelayMs = RECONNECT_DELAY_MIN_MS;
+  if (reconnectAttempts < 255) reconnectAttempts++;
+  unsigned long nextDelay = reconnectDelayMs * 2;
+  if (nextDelay > RECONNECT_DELAY_MAX_MS) nextDelay = RECONNECT_DELAY_MAX_MS;
+  uint32_t jitter = esp_random() % RECONNECT_DELAY_MIN_MS;
+  unsigned long jittered = nextDelay + jitter;
+  if (jittered > RECONNECT_DELAY_MAX_MS) jittered = RECONNECT_DELAY_MAX_MS;
+  reconnectDelayMs = jittered;
+  if (!reconnectAborted && reconnectDelayMs >= RECONNECT_DELAY_MAX_MS) {
+    logWarnf("⏸️ MQTT reconnect paused after reaching max backoff (%lu ms); last error: %s. "
+             "Will retry on network recovery, config change, or manual reconnect.",
+             (unsigned long)RECONNECT_DELAY_MAX_MS, g_lastErr.empty() ? "unknown" : g_lastErr.c_str());
+    reconnectAborted = true;
+    lastPausedRetryMs = millis();
+    // Note: reconnectAborted will be cleared on:
+    // 1. Successful connection (onSessionOnline)
+    // 2. Configuration change (mqtt_apply_settings)
+    // 3. Manual reconnect (mqtt_force_reconnect)
+  } else if (strcmp(g_lastErr.c_str(), "MQTT not configured") != 0) {
+    logWarnf("MQTT reconnect failed (%s); retry in %lu ms", g_lastErr.empty() ? "unknown" : g_lastErr.c_str(),
+             (unsigned long)reconnectDelayMs);
+  }
 }
 
 void mqtt_begin() {
@@ -604,6 +892,13 @@ void mqtt_begin() {
   mqtt_settings_load(g_mqttCfg);
   mqtt.setServer(g_mqttCfg.host.c_str(), g_mqttCfg.port);
   mqtt.setCallback(handleMessage);
+  mqtt.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  if (g_outbox.begin()) {
+    g_pub.setOutbox(&g_outbox);
+  } else {
+    logWarn("⚠️ MQTT outbox allocation failed; offline publishes will be dropped");
+  }
+  addStateChangeListener(onStateChanged);
   reconnectDelayMs = RECONNECT_DELAY_MIN_MS;
   reconnectAttempts = 0;
   reconnectAborted = false;
@@ -652,45 +947,50 @@ void mqtt_loop() {
     }
   }
 
+  if (g_setupIsConnect) {
+    // Once CONNECT has gone through, keep the session serviced between setup
+    // ticks: keepalive, and the retained commands and HA status the
+    // subscribe step asks for
+    if (mqtt.connected()) mqtt.loop();
+    g_setup.tick();
+    if (g_setup.finished()) {
+      g_setupIsConnect = false;
+      onSessionOnline();
+    } else if (g_setup.failed()) {
+      g_setupIsConnect = false;
+      if (g_lastErr.empty()) {
+        g_lastErr = "setup failed at ";
+        g_lastErr += g_setup.stepName();
+      }
+      abortSetup();
+      if (mqtt.connected()) mqtt.disconnect();
+      scheduleReconnect();
+    }
+    return;
+  }
+
   if (!mqtt.connected()) {
+    if (g_setup.active()) abortSetup();
+    g_outboxDrainStart = 0;
+    g_connected = false;
     ledEventStart(LedEvent::MqttDisconnected);
     unsigned long now = millis();
     if (now - lastReconnectAttempt >= reconnectDelayMs) {
       lastReconnectAttempt = now;
-      if (!mqtt_connect()) {
-        g_connected = false;
-        if (reconnectDelayMs < RECONNECT_DELAY_MIN_MS) reconnectDelayMs = RECONNECT_DELAY_MIN_MS;
-        if (reconnectAttempts < 255) reconnectAttempts++;
-        unsigned long nextDelay = reconnectDelayMs * 2;
-        if (nextDelay > RECONNECT_DELAY_MAX_MS) nextDelay = RECONNECT_DELAY_MAX_MS;
-        uint32_t jitter = esp_random() % RECONNECT_DELAY_MIN_MS;
-        unsigned long jittered = nextDelay + jitter;
-        if (jittered > RECONNECT_DELAY_MAX_MS) jittered = RECONNECT_DELAY_MAX_MS;
-        reconnectDelayMs = jittered;
-        if (!reconnectAborted && reconnectDelayMs >= RECONNECT_DELAY_MAX_MS) {
-          String errMsg = String("⏸️ MQTT reconnect paused after reaching max backoff (") +
-                          RECONNECT_DELAY_MAX_MS + " ms); last error: " +
-                          (g_lastErr.length() ? g_lastErr : String("unknown")) +
-                          String(". Will retry on network recovery, config change, or manual reconnect.");
-          logWarn(errMsg);
-          reconnectAborted = true;
-          lastPausedRetryMs = millis();
-          // Note: reconnectAborted will be cleared on:
-          // 1. Successful connection (mqtt_connect success path)
-          // 2. Configuration change (mqtt_apply_settings)
-          // 3. Manual reconnect (mqtt_force_reconnect)
-          return;
-        } else if (g_lastErr != "MQTT not configured") {
-          String warnMsg = String("MQTT reconnect failed (") + (g_lastErr.length() ? g_lastErr : String("unknown")) +
-                           "); retry in " + reconnectDelayMs + " ms";
-          logWarn(warnMsg);
-        }
-      }
+      if (!mqtt_connect_start()) scheduleReconnect();
     }
     return;
   }
   ledEventStop(LedEvent::MqttDisconnected);
   mqtt.loop();
+  drainOutbox();
+  if (g_setup.active()) {
+    g_setup.tick();
+  } else if (g_discoveryRepublish) {
+    g_discoveryRepublish = false;
+    g_setup.begin(kDiscoverySteps, sizeof(kDiscoverySteps) / sizeof(kDiscoverySteps[0]), kSetupBudget);
+  }
+  publishDirtyGroups();
   mqtt_publish_state(false);
 }
 
@@ -698,8 +998,8 @@ bool mqtt_is_connected() {
   return g_connected && mqtt.connected();
 }
 
-const String& mqtt_last_error() {
-  return g_lastErr;
+const char* mqtt_last_error() {
+  return g_lastErr.c_str();
 }
 
 void mqtt_apply_settings(const MqttSettings& s) {
@@ -713,11 +1013,14 @@ void mqtt_apply_settings(const MqttSettings& s) {
   g_mqttCfg = toSave;
 
   // Disconnect and reconfigure server and topics
+  abortSetup();
   if (mqtt.connected()) mqtt.disconnect();
   mqtt.setServer(g_mqttCfg.host.c_str(), g_mqttCfg.port);
 
-  // Recompute topics based on new base/discovery
+  // Recompute topics based on new base/discovery. Anything queued was meant
+  // for the old broker / base topic.
   buildTopics();
+  g_outbox.clear();
   
   // Reset reconnection state and enable reconnection attempts
   if (reconnectAborted) {
@@ -8,6 +8,21 @@ void mqtt_publish_state(bool force = false);
 void mqtt_publish_update_status(bool running);
 void mqtt_publish_update_status(bool running);
 
+// Retained publishes skipped by the state diff cache, per hour (last refresh window)
+uint32_t mqtt_saved_per_hour();
+
+// Offline publish queue (see MqttOutbox)
+struct MqttOutboxStats {
+  size_t depth;
+  size_t peakDepth;
+  size_t capacity;
+  uint32_t queued;
+  uint32_t dropped;
+  uint32_t coalesced;
+  unsigned long lastDrainMs;  // time from reconnect until the queue was empty
+};
+MqttOutboxStats mqtt_outbox_stats();
+
 // Apply new settings at runtime: disconnect, update client, reconnect
 struct MqttSettings; // fwd
 void mqtt_apply_settings(const MqttSettings& s);
@@ -17,4 +32,4 @@ void mqtt_force_reconnect();
 
 // Status helpers for Web UI
 bool mqtt_is_connected();
-const String& mqtt_last_error();
+const char* mqtt_last_error();
@@ -1,5 +1,6 @@
 #include "mqtt_command_handler.h"
 #include "display_settings.h"
+#include "json_arena.h"
 #include "night_mode.h"
 #include "led_state.h"
 #include "log.h"
@@ -13,80 +14,23 @@ extern bool clockEnabled;
 
 // Forward declarations for publisher functions (defined in mqtt_client.cpp)
 extern void publishLightState();
-extern void publishSwitch(const String& topic, bool on);
-extern void publishNumber(const String& topic, int v);
-extern void publishSelect(const String& topic);
+extern void publishSwitch(MqttTopic topic, bool on);
+extern void publishNumber(MqttTopic topic, int v);
+extern void publishSelect(MqttTopic topic);
 extern void publishNightOverrideState();
 extern void publishNightActiveState();
 extern void publishNightEffectState();
 extern void publishNightDimState();
 extern void publishNightScheduleState();
 
-// ============================================================================
-// Registry Implementation
-// ============================================================================
-
-MqttCommandRegistry& MqttCommandRegistry::instance() {
-    static MqttCommandRegistry registry;
-    return registry;
-}
-
-MqttCommandRegistry::~MqttCommandRegistry() {
-    // Clean up owned handler pointers
-    for (auto& pair : handlers_) {
-        delete pair.second;
-    }
-    handlers_.clear();
-    lambdaHandlers_.clear();
-}
-
-void MqttCommandRegistry::registerHandler(const String& topic, MqttCommandHandler* handler) {
-    // Delete any existing handler for this topic
-    auto it = handlers_.find(topic);
-    if (it != handlers_.end()) {
-        delete it->second;
-    }
-    handlers_[topic] = handler;
-}
-
-void MqttCommandRegistry::registerLambda(const String& topic, 
-                                        std::function<void(const String&)> handler) {
-    lambdaHandlers_[topic] = handler;
-}
-
-void MqttCommandRegistry::handleMessage(const String& topic, const String& payload) {
-    // Try direct handler first
-    auto it = handlers_.find(topic);
-    if (it != handlers_.end()) {
-        it->second->handle(payload);
-        return;
-    }
-    
-    // Try lambda handler
-    auto lit = lambdaHandlers_.find(topic);
-    if (lit != lambdaHandlers_.end()) {
-        lit->second(payload);
-        return;
-    }
-    
-    logWarn(String("Unhandled MQTT topic: ") + topic);
-}
-
-void MqttCommandRegistry::clear() {
-    for (auto& pair : handlers_) {
-        delete pair.second;
-    }
-    handlers_.clear();
-    lambdaHandlers_.clear();
-}
-
 // ============================================================================
 // Light Command Handler
 // ============================================================================
 
-void LightCommandHandler::handle(const String& payload) {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, payload);
+void LightCommandHandler::handle(const MqttPayload& payload) {
+    JSON_SCOPE(json, "mqtt light command");
+    JsonDocument doc(json.allocator());
+    DeserializationError err = deserializeJson(doc, payload.data, payload.length);
     if (err) {
         logWarn(String("Light command JSON parse error: ") + err.c_str());
         return;
@@ -95,7 +39,11 @@ void LightCommandHandler::handle(const String& payload) {
     // Handle state (ON/OFF)
     if (doc["state"].is<const char*>()) {
         const char* st = doc["state"];
-        clockEnabled = (strcmp(st, "ON") == 0);
+        bool on = (strcmp(st, "ON") == 0);
+        if (on != clockEnabled) {
+            clockEnabled = on;
+            notifyStateChanged(StateChange::Light);
+        }
     }
     
     // Handle brightness
@@ -128,14 +76,14 @@ void LightCommandHandler::handle(const String& payload) {
 // Switch Command Handler
 // ============================================================================
 
-SwitchCommandHandler::SwitchCommandHandler(const String& name,
-                                          std::function<void(bool)> setter,
-                                          std::function<void()> publisher)
+SwitchCommandHandler::SwitchCommandHandler(const char* name,
+                                          void (*setter)(bool),
+                                          void (*publisher)())
     : name_(name), setter_(setter), publisher_(publisher) {}
 
-void SwitchCommandHandler::handle(const String& payload) {
-    bool on = (payload == "ON" || payload == "on" || payload == "1" || 
-               payload == "true" || payload == "True");
+void SwitchCommandHandler::handle(const MqttPayload& payload) {
+    bool on = (payload.equals("ON") || payload.equals("on") || payload.equals("1") ||
+               payload.equals("true") || payload.equals("True"));
     setter_(on);
     publisher_();
 }
@@ -145,12 +93,12 @@ void SwitchCommandHandler::handle(const String& payload) {
 // ============================================================================
 
 NumberCommandHandler::NumberCommandHandler(int min, int max,
-                                          std::function<void(int)> setter,
-                                          std::function<void()> publisher)
+                                          void (*setter)(int),
+                                          void (*publisher)())
     : min_(min), max_(max), setter_(setter), publisher_(publisher) {}
 
-void NumberCommandHandler::handle(const String& payload) {
-    int value = payload.toInt();
+void NumberCommandHandler::handle(const MqttPayload& payload) {
+    int value = (int)payload.toInt();
     value = constrain(value, min_, max_);
     setter_(value);
     publisher_();
@@ -160,35 +108,32 @@ void NumberCommandHandler::handle(const String& payload) {
 // Select Command Handler
 // ============================================================================
 
-SelectCommandHandler::SelectCommandHandler(const std::vector<String>& validOptions,
-                                          std::function<void(const String&)> setter,
-                                          std::function<void()> publisher)
-    : validOptions_(validOptions), setter_(setter), publisher_(publisher) {}
+SelectCommandHandler::SelectCommandHandler(const char* const* validOptions, size_t optionCount,
+                                          void (*setter)(const char*),
+                                          void (*publisher)())
+    : validOptions_(validOptions), optionCount_(optionCount),
+      setter_(setter), publisher_(publisher) {}
 
-void SelectCommandHandler::handle(const String& payload) {
+void SelectCommandHandler::handle(const MqttPayload& payload) {
     // Try exact match first
-    for (const auto& option : validOptions_) {
-        if (payload == option) {
-            setter_(payload);
+    for (size_t i = 0; i < optionCount_; ++i) {
+        if (payload.equals(validOptions_[i])) {
+            setter_(validOptions_[i]);
             publisher_();
             return;
         }
     }
     
     // Try case-insensitive match
-    String payloadUpper = payload;
-    payloadUpper.toUpperCase();
-    for (const auto& option : validOptions_) {
-        String optionUpper = option;
-        optionUpper.toUpperCase();
-        if (payloadUpper == optionUpper) {
-            setter_(option);  // Use the valid option, not the payload
+    for (size_t i = 0; i < optionCount_; ++i) {
+        if (payload.equalsIgnoreCase(validOptions_[i])) {
+            setter_(validOptions_[i]);  // Use the valid option, not the payload
             publisher_();
             return;
         }
     }
     
-    logWarn(String("Invalid option for select: ") + payload);
+    logWarn(String("Invalid option for select: ") + payload.toString());
 }
 
 // ============================================================================
@@ -196,16 +141,16 @@ void SelectCommandHandler::handle(const String& payload) {
 // ============================================================================
 
 TimeStringCommandHandler::TimeStringCommandHandler(
-    std::function<bool(const String&, uint16_t&)> parser,
-    std::function<void(uint16_t)> setter,
-    std::function<void()> publisher,
-    const String& name)
+    Parser parser,
+    void (*setter)(uint16_t),
+    void (*publisher)(),
+    const char* name)
     : parser_(parser), setter_(setter), publisher_(publisher), name_(name) {}
 
-void TimeStringCommandHandler::handle(const String& payload) {
+void TimeStringCommandHandler::handle(const MqttPayload& payload) {
     uint16_t minutes = 0;
-    if (!parser_(payload, minutes)) {
-        logWarn(String("Invalid time string for ") + name_ + ": " + payload);
+    if (!parser_(payload.data, payload.length, minutes)) {
+        logWarn(String("Invalid time string for ") + name_ + ": " + payload.toString());
         return;
     }
     setter_(minutes);
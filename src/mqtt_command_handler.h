@@ -2,72 +2,9 @@
 #define MQTT_COMMAND_HANDLER_H
 
 #include <Arduino.h>
-#include <functional>
-#include <map>
-#include <vector>
+#include <stddef.h>
 
-/**
- * @brief Base class for MQTT command handlers
- * 
- * Implements the Command Pattern to replace the large if-else chain
- * in handleMessage(). Each handler encapsulates the logic for one
- * specific MQTT topic/command.
- */
-class MqttCommandHandler {
-public:
-    virtual ~MqttCommandHandler() = default;
-    
-    /**
-     * @brief Handle an incoming MQTT message
-     * @param payload The message payload as a string
-     */
-    virtual void handle(const String& payload) = 0;
-};
-
-/**
- * @brief Registry of MQTT command handlers
- * 
- * Maps MQTT topics to their corresponding handlers.
- * Implements Singleton pattern for global access.
- */
-class MqttCommandRegistry {
-public:
-    static MqttCommandRegistry& instance();
-    
-    /**
-     * @brief Register a handler for a specific topic
-     * @param topic MQTT topic to handle
-     * @param handler Handler instance (ownership transferred to registry)
-     */
-    void registerHandler(const String& topic, MqttCommandHandler* handler);
-    
-    /**
-     * @brief Handle an incoming MQTT message
-     * @param topic MQTT topic
-     * @param payload Message payload
-     */
-    void handleMessage(const String& topic, const String& payload);
-    
-    /**
-     * @brief Helper for simple lambda handlers
-     * @param topic MQTT topic
-     * @param handler Lambda function to handle the message
-     */
-    void registerLambda(const String& topic, 
-                       std::function<void(const String&)> handler);
-    
-    /**
-     * @brief Clear all registered handlers (useful for testing)
-     */
-    void clear();
-    
-private:
-    MqttCommandRegistry() = default;
-    ~MqttCommandRegistry();
-    
-    std::map<String, MqttCommandHandler*> handlers_;
-    std::map<String, std::function<void(const String&)>> lambdaHandlers_;
-};
+#include "mqtt_command_registry.h"
 
 /**
  * @brief Handler for light commands (JSON with state/brightness/color)
@@ -76,7 +13,7 @@ private:
  */
 class LightCommandHandler : public MqttCommandHandler {
 public:
-    void handle(const String& payload) override;
+    void handle(const MqttPayload& payload) override;
 };
 
 /**
@@ -86,15 +23,15 @@ public:
  */
 class SwitchCommandHandler : public MqttCommandHandler {
 public:
-    SwitchCommandHandler(const String& name, 
-                        std::function<void(bool)> setter,
-                        std::function<void()> publisher);
-    void handle(const String& payload) override;
+    SwitchCommandHandler(const char* name,
+                        void (*setter)(bool),
+                        void (*publisher)());
+    void handle(const MqttPayload& payload) override;
     
 private:
-    String name_;
-    std::function<void(bool)> setter_;
-    std::function<void()> publisher_;
+    const char* name_;
+    void (*setter_)(bool);
+    void (*publisher_)();
 };
 
 /**
@@ -105,32 +42,40 @@ private:
 class NumberCommandHandler : public MqttCommandHandler {
 public:
     NumberCommandHandler(int min, int max,
-                        std::function<void(int)> setter,
-                        std::function<void()> publisher);
-    void handle(const String& payload) override;
+                        void (*setter)(int),
+                        void (*publisher)());
+    void handle(const MqttPayload& payload) override;
     
 private:
     int min_, max_;
-    std::function<void(int)> setter_;
-    std::function<void()> publisher_;
+    void (*setter_)(int);
+    void (*publisher_)();
 };
 
 /**
  * @brief Generic handler for select/enum commands
  * 
- * Handles selection from a list of valid options.
+ * Handles selection from a list of valid options. The options array is
+ * referenced, not copied, so it must outlive the handler (a static table).
+ * The setter always receives the canonical option, never the payload.
  */
 class SelectCommandHandler : public MqttCommandHandler {
 public:
-    SelectCommandHandler(const std::vector<String>& validOptions,
-                        std::function<void(const String&)> setter,
-                        std::function<void()> publisher);
-    void handle(const String& payload) override;
+    SelectCommandHandler(const char* const* validOptions, size_t optionCount,
+                        void (*setter)(const char*),
+                        void (*publisher)());
+    template <size_t N>
+    SelectCommandHandler(const char* const (&validOptions)[N],
+                        void (*setter)(const char*),
+                        void (*publisher)())
+        : SelectCommandHandler(validOptions, N, setter, publisher) {}
+    void handle(const MqttPayload& payload) override;
     
 private:
-    std::vector<String> validOptions_;
-    std::function<void(const String&)> setter_;
-    std::function<void()> publisher_;
+    const char* const* validOptions_;
+    size_t optionCount_;
+    void (*setter_)(const char*);
+    void (*publisher_)();
 };
 
 /**
@@ -140,17 +85,19 @@ private:
  */
 class TimeStringCommandHandler : public MqttCommandHandler {
 public:
-    TimeStringCommandHandler(std::function<bool(const String&, uint16_t&)> parser,
-                            std::function<void(uint16_t)> setter,
-                            std::function<void()> publisher,
-                            const String& name);
-    void handle(const String& payload) override;
+    using Parser = bool (*)(const char* text, size_t length, uint16_t& minutesOut);
+
+    TimeStringCommandHandler(Parser parser,
+                            void (*setter)(uint16_t),
+                            void (*publisher)(),
+                            const char* name);
+    void handle(const MqttPayload& payload) override;
     
 private:
-    std::function<bool(const String&, uint16_t&)> parser_;
-    std::function<void(uint16_t)> setter_;
-    std::function<void()> publisher_;
-    String name_;
+    Parser parser_;
+    void (*setter_)(uint16_t);
+    void (*publisher_)();
+    const char* name_;
 };
 
 #endif // MQTT_COMMAND_HANDLER_H
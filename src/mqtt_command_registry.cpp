@@ -0,0 +1,112 @@
+#include "mqtt_command_registry.h"
+#include "log.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Payload view
+// ============================================================================
+
+bool MqttPayload::equals(const char* s) const {
+    return s && strlen(s) == length && memcmp(data, s, length) == 0;
+}
+
+bool MqttPayload::equalsIgnoreCase(const char* s) const {
+    if (!s || strlen(s) != length) return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (tolower((unsigned char)data[i]) != tolower((unsigned char)s[i])) return false;
+    }
+    return true;
+}
+
+long MqttPayload::toInt() const {
+    // atol() needs a terminator; any number that fits a long is this short
+    char buf[24];
+    size_t n = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+    memcpy(buf, data, n);
+    buf[n] = '\0';
+    return atol(buf);
+}
+
+String MqttPayload::toString() const {
+    return String(data, length);
+}
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+MqttCommandRegistry& MqttCommandRegistry::instance() {
+    static MqttCommandRegistry registry;
+    return registry;
+}
+
+namespace {
+
+// Adapts registerLambda() callbacks so every topic has exactly one slot.
+class FunctionCommandHandler : public MqttCommandHandler {
+public:
+    explicit FunctionCommandHandler(MqttCommandRegistry::CommandFn fn) : fn_(fn) {}
+    void handle(const MqttPayload& payload) override { fn_(payload); }
+
+private:
+    MqttCommandRegistry::CommandFn fn_;
+};
+
+} // namespace
+
+MqttCommandRegistry::~MqttCommandRegistry() {
+    clear();
+}
+
+void* MqttCommandRegistry::allocate(size_t size, size_t align) {
+    if (sealed_) {
+        logError("❌ MQTT command registry is sealed; handler not registered");
+        return nullptr;
+    }
+    size_t start = (arenaUsed_ + align - 1) & ~(align - 1);
+    if (start + size > sizeof(arena_)) {
+        logError(String("❌ MQTT handler arena full (") + (unsigned long)sizeof(arena_) + " bytes)");
+        return nullptr;
+    }
+    arenaUsed_ = start + size;
+    return arena_ + start;
+}
+
+void MqttCommandRegistry::install(MqttTopic topic, MqttCommandHandler* handler) {
+    size_t idx = static_cast<size_t>(topic);
+    // A replaced handler is destroyed now; its bytes come back on clear()
+    if (handlers_[idx]) handlers_[idx]->~MqttCommandHandler();
+    handlers_[idx] = handler;
+}
+
+bool MqttCommandRegistry::registerLambda(MqttTopic topic, CommandFn fn) {
+    if (!fn) return false;
+    return emplace<FunctionCommandHandler>(topic, fn);
+}
+
+bool MqttCommandRegistry::handleMessage(MqttTopic topic, const MqttPayload& payload) {
+    size_t idx = static_cast<size_t>(topic);
+    if (idx >= kMqttTopicCount || !handlers_[idx]) return false;
+    handlers_[idx]->handle(payload);
+    return true;
+}
+
+size_t MqttCommandRegistry::handlerCount() const {
+    size_t n = 0;
+    for (auto* handler : handlers_) {
+        if (handler) n++;
+    }
+    return n;
+}
+
+void MqttCommandRegistry::clear() {
+    for (auto& handler : handlers_) {
+        if (handler) handler->~MqttCommandHandler();
+        handler = nullptr;
+    }
+    arenaUsed_ = 0;
+    sealed_ = false;
+}
@@ -0,0 +1,134 @@
+#ifndef MQTT_COMMAND_REGISTRY_H
+#define MQTT_COMMAND_REGISTRY_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "mqtt_topics.h"
+
+// Bytes for all command handler objects. The production set needs a few
+// hundred; registering past the end fails instead of falling back to the heap.
+#ifndef MQTT_HANDLER_ARENA_SIZE
+#define MQTT_HANDLER_ARENA_SIZE 1024
+#endif
+
+/**
+ * @brief Non-owning view of an inbound MQTT payload
+ *
+ * Points straight into PubSubClient's receive buffer, which stays valid for
+ * the duration of the callback. Handlers that need to keep the payload must
+ * copy it.
+ */
+struct MqttPayload {
+  const char* data = "";
+  size_t length = 0;
+
+  MqttPayload() = default;
+  MqttPayload(const char* d, size_t n) : data(d ? d : ""), length(d ? n : 0) {}
+
+  bool equals(const char* s) const;
+  bool equalsIgnoreCase(const char* s) const;
+  /** Leading integer, same rules as String::toInt(); 0 if there is none. */
+  long toInt() const;
+  /** Copy into a String, for log messages. */
+  String toString() const;
+};
+
+/**
+ * @brief Base class for MQTT command handlers
+ *
+ * Implements the Command Pattern to replace the large if-else chain
+ * in handleMessage(). Each handler encapsulates the logic for one
+ * specific MQTT topic/command.
+ */
+class MqttCommandHandler {
+public:
+    virtual ~MqttCommandHandler() = default;
+
+    /**
+     * @brief Handle an incoming MQTT message
+     * @param payload View of the message payload (not NUL-terminated)
+     */
+    virtual void handle(const MqttPayload& payload) = 0;
+};
+
+/**
+ * @brief Registry of MQTT command handlers
+ *
+ * Topics are resolved to an MqttTopic by MqttTopicTable::match() first
+ * (binary search over the suffixes), so dispatch is an array index rather
+ * than a String-keyed map lookup.
+ *
+ * Handlers are constructed in place in a fixed arena owned by the registry;
+ * nothing is allocated per handler. After initCommandHandlers() the registry
+ * is sealed: later registrations are refused until clear().
+ * Implements Singleton pattern for global access.
+ */
+class MqttCommandRegistry {
+public:
+    using CommandFn = void (*)(const MqttPayload& payload);
+
+    static MqttCommandRegistry& instance();
+
+    /**
+     * @brief Construct a handler of type T in the arena for a topic
+     * @return false if sealed, out of arena space or topic out of range
+     */
+    template <typename T, typename... Args>
+    bool emplace(MqttTopic topic, Args&&... args) {
+        static_assert(std::is_base_of<MqttCommandHandler, T>::value,
+                      "handlers must derive from MqttCommandHandler");
+        if (static_cast<size_t>(topic) >= kMqttTopicCount) return false;
+        void* mem = allocate(sizeof(T), alignof(T));
+        if (!mem) return false;
+        install(topic, new (mem) T(std::forward<Args>(args)...));
+        return true;
+    }
+
+    /**
+     * @brief Helper for simple handlers without state
+     * @param topic MQTT topic
+     * @param fn Function (or captureless lambda) to handle the message
+     */
+    bool registerLambda(MqttTopic topic, CommandFn fn);
+
+    /**
+     * @brief Handle an incoming MQTT message
+     * @param topic MQTT topic
+     * @param payload Message payload
+     * @return false if no handler is registered for the topic
+     */
+    bool handleMessage(MqttTopic topic, const MqttPayload& payload);
+
+    /** Refuse further registrations; dispatch is unaffected. */
+    void seal() { sealed_ = true; }
+    bool sealed() const { return sealed_; }
+
+    size_t handlerCount() const;
+    size_t arenaUsed() const { return arenaUsed_; }
+
+    /**
+     * @brief Destroy all handlers and unseal (useful for testing)
+     */
+    void clear();
+
+private:
+    MqttCommandRegistry() = default;
+    ~MqttCommandRegistry();
+    MqttCommandRegistry(const MqttCommandRegistry&) = delete;
+    MqttCommandRegistry& operator=(const MqttCommandRegistry&) = delete;
+
+    void* allocate(size_t size, size_t align);
+    void install(MqttTopic topic, MqttCommandHandler* handler);
+
+    alignas(alignof(max_align_t)) uint8_t arena_[MQTT_HANDLER_ARENA_SIZE];
+    size_t arenaUsed_ = 0;
+    bool sealed_ = false;
+    MqttCommandHandler* handlers_[kMqttTopicCount] = {};
+};
+
+#endif // MQTT_COMMAND_REGISTRY_H
@@ -1,7 +1,13 @@
 #include "mqtt_discovery_builder.h"
 #include "log.h"
+#include "mqtt_setup.h"
 #include <utility>
 
+// Discovery documents are larger than PubSubClient's 256-byte default buffer
+static const uint16_t DISCOVERY_BUFFER_SIZE = 1024;
+
+static JsonArenaSite discoverySite("mqtt discovery set");
+
 MqttDiscoveryBuilder::MqttDiscoveryBuilder(PubSubClient& mqtt,
                                            const String& discoveryPrefix,
                                            const String& nodeId,
@@ -11,7 +17,9 @@ MqttDiscoveryBuilder::MqttDiscoveryBuilder(PubSubClient& mqtt,
       discoveryPrefix_(discoveryPrefix),
       nodeId_(nodeId),
       baseTopic_(baseTopic),
-      availTopic_(availTopic) {
+      availTopic_(availTopic),
+      arena_(MQTT_DISCOVERY_ARENA_BYTES),
+      arenaScope_(discoverySite, arena_) {
 }
 
 void MqttDiscoveryBuilder::setDeviceInfo(const String& name,
@@ -46,7 +54,7 @@ void MqttDiscoveryBuilder::addAvailability(JsonDocument& doc) {
 }
 
 void MqttDiscoveryBuilder::addLight(const String& stateTopic, const String& cmdTopic) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "light";
     entity.objectId = nodeId_ + "_light";
     
@@ -68,7 +76,7 @@ void MqttDiscoveryBuilder::addLight(const String& stateTopic, const String& cmdT
 
 void MqttDiscoveryBuilder::addSwitch(const String& name, const String& uniqueId,
                                      const String& stateTopic, const String& cmdTopic) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "switch";
     entity.objectId = uniqueId;
     
@@ -89,7 +97,7 @@ void MqttDiscoveryBuilder::addNumber(const String& name, const String& uniqueId,
                                      const String& stateTopic, const String& cmdTopic,
                                      int min, int max, int step,
                                      const String& unit, const String& mode) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "number";
     entity.objectId = uniqueId;
     
@@ -115,7 +123,7 @@ void MqttDiscoveryBuilder::addNumber(const String& name, const String& uniqueId,
 void MqttDiscoveryBuilder::addSelect(const String& name, const String& uniqueId,
                                      const String& stateTopic, const String& cmdTopic,
                                      const std::vector<String>& options) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "select";
     entity.objectId = uniqueId;
     
@@ -138,7 +146,7 @@ void MqttDiscoveryBuilder::addSelect(const String& name, const String& uniqueId,
 void MqttDiscoveryBuilder::addBinarySensor(const String& name, const String& uniqueId,
                                            const String& stateTopic,
                                            const String& deviceClass) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "binary_sensor";
     entity.objectId = uniqueId;
     
@@ -161,7 +169,7 @@ void MqttDiscoveryBuilder::addBinarySensor(const String& name, const String& uni
 void MqttDiscoveryBuilder::addButton(const String& name, const String& uniqueId,
                                      const String& cmdTopic,
                                      const String& deviceClass) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "button";
     entity.objectId = uniqueId;
     
@@ -184,7 +192,7 @@ void MqttDiscoveryBuilder::addSensor(const String& name, const String& uniqueId,
                                      const String& unit,
                                      const String& deviceClass,
                                      const String& stateClass) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "sensor";
     entity.objectId = uniqueId;
     
@@ -212,7 +220,7 @@ void MqttDiscoveryBuilder::addText(const String& name, const String& uniqueId,
                                    const String& stateTopic, const String& cmdTopic,
                                    int minLen, int maxLen,
                                    const String& pattern, const String& mode) {
-    Entity entity;
+    Entity entity(&arena_);
     entity.component = "text";
     entity.objectId = uniqueId;
     
@@ -234,22 +242,35 @@ void MqttDiscoveryBuilder::addText(const String& name, const String& uniqueId,
     entities_.push_back(std::move(entity));
 }
 
-void MqttDiscoveryBuilder::publishEntity(const Entity& entity) {
-    String topic = discoveryPrefix_ + "/" + entity.component + "/" + 
-                   entity.objectId + "/config";
-    
-    String output;
-    serializeJson(entity.config, output);
+String MqttDiscoveryBuilder::configTopic(const Entity& entity) const {
+    return discoveryPrefix_ + "/" + entity.component + "/" + 
+           entity.objectId + "/config";
+}
+
+bool MqttDiscoveryBuilder::publishEntity(const Entity& entity) {
+    String topic = configTopic(entity);
+    
+    // Serialized into the arena and handed back right after the publish
+    size_t length = measureJson(entity.config);
+    char* output = static_cast<char*>(arena_.allocate(length + 1));
+    if (!output) {
+        logWarn(String("No memory to publish: ") + entity.component + "/" + entity.objectId);
+        return false;
+    }
+    length = serializeJson(entity.config, output, length + 1);
+    bool sent = mqtt_.publish(topic.c_str(), reinterpret_cast<const uint8_t*>(output), length, true);
+    arena_.deallocate(output);
     
-    if (mqtt_.publish(topic.c_str(), output.c_str(), true)) {
+    if (sent) {
         logDebug(String("Published discovery: ") + entity.component + "/" + entity.objectId);
-    } else {
-        logWarn(String("Failed to publish: ") + entity.component + "/" + entity.objectId);
+        return true;
     }
+    logWarn(String("Failed to publish: ") + entity.component + "/" + entity.objectId);
+    return false;
 }
 
 int MqttDiscoveryBuilder::publish() {
-    mqtt_.setBufferSize(1024);
+    mqtt_.setBufferSize(DISCOVERY_BUFFER_SIZE);
     
     int published = 0;
     for (const auto& entity : entities_) {
@@ -262,6 +283,41 @@ int MqttDiscoveryBuilder::publish() {
     return published;
 }
 
+bool MqttDiscoveryBuilder::publishAt(size_t index) {
+    if (index >= entities_.size()) return false;
+    if (mqtt_.getBufferSize() < DISCOVERY_BUFFER_SIZE) {
+        mqtt_.setBufferSize(DISCOVERY_BUFFER_SIZE);
+    }
+    return publishEntity(entities_[index]);
+}
+
+static void hashChunk(void* ctx, const char* data, size_t length) {
+    uint32_t& h = *static_cast<uint32_t*>(ctx);
+    h = MqttDiscoveryCache::hashBytes(h, data, length);
+}
+
+uint32_t MqttDiscoveryBuilder::entityHash(size_t index, uint32_t seed) const {
+    if (index >= entities_.size()) return seed;
+    const Entity& entity = entities_[index];
+    String topic = configTopic(entity);
+    uint32_t h = MqttDiscoveryCache::hashString(seed, topic.c_str());
+    // Hashed as it is serialized, then the terminator, as hashString() would
+    char buf[64];
+    JsonChunkWriter writer(buf, sizeof(buf), hashChunk, &h);
+    serializeJson(entity.config, writer);
+    writer.flush();
+    return MqttDiscoveryCache::hashBytes(h, "", 1);
+}
+
+uint32_t MqttDiscoveryBuilder::contentHash(uint32_t seed) const {
+    uint32_t h = seed;
+    for (size_t i = 0; i < entities_.size(); ++i) {
+        h = entityHash(i, h);
+    }
+    return h;
+}
+
 void MqttDiscoveryBuilder::clear() {
     entities_.clear();
+    arena_.rewind(0);
 }
@@ -6,6 +6,14 @@
 #include <PubSubClient.h>
 #include <vector>
 
+#include "json_arena.h"
+
+// Arena for the whole discovery set; taken when the first entity is added
+// and released with the builder.
+#ifndef MQTT_DISCOVERY_ARENA_BYTES
+#define MQTT_DISCOVERY_ARENA_BYTES 16384
+#endif
+
 /**
  * @brief Builder for Home Assistant MQTT Discovery messages
  * 
@@ -14,6 +22,9 @@
  * - Managing topic generation
  * - Providing type-safe entity builders
  * - Batching publications
+ *
+ * Entity documents live in one arena owned by the builder, so a discovery
+ * set costs one block instead of a few hundred small heap allocations.
  */
 class MqttDiscoveryBuilder {
 public:
@@ -79,6 +90,26 @@ public:
      */
     int publish();
     
+    /** Number of configured entities. */
+    size_t size() const { return entities_.size(); }
+    
+    /**
+     * @brief Publish a single entity, for spreading discovery over loop ticks
+     * @return false if the index is out of range or the publish failed
+     */
+    bool publishAt(size_t index);
+    
+    /**
+     * @brief Hash of every config topic and payload, in order
+     *
+     * Two builders with the same entities, device info and topics hash the
+     * same; used to skip republishing a discovery set the broker already has.
+     */
+    uint32_t contentHash(uint32_t seed) const;
+    
+    /** Fold one entity's topic and payload into a running contentHash(). */
+    uint32_t entityHash(size_t index, uint32_t seed) const;
+    
     /**
      * @brief Clear all entities (for republishing)
      */
@@ -86,6 +117,7 @@ public:
     
 private:
     struct Entity {
+        explicit Entity(ArduinoJson::Allocator* allocator) : config(allocator) {}
         String component;
         String objectId;
         JsonDocument config;
@@ -93,7 +125,8 @@ private:
     
     void addDeviceInfo(JsonDocument& doc);
     void addAvailability(JsonDocument& doc);
-    void publishEntity(const Entity& entity);
+    bool publishEntity(const Entity& entity);
+    String configTopic(const Entity& entity) const;
     
     PubSubClient& mqtt_;
     String discoveryPrefix_;
@@ -106,6 +139,9 @@ private:
     String deviceManufacturer_;
     String deviceSwVersion_;
     
+    // Declared in this order so the documents go before their arena
+    JsonArena arena_;
+    JsonScope arenaScope_;
     std::vector<Entity> entities_;
 };
 
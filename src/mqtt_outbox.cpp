@@ -0,0 +1,69 @@
+#include "mqtt_outbox.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem_pool.h"
+
+MqttOutbox::~MqttOutbox() {
+  if (slots_) poolFree(MemPool::Bulk, slots_, storageBytes());
+}
+
+bool MqttOutbox::begin() {
+  if (slots_) poolFree(MemPool::Bulk, slots_, storageBytes());
+  // Queue contents are only touched from the loop task
+  slots_ = static_cast<Slot*>(poolCalloc(MemPool::Bulk, storageBytes()));
+  clear();
+  peak_ = 0;
+  dropped_ = 0;
+  coalesced_ = 0;
+  return slots_ != nullptr;
+}
+
+bool MqttOutbox::putState(MqttTopic topic, const char* payload, size_t length) {
+  if (!slots_ || static_cast<size_t>(topic) >= kMqttTopicCount) return false;
+  if (!payload || length > MQTT_OUTBOX_PAYLOAD_MAX) {
+    dropped_++;
+    return false;
+  }
+  if (pending_ & bit(topic)) coalesced_++;
+  Slot& slot = slots_[static_cast<size_t>(topic)];
+  memcpy(slot.data, payload, length);
+  slot.length = static_cast<uint16_t>(length);
+  pending_ |= bit(topic);
+  notePeak();
+  return true;
+}
+
+void MqttOutbox::discardState(MqttTopic topic) {
+  if (static_cast<size_t>(topic) < kMqttTopicCount) pending_ &= ~bit(topic);
+}
+
+bool MqttOutbox::peek(Message& out) const {
+  if (!pending_) return false;
+  size_t i = 0;
+  while (!(pending_ & (1ULL << i))) i++;
+  out.topic = static_cast<MqttTopic>(i);
+  out.payload = slots_[i].data;
+  out.length = slots_[i].length;
+  return true;
+}
+
+void MqttOutbox::pop() {
+  if (pending_) pending_ &= pending_ - 1;  // lowest set bit is what peek() returned
+}
+
+void MqttOutbox::clear() {
+  pending_ = 0;
+}
+
+size_t MqttOutbox::depth() const {
+  size_t n = 0;
+  for (uint64_t p = pending_; p; p &= p - 1) n++;
+  return n;
+}
+
+void MqttOutbox::notePeak() {
+  size_t d = depth();
+  if (d > peak_) peak_ = d;
+}
@@ -0,0 +1,83 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mqtt_topics.h"
+
+#ifndef MQTT_OUTBOX_PAYLOAD_MAX
+#define MQTT_OUTBOX_PAYLOAD_MAX 128  // light state JSON is the largest at 111 bytes
+#endif
+
+/**
+ * @brief Bounded store for retained state published while the broker is unreachable
+ *
+ * One slot per MqttTopic, last value wins: ten brightness changes while
+ * offline become a single publish after reconnect. There is no event lane;
+ * the only one-shot message (birth) is sent on connect, so nothing would
+ * ever be queued in one.
+ *
+ * Storage is one fixed block taken at begin(), from PSRAM when the board has
+ * it, so the queue never grows and never touches internal RAM at runtime.
+ * Payloads longer than MQTT_OUTBOX_PAYLOAD_MAX are refused and counted as
+ * dropped.
+ *
+ * Drain order is topic order.
+ */
+class MqttOutbox {
+public:
+  struct Message {
+    MqttTopic topic;
+    const char* payload;
+    size_t length;
+  };
+
+  MqttOutbox() = default;
+  ~MqttOutbox();
+  MqttOutbox(const MqttOutbox&) = delete;
+  MqttOutbox& operator=(const MqttOutbox&) = delete;
+
+  /** Allocate a slot for every topic. */
+  bool begin();
+  bool ready() const { return slots_ != nullptr; }
+
+  /** Queue retained state for topic, replacing anything pending for it. */
+  bool putState(MqttTopic topic, const char* payload, size_t length);
+  /** Forget pending state for topic (a newer value went out directly). */
+  void discardState(MqttTopic topic);
+
+  /** Next message to send, without removing it. */
+  bool peek(Message& out) const;
+  /** Remove the message last returned by peek(). */
+  void pop();
+  void clear();
+
+  bool empty() const { return depth() == 0; }
+  size_t depth() const;
+  size_t peakDepth() const { return peak_; }
+  size_t capacity() const { return kMqttTopicCount; }
+  /** Messages lost because the payload was too large. */
+  uint32_t droppedCount() const { return dropped_; }
+  /** State updates that replaced a still-pending value for the same topic. */
+  uint32_t coalescedCount() const { return coalesced_; }
+
+private:
+  struct Slot {
+    uint16_t length;
+    char data[MQTT_OUTBOX_PAYLOAD_MAX];
+  };
+
+  static_assert(kMqttTopicCount <= 64, "outbox uses a 64-bit pending mask");
+  static uint64_t bit(MqttTopic topic) { return 1ULL << static_cast<uint8_t>(topic); }
+  static size_t storageBytes() { return kMqttTopicCount * sizeof(Slot); }
+  void notePeak();
+
+  Slot* slots_ = nullptr;  // indexed by topic
+  uint64_t pending_ = 0;
+  size_t peak_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t coalesced_ = 0;
+};
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,164 @@
+#include "mqtt_publisher.h"
+
+#include <stdio.h>
+#include <string.h>
+
+uint32_t MqttPublisher::hashPayload(const char* payload, size_t length) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= static_cast<uint8_t>(payload[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+bool MqttPublisher::send(MqttTopic topic, const char* payload, size_t length, bool retained, uint32_t hash) {
+  bool ok = client_.publish(topics_.get(topic),
+                            reinterpret_cast<const uint8_t*>(payload),
+                            static_cast<unsigned int>(length), retained);
+  if (ok) {
+    published_++;
+    if (retained) {
+      hash_[static_cast<size_t>(topic)] = hash;
+      valid_ |= bit(topic);
+    }
+  } else {
+    failed_++;
+    invalidate(topic);
+  }
+  return ok;
+}
+
+bool MqttPublisher::publish(MqttTopic topic, const char* payload, size_t length, bool retained) {
+  if (!topics_.isBuilt() || !payload || static_cast<size_t>(topic) >= kMqttTopicCount) {
+    failed_++;
+    return false;
+  }
+  size_t idx = static_cast<size_t>(topic);
+  uint32_t h = 0;
+  if (retained) {
+    h = hashPayload(payload, length);
+    if (isCached(topic) && hash_[idx] == h) {
+      suppressed_++;
+      return true;
+    }
+  }
+  // Only retained state is worth delivering late; an offline event is lost
+  bool queue = retained && outbox_;
+  if (queue && !client_.connected()) {
+    return enqueue(topic, payload, length);
+  }
+  bool ok = send(topic, payload, length, retained, h);
+  if (ok) {
+    // A newer value went out directly; the queued one is stale
+    if (queue) outbox_->discardState(topic);
+  } else if (queue && !client_.connected()) {
+    // The write that found the dead link is kept too
+    return enqueue(topic, payload, length);
+  }
+  return ok;
+}
+
+bool MqttPublisher::enqueue(MqttTopic topic, const char* payload, size_t length) {
+  if (!outbox_->putState(topic, payload, length)) {
+    failed_++;
+    return false;
+  }
+  queued_++;
+  // What the broker retains is no longer what we want it to have
+  invalidate(topic);
+  return true;
+}
+
+bool MqttPublisher::publishEvent(MqttTopic topic, const char* payload, size_t length, bool retained) {
+  if (!topics_.isBuilt() || !payload || static_cast<size_t>(topic) >= kMqttTopicCount) {
+    failed_++;
+    return false;
+  }
+  bool ok = client_.publish(topics_.get(topic),
+                            reinterpret_cast<const uint8_t*>(payload),
+                            static_cast<unsigned int>(length), retained);
+  if (ok) published_++;
+  else failed_++;
+  return ok;
+}
+
+size_t MqttPublisher::drainOutbox(size_t maxMessages) {
+  if (!outbox_ || !topics_.isBuilt()) return 0;
+  size_t sent = 0;
+  MqttOutbox::Message m;
+  for (size_t n = 0; n < maxMessages && client_.connected() && outbox_->peek(m); ++n) {
+    uint32_t h = hashPayload(m.payload, m.length);
+    if (isCached(m.topic) && hash_[static_cast<size_t>(m.topic)] == h) {
+      suppressed_++;
+      outbox_->pop();
+      continue;
+    }
+    if (!send(m.topic, m.payload, m.length, true, h)) break;
+    outbox_->pop();
+    sent++;
+  }
+  return sent;
+}
+
+bool MqttPublisher::publish(MqttTopic topic, const char* payload, bool retained) {
+  return publish(topic, payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool MqttPublisher::publishSwitch(MqttTopic topic, bool on, bool retained) {
+  return on ? publish(topic, "ON", 2, retained) : publish(topic, "OFF", 3, retained);
+}
+
+bool MqttPublisher::publishInt(MqttTopic topic, long value, bool retained) {
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%ld", value);
+  return publish(topic, buf, static_cast<size_t>(n), retained);
+}
+
+bool MqttPublisher::publishUInt(MqttTopic topic, unsigned long value, bool retained) {
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%lu", value);
+  return publish(topic, buf, static_cast<size_t>(n), retained);
+}
+
+bool MqttPublisher::publishIntDeadband(MqttTopic topic, long value, long deadband) {
+  size_t idx = static_cast<size_t>(topic);
+  if (idx >= kMqttTopicCount) {
+    failed_++;
+    return false;
+  }
+  if (isCached(topic)) {
+    long delta = value - lastValue_[idx];
+    if (delta < 0) delta = -delta;
+    if (delta < deadband) {
+      suppressed_++;
+      return true;
+    }
+  }
+  bool ok = publishInt(topic, value, true);
+  if (ok) lastValue_[idx] = value;
+  return ok;
+}
+
+size_t MqttPublisher::formatLightState(char* buf, size_t size, bool on, uint8_t brightness,
+                                       uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+  int n = snprintf(buf, size,
+                   "{\"state\":\"%s\",\"brightness\":%u,\"color_mode\":\"rgbw\","
+                   "\"color\":{\"r\":%u,\"g\":%u,\"b\":%u,\"w\":%u}}",
+                   on ? "ON" : "OFF", (unsigned)brightness,
+                   (unsigned)r, (unsigned)g, (unsigned)b, (unsigned)w);
+  if (n < 0 || static_cast<size_t>(n) >= size) return 0;
+  return static_cast<size_t>(n);
+}
+
+bool MqttPublisher::publishLightState(bool on, uint8_t brightness,
+                                      uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+  // Worst case is 111 bytes (OFF, every channel 255).
+  char buf[128];
+  size_t n = formatLightState(buf, sizeof(buf), on, brightness, r, g, b, w);
+  if (n == 0) {
+    failed_++;
+    return false;
+  }
+  return publish(MqttTopic::LightState, buf, n, true);
+}
@@ -0,0 +1,114 @@
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <PubSubClient.h>
+
+#include "mqtt_outbox.h"
+#include "mqtt_topics.h"
+
+/**
+ * @brief Publishes device state by topic id, from stack buffers only
+ *
+ * Every payload is written with snprintf into a local buffer and handed to
+ * PubSubClient's (topic, bytes, length) overload, so a full state round does
+ * not touch the heap. The topic strings come from a prebuilt MqttTopicTable.
+ *
+ * Retained publishes go through a diff cache: each topic remembers a hash of
+ * the payload it last delivered, and an identical payload is counted as
+ * suppressed instead of being sent again. invalidate() forgets the cache so
+ * the next round goes out in full (on connect and on the periodic refresh).
+ * Non-retained publishes are events and always go out.
+ *
+ * With an outbox attached, retained publishes made while the client is
+ * disconnected are queued instead of lost, last value wins per topic.
+ * drainOutbox() sends them once the session is back. Events are not queued.
+ */
+class MqttPublisher {
+public:
+  MqttPublisher(PubSubClient& client, const MqttTopicTable& topics)
+    : client_(client), topics_(topics) {}
+
+  bool publish(MqttTopic topic, const char* payload, size_t length, bool retained = true);
+  bool publish(MqttTopic topic, const char* payload, bool retained = true);
+
+  /**
+   * @brief One-shot message (birth, notifications)
+   *
+   * Bypasses the diff cache and is never queued: offline, it fails.
+   */
+  bool publishEvent(MqttTopic topic, const char* payload, size_t length, bool retained = false);
+
+  /** "ON" / "OFF", as Home Assistant switches and binary sensors expect. */
+  bool publishSwitch(MqttTopic topic, bool on, bool retained = true);
+  bool publishInt(MqttTopic topic, long value, bool retained = true);
+  bool publishUInt(MqttTopic topic, unsigned long value, bool retained = true);
+
+  /**
+   * @brief Retained number that only goes out when it moved by >= deadband
+   *
+   * For noisy sensors (RSSI, free heap) where every small wobble would
+   * otherwise be a new payload. The reference is the last value sent.
+   */
+  bool publishIntDeadband(MqttTopic topic, long value, long deadband);
+
+  /**
+   * @brief Home Assistant JSON light state
+   *
+   * Same bytes as the ArduinoJson document this replaced:
+   * {"state":"ON","brightness":N,"color_mode":"rgbw","color":{"r":..,"g":..,"b":..,"w":..}}
+   */
+  bool publishLightState(bool on, uint8_t brightness,
+                         uint8_t r, uint8_t g, uint8_t b, uint8_t w);
+
+  /** Writes the light state JSON into buf; returns the length or 0 if it did not fit. */
+  static size_t formatLightState(char* buf, size_t size, bool on, uint8_t brightness,
+                                 uint8_t r, uint8_t g, uint8_t b, uint8_t w);
+
+  /** Queue retained publishes made while disconnected; nullptr drops them as before. */
+  void setOutbox(MqttOutbox* outbox) { outbox_ = outbox; }
+  MqttOutbox* outbox() const { return outbox_; }
+
+  /**
+   * @brief Send up to maxMessages queued messages
+   *
+   * Stops early when the client is not connected or a publish fails; the
+   * failed message stays at the head of the queue. Returns the number sent.
+   */
+  size_t drainOutbox(size_t maxMessages);
+
+  /** Forget what was sent, so the next retained publish of every topic goes out. */
+  void invalidate() { valid_ = 0; }
+  void invalidate(MqttTopic topic) { valid_ &= ~bit(topic); }
+
+  uint32_t publishedCount() const { return published_; }
+  uint32_t failedCount() const { return failed_; }
+  /** Retained publishes skipped because the payload was unchanged or inside the deadband. */
+  uint32_t suppressedCount() const { return suppressed_; }
+  /** Retained publishes handed to the outbox because the client was offline. */
+  uint32_t queuedCount() const { return queued_; }
+
+  /** 32-bit FNV-1a; exposed for tests. */
+  static uint32_t hashPayload(const char* payload, size_t length);
+
+private:
+  static_assert(kMqttTopicCount <= 64, "diff cache uses a 64-bit valid mask");
+  static uint64_t bit(MqttTopic topic) { return 1ULL << static_cast<uint8_t>(topic); }
+  bool isCached(MqttTopic topic) const { return (valid_ & bit(topic)) != 0; }
+  bool send(MqttTopic topic, const char* payload, size_t length, bool retained, uint32_t hash);
+  bool enqueue(MqttTopic topic, const char* payload, size_t length);
+
+  PubSubClient& client_;
+  const MqttTopicTable& topics_;
+  MqttOutbox* outbox_ = nullptr;
+  uint32_t hash_[kMqttTopicCount] = {};
+  long lastValue_[kMqttTopicCount] = {};
+  uint64_t valid_ = 0;
+  uint32_t published_ = 0;
+  uint32_t failed_ = 0;
+  uint32_t suppressed_ = 0;
+  uint32_t queued_ = 0;
+};
+
+#endif // MQTT_PUBLISHER_H
@@ -0,0 +1,126 @@
+#include "mqtt_setup.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+
+static const char* DISCOVERY_PREFS_NS = "mqtt_disc";
+static const char* DISCOVERY_HASH_KEY = "hash";
+
+void MqttSetupSequence::begin(const MqttSetupStep* steps, size_t stepCount,
+                              const MqttSetupBudget& budget) {
+  steps_ = steps;
+  stepCount_ = stepCount;
+  budget_ = budget;
+  if (budget_.maxItemsPerTick == 0) budget_.maxItemsPerTick = 1;
+  step_ = 0;
+  item_ = 0;
+  itemCount_ = 0;
+  stepEntered_ = false;
+  active_ = true;
+  finished_ = false;
+  failed_ = false;
+  ticks_ = 0;
+  itemsRun_ = 0;
+  longestTickMs_ = 0;
+  elapsedMs_ = 0;
+}
+
+void MqttSetupSequence::abort() {
+  active_ = false;
+  finished_ = false;
+}
+
+const char* MqttSetupSequence::stepName() const {
+  if (!steps_ || step_ >= stepCount_) return "";
+  return steps_[step_].name;
+}
+
+// Move to the next step that has work, evaluating count() on entry.
+// Returns false once every step is done.
+bool MqttSetupSequence::enterStep() {
+  while (step_ < stepCount_) {
+    if (!stepEntered_) {
+      itemCount_ = steps_[step_].count ? steps_[step_].count() : 1;
+      item_ = 0;
+      stepEntered_ = true;
+    }
+    if (item_ < itemCount_) return true;
+    step_++;
+    stepEntered_ = false;
+  }
+  return false;
+}
+
+bool MqttSetupSequence::tick() {
+  if (!active_) return false;
+  unsigned long start = millis();
+  uint8_t ran = 0;
+  ticks_++;
+
+  while (enterStep()) {
+    const MqttSetupStep& s = steps_[step_];
+    // A blocking item gets a tick to itself; anything else stops at the budget
+    if (ran > 0 && (s.exclusive || ran >= budget_.maxItemsPerTick ||
+                    (millis() - start) >= budget_.tickBudgetMs)) {
+      break;
+    }
+    bool ok = s.run(item_);
+    ran++;
+    itemsRun_++;
+    if (!ok) {
+      failed_ = true;
+      active_ = false;
+      break;
+    }
+    item_++;
+    if (s.exclusive) break;
+  }
+
+  unsigned long took = millis() - start;
+  if (took > longestTickMs_) longestTickMs_ = took;
+  elapsedMs_ += took;
+
+  if (!failed_ && !enterStep()) {
+    active_ = false;
+    finished_ = true;
+  }
+  return active_;
+}
+
+uint32_t MqttDiscoveryCache::hashBytes(uint32_t seed, const char* data, size_t length) {
+  uint32_t h = seed;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= static_cast<uint8_t>(data[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+uint32_t MqttDiscoveryCache::hashString(uint32_t seed, const char* str) {
+  // Include the terminator so ("ab","c") and ("a","bc") hash differently
+  return str ? hashBytes(seed, str, strlen(str) + 1) : seed;
+}
+
+bool MqttDiscoveryCache::matches(uint32_t hash) {
+  Preferences p;
+  if (!p.begin(DISCOVERY_PREFS_NS, true)) return false;
+  bool have = p.isKey(DISCOVERY_HASH_KEY);
+  uint32_t stored = have ? p.getUInt(DISCOVERY_HASH_KEY, 0) : 0;
+  p.end();
+  return have && stored == hash;
+}
+
+void MqttDiscoveryCache::store(uint32_t hash) {
+  Preferences p;
+  if (!p.begin(DISCOVERY_PREFS_NS, false)) return;
+  p.putUInt(DISCOVERY_HASH_KEY, hash);
+  p.end();
+}
+
+void MqttDiscoveryCache::forget() {
+  Preferences p;
+  if (!p.begin(DISCOVERY_PREFS_NS, false)) return;
+  p.remove(DISCOVERY_HASH_KEY);
+  p.end();
+}
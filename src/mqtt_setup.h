@@ -0,0 +1,103 @@
+#ifndef MQTT_SETUP_H
+#define MQTT_SETUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief One phase of bringing an MQTT session online
+ *
+ * A phase is a list of work items (one subscribe, one discovery document, one
+ * state group...). count() is evaluated when the phase starts, so a phase can
+ * turn out empty, e.g. discovery when the broker already has it. run(i) does
+ * item i and returns false to abort the whole sequence.
+ *
+ * exclusive marks items that may block on the network (the CONNECT itself):
+ * such an item always runs on a tick of its own.
+ */
+struct MqttSetupStep {
+  const char* name;
+  size_t (*count)();
+  bool (*run)(size_t index);
+  bool exclusive;
+};
+
+/** Limits for one MqttSetupSequence::tick(). */
+struct MqttSetupBudget {
+  unsigned long tickBudgetMs;  // stop starting new items once a tick used this much
+  uint8_t maxItemsPerTick;     // and never run more items than this per tick
+};
+
+/**
+ * @brief Resumable driver for a list of MqttSetupSteps
+ *
+ * mqtt_connect() used to do TCP connect, CONNACK, availability, birth, ~25
+ * discovery documents, 15 subscriptions and a full state round in one call
+ * from the loop. The sequence runs the same work a few items per tick: at
+ * least one item always runs (so it cannot stall), then items keep running
+ * until either limit of the budget is hit.
+ */
+class MqttSetupSequence {
+public:
+  void begin(const MqttSetupStep* steps, size_t stepCount, const MqttSetupBudget& budget);
+
+  /** Run up to one tick's worth of work. Returns true while more is left. */
+  bool tick();
+
+  /** Drop the sequence (connection lost mid-setup). */
+  void abort();
+
+  bool active() const { return active_; }
+  bool finished() const { return finished_; }
+  bool failed() const { return failed_; }
+
+  /** Name of the current (or failing) step; "" when idle. */
+  const char* stepName() const;
+
+  // Diagnostics for the last / current run
+  uint16_t ticks() const { return ticks_; }
+  uint32_t itemsRun() const { return itemsRun_; }
+  unsigned long longestTickMs() const { return longestTickMs_; }
+  unsigned long elapsedMs() const { return elapsedMs_; }
+
+private:
+  bool enterStep();
+
+  const MqttSetupStep* steps_ = nullptr;
+  size_t stepCount_ = 0;
+  MqttSetupBudget budget_ = {20, 4};
+  size_t step_ = 0;
+  size_t item_ = 0;
+  size_t itemCount_ = 0;
+  bool stepEntered_ = false;
+  bool active_ = false;
+  bool finished_ = false;
+  bool failed_ = false;
+
+  uint16_t ticks_ = 0;
+  uint32_t itemsRun_ = 0;
+  unsigned long longestTickMs_ = 0;
+  unsigned long elapsedMs_ = 0;
+};
+
+/**
+ * @brief Remembers which discovery set a broker already has
+ *
+ * Discovery configs are retained, so republishing an identical set on every
+ * reconnect is pure traffic. The caller hashes the set together with the
+ * broker address; when it matches what was stored after the last complete
+ * publish, discovery is skipped. forget() forces the next connect to publish
+ * (Home Assistant restarted, settings changed).
+ */
+class MqttDiscoveryCache {
+public:
+  static uint32_t hashBytes(uint32_t seed, const char* data, size_t length);
+  static uint32_t hashString(uint32_t seed, const char* str);
+  static const uint32_t kSeed = 2166136261u;
+
+  bool matches(uint32_t hash);
+  void store(uint32_t hash);
+  void forget();
+};
+
+#endif // MQTT_SETUP_H
@@ -0,0 +1,147 @@
+#include "mqtt_topics.h"
+
+#include <string.h>
+
+// Same order as MqttTopic. The static_assert below catches a missing entry;
+// a swapped pair is caught by test_mqtt_topics.
+static const char* const kMqttTopicSuffixes[] = {
+  "availability",
+  "birth",
+  "light/state",
+  "light/set",
+  "clock/state",
+  "clock/set",
+  "animate/state",
+  "animate/set",
+  "hetis/state",
+  "hetis/set",
+  "nightmode/enabled/state",
+  "nightmode/enabled/set",
+  "nightmode/override/state",
+  "nightmode/override/set",
+  "nightmode/active",
+  "nightmode/effect/state",
+  "nightmode/effect/set",
+  "nightmode/dim/state",
+  "nightmode/dim/set",
+  "nightmode/start/state",
+  "nightmode/start/set",
+  "nightmode/end/state",
+  "nightmode/end/set",
+  "loglevel/state",
+  "loglevel/set",
+  "restart/press",
+  "sequence/press",
+  "version",
+  "uiversion",
+  "ip",
+  "rssi",
+  "laststartup",
+  "heap",
+  "wifi_channel",
+  "boot_reason",
+  "reset_count",
+  "autoupdate/state",
+  "autoupdate/set",
+  "update/press",
+  "update/channel",
+  "update/auto_allowed",
+  "update/available",
+  "update/running",
+  "diag/mqtt_saved_per_hour",
+  "diag/loop_p99_us",
+  "diag/loop_max_us",
+};
+
+static_assert(sizeof(kMqttTopicSuffixes) / sizeof(kMqttTopicSuffixes[0]) == kMqttTopicCount,
+              "kMqttTopicSuffixes must have one entry per MqttTopic");
+
+const char* mqttTopicSuffix(MqttTopic topic) {
+  size_t idx = static_cast<size_t>(topic);
+  return idx < kMqttTopicCount ? kMqttTopicSuffixes[idx] : "";
+}
+
+bool MqttTopicTable::build(const char* base) {
+  built_ = false;
+  baseLen_ = 0;
+  used_ = 0;
+  arena_[0] = '\0';
+  if (!base) return false;
+
+  size_t baseLen = strlen(base);
+  size_t pos = 0;
+  if (baseLen + 1 > sizeof(arena_)) return false;
+  memcpy(arena_, base, baseLen + 1);
+  pos = baseLen + 1;
+
+  for (size_t i = 0; i < kMqttTopicCount; ++i) {
+    size_t suffixLen = strlen(kMqttTopicSuffixes[i]);
+    size_t need = baseLen + 1 + suffixLen + 1;
+    if (pos + need > sizeof(arena_)) {
+      arena_[0] = '\0';
+      return false;
+    }
+    offsets_[i] = static_cast<uint16_t>(pos);
+    memcpy(arena_ + pos, base, baseLen);
+    arena_[pos + baseLen] = '/';
+    memcpy(arena_ + pos + baseLen + 1, kMqttTopicSuffixes[i], suffixLen + 1);
+    pos += need;
+  }
+
+  baseLen_ = static_cast<uint16_t>(baseLen);
+  used_ = static_cast<uint16_t>(pos);
+  built_ = true;
+  sortedBySuffix();
+  return true;
+}
+
+const char* MqttTopicTable::get(MqttTopic topic) const {
+  size_t idx = static_cast<size_t>(topic);
+  if (!built_ || idx >= kMqttTopicCount) return "";
+  return arena_ + offsets_[idx];
+}
+
+const char* MqttTopicTable::suffixOf(const char* topic) const {
+  if (!built_ || !topic) return nullptr;
+  if (strncmp(topic, arena_, baseLen_) != 0) return nullptr;
+  if (topic[baseLen_] != '/') return nullptr;
+  return topic + baseLen_ + 1;
+}
+
+const uint8_t* MqttTopicTable::sortedBySuffix() {
+  static uint8_t order[kMqttTopicCount];
+  static bool ready = false;
+  if (!ready) {
+    // Insertion sort: ~45 constant entries, runs once
+    for (size_t i = 0; i < kMqttTopicCount; ++i) {
+      uint8_t id = static_cast<uint8_t>(i);
+      size_t j = i;
+      while (j > 0 && strcmp(kMqttTopicSuffixes[order[j - 1]], kMqttTopicSuffixes[id]) > 0) {
+        order[j] = order[j - 1];
+        --j;
+      }
+      order[j] = id;
+    }
+    ready = true;
+  }
+  return order;
+}
+
+bool MqttTopicTable::match(const char* topic, MqttTopic& out) const {
+  const char* suffix = suffixOf(topic);
+  if (!suffix) return false;
+  const uint8_t* order = sortedBySuffix();
+  size_t lo = 0;
+  size_t hi = kMqttTopicCount;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int cmp = strcmp(suffix, kMqttTopicSuffixes[order[mid]]);
+    if (cmp == 0) {
+      out = static_cast<MqttTopic>(order[mid]);
+      return true;
+    }
+    if (cmp < 0) hi = mid;
+    else lo = mid + 1;
+  }
+  return false;
+}
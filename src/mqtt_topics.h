@@ -0,0 +1,129 @@
+#ifndef MQTT_TOPICS_H
+#define MQTT_TOPICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes reserved for the rendered topic strings: the base once, then every
+// "<base>/<suffix>" with its terminator. The suffixes add up to ~700 bytes, so
+// the default leaves room for a base topic of roughly 45 characters. A longer
+// base fails MqttTopicTable::build() instead of truncating a topic.
+#ifndef MQTT_TOPIC_ARENA_SIZE
+#define MQTT_TOPIC_ARENA_SIZE 3072
+#endif
+
+/**
+ * @brief Every topic this device publishes or subscribes to, below its base
+ *
+ * The suffix for each entry lives in kMqttTopicSuffixes (mqtt_topics.cpp), in
+ * the same order. Topics that only exist on some builds (OTA, 'HET IS') are
+ * always in the table; the caller decides whether to publish or subscribe.
+ */
+enum class MqttTopic : uint8_t {
+  Availability,
+  Birth,
+  LightState,
+  LightSet,
+  ClockState,
+  ClockSet,
+  AnimState,
+  AnimSet,
+  HetIsState,
+  HetIsSet,
+  NightEnabledState,
+  NightEnabledSet,
+  NightOverrideState,
+  NightOverrideSet,
+  NightActive,
+  NightEffectState,
+  NightEffectSet,
+  NightDimState,
+  NightDimSet,
+  NightStartState,
+  NightStartSet,
+  NightEndState,
+  NightEndSet,
+  LogLevelState,
+  LogLevelSet,
+  RestartPress,
+  SequencePress,
+  Version,
+  UiVersion,
+  Ip,
+  Rssi,
+  LastStartup,
+  Heap,
+  WifiChannel,
+  BootReason,
+  ResetCount,
+  AutoUpdateState,
+  AutoUpdateSet,
+  UpdatePress,
+  UpdateChannel,
+  UpdateAutoAllowed,
+  UpdateAvailable,
+  UpdateRunning,
+  MqttSavedPerHour,
+  LoopP99,
+  LoopMax,
+  Count
+};
+
+constexpr size_t kMqttTopicCount = static_cast<size_t>(MqttTopic::Count);
+
+/** Suffix below the base topic, e.g. "light/state". Empty for Count. */
+const char* mqttTopicSuffix(MqttTopic topic);
+
+/**
+ * @brief All topics of one base, rendered once into a fixed arena
+ *
+ * Replaces the ~45 heap Strings that buildTopics() used to concatenate. The
+ * table is rebuilt on connect and on a settings change; everything else only
+ * reads it, so publishing and inbound matching never allocate.
+ */
+class MqttTopicTable {
+public:
+  /**
+   * @brief Render "<base>/<suffix>" for every topic
+   * @return false (and an empty table) if the base does not fit the arena
+   */
+  bool build(const char* base);
+
+  bool isBuilt() const { return built_; }
+
+  /** Full topic string; "" before a successful build(). */
+  const char* get(MqttTopic topic) const;
+
+  const char* base() const { return built_ ? arena_ : ""; }
+  size_t baseLength() const { return baseLen_; }
+
+  /** Bytes of the arena in use, for sizing MQTT_TOPIC_ARENA_SIZE. */
+  size_t used() const { return used_; }
+
+  /**
+   * @brief The part of an inbound topic after "<base>/"
+   * @return nullptr when the topic does not belong to this base
+   */
+  const char* suffixOf(const char* topic) const;
+
+  /**
+   * @brief Resolve an inbound topic to its table entry without copying it
+   *
+   * After the base prefix check the suffix is binary-searched in a
+   * suffix-sorted index, so the cost grows with log2 of the topic count.
+   * @return false for foreign or unknown topics
+   */
+  bool match(const char* topic, MqttTopic& out) const;
+
+private:
+  // Topic ids ordered by suffix; the suffixes are constant, so built once
+  static const uint8_t* sortedBySuffix();
+
+  char arena_[MQTT_TOPIC_ARENA_SIZE] = {};
+  uint16_t offsets_[kMqttTopicCount] = {};
+  uint16_t baseLen_ = 0;
+  uint16_t used_ = 0;
+  bool built_ = false;
+};
+
+#endif // MQTT_TOPICS_H
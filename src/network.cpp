@@ -48,13 +48,26 @@ void stopWiFiForBleProvisioning() {
 
 } // namespace
 
-static bool connectWithStoredCredentials() {
-  WiFi.begin();
-  for (int attempt = 0; attempt < WIFI_CONNECT_MAX_RETRIES; ++attempt) {
-    if (WiFi.status() == WL_CONNECTED) return true;
-    delay(WIFI_CONNECT_RETRY_DELAY_MS);
-  }
-  return WiFi.status() == WL_CONNECTED;
+// Boot-time connect: started by startNetwork(), finished by pollNetworkStart()
+// once the stored network answers or networkStartWindowMs() has passed.
+// processNetwork() stays out of the way meanwhile.
+static bool g_networkStarting = false;
+static unsigned long g_networkStartMs = 0;
+
+// Same windows as the blocking connects this replaced: BLE builds and builds
+// without WiFiManager polled WIFI_CONNECT_MAX_RETRIES x
+// WIFI_CONNECT_RETRY_DELAY_MS; the portal-only build waited in autoConnect().
+static unsigned long networkStartWindowMs() {
+#if WIFI_MANAGER_ENABLED && !BLE_PROVISIONING_ENABLED
+  return WIFI_MANAGER_CONNECT_WAIT_MS;
+#else
+  return (unsigned long)WIFI_CONNECT_MAX_RETRIES * WIFI_CONNECT_RETRY_DELAY_MS;
+#endif
+}
+
+static void logConnected(const char* what) {
+  logInfo(String("✅ WiFi connected to ") + what + ": " + String(WiFi.SSID()));
+  logInfo("📡 IP address: " + WiFi.localIP().toString());
 }
 
 static void startWiFiManagerPortal() {
@@ -69,7 +82,20 @@ static void startWiFiManagerPortal() {
 #endif
 }
 
-void initNetwork() {
+// The stored network did not answer in time
+static void networkStartFailed() {
+  g_wifiConnected = false;
+#if BLE_PROVISIONING_ENABLED
+  stopWiFiForBleProvisioning();
+  startBleProvisioning(BleProvisioningReason::WiFiUnavailableAtBoot);
+#elif WIFI_MANAGER_ENABLED
+  startWiFiManagerPortal();
+#else
+  logWarn("⚠️ WiFi not connected. WiFiManager portal disabled.");
+#endif
+}
+
+void startNetwork() {
   WiFi.mode(WIFI_STA);
   WiFi.setAutoReconnect(true);
 #if WIFI_MANAGER_ENABLED
@@ -94,67 +120,54 @@ void initNetwork() {
   logInfo(String("WiFiManager disabled (credentials present: ") + (g_wifiHadCredentialsAtBoot ? "yes" : "no") + ")");
 #endif
 
-#if BLE_PROVISIONING_ENABLED
-#if WIFI_MANAGER_ENABLED
   if (!g_wifiHadCredentialsAtBoot) {
+    // Nothing to wait for: provisioning starts right away
+    g_wifiConnected = false;
+#if BLE_PROVISIONING_ENABLED && WIFI_MANAGER_ENABLED
     stopWiFiForBleProvisioning();
     startBleProvisioning(BleProvisioningReason::FirstBootNoCreds);
-    g_wifiConnected = false;
-    return;
-  }
-  if (connectWithStoredCredentials()) {
-    g_wifiConnected = true;
-    logInfo("✅ WiFi connected to stored network: " + String(WiFi.SSID()));
-    logInfo("📡 IP address: " + WiFi.localIP().toString());
-    return;
-  }
-
-  stopWiFiForBleProvisioning();
-  startBleProvisioning(BleProvisioningReason::WiFiUnavailableAtBoot);
-  g_wifiConnected = false;
-  return;
-#else
-  if (connectWithStoredCredentials()) {
-    g_wifiConnected = true;
-    logInfo("✅ WiFi connected to stored network: " + String(WiFi.SSID()));
-    logInfo("📡 IP address: " + WiFi.localIP().toString());
     return;
-  }
-  stopWiFiForBleProvisioning();
-  startBleProvisioning(BleProvisioningReason::WiFiUnavailableAtBoot);
-  g_wifiConnected = false;
-  return;
-#endif
-#endif
-
-#if WIFI_MANAGER_ENABLED
-  bool autoResult = wm.autoConnect(AP_NAME, AP_PASSWORD);
-  (void)autoResult;
-  g_wifiConnected = (WiFi.status() == WL_CONNECTED);
-  if (g_wifiConnected) {
-    logInfo("✅ WiFi connected to network: " + String(WiFi.SSID()));
-    logInfo("📡 IP address: " + WiFi.localIP().toString());
-  } else {
-    if (!wm.getConfigPortalActive()) {
+#elif WIFI_MANAGER_ENABLED
+    // No saved network: autoConnect() opens the non-blocking portal at once
+    wm.autoConnect(AP_NAME, AP_PASSWORD);
+    g_wifiConnected = (WiFi.status() == WL_CONNECTED);
+    if (g_wifiConnected) {
+      logConnected("network");
+    } else if (!wm.getConfigPortalActive()) {
       startWiFiManagerPortal();
     } else {
       ledEventStart(LedEvent::WifiManagerPortal);
       g_wifiManagerStarted = true;
       logWarn(String("📶 WiFi config portal active. Connect to '") + AP_NAME + "' to configure WiFi.");
     }
+    return;
+#endif
   }
-#else
-  g_wifiConnected = connectWithStoredCredentials();
-  if (g_wifiConnected) {
-    logInfo("✅ WiFi connected to network: " + String(WiFi.SSID()));
-    logInfo("📡 IP address: " + WiFi.localIP().toString());
-  } else {
-    logWarn("⚠️ WiFi not connected. WiFiManager portal disabled.");
+
+  // Stored credentials: the driver connects in the background
+  WiFi.begin();
+  g_networkStarting = true;
+  g_networkStartMs = millis();
+}
+
+bool pollNetworkStart(unsigned long nowMs) {
+  if (!g_networkStarting) return true;
+  if (WiFi.status() == WL_CONNECTED) {
+    g_networkStarting = false;
+    g_wifiConnected = true;
+    logConnected("stored network");
+    return true;
   }
-#endif
+  if (nowMs - g_networkStartMs < networkStartWindowMs()) {
+    return false;
+  }
+  g_networkStarting = false;
+  networkStartFailed();
+  return true;
 }
 
 void processNetwork() {
+  if (g_networkStarting) return;  // pollNetworkStart() owns the connection until then
 #if WIFI_MANAGER_ENABLED
   // Only service the portal web server — do NOT call process() when idle, as
   // WiFiManager's internal state machine would otherwise auto-start the portal
@@ -272,7 +285,7 @@ bool isWiFiConnected() {
 
 bool isInitialSetupMode() {
   // Initial setup = no saved credentials AND not currently connected. The
-  // portal is up (initNetwork starts it on autoConnect failure) and the
+  // portal is up (startNetwork opens it when there are no credentials) and the
   // operator is in front of the device picking an SSID. There is nothing
   // useful to render on the clock face (no NTP yet) and no point in
   // periodic STA reconnect scans (no credentials to retry).
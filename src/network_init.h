@@ -4,7 +4,12 @@
 
 extern bool g_wifiHadCredentialsAtBoot;
 
-void initNetwork();
+// Starts WiFi without waiting for it. With stored credentials the driver
+// connects in the background and pollNetworkStart() reports when it did, or
+// gave up and opened the fallback (portal or BLE provisioning); without them
+// provisioning starts right away.
+void startNetwork();
+bool pollNetworkStart(unsigned long nowMs);
 void processNetwork();
 bool isWiFiConnected();
 void resetWiFiSettings();
@@ -1,31 +1,34 @@
 #include "night_mode.h"
 #include "log.h"
-#include "mqtt_client.h"
+#include "settings_store.h"
+#include "state_events.h"
 
 NightMode nightMode;
 
 void NightMode::begin() {
-  prefs_.begin(PREF_NAMESPACE, false);
-  enabled_ = prefs_.getBool("enabled", false);
-  uint8_t storedEffect = prefs_.getUChar("effect", static_cast<uint8_t>(NightModeEffect::Dim));
+  enabledKey_ = settingsStore.addBool(PREF_NAMESPACE, "enabled", false);
+  effectKey_ = settingsStore.addU8(PREF_NAMESPACE, "effect", static_cast<uint8_t>(NightModeEffect::Dim));
+  dimKey_ = settingsStore.addU8(PREF_NAMESPACE, "dim_pct", 20);
+  startKey_ = settingsStore.addU16(PREF_NAMESPACE, "start", 22 * 60);
+  endKey_ = settingsStore.addU16(PREF_NAMESPACE, "end", 6 * 60);
+
+  enabled_ = settingsStore.getBool(enabledKey_);
+  uint8_t storedEffect = settingsStore.getU8(effectKey_);
   if (storedEffect > static_cast<uint8_t>(NightModeEffect::Dim)) {
     storedEffect = static_cast<uint8_t>(NightModeEffect::Dim);
   }
   effect_ = static_cast<NightModeEffect>(storedEffect);
-  dimPercent_ = prefs_.getUChar("dim_pct", 20);
+  dimPercent_ = settingsStore.getU8(dimKey_);
   if (dimPercent_ > 100) dimPercent_ = 100;
-  startMinutes_ = prefs_.getUShort("start", 22 * 60);
+  startMinutes_ = settingsStore.getU16(startKey_);
   if (startMinutes_ >= 24 * 60) startMinutes_ = 22 * 60;
-  endMinutes_ = prefs_.getUShort("end", 6 * 60);
+  endMinutes_ = settingsStore.getU16(endKey_);
   if (endMinutes_ >= 24 * 60) endMinutes_ = 6 * 60;
-  prefs_.end();
 
   overrideMode_ = NightModeOverride::Auto;
   active_ = false;
   scheduleActive_ = false;
   hasValidTime_ = false;
-  dirty_ = false;
-  lastFlush_ = millis();
 }
 
 void NightMode::updateFromTime(const struct tm& timeinfo) {
@@ -122,16 +125,33 @@ String NightMode::formatMinutes(uint16_t minutes) const {
 }
 
 bool NightMode::parseTimeString(const String& text, uint16_t& minutesOut) {
-  String trimmed = text;
-  trimmed.trim();
-  if (trimmed.length() < 4) return false;
-  int colon = trimmed.indexOf(':');
-  if (colon <= 0) return false;
-  String hStr = trimmed.substring(0, colon);
-  String mStr = trimmed.substring(colon + 1);
-  if (hStr.length() == 0 || mStr.length() == 0) return false;
-  int hour = hStr.toInt();
-  int minute = mStr.toInt();
+  return parseTimeString(text.c_str(), text.length(), minutesOut);
+}
+
+// Leading integer of text[0..length), like String::toInt()
+static int parseTimeField(const char* text, size_t length) {
+  char buf[12];
+  size_t n = length < sizeof(buf) - 1 ? length : sizeof(buf) - 1;
+  memcpy(buf, text, n);
+  buf[n] = '\0';
+  return atoi(buf);
+}
+
+bool NightMode::parseTimeString(const char* text, size_t length, uint16_t& minutesOut) {
+  if (!text) return false;
+  while (length > 0 && isspace((unsigned char)text[0])) {
+    text++;
+    length--;
+  }
+  while (length > 0 && isspace((unsigned char)text[length - 1])) length--;
+  if (length < 4) return false;
+  const char* colon = static_cast<const char*>(memchr(text, ':', length));
+  if (!colon || colon == text) return false;
+  size_t hLen = static_cast<size_t>(colon - text);
+  size_t mLen = length - hLen - 1;
+  if (mLen == 0) return false;
+  int hour = parseTimeField(text, hLen);
+  int minute = parseTimeField(colon + 1, mLen);
   if (hour < 0 || hour > 23 || minute < 0 || minute > 59) return false;
   minutesOut = static_cast<uint16_t>(hour * 60 + minute);
   return true;
@@ -150,31 +170,29 @@ bool NightMode::computeScheduleActive(uint16_t minutes) const {
 }
 
 void NightMode::flush() {
-  if (!dirty_) return;
-  
-  prefs_.begin(PREF_NAMESPACE, false);
-  prefs_.putBool("enabled", enabled_);
-  prefs_.putUChar("effect", static_cast<uint8_t>(effect_));
-  prefs_.putUChar("dim_pct", dimPercent_);
-  prefs_.putUShort("start", startMinutes_);
-  prefs_.putUShort("end", endMinutes_);
-  prefs_.end();
-  
-  dirty_ = false;
-  lastFlush_ = millis();
+  settingsStore.commit();
 }
 
 void NightMode::loop() {
-  if (dirty_ && (millis() - lastFlush_) >= AUTO_FLUSH_DELAY_MS) {
-    flush();
-  }
+  settingsStore.loop(millis());
+}
+
+bool NightMode::isDirty() const {
+  return settingsStore.pending(PREF_NAMESPACE);
+}
+
+unsigned long NightMode::millisSinceLastFlush() const {
+  return millis() - settingsStore.pendingSinceMs();
 }
 
 void NightMode::markDirty() {
-  if (!dirty_) {
-    dirty_ = true;
-    lastFlush_ = millis();
-  }
+  // Only the values that differ from the store's shadow become pending
+  settingsStore.setBool(enabledKey_, enabled_);
+  settingsStore.setU8(effectKey_, static_cast<uint8_t>(effect_));
+  settingsStore.setU8(dimKey_, dimPercent_);
+  settingsStore.setU16(startKey_, startMinutes_);
+  settingsStore.setU16(endKey_, endMinutes_);
+  notifyStateChanged(StateChange::NightMode);
 }
 
 void NightMode::updateEffectiveState(const char* reason) {
@@ -201,5 +219,5 @@ void NightMode::updateEffectiveState(const char* reason) {
 }
 
 void NightMode::publishState() {
-  mqtt_publish_state(true);
+  notifyStateChanged(StateChange::NightMode);
 }
@@ -2,9 +2,10 @@
 #define NIGHT_MODE_H
 
 #include <Arduino.h>
-#include <Preferences.h>
 #include <time.h>
 
+#include "settings_store.h"
+
 enum class NightModeEffect : uint8_t {
   Off = 0,
   Dim = 1
@@ -47,24 +48,24 @@ public:
 
   String formatMinutes(uint16_t minutes) const;
   static bool parseTimeString(const String& text, uint16_t& minutesOut);
+  /** Same as above for a buffer that need not be NUL-terminated (MQTT payloads). */
+  static bool parseTimeString(const char* text, size_t length, uint16_t& minutesOut);
 
   /**
    * @brief Force immediate write to persistent storage
-   * @note Call before critical operations (OTA, deep sleep, restart)
+   * @note Commits every pending setting, not only these (settings_store.h)
    */
   void flush();
 
   /**
-   * @brief Automatic flush if dirty and sufficient time passed
-   * @note Call periodically from main loop (every 1-5 seconds)
+   * @brief Automatic flush once the oldest unsaved change is old enough
+   * @note Same as settingsStore.loop(); the runtime calls that directly
    */
   void loop();
 
   // Query persistence state
-  bool isDirty() const { return dirty_; }
-  unsigned long millisSinceLastFlush() const { 
-    return millis() - lastFlush_; 
-  }
+  bool isDirty() const;
+  unsigned long millisSinceLastFlush() const;
 
 private:
   static constexpr const char* PREF_NAMESPACE = "wc_night";  // Renamed namespace
@@ -74,7 +75,6 @@ private:
   void updateEffectiveState(const char* reason);
   void publishState();
 
-  Preferences prefs_;
   bool enabled_ = false;
   NightModeEffect effect_ = NightModeEffect::Dim;
   uint8_t dimPercent_ = 20;
@@ -84,10 +84,12 @@ private:
   bool active_ = false;
   bool scheduleActive_ = false;
   bool hasValidTime_ = false;
-  bool dirty_ = false;
-  unsigned long lastFlush_ = 0;
-  
-  static const unsigned long AUTO_FLUSH_DELAY_MS = 5000;  // 5 seconds
+
+  SettingKey enabledKey_ = SETTING_NONE;
+  SettingKey effectKey_ = SETTING_NONE;
+  SettingKey dimKey_ = SETTING_NONE;
+  SettingKey startKey_ = SETTING_NONE;
+  SettingKey endKey_ = SETTING_NONE;
 };
 
 extern NightMode nightMode;
@@ -1,6 +1,7 @@
 #include "config.h"
 #include "ota_updater.h"
 
+#include "heap_tracker.h"
 #include "led_events.h"
 #include "fs_compat.h"
 
@@ -52,6 +53,19 @@ void syncUiFilesFromConfiguredVersion() {}
 #include "display_settings.h"
 #include "grid_layout.h"
 #include "system_utils.h"
+#include "json_arena.h"
+#include "mem_pool.h"
+
+// Manifests are parsed into an arena of their own per check: the shared one
+// belongs to loop() and the route handlers, and a check runs on its own task
+// for as long as a download takes.
+#ifndef OTA_JSON_ARENA_BYTES
+#define OTA_JSON_ARENA_BYTES 16384
+#endif
+// Copy buffer for UI file downloads; from the Bulk pool, not the task stack
+#ifndef OTA_DOWNLOAD_CHUNK_BYTES
+#define OTA_DOWNLOAD_CHUNK_BYTES 4096
+#endif
 
 static const char* FS_IMAGE_VERSION_FILE = "/.fs_image_version";
 
@@ -104,24 +118,26 @@ static bool downloadToFs(const String& url, const String& path, WiFiClientSecure
   const int expectedLen = len;
   if (len == 0) { http.end(); return false; }
 
+  PoolBuffer buf(MemPool::Bulk, OTA_DOWNLOAD_CHUNK_BYTES);
+  if (!buf.data()) { http.end(); return false; }
+
   String tmp = path + ".tmp";
   ensureDirs(path);
   File f = FS_IMPL.open(tmp, "w");
   if (!f) { http.end(); return false; }
 
   WiFiClient& s = http.getStream();
-  uint8_t buf[2048];
   int written = 0;
   bool readTimedOut = false;
   while (http.connected() && (len > 0 || len == -1)) {
-    size_t n = s.readBytes(buf, sizeof(buf));
+    size_t n = s.readBytes(buf.data(), buf.size());
     if (n == 0) {
       if (http.connected()) {
         readTimedOut = true;
       }
       break;
     }
-    f.write(buf, n);
+    f.write(buf.data(), n);
     written += n;
     if (len > 0) len -= n;
   }
@@ -148,6 +164,10 @@ static bool downloadToFs(const String& url, const String& path, WiFiClientSecure
     FS_IMPL.remove(tmp);
     return false;
   }
+  // Precompressed copies from the fs image would otherwise be served in
+  // preference to the file just downloaded
+  FS_IMPL.remove(path + ".gz");
+  FS_IMPL.remove(path + ".br");
   logDebug("Wrote " + path + " (" + String(written) + " bytes)");
   return true;
 }
@@ -524,12 +544,15 @@ static bool isHtmlFileHealthy(const char* path) {
 static bool areUiFilesHealthy() {
   for (const char* name : UI_FILES) {
     String path = "/" + String(name);
+    // fs images ship pages gzip-only; those cannot be sniffed for markup
+    if (!FS_IMPL.exists(path) && FS_IMPL.exists(path + ".gz")) continue;
     if (!isHtmlFileHealthy(path.c_str())) return false;
   }
   return true;
 }
 
 void syncUiFilesFromConfiguredVersion() {
+  HeapTagScope heapTag(HeapTag::Ota);
 #if SUPPORT_OTA_V2
   logInfo("UI sync is legacy-only; skipping (OTA2 enabled).");
   return;
@@ -575,6 +598,7 @@ void syncUiFilesFromConfiguredVersion() {
 }
 
 void syncFilesFromManifest() {
+  HeapTagScope heapTag(HeapTag::Ota);
 #if SUPPORT_OTA_V2
   logInfo("UI sync is legacy-only; skipping (OTA2 enabled).");
   return;
@@ -590,7 +614,8 @@ void syncFilesFromManifest() {
 
   String requestedChannel = normalizeChannel(displaySettings.getUpdateChannel());
 
-  JsonDocument doc;
+  JSON_SCOPE(json, "ota ui sync", OTA_JSON_ARENA_BYTES);
+  JsonDocument doc(json.allocator());
   if (!fetchManifest(doc, *client, requestedChannel)) return;
   String selectedChannel;
   JsonVariant channelBlock = selectChannelBlock(doc, requestedChannel, selectedChannel);
@@ -651,7 +676,8 @@ static void checkForFirmwareUpdateLegacy() {
 
   String requestedChannel = normalizeChannel(displaySettings.getUpdateChannel());
 
-  JsonDocument doc;
+  JSON_SCOPE(json, "ota firmware check (legacy)", OTA_JSON_ARENA_BYTES);
+  JsonDocument doc(json.allocator());
   if (!fetchManifest(doc, *client, requestedChannel)) return;
   String selectedChannel;
   JsonVariant channelBlock = selectChannelBlock(doc, requestedChannel, selectedChannel);
@@ -783,7 +809,8 @@ static void checkForFirmwareUpdateV2() {
   const GridVariantInfo* info = getGridVariantInfo(getActiveGridVariant());
   logDebug(String("OTA grid: ") + (info ? info->key : "unknown"));
 
-  JsonDocument channelDoc;
+  JSON_SCOPE(json, "ota firmware check", OTA_JSON_ARENA_BYTES);
+  JsonDocument channelDoc(json.allocator());
   if (!fetchOta2Channel(channelDoc, *client, PRODUCT_ID, requestedChannel)) return;
 
   JsonVariant target = channelDoc["target"];
@@ -806,7 +833,7 @@ static void checkForFirmwareUpdateV2() {
 
   bool fsUpdated = false;
   if (!fsManifestUrl.isEmpty()) {
-    JsonDocument fsDoc;
+    JsonDocument fsDoc(json.allocator());
     if (fetchOta2Artifact(fsDoc, *client, fsManifestUrl)) {
       const String fsType = fsDoc["fs"] | "";
       const String fsVersion = fsDoc["version"] | "";
@@ -855,7 +882,7 @@ static void checkForFirmwareUpdateV2() {
 
   ledEventStart(LedEvent::FirmwareAvailable);
 
-  JsonDocument artifactDoc;
+  JsonDocument artifactDoc(json.allocator());
   if (!fetchOta2Artifact(artifactDoc, *client, manifestUrl)) {
     ledEventStop(LedEvent::FirmwareAvailable);
     return;
@@ -894,6 +921,7 @@ static void checkForFirmwareUpdateV2() {
 void checkForFirmwareUpdate() {}
 #else
 void checkForFirmwareUpdate() {
+  HeapTagScope heapTag(HeapTag::Ota);
 #if SUPPORT_OTA_V2
   checkForFirmwareUpdateV2();
 #else
@@ -911,6 +939,7 @@ void checkForFirmwareUpdate() {
 
 #if SUPPORT_OTA_V2
 bool installProductFirmware(const String& productId, const String& channel) {
+  HeapTagScope heapTag(HeapTag::Ota);
   logInfo(String("🔧 Bootstrap provisioning ") + productId + " (" + channel + ")");
 
   // Update is a global singleton — registering once here means the same
@@ -925,7 +954,8 @@ bool installProductFirmware(const String& productId, const String& channel) {
 
   std::unique_ptr<WiFiClient> client(new WiFiClient());
 
-  JsonDocument channelDoc;
+  JSON_SCOPE(json, "ota product install", OTA_JSON_ARENA_BYTES);
+  JsonDocument channelDoc(json.allocator());
   if (!fetchOta2Channel(channelDoc, *client, productId, channel)) {
     logError("❌ Bootstrap: failed to fetch channel manifest");
     return false;
@@ -948,7 +978,7 @@ bool installProductFirmware(const String& productId, const String& channel) {
   // firmware would boot without its UI — a worse failure mode than the
   // reverse (bootstrap survives if fs OTA fails before firmware OTA starts).
   if (!fsManifestUrl.isEmpty()) {
-    JsonDocument fsDoc;
+    JsonDocument fsDoc(json.allocator());
     if (!fetchOta2Artifact(fsDoc, *client, fsManifestUrl)) {
       logError("❌ Bootstrap: failed to fetch fs manifest");
       return false;
@@ -988,7 +1018,7 @@ bool installProductFirmware(const String& productId, const String& channel) {
   }
 
   // Firmware
-  JsonDocument artifactDoc;
+  JsonDocument artifactDoc(json.allocator());
   if (!fetchOta2Artifact(artifactDoc, *client, manifestUrl)) {
     logError("❌ Bootstrap: failed to fetch firmware manifest");
     return false;
@@ -1020,11 +1050,13 @@ bool installProductFirmware(const String& productId, const String& channel) {
 }
 
 bool listAvailableChannels(const String& productId, std::vector<ChannelTarget>& out) {
+  HeapTagScope heapTag(HeapTag::Ota);
   out.clear();
   std::unique_ptr<WiFiClient> client(new WiFiClient());
   static const char* kCandidates[] = { "stable", "early", "develop" };
   for (const char* ch : kCandidates) {
-    JsonDocument doc;
+    JSON_SCOPE(json, "ota channel list", OTA_JSON_ARENA_BYTES);
+    JsonDocument doc(json.allocator());
     if (!fetchOta2Channel(doc, *client, productId, String(ch))) continue;
     // Channel exists if the JSON has a non-null "target".
     JsonVariant target = doc["target"];
@@ -1045,13 +1077,15 @@ bool listAvailableChannels(const String& productId, std::vector<ChannelTarget>&
 // flow. On a newer remote version, hands off to installProductFirmware()
 // which reboots and never returns.
 bool checkForBootstrapSelfUpdate(bool& outUpToDate, String& outRemoteVersion) {
+  HeapTagScope heapTag(HeapTag::Ota);
   outUpToDate = false;
   outRemoteVersion = "";
   logInfo("🔍 Bootstrap: checking for self-update…");
 
   std::unique_ptr<WiFiClient> client(new WiFiClient());
 
-  JsonDocument channelDoc;
+  JSON_SCOPE(json, "ota bootstrap self-update", OTA_JSON_ARENA_BYTES);
+  JsonDocument channelDoc(json.allocator());
   if (!fetchOta2Channel(channelDoc, *client, "nextgen-bootstrap", "stable")) {
     logError("❌ Bootstrap self-update: channel manifest fetch failed");
     return false;
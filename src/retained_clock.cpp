@@ -0,0 +1,205 @@
+#include "retained_clock.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <esp_attr.h>
+#include <esp_sntp.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#else
+#include <Arduino.h>
+#endif
+
+namespace {
+
+// Anything earlier is the clock's reset value, not a time of day
+const int64_t kMinValidEpochUs = 1640995200LL * 1000000LL;  // 2022-01-01, as in log.cpp
+// ROM and bootloader run before esp_timer starts counting; a rough figure,
+// small next to the minute the clock face resolves
+const int64_t kResetGapUs = 300000;
+const uint32_t kMagic = 0xC10C0001u;
+
+// No padding before `check`: the checksum covers every byte up to it
+struct RetainedRecord {
+  int64_t epochUs;      // wall clock at uptimeUs
+  int64_t uptimeUs;     // esp_timer of the boot that wrote it
+  uint32_t magic;
+  int32_t driftPpm;
+  uint32_t check;
+};
+
+#ifndef PIO_UNIT_TESTING
+RTC_NOINIT_ATTR RetainedRecord s_record;
+#else
+RetainedRecord s_record;
+int64_t s_testWallUs = 0;
+#endif
+
+TimeConfidence s_confidence = TimeConfidence::None;
+bool s_restored = false;
+// Set from the SNTP task, taken in by retainTime() on the loop task
+volatile bool s_sntpFresh = false;
+// The previous sync of this boot, for the drift estimate
+int64_t s_syncEpochUs = 0;
+int64_t s_syncUptimeUs = 0;
+
+int64_t uptimeUs() {
+#ifndef PIO_UNIT_TESTING
+  return esp_timer_get_time();
+#else
+  return static_cast<int64_t>(millis()) * 1000LL;
+#endif
+}
+
+int64_t wallUs() {
+#ifndef PIO_UNIT_TESTING
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<int64_t>(tv.tv_sec) * 1000000LL + tv.tv_usec;
+#else
+  return s_testWallUs ? s_testWallUs + uptimeUs() : 0;
+#endif
+}
+
+void setWallUs(int64_t us) {
+#ifndef PIO_UNIT_TESTING
+  struct timeval tv;
+  tv.tv_sec = static_cast<time_t>(us / 1000000LL);
+  tv.tv_usec = static_cast<suseconds_t>(us % 1000000LL);
+  settimeofday(&tv, nullptr);
+#else
+  s_testWallUs = us - uptimeUs();
+#endif
+}
+
+uint32_t checksum(const RetainedRecord& r) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&r);
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < offsetof(RetainedRecord, check); ++i) h = (h ^ p[i]) * 16777619u;
+  return h;
+}
+
+bool warmReset() {
+#ifndef PIO_UNIT_TESTING
+  switch (esp_reset_reason()) {
+    case ESP_RST_SW:
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+      return true;
+    default:
+      return false;
+  }
+#else
+  return true;
+#endif
+}
+
+#ifndef PIO_UNIT_TESTING
+void onSntpSync(struct timeval*) { s_sntpFresh = true; }
+#endif
+
+void takeSync(int64_t nowWall, int64_t nowUptime) {
+  if (s_syncUptimeUs != 0) {
+    // How far esp_timer ran ahead of SNTP since the previous sync
+    int64_t wallSpan = nowWall - s_syncEpochUs;
+    int64_t timerSpan = nowUptime - s_syncUptimeUs;
+    if (wallSpan > 60LL * 1000000LL) {
+      s_record.driftPpm = static_cast<int32_t>((timerSpan - wallSpan) * 1000000LL / wallSpan);
+    }
+  }
+  s_syncEpochUs = nowWall;
+  s_syncUptimeUs = nowUptime;
+  s_confidence = TimeConfidence::Synced;
+}
+
+}  // namespace
+
+bool restoreRetainedTime() {
+  const RetainedRecord saved = s_record;
+  bool usable = warmReset() && saved.magic == kMagic && saved.check == checksum(saved) &&
+                saved.epochUs >= kMinValidEpochUs;
+  memset(&s_record, 0, sizeof(s_record));
+  s_record.driftPpm = usable ? saved.driftPpm : 0;
+  s_restored = false;
+  if (!usable) return false;
+
+  if (wallUs() < kMinValidEpochUs) {
+    // The last save was at most about a second before the reset; the reset
+    // and this boot's uptime so far come on top, the latter on an esp_timer
+    // that runs driftPpm fast
+    int64_t elapsed = kResetGapUs + uptimeUs();
+    elapsed -= elapsed * saved.driftPpm / 1000000LL;
+    setWallUs(saved.epochUs + elapsed);
+    s_restored = true;
+  }
+  s_confidence = TimeConfidence::Retained;
+  return s_restored;
+}
+
+void watchTimeSync() {
+#ifndef PIO_UNIT_TESTING
+  sntp_set_time_sync_notification_cb(onSntpSync);
+#endif
+}
+
+void retainTime() {
+  int64_t nowWall = wallUs();
+  if (nowWall < kMinValidEpochUs) return;
+  int64_t nowUptime = uptimeUs();
+  if (s_sntpFresh) {
+    s_sntpFresh = false;
+    takeSync(nowWall, nowUptime);
+  } else if (s_confidence == TimeConfidence::None) {
+    // Set by something other than SNTP or the record; keep it, do not trust it
+    s_confidence = TimeConfidence::Retained;
+  }
+  s_record.magic = kMagic;
+  s_record.epochUs = nowWall;
+  s_record.uptimeUs = nowUptime;
+  s_record.check = checksum(s_record);
+}
+
+TimeConfidence timeConfidence() {
+  if (s_sntpFresh) retainTime();
+  return s_confidence;
+}
+
+const char* timeConfidenceName(TimeConfidence c) {
+  switch (c) {
+    case TimeConfidence::Retained: return "retained";
+    case TimeConfidence::Synced: return "synced";
+    default: return "none";
+  }
+}
+
+int32_t timeDriftPpm() { return s_record.driftPpm; }
+
+bool timeWasRestored() { return s_restored; }
+
+#ifdef PIO_UNIT_TESTING
+void test_retainedClockPowerOn() {
+  memset(&s_record, 0x5A, sizeof(s_record));
+  test_retainedClockReboot();
+}
+
+void test_retainedClockReboot() {
+  s_testWallUs = 0;
+  s_confidence = TimeConfidence::None;
+  s_restored = false;
+  s_sntpFresh = false;
+  s_syncEpochUs = 0;
+  s_syncUptimeUs = 0;
+}
+
+void test_sntpSynced(int64_t epochUs) {
+  setWallUs(epochUs);
+  s_sntpFresh = true;
+}
+
+int64_t test_wallClockUs() { return wallUs(); }
+#endif
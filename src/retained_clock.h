@@ -0,0 +1,56 @@
+#ifndef RETAINED_CLOCK_H
+#define RETAINED_CLOCK_H
+
+#include <stdint.h>
+
+/** How far the system clock can be trusted. */
+enum class TimeConfidence : uint8_t {
+  None,      // no time yet
+  Retained,  // carried over a warm restart, SNTP has not confirmed it yet
+  Synced,    // SNTP delivered it this boot
+};
+
+/**
+ * @brief Wall-clock time kept across software resets
+ *
+ * The last known epoch, the esp_timer reading it belongs to and a drift
+ * estimate live in RTC_NOINIT memory, which software, panic and watchdog
+ * resets leave alone. restoreRetainedTime() seeds the system clock from
+ * them early in boot, so the first frame shows the right words instead of
+ * the no-time indicator; SNTP then confirms or corrects it. Power-on,
+ * brownout and reset-pin boots ignore the record: the device may have been
+ * off for any length of time.
+ *
+ * The error after a restart is the time since the last retainTime() call
+ * (at most about a second) plus an estimate of the reset itself.
+ */
+
+/** Early in boot: seeds the system clock on a warm restart. True when it did. */
+bool restoreRetainedTime();
+/** Start of SNTP: its sync notification promotes the clock to Synced. */
+void watchTimeSync();
+/**
+ * The clock has time: keeps the record current and takes in an SNTP sync.
+ * Cheap; called about once a second and before a planned restart.
+ */
+void retainTime();
+
+TimeConfidence timeConfidence();
+const char* timeConfidenceName(TimeConfidence c);
+/** esp_timer drift against SNTP in ppm, from the last two syncs; 0 until then. */
+int32_t timeDriftPpm();
+/** This boot's clock was seeded from the record. */
+bool timeWasRestored();
+
+#ifdef PIO_UNIT_TESTING
+/** As after power-on: no record, no time. */
+void test_retainedClockPowerOn();
+/** A warm restart: the record stays, the rest is forgotten. */
+void test_retainedClockReboot();
+/** SNTP sets the clock to `epochUs` and notifies. */
+void test_sntpSynced(int64_t epochUs);
+/** The system clock, 0 while it has no time. */
+int64_t test_wallClockUs();
+#endif
+
+#endif // RETAINED_CLOCK_H
@@ -5,25 +5,26 @@
 #include <time.h>
 
 #include <ESPmDNS.h>
-#include <WebServer.h>
 
 #if OTA_ENABLED
 #include <ArduinoOTA.h>
 #endif
 
 #include "ble_provisioning.h"
+#include "boot_profile.h"
 #include "device_identity.h"
 #include "device_registration.h"
 #include "display_settings.h"
+#include "heap_tracker.h"
 #include "heartbeat.h"
 #include "led_events.h"
-#include "led_state.h"
 #include "log.h"
+#include "loop_profile.h"
 #include "mqtt_client.h"
 #include "mqtt_init.h"
 #include "network_init.h"
-#include "night_mode.h"
 #include "ota_updater.h"
+#include "settings_store.h"
 #include "startup_sequence_init.h"
 #include "time_sync.h"
 #include "webserver_init.h"
@@ -31,6 +32,8 @@
 
 namespace {
 
+// runtimeInitOnSetup() ran; until then the boot steps own the services
+bool g_servicesStarted = false;
 bool g_mqttInitialized = false;
 bool g_autoUpdateHandled = false;
 bool g_uiSyncHandled = false;
@@ -114,7 +117,8 @@ void attemptAutoRegistration() {
 
 } // namespace
 
-void runtimeInitOnSetup(bool wifiConnected, WebServer& server) {
+void runtimeInitOnSetup(bool wifiConnected, HttpServer& server) {
+  g_servicesStarted = true;
   if (wifiConnected) {
     ensureMdns();
     initWebServer(server);
@@ -154,6 +158,7 @@ void runtimeHandleWifiTransitionLogs(bool wifiConnected) {
   if (wifiConnected != g_lastWifiConnected) {
     if (wifiConnected) {
       logInfo("✅ WiFi connected. Exiting provisioning mode.");
+      bootMilestone(BootMilestone::WifiConnected);
       // Trigger heartbeat on WiFi reconnect
       if (g_heartbeatInitialized) {
         triggerHeartbeat();
@@ -178,9 +183,7 @@ void runtimeHandleWifiTransitionLogs(bool wifiConnected) {
 bool runtimeHandleNoWifiLoop(unsigned long nowMs) {
   if (!isWiFiConnected()) {
     if (nowMs - g_lastSettingsFlushPortalMs >= 5000) {
-      ledState.loop();
-      displaySettings.loop();
-      nightMode.loop();
+      settingsStore.loop(nowMs);
       g_lastSettingsFlushPortalMs = nowMs;
     }
     return true;
@@ -188,8 +191,8 @@ bool runtimeHandleNoWifiLoop(unsigned long nowMs) {
   return false;
 }
 
-void runtimeEnsureOnlineServices(WebServer& server) {
-  if (!isWiFiConnected()) return;
+void runtimeEnsureOnlineServices(HttpServer& server) {
+  if (!g_servicesStarted || !isWiFiConnected()) return;
   ensureMdns();
   if (!g_serverInitialized) {
     initWebServer(server);
@@ -226,28 +229,39 @@ void runtimeEnsureOnlineServices(WebServer& server) {
   }
 }
 
-void runtimeHandleOnlineServices(WebServer& server, unsigned long nowMs) {
-  if (!isWiFiConnected()) return;
+void runtimeHandleOnlineServices(HttpServer& server, unsigned long nowMs) {
+  (void)server;  // served from its own task
+  if (!g_servicesStarted || !isWiFiConnected()) return;
   if (g_serverInitialized) {
-    server.handleClient();
+    eventStreamService(nowMs);
+    stateWaitService(nowMs);
   }
 #if OTA_ENABLED
-  ArduinoOTA.handle();
+  {
+    LoopStageTimer t(LoopStage::Ota);
+    HeapTagScope heapTag(HeapTag::Ota);
+    ArduinoOTA.handle();
+  }
 #endif
-  mqttEventLoop();
+  {
+    LoopStageTimer t(LoopStage::Mqtt);
+    HeapTagScope heapTag(HeapTag::Mqtt);
+    mqttEventLoop();
+  }
+  LoopStageTimer t(LoopStage::Heartbeat);
+  HeapTagScope heapTag(HeapTag::Heartbeat);
   processHeartbeat(nowMs);
 }
 
 void runtimeHandlePeriodicSettings(unsigned long nowMs, unsigned long intervalMs) {
   if (nowMs - g_lastSettingsFlushMs >= intervalMs) {
-    ledState.loop();
-    displaySettings.loop();
-    nightMode.loop();
+    settingsStore.loop(nowMs);
     g_lastSettingsFlushMs = nowMs;
   }
 }
 
 bool runtimeHandleLedEvents(unsigned long nowMs) {
+  LoopStageTimer t(LoopStage::LedEvents);
   return ledEventsTick(nowMs);
 }
 
@@ -258,11 +272,14 @@ bool runtimeHandleStartupSequence(StartupSequence& startupSequence) {
 void runtimeHandleWordclockLoop(unsigned long nowMs) {
   if (nowMs - g_lastLoopMs >= 50) {
     g_lastLoopMs = nowMs;
-    runWordclockLoop();
+    {
+      LoopStageTimer t(LoopStage::Wordclock);
+      runWordclockLoop();
+    }
 
 #if OTA_ENABLED
     struct tm timeinfo;
-    if (getLocalTime(&timeinfo)) {
+    if (getLocalTime(&timeinfo, 0)) {
       time_t nowEpoch = time(nullptr);
       if (timeinfo.tm_hour == 2 && timeinfo.tm_min == 0 && nowEpoch - g_lastFirmwareCheck > 3600) {
         bool autoAllowed = displaySettings.getAutoUpdate() && displaySettings.getUpdateChannel() != "develop";
@@ -2,14 +2,14 @@
 
 #include <Arduino.h>
 
-class WebServer;
+class HttpServer;
 class StartupSequence;
 
-void runtimeInitOnSetup(bool wifiConnected, WebServer& server);
+void runtimeInitOnSetup(bool wifiConnected, HttpServer& server);
 void runtimeHandleWifiTransitionLogs(bool wifiConnected);
 bool runtimeHandleNoWifiLoop(unsigned long nowMs);
-void runtimeEnsureOnlineServices(WebServer& server);
-void runtimeHandleOnlineServices(WebServer& server, unsigned long nowMs);
+void runtimeEnsureOnlineServices(HttpServer& server);
+void runtimeHandleOnlineServices(HttpServer& server, unsigned long nowMs);
 void runtimeHandlePeriodicSettings(unsigned long nowMs, unsigned long intervalMs);
 bool runtimeHandleLedEvents(unsigned long nowMs);
 bool runtimeHandleStartupSequence(StartupSequence& startupSequence);
@@ -4,10 +4,18 @@
 #include <Preferences.h>
 #include "language_settings.h"
 #include "log.h"
+#include "settings_store.h"
 
 class SettingsMigration {
 public:
     static void migrateIfNeeded() {
+        // Fast path: a current snapshot is only written by a boot that ran
+        // every step below at this SETTINGS_SNAPSHOT_VERSION. Adding a step
+        // means bumping that version.
+        if (settingsStore.snapshotLoaded()) {
+            return;
+        }
+
         migrateLogDeleteOnBootDefault();
 
         // MUST stay above the migrated_v2 early-return below. That key is the
@@ -0,0 +1,671 @@
+#include "settings_store.h"
+
+#include <Preferences.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PIO_UNIT_TESTING
+#include <esp_flash_partitions.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#endif
+
+SettingsStore settingsStore;
+
+namespace {
+
+const unsigned long kDayMs = 24UL * 60UL * 60UL * 1000UL;
+const size_t kNvsEntryBytes = 32;
+
+// Snapshot blob: header {u16 version, u16 records, u32 install, u32 crc of
+// the records}, then per key {u32 id, u8 type, u8 stored, u16 length, value}.
+// Numbers are 4 bytes little-endian, text is stored without its terminator.
+// `install` ties it to one installation of one image (installId()).
+const char* const kSnapshotNs = "wc_snap";
+const char* const kSnapshotKey = "v";
+const size_t kSnapshotHeader = 12;
+const size_t kRecordHeader = 8;
+const size_t kSnapshotMaxBytes = 4000;  // NVS blobs may span pages, but keep it sane
+
+uint64_t nowUs() {
+#ifndef PIO_UNIT_TESTING
+  return static_cast<uint64_t>(esp_timer_get_time());
+#else
+  return 0;
+#endif
+}
+
+uint32_t crc32(const uint8_t* data, size_t length) {
+#ifndef PIO_UNIT_TESTING
+  return esp_rom_crc32_le(0, data, static_cast<uint32_t>(length));
+#else
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+#endif
+}
+
+uint32_t s_installId = 0;
+bool s_installKnown = false;
+
+#ifdef PIO_UNIT_TESTING
+uint32_t s_testInstalls = 0;
+#else
+// The sequence number the bootloader picks the app by. Every OTA install
+// raises it, a reinstall of the same image and a rollback included.
+uint32_t otaSequence() {
+  const esp_partition_t* otadata =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_OTA, nullptr);
+  if (!otadata) return 0;
+  uint32_t seq = 0;
+  for (size_t sector = 0; sector < 2; ++sector) {
+    esp_ota_select_entry_t entry;
+    if (esp_partition_read(otadata, sector * SPI_FLASH_SEC_SIZE, &entry, sizeof(entry)) != ESP_OK) continue;
+    if (entry.ota_seq == UINT32_MAX) continue;
+    if (entry.crc != esp_rom_crc32_le(UINT32_MAX, reinterpret_cast<const uint8_t*>(&entry.ota_seq), 4)) continue;
+    if (entry.ota_seq > seq) seq = entry.ota_seq;
+  }
+  return seq;
+}
+#endif
+
+// Which install of which image wrote the snapshot. The firmware version is
+// not enough: roll back to an image without snapshots, change a setting,
+// reinstall the same version, and its old snapshot would look current and
+// revert the change (and skip migrations the other image relied on). The OTA
+// sequence moves on every install in between; the ELF hash and the slot
+// tell builds apart that share a version. A serial flash resets the
+// sequence, so there only the ELF hash and slot count.
+uint32_t installId() {
+  if (s_installKnown) return s_installId;
+  static const char version[] = FIRMWARE_VERSION;
+  uint32_t id = crc32(reinterpret_cast<const uint8_t*>(version), sizeof(version) - 1);
+  uint32_t seq;
+#ifndef PIO_UNIT_TESTING
+  const esp_app_desc_t* app = esp_ota_get_app_description();
+  id = esp_rom_crc32_le(id, app->app_elf_sha256, sizeof(app->app_elf_sha256));
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  uint32_t slot = running ? running->address : 0;
+  id = esp_rom_crc32_le(id, reinterpret_cast<const uint8_t*>(&slot), sizeof(slot));
+  seq = otaSequence();
+#else
+  seq = s_testInstalls;
+#endif
+  s_installId = id ^ (seq * 2654435761u);
+  s_installKnown = true;
+  return s_installId;
+}
+
+// FNV-1a over "ns/key"; records are matched on it together with the type
+uint32_t keyId(const char* ns, const char* key) {
+  uint32_t h = 2166136261u;
+  for (const char* p = ns; *p; ++p) h = (h ^ static_cast<uint8_t>(*p)) * 16777619u;
+  h = (h ^ '/') * 16777619u;
+  for (const char* p = key; *p; ++p) h = (h ^ static_cast<uint8_t>(*p)) * 16777619u;
+  return h;
+}
+
+uint16_t readLe16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint8_t* writeLe16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  return p + 2;
+}
+
+uint8_t* writeLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+  return p + 4;
+}
+
+// Header and record bounds check out, so lookups can walk it unchecked
+bool snapshotValid(const uint8_t* image, size_t length) {
+  if (length < kSnapshotHeader) return false;
+  if (readLe16(image) != SETTINGS_SNAPSHOT_VERSION) return false;
+  if (readLe32(image + 4) != installId()) return false;
+  if (crc32(image + kSnapshotHeader, length - kSnapshotHeader) != readLe32(image + 8)) return false;
+  size_t at = kSnapshotHeader;
+  for (uint16_t i = readLe16(image + 2); i > 0; --i) {
+    if (length - at < kRecordHeader) return false;
+    at += kRecordHeader + readLe16(image + at + 6);
+    if (at > length) return false;
+  }
+  return at == length;
+}
+
+// Flash NVS spends on one write of the value: numbers fit in one entry,
+// text and blobs take a header entry plus their data rounded up to entries
+size_t nvsBytes(SettingType type, size_t length) {
+  if (type == SettingType::Str || type == SettingType::Bytes) {
+    return kNvsEntryBytes * (1 + (length + kNvsEntryBytes - 1) / kNvsEntryBytes);
+  }
+  return kNvsEntryBytes;
+}
+
+#ifndef PIO_UNIT_TESTING
+// Preferences commits after every put; the store writes a namespace's keys
+// through one handle and commits once
+class NamespaceWriter {
+public:
+  explicit NamespaceWriter(const char* ns) { ok_ = nvs_open(ns, NVS_READWRITE, &handle_) == ESP_OK; }
+  ~NamespaceWriter() {
+    if (ok_) nvs_close(handle_);
+  }
+  bool ok() const { return ok_; }
+
+  bool putNumber(const char* key, SettingType type, uint32_t v) {
+    switch (type) {
+      case SettingType::U16: return nvs_set_u16(handle_, key, static_cast<uint16_t>(v)) == ESP_OK;
+      case SettingType::U32: return nvs_set_u32(handle_, key, v) == ESP_OK;
+      default: return nvs_set_u8(handle_, key, static_cast<uint8_t>(v)) == ESP_OK;  // Bool as Preferences does
+    }
+  }
+  bool putString(const char* key, const String& v) { return nvs_set_str(handle_, key, v.c_str()) == ESP_OK; }
+  bool putBytes(const char* key, const void* data, size_t length) {
+    return nvs_set_blob(handle_, key, data, length) == ESP_OK;
+  }
+  bool erase(const char* key) {
+    esp_err_t err = nvs_erase_key(handle_, key);
+    return err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND;
+  }
+  bool finish() { return nvs_commit(handle_) == ESP_OK; }
+
+private:
+  nvs_handle_t handle_ = 0;
+  bool ok_ = false;
+};
+#else
+// Native builds write through the Preferences mock
+class NamespaceWriter {
+public:
+  explicit NamespaceWriter(const char* ns) { ok_ = prefs_.begin(ns, false); }
+  ~NamespaceWriter() { prefs_.end(); }
+  bool ok() const { return ok_; }
+
+  bool putNumber(const char* key, SettingType type, uint32_t v) {
+    switch (type) {
+      case SettingType::Bool: return prefs_.putBool(key, v != 0) > 0;
+      case SettingType::U16: return prefs_.putUShort(key, static_cast<uint16_t>(v)) > 0;
+      case SettingType::U32: return prefs_.putUInt(key, v) > 0;
+      default: return prefs_.putUChar(key, static_cast<uint8_t>(v)) > 0;
+    }
+  }
+  bool putString(const char* key, const String& v) {
+    // putString returns the length, so an empty string is not a failure
+    prefs_.putString(key, v);
+    return prefs_.isKey(key);
+  }
+  bool putBytes(const char* key, const void* data, size_t length) {
+    prefs_.putBytes(key, data, length);
+    return prefs_.isKey(key);
+  }
+  bool erase(const char* key) {
+    prefs_.remove(key);
+    return true;
+  }
+  bool finish() { return true; }
+
+private:
+  Preferences prefs_;
+  bool ok_ = false;
+};
+#endif
+
+}  // namespace
+
+SettingsStore::Entry* SettingsStore::add(const char* ns, const char* key, SettingType type) {
+  for (uint8_t i = 0; i < count_; ++i) {
+    Entry& e = entries_[i];
+    if (e.type == type && strcmp(e.ns, ns) == 0 && strcmp(e.key, key) == 0) {
+      clearDirty(e);
+      return &e;
+    }
+  }
+  if (count_ >= SETTINGS_MAX_KEYS) {
+    if (overflows_ < 0xFF) overflows_++;
+    return nullptr;
+  }
+  Entry& e = entries_[count_++];
+  e.ns = ns;
+  e.key = key;
+  e.type = type;
+  return &e;
+}
+
+void SettingsStore::load(Entry& e, uint32_t defNum, const char* defStr) {
+  const uint64_t startUs = nowUs();
+  const uint8_t* value = nullptr;
+  size_t length = 0;
+  if (fromSnapshot(e, &value, &length)) {
+    if (!e.stored) {
+      e.num = defNum;
+      e.str = defStr ? defStr : "";
+      e.blobLength = 0;
+    } else if (e.type == SettingType::Str) {
+      e.str = String(reinterpret_cast<const char*>(value), static_cast<unsigned int>(length));
+    } else if (e.type == SettingType::Bytes) {
+      // Like Preferences::getBytes(): too long for the buffer reads as nothing
+      e.blobLength = length <= e.blobCapacity ? length : 0;
+      memcpy(e.blob, value, e.blobLength);
+    } else {
+      e.num = readLe32(value);
+    }
+  } else {
+    Preferences prefs;
+    prefs.begin(e.ns, true);
+    e.stored = prefs.isKey(e.key);
+    switch (e.type) {
+      case SettingType::Bool: e.num = prefs.getBool(e.key, defNum != 0) ? 1 : 0; break;
+      case SettingType::U8: e.num = prefs.getUChar(e.key, static_cast<uint8_t>(defNum)); break;
+      case SettingType::U16: e.num = prefs.getUShort(e.key, static_cast<uint16_t>(defNum)); break;
+      case SettingType::U32: e.num = prefs.getUInt(e.key, defNum); break;
+      case SettingType::Str: e.str = e.stored ? prefs.getString(e.key, defStr) : String(defStr); break;
+      case SettingType::Bytes: e.blobLength = e.stored ? prefs.getBytes(e.key, e.blob, e.blobCapacity) : 0; break;
+    }
+    prefs.end();
+  }
+  loadUs_ += static_cast<uint32_t>(nowUs() - startUs);
+}
+
+SettingKey SettingsStore::addBool(const char* ns, const char* key, bool def) {
+  Entry* e = add(ns, key, SettingType::Bool);
+  if (!e) return SETTING_NONE;
+  load(*e, def ? 1 : 0, nullptr);
+  return handle(e);
+}
+
+SettingKey SettingsStore::addU8(const char* ns, const char* key, uint8_t def) {
+  Entry* e = add(ns, key, SettingType::U8);
+  if (!e) return SETTING_NONE;
+  load(*e, def, nullptr);
+  return handle(e);
+}
+
+SettingKey SettingsStore::addU16(const char* ns, const char* key, uint16_t def) {
+  Entry* e = add(ns, key, SettingType::U16);
+  if (!e) return SETTING_NONE;
+  load(*e, def, nullptr);
+  return handle(e);
+}
+
+SettingKey SettingsStore::addU32(const char* ns, const char* key, uint32_t def) {
+  Entry* e = add(ns, key, SettingType::U32);
+  if (!e) return SETTING_NONE;
+  load(*e, def, nullptr);
+  return handle(e);
+}
+
+SettingKey SettingsStore::addString(const char* ns, const char* key, const char* def) {
+  Entry* e = add(ns, key, SettingType::Str);
+  if (!e) return SETTING_NONE;
+  load(*e, 0, def ? def : "");
+  return handle(e);
+}
+
+SettingKey SettingsStore::addBytes(const char* ns, const char* key, void* buf, size_t capacity) {
+  Entry* e = add(ns, key, SettingType::Bytes);
+  if (!e) return SETTING_NONE;
+  e->blob = buf;
+  e->blobCapacity = capacity;
+  load(*e, 0, nullptr);
+  return handle(e);
+}
+
+SettingsStore::Entry* SettingsStore::entry(SettingKey k, SettingType type) {
+  if (k >= count_ || entries_[k].type != type) return nullptr;
+  return &entries_[k];
+}
+
+const SettingsStore::Entry* SettingsStore::entry(SettingKey k, SettingType type) const {
+  if (k >= count_ || entries_[k].type != type) return nullptr;
+  return &entries_[k];
+}
+
+bool SettingsStore::getBool(SettingKey k) const {
+  const Entry* e = entry(k, SettingType::Bool);
+  return e && e->num != 0;
+}
+
+uint8_t SettingsStore::getU8(SettingKey k) const {
+  const Entry* e = entry(k, SettingType::U8);
+  return e ? static_cast<uint8_t>(e->num) : 0;
+}
+
+uint16_t SettingsStore::getU16(SettingKey k) const {
+  const Entry* e = entry(k, SettingType::U16);
+  return e ? static_cast<uint16_t>(e->num) : 0;
+}
+
+uint32_t SettingsStore::getU32(SettingKey k) const {
+  const Entry* e = entry(k, SettingType::U32);
+  return e ? e->num : 0;
+}
+
+const String& SettingsStore::getString(SettingKey k) const {
+  static const String empty;
+  const Entry* e = entry(k, SettingType::Str);
+  return e ? e->str : empty;
+}
+
+size_t SettingsStore::storedLength(SettingKey k) const {
+  const Entry* e = entry(k, SettingType::Bytes);
+  return e ? e->blobLength : 0;
+}
+
+bool SettingsStore::isStored(SettingKey k) const {
+  return k < count_ && entries_[k].stored;
+}
+
+void SettingsStore::setNumber(SettingKey k, SettingType type, uint32_t v) {
+  Entry* e = entry(k, type);
+  if (!e || (e->num == v && e->stored)) return;
+  e->num = v;
+  markDirty(*e);
+}
+
+void SettingsStore::setBool(SettingKey k, bool v) { setNumber(k, SettingType::Bool, v ? 1 : 0); }
+void SettingsStore::setU8(SettingKey k, uint8_t v) { setNumber(k, SettingType::U8, v); }
+void SettingsStore::setU16(SettingKey k, uint16_t v) { setNumber(k, SettingType::U16, v); }
+void SettingsStore::setU32(SettingKey k, uint32_t v) { setNumber(k, SettingType::U32, v); }
+
+void SettingsStore::setString(SettingKey k, const char* v) {
+  Entry* e = entry(k, SettingType::Str);
+  if (!e || !v || (e->str == v && e->stored)) return;
+  e->str = v;
+  markDirty(*e);
+}
+
+void SettingsStore::bytesChanged(SettingKey k, size_t length) {
+  Entry* e = entry(k, SettingType::Bytes);
+  if (!e) return;
+  e->blobLength = length < e->blobCapacity ? length : e->blobCapacity;
+  markDirty(*e);
+}
+
+bool SettingsStore::pending(const char* ns) const {
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (entries_[i].dirty && strcmp(entries_[i].ns, ns) == 0) return true;
+  }
+  return false;
+}
+
+void SettingsStore::markDirty(Entry& e) {
+  if (e.dirty) return;
+  e.dirty = true;
+  if (pendingCount_++ == 0) pendingSinceMs_ = millis();
+}
+
+void SettingsStore::clearDirty(Entry& e) {
+  if (!e.dirty) return;
+  e.dirty = false;
+  pendingCount_--;
+}
+
+void SettingsStore::loop(unsigned long nowMs) {
+  if (pendingCount_ > 0 && nowMs - pendingSinceMs_ >= SETTINGS_COMMIT_DELAY_MS) {
+    commit();
+  }
+}
+
+bool SettingsStore::commit() {
+  if (pendingCount_ == 0) return true;
+  const unsigned long nowMs = millis();
+  rollDay(nowMs);
+  // The snapshot goes first: a power cut halfway must not leave it holding
+  // values the namespaces no longer have. If it cannot go, nothing does.
+  if (snapshotOnFlash_ && !eraseSnapshot()) {
+    pendingSinceMs_ = nowMs;
+    return false;
+  }
+  // Keys registered later in boot must not be read from the old image
+  free(snapshot_);
+  snapshot_ = nullptr;
+
+  uint32_t keys = 0;
+  uint32_t bytes = 0;
+  bool allOk = true;
+  bool visited[SETTINGS_MAX_KEYS] = {};
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (visited[i] || !entries_[i].dirty) continue;
+    // Each namespace is opened once, at its first pending key, and all of
+    // its pending keys are written through that one handle
+    const char* ns = entries_[i].ns;
+    NamespaceWriter writer(ns);
+    for (uint8_t j = i; j < count_; ++j) {
+      Entry& e = entries_[j];
+      if (visited[j] || strcmp(e.ns, ns) != 0) continue;
+      visited[j] = true;
+      if (!e.dirty || !writer.ok()) continue;
+      bool ok;
+      size_t length = 0;
+      if (e.type == SettingType::Str) {
+        ok = writer.putString(e.key, e.str);
+        length = e.str.length() + 1;
+      } else if (e.type == SettingType::Bytes) {
+        ok = writer.putBytes(e.key, e.blob, e.blobLength);
+        length = e.blobLength;
+      } else {
+        ok = writer.putNumber(e.key, e.type, e.num);
+      }
+      if (!ok) {
+        failures_++;
+        allOk = false;
+        continue;
+      }
+      e.stored = true;
+      clearDirty(e);
+      keys++;
+      bytes += nvsBytes(e.type, length);
+    }
+    if (!writer.ok() || !writer.finish()) {
+      failures_++;
+      allOk = false;
+    }
+  }
+
+  if (keys > 0) {
+    commits_++;
+    commitsDay_++;
+    keysWritten_ += keys;
+    bytesWritten_ += bytes;
+    bytesDay_ += bytes;
+  }
+  // What is left waits a full delay before the next try
+  pendingSinceMs_ = nowMs;
+  return allOk;
+}
+
+void SettingsStore::rollDay(unsigned long nowMs) {
+  while (nowMs - dayStartMs_ >= kDayMs) {
+    commitsPrevDay_ = commitsDay_;
+    bytesPrevDay_ = bytesDay_;
+    commitsDay_ = 0;
+    bytesDay_ = 0;
+    dayStartMs_ += kDayMs;
+  }
+}
+
+bool SettingsStore::fromSnapshot(Entry& e, const uint8_t** value, size_t* length) {
+  if (!snapshot_) return false;
+  const uint32_t id = keyId(e.ns, e.key);
+  size_t at = kSnapshotHeader;
+  for (uint16_t i = readLe16(snapshot_ + 2); i > 0; --i) {
+    const uint8_t* rec = snapshot_ + at;
+    const uint16_t recLength = readLe16(rec + 6);
+    if (readLe32(rec) == id && rec[4] == static_cast<uint8_t>(e.type)) {
+      e.stored = rec[5] != 0;
+      *value = rec + kRecordHeader;
+      *length = recLength;
+      if (snapshotHits_ < 0xFF) snapshotHits_++;
+      return true;
+    }
+    at += kRecordHeader + recLength;
+  }
+  snapshotMissed_ = true;
+  return false;
+}
+
+bool SettingsStore::loadSnapshot() {
+  const uint64_t startUs = nowUs();
+  Preferences prefs;
+  prefs.begin(kSnapshotNs, true);
+  const size_t length = prefs.getBytesLength(kSnapshotKey);
+  uint8_t* image = nullptr;
+  if (length >= kSnapshotHeader && length <= kSnapshotMaxBytes) {
+    image = static_cast<uint8_t*>(malloc(length));
+  }
+  if (image && prefs.getBytes(kSnapshotKey, image, length) == length && snapshotValid(image, length)) {
+    free(snapshot_);
+    snapshot_ = image;
+    snapshotLoaded_ = true;
+    snapshotOnFlash_ = true;
+  } else {
+    free(image);
+  }
+  prefs.end();
+  loadUs_ += static_cast<uint32_t>(nowUs() - startUs);
+  return snapshotLoaded_;
+}
+
+void SettingsStore::finishBoot() {
+  free(snapshot_);
+  snapshot_ = nullptr;
+  if (snapshotMissed_) snapshotOnFlash_ = false;
+  saveSnapshot();
+}
+
+bool SettingsStore::saveSnapshot() {
+  if (snapshotBlocked_ || pendingCount_ > 0 || count_ == 0) return false;
+  if (snapshotOnFlash_) return true;
+
+  size_t length = kSnapshotHeader;
+  for (uint8_t i = 0; i < count_; ++i) {
+    const Entry& e = entries_[i];
+    length += kRecordHeader;
+    if (!e.stored) continue;
+    if (e.type == SettingType::Str) length += e.str.length();
+    else if (e.type == SettingType::Bytes) length += e.blobLength;
+    else length += 4;
+  }
+  if (length > kSnapshotMaxBytes) return false;
+  uint8_t* image = static_cast<uint8_t*>(malloc(length));
+  if (!image) return false;
+
+  uint8_t* p = writeLe16(image, SETTINGS_SNAPSHOT_VERSION);
+  p = writeLe16(p, count_);
+  p = writeLe32(p, installId());
+  p += 4;  // crc, below
+  for (uint8_t i = 0; i < count_; ++i) {
+    const Entry& e = entries_[i];
+    const uint8_t* value = nullptr;
+    uint8_t number[4];
+    size_t valueLength = 0;
+    if (e.stored) {
+      if (e.type == SettingType::Str) {
+        value = reinterpret_cast<const uint8_t*>(e.str.c_str());
+        valueLength = e.str.length();
+      } else if (e.type == SettingType::Bytes) {
+        value = static_cast<const uint8_t*>(e.blob);
+        valueLength = e.blobLength;
+      } else {
+        writeLe32(number, e.num);
+        value = number;
+        valueLength = 4;
+      }
+    }
+    p = writeLe32(p, keyId(e.ns, e.key));
+    *p++ = static_cast<uint8_t>(e.type);
+    *p++ = e.stored ? 1 : 0;
+    p = writeLe16(p, static_cast<uint16_t>(valueLength));
+    if (valueLength) memcpy(p, value, valueLength);
+    p += valueLength;
+  }
+  writeLe32(image + 8, crc32(image + kSnapshotHeader, length - kSnapshotHeader));
+
+  NamespaceWriter writer(kSnapshotNs);
+  const bool ok = writer.ok() && writer.putBytes(kSnapshotKey, image, length) && writer.finish();
+  free(image);
+  if (!ok) {
+    failures_++;
+    return false;
+  }
+  snapshotOnFlash_ = true;
+  snapshotMissed_ = false;
+  const uint32_t bytes = static_cast<uint32_t>(nvsBytes(SettingType::Bytes, length));
+  bytesWritten_ += bytes;
+  bytesDay_ += bytes;
+  return true;
+}
+
+void SettingsStore::invalidateSnapshot() {
+  snapshotBlocked_ = true;
+  eraseSnapshot();
+}
+
+bool SettingsStore::eraseSnapshot() {
+  NamespaceWriter writer(kSnapshotNs);
+  if (!writer.ok() || !writer.erase(kSnapshotKey) || !writer.finish()) {
+    failures_++;
+    return false;
+  }
+  snapshotOnFlash_ = false;
+  bytesWritten_ += kNvsEntryBytes;
+  bytesDay_ += kNvsEntryBytes;
+  return true;
+}
+
+SettingsStoreStats SettingsStore::stats(unsigned long nowMs) {
+  rollDay(nowMs);
+  SettingsStoreStats s;
+  s.commits = commits_;
+  s.keysWritten = keysWritten_;
+  s.bytesWritten = bytesWritten_;
+  s.failures = failures_;
+  s.commitsDay = commitsDay_;
+  s.bytesDay = bytesDay_;
+  s.commitsPrevDay = commitsPrevDay_;
+  s.bytesPrevDay = bytesPrevDay_;
+  s.keys = count_;
+  s.pending = pendingCount_;
+  s.overflows = overflows_;
+  s.snapshotLoaded = snapshotLoaded_;
+  s.snapshotHits = snapshotHits_;
+  s.loadUs = loadUs_;
+  return s;
+}
+
+#ifdef PIO_UNIT_TESTING
+void SettingsStore::test_reset() {
+  for (uint8_t i = 0; i < count_; ++i) entries_[i] = Entry();
+  count_ = 0;
+  pendingCount_ = 0;
+  overflows_ = 0;
+  pendingSinceMs_ = 0;
+  commits_ = keysWritten_ = bytesWritten_ = failures_ = 0;
+  dayStartMs_ = 0;
+  commitsDay_ = bytesDay_ = commitsPrevDay_ = bytesPrevDay_ = 0;
+  free(snapshot_);
+  snapshot_ = nullptr;
+  snapshotLoaded_ = snapshotOnFlash_ = snapshotBlocked_ = snapshotMissed_ = false;
+  snapshotHits_ = 0;
+  loadUs_ = 0;
+}
+
+void test_settingsInstall() {
+  s_testInstalls++;
+  s_installKnown = false;
+}
+#endif
@@ -0,0 +1,195 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/** Handle for a registered setting; SETTING_NONE when the table was full. */
+typedef uint8_t SettingKey;
+static const SettingKey SETTING_NONE = 0xFF;
+
+enum class SettingType : uint8_t { Bool, U8, U16, U32, Str, Bytes };
+
+/**
+ * Snapshot format and migration level. Bump it when the record layout
+ * changes or SettingsMigration gains a step: an older snapshot is then
+ * ignored, the keys are read one by one and the migrations run again.
+ */
+static const uint16_t SETTINGS_SNAPSHOT_VERSION = 1;
+
+struct SettingsStoreStats {
+  uint32_t commits = 0;         // commits that wrote at least one key, since boot
+  uint32_t keysWritten = 0;
+  uint32_t bytesWritten = 0;    // NVS entry bytes, see SettingsStore
+  uint32_t failures = 0;        // keys or namespaces NVS refused; retried later
+  uint32_t commitsDay = 0;      // in the current 24 h window since boot
+  uint32_t bytesDay = 0;
+  uint32_t commitsPrevDay = 0;  // in the window before it
+  uint32_t bytesPrevDay = 0;
+  uint8_t keys = 0;             // registered
+  uint8_t pending = 0;          // changed, not yet committed
+  uint8_t overflows = 0;        // registrations the table had no room for
+  bool snapshotLoaded = false;  // this boot's keys came from the snapshot
+  uint8_t snapshotHits = 0;     // keys served from it
+  uint32_t loadUs = 0;          // time spent reading settings at boot
+};
+
+/**
+ * @brief One in-RAM shadow for every persisted setting, committed in batches
+ *
+ * Modules register their keys once (usually in begin()): add*() reads the
+ * current value from NVS, or takes the default, and returns a handle. Setters
+ * only touch the shadow and mark the key pending when the value changes, or
+ * when the key is not in NVS yet. loop() commits once the oldest pending
+ * change is SETTINGS_COMMIT_DELAY_MS old; commit() does it right away. A
+ * commit writes only the pending keys, each namespace opened once with a
+ * single nvs_commit.
+ *
+ * Registering a key again hands back the same handle and reloads it from
+ * NVS, dropping an unsaved change - as a reboot would.
+ *
+ * Bytes settings use the caller's buffer as their shadow: the module edits it
+ * in place and reports the change with bytesChanged().
+ *
+ * Boot reads everything at once from a snapshot: one versioned,
+ * CRC-checked blob holding every registered key. loadSnapshot() reads it
+ * before the first module registers, and add*() then takes values from it
+ * instead of opening namespaces. A missing, corrupt or outdated snapshot, or
+ * one written by another firmware build, leaves the per-key reads in place.
+ * The snapshot is a cache of the namespaces, never the other way round: the
+ * first commit after boot erases it, and finishBoot() or saveSnapshot()
+ * writes a fresh one when nothing is pending. A power cut therefore costs one
+ * slow boot, never a stale value.
+ *
+ * Write amplification is counted in NVS entry bytes: NVS writes whole 32-byte
+ * entries, one for a number and one plus one per 32 bytes of text or blob.
+ * Snapshot writes and erases count towards the bytes, not the commits.
+ * Not thread-safe; callers hold the app lock (see HttpAppLock).
+ */
+class SettingsStore {
+public:
+  SettingKey addBool(const char* ns, const char* key, bool def);
+  SettingKey addU8(const char* ns, const char* key, uint8_t def);
+  SettingKey addU16(const char* ns, const char* key, uint16_t def);
+  SettingKey addU32(const char* ns, const char* key, uint32_t def);
+  SettingKey addString(const char* ns, const char* key, const char* def);
+  /** Loads up to `capacity` bytes into `buf`; see storedLength(). */
+  SettingKey addBytes(const char* ns, const char* key, void* buf, size_t capacity);
+
+  bool getBool(SettingKey k) const;
+  uint8_t getU8(SettingKey k) const;
+  uint16_t getU16(SettingKey k) const;
+  uint32_t getU32(SettingKey k) const;
+  const String& getString(SettingKey k) const;
+  /** Bytes held by a Bytes setting (0 when nothing was stored). */
+  size_t storedLength(SettingKey k) const;
+  /** The key was in NVS when registered, or has been committed since. */
+  bool isStored(SettingKey k) const;
+
+  void setBool(SettingKey k, bool v);
+  void setU8(SettingKey k, uint8_t v);
+  void setU16(SettingKey k, uint16_t v);
+  void setU32(SettingKey k, uint32_t v);
+  void setString(SettingKey k, const char* v);
+  /** The caller changed the registered buffer; `length` bytes are to be stored. */
+  void bytesChanged(SettingKey k, size_t length);
+
+  bool pending() const { return pendingCount_ > 0; }
+  /** Some key of namespace `ns` is waiting for a commit. */
+  bool pending(const char* ns) const;
+  /** When the oldest pending change was made; when nothing is pending, the last commit. */
+  unsigned long pendingSinceMs() const { return pendingSinceMs_; }
+
+  /** Commits once the oldest pending change is SETTINGS_COMMIT_DELAY_MS old. */
+  void loop(unsigned long nowMs);
+  /** Writes every pending key now. False if NVS refused some; those stay pending. */
+  bool commit();
+
+  /** Reads the snapshot; true when it is intact and SETTINGS_SNAPSHOT_VERSION. */
+  bool loadSnapshot();
+  /** This boot's settings came from the snapshot, so migrations have run. */
+  bool snapshotLoaded() const { return snapshotLoaded_; }
+  /**
+   * End of boot: drops the loaded image and writes a snapshot if the one on
+   * flash is missing, outdated or lacks a key registered since.
+   */
+  void finishBoot();
+  /** Writes the snapshot now, unless keys are pending or it is current. */
+  bool saveSnapshot();
+  /**
+   * Something wrote the store's namespaces behind its back (factory reset):
+   * erases the snapshot and writes none until reboot.
+   */
+  void invalidateSnapshot();
+
+  SettingsStoreStats stats(unsigned long nowMs);
+
+#ifdef PIO_UNIT_TESTING
+  /** Forgets every key and the snapshot state, as a reboot would. */
+  void test_reset();
+#endif
+
+private:
+  struct Entry {
+    const char* ns = nullptr;
+    const char* key = nullptr;
+    SettingType type = SettingType::U8;
+    bool dirty = false;
+    bool stored = false;
+    uint32_t num = 0;
+    String str;
+    void* blob = nullptr;
+    size_t blobLength = 0;
+    size_t blobCapacity = 0;
+  };
+
+  Entry* add(const char* ns, const char* key, SettingType type);
+  void load(Entry& e, uint32_t defNum, const char* defStr);
+  // The loaded snapshot record for a key, or null; `value` and `length`
+  // point into the image
+  bool fromSnapshot(Entry& e, const uint8_t** value, size_t* length);
+  bool eraseSnapshot();
+  Entry* entry(SettingKey k, SettingType type);
+  const Entry* entry(SettingKey k, SettingType type) const;
+  SettingKey handle(const Entry* e) const { return static_cast<SettingKey>(e - entries_); }
+  void setNumber(SettingKey k, SettingType type, uint32_t v);
+  void markDirty(Entry& e);
+  void clearDirty(Entry& e);
+  void rollDay(unsigned long nowMs);
+
+  Entry entries_[SETTINGS_MAX_KEYS];
+  uint8_t count_ = 0;
+  uint8_t pendingCount_ = 0;
+  uint8_t overflows_ = 0;
+  unsigned long pendingSinceMs_ = 0;
+
+  uint32_t commits_ = 0;
+  uint32_t keysWritten_ = 0;
+  uint32_t bytesWritten_ = 0;
+  uint32_t failures_ = 0;
+  unsigned long dayStartMs_ = 0;
+  uint32_t commitsDay_ = 0;
+  uint32_t bytesDay_ = 0;
+  uint32_t commitsPrevDay_ = 0;
+  uint32_t bytesPrevDay_ = 0;
+
+  uint8_t* snapshot_ = nullptr;  // image read by loadSnapshot(), until finishBoot()
+  bool snapshotLoaded_ = false;
+  bool snapshotOnFlash_ = false;  // the blob in NVS matches the shadow
+  bool snapshotBlocked_ = false;
+  bool snapshotMissed_ = false;   // a key was registered that it did not hold
+  uint8_t snapshotHits_ = 0;
+  uint32_t loadUs_ = 0;
+};
+
+extern SettingsStore settingsStore;
+
+#ifdef PIO_UNIT_TESTING
+/** An OTA install of any image: the OTA sequence moves on. */
+void test_settingsInstall();
+#endif
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Lightweight change notification for user-visible state.
+//
+// Setters in LedState, DisplaySettings and NightMode call notifyStateChanged()
+// after an actual change; consumers (the MQTT state publisher) register a
+// listener and decide for themselves when to act. Every notification also
+// bumps a generation counter, so a poller (/api/state) can tell "anything
+// changed since I last looked" from one integer. Header-only on purpose:
+// the settings classes are header-only and are compiled into most native
+// tests, which then need no extra translation unit or mock.
+
+enum class StateChange : uint8_t {
+  Light = 0,   // colour, brightness, clock on/off
+  Display,     // animation, 'HET IS' duration, update channel / auto update
+  NightMode,   // schedule, effect, dim level, override, active
+  System,      // language / dialect choice, firmware update running
+  Count
+};
+
+using StateChangeListener = void (*)(StateChange change);
+
+static const uint8_t STATE_CHANGE_MAX_LISTENERS = 4;
+
+namespace state_events_detail {
+inline StateChangeListener* listeners() {
+  static StateChangeListener list[STATE_CHANGE_MAX_LISTENERS] = {};
+  return list;
+}
+inline std::atomic<uint32_t>& generation() {
+  static std::atomic<uint32_t> g{0};
+  return g;
+}
+}
+
+/** Number of notifyStateChanged() calls since boot (wraps). */
+inline uint32_t stateGeneration() {
+  return state_events_detail::generation().load(std::memory_order_acquire);
+}
+
+/** Register a listener; registering the same one twice is a no-op. */
+inline bool addStateChangeListener(StateChangeListener fn) {
+  StateChangeListener* list = state_events_detail::listeners();
+  for (uint8_t i = 0; i < STATE_CHANGE_MAX_LISTENERS; ++i) {
+    if (list[i] == fn) return true;
+    if (!list[i]) {
+      list[i] = fn;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void removeStateChangeListener(StateChangeListener fn) {
+  StateChangeListener* list = state_events_detail::listeners();
+  for (uint8_t i = 0; i < STATE_CHANGE_MAX_LISTENERS; ++i) {
+    if (list[i] == fn) list[i] = nullptr;
+  }
+}
+
+inline void notifyStateChanged(StateChange change) {
+  state_events_detail::generation().fetch_add(1, std::memory_order_acq_rel);
+  StateChangeListener* list = state_events_detail::listeners();
+  for (uint8_t i = 0; i < STATE_CHANGE_MAX_LISTENERS; ++i) {
+    if (list[i]) list[i](change);
+  }
+}
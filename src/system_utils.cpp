@@ -4,18 +4,19 @@
 #include "log.h"
 
 #ifndef WORDCLOCK_BOOTSTRAP
-// Per-device build: pulls in the runtime singletons whose state we flush.
-// Bootstrap firmware has no settings to persist, so these headers and the
-// flush helper are excluded entirely to keep the bootstrap link minimal.
-#include "display_settings.h"
-#include "led_state.h"
-#include "night_mode.h"
+// Per-device build: every persisted setting lives in the settings store.
+// Bootstrap firmware has no settings to persist, so the flush helper is
+// excluded entirely to keep the bootstrap link minimal.
+#include "retained_clock.h"
+#include "settings_store.h"
 
 void flushAllSettings() {
   logDebug("Flushing all settings to persistent storage...");
-  ledState.flush();
-  displaySettings.flush();
-  nightMode.flush();
+  if (!settingsStore.commit()) {
+    logWarn("⚠️ Some settings could not be written");
+  }
+  // The next boot then reads them in one go
+  settingsStore.saveSnapshot();
   logDebug("Settings flush complete");
 }
 #else
@@ -25,6 +26,7 @@ void flushAllSettings() {
 void safeRestart() {
 #ifndef WORDCLOCK_BOOTSTRAP
   flushAllSettings();
+  retainTime();  // the next boot starts from this second
 #else
   // Belt-and-suspenders for the persistent(false) call in bootstrap_main:
   // on the way out, explicitly erase any Wi-Fi credentials that may have
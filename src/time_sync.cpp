@@ -1,3 +1,5 @@
 #include "time_sync.h"
 
 bool g_initialTimeSyncSucceeded = false;
+bool g_timeSyncPending = false;
+unsigned long g_timeSyncStartMs = 0;
@@ -4,32 +4,47 @@
 #include "log.h"
 #include "config.h"
 #include "led_events.h"
+#include "boot_profile.h"
+#include "retained_clock.h"
 
 extern bool g_initialTimeSyncSucceeded;
 
-// Initialize time synchronization via NTP
-// This function sets the timezone and NTP servers, and waits until the time is successfully retrieved.
-// Provides status messages via logging.
-inline void initTimeSync(const char* tzInfo, const char* ntp1, const char* ntp2) {
+extern bool g_timeSyncPending;
+extern unsigned long g_timeSyncStartMs;
+
+// Sets the time zone. Runs before the first frame: the system time survives a
+// software reset, so the clock can show it before NTP answers, and it must
+// not show it in UTC.
+inline void applyTimeZone(const char* tzInfo) {
+    setenv("TZ", tzInfo, 1);
+    tzset();
+}
+
+// Starts time synchronization via NTP; pollTimeSync() reports the outcome.
+// Nothing waits for it: the clock shows the time kept across a warm restart
+// (retained_clock.h), or else the no-time indicator, until the time arrives.
+inline void startTimeSync(const char* tzInfo, const char* ntp1, const char* ntp2) {
     g_initialTimeSyncSucceeded = false;
     configTzTime(tzInfo, ntp1, ntp2); // Set timezone and NTP servers
+    watchTimeSync();
     logInfo("⌛ Waiting for NTP...");
+    g_timeSyncPending = true;
+    g_timeSyncStartMs = millis();
+}
+
+// True once SNTP delivered the time or TIME_SYNC_TIMEOUT_MS has passed. A
+// clock that already runs on retained time does not count.
+inline bool pollTimeSync(unsigned long nowMs) {
+    if (!g_timeSyncPending) return true;
     struct tm timeinfo;
-    unsigned long start = millis();
-    bool synced = false;
-    while (millis() - start < TIME_SYNC_TIMEOUT_MS) {
-        if (getLocalTime(&timeinfo)) {
-            synced = true;
-            break;
-        }
-        logDebug(".");
-        delay(500);
-    }
-    if (!synced) {
+    if (timeConfidence() != TimeConfidence::Synced || !getLocalTime(&timeinfo, 0)) {
+        if (nowMs - g_timeSyncStartMs < TIME_SYNC_TIMEOUT_MS) return false;
+        g_timeSyncPending = false;
         logWarn("⌛ NTP timeout; proceeding without synced time");
         ledEventStart(LedEvent::NtpFailed);
-        return;
+        return true;
     }
+    g_timeSyncPending = false;
     char buf[32];
     snprintf(buf, sizeof(buf), "%02d/%02d %02d:%02d",
              timeinfo.tm_mday,
@@ -37,7 +52,17 @@ inline void initTimeSync(const char* tzInfo, const char* ntp1, const char* ntp2)
              timeinfo.tm_hour,
              timeinfo.tm_min);
     logInfo(String("🕒 Time synchronized: ") + buf);
-    g_initialTimeSyncSucceeded = true;
-    logRewriteUnsynced(); // rewrite uptime-based logs with real timestamps now that time is synced
+    if (!g_initialTimeSyncSucceeded) {
+        // The clock display may have seen the time first and rewritten already
+        g_initialTimeSyncSucceeded = true;
+        logRewriteUnsynced(); // rewrite uptime-based logs with real timestamps now that time is synced
+    }
+    bootMilestone(BootMilestone::TimeSynced);
     ledEventStop(LedEvent::NtpFailed);
+    return true;
+}
+
+// NTP was started at boot and has neither answered nor timed out yet
+inline bool timeSyncPending() {
+    return g_timeSyncPending;
 }
@@ -1,23 +1,26 @@
 #pragma once
-#include <Preferences.h>
 #include <Arduino.h>
 
+#include "settings_store.h"
+
 class UiAuth {
 public:
   void begin(const String &defaultPass) {
-    prefs.begin("ui_auth", false);
-    bool initialized = prefs.getBool("ui_init", false);
-    if (!initialized) {
+    initKey = settingsStore.addBool("ui_auth", "ui_init", false);
+    userKey = settingsStore.addString("ui_auth", "ui_user", "user");
+    passKey = settingsStore.addString("ui_auth", "ui_pass", defaultPass.c_str());
+    mustChangeKey = settingsStore.addBool("ui_auth", "mustchg", true);
+    if (!settingsStore.getBool(initKey)) {
       // First-time: set defaults and force change
-      prefs.putString("ui_user", "user");
-      prefs.putString("ui_pass", defaultPass);
-      prefs.putBool("mustchg", true);
-      prefs.putBool("ui_init", true);
+      settingsStore.setString(userKey, "user");
+      settingsStore.setString(passKey, defaultPass.c_str());
+      settingsStore.setBool(mustChangeKey, true);
+      settingsStore.setBool(initKey, true);
+      settingsStore.commit();
     }
-    user = prefs.getString("ui_user", "user");
-    pass = prefs.getString("ui_pass", defaultPass);
-    mustChange = prefs.getBool("mustchg", true);
-    prefs.end();
+    user = settingsStore.getString(userKey);
+    pass = settingsStore.getString(passKey);
+    mustChange = settingsStore.getBool(mustChangeKey);
   }
 
   const String &getUser() const { return user; }
@@ -28,19 +31,22 @@ public:
     if (newPass.length() < 6) return false;
     pass = newPass;
     mustChange = false;
-    prefs.begin("ui_auth", false);
-    prefs.putString("ui_pass", pass);
-    prefs.putBool("mustchg", mustChange);
-    prefs.end();
+    settingsStore.setString(passKey, pass.c_str());
+    settingsStore.setBool(mustChangeKey, mustChange);
+    // Not left to the commit delay: a power cut in between would bring back
+    // the old password, possibly the default one
+    settingsStore.commit();
     return true;
   }
 
 private:
-  Preferences prefs;
   String user;
   String pass;
   bool mustChange = true;
+  SettingKey initKey = SETTING_NONE;
+  SettingKey userKey = SETTING_NONE;
+  SettingKey passKey = SETTING_NONE;
+  SettingKey mustChangeKey = SETTING_NONE;
 };
 
 extern UiAuth uiAuth;
-
@@ -1,4 +1,5 @@
 #include "update_status.h"
+#include "state_events.h"
 
 static volatile bool g_updateRunning = false;
 
@@ -7,5 +8,7 @@ bool is_update_running() {
 }
 
 void set_update_running(bool running) {
+  if (g_updateRunning == running) return;
   g_updateRunning = running;
+  notifyStateChanged(StateChange::System);
 }
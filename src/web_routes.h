@@ -4,12 +4,20 @@
 #if OTA_ENABLED || UPDATE_UPLOAD_ENABLED
 #include <Update.h>
 #endif
-#include <WebServer.h>
+#include "http_server.h"
 #include <esp_system.h>
 #include <ctype.h>
 #include <PubSubClient.h>
 #include <time.h>
 #include <ArduinoJson.h>
+#include "json_arena.h"
+#include "fixed_string.h"
+#include "mem_pool.h"
+#include "settings_store.h"
+#include "boot_profile.h"
+#include "retained_clock.h"
+#include "loop_profile.h"
+#include "heap_tracker.h"
 #include <vector>
 #include <algorithm>
 #include <map>
@@ -20,6 +28,7 @@
 #include "logo_leds.h"
 #endif
 #include "log.h"
+#include "log_store.h"
 #include "time_mapper.h"
 #if OTA_ENABLED
 #include "ota_updater.h"
@@ -41,16 +50,21 @@
 #include "device_identity.h"
 #include "device_registration.h"
 #include "ble_provisioning.h"
+#include "event_stream.h"
+#include "http_encoding.h"
+#include "asset_bundle.h"
+#include "state_events.h"
 #include <WiFi.h>
+#include <lwip/sockets.h>
+#include <rom/miniz.h>
+#include <errno.h>
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
 
 // References to global variables
-extern WebServer server;
-extern String logBuffer[];
-extern int logIndex;
+extern HttpServer server;
 extern bool clockEnabled;
 extern bool g_wifiHadCredentialsAtBoot;
 
@@ -117,12 +131,17 @@ static const String& cachedUiVersion() {
 // unchanged page then costs one round trip and no body. Version + size is
 // enough of a tag because the UI version turns over exactly when the files do.
 //
+// One URL can be answered as br, gzip or plain depending on Accept-Encoding,
+// so each encoding gets its own tag (`coding` suffix; none for a plain file,
+// which keeps those tags unchanged) and every response says Vary so a shared
+// cache never hands a gzip body to a client that did not ask for one.
+//
 // Returns true when it has already sent a 304, in which case the caller must
 // not stream a body.
-static bool applyStaticCacheHeaders(size_t size) {
-  String etag = "\"" + cachedUiVersion() + "-" + String((uint32_t)size) + "\"";
+static bool sendCacheValidators(const String& etag) {
   server.sendHeader("Cache-Control", "no-cache");
   server.sendHeader("ETag", etag);
+  server.sendHeader("Vary", "Accept-Encoding");
   // Exact match only. Browsers echo back the strong tag we sent verbatim; a
   // weakened or multi-tag If-None-Match simply misses and costs a full body,
   // which is the pre-existing behaviour rather than a regression.
@@ -133,40 +152,200 @@ static bool applyStaticCacheHeaders(size_t size) {
   return false;
 }
 
-// Serve file, preferring a .gz variant if client accepts gzip
-static void serveFile(const char* path, const char* mime) {
-  // Gzip temporarily disabled; always serve plain files
-  bool acceptGzip = false;
-  String gzPath = String(path) + ".gz";
-  if (acceptGzip) {
-    File gz = FS_IMPL.open(gzPath, "r");
-    if (gz) {
-      // The gzipped and plain forms differ in size, so they get distinct
-      // ETags on their own — no Vary juggling needed here.
-      if (applyStaticCacheHeaders(gz.size())) { gz.close(); return; }
-      server.sendHeader("Content-Encoding", "gzip");
-      server.streamFile(gz, mime);
-      gz.close();
-      return;
+// Tag for a file on LittleFS: UI version + size, plus the coding if any.
+static bool applyStaticCacheHeaders(size_t size, const char* coding = nullptr) {
+  String etag = "\"" + cachedUiVersion() + "-" + String((uint32_t)size);
+  if (coding) etag += String("-") + coding;
+  etag += "\"";
+  return sendCacheValidators(etag);
+}
+
+// Plain body for a client that refuses gzip when only a gzip copy exists:
+// a .gz on the filesystem (read 512 B at a time) or an embedded asset
+// already whole in flash (`src`). Inflated as the client takes it, after
+// the handler has returned. tinfl writes into its 32 KB history window,
+// which doubles as the send buffer. For the length of the response the
+// window is in the Bulk pool (written and sent in order) and the
+// decompressor state, whose Huffman tables are hit for every symbol, in
+// the Hot pool.
+class InflateBodySource : public HttpBodySource {
+public:
+  InflateBodySource(const uint8_t* src, size_t srcLen, const File& more)
+      : more_(more),
+        src_(src),
+        srcLen_(srcLen),
+        state_(MemPool::Hot, sizeof(tinfl_decompressor)),
+        history_(MemPool::Bulk, TINFL_LZ_DICT_SIZE) {
+    if (more_) {
+      srcLen_ = more_.read(buf_, sizeof(buf_));
+      src_ = buf_;
+    }
+    inAt_ = gzipHeaderLength(src_, srcLen_);
+    eof_ = !more_ || !more_.available();
+    if (state_.data()) tinfl_init(reinterpret_cast<tinfl_decompressor*>(state_.data()));
+  }
+  ~InflateBodySource() override {
+    if (more_) more_.close();
+  }
+
+  bool corrupt() const { return inAt_ == 0; }
+  bool allocated() const { return state_.data() && history_.data(); }
+
+  long read(uint8_t* buffer, size_t length) override {
+    while (ready_ == 0) {
+      if (finished_) return 0;
+      inflate();
+    }
+    size_t n = length < ready_ ? length : ready_;
+    memcpy(buffer, history_.data() + readyAt_, n);
+    readyAt_ += n;
+    ready_ -= n;
+    return (long)n;
+  }
+
+private:
+  // One tinfl call; what it wrote to the window is sent before the next
+  void inflate() {
+    if (inAt_ == srcLen_ && !eof_) {
+      srcLen_ = more_.read(buf_, sizeof(buf_));
+      inAt_ = 0;
+      eof_ = (srcLen_ == 0) || !more_.available();
+    }
+    size_t inBytes = srcLen_ - inAt_;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - outAt_;
+    tinfl_status status = tinfl_decompress(reinterpret_cast<tinfl_decompressor*>(state_.data()), src_ + inAt_,
+                                           &inBytes, history_.data(), history_.data() + outAt_, &outBytes,
+                                           eof_ ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+    inAt_ += inBytes;
+    readyAt_ = outAt_;
+    ready_ = outBytes;
+    outAt_ = (outAt_ + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    if (status == TINFL_STATUS_HAS_MORE_OUTPUT) return;
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && !eof_) return;
+    finished_ = true;  // done, corrupt, or truncated
+  }
+
+  File more_;
+  uint8_t buf_[512];
+  const uint8_t* src_;
+  size_t srcLen_;
+  size_t inAt_ = 0;
+  bool eof_ = true;
+  bool finished_ = false;
+  PoolBuffer state_;
+  PoolBuffer history_;
+  size_t outAt_ = 0;
+  size_t readyAt_ = 0;  // window bytes written by the last call, not sent yet
+  size_t ready_ = 0;
+};
+
+// The response owns `more` from here on, and closes it.
+static void streamInflatedGzip(const uint8_t* src, size_t srcLen, const File& more, const char* mime) {
+  std::unique_ptr<InflateBodySource> body(new InflateBodySource(src, srcLen, more));
+  if (body->corrupt()) {
+    server.send(500, "text/plain", "Corrupt compressed asset");
+    return;
+  }
+  if (!body->allocated()) {
+    server.send(503, "text/plain", "Out of memory");
+    return;
+  }
+  server.sendSource(200, mime, std::move(body));
+}
+
+// Embedded assets replaced by a file under ASSET_OVERRIDE_DIR, one flag per
+// kEmbeddedAssets entry. Found once at boot, so a request for an asset that
+// is not overridden never touches LittleFS.
+static std::vector<bool> g_assetOverridden;
+
+static void scanAssetOverrides() {
+  g_assetOverridden.assign(kEmbeddedAssetCount, false);
+  if (!FS_IMPL.exists(ASSET_OVERRIDE_DIR)) return;
+  size_t found = 0;
+  for (size_t i = 0; i < kEmbeddedAssetCount; ++i) {
+    String base = String(ASSET_OVERRIDE_DIR) + kEmbeddedAssets[i].path;
+    if (FS_IMPL.exists(base) || FS_IMPL.exists(base + ".gz") || FS_IMPL.exists(base + ".br")) {
+      g_assetOverridden[i] = true;
+      logInfo(String("Asset override: ") + base);
+      found++;
     }
   }
-  File f = FS_IMPL.open(path, "r");
-  if (!f) {
-    File gz = FS_IMPL.open(gzPath, "r");
-    if (gz) {
-      if (applyStaticCacheHeaders(gz.size())) { gz.close(); return; }
-      server.sendHeader("Content-Encoding", "gzip");
-      server.streamFile(gz, mime);
-      gz.close();
+  if (found) logInfo("Serving " + String((unsigned)found) + " asset(s) from " ASSET_OVERRIDE_DIR);
+}
+
+static bool isAssetOverridden(const EmbeddedAsset* asset) {
+  size_t i = (size_t)(asset - kEmbeddedAssets);
+  return i < g_assetOverridden.size() && g_assetOverridden[i];
+}
+
+// Answer from the firmware image: no filesystem open, and send_P() writes
+// straight from the flash-mapped bytes with no heap copy.
+static void serveEmbeddedAsset(const EmbeddedAsset& asset, const char* mime) {
+  ContentCoding coding;
+  bool inflate;
+  if (!selectEmbeddedVariant(asset, server.header("Accept-Encoding").c_str(), coding, inflate)) {
+    server.send(406, "text/plain", "No acceptable encoding");
+    return;
+  }
+  char etag[48];
+  formatEmbeddedEtag(asset, inflate ? ContentCoding::Identity : coding, etag, sizeof(etag));
+  if (sendCacheValidators(etag)) return;
+  const uint8_t idx = static_cast<uint8_t>(coding);
+  if (inflate) {
+    streamInflatedGzip(asset.data[idx], asset.length[idx], File(), mime);
+    return;
+  }
+  if (coding != ContentCoding::Identity) server.sendHeader("Content-Encoding", contentCodingName(coding));
+  server.send_P(200, mime, reinterpret_cast<const char*>(asset.data[idx]), asset.length[idx]);
+}
+
+// Serve a static asset. The copy compiled into the firmware wins unless an
+// override exists on LittleFS; paths outside the bundle, and every path in a
+// build with an empty bundle, are read from LittleFS as before.
+//
+// From the filesystem, the best encoding both the client and LittleFS have
+// is sent: path.br, path.gz or path itself, in the order
+// rankContentCodings() gives for the request's Accept-Encoding. When the
+// client accepts nothing that is stored, the .gz copy is inflated on the fly.
+static void serveFile(const char* path, const char* mime) {
+  const EmbeddedAsset* asset = findEmbeddedAsset(path);
+  if (asset && !isAssetOverridden(asset)) {
+    serveEmbeddedAsset(*asset, mime);
+    return;
+  }
+  const String fsPath = asset ? String(ASSET_OVERRIDE_DIR) + path : String(path);
+  ContentCoding order[3];
+  size_t n = rankContentCodings(server.header("Accept-Encoding").c_str(), order);
+  for (size_t i = 0; i < n; ++i) {
+    File f = FS_IMPL.open(fsPath + contentCodingSuffix(order[i]), "r");
+    if (!f) continue;
+    bool plain = (order[i] == ContentCoding::Identity);
+    if (applyStaticCacheHeaders(f.size(), plain ? nullptr : contentCodingName(order[i]))) {
+      f.close();
       return;
     }
-    // No validators on a 404 — there is nothing to revalidate against.
-    server.send(404, "text/plain", String(path) + " not found");
+    // streamFile() adds "Content-Encoding: gzip" by itself for a *.gz file
+    // name; setting it here as well would read as gzip applied twice. The
+    // response keeps the file open until the client has all of it.
+    if (order[i] == ContentCoding::Brotli) server.sendHeader("Content-Encoding", "br");
+    server.streamFile(f, mime);
+    return;
+  }
+  File gz = FS_IMPL.open(fsPath + ".gz", "r");
+  if (gz) {
+    if (applyStaticCacheHeaders(gz.size(), "identity")) { gz.close(); return; }
+    streamInflatedGzip(nullptr, 0, gz, mime);
     return;
   }
-  if (applyStaticCacheHeaders(f.size())) { f.close(); return; }
-  server.streamFile(f, mime);
-  f.close();
+  // A client that refuses even identity still gets the plain file if any
+  File f = FS_IMPL.open(fsPath, "r");
+  if (f) {
+    if (applyStaticCacheHeaders(f.size())) { f.close(); return; }
+    server.streamFile(f, mime);
+    return;
+  }
+  // No validators on a 404 — there is nothing to revalidate against.
+  server.send(404, "text/plain", String(path) + " not found");
 }
 // Simple Basic-Auth guard for admin resources
 static bool ensureAdminAuth() {
@@ -195,8 +374,7 @@ static const char* nightOverrideToStr(NightModeOverride mode) {
   }
 }
 
-static void sendNightModeConfig() {
-  JsonDocument doc;
+static void buildNightModeConfig(JsonObject doc) {
   doc["enabled"] = nightMode.isEnabled();
   doc["effect"] = nightEffectToStr(nightMode.getEffect());
   doc["dim_percent"] = nightMode.getDimPercent();
@@ -208,9 +386,139 @@ static void sendNightModeConfig() {
   doc["active"] = nightMode.isActive();
   doc["schedule_active"] = nightMode.isScheduleActive();
   doc["time_synced"] = nightMode.hasTime();
-  String out;
-  serializeJson(doc, out);
-  server.send(200, "application/json", out);
+}
+
+// A body serialized whole into the Bulk pool, sent as the client takes it.
+class PoolBodySource : public HttpBodySource {
+public:
+  explicit PoolBodySource(size_t bytes) : buffer_(MemPool::Bulk, bytes) {}
+  char* data() const { return reinterpret_cast<char*>(buffer_.data()); }
+
+  long read(uint8_t* buffer, size_t length) override {
+    size_t left = length_ - at_;
+    size_t n = length < left ? length : left;
+    memcpy(buffer, buffer_.data() + at_, n);
+    at_ += n;
+    return (long)n;
+  }
+  void setLength(size_t length) { length_ = length; }
+
+private:
+  PoolBuffer buffer_;
+  size_t length_ = 0;
+  size_t at_ = 0;
+};
+
+// A body that fits one JSON_CHUNK_BYTES buffer from the scope's arena is
+// sent from there. A larger one is serialized into the Bulk pool and sent
+// with a length after the handler returns, so no handler waits on a slow
+// client.
+static void sendJson(JsonScope& json, JsonVariantConst doc) {
+  size_t length = measureJson(doc);
+  std::unique_ptr<PoolBodySource> body;
+  char* buf = nullptr;
+  if (length < JSON_CHUNK_BYTES) {
+    buf = json.buffer(JSON_CHUNK_BYTES);
+  } else {
+    body.reset(new PoolBodySource(length + 1));  // serializeJson() adds a NUL
+    buf = body->data();
+  }
+  if (!buf) {
+    server.send(500, "text/plain", "Out of memory");
+    return;
+  }
+  serializeJson(doc, buf, length + 1);
+  if (!body) {
+    server.send(200, "application/json", buf, length);
+    return;
+  }
+  body->setLength(length);
+  server.sendSource(200, "application/json", std::move(body), (long)length);
+}
+
+static void sendNightModeConfig() {
+  JSON_SCOPE(json, "GET /getNightModeConfig");
+  JsonDocument doc(json.allocator());
+  buildNightModeConfig(doc.to<JsonObject>());
+  sendJson(json, doc);
+}
+
+static void buildLanguageState(JsonObject doc) {
+  doc["active"] = LanguageSettings::activeLanguage();
+  doc["stored"] = LanguageSettings::storedLanguage();
+  doc["source"] = LanguageSettings::sourceName();
+  doc["setupComplete"] = LanguageSettings::isSetupComplete();
+  doc["rebootRequired"] = LanguageSettings::rebootRequired();
+  JsonArray available = doc["available"].to<JsonArray>();
+  for (size_t i = 0; i < getLanguageCount(); ++i) {
+    available.add(getLanguageCode(i));
+  }
+}
+
+static void buildDialectState(JsonObject doc) {
+  doc["active"] = LanguageSettings::activeDialect();
+  JsonArray available = doc["available"].to<JsonArray>();
+  for (size_t i = 0; i < getDialectCount(); ++i) {
+    const ClockDialect* d = getDialect(i);
+    if (!d) continue;
+    JsonObject item = available.add<JsonObject>();
+    item["id"] = d->id;
+    item["label"] = d->label;
+    item["sample"] = d->sample;
+  }
+  // Axes, when the variant has them. A client that ignores this key still
+  // works off `available` exactly as before — which is what keeps older
+  // dashboards (and Home Assistant) functioning against new firmware.
+  for (size_t i = 0; i < getDialectAxisCount(); ++i) {
+    const DialectAxis* axis = getDialectAxis(i);
+    if (!axis) continue;
+    JsonObject a = doc["axes"].add<JsonObject>();
+    a["id"] = axis->id;
+    a["label"] = axis->label;
+    a["active"] = getActiveDialectAxisValue(axis->id);
+    for (size_t o = 0; o < axis->optionCount; ++o) {
+      JsonObject opt = a["options"].add<JsonObject>();
+      opt["value"] = axis->options[o].value;
+      opt["label"] = axis->options[o].label;
+      opt["sample"] = axis->options[o].sample;
+    }
+  }
+}
+
+// Light and display groups as pushed on /api/events and returned by /api/state
+static void buildLightState(JsonObject doc) {
+  uint8_t r, g, b, w;
+  ledState.getRGBW(r, g, b, w);
+  if (w > 0) { r = g = b = 255; }
+  char color[7];
+  snprintf(color, sizeof(color), "%02X%02X%02X", r, g, b);
+  doc["on"] = clockEnabled;
+  doc["color"] = color;
+  doc["brightness"] = ledState.getBrightness();
+}
+
+static void buildDisplayState(JsonObject doc) {
+  doc["animate"] = displaySettings.getAnimateWords();
+  doc["auto_update"] = displaySettings.getAutoUpdate();
+  doc["update_channel"] = displaySettings.getUpdateChannel();
+  doc["sell_mode"] = displaySettings.isSellMode();
+#if !defined(PRODUCT_VARIANT_MINI)
+  doc["het_is_seconds"] = displaySettings.getHetIsDurationSec();
+#endif
+}
+
+static const char* ledEventName(LedEvent e) {
+  switch (e) {
+    case LedEvent::FirmwareCheck:         return "FirmwareCheck";
+    case LedEvent::FirmwareAvailable:     return "FirmwareAvailable";
+    case LedEvent::FirmwareDownloading:   return "FirmwareDownloading";
+    case LedEvent::FirmwareApplying:      return "FirmwareApplying";
+    case LedEvent::NtpFailed:             return "NtpFailed";
+    case LedEvent::MqttDisconnected:      return "MqttDisconnected";
+    case LedEvent::BleProvisioning:       return "BleProvisioning";
+    case LedEvent::WifiManagerPortal:     return "WifiManagerPortal";
+    default:                              return "FirmwareCheck";
+  }
 }
 
 #if defined(PRODUCT_VARIANT_LOGO)
@@ -240,7 +548,8 @@ static void refreshCurrentTimeDisplay() {
 }
 
 static void sendLogoState() {
-  JsonDocument doc;
+  JSON_SCOPE(json, "GET /logo/state");
+  JsonDocument doc(json.allocator());
   doc["brightness"] = logoLeds.getBrightness();
   uint16_t logoCount = getLogoLedCount();
   doc["count"] = logoCount;
@@ -252,9 +561,7 @@ static void sendLogoState() {
     snprintf(buf, sizeof(buf), "%02X%02X%02X", colors[i].r, colors[i].g, colors[i].b);
     arr.add(String(buf));
   }
-  String out;
-  serializeJson(doc, out);
-  server.send(200, "application/json", out);
+  sendJson(json, doc);
 }
 #endif
 
@@ -267,43 +574,327 @@ static void performFactoryReset() {
     p.clear();
     p.end();
   }
+  // The snapshot still holds the cleared values; the next boot must not
+  // bring them back
+  settingsStore.invalidateSnapshot();
 }
 
 // Clear all log files (helper function)
 static void clearAllLogFiles() {
   logFlushFile();
-  logCloseFile();
-  size_t deleted = 0;
-  size_t failed = 0;
-  File dir = FS_IMPL.open("/logs");
-  if (dir) {
-    while (true) {
-      File entry = dir.openNextFile();
-      if (!entry) break;
-      if (!entry.isDirectory()) {
-        String name = entry.name();
-        // Normalize path: remove leading "/" and "logs/" prefix if present
-        if (name.startsWith("/")) name = name.substring(1);
-        if (name.startsWith("logs/")) name = name.substring(5);
-        String full = String("/logs/") + name;
-        entry.close();
-        if (FS_IMPL.remove(full)) {
-          deleted++;
-        } else {
-          failed++;
-          logWarn("Failed to remove log file: " + full);
-        }
-      } else {
-        entry.close();
-      }
+  LogStoreStats before = logStoreStats();
+  logClearFiles();
+  logInfo("🗑️ Cleared " + String(before.segments) + " log segments (" + String(before.bytes + before.unsyncedBytes) + " bytes)");
+  // Re-enable file sink (reloads the now empty index)
+  logEnableFileSink();
+}
+
+// Log lines as a chunked text/plain body, read from the store about 1 KB at
+// a time as the client takes them: the app lock is not held while a slow
+// client drains, and the log file mutex only while a piece is read.
+class LogBodySource : public HttpBodySource {
+public:
+  // Stored lines in [from, to] at minLevel or above
+  LogBodySource(uint32_t from, uint32_t to, uint8_t minLevel) {
+    cursor_.query.from = from;
+    cursor_.query.to = to;
+    cursor_.query.minLevel = minLevel;
+  }
+  // The pre-sync file as it is
+  LogBodySource() : unsynced_(true) {}
+
+  long read(uint8_t* buffer, size_t length) override {
+    if (unsynced_) {
+      size_t n = logReadUnsyncedAt(offset_, buffer, length);
+      offset_ += (uint32_t)n;
+      return (long)n;
+    }
+    while (pendingAt_ == pending_.size()) {
+      if (cursor_.done) return 0;
+      pending_.clear();
+      pendingAt_ = 0;
+      logQueryMore(cursor_, append, this, kPieceBytes);
+    }
+    size_t n = pending_.size() - pendingAt_;
+    if (n > length) n = length;
+    memcpy(buffer, pending_.data() + pendingAt_, n);
+    pendingAt_ += n;
+    return (long)n;
+  }
+
+  static void send(std::unique_ptr<LogBodySource> body, const char* filename) {
+    if (filename) {
+      server.sendHeader("Content-Disposition", String("attachment; filename=\"") + filename + "\"");
     }
-    dir.close();
-    logInfo("🗑️ Cleared " + String(deleted) + " log files" + (failed > 0 ? " (" + String(failed) + " failed)" : ""));
+    server.sendSource(200, "text/plain", std::move(body));
+  }
+
+private:
+  static const size_t kPieceBytes = 1024;
+
+  static void append(void* ctx, const char* data, size_t length) {
+    static_cast<LogBodySource*>(ctx)->pending_.append(data, length);
+  }
+
+  LogCursor cursor_;
+  bool unsynced_ = false;
+  uint32_t offset_ = 0;
+  std::string pending_;
+  size_t pendingAt_ = 0;
+};
+
+// "YYYY-MM-DD" -> first and last epoch second of that local day
+static bool localDayBounds(const String& date, uint32_t& from, uint32_t& to) {
+  bool valid = (date.length() == 10 &&
+                isdigit(date[0]) && isdigit(date[1]) && isdigit(date[2]) && isdigit(date[3]) &&
+                date[4] == '-' &&
+                isdigit(date[5]) && isdigit(date[6]) &&
+                date[7] == '-' &&
+                isdigit(date[8]) && isdigit(date[9]));
+  if (!valid) return false;
+  struct tm lt = {};
+  lt.tm_year = date.substring(0, 4).toInt() - 1900;
+  lt.tm_mon = date.substring(5, 7).toInt() - 1;
+  lt.tm_mday = date.substring(8, 10).toInt();
+  lt.tm_isdst = -1;
+  time_t start = mktime(&lt);
+  lt.tm_mday += 1;
+  lt.tm_hour = 0;
+  lt.tm_min = 0;
+  lt.tm_sec = 0;
+  lt.tm_isdst = -1;
+  time_t next = mktime(&lt);
+  if (start <= 0 || next <= start) return false;
+  from = (uint32_t)start;
+  to = (uint32_t)next - 1;
+  return true;
+}
+
+// "level" as the numeric LogLevel or its name (debug/info/warn/error)
+static bool parseLogLevelArg(const String& arg, uint8_t& level) {
+  String v = arg;
+  v.toLowerCase();
+  if (v == "debug" || v == "0") level = LOG_LEVEL_DEBUG;
+  else if (v == "info" || v == "1") level = LOG_LEVEL_INFO;
+  else if (v == "warn" || v == "2") level = LOG_LEVEL_WARN;
+  else if (v == "error" || v == "3") level = LOG_LEVEL_ERROR;
+  else return false;
+  return true;
+}
+
+// ---- /api/events: Server-Sent Events push to the dashboard ----
+//
+// The dashboard used to poll /status, /api/led/event and /api/logs every
+// few seconds per open tab. Instead each tab keeps one connection open and
+// the device pushes what changed: new log lines ("log"), light / display /
+// night mode state ("light", "display", "night", from the same setter
+// notifications the MQTT state publisher uses) and the LED status event
+// ("led"). EventStreamHub caps the subscribers and queues per subscriber;
+// a slow one loses frames, gets "event: dropped" and reloads over REST.
+
+// One subscriber socket, taken over from the HTTP server with
+// server.client() (the WiFiClient handle is reference-counted); sends are
+// MSG_DONTWAIT so a full TCP window never blocks loop().
+class WiFiEventTransport : public EventStreamTransport {
+public:
+  explicit WiFiEventTransport(const WiFiClient& client) : client_(client) {}
+
+  int trySend(const uint8_t* data, size_t length) override {
+    int fd = client_.fd();
+    if (fd < 0) return -1;
+    int n = ::send(fd, data, length, MSG_DONTWAIT);
+    if (n >= 0) return n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+    return -1;
+  }
+
+  void close() override { client_.stop(); }
+
+private:
+  WiFiClient client_;
+};
+
+static EventStreamHub g_events;
+static uint32_t g_eventLogCursor = 0;
+// StateChange bits set by the setters, cleared when published
+static volatile uint8_t g_eventPending = 0;
+static LedEvent g_eventLed = LedEvent::FirmwareCheck;
+
+static void onStateChangedForEvents(StateChange change) {
+  g_eventPending |= (uint8_t)(1u << static_cast<uint8_t>(change));
+}
+
+static void publishEventJson(const char* event, JsonDocument& doc) {
+  char buf[512];
+  size_t n = serializeJson(doc, buf, sizeof(buf));
+  g_events.publish(event, buf, n);
+}
+
+static void publishLightEvent() {
+  JSON_SCOPE(json, "sse light");
+  JsonDocument doc(json.allocator());
+  buildLightState(doc.to<JsonObject>());
+  publishEventJson("light", doc);
+}
+
+static void publishDisplayEvent() {
+  JSON_SCOPE(json, "sse display");
+  JsonDocument doc(json.allocator());
+  buildDisplayState(doc.to<JsonObject>());
+  publishEventJson("display", doc);
+}
+
+static void publishNightEvent() {
+  JSON_SCOPE(json, "sse night");
+  JsonDocument doc(json.allocator());
+  buildNightModeConfig(doc.to<JsonObject>());
+  publishEventJson("night", doc);
+}
+
+static void publishLedEvent() {
+  JSON_SCOPE(json, "sse led");
+  JsonDocument doc(json.allocator());
+  doc["event"] = ledEventName(g_eventLed);
+  publishEventJson("led", doc);
+}
+
+static void publishLogLine(void*, const char* data, size_t length) {
+  g_events.publish("log", data, length);
+}
+
+// Called from loop(): publishes what changed since the last call and moves
+// queued bytes out to the sockets.
+void eventStreamService(unsigned long nowMs) {
+  if (!g_events.hasSubscribers()) {
+    // Nobody listening: keep up with the ring so a new subscriber starts
+    // at "now" rather than being flooded with the backlog
+    g_eventLogCursor = logCursor();
+    g_eventPending = 0;
+    return;
+  }
+  g_eventLogCursor = logReadSince(g_eventLogCursor, publishLogLine, nullptr);
+
+  uint8_t pending = g_eventPending;
+  g_eventPending = 0;
+  if (pending & (1u << static_cast<uint8_t>(StateChange::Light))) publishLightEvent();
+  if (pending & (1u << static_cast<uint8_t>(StateChange::Display))) publishDisplayEvent();
+  if (pending & (1u << static_cast<uint8_t>(StateChange::NightMode))) publishNightEvent();
+  LedEvent led = ledEventGetCurrent();
+  if (led != g_eventLed) {
+    g_eventLed = led;
+    publishLedEvent();
+  }
+  g_events.service(nowMs);
+}
+
+// ---- /api/state: everything the dashboard shows, in one document ----
+//
+// The ETag is a per-boot id plus stateGeneration(), which every setter bumps
+// through notifyStateChanged(), so an unchanged state costs a 304 and no
+// body. With ?wait=<seconds> a request whose If-None-Match is still current
+// is parked instead: stateWaitService() answers it from loop() as soon as
+// the generation moves, or with a 304 when the wait runs out.
+
+static const uint8_t STATE_WAIT_MAX_CLIENTS = 4;
+static const long STATE_WAIT_MAX_SEC = 30;
+
+struct StateWaiter {
+  WiFiClient client;
+  uint32_t generation = 0;
+  unsigned long sinceMs = 0;
+  unsigned long waitMs = 0;
+  bool active = false;
+};
+static StateWaiter g_stateWaiters[STATE_WAIT_MAX_CLIENTS];
+
+static void formatStateEtag(uint32_t generation, char* out, size_t cap) {
+  // Generations restart at 0 on every boot; the id keeps old tags from matching
+  static const uint32_t bootId = esp_random();
+  snprintf(out, cap, "\"%08lx-%lu\"", (unsigned long)bootId, (unsigned long)generation);
+}
+
+static void buildStateDocument(JsonDocument& doc, uint32_t generation) {
+  doc["generation"] = generation;
+  buildLightState(doc["light"].to<JsonObject>());
+  buildDisplayState(doc["display"].to<JsonObject>());
+  buildNightModeConfig(doc["night"].to<JsonObject>());
+  buildLanguageState(doc["language"].to<JsonObject>());
+  buildDialectState(doc["dialect"].to<JsonObject>());
+#if OTA_ENABLED
+  doc["update"]["running"] = is_update_running();
+#endif
+}
+
+// MSG_DONTWAIT, as WiFiEventTransport: loop() never waits on a parked
+// socket. False unless the socket took all of it.
+static bool sendParked(WiFiClient& client, const char* data, size_t length) {
+  int fd = client.fd();
+  if (fd < 0) return false;
+  int n = ::send(fd, data, length, MSG_DONTWAIT);
+  return n >= 0 && (size_t)n == length;
+}
+
+// Complete response written straight to a parked socket, which the HTTP
+// server no longer tracks. Its send buffer is empty, so a response this
+// size normally goes out whole; a peer that takes less is dropped, and the
+// dashboard polls again.
+static void answerStateWaiter(StateWaiter& waiter, bool changed) {
+  uint32_t gen = stateGeneration();
+  char etag[24];
+  formatStateEtag(gen, etag, sizeof(etag));
+  String head = changed ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 304 Not Modified\r\n";
+  head += "Cache-Control: no-cache\r\nETag: ";
+  head += etag;
+  head += "\r\nConnection: close\r\n";
+  if (changed) {
+    JSON_SCOPE(json, "long-poll /api/state");
+    JsonDocument doc(json.allocator());
+    buildStateDocument(doc, gen);
+    size_t length = measureJson(doc);
+    char* body = json.buffer(length + 1);
+    if (body) length = serializeJson(doc, body, length + 1);
+    head += "Content-Type: application/json\r\nContent-Length: ";
+    head += String((unsigned long)(body ? length : 0));
+    head += "\r\n\r\n";
+    if (sendParked(waiter.client, head.c_str(), head.length()) && body) sendParked(waiter.client, body, length);
   } else {
-    logWarn("Failed to open /logs directory for clearing");
+    head += "\r\n";
+    sendParked(waiter.client, head.c_str(), head.length());
+  }
+  waiter.client.stop();
+  waiter.client = WiFiClient();
+  waiter.active = false;
+}
+
+static bool parkStateWaiter(uint32_t generation, long waitSec) {
+  if (waitSec > STATE_WAIT_MAX_SEC) waitSec = STATE_WAIT_MAX_SEC;
+  for (StateWaiter& w : g_stateWaiters) {
+    if (w.active) continue;
+    // Our own copy keeps the socket open once the handler returns
+    w.client = server.client();
+    w.generation = generation;
+    w.sinceMs = millis();
+    w.waitMs = (unsigned long)waitSec * 1000UL;
+    w.active = true;
+    return true;
+  }
+  return false;
+}
+
+// Called from loop()
+void stateWaitService(unsigned long nowMs) {
+  uint32_t gen = stateGeneration();
+  for (StateWaiter& w : g_stateWaiters) {
+    if (!w.active) continue;
+    if (!w.client.connected()) {
+      w.client = WiFiClient();
+      w.active = false;
+    } else if (gen != w.generation) {
+      answerStateWaiter(w, true);
+    } else if (nowMs - w.sinceMs >= w.waitMs) {
+      answerStateWaiter(w, false);
+    }
   }
-  // Re-enable file sink (will recreate today's file if needed)
-  logEnableFileSink();
 }
 
 // Token for allowing factory reset from Forgot Password page
@@ -321,11 +912,12 @@ static String generateFactoryToken(unsigned long ttl_ms = 60000) {
 
 // Function to register all routes
 void setupWebRoutes() {
-  // WebServer discards every request header that is not named here, so
-  // If-None-Match must be collected or applyStaticCacheHeaders() would never
-  // see a conditional request and every revalidation would cost a full body.
+  // HttpServer keeps every header; the list still says which ones the
+  // routes rely on (WebServer used to discard the rest).
   static const char* headerKeys[] = { "Accept-Encoding", "If-None-Match" };
   server.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+  addStateChangeListener(onStateChangedForEvents);
+  scanAssetOverrides();
 
   // Helper defined at file scope: serveFile()
   // Main pages
@@ -469,13 +1061,6 @@ void setupWebRoutes() {
 
   // Public landing page: go straight to dashboard
   server.on("/", HTTP_GET, []() {
-    File f = FS_IMPL.open("/dashboard.html", "r");
-    if (!f) {
-      logError("[API] /: dashboard.html not found");
-      server.send(404, "text/plain", "dashboard.html not found");
-      return;
-    }
-    f.close();
     serveFile("/dashboard.html", "text/html");
   });
 
@@ -490,13 +1075,12 @@ void setupWebRoutes() {
   });
 
   server.on("/api/ble/status", HTTP_GET, []() {
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /api/ble/status");
+    JsonDocument doc(json.allocator());
     doc["active"] = isBleProvisioningActive();
     doc["state"] = getBleProvisioningState();
     doc["hardware_id"] = get_hardware_id();
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
 #if OTA_ENABLED
@@ -591,8 +1175,16 @@ void setupWebRoutes() {
   server.on("/api/mqtt/status", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
     bool c = mqtt_is_connected();
+    MqttOutboxStats q = mqtt_outbox_stats();
     String json = String("{\"connected\":") + (c ? "true" : "false") + 
-                  ",\"last_error\":\"" + mqtt_last_error() + "\"}";
+                  ",\"last_error\":\"" + mqtt_last_error() + "\"" +
+                  ",\"outbox\":{\"depth\":" + (unsigned long)q.depth +
+                  ",\"peak\":" + (unsigned long)q.peakDepth +
+                  ",\"capacity\":" + (unsigned long)q.capacity +
+                  ",\"queued\":" + (unsigned long)q.queued +
+                  ",\"dropped\":" + (unsigned long)q.dropped +
+                  ",\"coalesced\":" + (unsigned long)q.coalesced +
+                  ",\"last_drain_ms\":" + q.lastDrainMs + "}}";
     server.send(200, "application/json", json);
   });
 
@@ -684,13 +1276,12 @@ void setupWebRoutes() {
       logWarn("[API] /api/update/channel: Auth failed");
       return;
     }
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /api/update/channel");
+    JsonDocument doc(json.allocator());
     String channel = displaySettings.getUpdateChannel();
     doc["channel"] = channel;
     doc["default"] = "stable";
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
   server.on("/api/update/channel", HTTP_POST, []() {
@@ -699,7 +1290,8 @@ void setupWebRoutes() {
     if (server.hasArg("channel")) {
       ch = server.arg("channel");
     } else if (server.hasArg("plain")) {
-      JsonDocument doc;
+      JSON_SCOPE(json, "POST /api/update/channel body");
+      JsonDocument doc(json.allocator());
       DeserializationError err = deserializeJson(doc, server.arg("plain"));
       if (!err && doc["channel"].is<const char*>()) {
         ch = String(doc["channel"].as<const char*>());
@@ -712,12 +1304,11 @@ void setupWebRoutes() {
     }
     displaySettings.setUpdateChannel(ch);
     mqtt_publish_state(true);
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /api/update/channel");
+    JsonDocument doc(json.allocator());
     doc["channel"] = displaySettings.getUpdateChannel();
     doc["default"] = "stable";
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 #endif
 
@@ -731,72 +1322,31 @@ void setupWebRoutes() {
       logWarn("[API] /log: Auth failed");
       return;
     }
-    String logContent = "";
-    int i = logIndex;
-    int lineCount = 0;
-    for (int count = 0; count < LOG_BUFFER_SIZE; count++) {
-      String line = logBuffer[i];
-      if (line.length() > 0) {
-        logContent += line + "\n";
-        lineCount++;
-      }
-      i = (i + 1) % LOG_BUFFER_SIZE;
-    }
+    String logContent = logRecentText();
     server.send(200, "text/plain", logContent);
   });
 
   server.on("/api/logs", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
     logFlushFile();
-    struct LogItem {
-      String name;
-      size_t size;
-      String date;
-    };
-    // Deduplicate by date: keep the largest file per date
-    std::vector<LogItem> items;
-    std::map<String, LogItem, std::greater<String>> bestByDate;
-    File dir = FS_IMPL.open("/logs");
-    if (dir) {
-      while (true) {
-        File entry = dir.openNextFile();
-        if (!entry) break;
-        if (!entry.isDirectory()) {
-          String name = entry.name();
-          size_t size = entry.size();
-          String shortName = name;
-          if (shortName.startsWith("/")) shortName = shortName.substring(1);
-          if (shortName.startsWith("logs/")) shortName = shortName.substring(5);
-          String date = shortName;
-          int dot = date.lastIndexOf('.');
-          if (dot > 0) date = date.substring(0, dot);
-          LogItem item;
-          item.name = shortName.length() ? shortName : name;
-          item.size = size;
-          item.date = date;
-          auto it = bestByDate.find(date);
-          if (it == bestByDate.end() || size > it->second.size) {
-            bestByDate[date] = item;
-          }
-        }
-        entry.close();
-      }
-      dir.close();
-    }
-    for (const auto& kv : bestByDate) {
-      items.push_back(kv.second);
-    }
-    JsonDocument doc;
+    // One entry per local day, newest first, straight from the segment index
+    JSON_SCOPE(json, "GET /api/logs");
+    JsonDocument doc(json.allocator());
     JsonArray arr = doc.to<JsonArray>();
-    for (const auto& item : items) {
+    logListDays([](void* ctx, const char* date, uint32_t bytes) {
+      JsonObject o = static_cast<JsonArray*>(ctx)->add<JsonObject>();
+      o["name"] = String(date) + ".log";
+      o["size"] = bytes;
+      o["date"] = date;
+    }, &arr);
+    LogStoreStats store = logStoreStats();
+    if (store.unsyncedBytes > 0) {
       JsonObject o = arr.add<JsonObject>();
-      o["name"] = item.name;
-      o["size"] = item.size;
-      o["date"] = item.date;
+      o["name"] = "unsynced.log";
+      o["size"] = store.unsyncedBytes;
+      o["date"] = "unsynced";
     }
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
   // Logs summary
@@ -806,55 +1356,58 @@ void setupWebRoutes() {
       return;
     }
     logFlushFile();
-    // Deduplicate per date: keep the largest file for each date to match the list view
-    size_t total = 0;
-    size_t count = 0;
-    std::map<String, size_t, std::greater<String>> bestByDate;
-    File dir = FS_IMPL.open("/logs");
-    if (dir) {
-      while (true) {
-        File entry = dir.openNextFile();
-        if (!entry) break;
-        if (!entry.isDirectory()) {
-          String shortName = entry.name();
-          if (shortName.startsWith("/")) shortName = shortName.substring(1);
-          if (shortName.startsWith("logs/")) shortName = shortName.substring(5);
-          String date = shortName;
-          int dot = date.lastIndexOf('.');
-          if (dot > 0) date = date.substring(0, dot);
-          size_t sz = entry.size();
-          auto it = bestByDate.find(date);
-          if (it == bestByDate.end() || sz > it->second) {
-            bestByDate[date] = sz;
-          }
-        }
-        entry.close();
-      }
-      dir.close();
-    } else {
-      logWarn("[API] /api/logs/summary: Failed to open /logs directory");
+    LogStoreStats store = logStoreStats();
+    size_t days = logListDays([](void*, const char*, uint32_t) {}, nullptr);
+    JSON_SCOPE(json, "GET /api/logs/summary");
+    JsonDocument doc(json.allocator());
+    doc["total_bytes"] = store.bytes + store.unsyncedBytes;
+    doc["count"] = (uint32_t)(days + (store.unsyncedBytes > 0 ? 1 : 0));
+    JsonObject storeObj = doc["store"].to<JsonObject>();
+    storeObj["segments"] = store.segments;
+    storeObj["bytes"] = store.bytes;
+    storeObj["quota_bytes"] = store.quotaBytes;
+    storeObj["unsynced_bytes"] = store.unsyncedBytes;
+    storeObj["segments_removed"] = store.segmentsRemoved;
+    LogSinkStats sink = logSinkStats();
+    JsonObject sinkObj = doc["sink"].to<JsonObject>();
+    sinkObj["written"] = sink.written;
+    sinkObj["dropped"] = sink.dropped;
+    sinkObj["batches"] = sink.batches;
+    sinkObj["flushes"] = sink.flushes;
+    sinkObj["backlog"] = sink.backlog;
+    sendJson(json, doc);
+  });
+
+  // Stored lines by time range and level; the index lets the store skip
+  // segments and seek inside them, so a narrow window reads little flash.
+  server.on("/api/logs/query", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    uint8_t level = LOG_LEVEL_DEBUG;
+    if (server.hasArg("from")) from = (uint32_t)strtoul(server.arg("from").c_str(), nullptr, 10);
+    if (server.hasArg("to")) to = (uint32_t)strtoul(server.arg("to").c_str(), nullptr, 10);
+    if (server.hasArg("level") && !parseLogLevelArg(server.arg("level"), level)) {
+      server.send(400, "text/plain", "Invalid log level");
+      return;
     }
-    for (const auto& kv : bestByDate) {
-      total += kv.second;
-      count++;
+    if (from > to) {
+      server.send(400, "text/plain", "from is after to");
+      return;
     }
-    JsonDocument doc;
-    doc["total_bytes"] = (uint32_t)total;
-    doc["count"] = (uint32_t)count;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    logFlushFile();
+    LogBodySource::send(std::unique_ptr<LogBodySource>(new LogBodySource(from, to, level)), nullptr);
   });
 
   server.on("/api/logs/settings", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /api/logs/settings");
+    JsonDocument doc(json.allocator());
     doc["retention_days"] = getLogRetentionDays();
     doc["delete_on_boot"] = getLogDeleteOnBoot();
     doc["level"] = (uint8_t)LOG_LEVEL;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    doc["compiled_min_level"] = LOG_COMPILE_MIN_LEVEL;
+    sendJson(json, doc);
   });
 
   server.on("/api/logs/settings", HTTP_POST, []() {
@@ -873,18 +1426,18 @@ void setupWebRoutes() {
 
   server.on("/buildinfo", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /buildinfo");
+    JsonDocument doc(json.allocator());
     doc["firmware"] = FIRMWARE_VERSION;
     doc["ui"] = getUiVersion();
+    doc["ui_bundle"] = kEmbeddedBundleId;
     doc["git_sha"] = BUILD_GIT_SHA;
     doc["git_branch"] = BUILD_GIT_BRANCH;
     doc["build_time_utc"] = BUILD_TIME_UTC;
     doc["environment"] = BUILD_ENV_NAME;
     doc["ui_sync_supported"] = (SUPPORT_OTA_V2 == 0);
     doc["ota_enabled"] = (bool)OTA_ENABLED;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
   server.on("/api/device/info", HTTP_GET, []() {
@@ -903,7 +1456,8 @@ void setupWebRoutes() {
     char upBuf[32];
     snprintf(upBuf, sizeof(upBuf), "%lud %02lu:%02lu:%02lu", days, hours, mins, secs);
 
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /api/device/info");
+    JsonDocument doc(json.allocator());
     doc["uptime_ms"] = millis();
     doc["uptime_human"] = upBuf;
     doc["heap_free"] = ESP.getFreeHeap();
@@ -931,9 +1485,7 @@ void setupWebRoutes() {
 #if defined(ARDUINO_ARCH_ESP32)
     doc["temp_c"] = temperatureRead();
 #endif
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
   // ---------------------------------------------------------------------
@@ -946,19 +1498,10 @@ void setupWebRoutes() {
   // dialect only swaps the phrase table and takes effect immediately.
   server.on("/api/language", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
-    JsonDocument doc;
-    doc["active"] = LanguageSettings::activeLanguage();
-    doc["stored"] = LanguageSettings::storedLanguage();
-    doc["source"] = LanguageSettings::sourceName();
-    doc["setupComplete"] = LanguageSettings::isSetupComplete();
-    doc["rebootRequired"] = LanguageSettings::rebootRequired();
-    JsonArray available = doc["available"].to<JsonArray>();
-    for (size_t i = 0; i < getLanguageCount(); ++i) {
-      available.add(getLanguageCode(i));
-    }
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    JSON_SCOPE(json, "GET /api/language");
+    JsonDocument doc(json.allocator());
+    buildLanguageState(doc.to<JsonObject>());
+    sendJson(json, doc);
   });
 
   server.on("/api/language", HTTP_POST, []() {
@@ -973,13 +1516,12 @@ void setupWebRoutes() {
       return;
     }
     const bool reboot = LanguageSettings::rebootRequired();
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /api/language");
+    JsonDocument doc(json.allocator());
     doc["stored"] = LanguageSettings::storedLanguage();
     doc["source"] = LanguageSettings::sourceName();
     doc["rebootRequired"] = reboot;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
     if (reboot) {
       delay(100);  // let the response leave before the radio goes down
       safeRestart();
@@ -988,37 +1530,10 @@ void setupWebRoutes() {
 
   server.on("/api/dialect", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
-    JsonDocument doc;
-    doc["active"] = LanguageSettings::activeDialect();
-    JsonArray available = doc["available"].to<JsonArray>();
-    for (size_t i = 0; i < getDialectCount(); ++i) {
-      const ClockDialect* d = getDialect(i);
-      if (!d) continue;
-      JsonObject item = available.add<JsonObject>();
-      item["id"] = d->id;
-      item["label"] = d->label;
-      item["sample"] = d->sample;
-    }
-    // Axes, when the variant has them. A client that ignores this key still
-    // works off `available` exactly as before — which is what keeps older
-    // dashboards (and Home Assistant) functioning against new firmware.
-    for (size_t i = 0; i < getDialectAxisCount(); ++i) {
-      const DialectAxis* axis = getDialectAxis(i);
-      if (!axis) continue;
-      JsonObject a = doc["axes"].add<JsonObject>();
-      a["id"] = axis->id;
-      a["label"] = axis->label;
-      a["active"] = getActiveDialectAxisValue(axis->id);
-      for (size_t o = 0; o < axis->optionCount; ++o) {
-        JsonObject opt = a["options"].add<JsonObject>();
-        opt["value"] = axis->options[o].value;
-        opt["label"] = axis->options[o].label;
-        opt["sample"] = axis->options[o].sample;
-      }
-    }
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    JSON_SCOPE(json, "GET /api/dialect");
+    JsonDocument doc(json.allocator());
+    buildDialectState(doc.to<JsonObject>());
+    sendJson(json, doc);
   });
 
   server.on("/api/dialect", HTTP_POST, []() {
@@ -1050,16 +1565,15 @@ void setupWebRoutes() {
       server.send(400, "text/plain", "Unknown dialect for active language: " + id);
       return;
     }
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /api/dialect");
+    JsonDocument doc(json.allocator());
     doc["active"] = LanguageSettings::activeDialect();
     for (size_t i = 0; i < getDialectAxisCount(); ++i) {
       const DialectAxis* axis = getDialectAxis(i);
       if (!axis) continue;
       doc["axes"][axis->id] = getActiveDialectAxisValue(axis->id);
     }
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
   server.on("/api/device/register", HTTP_POST, []() {
@@ -1071,22 +1585,20 @@ void setupWebRoutes() {
       server.send(502, "text/plain", err);
       return;
     }
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /api/device/register");
+    JsonDocument doc(json.allocator());
     doc["deviceId"] = deviceId;
     doc["token"] = token;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 
 #if OTA_ENABLED
   server.on("/api/update/status", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /api/update/status");
+    JsonDocument doc(json.allocator());
     doc["running"] = is_update_running();
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
   });
 #endif
 
@@ -1096,55 +1608,228 @@ void setupWebRoutes() {
   // unauthenticated so the polling JS can distinguish "device offline" from
   // "needs credentials". Returns nothing sensitive (version + product id).
   server.on("/api/firmware/identity", HTTP_GET, []() {
-    JsonDocument doc;
+    JSON_SCOPE(json, "GET /api/firmware/identity");
+    JsonDocument doc(json.allocator());
     doc["role"] = "product";
     doc["firmware"] = FIRMWARE_VERSION;
     doc["ui"] = UI_VERSION;
     doc["product_id"] = PRODUCT_ID;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    sendJson(json, doc);
+  });
+
+  // Arena use per JSON call site since boot, for sizing JSON_ARENA_BYTES and
+  // the private arenas. A site with spilled_calls outgrew its arena; one
+  // with heap_calls found the shared arena held by another task.
+  server.on("/api/perf/json", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    JSON_SCOPE(json, "GET /api/perf/json");
+    JsonDocument doc(json.allocator());
+    const JsonArena& shared = jsonSharedArena();
+    JsonObject arena = doc["shared"].to<JsonObject>();
+    arena["capacity"] = shared.capacity();
+    arena["high_water"] = shared.highWater();
+    arena["spills"] = shared.spills();
+    arena["psram"] = shared.external();
+    JsonArray sites = doc["sites"].to<JsonArray>();
+    for (const JsonArenaSite* s = JsonArenaSite::first(); s; s = s->next()) {
+      JsonObject o = sites.add<JsonObject>();
+      o["site"] = s->name();
+      o["calls"] = s->calls();
+      o["peak_bytes"] = s->peakBytes();
+      o["spilled_calls"] = s->spilledCalls();
+      o["heap_calls"] = s->heapCalls();
+    }
+    sendJson(json, doc);
+  });
+
+  // Heap churn: realloc() calls (String growth, ArduinoJson) since boot and
+  // per second since the previous request, plus FixedStrings that were cut off
+  server.on("/api/perf/strings", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    static ReallocMeter meter;
+    JSON_SCOPE(json, "GET /api/perf/strings");
+    JsonDocument doc(json.allocator());
+    doc["realloc_calls"] = reallocCount();
+    doc["per_sec"] = meter.perSecond(millis());
+    doc["fixed_truncations"] = fixedStringTruncations();
+    doc["free_heap"] = ESP.getFreeHeap();
+    doc["min_free_heap"] = ESP.getMinFreeHeap();
+    sendJson(json, doc);
+  });
+
+  // Flash wear from settings: batched NVS commits and the entry bytes they
+  // wrote, since boot and per 24 h window; plus how boot read them
+  server.on("/api/perf/settings", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    SettingsStoreStats st = settingsStore.stats(millis());
+    JSON_SCOPE(json, "GET /api/perf/settings");
+    JsonDocument doc(json.allocator());
+    doc["commits"] = st.commits;
+    doc["keys_written"] = st.keysWritten;
+    doc["bytes_written"] = st.bytesWritten;
+    doc["commits_day"] = st.commitsDay;
+    doc["bytes_day"] = st.bytesDay;
+    doc["commits_prev_day"] = st.commitsPrevDay;
+    doc["bytes_prev_day"] = st.bytesPrevDay;
+    doc["failures"] = st.failures;
+    doc["keys"] = st.keys;
+    doc["pending"] = st.pending;
+    doc["overflows"] = st.overflows;
+    doc["snapshot_loaded"] = st.snapshotLoaded;
+    doc["snapshot_hits"] = st.snapshotHits;
+    doc["load_us"] = st.loadUs;
+    sendJson(json, doc);
+  });
+
+  // Where this boot's time went: every boot step with its start and
+  // duration (background steps overlap the others), the milestones, and the
+  // boot before this one as kept in RTC memory. stuck_in names the step that
+  // boot reset during; clock says whether the time came over a warm restart.
+  server.on("/api/perf/boot", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    JSON_SCOPE(json, "GET /api/perf/boot");
+    JsonDocument doc(json.allocator());
+    auto addTimeline = [](JsonObject out, const BootTimeline& t) {
+      out["boot_count"] = t.bootCount;
+      JsonArray phases = out["phases"].to<JsonArray>();
+      for (uint8_t p = 0; p < BOOT_PHASE_COUNT; ++p) {
+        if (!(t.ran & (1u << p))) continue;
+        JsonObject o = phases.add<JsonObject>();
+        o["phase"] = bootPhaseName(p);
+        o["start_us"] = t.startUs[p];
+        if (t.phaseOpen(p)) {
+          o["open"] = true;
+        } else {
+          o["duration_us"] = t.durationUs[p];
+        }
+      }
+      JsonObject marks = out["milestones_ms"].to<JsonObject>();
+      for (uint8_t m = 0; m < BOOT_MILESTONE_COUNT; ++m) {
+        if (t.milestoneMs[m]) marks[bootMilestoneName(m)] = t.milestoneMs[m];
+      }
+    };
+    addTimeline(doc["current"].to<JsonObject>(), bootTimeline());
+    const BootTimeline* previous = previousBootTimeline();
+    if (previous) {
+      JsonObject prev = doc["previous"].to<JsonObject>();
+      addTimeline(prev, *previous);
+      if (previousBootIncomplete()) prev["stuck_in"] = bootPhaseName(previous->stuckPhase());
+    } else {
+      doc["previous"] = nullptr;
+    }
+    doc["reset_reason"] = (int)esp_reset_reason();
+    JsonObject clock = doc["clock"].to<JsonObject>();
+    clock["confidence"] = timeConfidenceName(timeConfidence());
+    clock["restored"] = timeWasRestored();
+    clock["drift_ppm"] = timeDriftPpm();
+    sendJson(json, doc);
+  });
+
+  // Latency per loop() stage and per LED data line since boot, in us:
+  // p50/p90/p99/p999 (bucket tops, within 25 %), mean and max. `http` is the
+  // time route handlers hold loop() off. ?reset=1 starts them over.
+  server.on("/api/perf/loop", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    JSON_SCOPE(json, "GET /api/perf/loop");
+    JsonDocument doc(json.allocator());
+    auto addHistogram = [](JsonObject o, const LatencyHistogram& h) {
+      o["count"] = h.count();
+      o["p50"] = h.percentile(500);
+      o["p90"] = h.percentile(900);
+      o["p99"] = h.percentile(990);
+      o["p999"] = h.percentile(999);
+      o["mean"] = h.meanUs();
+      o["max"] = h.maxUs();
+    };
+    JsonObject stages = doc["stages"].to<JsonObject>();
+    for (uint8_t i = 0; i < LOOP_STAGE_COUNT; ++i) {
+      LoopStage stage = static_cast<LoopStage>(i);
+      addHistogram(stages[loopStageName(stage)].to<JsonObject>(), loopStageHistogram(stage));
+    }
+    JsonArray show = doc["show"].to<JsonArray>();
+    for (uint8_t s = 0; s < LOOP_SHOW_SEGMENTS; ++s) {
+      const LatencyHistogram& h = loopShowHistogram(s);
+      if (h.count() == 0) continue;
+      JsonObject o = show.add<JsonObject>();
+      o["segment"] = s;
+      addHistogram(o, h);
+    }
+    doc["uptime_ms"] = millis();
+    if (server.hasArg("reset") && server.arg("reset") == "1") loopProfileReset();
+    sendJson(json, doc);
+  });
+
+  // Internal heap shape, always: free bytes, the largest free block and how
+  // splintered the rest is. With HEAP_TRACKING builds also who allocates:
+  // per tag since boot and per second since the previous request.
+  server.on("/api/perf/heap", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    static HeapTagMeter meter;
+    // Read before the JSON document takes its own memory
+    size_t freeInternal = heapInternalFree();
+    size_t largest = heapLargestFreeBlock();
+    JSON_SCOPE(json, "GET /api/perf/heap");
+    JsonDocument doc(json.allocator());
+    doc["free_internal"] = freeInternal;
+    doc["largest_free_block"] = largest;
+    doc["fragmentation_pct"] = heapFragmentationPct(freeInternal, largest);
+    doc["free_heap"] = ESP.getFreeHeap();
+    doc["min_free_heap"] = ESP.getMinFreeHeap();
+    doc["tracking"] = heapTrackingEnabled();
+    if (heapTrackingEnabled()) {
+      float perSec[HEAP_TAG_COUNT];
+      meter.perSecond(millis(), perSec);
+      JsonObject tags = doc["tags"].to<JsonObject>();
+      for (uint8_t i = 0; i < HEAP_TAG_COUNT; ++i) {
+        HeapTag tag = static_cast<HeapTag>(i);
+        HeapTagStats st = heapTagStats(tag);
+        JsonObject o = tags[heapTagName(tag)].to<JsonObject>();
+        o["allocs"] = st.allocs;
+        o["bytes"] = st.bytes;
+        o["failures"] = st.failures;
+        o["largest"] = st.largest;
+        o["per_sec"] = perSec[i];
+      }
+      HeapTotals totals = heapTotals();
+      doc["allocs"] = totals.allocs;
+      doc["frees"] = totals.frees;
+      doc["net_bytes"] = (int32_t)(totals.bytes - totals.freedBytes);
+      doc["scope_misses"] = totals.scopeMisses;
+    }
+    sendJson(json, doc);
   });
 
   server.on("/log/download", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
     logFlushFile();
-    String path;
+    String date;
     if (server.hasArg("date")) {
-      String date = server.arg("date");
-      bool valid = (date.length() == 10 &&
-                    isdigit(date[0]) && isdigit(date[1]) && isdigit(date[2]) && isdigit(date[3]) &&
-                    date[4] == '-' &&
-                    isdigit(date[5]) && isdigit(date[6]) &&
-                    date[7] == '-' &&
-                    isdigit(date[8]) && isdigit(date[9]));
-      if (!valid) {
-        server.send(400, "text/plain", "Invalid date format");
-        return;
-      }
-      path = String("/logs/") + date + ".log";
+      date = server.arg("date");
     } else {
-      path = logLatestFilePath();
-      if (path.length() == 0) {
-        server.send(404, "text/plain", "No log files available");
+      // Latest day with lines, else whatever was logged before the clock synced
+      logListDays([](void* ctx, const char* d, uint32_t) {
+        String* latest = static_cast<String*>(ctx);
+        if (latest->length() == 0) *latest = d;
+      }, &date);
+      if (date.length() == 0) date = "unsynced";
+    }
+    if (date == "unsynced") {
+      if (logStoreStats().unsyncedBytes == 0) {
+        server.send(404, "text/plain", "Log file not found");
         return;
       }
-      if (!path.startsWith("/")) {
-        path = "/" + path;
-      }
-      if (!path.startsWith("/logs/")) {
-        path = String("/logs/") + path;
-      }
+      LogBodySource::send(std::unique_ptr<LogBodySource>(new LogBodySource()), "unsynced.log");
+      return;
     }
-    File f = FS_IMPL.open(path, "r");
-    if (!f) {
-      server.send(404, "text/plain", "Log file not found");
+    uint32_t from = 0;
+    uint32_t to = 0;
+    if (!localDayBounds(date, from, to)) {
+      server.send(400, "text/plain", "Invalid date format");
       return;
     }
-    String filename = path.substring(path.lastIndexOf('/') + 1);
-    server.sendHeader("Content-Disposition", String("attachment; filename=\"") + filename + "\"");
-    server.streamFile(f, "text/plain");
-    f.close();
+    String filename = date + ".log";
+    LogBodySource::send(std::unique_ptr<LogBodySource>(new LogBodySource(from, to, LOG_LEVEL_DEBUG)),
+                        filename.c_str());
   });
 
   // Get status
@@ -1157,32 +1842,73 @@ void setupWebRoutes() {
     server.send(200, "text/plain", status);
   });
 
+  // Live push of logs, state and LED events (see eventStreamService)
+  server.on("/api/events", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    if (g_events.subscriberCount() >= EVENT_STREAM_MAX_CLIENTS) {
+      server.sendHeader("Retry-After", "10");
+      server.send(503, "text/plain", "Too many event subscribers");
+      return;
+    }
+    // Headers by hand on the taken-over socket: the response stays open
+    WiFiClient client = server.client();
+    client.print("HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/event-stream\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Connection: keep-alive\r\n\r\n");
+    if (!g_events.subscribe(std::unique_ptr<EventStreamTransport>(new WiFiEventTransport(client)), millis())) {
+      return;
+    }
+    // Current state for the newcomer (the others just see it again)
+    g_eventLed = ledEventGetCurrent();
+    publishLightEvent();
+    publishDisplayEvent();
+    publishNightEvent();
+    publishLedEvent();
+  });
+
+  // Aggregated UI state with a generation ETag and optional long-poll
+  server.on("/api/state", HTTP_GET, []() {
+    if (!ensureUiAuth()) return;
+    uint32_t gen = stateGeneration();
+    char etag[24];
+    formatStateEtag(gen, etag, sizeof(etag));
+    if (server.header("If-None-Match") == etag) {
+      long waitSec = server.hasArg("wait") ? server.arg("wait").toInt() : 0;
+      // Parked: no response here (headers set now would leak into the next one)
+      if (waitSec > 0 && parkStateWaiter(gen, waitSec)) return;
+      if (waitSec > 0) {
+        server.sendHeader("Retry-After", "5");
+        server.send(503, "text/plain", "Too many waiting requests");
+        return;
+      }
+      server.sendHeader("Cache-Control", "no-cache");
+      server.sendHeader("ETag", etag);
+      server.send(304, "text/plain", "");
+      return;
+    }
+    JSON_SCOPE(json, "GET /api/state");
+    JsonDocument doc(json.allocator());
+    buildStateDocument(doc, gen);
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("ETag", etag);
+    sendJson(json, doc);
+  });
+
   // Current LED status event (for dashboard)
   server.on("/api/led/event", HTTP_GET, []() {
     if (!ensureUiAuth()) return;
-    LedEvent e = ledEventGetCurrent();
-    const char* name = "FirmwareCheck";
-    switch (e) {
-      case LedEvent::FirmwareCheck:         name = "FirmwareCheck"; break;
-      case LedEvent::FirmwareAvailable:    name = "FirmwareAvailable"; break;
-      case LedEvent::FirmwareDownloading:   name = "FirmwareDownloading"; break;
-      case LedEvent::FirmwareApplying:     name = "FirmwareApplying"; break;
-      case LedEvent::NtpFailed:             name = "NtpFailed"; break;
-      case LedEvent::MqttDisconnected:      name = "MqttDisconnected"; break;
-      case LedEvent::BleProvisioning:      name = "BleProvisioning"; break;
-      case LedEvent::WifiManagerPortal:    name = "WifiManagerPortal"; break;
-    }
-    JsonDocument doc;
-    doc["event"] = name;
-    String out;
-    serializeJson(doc, out);
-    server.send(200, "application/json", out);
+    JSON_SCOPE(json, "GET /api/led/event");
+    JsonDocument doc(json.allocator());
+    doc["event"] = ledEventName(ledEventGetCurrent());
+    sendJson(json, doc);
   });
 
 #if defined(PRODUCT_VARIANT_LOGO)
   server.on("/api/diag/led", HTTP_POST, []() {
     if (!ensureUiAuth()) return;
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /api/diag/led");
+    JsonDocument doc(json.allocator());
     DeserializationError err = deserializeJson(doc, server.arg("plain"));
     if (err) { server.send(400, "text/plain", "Invalid JSON"); return; }
     JsonArray arr = doc["indices"].as<JsonArray>();
@@ -1217,7 +1943,11 @@ void setupWebRoutes() {
   server.on("/toggle", []() {
     if (!ensureUiAuth()) return;
     String state = server.arg("state");
-    clockEnabled = (state == "on");
+    bool on = (state == "on");
+    if (on != clockEnabled) {
+      clockEnabled = on;
+      notifyStateChanged(StateChange::Light);
+    }
     // Apply immediately
     if (clockEnabled) {
       struct tm timeinfo;
@@ -1532,7 +2262,8 @@ void setupWebRoutes() {
       server.send(400, "text/plain", "Missing body");
       return;
     }
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /logo/state");
+    JsonDocument doc(json.allocator());
     DeserializationError err = deserializeJson(doc, server.arg("plain"));
     if (err) {
       server.send(400, "text/plain", "Invalid JSON");
@@ -1668,7 +2399,8 @@ void setupWebRoutes() {
       server.send(400, "text/plain", "Missing body");
       return;
     }
-    JsonDocument doc;
+    JSON_SCOPE(json, "POST /setNightModeConfig");
+    JsonDocument doc(json.allocator());
     DeserializationError err = deserializeJson(doc, server.arg("plain"));
     if (err) {
       server.send(400, "text/plain", "Invalid JSON");
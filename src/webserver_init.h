@@ -1,13 +1,14 @@
 #pragma once
 
-#include <WebServer.h>
+#include "http_server.h"
 #include "web_routes.h"
 #include "log.h"
 
 // Initialize webserver and routes
 // This function registers all webserver endpoints and starts the webserver.
-// Ensures the UI and API are accessible over the network.
-inline void initWebServer(WebServer& server) {
+// Ensures the UI and API are accessible over the network. Routes must all be
+// registered before begin(), which starts the server task.
+inline void initWebServer(HttpServer& server) {
     setupWebRoutes();
     server.begin();
     logInfo("🟢 Webserver started and routes activated");
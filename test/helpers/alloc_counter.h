@@ -0,0 +1,51 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Counts global operator new calls so a test can assert that a code path does
+// not touch the heap. Replacing operator new is program-wide, so include this
+// from exactly one translation unit (every test here is a single .cpp anyway).
+//
+// Usage:
+//   AllocCounter counter;
+//   codeUnderTest();
+//   EXPECT_EQ(0u, counter.allocations());
+
+namespace alloc_counter_detail {
+inline size_t& allocations() { static size_t n = 0; return n; }
+inline size_t& bytes() { static size_t n = 0; return n; }
+}
+
+class AllocCounter {
+public:
+    AllocCounter()
+        : startAllocs_(alloc_counter_detail::allocations()),
+          startBytes_(alloc_counter_detail::bytes()) {}
+
+    size_t allocations() const { return alloc_counter_detail::allocations() - startAllocs_; }
+    size_t bytes() const { return alloc_counter_detail::bytes() - startBytes_; }
+
+private:
+    size_t startAllocs_;
+    size_t startBytes_;
+};
+
+inline void* alloc_counter_new(std::size_t size) {
+    alloc_counter_detail::allocations()++;
+    alloc_counter_detail::bytes() += size;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) { return alloc_counter_new(size); }
+void* operator new[](std::size_t size) { return alloc_counter_new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif // ALLOC_COUNTER_H
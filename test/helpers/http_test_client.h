@@ -0,0 +1,188 @@
+#ifndef HTTP_TEST_CLIENT_H
+#define HTTP_TEST_CLIENT_H
+
+// Blocking loopback HTTP/1.1 client for the server tests, plus a thread
+// that keeps a server polling while a test talks to it.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace httptest {
+
+struct Response {
+    int status = 0;  // 0: no (complete) response
+    std::string head;
+    std::string body;
+
+    // First value of a header, or "" (names compared case-insensitively)
+    std::string header(const std::string& name) const {
+        std::string lowerHead = lower(head);
+        std::string key = "\r\n" + lower(name) + ":";
+        size_t at = lowerHead.find(key);
+        if (at == std::string::npos) return "";
+        size_t start = at + key.size();
+        size_t end = head.find("\r\n", start);
+        std::string value = head.substr(start, end - start);
+        value.erase(0, value.find_first_not_of(' '));
+        return value;
+    }
+
+    static std::string lower(std::string s) {
+        for (char& c : s) c = (char)tolower((unsigned char)c);
+        return s;
+    }
+};
+
+class Client {
+public:
+    explicit Client(uint16_t port, int timeoutMs = 3000) {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        timeval tv{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (connect(fd_, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+    ~Client() { close(); }
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    bool connected() const { return fd_ >= 0; }
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool send(const std::string& data) {
+        size_t at = 0;
+        while (at < data.size()) {
+            ssize_t n = ::send(fd_, data.data() + at, data.size() - at, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            at += (size_t)n;
+        }
+        return true;
+    }
+
+    /** One response; interim 100 Continue responses are counted and skipped. */
+    Response read(bool headRequest = false) {
+        Response r;
+        while (true) {
+            size_t end;
+            while ((end = buf_.find("\r\n\r\n")) == std::string::npos) {
+                if (!fill()) return r;
+            }
+            r.head = buf_.substr(0, end + 2);
+            buf_.erase(0, end + 4);
+            r.status = std::atoi(r.head.c_str() + 9);
+            if (r.status != 100) break;
+            continues++;
+        }
+        if (headRequest || r.status == 204 || r.status == 304) return r;
+
+        if (Response::lower(r.header("Transfer-Encoding")) == "chunked") {
+            while (true) {
+                size_t eol;
+                while ((eol = buf_.find("\r\n")) == std::string::npos) {
+                    if (!fill()) return Response();
+                }
+                size_t size = std::strtoul(buf_.c_str(), nullptr, 16);
+                buf_.erase(0, eol + 2);
+                while (buf_.size() < size + 2) {
+                    if (!fill()) return Response();
+                }
+                r.body.append(buf_, 0, size);
+                buf_.erase(0, size + 2);
+                if (size == 0) return r;
+            }
+        }
+        std::string length = r.header("Content-Length");
+        if (!length.empty()) {
+            size_t n = std::strtoul(length.c_str(), nullptr, 10);
+            while (buf_.size() < n) {
+                if (!fill()) return Response();
+            }
+            r.body = buf_.substr(0, n);
+            buf_.erase(0, n);
+            return r;
+        }
+        while (fill()) {
+        }
+        r.body.swap(buf_);
+        return r;
+    }
+
+    /** The server closed the connection (and sent nothing more). */
+    bool peerClosed() {
+        char c;
+        return buf_.empty() && recv(fd_, &c, 1, 0) == 0;
+    }
+
+    int fd() const { return fd_; }
+    int continues = 0;
+
+private:
+    bool fill() {
+        char chunk[4096];
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buf_.append(chunk, (size_t)n);
+        return true;
+    }
+
+    int fd_ = -1;
+    std::string buf_;
+};
+
+inline Response fetch(uint16_t port, const std::string& request, bool headRequest = false) {
+    Client c(port);
+    if (!c.send(request)) return Response();
+    return c.read(headRequest);
+}
+
+/** Polls `condition` until it holds or `timeoutMs` passes; the server thread updates state after the client sees its bytes. */
+inline bool eventually(const std::function<bool()>& condition, int timeoutMs = 1000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return true;
+}
+
+/** Calls `poll` in a loop on its own thread until destroyed. */
+class PollThread {
+public:
+    explicit PollThread(std::function<void()> poll)
+        : thread_([this, poll]() {
+              while (!stop_) poll();
+          }) {}
+    ~PollThread() {
+        stop_ = true;
+        thread_.join();
+    }
+
+private:
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+}  // namespace httptest
+
+#endif // HTTP_TEST_CLIENT_H
@@ -0,0 +1,258 @@
+#ifndef MOCK_FS_H
+#define MOCK_FS_H
+
+// In-memory filesystem with the subset of the Arduino FS/File API the
+// firmware uses. Files are shared between handles, so a reader sees what a
+// writer appended. Counters let tests assert on read/write/flush traffic.
+
+#include "mock_arduino.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace mockfs {
+
+struct Node {
+    std::string data;
+    time_t lastWrite = 0;
+};
+
+struct Stats {
+    size_t opens = 0;
+    size_t writeCalls = 0;
+    size_t bytesWritten = 0;
+    size_t flushCalls = 0;
+    size_t bytesRead = 0;
+};
+
+struct State {
+    std::map<std::string, std::shared_ptr<Node>> files;
+    std::map<std::string, bool> dirs;  // value unused; ordered set
+    Stats stats;
+    time_t now = 0;
+    size_t totalBytes = 1024 * 1024;
+};
+
+inline State& state() {
+    static State s;
+    return s;
+}
+
+inline std::string normalize(const char* path) {
+    std::string p = path ? path : "";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return p;
+}
+
+inline std::string parentOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+inline std::string baseName(const std::string& path) {
+    return path.substr(path.rfind('/') + 1);
+}
+
+}  // namespace mockfs
+
+class File {
+public:
+    File() = default;
+
+    // File handle
+    File(std::shared_ptr<mockfs::Node> node, const std::string& path, bool writable)
+        : node_(std::move(node)), path_(path), name_(mockfs::baseName(path)), writable_(writable) {}
+
+    // Directory handle: snapshot of the children at open time
+    File(const std::string& path, std::vector<std::string> children)
+        : path_(path), name_(mockfs::baseName(path)), dir_(true), children_(std::move(children)) {}
+
+    explicit operator bool() const { return open_ && (node_ || dir_); }
+
+    size_t write(const uint8_t* buf, size_t n) {
+        if (!node_ || !writable_ || !open_) return 0;
+        node_->data.append(reinterpret_cast<const char*>(buf), n);
+        node_->lastWrite = mockfs::state().now;
+        pos_ = node_->data.size();
+        mockfs::state().stats.writeCalls++;
+        mockfs::state().stats.bytesWritten += n;
+        return n;
+    }
+    size_t write(const char* buf, size_t n) { return write(reinterpret_cast<const uint8_t*>(buf), n); }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const char* s) { return write(s, strlen(s)); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t println(const char* s) { return print(s) + print("\n"); }
+    size_t println(const String& s) { return print(s) + print("\n"); }
+
+    int available() { return node_ && open_ ? (int)(node_->data.size() - pos_) : 0; }
+    int read() {
+        if (available() <= 0) return -1;
+        mockfs::state().stats.bytesRead++;
+        return (uint8_t)node_->data[pos_++];
+    }
+    size_t read(uint8_t* buf, size_t n) {
+        size_t left = (size_t)available();
+        if (n > left) n = left;
+        if (n) memcpy(buf, node_->data.data() + pos_, n);
+        pos_ += n;
+        mockfs::state().stats.bytesRead += n;
+        return n;
+    }
+    String readStringUntil(char term) {
+        std::string out;
+        int c;
+        while ((c = read()) >= 0 && c != term) out += (char)c;
+        return String(out.c_str());
+    }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+        if (!node_) return false;
+        size_t base = mode == SeekSet ? 0 : mode == SeekCur ? pos_ : node_->data.size();
+        if (base + pos > node_->data.size()) return false;
+        pos_ = base + pos;
+        return true;
+    }
+    size_t position() const { return pos_; }
+    size_t size() const { return node_ ? node_->data.size() : 0; }
+
+    void flush() {
+        if (node_ && open_) mockfs::state().stats.flushCalls++;
+    }
+    void close() { open_ = false; }
+
+    bool isDirectory() const { return dir_; }
+    File openNextFile();
+    void rewindDirectory() { next_ = 0; }
+
+    const char* name() const { return name_.c_str(); }
+    const char* path() const { return path_.c_str(); }
+    time_t getLastWrite() const { return node_ ? node_->lastWrite : 0; }
+
+private:
+    std::shared_ptr<mockfs::Node> node_;
+    std::string path_;
+    std::string name_;
+    bool writable_ = false;
+    bool dir_ = false;
+    bool open_ = true;
+    size_t pos_ = 0;
+    std::vector<std::string> children_;
+    size_t next_ = 0;
+};
+
+namespace fs {
+
+class FS {
+public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false) {
+        (void)create;
+        auto& st = mockfs::state();
+        std::string p = mockfs::normalize(path);
+        if (st.dirs.count(p) || p == "/") return openDir(p);
+        bool write = mode && (mode[0] == 'w' || mode[0] == 'a');
+        auto it = st.files.find(p);
+        if (it == st.files.end()) {
+            if (!write || !parentExists(p)) return File();
+            it = st.files.emplace(p, std::make_shared<mockfs::Node>()).first;
+        }
+        if (mode && mode[0] == 'w') it->second->data.clear();
+        st.stats.opens++;
+        File f(it->second, p, write);
+        if (mode && mode[0] == 'a') f.seek(0, SeekEnd);
+        return f;
+    }
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+
+    bool exists(const char* path) {
+        std::string p = mockfs::normalize(path);
+        return p == "/" || mockfs::state().files.count(p) || mockfs::state().dirs.count(p);
+    }
+    bool exists(const String& path) { return exists(path.c_str()); }
+
+    bool remove(const char* path) { return mockfs::state().files.erase(mockfs::normalize(path)) > 0; }
+    bool remove(const String& path) { return remove(path.c_str()); }
+
+    bool rename(const char* from, const char* to) {
+        auto& files = mockfs::state().files;
+        auto it = files.find(mockfs::normalize(from));
+        std::string dst = mockfs::normalize(to);
+        if (it == files.end() || !parentExists(dst)) return false;
+        auto node = it->second;
+        files.erase(it);
+        files[dst] = node;
+        return true;
+    }
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+
+    bool mkdir(const char* path) {
+        mockfs::state().dirs[mockfs::normalize(path)] = true;
+        return true;
+    }
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+
+    bool rmdir(const char* path) { return mockfs::state().dirs.erase(mockfs::normalize(path)) > 0; }
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+private:
+    bool parentExists(const std::string& p) {
+        std::string parent = mockfs::parentOf(p);
+        return parent == "/" || mockfs::state().dirs.count(parent);
+    }
+
+    File openDir(const std::string& p) {
+        std::vector<std::string> children;
+        for (auto& kv : mockfs::state().files) {
+            if (mockfs::parentOf(kv.first) == p) children.push_back(kv.first);
+        }
+        for (auto& kv : mockfs::state().dirs) {
+            if (kv.first != p && mockfs::parentOf(kv.first) == p) children.push_back(kv.first);
+        }
+        return File(p, children);
+    }
+};
+
+}  // namespace fs
+
+using fs::FS;
+
+inline File File::openNextFile() {
+    auto& st = mockfs::state();
+    while (next_ < children_.size()) {
+        const std::string& child = children_[next_++];
+        auto it = st.files.find(child);
+        if (it != st.files.end()) return File(it->second, child, false);
+        if (st.dirs.count(child)) return File(child, {});
+    }
+    return File();
+}
+
+namespace mockfs {
+
+// Empty filesystem, zeroed counters, clock at 0
+inline void reset() {
+    state() = State();
+}
+
+inline std::string contents(const char* path) {
+    auto it = state().files.find(normalize(path));
+    return it == state().files.end() ? std::string() : it->second->data;
+}
+
+inline Stats& stats() { return state().stats; }
+
+inline void setTime(time_t t) { state().now = t; }
+
+}  // namespace mockfs
+
+#endif // MOCK_FS_H
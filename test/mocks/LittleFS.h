@@ -0,0 +1,26 @@
+#ifndef MOCK_LITTLEFS_H
+#define MOCK_LITTLEFS_H
+
+// This file redirects LittleFS.h includes to the in-memory filesystem
+#include "FS.h"
+
+class LittleFSFS : public fs::FS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char* label = "spiffs") {
+        (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)label;
+        return true;
+    }
+    void end() {}
+    bool format() { mockfs::reset(); return true; }
+    size_t totalBytes() { return mockfs::state().totalBytes; }
+    size_t usedBytes() {
+        size_t used = 0;
+        for (auto& kv : mockfs::state().files) used += kv.second->data.size();
+        return used;
+    }
+};
+
+inline LittleFSFS LittleFS;
+
+#endif // MOCK_LITTLEFS_H
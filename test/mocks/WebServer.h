@@ -0,0 +1,38 @@
+#ifndef MOCK_WEBSERVER_H
+#define MOCK_WEBSERVER_H
+
+// The types HttpServer borrows from the Arduino WebServer header, with the
+// same values (HTTPMethod is http_parser's enum there). No server.
+
+#include "mock_arduino.h"
+#include <stddef.h>
+#include <stdint.h>
+
+enum HTTPMethod {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+    HTTP_OPTIONS = 6,
+    HTTP_PATCH = 28,
+};
+#define HTTP_ANY (HTTPMethod)(255)
+
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef struct {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+} HTTPUpload;
+
+#endif // MOCK_WEBSERVER_H
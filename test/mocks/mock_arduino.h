@@ -12,6 +12,7 @@ public:
     String() : data_("") {}
     String(const char* cstr) : data_(cstr ? cstr : "") {}
     String(const std::string& str) : data_(str) {}
+    String(const char* cstr, unsigned int length) : data_(cstr ? std::string(cstr, length) : std::string()) {}
     String(int num) : data_(std::to_string(num)) {}
     String(unsigned int num) : data_(std::to_string(num)) {}
     String(long num) : data_(std::to_string(num)) {}
@@ -63,6 +64,10 @@ public:
         return data_ != (cstr ? cstr : "");
     }
     
+    bool operator<(const String& other) const {
+        return data_ < other.data_;
+    }
+    
     void toLowerCase() {
         for (char& c : data_) {
             if (c >= 'A' && c <= 'Z') {
@@ -93,6 +98,10 @@ public:
         size_t pos = data_.find(ch);
         return pos == std::string::npos ? -1 : static_cast<int>(pos);
     }
+    int indexOf(const char* str) const {
+        size_t pos = data_.find(str);
+        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+    }
     
     String substring(size_t start) const {
         if (start >= data_.length()) return String("");
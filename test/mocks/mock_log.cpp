@@ -13,6 +13,18 @@ void logln(String msg, int level) {
     // Silent in tests
 }
 
+void logln(const char* msg, int level) {
+    (void)level;
+    (void)msg;
+    // Silent in tests
+}
+
+void logPrintf(int level, const char* fmt, ...) {
+    (void)level;
+    (void)fmt;
+    // Silent in tests
+}
+
 void setLogLevel(LogLevel level) { (void)level; }
 void setLogRetentionDays(uint32_t days) { (void)days; }
 uint32_t getLogRetentionDays() { return 7; }
@@ -22,7 +34,7 @@ void initLogSettings() { }
 void logEnableFileSink() { }
 void logCloseFile() { }
 void logFlushFile() { }
-String logLatestFilePath() { return String(""); }
+void logClearFiles() { }
 void logRewriteUnsynced() { }
 
 // Global log level variable
@@ -21,12 +21,30 @@ extern LogLevel LOG_LEVEL;
 // Mock logging functions for testing - matching production signatures
 void log(String msg, int level);
 void logln(String msg, int level);
+void logln(const char* msg, int level);
+
+#ifndef LOG_COMPILE_MIN_LEVEL
+#define LOG_COMPILE_MIN_LEVEL 0
+#endif
+
+// printf-style line (newline appended); formats on the stack, no String
+void logPrintf(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// True when a message at this level is kept. The convenience macros test it
+// before evaluating their arguments, so a filtered call builds no String;
+// levels below LOG_COMPILE_MIN_LEVEL fold to false and are removed entirely.
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_MIN_LEVEL && (level) >= LOG_LEVEL)
 
 // Convenience macros - matching production code
-#define logDebug(msg) logln(msg, LOG_LEVEL_DEBUG)
-#define logInfo(msg)  logln(msg, LOG_LEVEL_INFO)
-#define logWarn(msg)  logln(msg, LOG_LEVEL_WARN)
-#define logError(msg) logln(msg, LOG_LEVEL_ERROR)
+#define logDebug(msg) (LOG_ENABLED(LOG_LEVEL_DEBUG) ? logln(msg, LOG_LEVEL_DEBUG) : (void)0)
+#define logInfo(msg)  (LOG_ENABLED(LOG_LEVEL_INFO) ? logln(msg, LOG_LEVEL_INFO) : (void)0)
+#define logWarn(msg)  (LOG_ENABLED(LOG_LEVEL_WARN) ? logln(msg, LOG_LEVEL_WARN) : (void)0)
+#define logError(msg) (LOG_ENABLED(LOG_LEVEL_ERROR) ? logln(msg, LOG_LEVEL_ERROR) : (void)0)
+
+#define logDebugf(...) (LOG_ENABLED(LOG_LEVEL_DEBUG) ? logPrintf(LOG_LEVEL_DEBUG, __VA_ARGS__) : (void)0)
+#define logInfof(...)  (LOG_ENABLED(LOG_LEVEL_INFO) ? logPrintf(LOG_LEVEL_INFO, __VA_ARGS__) : (void)0)
+#define logWarnf(...)  (LOG_ENABLED(LOG_LEVEL_WARN) ? logPrintf(LOG_LEVEL_WARN, __VA_ARGS__) : (void)0)
+#define logErrorf(...) (LOG_ENABLED(LOG_LEVEL_ERROR) ? logPrintf(LOG_LEVEL_ERROR, __VA_ARGS__) : (void)0)
 
 // Mock other log functions
 void setLogLevel(LogLevel level);
@@ -38,7 +56,7 @@ void initLogSettings();
 void logEnableFileSink();
 void logCloseFile();
 void logFlushFile();
-String logLatestFilePath();
+void logClearFiles();
 void logRewriteUnsynced();
 
 #endif // MOCK_LOG_H
@@ -103,6 +103,26 @@ public:
         return value.length();
     }
     
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        if (readOnly_) return 0;
+        storage_[namespace_][key] = std::string(static_cast<const char*>(value), len);
+        return len;
+    }
+
+    size_t getBytesLength(const char* key) {
+        auto& ns = storage_[namespace_];
+        auto it = ns.find(key);
+        return (it != ns.end()) ? it->second.size() : 0;
+    }
+
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        auto& ns = storage_[namespace_];
+        auto it = ns.find(key);
+        if (it == ns.end() || it->second.size() > maxLen) return 0;
+        memcpy(buf, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
     bool isKey(const char* key) {
         auto& ns = storage_[namespace_];
         return ns.find(key) != ns.end();
@@ -4,6 +4,7 @@
 #include "../mocks/mock_arduino.h"
 #include <map>
 #include <string>
+#include <vector>
 
 /**
  * @brief Mock PubSubClient for testing MQTT Discovery Builder
@@ -19,14 +20,33 @@ public:
     MockPubSubClient() : bufferSize_(256) {}
     
     bool publish(const char* topic, const char* payload, bool retained = false) {
+        return publish(topic, reinterpret_cast<const uint8_t*>(payload),
+                       static_cast<unsigned int>(strlen(payload)), retained);
+    }
+    
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+        if (!connected_) return false;
+        publishCount_++;
+        publishBytes_ += strlen(topic) + length;
+        mockMillis += publishCostMs_;
+        if (!recording_) return true;
         PublishedMessage msg;
         msg.topic = String(topic);
-        msg.payload = String(payload);
+        msg.payload = String(std::string(reinterpret_cast<const char*>(payload), length));
         msg.retained = retained;
         publishedMessages_.push_back(msg);
         return true; // Always succeed for testing
     }
     
+    bool connected() const {
+        return connected_;
+    }
+    
+    /** Simulate losing / regaining the broker; publishes fail while down. */
+    void setConnected(bool on) {
+        connected_ = on;
+    }
+    
     void setBufferSize(uint16_t size) {
         bufferSize_ = size;
     }
@@ -61,6 +81,38 @@ public:
     void clear() {
         publishedMessages_.clear();
         bufferSize_ = 256;
+        recording_ = true;
+        publishCount_ = 0;
+        publishBytes_ = 0;
+        publishCostMs_ = 0;
+        connected_ = true;
+    }
+    
+    /**
+     * @brief Let every publish advance mock time
+     *
+     * Stands in for the socket write so time-budgeted code can be tested.
+     */
+    void setPublishCostMs(unsigned long ms) {
+        publishCostMs_ = ms;
+    }
+    
+    /**
+     * @brief Count publishes without storing them
+     *
+     * Recording copies topic and payload into Strings; allocation-counting
+     * tests switch it off so only the code under test is measured.
+     */
+    void setRecording(bool on) {
+        recording_ = on;
+    }
+    
+    size_t getPublishCalls() const {
+        return publishCount_;
+    }
+    
+    size_t getPublishBytes() const {
+        return publishBytes_;
     }
     
     size_t getPublishedCount() const {
@@ -70,6 +122,11 @@ public:
 private:
     std::vector<PublishedMessage> publishedMessages_;
     uint16_t bufferSize_;
+    bool recording_ = true;
+    size_t publishCount_ = 0;
+    size_t publishBytes_ = 0;
+    unsigned long publishCostMs_ = 0;
+    bool connected_ = true;
 };
 
 // Forward declaration for PubSubClient type alias
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <string>
+
+// Include production code
+#include "../../src/http_encoding.cpp"
+#include "../../src/asset_bundle.cpp"
+
+// Stand-in for the table tools/embed_assets.py generates: sorted by path,
+// text stored compressed only, other files as-is.
+namespace {
+const uint8_t kGz[] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 2, 3};
+const uint8_t kBr[] = {0x0b, 0x01};
+const uint8_t kPng[] = {0x89, 'P', 'N', 'G'};
+}  // namespace
+
+const EmbeddedAsset kEmbeddedAssets[] = {
+    {"/app.js", "1111111111111111", {nullptr, kGz, kBr}, {0, sizeof(kGz), sizeof(kBr)}},
+    {"/dashboard.html", "2222222222222222", {nullptr, kGz, nullptr}, {0, sizeof(kGz), 0}},
+    {"/i18n/nl.json", "3333333333333333", {nullptr, kGz, nullptr}, {0, sizeof(kGz), 0}},
+    {"/logo.png", "4444444444444444", {kPng, nullptr, nullptr}, {sizeof(kPng), 0, 0}},
+    {"/update.html", "5555555555555555", {nullptr, kGz, nullptr}, {0, sizeof(kGz), 0}},
+};
+const size_t kEmbeddedAssetCount = sizeof(kEmbeddedAssets) / sizeof(kEmbeddedAssets[0]);
+const char kEmbeddedBundleId[] = "0123456789abcdef";
+
+namespace {
+
+struct Choice {
+    ContentCoding coding;
+    bool inflate;
+};
+
+Choice choose(const char* path, const char* acceptEncoding) {
+    const EmbeddedAsset* asset = findEmbeddedAsset(path);
+    EXPECT_NE(nullptr, asset);
+    Choice c{ContentCoding::Identity, false};
+    EXPECT_TRUE(selectEmbeddedVariant(*asset, acceptEncoding, c.coding, c.inflate));
+    return c;
+}
+
+std::string etag(const char* path, ContentCoding coding) {
+    char buf[48];
+    EXPECT_TRUE(formatEmbeddedEtag(*findEmbeddedAsset(path), coding, buf, sizeof(buf)));
+    return buf;
+}
+
+}  // namespace
+
+TEST(AssetBundleTest, FindsEveryAssetByExactPath) {
+    for (size_t i = 0; i < kEmbeddedAssetCount; ++i) {
+        EXPECT_EQ(&kEmbeddedAssets[i], findEmbeddedAsset(kEmbeddedAssets[i].path));
+    }
+}
+
+TEST(AssetBundleTest, MissesAreNull) {
+    EXPECT_EQ(nullptr, findEmbeddedAsset("/nope.html"));
+    EXPECT_EQ(nullptr, findEmbeddedAsset("/dashboard.htm"));
+    EXPECT_EQ(nullptr, findEmbeddedAsset("/dashboard.html.gz"));
+    EXPECT_EQ(nullptr, findEmbeddedAsset("dashboard.html"));
+    EXPECT_EQ(nullptr, findEmbeddedAsset("/"));
+    EXPECT_EQ(nullptr, findEmbeddedAsset(""));
+    EXPECT_EQ(nullptr, findEmbeddedAsset(nullptr));
+}
+
+TEST(AssetBundleTest, PicksBestStoredVariant) {
+    Choice c = choose("/app.js", "gzip, deflate, br");
+    EXPECT_EQ(ContentCoding::Brotli, c.coding);
+    EXPECT_FALSE(c.inflate);
+
+    c = choose("/app.js", "gzip");
+    EXPECT_EQ(ContentCoding::Gzip, c.coding);
+    EXPECT_FALSE(c.inflate);
+
+    // br preferred but not stored: gzip is next
+    c = choose("/dashboard.html", "br, gzip");
+    EXPECT_EQ(ContentCoding::Gzip, c.coding);
+    EXPECT_FALSE(c.inflate);
+}
+
+TEST(AssetBundleTest, ClientWithoutGzipGetsInflatedBody) {
+    Choice c = choose("/dashboard.html", "");
+    EXPECT_EQ(ContentCoding::Gzip, c.coding);
+    EXPECT_TRUE(c.inflate);
+
+    c = choose("/app.js", "identity");
+    EXPECT_EQ(ContentCoding::Gzip, c.coding);
+    EXPECT_TRUE(c.inflate);
+}
+
+TEST(AssetBundleTest, UncompressedAssetsAreSentAsIs) {
+    Choice c = choose("/logo.png", "gzip, br");
+    EXPECT_EQ(ContentCoding::Identity, c.coding);
+    EXPECT_FALSE(c.inflate);
+
+    // Even to a client that claims to refuse identity
+    c = choose("/logo.png", "gzip, identity;q=0");
+    EXPECT_EQ(ContentCoding::Identity, c.coding);
+    EXPECT_FALSE(c.inflate);
+}
+
+TEST(AssetBundleTest, NothingStoredIsReported) {
+    const EmbeddedAsset empty = {"/x", "0", {nullptr, nullptr, nullptr}, {0, 0, 0}};
+    ContentCoding coding;
+    bool inflate;
+    EXPECT_FALSE(selectEmbeddedVariant(empty, "gzip, br", coding, inflate));
+}
+
+TEST(AssetBundleTest, EtagsAreContentAddressedPerCoding) {
+    EXPECT_EQ("\"2222222222222222-gzip\"", etag("/dashboard.html", ContentCoding::Gzip));
+    EXPECT_EQ("\"1111111111111111-br\"", etag("/app.js", ContentCoding::Brotli));
+    // Plain bodies, stored or inflated, share the bare hash
+    EXPECT_EQ("\"2222222222222222\"", etag("/dashboard.html", ContentCoding::Identity));
+    EXPECT_NE(etag("/app.js", ContentCoding::Gzip), etag("/dashboard.html", ContentCoding::Gzip));
+
+    char tiny[8];
+    EXPECT_FALSE(formatEmbeddedEtag(kEmbeddedAssets[0], ContentCoding::Gzip, tiny, sizeof(tiny)));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
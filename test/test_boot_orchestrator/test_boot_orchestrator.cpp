@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../mocks/mock_arduino.h"
+
+// Include production code
+#include "../../src/boot_profile.cpp"
+#include "../../src/boot_orchestrator.cpp"
+
+static std::string g_order;
+static bool g_networkUp = false;
+
+static void startA() { g_order += "A"; }
+static void startB() { g_order += "B"; }
+static void startC() { g_order += "C"; }
+static void startD() { g_order += "D"; }
+static void startNet() { g_order += "N"; }
+static bool pollNet(unsigned long) { return g_networkUp; }
+static void slowStart() { setMockMillis(millis() + 40); }
+
+class BootOrchestratorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_bootPowerOn();
+        setMockMillis(100);
+        bootProfileBegin();
+        bootOrchestrator.test_reset();
+        g_order.clear();
+        g_networkUp = false;
+    }
+};
+
+TEST_F(BootOrchestratorTest, StepsRunAfterWhatTheyNeed) {
+    BootOrchestrator& b = bootOrchestrator;
+    b.add(BootPhase::Display, bootStep(BootPhase::Language), startC);
+    b.add(BootPhase::Early, 0, startA);
+    b.add(BootPhase::Language, bootStep(BootPhase::Early), startB);
+    EXPECT_TRUE(b.valid());
+    EXPECT_TRUE(b.run());
+    EXPECT_EQ("ABC", g_order);
+    EXPECT_TRUE(b.done());
+    EXPECT_NE(0u, bootTimeline().milestone(BootMilestone::BootDone));
+}
+
+TEST_F(BootOrchestratorTest, ReadyStepsKeepTheirDeclaredOrder) {
+    BootOrchestrator& b = bootOrchestrator;
+    b.add(BootPhase::Early, 0, startA);
+    b.add(BootPhase::NightMode, bootStep(BootPhase::Early), startB);
+    b.add(BootPhase::Language, bootStep(BootPhase::Early), startC);
+    b.run();
+    EXPECT_EQ("ABC", g_order);
+}
+
+TEST_F(BootOrchestratorTest, TheClockDoesNotWaitForTheNetwork) {
+    BootOrchestrator& b = bootOrchestrator;
+    b.add(BootPhase::Early, 0, startA);
+    b.add(BootPhase::Network, bootStep(BootPhase::Early), startNet, pollNet);
+    b.add(BootPhase::Display, bootStep(BootPhase::Early), startB);
+    b.add(BootPhase::Services, bootStep(BootPhase::Network) | bootStep(BootPhase::Display), startC);
+
+    EXPECT_FALSE(b.run());
+    EXPECT_EQ("ANB", g_order);
+    EXPECT_TRUE(b.running(BootPhase::Network));
+    EXPECT_TRUE(b.finished(BootPhase::Display));
+    EXPECT_FALSE(b.finished(BootPhase::Services));
+
+    // loop() passes: nothing new until the network is up
+    EXPECT_FALSE(b.run());
+    EXPECT_EQ("ANB", g_order);
+    g_networkUp = true;
+    EXPECT_TRUE(b.run());
+    EXPECT_EQ("ANBC", g_order);
+    EXPECT_FALSE(b.running(BootPhase::Network));
+}
+
+TEST_F(BootOrchestratorTest, BackgroundStepsAreTimedUntilTheyFinish) {
+    BootOrchestrator& b = bootOrchestrator;
+    b.add(BootPhase::Network, 0, startNet, pollNet);
+    b.add(BootPhase::Display, 0, slowStart);
+    b.run();
+    setMockMillis(2100);
+    g_networkUp = true;
+    b.run();
+
+    const BootTimeline& t = bootTimeline();
+    EXPECT_EQ(40000u, t.durationUs[static_cast<uint8_t>(BootPhase::Display)]);
+    EXPECT_EQ(2000000u, t.durationUs[static_cast<uint8_t>(BootPhase::Network)]);
+    EXPECT_EQ(0u, t.open);
+}
+
+TEST_F(BootOrchestratorTest, MissingOrCircularNeedsAreInvalid) {
+    BootOrchestrator& b = bootOrchestrator;
+    b.add(BootPhase::Early, 0, startA);
+    b.add(BootPhase::Services, bootStep(BootPhase::Network), startB);  // never added
+    EXPECT_FALSE(b.valid());
+    EXPECT_FALSE(b.run());
+    EXPECT_EQ("A", g_order);
+
+    b.test_reset();
+    b.add(BootPhase::Display, bootStep(BootPhase::Wordclock), startC);
+    b.add(BootPhase::Wordclock, bootStep(BootPhase::Display), startD);
+    EXPECT_FALSE(b.valid());
+}
+
+TEST_F(BootOrchestratorTest, AStepIsDeclaredOnce) {
+    BootOrchestrator& b = bootOrchestrator;
+    b.add(BootPhase::Early, 0, startA);
+    b.add(BootPhase::Early, 0, startB);
+    b.run();
+    EXPECT_EQ("A", g_order);
+    // Finished steps do not run again
+    b.run();
+    EXPECT_EQ("A", g_order);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
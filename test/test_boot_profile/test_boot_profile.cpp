@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+
+// Include production code
+#include "../../src/boot_profile.cpp"
+
+class BootProfileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_bootPowerOn();
+        setMockMillis(100);
+        bootProfileBegin();
+    }
+
+    static uint32_t durationMs(const BootTimeline& t, BootPhase p) {
+        return t.durationUs[static_cast<uint8_t>(p)] / 1000;
+    }
+};
+
+TEST_F(BootProfileTest, PhasesAreTimedFromBeginToEnd) {
+    bootPhaseBegin(BootPhase::Early);
+    setMockMillis(150);
+    bootPhaseEnd(BootPhase::Early);
+    bootPhaseBegin(BootPhase::StartDelay);
+    setMockMillis(1150);
+    bootPhaseEnd(BootPhase::StartDelay);
+    bootPhaseBegin(BootPhase::Network);
+    setMockMillis(4150);
+    bootPhaseEnd(BootPhase::Network);
+    bootPhaseEnd(BootPhase::Network);  // a second end changes nothing
+
+    const BootTimeline& t = bootTimeline();
+    EXPECT_EQ(50u, durationMs(t, BootPhase::Early));
+    EXPECT_EQ(1000u, durationMs(t, BootPhase::StartDelay));
+    EXPECT_EQ(3000u, durationMs(t, BootPhase::Network));
+    EXPECT_EQ(1150000u, t.startUs[static_cast<uint8_t>(BootPhase::Network)]);
+    EXPECT_TRUE(t.phaseRan(BootPhase::Network));
+    EXPECT_FALSE(t.phaseRan(BootPhase::Ble));
+    EXPECT_EQ(0u, t.open);
+    EXPECT_EQ(static_cast<uint8_t>(BootPhase::Network), bootSlowestPhase());
+    EXPECT_STREQ("network", bootPhaseName(bootSlowestPhase()));
+}
+
+TEST_F(BootProfileTest, BackgroundPhasesOverlapOthers) {
+    bootPhaseBegin(BootPhase::Network);
+    setMockMillis(200);
+    bootPhaseBegin(BootPhase::Display);
+    setMockMillis(260);
+    bootPhaseEnd(BootPhase::Display);
+    setMockMillis(2100);
+    bootPhaseEnd(BootPhase::Network);
+
+    const BootTimeline& t = bootTimeline();
+    EXPECT_EQ(60u, durationMs(t, BootPhase::Display));
+    EXPECT_EQ(2000u, durationMs(t, BootPhase::Network));
+}
+
+TEST_F(BootProfileTest, MilestonesKeepTheFirstTime) {
+    setMockMillis(2500);
+    bootMilestone(BootMilestone::WifiConnected);
+    setMockMillis(90000);
+    bootMilestone(BootMilestone::WifiConnected);  // a reconnect, not boot latency
+    EXPECT_EQ(2500u, bootTimeline().milestone(BootMilestone::WifiConnected));
+    EXPECT_EQ(0u, bootTimeline().milestone(BootMilestone::TimeSynced));
+}
+
+TEST_F(BootProfileTest, PowerOnHasNoPreviousBoot) {
+    EXPECT_EQ(nullptr, previousBootTimeline());
+    EXPECT_FALSE(previousBootIncomplete());
+    EXPECT_EQ(1u, bootTimeline().bootCount);
+    EXPECT_EQ(BOOT_PHASE_NONE, bootSlowestPhase());
+}
+
+TEST_F(BootProfileTest, ResetKeepsTheFinishedBoot) {
+    bootPhaseBegin(BootPhase::TimeSync);
+    setMockMillis(600);
+    bootPhaseEnd(BootPhase::TimeSync);
+    bootMilestone(BootMilestone::SetupDone);
+    bootMilestone(BootMilestone::BootDone);
+
+    setMockMillis(50);
+    bootProfileBegin();  // software reset
+    const BootTimeline* prev = previousBootTimeline();
+    ASSERT_NE(nullptr, prev);
+    EXPECT_FALSE(previousBootIncomplete());
+    EXPECT_EQ(500u, durationMs(*prev, BootPhase::TimeSync));
+    EXPECT_EQ(600u, prev->milestone(BootMilestone::SetupDone));
+    EXPECT_EQ(2u, bootTimeline().bootCount);
+    EXPECT_FALSE(bootTimeline().phaseRan(BootPhase::TimeSync));
+}
+
+TEST_F(BootProfileTest, ResetDuringAPhaseNamesIt) {
+    bootPhaseBegin(BootPhase::Network);
+    setMockMillis(300);
+    bootPhaseBegin(BootPhase::Services);
+    setMockMillis(8000);
+    bootProfileBegin();  // watchdog reset while the web server starts
+    ASSERT_TRUE(previousBootIncomplete());
+    const BootTimeline* prev = previousBootTimeline();
+    EXPECT_TRUE(prev->phaseOpen(static_cast<uint8_t>(BootPhase::Network)));
+    EXPECT_STREQ("services", bootPhaseName(prev->stuckPhase()));
+}
+
+TEST_F(BootProfileTest, ResetBeforeTheBackgroundStepsFinishedIsIncomplete) {
+    bootPhaseBegin(BootPhase::TimeSync);
+    bootMilestone(BootMilestone::SetupDone);
+    setMockMillis(5000);
+    bootProfileBegin();
+    ASSERT_TRUE(previousBootIncomplete());
+    EXPECT_STREQ("time_sync", bootPhaseName(previousBootTimeline()->stuckPhase()));
+}
+
+TEST_F(BootProfileTest, GarbageAfterPowerOnIsNotAPreviousBoot) {
+    bootMilestone(BootMilestone::SetupDone);
+    test_bootPowerOn();
+    bootProfileBegin();
+    EXPECT_EQ(nullptr, previousBootTimeline());
+    EXPECT_EQ(1u, bootTimeline().bootCount);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -10,6 +10,7 @@
 #include "../../src/log.cpp"
 #include "../../src/time_mapper.cpp"
 #include "../../src/night_mode.cpp"
+#include "../../src/settings_store.cpp"
 
 class EdgeCasesTest : public ::testing::Test {
 protected:
@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <string>
+
+// Include production code
+#include "../../src/event_stream.cpp"
+
+namespace {
+
+// Socket stand-in: takes at most `window` bytes per send, or reports the
+// peer as gone.
+struct MockPeer {
+    std::string received;
+    size_t window = SIZE_MAX;
+    bool gone = false;
+    bool closed = false;
+};
+
+class MockTransport : public EventStreamTransport {
+public:
+    explicit MockTransport(MockPeer& peer) : peer_(peer) {}
+
+    int trySend(const uint8_t* data, size_t length) override {
+        if (peer_.gone) return -1;
+        size_t n = length < peer_.window ? length : peer_.window;
+        peer_.received.append(reinterpret_cast<const char*>(data), n);
+        return (int)n;
+    }
+
+    void close() override { peer_.closed = true; }
+
+private:
+    MockPeer& peer_;
+};
+
+const std::string kHello = "retry: 3000\n\n";
+
+}  // namespace
+
+class EventStreamTest : public ::testing::Test {
+protected:
+    bool subscribe(MockPeer& peer, unsigned long nowMs = 0) {
+        return hub.subscribe(std::unique_ptr<EventStreamTransport>(new MockTransport(peer)), nowMs);
+    }
+
+    void publish(const char* event, const std::string& data) {
+        hub.publish(event, data.data(), data.size());
+    }
+
+    EventStreamHub hub;
+};
+
+TEST_F(EventStreamTest, FormatsFramesAfterPreamble) {
+    MockPeer peer;
+    ASSERT_TRUE(subscribe(peer));
+    publish("light", "{\"on\":true}");
+    hub.service(10);
+    EXPECT_EQ(kHello + "event: light\ndata: {\"on\":true}\n\n", peer.received);
+    EXPECT_EQ(1u, hub.stats().published);
+}
+
+TEST_F(EventStreamTest, SplitsMultilineDataAndTrimsTrailingNewline) {
+    MockPeer peer;
+    ASSERT_TRUE(subscribe(peer));
+    publish("log", "[INFO] stack:\n  frame 0\n");
+    publish("log", "");
+    hub.service(10);
+    EXPECT_EQ(kHello +
+              "event: log\ndata: [INFO] stack:\ndata:   frame 0\n\n"
+              "event: log\ndata: \n\n",
+              peer.received);
+}
+
+TEST_F(EventStreamTest, RejectsSubscribersOverTheCap) {
+    MockPeer peers[EVENT_STREAM_MAX_CLIENTS + 1];
+    for (size_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; ++i) ASSERT_TRUE(subscribe(peers[i]));
+    EXPECT_FALSE(subscribe(peers[EVENT_STREAM_MAX_CLIENTS]));
+    EXPECT_TRUE(peers[EVENT_STREAM_MAX_CLIENTS].closed);
+    EXPECT_EQ((size_t)EVENT_STREAM_MAX_CLIENTS, hub.subscriberCount());
+    EXPECT_EQ(1u, hub.stats().rejected);
+
+    // A freed slot takes the next subscriber
+    peers[0].gone = true;
+    hub.service(10);
+    EXPECT_TRUE(peers[0].closed);
+    MockPeer late;
+    EXPECT_TRUE(subscribe(late, 20));
+}
+
+TEST_F(EventStreamTest, PartialSendsKeepByteOrder) {
+    MockPeer peer;
+    peer.window = 7;
+    ASSERT_TRUE(subscribe(peer));
+    publish("a", "first");
+    publish("b", "second");
+    std::string expected = kHello + "event: a\ndata: first\n\nevent: b\ndata: second\n\n";
+    for (int i = 0; i < 100 && peer.received.size() < expected.size(); ++i) hub.service(10 + i);
+    EXPECT_EQ(expected, peer.received);
+}
+
+TEST_F(EventStreamTest, SlowSubscriberDropsAndIsToldSo) {
+    MockPeer slow;
+    MockPeer fast;
+    ASSERT_TRUE(subscribe(slow));
+    ASSERT_TRUE(subscribe(fast));
+    slow.window = 0;  // TCP window full
+
+    std::string line(100, 'x');
+    const int kFrames = 40;  // ~4.5 KB: more than one queue holds
+    for (int i = 0; i < kFrames; ++i) {
+        publish("log", line);
+        hub.service(10);
+    }
+    EXPECT_EQ(kHello.size() + kFrames * (std::string("event: log\ndata: \n\n").size() + line.size()),
+              fast.received.size());
+    EXPECT_TRUE(slow.received.empty());
+    uint32_t dropped = hub.stats().dropped;
+    EXPECT_GT(dropped, 0u);
+
+    // The reader catches up; the next frame is preceded by the drop count
+    slow.window = SIZE_MAX;
+    hub.service(20);
+    publish("log", "after");
+    hub.service(30);
+    std::string notice = "event: dropped\ndata: " + std::to_string(dropped) + "\n\n";
+    size_t at = slow.received.find(notice);
+    ASSERT_NE(std::string::npos, at);
+    EXPECT_EQ(slow.received.size() - notice.size() - std::string("event: log\ndata: after\n\n").size(), at);
+    EXPECT_EQ(std::string::npos, fast.received.find("event: dropped"));
+}
+
+TEST_F(EventStreamTest, DropNoticeSentWithoutFurtherTraffic) {
+    MockPeer peer;
+    ASSERT_TRUE(subscribe(peer));
+    peer.window = 0;
+    std::string big(EVENT_STREAM_QUEUE_BYTES, 'y');
+    publish("log", big);  // never fits
+    EXPECT_EQ(1u, hub.stats().dropped);
+    peer.window = SIZE_MAX;
+    hub.service(10);
+    hub.service(20);
+    EXPECT_EQ(kHello + "event: dropped\ndata: 1\n\n", peer.received);
+}
+
+TEST_F(EventStreamTest, StalledSubscriberIsDisconnected) {
+    MockPeer peer;
+    ASSERT_TRUE(subscribe(peer, 1000));
+    peer.window = 0;
+    publish("log", "stuck");
+    hub.service(1000 + EVENT_STREAM_STALL_MS - 1);
+    EXPECT_FALSE(peer.closed);
+    hub.service(1000 + EVENT_STREAM_STALL_MS);
+    EXPECT_TRUE(peer.closed);
+    EXPECT_EQ(0u, hub.subscriberCount());
+    EXPECT_EQ(1u, hub.stats().disconnects);
+}
+
+TEST_F(EventStreamTest, IdleSubscriberGetsKeepalive) {
+    MockPeer peer;
+    ASSERT_TRUE(subscribe(peer, 0));
+    hub.service(1);
+    EXPECT_EQ(kHello, peer.received);
+    hub.service(EVENT_STREAM_KEEPALIVE_MS - 1);
+    EXPECT_EQ(kHello, peer.received);
+    hub.service(EVENT_STREAM_KEEPALIVE_MS);
+    EXPECT_EQ(kHello + ": ping\n\n", peer.received);
+    // An idle but reading subscriber is never counted as stalled
+    hub.service(EVENT_STREAM_KEEPALIVE_MS + EVENT_STREAM_STALL_MS);
+    EXPECT_FALSE(peer.closed);
+}
+
+TEST_F(EventStreamTest, ClosedPeerFreesSlot) {
+    MockPeer peer;
+    ASSERT_TRUE(subscribe(peer));
+    peer.gone = true;
+    publish("led", "{}");
+    hub.service(10);
+    EXPECT_TRUE(peer.closed);
+    EXPECT_FALSE(hub.hasSubscribers());
+    EXPECT_EQ(1u, hub.stats().disconnects);
+
+    // Publishing with nobody subscribed is not counted
+    publish("led", "{}");
+    EXPECT_EQ(1u, hub.stats().published);
+}
+
+TEST_F(EventStreamTest, CloseAllReleasesEveryone) {
+    MockPeer a, b;
+    ASSERT_TRUE(subscribe(a));
+    ASSERT_TRUE(subscribe(b));
+    hub.closeAll();
+    EXPECT_TRUE(a.closed);
+    EXPECT_TRUE(b.closed);
+    EXPECT_EQ(0u, hub.subscriberCount());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../helpers/alloc_counter.h"
+
+// Include production code
+#include "../../src/fixed_string.cpp"
+
+TEST(FixedStringTest, AppendsTextAndNumbers) {
+    FixedString<64> s;
+    s += "uptime ";
+    s += 1234UL;
+    s += ' ';
+    s += -7;
+    s += " rssi ";
+    s += (int8_t)-61;
+    s += String(" ok");
+    EXPECT_STREQ("uptime 1234 -7 rssi -61 ok", s.c_str());
+    EXPECT_EQ(strlen(s.c_str()), s.length());
+    EXPECT_FALSE(s.truncated());
+    EXPECT_EQ(63u, s.capacity());
+}
+
+TEST(FixedStringTest, AppendfContinuesWhereTheTextEnds) {
+    FixedString<32> s("state ");
+    s.appendf("%d/%s", 3, "ok");
+    EXPECT_STREQ("state 3/ok", s.c_str());
+    EXPECT_EQ(10u, s.length());
+}
+
+TEST(FixedStringTest, CutsAtCapacityAndCountsOnce) {
+    uint32_t before = fixedStringTruncations();
+    FixedString<8> s;
+    s += "abcde";
+    s += "fghij";
+    EXPECT_STREQ("abcdefg", s.c_str());
+    EXPECT_EQ(7u, s.length());
+    EXPECT_TRUE(s.truncated());
+    s += "x";
+    s.appendf("%d", 42);
+    EXPECT_STREQ("abcdefg", s.c_str());
+    EXPECT_EQ(before + 1, fixedStringTruncations());
+
+    // clear() starts over
+    s.clear();
+    EXPECT_FALSE(s.truncated());
+    EXPECT_TRUE(s.empty());
+    s += "hi";
+    EXPECT_STREQ("hi", s.c_str());
+}
+
+TEST(FixedStringTest, LaterPiecesAreNotSplicedOnAfterACut) {
+    FixedString<8> s("abcd");
+    s += "efghij";  // does not fit
+    s += "k";       // would fit on its own
+    EXPECT_STREQ("abcdefg", s.c_str());
+}
+
+TEST(FixedStringTest, AppendfThatDoesNotFitIsCut) {
+    FixedString<8> s;
+    s.appendf("%s", "0123456789");
+    EXPECT_STREQ("0123456", s.c_str());
+    EXPECT_EQ(7u, s.length());
+    EXPECT_TRUE(s.truncated());
+}
+
+TEST(FixedStringTest, JsonEscaping) {
+    FixedString<64> s;
+    s.appendJsonEscaped("a\"b\\c\nd\te\x01");
+    EXPECT_STREQ("a\\\"b\\\\c\\nd\\te\\u0001", s.c_str());
+    EXPECT_FALSE(s.truncated());
+}
+
+TEST(FixedStringTest, EscapesAreNeverCutInHalf) {
+    FixedString<5> s("ab");
+    s.appendJsonEscaped("c\"d");
+    // "c" fits, the two-character escape does not: no dangling backslash
+    EXPECT_STREQ("abc", s.c_str());
+    EXPECT_TRUE(s.truncated());
+}
+
+TEST(FixedStringTest, CopiesOwnTheirBuffer) {
+    FixedString<16> a("first");
+    FixedString<16> b(a);
+    a = "second";
+    EXPECT_STREQ("first", b.c_str());
+    EXPECT_STREQ("second", a.c_str());
+    b = a;
+    a += "!";
+    EXPECT_STREQ("second", b.c_str());
+    EXPECT_STREQ("second!", a.c_str());
+}
+
+static void describe(StringBuilder& out, int value) {
+    out.appendf("value=%d", value);
+}
+
+TEST(FixedStringTest, FunctionsTakeTheBuilderForAnySize) {
+    FixedString<16> small;
+    FixedString<128> large;
+    describe(small, 5);
+    describe(large, 500);
+    EXPECT_STREQ("value=5", small.c_str());
+    EXPECT_STREQ("value=500", large.c_str());
+}
+
+TEST(FixedStringTest, BuildingNeverAllocates) {
+    AllocCounter counter;
+    FixedString<96> s;
+    s += "wordclock/";
+    s += 42UL;
+    s.appendf("/%s", "state");
+    s.appendJsonEscaped("quote\"d");
+    EXPECT_STREQ("wordclock/42/statequote\\\"d", s.c_str());
+    EXPECT_EQ(0u, counter.allocations());
+}
+
+TEST(FixedStringTest, AllocMeterReportsRatePerSecond) {
+    ReallocMeter meter;
+    meter.perSecond(1000);
+    for (int i = 0; i < 30; ++i) test_noteRealloc();
+    EXPECT_FLOAT_EQ(15.0f, meter.perSecond(3000));
+    EXPECT_FLOAT_EQ(0.0f, meter.perSecond(4000));
+    // Same time again: no window, no rate
+    EXPECT_FLOAT_EQ(0.0f, meter.perSecond(4000));
+    EXPECT_GE(reallocCount(), 30u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include <memory>
+#include <vector>
+
+// Scopes only do something in tracking builds
+#define HEAP_TRACKING 1
+
+// Include production code
+#include "../../src/heap_tracker.cpp"
+
+class HeapTrackerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_heapReset();
+    }
+};
+
+TEST_F(HeapTrackerTest, UnscopedAllocationsAreOther) {
+    heapNoteAlloc(64, true);
+    heapNoteAlloc(32, false);
+    HeapTagStats st = heapTagStats(HeapTag::Other);
+    EXPECT_EQ(2u, st.allocs);
+    EXPECT_EQ(96u, st.bytes);
+    EXPECT_EQ(1u, st.failures);
+    EXPECT_EQ(64u, st.largest);
+    EXPECT_EQ(0u, heapTagStats(HeapTag::Web).allocs);
+}
+
+TEST_F(HeapTrackerTest, ScopeChargesItsTag) {
+    {
+        HeapTagScope scope(HeapTag::Mqtt);
+        EXPECT_EQ(HeapTag::Mqtt, heapCurrentTag());
+        heapNoteAlloc(100, true);
+    }
+    EXPECT_EQ(HeapTag::Other, heapCurrentTag());
+    heapNoteAlloc(10, true);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Mqtt).allocs);
+    EXPECT_EQ(100u, heapTagStats(HeapTag::Mqtt).bytes);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Other).allocs);
+}
+
+TEST_F(HeapTrackerTest, NestedScopesRestoreTheOuterTag) {
+    HeapTagScope web(HeapTag::Web);
+    {
+        HeapTagScope log(HeapTag::Log);
+        heapNoteAlloc(8, true);
+    }
+    heapNoteAlloc(16, true);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Log).allocs);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Web).allocs);
+    EXPECT_EQ(HeapTag::Web, heapCurrentTag());
+}
+
+TEST_F(HeapTrackerTest, OtherTasksKeepTheirOwnTag) {
+    test_heapSetTask(1);
+    HeapTagScope heartbeat(HeapTag::Heartbeat);
+    test_heapSetTask(2);
+    // Another task allocating meanwhile is not charged to the heartbeat
+    heapNoteAlloc(40, true);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Other).allocs);
+    {
+        HeapTagScope ota(HeapTag::Ota);
+        heapNoteAlloc(50, true);
+    }
+    test_heapSetTask(1);
+    heapNoteAlloc(60, true);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Ota).allocs);
+    EXPECT_EQ(60u, heapTagStats(HeapTag::Heartbeat).bytes);
+}
+
+TEST_F(HeapTrackerTest, TooManyTasksFallBackToOther) {
+    std::vector<std::unique_ptr<HeapTagScope>> scopes;
+    for (uintptr_t t = 1; t <= HEAP_TAG_TASKS + 1; ++t) {
+        test_heapSetTask(t);
+        scopes.emplace_back(new HeapTagScope(HeapTag::Web));
+    }
+    heapNoteAlloc(1, true);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Other).allocs);
+    EXPECT_EQ(1u, heapTotals().scopeMisses);
+    test_heapSetTask(1);
+    heapNoteAlloc(1, true);
+    EXPECT_EQ(1u, heapTagStats(HeapTag::Web).allocs);
+}
+
+TEST_F(HeapTrackerTest, TotalsAndNetBytes) {
+    heapNoteAlloc(200, true);
+    {
+        HeapTagScope web(HeapTag::Web);
+        heapNoteAlloc(300, true);
+    }
+    heapNoteFree(200);
+    HeapTotals t = heapTotals();
+    EXPECT_EQ(2u, t.allocs);
+    EXPECT_EQ(500u, t.bytes);
+    EXPECT_EQ(1u, t.frees);
+    EXPECT_EQ(300u, t.bytes - t.freedBytes);
+}
+
+TEST_F(HeapTrackerTest, MeterReportsPerSecondPerTag) {
+    HeapTagMeter meter;
+    float perSec[HEAP_TAG_COUNT];
+    meter.perSecond(1000, perSec);
+    {
+        HeapTagScope mqtt(HeapTag::Mqtt);
+        for (int i = 0; i < 20; ++i) heapNoteAlloc(16, true);
+    }
+    meter.perSecond(3000, perSec);
+    EXPECT_FLOAT_EQ(10.0f, perSec[static_cast<uint8_t>(HeapTag::Mqtt)]);
+    EXPECT_FLOAT_EQ(0.0f, perSec[static_cast<uint8_t>(HeapTag::Web)]);
+}
+
+TEST_F(HeapTrackerTest, FragmentationFromLargestBlock) {
+    EXPECT_EQ(0, heapFragmentationPct(0, 0));
+    EXPECT_EQ(0, heapFragmentationPct(100000, 100000));
+    EXPECT_EQ(75, heapFragmentationPct(100000, 25000));
+    EXPECT_EQ(100, heapFragmentationPct(100000, 0));
+}
+
+TEST_F(HeapTrackerTest, EveryTagHasAName) {
+    EXPECT_STREQ("other", heapTagName(HeapTag::Other));
+    EXPECT_STREQ("ota", heapTagName(HeapTag::Ota));
+    EXPECT_STREQ("none", heapTagName(HeapTag::Count));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,465 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Short timeouts and a small pool so the limits are reachable in a test
+#define HTTP_CORE_MAX_CONNECTIONS 4
+#define HTTP_CORE_IDLE_MS 400
+#define HTTP_CORE_REQUEST_MS 300
+#define HTTP_CORE_STALL_MS 1000
+
+// Include production code
+#include "../../src/http_request.cpp"
+#include "../../src/http_core.cpp"
+
+#include "../helpers/http_test_client.h"
+
+using httptest::Client;
+using httptest::eventually;
+using httptest::PollThread;
+using httptest::Response;
+using httptest::fetch;
+
+namespace {
+
+const uint16_t kGet = httpMethodBit(HttpMethod::Get) | httpMethodBit(HttpMethod::Head);
+const uint16_t kPost = httpMethodBit(HttpMethod::Post);
+
+// Body produced on demand: `total` bytes of a repeating pattern
+class PatternSource : public HttpBodySource {
+public:
+    explicit PatternSource(size_t total) : left_(total) {}
+    long read(uint8_t* buffer, size_t length) override {
+        size_t n = std::min(length, left_);
+        for (size_t i = 0; i < n; ++i) buffer[i] = (uint8_t)('a' + (produced_++ % 26));
+        left_ -= n;
+        return (long)n;
+    }
+
+private:
+    size_t left_;
+    size_t produced_ = 0;
+};
+
+std::string pattern(size_t total) {
+    std::string s;
+    for (size_t i = 0; i < total; ++i) s += (char)('a' + (i % 26));
+    return s;
+}
+
+struct UploadLog {
+    std::mutex mutex;
+    std::vector<HttpUploadEvent::Phase> phases;
+    std::string filename;
+    std::string data;
+    size_t total = 0;
+};
+
+}  // namespace
+
+class HttpCoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        core.on("/hello", kGet, [](HttpRequest& req, HttpResponse& res) {
+            const std::string* name = req.arg("name");
+            res.addHeader("X-Route", "hello");
+            res.send(200, "text/plain", "hi " + (name ? *name : std::string("there")));
+        });
+        core.on("/echo", kPost, [](HttpRequest& req, HttpResponse& res) {
+            res.send(200, "text/plain", req.body);
+        });
+        core.on("/big", kGet, [](HttpRequest&, HttpResponse& res) {
+            res.sendSource(200, "text/plain", std::unique_ptr<HttpBodySource>(new PatternSource(300000)), 300000);
+        });
+        core.on("/stream", kGet, [](HttpRequest&, HttpResponse& res) {
+            res.beginChunked(200, "text/plain");
+            for (int i = 0; i < 5; ++i) res.writeChunk("line\n", 5);
+            res.endChunked();
+        });
+        core.on("/pattern", kGet, [](HttpRequest&, HttpResponse& res) {
+            res.sendSource(200, "text/plain", std::unique_ptr<HttpBodySource>(new PatternSource(100000)), -1);
+        });
+        // Writes until the client falls too far behind, as a log download did
+        core.on("/flood", kGet, [this](HttpRequest&, HttpResponse& res) {
+            std::string piece(1024, 'f');
+            res.beginChunked(200, "text/plain");
+            for (size_t sent = 0; sent < (64u << 20) && res.writeChunk(piece.data(), piece.size());) {
+                sent += piece.size();
+            }
+            floodReturned = true;
+        });
+        core.on("/silent", kGet, [](HttpRequest&, HttpResponse&) {});
+        core.on("/nocontent", kGet, [](HttpRequest&, HttpResponse& res) { res.send(204, "text/plain", "ignored"); });
+        core.on("/static", kGet, [](HttpRequest&, HttpResponse& res) {
+            static const uint8_t kBody[] = "from flash";
+            res.sendStatic(200, "text/plain", kBody, sizeof(kBody) - 1);
+        });
+        core.on("/detach", kGet, [](HttpRequest&, HttpResponse& res) {
+            int fd = res.detach();
+            const char reply[] = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nConnection: close\r\n\r\nmine";
+            ::send(fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL);
+            close(fd);
+        });
+        core.on("/upload", kPost,
+                [this](HttpRequest& req, HttpResponse& res) {
+                    const std::string* note = req.arg("note");
+                    res.send(200, "text/plain", "stored " + std::to_string(uploads.data.size()) + " " +
+                                                    (note ? *note : std::string("-")));
+                },
+                [this](HttpRequest&, const HttpUploadEvent& ev) {
+                    std::lock_guard<std::mutex> lock(uploads.mutex);
+                    uploads.phases.push_back(ev.phase);
+                    if (ev.phase == HttpUploadEvent::Phase::Start) uploads.filename = ev.part->filename;
+                    if (ev.phase == HttpUploadEvent::Phase::Data) {
+                        uploads.data.append(reinterpret_cast<const char*>(ev.data), ev.length);
+                    }
+                    uploads.total = ev.total;
+                });
+        ASSERT_TRUE(core.begin(0, true));
+        port = core.port();
+        ASSERT_NE(0, port);
+    }
+
+    void TearDown() override {
+        poller.reset();
+        core.end();
+    }
+
+    // Runs poll() on a background thread for the rest of the test
+    void serve() {
+        poller.reset(new PollThread([this]() { core.poll(5); }));
+    }
+
+    HttpServerCore core;
+    uint16_t port = 0;
+    UploadLog uploads;
+    std::atomic<bool> floodReturned{false};
+    std::unique_ptr<PollThread> poller;
+};
+
+TEST_F(HttpCoreTest, AnswersRoutesAnd404) {
+    serve();
+    Response r = fetch(port, "GET /hello?name=clock HTTP/1.1\r\nHost: x\r\n\r\n");
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("hi clock", r.body);
+    EXPECT_EQ("text/plain", r.header("Content-Type"));
+    EXPECT_EQ("hello", r.header("X-Route"));
+    EXPECT_EQ("8", r.header("Content-Length"));
+
+    r = fetch(port, "GET /nope HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(404, r.status);
+    // Known path, other method: still not routed
+    r = fetch(port, "POST /hello HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_EQ(404, r.status);
+}
+
+TEST_F(HttpCoreTest, HeadGetsHeadersOnly) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("HEAD /hello HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\n\r\n"));
+    Response head = c.read(true);
+    EXPECT_EQ(200, head.status);
+    EXPECT_EQ("8", head.header("Content-Length"));
+    // No body bytes came before the next response
+    Response get = c.read();
+    EXPECT_EQ(200, get.status);
+    EXPECT_EQ("hi there", get.body);
+}
+
+TEST_F(HttpCoreTest, KeepAliveAndPipelining) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("GET /hello?name=1 HTTP/1.1\r\n\r\n"
+                       "POST /echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nabcde"
+                       "GET /hello?name=3 HTTP/1.1\r\n\r\n"));
+    EXPECT_EQ("hi 1", c.read().body);
+    EXPECT_EQ("abcde", c.read().body);
+    Response third = c.read();
+    EXPECT_EQ("hi 3", third.body);
+    EXPECT_EQ("keep-alive", third.header("Connection"));
+
+    ASSERT_TRUE(c.send("GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n"));
+    Response last = c.read();
+    EXPECT_EQ("close", last.header("Connection"));
+    EXPECT_TRUE(c.peerClosed());
+
+    HttpServerCore::Stats s = core.stats();
+    EXPECT_EQ(1u, s.accepted);
+    EXPECT_EQ(4u, s.requests);
+    EXPECT_EQ(3u, s.reused);
+}
+
+TEST_F(HttpCoreTest, RequestArrivingByteByByte) {
+    serve();
+    Client c(port);
+    std::string req = "POST /echo HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz";
+    for (char ch : req) {
+        ASSERT_TRUE(c.send(std::string(1, ch)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ("xyz", c.read().body);
+}
+
+TEST_F(HttpCoreTest, SlowClientDoesNotHoldUpOthers) {
+    serve();
+    Client slow(port);
+    ASSERT_TRUE(slow.send("GET /hello HTTP/1.1\r\nHo"));
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(200, fetch(port, "GET /hello HTTP/1.1\r\n\r\n").status);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+    ASSERT_TRUE(slow.send("st: x\r\n\r\n"));
+    EXPECT_EQ("hi there", slow.read().body);
+}
+
+TEST_F(HttpCoreTest, LargeBodyDrainsWhileOthersAreServed) {
+    serve();
+    Client reader(port);
+    ASSERT_TRUE(reader.send("GET /big HTTP/1.1\r\n\r\n"));
+    // The reader takes nothing yet; the socket buffers fill and the rest waits
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(200, fetch(port, "GET /hello HTTP/1.1\r\n\r\n").status);
+    Response big = reader.read();
+    EXPECT_EQ(200, big.status);
+    EXPECT_EQ("300000", big.header("Content-Length"));
+    EXPECT_EQ(pattern(300000), big.body);
+}
+
+TEST_F(HttpCoreTest, ReaderThatStopsDoesNotBlockOthers) {
+    serve();
+    Client stalled(port);
+    ASSERT_TRUE(stalled.send("GET /flood HTTP/1.1\r\n\r\n"));
+    // The handler is not held until the stall timeout: once the socket and
+    // the chunk queue are full it is told the client is gone
+    EXPECT_TRUE(eventually([this]() { return floodReturned.load(); }, 250));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(200, fetch(port, "GET /hello HTTP/1.1\r\n\r\n").status);
+    Response r = fetch(port, "GET /pattern HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("chunked", r.header("Transfer-Encoding"));
+    EXPECT_EQ(pattern(100000), r.body);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+    // And the connection it was writing to goes once it stops moving
+    EXPECT_TRUE(eventually([this]() { return core.stats().timeouts == 1; }, HTTP_CORE_STALL_MS + 500));
+}
+
+TEST_F(HttpCoreTest, ChunkedStaticAndBodylessResponses) {
+    serve();
+    Response r = fetch(port, "GET /stream HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("chunked", r.header("Transfer-Encoding"));
+    EXPECT_EQ("line\nline\nline\nline\nline\n", r.body);
+
+    // HTTP/1.0 has no chunking: the body ends when the connection does
+    r = fetch(port, "GET /stream HTTP/1.0\r\n\r\n");
+    EXPECT_EQ("", r.header("Transfer-Encoding"));
+    EXPECT_EQ("close", r.header("Connection"));
+    EXPECT_EQ("line\nline\nline\nline\nline\n", r.body);
+
+    r = fetch(port, "GET /static HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("from flash", r.body);
+
+    Client c(port);
+    ASSERT_TRUE(c.send("GET /nocontent HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\n\r\n"));
+    r = c.read();
+    EXPECT_EQ(204, r.status);
+    EXPECT_EQ("", r.header("Content-Length"));
+    EXPECT_EQ("hi there", c.read().body);
+}
+
+TEST_F(HttpCoreTest, HandlerWithoutResponseGets500) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("GET /silent HTTP/1.1\r\n\r\nGET /hello HTTP/1.1\r\n\r\n"));
+    EXPECT_EQ(500, c.read().status);
+    EXPECT_EQ(200, c.read().status);
+}
+
+TEST_F(HttpCoreTest, OversizedRequestsAreRefused) {
+    serve();
+    Client head(port);
+    ASSERT_TRUE(head.send("GET /hello HTTP/1.1\r\nX: " + std::string(HTTP_MAX_HEADER_BYTES, 'a') + "\r\n\r\n"));
+    Response r = head.read();
+    EXPECT_EQ(431, r.status);
+    EXPECT_EQ("close", r.header("Connection"));
+
+    Client body(port);
+    ASSERT_TRUE(body.send("POST /echo HTTP/1.1\r\nContent-Length: " + std::to_string(HTTP_MAX_BODY_BYTES + 1) +
+                          "\r\n\r\n"));
+    r = body.read();
+    EXPECT_EQ(413, r.status);
+    EXPECT_TRUE(body.peerClosed());
+
+    r = fetch(port, "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n");
+    EXPECT_EQ(501, r.status);
+
+    r = fetch(port, "GET / HTTP/3\r\n\r\n");
+    EXPECT_EQ(505, r.status);
+
+    // A body right at the limit is fine
+    std::string fits(HTTP_MAX_BODY_BYTES, 'q');
+    r = fetch(port, "POST /echo HTTP/1.1\r\nContent-Length: " + std::to_string(fits.size()) + "\r\n\r\n" + fits);
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(fits, r.body);
+    EXPECT_TRUE(eventually([this]() { return core.stats().rejected == 4; }));
+}
+
+TEST_F(HttpCoreTest, ExpectContinueIsAnsweredBeforeTheBody) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("POST /echo HTTP/1.1\r\nContent-Length: 4\r\nExpect: 100-continue\r\n\r\n"));
+    char buf[64];
+    ssize_t n = recv(c.fd(), buf, sizeof(buf), 0);
+    ASSERT_GT(n, 0);
+    EXPECT_EQ("HTTP/1.1 100 Continue\r\n\r\n", std::string(buf, (size_t)n));
+    ASSERT_TRUE(c.send("body"));
+    EXPECT_EQ("body", c.read().body);
+
+    // Too large: refused without a 100, so the client never sends it
+    Client big(port);
+    ASSERT_TRUE(big.send("POST /echo HTTP/1.1\r\nContent-Length: 999999\r\nExpect: 100-continue\r\n\r\n"));
+    Response r = big.read();
+    EXPECT_EQ(413, r.status);
+    EXPECT_EQ(0, big.continues);
+}
+
+TEST_F(HttpCoreTest, IncompleteRequestTimesOutWith408) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("POST /echo HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc"));
+    Response r = c.read();
+    EXPECT_EQ(408, r.status);
+    EXPECT_TRUE(c.peerClosed());
+    EXPECT_EQ(1u, core.stats().timeouts);
+}
+
+TEST_F(HttpCoreTest, IdleKeepAliveConnectionsAreClosed) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("GET /hello HTTP/1.1\r\n\r\n"));
+    EXPECT_EQ(200, c.read().status);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(c.peerClosed());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(HTTP_CORE_IDLE_MS - 100));
+    EXPECT_TRUE(eventually([this]() { return core.connectionCount() == 0; }));
+}
+
+TEST_F(HttpCoreTest, FullPoolEvictsTheLongestIdle) {
+    serve();
+    std::vector<std::unique_ptr<Client>> idle;
+    for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS; ++i) {
+        idle.emplace_back(new Client(port));
+        ASSERT_TRUE(idle.back()->send("GET /hello HTTP/1.1\r\n\r\n"));
+        EXPECT_EQ(200, idle.back()->read().status);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ((size_t)HTTP_CORE_MAX_CONNECTIONS, core.connectionCount());
+
+    EXPECT_EQ(200, fetch(port, "GET /hello HTTP/1.1\r\n\r\n").status);
+    EXPECT_TRUE(idle[0]->peerClosed());  // idle the longest
+    EXPECT_TRUE(eventually([this]() { return core.stats().evicted == 1; }));
+}
+
+TEST_F(HttpCoreTest, BusyPoolQueuesNewClients) {
+    serve();
+    // Every slot mid-request: nothing can be evicted
+    std::vector<std::unique_ptr<Client>> busy;
+    for (int i = 0; i < HTTP_CORE_MAX_CONNECTIONS; ++i) {
+        busy.emplace_back(new Client(port));
+        ASSERT_TRUE(busy.back()->send("GET /hello HTTP/1.1\r\n"));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Client waiting(port);
+    ASSERT_TRUE(waiting.send("GET /hello HTTP/1.1\r\n\r\n"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ((size_t)HTTP_CORE_MAX_CONNECTIONS, core.connectionCount());
+    // One finishes; the waiting client is taken in and answered
+    ASSERT_TRUE(busy[0]->send("Connection: close\r\n\r\n"));
+    EXPECT_EQ(200, busy[0]->read().status);
+    EXPECT_EQ("hi there", waiting.read().body);
+    EXPECT_EQ(0u, core.stats().evicted);
+}
+
+TEST_F(HttpCoreTest, MultipartUploadIsStreamedToTheUploadHandler) {
+    serve();
+    std::string file = pattern(50000);
+    std::string body = "--XX\r\nContent-Disposition: form-data; name=\"note\"\r\n\r\nv2\r\n"
+                       "--XX\r\nContent-Disposition: form-data; name=\"firmware\"; filename=\"fw.bin\"\r\n"
+                       "Content-Type: application/octet-stream\r\n\r\n" +
+                       file + "\r\n--XX--\r\n";
+    // Larger than HTTP_MAX_BODY_BYTES: uploads are not buffered
+    ASSERT_GT(body.size(), (size_t)HTTP_MAX_BODY_BYTES);
+    Client c(port);
+    ASSERT_TRUE(c.send("POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=XX\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n"));
+    for (size_t at = 0; at < body.size(); at += 1000) ASSERT_TRUE(c.send(body.substr(at, 1000)));
+    Response r = c.read();
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("stored 50000 v2", r.body);
+
+    std::lock_guard<std::mutex> lock(uploads.mutex);
+    EXPECT_EQ("fw.bin", uploads.filename);
+    EXPECT_EQ(file, uploads.data);
+    EXPECT_EQ(50000u, uploads.total);
+    ASSERT_GE(uploads.phases.size(), 3u);
+    EXPECT_EQ(HttpUploadEvent::Phase::Start, uploads.phases.front());
+    EXPECT_EQ(HttpUploadEvent::Phase::End, uploads.phases.back());
+}
+
+TEST_F(HttpCoreTest, UploadCutShortIsAborted) {
+    serve();
+    {
+        Client c(port);
+        ASSERT_TRUE(c.send("POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=XX\r\n"
+                           "Content-Length: 100000\r\n\r\n"
+                           "--XX\r\nContent-Disposition: form-data; name=\"f\"; filename=\"a\"\r\n\r\npartial data"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::lock_guard<std::mutex> lock(uploads.mutex);
+    ASSERT_FALSE(uploads.phases.empty());
+    EXPECT_EQ(HttpUploadEvent::Phase::Start, uploads.phases.front());
+    EXPECT_EQ(HttpUploadEvent::Phase::Aborted, uploads.phases.back());
+}
+
+TEST_F(HttpCoreTest, DetachedSocketBelongsToTheHandler) {
+    serve();
+    Client c(port);
+    ASSERT_TRUE(c.send("GET /detach HTTP/1.1\r\n\r\n"));
+    Response r = c.read();
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("mine", r.body);
+    EXPECT_TRUE(c.peerClosed());
+    EXPECT_TRUE(eventually([this]() { return core.stats().detached == 1 && core.connectionCount() == 0; }));
+}
+
+TEST_F(HttpCoreTest, ManyConcurrentClients) {
+    serve();
+    const int kThreads = 16;
+    const int kRequests = 25;
+    std::atomic<int> ok{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            Client c(port);
+            for (int i = 0; i < kRequests; ++i) {
+                std::string name = std::to_string(t) + "-" + std::to_string(i);
+                if (!c.send("GET /hello?name=" + name + " HTTP/1.1\r\n\r\n")) break;
+                Response r = c.read();
+                if (r.body == "hi " + name) ok++;
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    // More clients than slots: some keep-alive connections were evicted
+    // mid-run; the ones that were all got complete, correct answers first
+    EXPECT_GT(ok.load(), kThreads * kRequests / 2);
+    EXPECT_LE(core.connectionCount(), (size_t)HTTP_CORE_MAX_CONNECTIONS);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
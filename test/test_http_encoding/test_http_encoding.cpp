@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+// Include production code
+#include "../../src/http_encoding.cpp"
+
+namespace {
+
+std::vector<ContentCoding> rank(const char* header) {
+    ContentCoding out[3];
+    size_t n = rankContentCodings(header, out);
+    return std::vector<ContentCoding>(out, out + n);
+}
+
+const ContentCoding kBr = ContentCoding::Brotli;
+const ContentCoding kGz = ContentCoding::Gzip;
+const ContentCoding kId = ContentCoding::Identity;
+
+}  // namespace
+
+TEST(HttpEncodingTest, NamesAndSuffixes) {
+    EXPECT_STREQ("gzip", contentCodingName(kGz));
+    EXPECT_STREQ("br", contentCodingName(kBr));
+    EXPECT_STREQ("identity", contentCodingName(kId));
+    EXPECT_STREQ(".gz", contentCodingSuffix(kGz));
+    EXPECT_STREQ(".br", contentCodingSuffix(kBr));
+    EXPECT_STREQ("", contentCodingSuffix(kId));
+}
+
+TEST(HttpEncodingTest, BrowserHeadersPreferSmallest) {
+    // Chrome / Firefox / Safari
+    EXPECT_EQ((std::vector<ContentCoding>{kBr, kGz, kId}), rank("gzip, deflate, br, zstd"));
+    EXPECT_EQ((std::vector<ContentCoding>{kBr, kGz, kId}), rank("gzip, deflate, br"));
+    EXPECT_EQ((std::vector<ContentCoding>{kGz, kId}), rank("gzip, deflate"));
+}
+
+TEST(HttpEncodingTest, NoHeaderMeansIdentityOnly) {
+    EXPECT_EQ((std::vector<ContentCoding>{kId}), rank(nullptr));
+    EXPECT_EQ((std::vector<ContentCoding>{kId}), rank(""));
+    EXPECT_EQ(0, acceptEncodingQuality("", kGz));
+}
+
+TEST(HttpEncodingTest, QualityValuesOrderAndRefuse) {
+    EXPECT_EQ(500, acceptEncodingQuality("gzip;q=0.5", kGz));
+    EXPECT_EQ(1000, acceptEncodingQuality("gzip;q=1.0", kGz));
+    EXPECT_EQ(125, acceptEncodingQuality("gzip; q=0.125", kGz));
+    EXPECT_EQ(0, acceptEncodingQuality("gzip;q=0", kGz));
+    EXPECT_EQ(0, acceptEncodingQuality("gzip;q=0.000", kGz));
+
+    // Unlisted identity keeps its implicit q=1
+    EXPECT_EQ((std::vector<ContentCoding>{kGz, kId, kBr}), rank("br;q=0.5, gzip"));
+    EXPECT_EQ((std::vector<ContentCoding>{kBr, kId}), rank("gzip;q=0, br"));
+}
+
+TEST(HttpEncodingTest, TokensAreCaseInsensitiveAndXGzipIsGzip) {
+    EXPECT_EQ(1000, acceptEncodingQuality("GZIP", kGz));
+    EXPECT_EQ(1000, acceptEncodingQuality("x-gzip", kGz));
+    EXPECT_EQ(1000, acceptEncodingQuality("deflate, BR", kBr));
+    // Prefixes do not match
+    EXPECT_EQ(0, acceptEncodingQuality("gzipped", kGz));
+    EXPECT_EQ(0, acceptEncodingQuality("brotli", kBr));
+}
+
+TEST(HttpEncodingTest, IdentityCanBeRefused) {
+    EXPECT_EQ((std::vector<ContentCoding>{kGz}), rank("gzip, identity;q=0"));
+    EXPECT_EQ((std::vector<ContentCoding>{kGz}), rank("gzip, *;q=0"));
+    // Explicit identity beats the wildcard
+    EXPECT_EQ((std::vector<ContentCoding>{kGz, kId}), rank("gzip, identity, *;q=0"));
+    // A client that refuses everything gets an empty list; the caller decides
+    EXPECT_TRUE(rank("identity;q=0").empty());
+}
+
+TEST(HttpEncodingTest, WildcardCoversUnlisted) {
+    EXPECT_EQ((std::vector<ContentCoding>{kBr, kGz, kId}), rank("*"));
+    EXPECT_EQ((std::vector<ContentCoding>{kBr, kId, kGz}), rank("gzip;q=0.2, *;q=0.8"));
+}
+
+TEST(HttpEncodingTest, ToleratesOddSpacingAndParameters) {
+    EXPECT_EQ((std::vector<ContentCoding>{kBr, kGz, kId}), rank(" ,gzip ,,  br ;level=3 ,"));
+    EXPECT_EQ(700, acceptEncodingQuality("gzip;foo=bar;q=0.7", kGz));
+    EXPECT_EQ(1000, acceptEncodingQuality("gzip;q=", kGz));
+}
+
+TEST(HttpEncodingTest, GzipHeaderLengthSkipsOptionalFields) {
+    // Plain 10-byte header as written by gzip_data.py with no name
+    const uint8_t bare[] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 2, 3, 0xAA};
+    EXPECT_EQ(10u, gzipHeaderLength(bare, sizeof(bare)));
+
+    // FNAME "a.js" + FHCRC
+    const uint8_t named[] = {0x1f, 0x8b, 8, 0x08 | 0x02, 0, 0, 0, 0, 2, 3,
+                             'a', '.', 'j', 's', 0, 0x12, 0x34, 0xAA};
+    EXPECT_EQ(17u, gzipHeaderLength(named, sizeof(named)));
+
+    // FEXTRA (3 bytes) + FCOMMENT ""
+    const uint8_t extra[] = {0x1f, 0x8b, 8, 0x04 | 0x10, 0, 0, 0, 0, 2, 3,
+                             3, 0, 'x', 'y', 'z', 0, 0xAA};
+    EXPECT_EQ(16u, gzipHeaderLength(extra, sizeof(extra)));
+}
+
+TEST(HttpEncodingTest, GzipHeaderLengthRejectsBadInput) {
+    const uint8_t notGzip[] = {'<', '!', 'D', 'O', 'C', 'T', 'Y', 'P', 'E', ' '};
+    EXPECT_EQ(0u, gzipHeaderLength(notGzip, sizeof(notGzip)));
+    const uint8_t shortHeader[] = {0x1f, 0x8b, 8, 0};
+    EXPECT_EQ(0u, gzipHeaderLength(shortHeader, sizeof(shortHeader)));
+    // Name never terminated inside the buffer
+    const uint8_t cut[] = {0x1f, 0x8b, 8, 0x08, 0, 0, 0, 0, 2, 3, 'a', 'b'};
+    EXPECT_EQ(0u, gzipHeaderLength(cut, sizeof(cut)));
+    // Method other than deflate
+    const uint8_t stored[] = {0x1f, 0x8b, 7, 0, 0, 0, 0, 0, 2, 3};
+    EXPECT_EQ(0u, gzipHeaderLength(stored, sizeof(stored)));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+// Include production code
+#include "../../src/http_request.cpp"
+
+namespace {
+
+HttpHeadStatus parse(const std::string& text, HttpRequest& out, size_t* headLength = nullptr,
+                     int* errorStatus = nullptr) {
+    size_t length = 0;
+    int status = 0;
+    HttpHeadStatus result = parseHttpHead(text.data(), text.size(), out, length, status);
+    if (headLength) *headLength = length;
+    if (errorStatus) *errorStatus = status;
+    return result;
+}
+
+int errorFor(const std::string& text) {
+    HttpRequest r;
+    int status = 0;
+    EXPECT_EQ(HttpHeadStatus::Error, parse(text, r, nullptr, &status));
+    return status;
+}
+
+std::string argOr(const HttpRequest& r, const char* name, const char* fallback = "<none>") {
+    const std::string* v = r.arg(name);
+    return v ? *v : fallback;
+}
+
+struct Recorded {
+    std::vector<MultipartPart> parts;
+    std::vector<std::string> data;
+    int ends = 0;
+};
+
+void record(void* ctx, MultipartParser::Event event, const MultipartPart& part, const char* data, size_t length) {
+    Recorded* r = static_cast<Recorded*>(ctx);
+    switch (event) {
+        case MultipartParser::Event::PartBegin:
+            r->parts.push_back(part);
+            r->data.emplace_back();
+            break;
+        case MultipartParser::Event::PartData:
+            r->data.back().append(data, length);
+            break;
+        case MultipartParser::Event::PartEnd:
+            r->ends++;
+            break;
+    }
+}
+
+const char kBoundaryType[] = "multipart/form-data; boundary=----xyz";
+const std::string kMultipartBody =
+    "preamble\r\n"
+    "------xyz\r\n"
+    "Content-Disposition: form-data; name=\"note\"\r\n"
+    "\r\n"
+    "hello\r\n"
+    "------xyz\r\n"
+    "Content-Disposition: form-data; name=\"file\"; filename=\"fw.bin\"\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "\r\n"
+    "\x01\x02\r\n-----xy\r\n--\x03"  // almost-boundaries inside the data
+    "\r\n"
+    "------xyz--\r\n"
+    "epilogue";
+
+}  // namespace
+
+TEST(HttpRequestTest, ParsesRequestLineHeadersAndQuery) {
+    HttpRequest r;
+    size_t headLength = 0;
+    std::string text = "GET /api/logs%20x?level=warn&q=a+b%26c HTTP/1.1\r\n"
+                       "Host: clock.local\r\n"
+                       "Accept-Encoding:  gzip, br \r\n"
+                       "\r\n";
+    ASSERT_EQ(HttpHeadStatus::Complete, parse(text + "NEXT", r, &headLength));
+    EXPECT_EQ(text.size(), headLength);
+    EXPECT_EQ(HttpMethod::Get, r.method);
+    EXPECT_EQ("/api/logs x", r.path);
+    EXPECT_EQ("level=warn&q=a+b%26c", r.query);
+    EXPECT_EQ("warn", argOr(r, "level"));
+    EXPECT_EQ("a b&c", argOr(r, "q"));
+    EXPECT_FALSE(r.http10);
+    EXPECT_TRUE(r.keepAlive);
+    // Case-insensitive names, trimmed values
+    ASSERT_NE(nullptr, r.header("accept-encoding"));
+    EXPECT_EQ("gzip, br", *r.header("accept-encoding"));
+    EXPECT_EQ(nullptr, r.header("Cookie"));
+}
+
+TEST(HttpRequestTest, NeedsMoreUntilTheBlankLine) {
+    const std::string text = "POST /setColor HTTP/1.1\r\nContent-Length: 3\r\n\r\n";
+    HttpRequest r;
+    for (size_t n = 0; n < text.size(); ++n) {
+        EXPECT_EQ(HttpHeadStatus::NeedMore, parse(text.substr(0, n), r)) << n;
+    }
+    EXPECT_EQ(HttpHeadStatus::Complete, parse(text, r));
+    EXPECT_EQ(HttpMethod::Post, r.method);
+    EXPECT_EQ(3u, r.contentLength);
+}
+
+TEST(HttpRequestTest, AcceptsBareLineFeedsAndLeadingBlankLines) {
+    HttpRequest r;
+    size_t headLength = 0;
+    std::string text = "\r\n\nDELETE /x HTTP/1.1\nHost: a\n\n";
+    ASSERT_EQ(HttpHeadStatus::Complete, parse(text, r, &headLength));
+    EXPECT_EQ(text.size(), headLength);
+    EXPECT_EQ(HttpMethod::Delete, r.method);
+    ASSERT_NE(nullptr, r.header("Host"));
+    EXPECT_EQ("a", *r.header("Host"));
+}
+
+TEST(HttpRequestTest, KeepAliveFollowsVersionAndConnectionHeader) {
+    HttpRequest r;
+    parse("GET / HTTP/1.0\r\n\r\n", r);
+    EXPECT_TRUE(r.http10);
+    EXPECT_FALSE(r.keepAlive);
+
+    parse("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", r);
+    EXPECT_TRUE(r.keepAlive);
+
+    parse("GET / HTTP/1.1\r\nConnection: TE, close\r\n\r\n", r);
+    EXPECT_FALSE(r.keepAlive);
+}
+
+TEST(HttpRequestTest, AbsoluteFormTargetKeepsOnlyThePath) {
+    HttpRequest r;
+    parse("GET http://clock.local/status?x=1 HTTP/1.1\r\n\r\n", r);
+    EXPECT_EQ("/status", r.path);
+    EXPECT_EQ("1", argOr(r, "x"));
+}
+
+TEST(HttpRequestTest, UnknownMethodsParseAsOther) {
+    HttpRequest r;
+    ASSERT_EQ(HttpHeadStatus::Complete, parse("PROPFIND / HTTP/1.1\r\n\r\n", r));
+    EXPECT_EQ(HttpMethod::Other, r.method);
+}
+
+TEST(HttpRequestTest, MalformedHeadsGetTheRightStatus) {
+    EXPECT_EQ(400, errorFor("GET\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("GET  HTTP/1.1\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("GET relative HTTP/1.1\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("GET / FTP/1.1\r\n\r\n"));
+    EXPECT_EQ(505, errorFor("GET / HTTP/2.0\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("GET / HTTP/1.1\r\nNoColon\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("POST / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n"));
+    EXPECT_EQ(400, errorFor("POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n"));
+    EXPECT_EQ(501, errorFor("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"));
+}
+
+TEST(HttpRequestTest, OversizedHeadIs431) {
+    std::string text = "GET / HTTP/1.1\r\nX-Pad: " + std::string(HTTP_MAX_HEADER_BYTES, 'a');
+    EXPECT_EQ(431, errorFor(text));
+    // Even once complete
+    EXPECT_EQ(431, errorFor(text + "\r\n\r\n"));
+    // Just under the limit is fine
+    HttpRequest r;
+    std::string fits = "GET / HTTP/1.1\r\nX: ";
+    fits += std::string(HTTP_MAX_HEADER_BYTES - fits.size() - 4, 'a') + "\r\n\r\n";
+    ASSERT_EQ(HTTP_MAX_HEADER_BYTES, fits.size());
+    EXPECT_EQ(HttpHeadStatus::Complete, parse(fits, r));
+}
+
+TEST(HttpRequestTest, BodyFlagsAreParsed) {
+    HttpRequest r;
+    parse("PUT /x HTTP/1.1\r\nContent-Length: 42\r\nExpect: 100-continue\r\n\r\n", r);
+    EXPECT_EQ(42u, r.contentLength);
+    EXPECT_TRUE(r.expectContinue);
+    EXPECT_FALSE(r.chunkedBody);
+
+    parse("POST /x HTTP/1.1\r\nTransfer-Encoding: Chunked\r\n\r\n", r);
+    EXPECT_TRUE(r.chunkedBody);
+    EXPECT_FALSE(r.expectContinue);
+    EXPECT_EQ(0u, r.contentLength);
+}
+
+TEST(HttpRequestTest, FormBodiesBecomeArguments) {
+    HttpRequest r;
+    parse("POST /f?a=1 HTTP/1.1\r\nContent-Type: application/x-www-form-urlencoded; charset=UTF-8\r\n\r\n", r);
+    EXPECT_EQ("application/x-www-form-urlencoded", r.mediaType());
+    r.body = "b=two+words&flag&c=%3D";
+    finishHttpBody(r);
+    EXPECT_EQ("1", argOr(r, "a"));
+    EXPECT_EQ("two words", argOr(r, "b"));
+    EXPECT_EQ("", argOr(r, "flag"));
+    EXPECT_EQ("=", argOr(r, "c"));
+    EXPECT_EQ("<none>", argOr(r, "plain"));
+
+    // Anything else is "plain", as WebServer did for JSON posts
+    parse("POST /j HTTP/1.1\r\nContent-Type: application/json\r\n\r\n", r);
+    r.body = "{\"on\":true}";
+    finishHttpBody(r);
+    EXPECT_EQ("{\"on\":true}", argOr(r, "plain"));
+}
+
+TEST(HttpRequestTest, UrlDecodeLeavesBrokenEscapesAlone) {
+    EXPECT_EQ("a b", urlDecode("a%20b", 5, false));
+    EXPECT_EQ("a+b", urlDecode("a+b", 3, false));
+    EXPECT_EQ("a b", urlDecode("a+b", 3, true));
+    EXPECT_EQ("%zz%4", urlDecode("%zz%4", 5, false));
+    EXPECT_EQ("A", urlDecode("%41", 3, false));
+}
+
+TEST(HttpRequestTest, Base64DecodesCredentials) {
+    std::string out;
+    EXPECT_TRUE(base64Decode("YWRtaW46c2VjcmV0", out));
+    EXPECT_EQ("admin:secret", out);
+    EXPECT_TRUE(base64Decode("YQ==", out));
+    EXPECT_EQ("a", out);
+    EXPECT_TRUE(base64Decode("YWI", out));
+    EXPECT_EQ("ab", out);
+    EXPECT_FALSE(base64Decode("YW*i", out));
+}
+
+TEST(HttpRequestTest, ReasonPhrases) {
+    EXPECT_STREQ("OK", httpReasonPhrase(200));
+    EXPECT_STREQ("Content Too Large", httpReasonPhrase(413));
+    EXPECT_STREQ("Request Header Fields Too Large", httpReasonPhrase(431));
+    EXPECT_STREQ("", httpReasonPhrase(299));
+}
+
+TEST(MultipartParserTest, SplitsFieldsAndFiles) {
+    MultipartParser parser;
+    Recorded rec;
+    ASSERT_TRUE(parser.begin(kBoundaryType, record, &rec));
+    ASSERT_TRUE(parser.feed(kMultipartBody.data(), kMultipartBody.size()));
+    EXPECT_TRUE(parser.finished());
+    ASSERT_EQ(2u, rec.parts.size());
+    EXPECT_EQ(2, rec.ends);
+    EXPECT_EQ("note", rec.parts[0].name);
+    EXPECT_EQ("", rec.parts[0].filename);
+    EXPECT_EQ("hello", rec.data[0]);
+    EXPECT_EQ("file", rec.parts[1].name);
+    EXPECT_EQ("fw.bin", rec.parts[1].filename);
+    EXPECT_EQ("application/octet-stream", rec.parts[1].contentType);
+    EXPECT_EQ(std::string("\x01\x02\r\n-----xy\r\n--\x03"), rec.data[1]);
+}
+
+TEST(MultipartParserTest, ResultDoesNotDependOnHowBytesArrive) {
+    for (size_t step = 1; step <= 7; ++step) {
+        MultipartParser parser;
+        Recorded rec;
+        ASSERT_TRUE(parser.begin(kBoundaryType, record, &rec));
+        for (size_t at = 0; at < kMultipartBody.size(); at += step) {
+            size_t n = std::min(step, kMultipartBody.size() - at);
+            ASSERT_TRUE(parser.feed(kMultipartBody.data() + at, n)) << "step " << step << " at " << at;
+        }
+        EXPECT_TRUE(parser.finished()) << step;
+        ASSERT_EQ(2u, rec.parts.size()) << step;
+        EXPECT_EQ("hello", rec.data[0]) << step;
+        EXPECT_EQ(std::string("\x01\x02\r\n-----xy\r\n--\x03"), rec.data[1]) << step;
+    }
+}
+
+TEST(MultipartParserTest, LargePartPassesThroughInBoundedMemory) {
+    MultipartParser parser;
+    Recorded rec;
+    ASSERT_TRUE(parser.begin("multipart/form-data; boundary=\"b\"", record, &rec));
+    std::string head = "--b\r\nContent-Disposition: form-data; name=\"f\"; filename=\"x\"\r\n\r\n";
+    ASSERT_TRUE(parser.feed(head.data(), head.size()));
+    std::string block(1000, 'z');
+    for (int i = 0; i < 200; ++i) ASSERT_TRUE(parser.feed(block.data(), block.size()));
+    // Everything but a possible boundary prefix has been handed on
+    EXPECT_GE(rec.data[0].size(), 200000u - 4);
+    EXPECT_TRUE(parser.inPart());
+    std::string tail = "\r\n--b--";
+    ASSERT_TRUE(parser.feed(tail.data(), tail.size()));
+    EXPECT_TRUE(parser.finished());
+    EXPECT_EQ(200000u, rec.data[0].size());
+}
+
+TEST(MultipartParserTest, RejectsMissingBoundaryAndGarbage) {
+    MultipartParser parser;
+    Recorded rec;
+    EXPECT_FALSE(parser.begin("multipart/form-data", record, &rec));
+    EXPECT_FALSE(parser.feed("x", 1));
+
+    ASSERT_TRUE(parser.begin(kBoundaryType, record, &rec));
+    std::string bad = "------xyzJUNK";
+    EXPECT_FALSE(parser.feed(bad.data(), bad.size()));
+    EXPECT_FALSE(parser.finished());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,248 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/LittleFS.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Include production log implementation (with PIO_UNIT_TESTING stubs)
+#include "../../src/log.cpp"
+
+// Include production code
+#include "../../src/http_request.cpp"
+#include "../../src/http_core.cpp"
+#include "../../src/latency_histogram.cpp"
+#include "../../src/loop_profile.cpp"
+#include "../../src/http_server.cpp"
+
+#include "../helpers/http_test_client.h"
+
+using httptest::PollThread;
+using httptest::Response;
+using httptest::fetch;
+
+// Routes below are written exactly as web_routes.h writes them
+class HttpServerTest : public ::testing::Test {
+protected:
+    HttpServerTest() : server(0) {}
+
+    void SetUp() override {
+        mockfs::reset();
+        server.on("/status", HTTP_GET, [this]() {
+            String who = server.hasArg("who") ? server.arg("who") : String("nobody");
+            server.sendHeader("Cache-Control", "no-cache");
+            server.send(200, "text/plain", String("ok ") + who + " " + server.uri());
+        });
+        server.on("/any", [this]() {
+            server.send(200, "text/plain", server.method() == HTTP_POST ? "post" : "other");
+        });
+        server.on("/setColor", HTTP_POST, [this]() {
+            server.send(200, "application/json", server.arg("plain"));
+        });
+        server.on("/admin", HTTP_GET, [this]() {
+            if (!server.authenticate("admin", "s3cret")) {
+                server.requestAuthentication(BASIC_AUTH, "clock");
+                return;
+            }
+            server.send(200, "text/plain", "welcome");
+        });
+        server.on("/log", HTTP_GET, [this]() {
+            server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+            server.send(200, "text/plain", "");
+            for (int i = 0; i < 3; ++i) server.sendContent(String("line ") + String(i) + "\n");
+            server.sendContent("");
+        });
+        server.on("/flash", HTTP_GET, [this]() {
+            static const char kPage[] = "<html>embedded</html>";
+            server.sendHeader("Content-Encoding", "identity");
+            server.send_P(200, "text/html", kPage, sizeof(kPage) - 1);
+        });
+        server.on("/file", HTTP_GET, [this]() {
+            File f = LittleFS.open(server.arg("name"), "r");
+            if (!f) {
+                server.send(404, "text/plain", "missing");
+                return;
+            }
+            server.streamFile(f, "text/html");
+        });
+        server.on("/echoHeader", HTTP_GET, [this]() {
+            server.send(200, "text/plain", server.header("If-None-Match"));
+        });
+        server.on(
+            "/uploadFirmware", HTTP_POST,
+            [this]() { server.send(200, "text/plain", String("got ") + String((unsigned long)uploadTotal)); },
+            [this]() {
+                HTTPUpload& upload = server.upload();
+                if (upload.status == UPLOAD_FILE_START) {
+                    uploadName = upload.filename.c_str();
+                    uploadStatuses.push_back("start");
+                } else if (upload.status == UPLOAD_FILE_WRITE) {
+                    uploadData.append(reinterpret_cast<const char*>(upload.buf), upload.currentSize);
+                    maxPiece = std::max(maxPiece, upload.currentSize);
+                    uploadStatuses.push_back("write");
+                } else if (upload.status == UPLOAD_FILE_END) {
+                    uploadTotal = upload.totalSize;
+                    uploadStatuses.push_back("end");
+                }
+            });
+        server.begin();
+        ASSERT_NE(0, server.port());
+        poller.reset(new PollThread([this]() { server.poll(5); }));
+    }
+
+    void TearDown() override { poller.reset(); }
+
+    HttpServer server;
+    std::unique_ptr<PollThread> poller;
+    std::string uploadName;
+    std::string uploadData;
+    std::vector<std::string> uploadStatuses;
+    size_t uploadTotal = 0;
+    size_t maxPiece = 0;
+};
+
+TEST_F(HttpServerTest, WebServerStyleRoutes) {
+    Response r = fetch(server.port(), "GET /status?who=me HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("ok me /status", r.body);
+    EXPECT_EQ("no-cache", r.header("Cache-Control"));
+
+    r = fetch(server.port(), "POST /any HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+    EXPECT_EQ("post", r.body);
+    r = fetch(server.port(), "DELETE /any HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("other", r.body);
+
+    // A GET route answers HEAD too
+    r = fetch(server.port(), "HEAD /status HTTP/1.1\r\n\r\n", true);
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("", r.body);
+
+    r = fetch(server.port(), "GET /setColor HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(404, r.status);
+}
+
+TEST_F(HttpServerTest, JsonBodyIsThePlainArgument) {
+    std::string json = "{\"r\":255,\"g\":0}";
+    Response r = fetch(server.port(), "POST /setColor HTTP/1.1\r\nContent-Type: application/json\r\n"
+                                      "Content-Length: " + std::to_string(json.size()) + "\r\n\r\n" + json);
+    EXPECT_EQ(json, r.body);
+    EXPECT_EQ("application/json", r.header("Content-Type"));
+}
+
+TEST_F(HttpServerTest, EveryHeaderIsAvailable) {
+    Response r = fetch(server.port(), "GET /echoHeader HTTP/1.1\r\nIf-None-Match: \"v1-42\"\r\n\r\n");
+    EXPECT_EQ("\"v1-42\"", r.body);
+}
+
+TEST_F(HttpServerTest, BasicAuthentication) {
+    Response r = fetch(server.port(), "GET /admin HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(401, r.status);
+    EXPECT_EQ("Basic realm=\"clock\"", r.header("WWW-Authenticate"));
+
+    // admin:wrong
+    r = fetch(server.port(), "GET /admin HTTP/1.1\r\nAuthorization: Basic YWRtaW46d3Jvbmc=\r\n\r\n");
+    EXPECT_EQ(401, r.status);
+    // admin:s3cret
+    r = fetch(server.port(), "GET /admin HTTP/1.1\r\nAuthorization: Basic YWRtaW46czNjcmV0\r\n\r\n");
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("welcome", r.body);
+}
+
+TEST_F(HttpServerTest, UnknownLengthBecomesChunked) {
+    Response r = fetch(server.port(), "GET /log HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("chunked", r.header("Transfer-Encoding"));
+    EXPECT_EQ("line 0\nline 1\nline 2\n", r.body);
+}
+
+TEST_F(HttpServerTest, SendPAndStreamFile) {
+    Response r = fetch(server.port(), "GET /flash HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("<html>embedded</html>", r.body);
+    EXPECT_EQ("identity", r.header("Content-Encoding"));
+
+    std::string page(20000, 'p');
+    LittleFS.open("/page.html", "w").write(page.data(), page.size());
+    LittleFS.open("/page.html.gz", "w").write("\x1f\x8b", 2);
+
+    r = fetch(server.port(), "GET /file?name=/page.html HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ(page, r.body);
+    EXPECT_EQ("", r.header("Content-Encoding"));
+
+    // As WebServer: a .gz file name implies the encoding
+    r = fetch(server.port(), "GET /file?name=/page.html.gz HTTP/1.1\r\n\r\n");
+    EXPECT_EQ("gzip", r.header("Content-Encoding"));
+    EXPECT_EQ("\x1f\x8b", r.body);
+}
+
+TEST_F(HttpServerTest, UploadArrivesInWebServerSizedPieces) {
+    std::string file;
+    for (int i = 0; i < 10000; ++i) file += (char)(i * 7);
+    std::string body = "--b\r\nContent-Disposition: form-data; name=\"update\"; filename=\"firmware.bin\"\r\n\r\n" +
+                       file + "\r\n--b--\r\n";
+    Response r = fetch(server.port(), "POST /uploadFirmware HTTP/1.1\r\n"
+                                      "Content-Type: multipart/form-data; boundary=b\r\n"
+                                      "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+    EXPECT_EQ(200, r.status);
+    EXPECT_EQ("got 10000", r.body);
+    EXPECT_EQ("firmware.bin", uploadName);
+    EXPECT_EQ(file, uploadData);
+    EXPECT_EQ((size_t)HTTP_UPLOAD_BUFLEN, maxPiece);
+    ASSERT_GE(uploadStatuses.size(), 3u);
+    EXPECT_EQ("start", uploadStatuses.front());
+    EXPECT_EQ("end", uploadStatuses.back());
+    // 10000 bytes: six full pieces and the rest
+    EXPECT_EQ(7u, uploadStatuses.size() - 2);
+}
+
+// Many clients at once against a route that mutates shared state, while a
+// stand-in for loop() takes the app lock in a tight cycle: every request is
+// answered, and no handler ever runs inside a loop() pass.
+TEST_F(HttpServerTest, LoadTestSerializesHandlersWithLoop) {
+    std::atomic<bool> inLoop{false};
+    std::atomic<int> overlaps{0};
+    int counter = 0;  // guarded by the app lock only
+    server.on("/count", HTTP_POST, [&]() {
+        if (inLoop) overlaps++;
+        counter++;
+        server.send(200, "text/plain", String(counter));
+    });
+
+    std::atomic<bool> stop{false};
+    std::thread loopThread([&]() {
+        while (!stop) {
+            HttpAppLock appLock;
+            inLoop = true;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            inLoop = false;
+        }
+    });
+
+    const int kClients = 24;
+    const int kRequests = 40;
+    std::atomic<int> answered{0};
+    std::vector<std::thread> clients;
+    for (int t = 0; t < kClients; ++t) {
+        clients.emplace_back([&]() {
+            for (int i = 0; i < kRequests; ++i) {
+                // New connection per request: HTTP_CORE_MAX_CONNECTIONS is
+                // far below kClients, so the pool and backlog get exercised
+                Response r = fetch(server.port(), "POST /count HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+                if (r.status == 200) answered++;
+            }
+        });
+    }
+    for (std::thread& t : clients) t.join();
+    stop = true;
+    loopThread.join();
+
+    EXPECT_EQ(kClients * kRequests, answered.load());
+    HttpAppLock appLock;
+    EXPECT_EQ(kClients * kRequests, counter);
+    EXPECT_EQ(0, overlaps.load());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -12,6 +12,7 @@
 #include "../../src/time_mapper.cpp"
 #include "../../src/led_state.h"
 #include "../../src/led_state.cpp"
+#include "../../src/settings_store.cpp"
 
 // Mock night mode for integration
 #ifndef NIGHT_MODE_H
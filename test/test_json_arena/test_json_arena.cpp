@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <ArduinoJson.h>
+#include "../mocks/mock_arduino.h"
+#include <string>
+#include <thread>
+
+// Include production code
+#include "../../src/mem_pool.cpp"
+#include "../../src/json_arena.cpp"
+
+static const JsonArenaSite* findSite(const char* name) {
+    for (const JsonArenaSite* s = JsonArenaSite::first(); s; s = s->next()) {
+        if (strcmp(s->name(), name) == 0) return s;
+    }
+    return nullptr;
+}
+
+static void appendChunk(void* ctx, const char* data, size_t length) {
+    static_cast<std::vector<std::string>*>(ctx)->push_back(std::string(data, length));
+}
+
+TEST(JsonArenaTest, AllocatesInOrderAndFreesOnlyTheTop) {
+    JsonArena arena(256);
+    void* a = arena.allocate(10);
+    void* b = arena.allocate(20);
+    ASSERT_NE(nullptr, a);
+    ASSERT_NE(nullptr, b);
+    EXPECT_LT(a, b);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a) % 8);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b) % 8);
+    size_t afterB = arena.used();
+
+    arena.deallocate(a);  // not the top: nothing comes back
+    EXPECT_EQ(afterB, arena.used());
+    arena.deallocate(b);
+    EXPECT_LT(arena.used(), afterB);
+    EXPECT_EQ(afterB, arena.highWater());
+}
+
+TEST(JsonArenaTest, TopBlockGrowsInPlace) {
+    JsonArena arena(256);
+    char* s = static_cast<char*>(arena.allocate(8));
+    strcpy(s, "abcdefg");
+    char* grown = static_cast<char*>(arena.reallocate(s, 64));
+    EXPECT_EQ(s, grown);
+    EXPECT_STREQ("abcdefg", grown);
+
+    // Not the top any more: growing moves it, with its contents
+    arena.allocate(8);
+    char* moved = static_cast<char*>(arena.reallocate(grown, 100));
+    ASSERT_NE(nullptr, moved);
+    EXPECT_NE(grown, moved);
+    EXPECT_STREQ("abcdefg", moved);
+    EXPECT_EQ(0u, arena.spills());
+}
+
+TEST(JsonArenaTest, SpillsToTheHeapWhenFull) {
+    JsonArena arena(64);
+    void* inside = arena.allocate(32);
+    void* spilled = arena.allocate(64);
+    ASSERT_NE(nullptr, spilled);
+    EXPECT_EQ(1u, arena.spills());
+    // Heap blocks keep working through the same interface
+    void* bigger = arena.reallocate(spilled, 200);
+    ASSERT_NE(nullptr, bigger);
+    arena.deallocate(bigger);
+    arena.deallocate(inside);
+    EXPECT_EQ(0u, arena.used());
+}
+
+TEST(JsonArenaTest, ScopeRecordsItsPeakAndRewinds) {
+    JsonArena arena(1024);
+    static JsonArenaSite site("test scope");
+    arena.allocate(16);
+    size_t before = arena.used();
+    {
+        JsonScope scope(site, arena);
+        ArduinoJson::Allocator* a = scope.allocator();
+        a->allocate(100);
+        a->allocate(100);
+    }
+    EXPECT_EQ(before, arena.used());
+    EXPECT_EQ(1u, site.calls());
+    EXPECT_EQ(2u * (8 + 104), site.peakBytes());
+    EXPECT_EQ(0u, site.spilledCalls());
+}
+
+TEST(JsonArenaTest, NestedScopesMeasureOnlyTheirOwnUse) {
+    JsonArena arena(4096);
+    static JsonArenaSite outerSite("test outer");
+    static JsonArenaSite innerSite("test inner");
+    {
+        JsonScope outer(outerSite, arena);
+        void* big = outer.allocator()->allocate(1000);
+        outer.allocator()->deallocate(big);  // back down before the inner scope
+        {
+            JsonScope inner(innerSite, arena);
+            inner.allocator()->allocate(100);
+        }
+    }
+    EXPECT_EQ(8u + 104, innerSite.peakBytes());
+    EXPECT_EQ(8u + 1000, outerSite.peakBytes());
+    EXPECT_EQ(0u, arena.used());
+}
+
+TEST(JsonArenaTest, SpillingCallsAreCounted) {
+    JsonArena arena(128);
+    static JsonArenaSite site("test spill");
+    {
+        JsonScope scope(site, arena);
+        void* p = scope.allocator()->allocate(500);
+        scope.allocator()->deallocate(p);
+    }
+    EXPECT_EQ(1u, site.spilledCalls());
+}
+
+TEST(JsonArenaTest, ScopeWithItsOwnArena) {
+    static JsonArenaSite site("test private");
+    size_t sharedBefore = jsonSharedArena().highWater();
+    {
+        JsonScope scope(site, 2048);
+        ASSERT_NE(nullptr, scope.allocator()->allocate(1500));
+    }
+    EXPECT_EQ(sharedBefore, jsonSharedArena().highWater());
+    EXPECT_GE(site.peakBytes(), 1500u);
+}
+
+TEST(JsonArenaTest, SharedArenaBelongsToOneThreadAtATime) {
+    static JsonArenaSite mainSite("test shared main");
+    static JsonArenaSite otherSite("test shared other");
+    {
+        JsonScope scope(mainSite);
+        ASSERT_NE(nullptr, scope.allocator()->allocate(64));
+        // The same thread nests on it
+        {
+            JsonScope nested(mainSite);
+            EXPECT_EQ(static_cast<ArduinoJson::Allocator*>(&jsonSharedArena()), nested.allocator());
+        }
+        std::thread other([]() {
+            JsonScope scope(otherSite);
+            EXPECT_NE(static_cast<ArduinoJson::Allocator*>(&jsonSharedArena()), scope.allocator());
+            void* p = scope.allocator()->allocate(64);
+            EXPECT_NE(nullptr, p);
+            scope.allocator()->deallocate(p);
+        });
+        other.join();
+    }
+    EXPECT_EQ(1u, otherSite.heapCalls());
+    EXPECT_EQ(2u, mainSite.calls());
+
+    // Released: another thread gets it now
+    std::thread later([]() {
+        JsonScope scope(otherSite);
+        EXPECT_EQ(static_cast<ArduinoJson::Allocator*>(&jsonSharedArena()), scope.allocator());
+    });
+    later.join();
+    EXPECT_EQ(1u, otherSite.calls());
+}
+
+TEST(JsonArenaTest, JsonScopeMacroRegistersTheSite) {
+    {
+        JSON_SCOPE(json, "test macro");
+        ASSERT_NE(nullptr, json.buffer(32));
+    }
+    const JsonArenaSite* site = findSite("test macro");
+    ASSERT_NE(nullptr, site);
+    EXPECT_EQ(1u, site->calls());
+    EXPECT_EQ(0u, jsonSharedArena().used());
+}
+
+TEST(JsonArenaTest, ChunkWriterHandsOverFixedPieces) {
+    char buf[4];
+    std::vector<std::string> chunks;
+    JsonChunkWriter writer(buf, sizeof(buf), appendChunk, &chunks);
+    writer.write('{');
+    writer.write(reinterpret_cast<const uint8_t*>("\"a\":12345"), 9);
+    writer.write('}');
+    EXPECT_EQ(8u, writer.flushed());
+    EXPECT_EQ(3u, writer.pending());
+    writer.flush();
+    ASSERT_EQ(3u, chunks.size());
+    EXPECT_EQ("{\"a\"", chunks[0]);
+    EXPECT_EQ(":123", chunks[1]);
+    EXPECT_EQ("45}", chunks[2]);
+}
+
+TEST(JsonArenaTest, DocumentRoundTripThroughTheArena) {
+    static JsonArenaSite site("test document");
+    JsonArena arena(4096);
+    std::string out;
+    {
+        JsonScope json(site, arena);
+        JsonDocument doc(json.allocator());
+        ASSERT_FALSE(deserializeJson(doc, "{\"state\":\"ON\",\"color\":{\"r\":255,\"g\":10}}"));
+        doc["brightness"] = 128;
+        doc["name"] = std::string("a string long enough to need its own copy");
+        EXPECT_FALSE(doc.overflowed());
+
+        char buf[16];
+        std::vector<std::string> chunks;
+        JsonChunkWriter writer(buf, sizeof(buf), appendChunk, &chunks);
+        serializeJson(doc, writer);
+        writer.flush();
+        for (const std::string& c : chunks) out += c;
+    }
+    EXPECT_EQ("{\"state\":\"ON\",\"color\":{\"r\":255,\"g\":10},\"brightness\":128,"
+              "\"name\":\"a string long enough to need its own copy\"}",
+              out);
+    EXPECT_EQ(0u, arena.used());
+    EXPECT_EQ(0u, arena.spills());
+    EXPECT_GT(site.peakBytes(), 0u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -5,6 +5,7 @@
 // Include production code
 #include "../../src/led_state.h"
 #include "../../src/led_state.cpp"
+#include "../../src/settings_store.cpp"
 
 class LedStateTest : public ::testing::Test {
 protected:
@@ -237,6 +238,27 @@ TEST_F(LedStateTest, LoopWhenClean_NoOp) {
     ASSERT_FALSE(ledState.isDirty());
 }
 
+// State change notification (drives MQTT delta publishing)
+static int g_lightChanges = 0;
+static void countLightChanges(StateChange change) {
+    if (change == StateChange::Light) g_lightChanges++;
+}
+
+TEST_F(LedStateTest, SettersNotifyOnlyOnChange) {
+    g_lightChanges = 0;
+    ASSERT_TRUE(addStateChangeListener(countLightChanges));
+
+    ledState.setBrightness(100);
+    ledState.setBrightness(100);  // no change
+    ledState.setRGBW(1, 2, 3, 4);
+    ledState.setRGBW(1, 2, 3, 4);  // no change
+    ASSERT_EQ(2, g_lightChanges);
+
+    removeStateChangeListener(countLightChanges);
+    ledState.setBrightness(10);
+    ASSERT_EQ(2, g_lightChanges);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
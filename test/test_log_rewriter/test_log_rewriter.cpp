@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/LittleFS.h"
+
+// Room for the whole synthetic log, so nothing is evicted
+#define LOG_SEGMENT_BYTES (64UL * 1024UL)
+#define LOG_STORE_QUOTA_BYTES (8UL * 1024UL * 1024UL)
+
+// Include production code
+#include "../../src/log_store.cpp"
+#include "../../src/log_rewriter.cpp"
+
+namespace {
+
+const char* kLevels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+const uint64_t kBootEpochMs = 1761433200123ULL;  // 2025-10-25 23:00:00.123 UTC
+
+// Hours of boot log: a line every 0.1-2 s with varied levels and lengths
+std::string syntheticLog(size_t lines) {
+    std::string out;
+    uint64_t upMs = 812;
+    uint32_t rnd = 12345;
+    for (size_t i = 0; i < lines; ++i) {
+        rnd = rnd * 1103515245u + 12345u;
+        upMs += 100 + (rnd >> 8) % 1900;
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "[uptime %lu.%03lus][%s] ", (unsigned long)(upMs / 1000),
+                 (unsigned long)(upMs % 1000), kLevels[(rnd >> 4) % 4]);
+        out += prefix;
+        out += "📶 WiFi retry " + std::to_string(i) + std::string((rnd >> 12) % 60, '.') + "\n";
+    }
+    return out;
+}
+
+// The rewrite as it was before the streaming version: one String line at a
+// time, indexOf/substring to split it, localtime_r/strftime per line, and
+// only "[uptime ...]" lines kept.
+std::string legacyRewrite(const std::string& in, uint64_t bootEpochMs) {
+    std::string out;
+    size_t pos = 0;
+    while (pos < in.size()) {
+        size_t nl = in.find('\n', pos);
+        std::string line = in.substr(pos, nl == std::string::npos ? std::string::npos : nl - pos);
+        pos = nl == std::string::npos ? in.size() : nl + 1;
+        if (line.empty()) continue;
+        if (line.find("[uptime ") != 0) continue;
+        size_t dotPos = line.find('.', 8);
+        size_t sPos = line.find("s][", dotPos);
+        if (dotPos == std::string::npos || sPos == std::string::npos) continue;
+        size_t lvlStart = sPos + 3;
+        size_t lvlEnd = line.find(']', lvlStart);
+        if (lvlEnd == std::string::npos) continue;
+        std::string lvlStr = line.substr(lvlStart, lvlEnd - lvlStart);
+        std::string msg = line.substr(lvlEnd + 2);
+        uint64_t upSec = strtoull(line.substr(8, dotPos - 8).c_str(), nullptr, 10);
+        uint64_t upMs = strtoull(line.substr(dotPos + 1, sPos - dotPos - 1).c_str(), nullptr, 10);
+        uint64_t lineMs = bootEpochMs + upSec * 1000ULL + upMs;
+        time_t lineSec = (time_t)(lineMs / 1000ULL);
+        struct tm lt = {};
+        localtime_r(&lineSec, &lt);
+        char datebuf[32];
+        char tzbuf[8];
+        strftime(datebuf, sizeof(datebuf), "%Y-%m-%d %H:%M:%S", &lt);
+        strftime(tzbuf, sizeof(tzbuf), "%Z", &lt);
+        char prefix[96];
+        snprintf(prefix, sizeof(prefix), "[%s.%03u %s][%s] ", datebuf, (unsigned)(lineMs % 1000ULL), tzbuf,
+                 lvlStr.c_str());
+        out += prefix;
+        out += msg + "\n";
+    }
+    return out;
+}
+
+}  // namespace
+
+class LogRewriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Central European time: the synthetic log crosses the October DST change
+        setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+        tzset();
+        mockfs::reset();
+        ASSERT_TRUE(store.begin());
+    }
+
+    void writeUnsynced(const std::string& data) {
+        File f = LittleFS.open(LogStore::kUnsyncedPath, "w");
+        f.write(data.data(), data.size());
+        f.close();
+    }
+
+    // Runs the rewriter to completion; returns the number of steps
+    size_t runAll(size_t perStep) {
+        size_t steps = 0;
+        while (true) {
+            UnsyncedLogRewriter::Step st = rewriter.step(store, perStep);
+            steps++;
+            EXPECT_LE(st.lines, perStep);
+            if (st.done) break;
+        }
+        store.flush();
+        return steps;
+    }
+
+    std::string stored() {
+        std::string out;
+        store.query(LogQuery(), [&](const char* line, size_t n) { out.append(line, n); });
+        return out;
+    }
+
+    LogStore store{LittleFS};
+    UnsyncedLogRewriter rewriter;
+};
+
+TEST_F(LogRewriterTest, MissingFileIsNotStarted) {
+    EXPECT_FALSE(rewriter.begin(LittleFS, LogStore::kUnsyncedPath, kBootEpochMs));
+    EXPECT_FALSE(rewriter.active());
+    EXPECT_TRUE(rewriter.step(store, 8).done);
+}
+
+TEST_F(LogRewriterTest, MatchesLegacyRewriteOnLargeLog) {
+    std::string log = syntheticLog(20000);
+    writeUnsynced(log);
+
+    ASSERT_TRUE(rewriter.begin(LittleFS, LogStore::kUnsyncedPath, kBootEpochMs));
+    size_t steps = runAll(LOG_REWRITE_LINES_PER_STEP);
+
+    EXPECT_EQ(20000u, rewriter.convertedCount());
+    EXPECT_EQ((20000 + LOG_REWRITE_LINES_PER_STEP - 1) / LOG_REWRITE_LINES_PER_STEP + 1, steps);
+    EXPECT_FALSE(rewriter.active());
+    std::string expected = legacyRewrite(log, kBootEpochMs);
+    std::string got = stored();
+    ASSERT_EQ(expected.size(), got.size());
+    EXPECT_TRUE(expected == got);
+    // Both sides of the DST change made it through
+    EXPECT_NE(std::string::npos, got.find(" CEST]"));
+    EXPECT_NE(std::string::npos, got.find(" CET]"));
+}
+
+TEST_F(LogRewriterTest, LevelsAndTimesReachTheIndex) {
+    writeUnsynced("[uptime 0.500s][INFO] boot\n"
+                  "[uptime 61.250s][ERROR] sensor fault\n"
+                  "[uptime 3600.000s][WARN] late\n");
+    ASSERT_TRUE(rewriter.begin(LittleFS, LogStore::kUnsyncedPath, kBootEpochMs));
+    runAll(8);
+
+    ASSERT_EQ(1u, store.segmentCount());
+    const LogSegmentInfo& seg = store.segment(0);
+    EXPECT_EQ((uint32_t)(kBootEpochMs / 1000), seg.firstEpoch);
+    EXPECT_EQ((uint32_t)((kBootEpochMs + 3600000) / 1000), seg.lastEpoch);
+    EXPECT_EQ(1u, seg.levelCounts[1]);
+    EXPECT_EQ(1u, seg.levelCounts[2]);
+    EXPECT_EQ(1u, seg.levelCounts[3]);
+
+    LogQuery errors;
+    errors.minLevel = 3;
+    std::string out;
+    store.query(errors, [&](const char* line, size_t n) { out.append(line, n); });
+    EXPECT_EQ("[2025-10-26 01:01:01.373 CEST][ERROR] sensor fault\n", out);
+}
+
+TEST_F(LogRewriterTest, KeepsContinuationLinesAndUnterminatedTail) {
+    writeUnsynced("[uptime 1.000s][ERROR] stack:\n"
+                  "  frame 0\n"
+                  "\n"
+                  "[uptime 2.000s][INFO] tail without newline");
+    ASSERT_TRUE(rewriter.begin(LittleFS, LogStore::kUnsyncedPath, kBootEpochMs));
+    runAll(8);
+
+    EXPECT_EQ("[2025-10-26 01:00:01.123 CEST][ERROR] stack:\n"
+              "  frame 0\n"
+              "[2025-10-26 01:00:02.123 CEST][INFO] tail without newline\n",
+              stored());
+    // The continuation is filtered with the line it belongs to
+    LogQuery errors;
+    errors.minLevel = 3;
+    size_t n = store.query(errors, [](const char*, size_t) {});
+    EXPECT_EQ(2u, n);
+}
+
+TEST_F(LogRewriterTest, StepsStayWithinBudget) {
+    std::string log = syntheticLog(20000);
+    writeUnsynced(log);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::string legacy = legacyRewrite(log, kBootEpochMs);
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    ASSERT_TRUE(rewriter.begin(LittleFS, LogStore::kUnsyncedPath, kBootEpochMs));
+    double worstStepUs = 0;
+    double totalUs = 0;
+    while (true) {
+        auto s0 = std::chrono::high_resolution_clock::now();
+        UnsyncedLogRewriter::Step st = rewriter.step(store, LOG_REWRITE_LINES_PER_STEP);
+        auto s1 = std::chrono::high_resolution_clock::now();
+        double us = std::chrono::duration<double, std::micro>(s1 - s0).count();
+        totalUs += us;
+        if (us > worstStepUs) worstStepUs = us;
+        if (st.done) break;
+    }
+
+    double legacyUs = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    std::cout << "[ BENCH    ] 20000 lines: legacy " << legacyUs << " us in one go, streaming "
+              << totalUs << " us total, worst step " << worstStepUs << " us" << std::endl;
+
+    // Generous bound for slow CI hosts; typical is tens of us per step
+    EXPECT_LT(worstStepUs, 5000.0) << "Step too slow: " << worstStepUs << " us";
+    EXPECT_LT(worstStepUs * 10, legacyUs);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
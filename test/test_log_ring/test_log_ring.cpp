@@ -0,0 +1,313 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "../mocks/mock_arduino.h"
+#include "../helpers/alloc_counter.h"
+
+// As in the release envs: DEBUG calls are compiled out
+#define LOG_COMPILE_MIN_LEVEL 1
+
+// Include production code
+#include "../../src/log_ring.cpp"
+#include "../../src/log.cpp"
+
+namespace {
+
+const size_t kSlots = 8;
+
+std::string text(const LogRecord& rec) {
+    return std::string(rec.text, rec.length);
+}
+
+std::string prefix(const LogRecord& rec) {
+    char buf[96];
+    size_t n = logFormatPrefix(rec, buf, sizeof(buf));
+    return std::string(buf, n);
+}
+
+int g_evaluated = 0;
+
+String expensiveMessage() {
+    g_evaluated++;
+    return String("value ") + g_evaluated;
+}
+
+}  // namespace
+
+class LogRingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        setenv("TZ", "UTC0", 1);
+        tzset();
+    }
+
+    void append(const char* msg, uint8_t level = 1) {
+        ring.append(level, 1500000, 0, msg, strlen(msg));
+    }
+
+    std::vector<std::string> contents(uint32_t from = 0) {
+        std::vector<std::string> out;
+        ring.forEach(from, [&](const LogRecord& rec) { out.push_back(text(rec)); });
+        return out;
+    }
+
+    alignas(8) uint8_t arena[kSlots * LOG_RECORD_SIZE];
+    LogRing ring{arena, sizeof(arena)};
+};
+
+TEST_F(LogRingTest, AppendThenRead) {
+    ring.append(2, 1234567, 0, "hello\n", 6);
+    EXPECT_EQ(kSlots, ring.capacity());
+    EXPECT_EQ(1u, ring.head());
+
+    char buf[LOG_RECORD_SIZE];
+    LogRecord rec;
+    ASSERT_TRUE(ring.read(0, rec, buf));
+    EXPECT_EQ("hello\n", text(rec));
+    EXPECT_EQ(2, rec.level);
+    EXPECT_EQ(1234567, rec.uptimeUs);
+    EXPECT_EQ(0u, rec.epoch);
+    EXPECT_FALSE(rec.truncated);
+    EXPECT_FALSE(ring.read(1, rec, buf));
+}
+
+TEST_F(LogRingTest, WrapKeepsNewestRecords) {
+    for (int i = 0; i < 20; ++i) {
+        char msg[8];
+        snprintf(msg, sizeof(msg), "m%d", i);
+        append(msg);
+    }
+    EXPECT_EQ(20u, ring.head());
+    EXPECT_EQ(12u, ring.tail());
+    std::vector<std::string> expected = {"m12", "m13", "m14", "m15", "m16", "m17", "m18", "m19"};
+    EXPECT_EQ(expected, contents());
+
+    char buf[LOG_RECORD_SIZE];
+    LogRecord rec;
+    EXPECT_FALSE(ring.read(3, rec, buf));  // overwritten by m11
+}
+
+// The boot block is small; the ring moves to a bigger one and carries on
+TEST_F(LogRingTest, MoveToKeepsRecordsAndSeqs) {
+    for (int i = 0; i < 10; ++i) {
+        char msg[8];
+        snprintf(msg, sizeof(msg), "m%d", i);
+        append(msg);
+    }
+    alignas(8) static uint8_t bigger[3 * kSlots * LOG_RECORD_SIZE];
+    ring.moveTo(bigger, sizeof(bigger));
+    EXPECT_EQ(3 * kSlots, ring.capacity());
+    EXPECT_EQ(10u, ring.head());
+    EXPECT_EQ(2u, ring.tail());  // m0 and m1 were gone before the move
+    std::vector<std::string> expected = {"m2", "m3", "m4", "m5", "m6", "m7", "m8", "m9"};
+    EXPECT_EQ(expected, contents());
+
+    append("after");
+    expected.push_back("after");
+    EXPECT_EQ(expected, contents());
+    char buf[LOG_RECORD_SIZE];
+    LogRecord rec;
+    EXPECT_FALSE(ring.read(1, rec, buf));
+
+    // Moving to a smaller block keeps only the newest records
+    alignas(8) uint8_t small[2 * LOG_RECORD_SIZE];
+    ring.moveTo(small, sizeof(small));
+    expected = {"m9", "after"};
+    EXPECT_EQ(expected, contents());
+}
+
+TEST_F(LogRingTest, ForEachResumesFromCursor) {
+    append("a");
+    append("b");
+    uint32_t cursor = ring.forEach(0, [](const LogRecord&) {});
+    EXPECT_EQ(2u, cursor);
+    append("c");
+    std::vector<std::string> expected = {"c"};
+    EXPECT_EQ(expected, contents(cursor));
+    EXPECT_TRUE(contents(ring.head()).empty());
+}
+
+TEST_F(LogRingTest, LappedCursorIsClampedToTail) {
+    for (int i = 0; i < 12; ++i) append("x");
+    uint32_t visited = 0;
+    uint32_t next = ring.forEach(1, [&](const LogRecord& rec) {
+        EXPECT_GE(rec.seq, ring.tail());
+        visited++;
+    });
+    EXPECT_EQ(kSlots, visited);
+    EXPECT_EQ(12u, next);
+}
+
+TEST_F(LogRingTest, LongMessageIsTruncatedKeepingNewline) {
+    std::string big(LOG_RECORD_SIZE * 2, 'y');
+    big.back() = '\n';
+    ring.append(1, 0, 0, big.c_str(), big.size());
+
+    char buf[LOG_RECORD_SIZE];
+    LogRecord rec;
+    ASSERT_TRUE(ring.read(0, rec, buf));
+    EXPECT_TRUE(rec.truncated);
+    EXPECT_EQ(LogRing::textCapacity(), rec.length);
+    EXPECT_EQ('\n', rec.text[rec.length - 1]);
+    EXPECT_EQ('y', rec.text[rec.length - 2]);
+}
+
+TEST_F(LogRingTest, ClearEmptiesRing) {
+    append("a");
+    ring.clear();
+    EXPECT_EQ(0u, ring.head());
+    EXPECT_TRUE(contents().empty());
+}
+
+TEST_F(LogRingTest, PrefixMatchesLegacyFormat) {
+    LogRecord rec = {};
+    rec.level = 2;
+    rec.uptimeUs = 65432100;  // 65.432 s
+    EXPECT_EQ("[uptime 65.432s][WARN] ", prefix(rec));
+
+    rec.level = 3;
+    rec.epoch = 1700000000;  // 2023-11-14 22:13:20 UTC
+    EXPECT_EQ("[2023-11-14 22:13:20.432 UTC][ERROR] ", prefix(rec));
+
+    rec.level = 0;
+    EXPECT_EQ(std::string("DEBUG"), logLevelTag(rec.level));
+    EXPECT_EQ(std::string("INFO"), logLevelTag(42));
+}
+
+TEST_F(LogRingTest, PrefixRespectsSmallBuffer) {
+    LogRecord rec = {};
+    char buf[8];
+    EXPECT_EQ(7u, logFormatPrefix(rec, buf, sizeof(buf)));
+    EXPECT_EQ(std::string("[uptime"), std::string(buf));
+}
+
+// Several writers and a reader race on a small ring: every record the
+// reader accepts must be intact, and every seq must be accounted for.
+TEST_F(LogRingTest, ConcurrentWritersNeverProduceTornRecords) {
+    const int kThreads = 4;
+    const int kPerThread = 20000;
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint32_t> seen{0};
+
+    std::thread reader([&] {
+        uint32_t cursor = 0;
+        while (!done.load() || cursor != ring.head()) {
+            cursor = ring.forEach(cursor, [&](const LogRecord& rec) {
+                // Each message is one repeated character plus the writer id as level
+                char c = static_cast<char>('a' + rec.level);
+                bool ok = rec.length == 40 && rec.uptimeUs == static_cast<int64_t>(rec.level) * 1000;
+                for (size_t i = 0; ok && i < rec.length; ++i) ok = rec.text[i] == c;
+                if (!ok) torn++;
+                seen++;
+            });
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < kThreads; ++t) {
+        writers.emplace_back([&, t] {
+            std::string msg(40, static_cast<char>('a' + t));
+            for (int i = 0; i < kPerThread; ++i) {
+                ring.append(static_cast<uint8_t>(t), t * 1000, 0, msg.data(), msg.size());
+            }
+        });
+    }
+    for (auto& w : writers) w.join();
+    done = true;
+    reader.join();
+
+    EXPECT_EQ(0u, torn.load());
+    EXPECT_EQ(static_cast<uint32_t>(kThreads * kPerThread), ring.head());
+    EXPECT_GT(seen.load(), 0u);
+    // After the writers stop the full ring is readable and intact
+    EXPECT_EQ(kSlots, contents().size());
+}
+
+// Per-call cost of the old path (time prefix via localtime_r/strftime,
+// String concatenation, String stored in a String ring) against appending
+// the raw message to the binary ring.
+TEST_F(LogRingTest, Benchmark_PerCallCost) {
+    const int kCalls = 20000;
+    String legacyRing[50];
+    int legacyIndex = 0;
+    String msg("📶 WiFi connected, RSSI -61 dBm\n");
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+        time_t now = 1700000000 + i;
+        struct tm lt = {};
+        localtime_r(&now, &lt);
+        char datebuf[32];
+        char tzbuf[8];
+        strftime(datebuf, sizeof(datebuf), "%Y-%m-%d %H:%M:%S", &lt);
+        strftime(tzbuf, sizeof(tzbuf), "%Z", &lt);
+        char out[80];
+        snprintf(out, sizeof(out), "[%s.%03lu %s][%s] ", datebuf, (unsigned long)(i % 1000), tzbuf, "INFO");
+        String line = String(out) + msg;
+        legacyRing[legacyIndex] = line;
+        legacyIndex = (legacyIndex + 1) % 50;
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+        ring.append(1, i * 1000LL, 1700000000u + i, msg.c_str(), msg.length());
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    double legacyNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / kCalls;
+    double ringNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / kCalls;
+    std::cout << "[ BENCH    ] log call: String ring " << legacyNs << " ns, binary ring "
+              << ringNs << " ns" << std::endl;
+
+    EXPECT_EQ(static_cast<uint32_t>(kCalls), ring.head());
+    // Generous bound for slow CI hosts; typical is tens of ns
+    EXPECT_LT(ringNs, 2000.0) << "Append too slow: " << ringNs << " ns";
+}
+
+TEST(LogMacroTest, FilteredLevelsDoNotEvaluateArguments) {
+    LogLevel saved = LOG_LEVEL;
+    LOG_LEVEL = LOG_LEVEL_ERROR;
+    g_evaluated = 0;
+    logInfo(expensiveMessage());
+    logWarn(String("x") + expensiveMessage());
+    logInfof("%s", expensiveMessage().c_str());
+    EXPECT_EQ(0, g_evaluated);
+
+    logError(expensiveMessage());
+    logErrorf("%s", expensiveMessage().c_str());
+    EXPECT_EQ(2, g_evaluated);
+    LOG_LEVEL = saved;
+}
+
+TEST(LogMacroTest, CompiledOutLevelIgnoresRuntimeLevel) {
+    LogLevel saved = LOG_LEVEL;
+    LOG_LEVEL = LOG_LEVEL_DEBUG;
+    g_evaluated = 0;
+    logDebug(expensiveMessage());
+    logDebugf("%s", expensiveMessage().c_str());
+    EXPECT_EQ(0, g_evaluated);
+    EXPECT_FALSE(LOG_ENABLED(LOG_LEVEL_DEBUG));
+    EXPECT_TRUE(LOG_ENABLED(LOG_LEVEL_INFO));
+    LOG_LEVEL = saved;
+}
+
+TEST(LogMacroTest, FilteredCallsDoNotAllocate) {
+    LogLevel saved = LOG_LEVEL;
+    LOG_LEVEL = LOG_LEVEL_ERROR;
+    AllocCounter counter;
+    for (int i = 0; i < 100; ++i) {
+        logDebug(String("MQTT command handlers: ") + i);
+        logInfo(String("Published ") + i + " discovery entities");
+        logWarnf("Anim step %d/%u dt=%lums", i, 10u, 40ul);
+    }
+    EXPECT_EQ(0u, counter.allocations());
+    LOG_LEVEL = saved;
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/LittleFS.h"
+
+// Include production code
+#include "../../src/log_ring.cpp"
+#include "../../src/log_store.cpp"
+#include "../../src/log_sink.cpp"
+
+namespace {
+
+const size_t kSlots = 32;
+
+}  // namespace
+
+class LogSinkTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        setenv("TZ", "UTC0", 1);
+        tzset();
+        mockfs::reset();
+        ASSERT_TRUE(store.begin());
+    }
+
+    // A 60-byte line: "[uptime 1.000s][INFO] " (22) + 38 bytes of text
+    void logLine(char c = 'x', uint8_t level = 1) {
+        std::string msg(37, c);
+        msg += '\n';
+        ring.append(level, 1000000, 0, msg.data(), msg.size());
+    }
+
+    std::string written() const { return mockfs::contents("/logs/unsynced.log"); }
+
+    alignas(8) uint8_t arena[kSlots * LOG_RECORD_SIZE];
+    LogRing ring{arena, sizeof(arena)};
+    LogFileSink sink{ring};
+    LogStore store{LittleFS};
+};
+
+TEST_F(LogSinkTest, WritesFormattedLines) {
+    const char* msg = "boot\n";
+    ring.append(2, 1500000, 0, msg, strlen(msg));
+    LogFileSink::Result r = sink.drain(store, false, 0);
+
+    EXPECT_EQ(1u, r.records);
+    EXPECT_EQ("[uptime 1.500s][WARN] boot\n", written());
+    EXPECT_FALSE(sink.pending());
+}
+
+TEST_F(LogSinkTest, BatchesWritesByPage) {
+    for (int i = 0; i < 20; ++i) logLine();
+    mockfs::stats() = mockfs::Stats();
+
+    LogFileSink::Result r = sink.drain(store, false, 0);
+    EXPECT_EQ(20u, r.records);
+    EXPECT_EQ(1200u, r.bytes);
+    // 1200 bytes in 512-byte batches: two full, one partial
+    EXPECT_EQ(3u, mockfs::stats().writeCalls);
+    EXPECT_EQ(1200u, mockfs::stats().bytesWritten);
+    EXPECT_EQ(1u, mockfs::stats().flushCalls);
+    EXPECT_EQ(3u, store.batchCount());
+    EXPECT_EQ(1200u, written().size());
+}
+
+TEST_F(LogSinkTest, OneWritePerLineWithoutBatching) {
+    // What the old per-call sink cost: a print and a flush for every line
+    for (int i = 0; i < 20; ++i) logLine();
+    File file = LittleFS.open("/logs/unsynced.log", "a");
+    ASSERT_TRUE((bool)file);
+    mockfs::stats() = mockfs::Stats();
+    size_t lines = 0;
+    ring.forEach(0, [&](const LogRecord& rec) {
+        char prefix[96];
+        size_t n = logFormatPrefix(rec, prefix, sizeof(prefix));
+        std::string line(prefix, n);
+        line.append(rec.text, rec.length);
+        file.print(line.c_str());
+        file.flush();
+        lines++;
+    });
+    EXPECT_EQ(20u, lines);
+    EXPECT_EQ(20u, mockfs::stats().writeCalls);
+    EXPECT_EQ(20u, mockfs::stats().flushCalls);
+}
+
+TEST_F(LogSinkTest, NothingPendingWritesNothing) {
+    logLine();
+    sink.drain(store, false, 0);
+    mockfs::stats() = mockfs::Stats();
+
+    LogFileSink::Result r = sink.drain(store, false, LOG_SINK_INTERVAL_MS * 3);
+    EXPECT_EQ(0u, r.records);
+    EXPECT_EQ(0u, mockfs::stats().writeCalls);
+    EXPECT_EQ(0u, mockfs::stats().flushCalls);
+}
+
+TEST_F(LogSinkTest, FlushesOncePerInterval) {
+    logLine();
+    EXPECT_TRUE(sink.drain(store, false, 1000).flushed);  // first drain always flushes
+
+    logLine();
+    EXPECT_FALSE(sink.drain(store, false, 2000).flushed);
+    logLine();
+    EXPECT_FALSE(sink.drain(store, false, 1000 + LOG_SINK_INTERVAL_MS - 1).flushed);
+    logLine();
+    EXPECT_TRUE(sink.drain(store, false, 1000 + LOG_SINK_INTERVAL_MS).flushed);
+    EXPECT_EQ(2u, mockfs::stats().flushCalls);
+}
+
+TEST_F(LogSinkTest, ErrorsAndExplicitRequestsFlushImmediately) {
+    logLine();
+    sink.drain(store, false, 0);
+
+    logLine('e', 3);
+    EXPECT_TRUE(sink.drain(store, false, 10).flushed);
+
+    logLine();
+    EXPECT_TRUE(sink.drain(store, true, 20).flushed);
+    // Even with nothing new, a requested flush is honoured
+    EXPECT_TRUE(sink.drain(store, true, 30).flushed);
+    EXPECT_EQ(4u, sink.flushCount());
+}
+
+TEST_F(LogSinkTest, LappedRecordsAreCountedAndMarked) {
+    for (size_t i = 0; i < kSlots + 5; ++i) logLine('a' + (i % 26));
+    EXPECT_EQ(kSlots + 5, sink.backlog());
+
+    LogFileSink::Result r = sink.drain(store, false, 0);
+    EXPECT_EQ(kSlots, r.records);
+    EXPECT_EQ(5u, sink.droppedCount());
+    EXPECT_EQ(kSlots, sink.writtenCount());
+    EXPECT_EQ(0u, written().find("[uptime 1.000s][WARN] [log] 5 records dropped before reaching the file\n"));
+}
+
+TEST_F(LogSinkTest, SkipDropsBacklog) {
+    logLine();
+    logLine();
+    sink.skip();
+    EXPECT_EQ(2u, sink.droppedCount());
+    EXPECT_FALSE(sink.pending());
+    logLine();
+    EXPECT_EQ(1u, sink.drain(store, false, 0).records);
+}
+
+TEST_F(LogSinkTest, LinesSplitAcrossBatchesStayIntact) {
+    // 7 records of 100 bytes straddle the 512-byte batch boundary
+    for (int i = 0; i < 7; ++i) {
+        std::string msg(77, 'a' + i);
+        msg += '\n';
+        ring.append(1, 1000000, 0, msg.data(), msg.size());
+    }
+    sink.drain(store, false, 0);
+    std::string out = written();
+    ASSERT_EQ(700u, out.size());
+    for (int i = 0; i < 7; ++i) {
+        std::string line = out.substr(i * 100, 100);
+        EXPECT_EQ("[uptime 1.000s][INFO] " + std::string(77, 'a' + i) + "\n", line);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,459 @@
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/LittleFS.h"
+
+// Small segments so rotation and the quota kick in after a few hundred lines
+#define LOG_SEGMENT_BYTES 4096
+#define LOG_STORE_QUOTA_BYTES (16UL * 1024UL)
+
+// Include production code
+#include "../../src/log_store.cpp"
+
+namespace {
+
+const uint32_t kT0 = 1760000000;  // 2025-10-09 08:53:20 UTC
+const char* kLevels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+struct Line {
+    uint32_t epoch;
+    uint8_t level;
+    std::string text;
+};
+
+std::string prefixFor(uint32_t epoch, uint8_t level) {
+    if (epoch == 0) return std::string("[uptime 1.000s][") + kLevels[level] + "] ";
+    time_t t = epoch;
+    struct tm lt = {};
+    localtime_r(&t, &lt);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &lt);
+    return std::string("[") + when + ".000 UTC][" + kLevels[level] + "] ";
+}
+
+std::vector<std::string> collect(LogStore& store, const LogQuery& q) {
+    std::vector<std::string> out;
+    store.query(q, [&](const char* line, size_t n) { out.emplace_back(line, n); });
+    return out;
+}
+
+}  // namespace
+
+class LogStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        setenv("TZ", "UTC0", 1);
+        tzset();
+        mockfs::reset();
+        ASSERT_TRUE(store.begin());
+    }
+
+    // A 100-byte line, whatever the prefix
+    void add(uint32_t epoch, uint8_t level = 1, char c = 'x') {
+        std::string prefix = prefixFor(epoch, level);
+        std::string text(100 - prefix.size() - 1, c);
+        text += '\n';
+        store.append(epoch, level, prefix.data(), prefix.size(), text.data(), text.size());
+        lines.push_back({epoch, level, prefix + text});
+    }
+
+    // What a full scan with no index would return
+    std::vector<std::string> expected(const LogQuery& q) const {
+        std::vector<std::string> out;
+        for (const Line& l : lines) {
+            if (l.epoch != 0 && l.epoch >= q.from && l.epoch <= q.to && l.level >= q.minLevel) {
+                out.push_back(l.text);
+            }
+        }
+        return out;
+    }
+
+    std::string segmentFile(size_t i) const {
+        char path[32];
+        LogStore::segmentPath(store.segment(i).id, path, sizeof(path));
+        return mockfs::contents(path);
+    }
+
+    LogStore store{LittleFS};
+    std::vector<Line> lines;
+};
+
+TEST_F(LogStoreTest, ParsesLinePrefix) {
+    std::string line = prefixFor(kT0, 2) + "hello\n";
+    const char* when = nullptr;
+    uint8_t level = 0;
+    ASSERT_TRUE(logParseLinePrefix(line.data(), line.size(), when, level));
+    EXPECT_EQ(2, level);
+    EXPECT_EQ("2025-10-09 08:53:20", std::string(when, 19));
+
+    std::string uptime = prefixFor(0, 1) + "boot\n";
+    EXPECT_FALSE(logParseLinePrefix(uptime.data(), uptime.size(), when, level));
+    EXPECT_FALSE(logParseLinePrefix("continued\n", 10, when, level));
+}
+
+TEST_F(LogStoreTest, UnsyncedLinesGoToTheirOwnFile) {
+    add(0);
+    add(0);
+    add(kT0);
+    store.flush();
+
+    EXPECT_EQ(200u, mockfs::contents(LogStore::kUnsyncedPath).size());
+    EXPECT_EQ(200u, store.unsyncedBytes());
+    ASSERT_EQ(1u, store.segmentCount());
+    EXPECT_EQ(100u, store.segment(0).bytes);
+    EXPECT_EQ(kT0, store.segment(0).firstEpoch);
+
+    std::string raw;
+    store.readUnsynced([](void* ctx, const char* d, size_t n) { static_cast<std::string*>(ctx)->append(d, n); },
+                       &raw);
+    EXPECT_EQ(lines[0].text + lines[1].text, raw);
+    uint8_t piece[64];
+    ASSERT_EQ(64u, store.readUnsynced(120, piece, sizeof(piece)));
+    EXPECT_EQ(raw.substr(120, 64), std::string(reinterpret_cast<char*>(piece), 64));
+    EXPECT_EQ(20u, store.readUnsynced(180, piece, sizeof(piece)));
+    EXPECT_EQ(0u, store.readUnsynced(200, piece, sizeof(piece)));
+
+    store.removeUnsynced();
+    EXPECT_FALSE(LittleFS.exists(LogStore::kUnsyncedPath));
+    EXPECT_EQ(0u, store.unsyncedBytes());
+}
+
+TEST_F(LogStoreTest, RotatesAtSegmentSizeOnLineBoundaries) {
+    for (uint32_t i = 0; i < 100; ++i) add(kT0 + i);
+    store.flush();
+
+    // 40 lines fit in 4096 bytes
+    ASSERT_EQ(3u, store.segmentCount());
+    EXPECT_EQ(4000u, store.segment(0).bytes);
+    EXPECT_EQ(4000u, store.segment(1).bytes);
+    EXPECT_EQ(2000u, store.segment(2).bytes);
+    for (size_t i = 0; i < 3; ++i) {
+        std::string data = segmentFile(i);
+        EXPECT_EQ(store.segment(i).bytes, data.size());
+        EXPECT_EQ('[', data[0]);
+        EXPECT_EQ('\n', data.back());
+    }
+    EXPECT_EQ(kT0, store.segment(0).firstEpoch);
+    EXPECT_EQ(kT0 + 39, store.segment(0).lastEpoch);
+    EXPECT_EQ(kT0 + 40, store.segment(1).firstEpoch);
+    EXPECT_EQ(40u, store.segment(0).levelCounts[1]);
+}
+
+TEST_F(LogStoreTest, QuotaRemovesOldestSegments) {
+    for (uint32_t i = 0; i < 400; ++i) add(kT0 + i);
+    store.flush();
+
+    EXPECT_LE(store.totalBytes(), LOG_STORE_QUOTA_BYTES);
+    EXPECT_GT(store.segmentsRemoved(), 0u);
+    EXPECT_EQ(store.segmentsRemoved() + store.segmentCount(), store.segment(store.segmentCount() - 1).id);
+    // Nothing on the filesystem beyond the quota plus the index
+    EXPECT_LE(LittleFS.usedBytes(), LOG_STORE_QUOTA_BYTES + 1024);
+    EXPECT_FALSE(LittleFS.exists("/logs/seg-000001.log"));
+    // The newest lines are all still there
+    LogQuery q;
+    q.from = kT0 + 390;
+    EXPECT_EQ(10u, collect(store, q).size());
+}
+
+TEST_F(LogStoreTest, IndexIsReloadedWithoutReadingSegments) {
+    for (uint32_t i = 0; i < 100; ++i) add(kT0 + i, i % 4);
+    store.close();
+
+    mockfs::stats() = mockfs::Stats();
+    LogStore again(LittleFS);
+    ASSERT_TRUE(again.begin());
+    EXPECT_EQ(mockfs::contents(LogStore::kIndexPath).size(), mockfs::stats().bytesRead);
+
+    ASSERT_EQ(store.segmentCount(), again.segmentCount());
+    for (size_t i = 0; i < store.segmentCount(); ++i) {
+        EXPECT_EQ(0, memcmp(&store.segment(i), &again.segment(i), sizeof(LogSegmentInfo)));
+    }
+
+    // New lines continue the last segment
+    std::string line = prefixFor(kT0 + 100, 1) + "more\n";
+    again.append(kT0 + 100, 1, "", 0, line.data(), line.size());
+    again.flush();
+    EXPECT_EQ(store.segmentCount(), again.segmentCount());
+    EXPECT_EQ(2000u + line.size(), again.segment(2).bytes);
+}
+
+TEST_F(LogStoreTest, IndexIsRebuiltWhenMissing) {
+    for (uint32_t i = 0; i < 100; ++i) add(kT0 + i, i % 4);
+    store.close();
+    LittleFS.remove(LogStore::kIndexPath);
+
+    LogStore again(LittleFS);
+    ASSERT_TRUE(again.begin());
+    ASSERT_EQ(store.segmentCount(), again.segmentCount());
+    for (size_t i = 0; i < store.segmentCount(); ++i) {
+        const LogSegmentInfo& a = store.segment(i);
+        const LogSegmentInfo& b = again.segment(i);
+        EXPECT_EQ(a.id, b.id);
+        EXPECT_EQ(a.firstEpoch, b.firstEpoch);
+        EXPECT_EQ(a.lastEpoch, b.lastEpoch);
+        EXPECT_EQ(a.bytes, b.bytes);
+        EXPECT_EQ(0, memcmp(a.levelCounts, b.levelCounts, sizeof(a.levelCounts)));
+        ASSERT_EQ(a.checkpointCount, b.checkpointCount);
+        for (uint8_t c = 0; c < a.checkpointCount; ++c) {
+            EXPECT_EQ(a.checkpoints[c].epoch, b.checkpoints[c].epoch);
+            EXPECT_EQ(a.checkpoints[c].offset, b.checkpoints[c].offset);
+        }
+    }
+    EXPECT_TRUE(LittleFS.exists(LogStore::kIndexPath));
+}
+
+TEST_F(LogStoreTest, SegmentThatOutgrewItsIndexEntryIsRescanned) {
+    for (uint32_t i = 0; i < 10; ++i) add(kT0 + i);
+    store.close();
+    // Lines that reached the file after the last index save (e.g. a reset)
+    std::string late = prefixFor(kT0 + 50, 3) + "late\n";
+    File f = LittleFS.open("/logs/seg-000001.log", "a");
+    f.print(late.c_str());
+    f.close();
+
+    LogStore again(LittleFS);
+    ASSERT_TRUE(again.begin());
+    ASSERT_EQ(1u, again.segmentCount());
+    EXPECT_EQ(1000u + late.size(), again.segment(0).bytes);
+    EXPECT_EQ(kT0 + 50, again.segment(0).lastEpoch);
+    EXPECT_EQ(1u, again.segment(0).levelCounts[3]);
+}
+
+TEST_F(LogStoreTest, ImportsLegacyDayFiles) {
+    File newer = LittleFS.open("/logs/2025-10-02.log", "w");
+    newer.print("[2025-10-02 09:00:00.000 UTC][ERROR] trace:\n  frame 1\n");
+    newer.print("[2025-10-02 09:00:05.000 UTC][INFO] last");
+    newer.close();
+    File older = LittleFS.open("/logs/2025-10-01.log", "w");
+    older.print("[2025-10-01 10:00:00.000 UTC][INFO] old\n");
+    older.close();
+    File keep = LittleFS.open("/logs/notes.txt", "w");
+    keep.close();
+
+    LogStore again(LittleFS);
+    ASSERT_TRUE(again.begin());
+    EXPECT_FALSE(LittleFS.exists("/logs/2025-10-01.log"));
+    EXPECT_FALSE(LittleFS.exists("/logs/2025-10-02.log"));
+    EXPECT_TRUE(LittleFS.exists("/logs/notes.txt"));
+
+    std::vector<std::string> all = collect(again, LogQuery());
+    std::vector<std::string> want = {
+        "[2025-10-01 10:00:00.000 UTC][INFO] old\n",
+        "[2025-10-02 09:00:00.000 UTC][ERROR] trace:\n",
+        "  frame 1\n",
+        "[2025-10-02 09:00:05.000 UTC][INFO] last\n"};
+    EXPECT_EQ(want, all);
+
+    // Continuations keep the time and level of their record
+    LogQuery errors;
+    errors.minLevel = 3;
+    EXPECT_EQ(2u, collect(again, errors).size());
+    ASSERT_EQ(1u, again.segmentCount());
+    EXPECT_EQ(1759312800u, again.segment(0).firstEpoch);  // 2025-10-01 10:00:00 UTC
+
+    // Nothing left to import on the next boot
+    LogStore third(LittleFS);
+    ASSERT_TRUE(third.begin());
+    EXPECT_EQ(4u, collect(third, LogQuery()).size());
+}
+
+TEST_F(LogStoreTest, LegacyDaysBeyondTheQuotaAreDropped) {
+    // Three days of 8 KB with a 16 KB quota: only the newest two are read
+    for (int day = 1; day <= 3; ++day) {
+        char path[32];
+        snprintf(path, sizeof(path), "/logs/2025-10-0%d.log", day);
+        File f = LittleFS.open(path, "w");
+        for (int i = 0; i < 80; ++i) {
+            char line[101];
+            int n = snprintf(line, sizeof(line), "[2025-10-0%d 10:%02d:00.000 UTC][INFO] ", day, i % 60);
+            memset(line + n, 'x', 99 - n);
+            line[99] = '\n';
+            line[100] = '\0';
+            f.print(line);
+        }
+        f.close();
+    }
+
+    LogStore again(LittleFS);
+    ASSERT_TRUE(again.begin());
+    EXPECT_FALSE(LittleFS.exists("/logs/2025-10-01.log"));
+    LogQuery firstDay;
+    firstDay.to = 1759363199;  // 2025-10-01 23:59:59 UTC
+    EXPECT_TRUE(collect(again, firstDay).empty());
+    LogQuery lastDay;
+    lastDay.from = 1759449600;  // 2025-10-03 00:00:00 UTC
+    EXPECT_EQ(80u, collect(again, lastDay).size());
+    EXPECT_LE(again.totalBytes(), LOG_STORE_QUOTA_BYTES);
+}
+
+TEST_F(LogStoreTest, QueryFiltersByTimeAndLevel) {
+    for (uint32_t i = 0; i < 100; ++i) add(kT0 + i, i % 4);
+
+    LogQuery all;
+    EXPECT_EQ(expected(all), collect(store, all));
+
+    LogQuery window;
+    window.from = kT0 + 10;
+    window.to = kT0 + 59;
+    window.minLevel = 2;
+    std::vector<std::string> got = collect(store, window);
+    EXPECT_EQ(26u, got.size());
+    EXPECT_EQ(expected(window), got);
+
+    LogQuery errors;
+    errors.minLevel = 3;
+    EXPECT_EQ(25u, collect(store, errors).size());
+
+    LogQuery none;
+    none.from = kT0 + 1000;
+    EXPECT_TRUE(collect(store, none).empty());
+}
+
+TEST_F(LogStoreTest, QuerySeeksToTheWindow) {
+    // ~16 KB over four segments; ask for the last ten seconds
+    for (uint32_t i = 0; i < 160; ++i) add(kT0 + i);
+    store.flush();
+    LogQuery q;
+    q.from = kT0 + 150;
+
+    mockfs::stats() = mockfs::Stats();
+    std::vector<std::string> got = collect(store, q);
+    EXPECT_EQ(expected(q), got);
+    EXPECT_EQ(10u, got.size());
+    // Only the last segment is opened, from its closest checkpoint
+    EXPECT_LT(mockfs::stats().bytesRead, LOG_SEGMENT_BYTES / 2);
+    EXPECT_LT(mockfs::stats().bytesRead, store.totalBytes() / 10);
+
+    // And a window in the middle stops before the end of its segment
+    LogQuery mid;
+    mid.from = kT0 + 45;
+    mid.to = kT0 + 49;
+    mockfs::stats() = mockfs::Stats();
+    EXPECT_EQ(expected(mid), collect(store, mid));
+    EXPECT_LT(mockfs::stats().bytesRead, LOG_SEGMENT_BYTES / 2);
+}
+
+TEST_F(LogStoreTest, QueryHandlesOutOfOrderSegments) {
+    // A clock step backwards: the segment is no longer seekable by checkpoint
+    for (uint32_t i = 0; i < 20; ++i) add(kT0 + 100 + i);
+    for (uint32_t i = 0; i < 20; ++i) add(kT0 + i);
+    store.flush();
+    EXPECT_FALSE(store.segment(0).ordered);
+
+    LogQuery q;
+    q.from = kT0 + 105;
+    q.to = kT0 + 110;
+    EXPECT_EQ(expected(q), collect(store, q));
+    EXPECT_EQ(6u, collect(store, q).size());
+}
+
+TEST_F(LogStoreTest, QueryResumesFromACursor) {
+    for (uint32_t i = 0; i < 100; ++i) add(kT0 + i, i % 4);
+    LogCursor cur;
+    cur.query.from = kT0 + 10;
+    cur.query.minLevel = 1;
+
+    // A piece at a time, the way a download drains it
+    std::string got;
+    auto append = [](void* ctx, const char* d, size_t n) { static_cast<std::string*>(ctx)->append(d, n); };
+    size_t calls = 0;
+    while (!cur.done) {
+        store.queryMore(cur, append, &got, 250);
+        ASSERT_LT(++calls, 100u);
+        // Logged mid-download: after the query began, so not part of it
+        if (calls == 2) add(kT0 + 200, 3);
+    }
+    EXPECT_GT(calls, 10u);
+    std::string whole;
+    for (const std::string& line : collect(store, cur.query)) {
+        if (line != lines.back().text) whole += line;
+    }
+    EXPECT_EQ(whole, got);
+}
+
+TEST_F(LogStoreTest, CursorSkipsSegmentsRemovedMeanwhile) {
+    for (uint32_t i = 0; i < 120; ++i) add(kT0 + i);
+    store.flush();
+    ASSERT_EQ(3u, store.segmentCount());
+    LogCursor cur;
+    std::string got;
+    auto append = [](void* ctx, const char* d, size_t n) { static_cast<std::string*>(ctx)->append(d, n); };
+    store.queryMore(cur, append, &got, 100);
+    EXPECT_EQ(lines[0].text, got);
+
+    // The segment it paused in goes under the quota
+    for (uint32_t i = 120; i < 170; ++i) add(kT0 + i);
+    store.flush();
+    ASSERT_EQ(2u, store.segment(0).id);
+    while (!cur.done) store.queryMore(cur, append, &got, 4096);
+    // Picks up at the oldest segment left, up to where the store ended when it began
+    std::string rest;
+    for (const Line& l : lines) {
+        if (l.epoch >= kT0 + 40 && l.epoch < kT0 + 120) rest += l.text;
+    }
+    EXPECT_EQ(lines[0].text + rest, got);
+}
+
+TEST_F(LogStoreTest, ContinuationLinesFollowTheirRecord) {
+    std::string prefix = prefixFor(kT0, 3);
+    const char* text = "trace:\n  frame 1\n";
+    store.append(kT0, 3, prefix.data(), prefix.size(), text, strlen(text));
+    add(kT0 + 1, 1);
+
+    LogQuery q;
+    q.minLevel = 3;
+    std::vector<std::string> got = collect(store, q);
+    ASSERT_EQ(2u, got.size());
+    EXPECT_EQ(prefix + "trace:\n", got[0]);
+    EXPECT_EQ("  frame 1\n", got[1]);
+}
+
+TEST_F(LogStoreTest, RetentionDropsSegmentsOlderThanTheWindow) {
+    for (uint32_t i = 0; i < 40; ++i) add(kT0 + i);
+    for (uint32_t i = 0; i < 40; ++i) add(kT0 + 86400 + i);
+    for (uint32_t i = 0; i < 10; ++i) add(kT0 + 2 * 86400 + i);
+    ASSERT_EQ(3u, store.segmentCount());
+
+    store.enforceRetention(kT0 + 2 * 86400, 1);
+    ASSERT_EQ(2u, store.segmentCount());
+    EXPECT_EQ(kT0 + 86400, store.segment(0).firstEpoch);
+
+    // The active segment is kept however old it is
+    store.enforceRetention(kT0 + 30 * 86400, 1);
+    EXPECT_EQ(1u, store.segmentCount());
+}
+
+TEST_F(LogStoreTest, ListsDaysNewestFirst) {
+    for (uint32_t i = 0; i < 40; ++i) add(kT0 + i);
+    for (uint32_t i = 0; i < 20; ++i) add(kT0 + 86400 + i);
+
+    std::vector<std::pair<std::string, uint32_t>> days;
+    size_t n = store.forEachDay([](void* ctx, const char* date, uint32_t bytes) {
+        static_cast<std::vector<std::pair<std::string, uint32_t>>*>(ctx)->emplace_back(date, bytes);
+    }, &days);
+    ASSERT_EQ(2u, n);
+    EXPECT_EQ("2025-10-10", days[0].first);
+    EXPECT_EQ("2025-10-09", days[1].first);
+    EXPECT_EQ(6000u, days[0].second + days[1].second);
+}
+
+TEST_F(LogStoreTest, ClearRemovesEverything) {
+    add(0);
+    for (uint32_t i = 0; i < 100; ++i) add(kT0 + i);
+    store.flush();
+    store.clear();
+
+    EXPECT_EQ(0u, store.segmentCount());
+    EXPECT_EQ(0u, store.unsyncedBytes());
+    EXPECT_EQ(0u, LittleFS.usedBytes());
+    add(kT0 + 200);
+    store.flush();
+    EXPECT_EQ(1u, store.segmentCount());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
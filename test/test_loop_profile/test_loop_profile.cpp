@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+
+// Include production code
+#include "../../src/latency_histogram.cpp"
+#include "../../src/loop_profile.cpp"
+
+TEST(LatencyHistogramTest, SmallValuesHaveTheirOwnBucket) {
+    for (uint32_t us = 0; us < 4; ++us) {
+        EXPECT_EQ(us, LatencyHistogram::bucketOf(us));
+        EXPECT_EQ(us, LatencyHistogram::bucketTop(us));
+    }
+    EXPECT_EQ(4u, LatencyHistogram::bucketOf(4));
+    EXPECT_EQ(7u, LatencyHistogram::bucketOf(7));
+    EXPECT_EQ(8u, LatencyHistogram::bucketOf(8));
+    EXPECT_EQ(8u, LatencyHistogram::bucketOf(9));
+    EXPECT_EQ(9u, LatencyHistogram::bucketOf(10));
+}
+
+TEST(LatencyHistogramTest, BucketsTileTheRangeWithin25Percent) {
+    // Every value falls in the bucket whose top is the first at or above it,
+    // and no bucket is wider than a quarter of its lower bound
+    for (uint8_t b = 0; b + 1 < LatencyHistogram::kBuckets; ++b) {
+        uint32_t low = b == 0 ? 0 : LatencyHistogram::bucketTop(b - 1) + 1;
+        uint32_t top = LatencyHistogram::bucketTop(b);
+        ASSERT_LE(low, top) << "bucket " << (int)b;
+        EXPECT_EQ(b, LatencyHistogram::bucketOf(low));
+        EXPECT_EQ(b, LatencyHistogram::bucketOf(top));
+        EXPECT_LE(top - low, low / 4) << "bucket " << (int)b;
+    }
+    // About 4 s and beyond share the last bucket
+    EXPECT_EQ(LatencyHistogram::kBuckets - 1, LatencyHistogram::bucketOf(4200000));
+    EXPECT_EQ(LatencyHistogram::kBuckets - 1, LatencyHistogram::bucketOf(0xFFFFFFFFu));
+}
+
+TEST(LatencyHistogramTest, EmptyReportsZero) {
+    LatencyHistogram h;
+    EXPECT_EQ(0u, h.count());
+    EXPECT_EQ(0u, h.percentile(500));
+    EXPECT_EQ(0u, h.meanUs());
+    EXPECT_EQ(0u, h.maxUs());
+}
+
+TEST(LatencyHistogramTest, PercentilesComeFromTheRightSamples) {
+    LatencyHistogram h;
+    // 98 fast passes, one slow, one very slow
+    for (int i = 0; i < 98; ++i) h.record(1000);
+    h.record(20000);
+    h.record(150000);
+    EXPECT_EQ(100u, h.count());
+    EXPECT_EQ(150000u, h.maxUs());
+    EXPECT_EQ((98u * 1000u + 20000u + 150000u) / 100u, h.meanUs());
+
+    uint32_t p50 = h.percentile(500);
+    EXPECT_GE(p50, 1000u);
+    EXPECT_LE(p50, 1250u);
+    uint32_t p99 = h.percentile(990);
+    EXPECT_GE(p99, 20000u);
+    EXPECT_LE(p99, 25000u);
+    // The top sample is reported exactly: the bucket top is capped at max
+    EXPECT_EQ(150000u, h.percentile(1000));
+}
+
+TEST(LatencyHistogramTest, OverflowKeepsTheExactMax) {
+    LatencyHistogram h;
+    h.record(10);
+    h.record(9000000);
+    EXPECT_EQ(9000000u, h.maxUs());
+    EXPECT_EQ(9000000u, h.percentile(999));
+}
+
+TEST(LatencyHistogramTest, ResetStartsOver) {
+    LatencyHistogram h;
+    h.record(500);
+    h.reset();
+    EXPECT_EQ(0u, h.count());
+    EXPECT_EQ(0u, h.maxUs());
+    h.record(3);
+    EXPECT_EQ(3u, h.percentile(500));
+}
+
+class LoopProfileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        loopProfileReset();
+        setMockMillis(1000);
+    }
+};
+
+TEST_F(LoopProfileTest, TimerRecordsItsScope) {
+    {
+        LoopStageTimer t(LoopStage::Mqtt);
+        setMockMillis(1007);
+    }
+    const LatencyHistogram& h = loopStageHistogram(LoopStage::Mqtt);
+    EXPECT_EQ(1u, h.count());
+    EXPECT_EQ(7000u, h.maxUs());
+    EXPECT_EQ(0u, loopStageHistogram(LoopStage::Pass).count());
+}
+
+TEST_F(LoopProfileTest, ShowIsKeptPerDataLine) {
+    loopShowRecord(0, 3600);
+    loopShowRecord(1, 1200);
+    loopShowRecord(1, 1300);
+    loopShowRecord(LOOP_SHOW_SEGMENTS, 99);  // no such line
+    EXPECT_EQ(1u, loopShowHistogram(0).count());
+    EXPECT_EQ(2u, loopShowHistogram(1).count());
+    EXPECT_EQ(0u, loopShowHistogram(LOOP_SHOW_SEGMENTS).count());
+    loopProfileReset();
+    EXPECT_EQ(0u, loopShowHistogram(1).count());
+}
+
+TEST_F(LoopProfileTest, EveryStageHasAName) {
+    EXPECT_STREQ("pass", loopStageName(LoopStage::Pass));
+    EXPECT_STREQ("led_events", loopStageName(LoopStage::LedEvents));
+    EXPECT_STREQ("none", loopStageName(LoopStage::Count));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include <list>
+#include <thread>
+#include <vector>
+
+// Include production code
+#include "../../src/mem_pool.cpp"
+
+// Counters are global; every test looks at what changed during it
+struct PoolDelta {
+    explicit PoolDelta(MemPool pool) : pool(pool), before(poolStats(pool)) {}
+    size_t inUse() const { return poolStats(pool).inUse - before.inUse; }
+    uint32_t allocs() const { return poolStats(pool).allocs - before.allocs; }
+
+    MemPool pool;
+    MemPoolStats before;
+};
+
+TEST(MemPoolTest, CountsBytesInUseAndHighWater) {
+    PoolDelta bulk(MemPool::Bulk);
+    size_t peakBefore = poolStats(MemPool::Bulk).highWater;
+
+    void* a = poolAlloc(MemPool::Bulk, 1000);
+    void* b = poolAlloc(MemPool::Bulk, 500);
+    ASSERT_NE(nullptr, a);
+    ASSERT_NE(nullptr, b);
+    EXPECT_EQ(1500u, bulk.inUse());
+    EXPECT_EQ(2u, bulk.allocs());
+    EXPECT_GE(poolStats(MemPool::Bulk).highWater, bulk.before.inUse + 1500);
+
+    poolFree(MemPool::Bulk, a, 1000);
+    poolFree(MemPool::Bulk, b, 500);
+    EXPECT_EQ(0u, bulk.inUse());
+    // The peak stays where it got to
+    EXPECT_GE(poolStats(MemPool::Bulk).highWater, peakBefore);
+    EXPECT_GE(poolStats(MemPool::Bulk).highWater, bulk.before.inUse + 1500);
+}
+
+TEST(MemPoolTest, PoolsAreAccountedSeparately) {
+    PoolDelta hot(MemPool::Hot);
+    PoolDelta bulk(MemPool::Bulk);
+    void* p = poolAlloc(MemPool::Hot, 256);
+    EXPECT_EQ(256u, hot.inUse());
+    EXPECT_EQ(0u, bulk.inUse());
+    poolFree(MemPool::Hot, p, 256);
+    EXPECT_EQ(0u, hot.inUse());
+}
+
+TEST(MemPoolTest, CallocZeroFills) {
+    // Dirty a block first so a fresh one is likely to reuse it
+    uint8_t* dirty = static_cast<uint8_t*>(poolAlloc(MemPool::Bulk, 4096));
+    ASSERT_NE(nullptr, dirty);
+    memset(dirty, 0xAB, 4096);
+    poolFree(MemPool::Bulk, dirty, 4096);
+
+    uint8_t* p = static_cast<uint8_t*>(poolCalloc(MemPool::Bulk, 4096));
+    ASSERT_NE(nullptr, p);
+    for (size_t i = 0; i < 4096; ++i) ASSERT_EQ(0, p[i]) << i;
+    poolFree(MemPool::Bulk, p, 4096);
+}
+
+TEST(MemPoolTest, ZeroBytesAndNullAreNoOps) {
+    PoolDelta bulk(MemPool::Bulk);
+    EXPECT_EQ(nullptr, poolAlloc(MemPool::Bulk, 0));
+    poolFree(MemPool::Bulk, nullptr, 100);
+    EXPECT_EQ(0u, bulk.inUse());
+    EXPECT_EQ(0u, bulk.allocs());
+}
+
+TEST(MemPoolTest, NativeBuildHasNoPsram) {
+    void* p = poolAlloc(MemPool::Bulk, 64);
+    EXPECT_FALSE(poolIsExternal(p));
+    EXPECT_EQ(0u, poolStats(MemPool::Bulk).fallbacks);
+    EXPECT_EQ(0u, poolStats(MemPool::Bulk).freeBytes);
+    poolFree(MemPool::Bulk, p, 64);
+    EXPECT_STREQ("hot", poolName(MemPool::Hot));
+    EXPECT_STREQ("bulk", poolName(MemPool::Bulk));
+}
+
+TEST(MemPoolTest, BulkVectorAllocatesFromThePool) {
+    PoolDelta bulk(MemPool::Bulk);
+    {
+        BulkVector<uint16_t> v;
+        for (uint16_t i = 0; i < 1000; ++i) v.push_back(i);
+        EXPECT_EQ(v.capacity() * sizeof(uint16_t), bulk.inUse());
+        EXPECT_EQ(999, v.back());
+
+        // Copies and moves keep the accounting straight
+        BulkVector<uint16_t> copy = v;
+        EXPECT_EQ((v.capacity() + copy.capacity()) * sizeof(uint16_t), bulk.inUse());
+        BulkVector<uint16_t> moved = std::move(copy);
+        EXPECT_EQ((v.capacity() + moved.capacity()) * sizeof(uint16_t), bulk.inUse());
+        EXPECT_EQ(v, moved);
+    }
+    EXPECT_EQ(0u, bulk.inUse());
+}
+
+TEST(MemPoolTest, AllocatorRebindsForNodeContainers) {
+    PoolDelta hot(MemPool::Hot);
+    {
+        std::list<int, PoolAllocator<int, MemPool::Hot>> l;
+        for (int i = 0; i < 10; ++i) l.push_back(i);
+        EXPECT_EQ(10u, hot.allocs());
+        EXPECT_GT(hot.inUse(), 10 * sizeof(int));
+    }
+    EXPECT_EQ(0u, hot.inUse());
+    EXPECT_TRUE((PoolAllocator<int, MemPool::Hot>() == PoolAllocator<char, MemPool::Hot>()));
+}
+
+TEST(MemPoolTest, PoolBufferFreesOnScopeExit) {
+    PoolDelta bulk(MemPool::Bulk);
+    {
+        PoolBuffer buf(MemPool::Bulk, 2048);
+        ASSERT_NE(nullptr, buf.data());
+        EXPECT_EQ(2048u, buf.size());
+        buf.data()[2047] = 1;
+        EXPECT_EQ(2048u, bulk.inUse());
+    }
+    EXPECT_EQ(0u, bulk.inUse());
+}
+
+TEST(MemPoolTest, CountersHoldUpAcrossThreads) {
+    PoolDelta bulk(MemPool::Bulk);
+    const int kThreads = 8;
+    const int kRounds = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < kRounds; ++i) {
+                size_t bytes = 16 + (i % 64);
+                void* p = poolAlloc(MemPool::Bulk, bytes);
+                poolFree(MemPool::Bulk, p, bytes);
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    EXPECT_EQ(0u, bulk.inUse());
+    EXPECT_EQ((uint32_t)(kThreads * kRounds), bulk.allocs());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,9 @@
 // Include production code
 #include "../../src/mqtt_discovery_builder.h"
 #include "../../src/mqtt_discovery_builder.cpp"
+#include "../../src/mqtt_setup.cpp"
+#include "../../src/mem_pool.cpp"
+#include "../../src/json_arena.cpp"
 
 class MqttDiscoveryBuilderTest : public ::testing::Test {
 protected:
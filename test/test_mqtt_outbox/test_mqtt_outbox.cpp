@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/PubSubClient.h"
+
+// Include production code
+#include "../../src/mqtt_topics.cpp"
+#include "../../src/mem_pool.cpp"
+#include "../../src/mqtt_outbox.cpp"
+#include "../../src/mqtt_publisher.cpp"
+
+class MqttOutboxTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mqtt.clear();
+        ASSERT_TRUE(topics.build("wordclock"));
+        ASSERT_TRUE(outbox.begin());
+        pub.setOutbox(&outbox);
+    }
+
+    // Drain everything the way mqtt_loop does, budget per tick; returns ticks used
+    size_t drainAll(size_t perTick) {
+        size_t ticks = 0;
+        while (!outbox.empty() && ticks < 100) {
+            pub.drainOutbox(perTick);
+            ticks++;
+        }
+        return ticks;
+    }
+
+    std::vector<std::string> sentTopics() const {
+        std::vector<std::string> out;
+        for (const auto& m : mqtt.getPublishedMessages()) out.push_back(m.topic.c_str());
+        return out;
+    }
+
+    PubSubClient mqtt;
+    MqttTopicTable topics;
+    MqttOutbox outbox;
+    MqttPublisher pub{mqtt, topics};
+};
+
+TEST_F(MqttOutboxTest, StateIsLastValueWins) {
+    ASSERT_TRUE(outbox.putState(MqttTopic::AnimState, "classic", 7));
+    ASSERT_TRUE(outbox.putState(MqttTopic::AnimState, "smart", 5));
+    ASSERT_TRUE(outbox.putState(MqttTopic::AnimState, "wipe", 4));
+
+    EXPECT_EQ(1u, outbox.depth());
+    EXPECT_EQ(2u, outbox.coalescedCount());
+
+    MqttOutbox::Message m;
+    ASSERT_TRUE(outbox.peek(m));
+    EXPECT_EQ(MqttTopic::AnimState, m.topic);
+    EXPECT_EQ(std::string("wipe"), std::string(m.payload, m.length));
+}
+
+TEST_F(MqttOutboxTest, StateDrainsInTopicOrder) {
+    outbox.putState(MqttTopic::NightActive, "ON", 2);
+    outbox.putState(MqttTopic::LightState, "{}", 2);
+
+    MqttOutbox::Message m;
+    ASSERT_TRUE(outbox.peek(m));
+    EXPECT_EQ(MqttTopic::LightState, m.topic);
+    outbox.pop();
+    ASSERT_TRUE(outbox.peek(m));
+    EXPECT_EQ(MqttTopic::NightActive, m.topic);
+    outbox.pop();
+    EXPECT_TRUE(outbox.empty());
+    EXPECT_EQ(kMqttTopicCount, outbox.capacity());
+}
+
+TEST_F(MqttOutboxTest, OversizedPayloadIsDropped) {
+    std::string big(MQTT_OUTBOX_PAYLOAD_MAX + 1, 'x');
+    EXPECT_FALSE(outbox.putState(MqttTopic::Version, big.c_str(), big.size()));
+    EXPECT_EQ(1u, outbox.droppedCount());
+    EXPECT_TRUE(outbox.empty());
+}
+
+TEST_F(MqttOutboxTest, PeakDepthIsTracked) {
+    outbox.putState(MqttTopic::Version, "1", 1);
+    outbox.putState(MqttTopic::Ip, "2", 1);
+    outbox.putState(MqttTopic::Heap, "3", 1);
+    outbox.clear();
+    outbox.putState(MqttTopic::Version, "1", 1);
+    EXPECT_EQ(1u, outbox.depth());
+    EXPECT_EQ(3u, outbox.peakDepth());
+}
+
+TEST_F(MqttOutboxTest, OfflinePublishesAreQueuedNotLost) {
+    mqtt.setConnected(false);
+    EXPECT_TRUE(pub.publishSwitch(MqttTopic::ClockState, false));
+    EXPECT_TRUE(pub.publishSwitch(MqttTopic::ClockState, true));
+    EXPECT_TRUE(pub.publish(MqttTopic::AnimState, "smart"));
+
+    EXPECT_EQ(0u, mqtt.getPublishCalls());
+    EXPECT_EQ(3u, pub.queuedCount());
+    EXPECT_EQ(2u, outbox.depth());
+
+    mqtt.setConnected(true);
+    EXPECT_EQ(1u, drainAll(2));
+
+    std::vector<std::string> expected = {"wordclock/clock/state", "wordclock/animate/state"};
+    EXPECT_EQ(expected, sentTopics());
+    EXPECT_EQ(String("ON"), mqtt.getPublishedPayload("wordclock/clock/state"));
+    EXPECT_TRUE(mqtt.getPublishedMessages()[0].retained);
+}
+
+TEST_F(MqttOutboxTest, OfflineEventsAreNotQueued) {
+    mqtt.setConnected(false);
+    EXPECT_FALSE(pub.publishEvent(MqttTopic::Birth, "hello", 5, true));
+    EXPECT_FALSE(pub.publish(MqttTopic::Birth, "hello", false));
+    EXPECT_TRUE(outbox.empty());
+    EXPECT_EQ(0u, pub.queuedCount());
+    EXPECT_EQ(2u, pub.failedCount());
+}
+
+TEST_F(MqttOutboxTest, DrainRespectsBudgetPerTick) {
+    mqtt.setConnected(false);
+    for (size_t i = 0; i < kMqttTopicCount; ++i) {
+        pub.publishInt(static_cast<MqttTopic>(i), (long)i);
+    }
+    ASSERT_EQ(kMqttTopicCount, outbox.depth());
+    mqtt.setConnected(true);
+
+    EXPECT_EQ(3u, pub.drainOutbox(3));
+    EXPECT_EQ(3u, mqtt.getPublishCalls());
+    EXPECT_EQ(kMqttTopicCount - 3, outbox.depth());
+    size_t ticks = drainAll(3);
+    EXPECT_EQ((kMqttTopicCount - 3 + 2) / 3, ticks);
+    EXPECT_EQ(kMqttTopicCount, mqtt.getPublishCalls());
+}
+
+TEST_F(MqttOutboxTest, DrainStopsWhenLinkDropsAgain) {
+    mqtt.setConnected(false);
+    pub.publish(MqttTopic::Version, "1");
+    pub.publish(MqttTopic::Ip, "10.0.0.2");
+    mqtt.setConnected(true);
+
+    ASSERT_EQ(1u, pub.drainOutbox(1));
+    mqtt.setConnected(false);
+    EXPECT_EQ(0u, pub.drainOutbox(10));
+    EXPECT_EQ(1u, outbox.depth());
+
+    mqtt.setConnected(true);
+    EXPECT_EQ(1u, pub.drainOutbox(10));
+    EXPECT_TRUE(outbox.empty());
+    EXPECT_EQ(2u, mqtt.getPublishCalls());
+}
+
+TEST_F(MqttOutboxTest, DirectPublishSupersedesQueuedState) {
+    mqtt.setConnected(false);
+    pub.publishIntDeadband(MqttTopic::Rssi, -70, 3);
+    mqtt.setConnected(true);
+    // The reconnect state round sends a fresher value before the drain runs
+    pub.invalidate();
+    pub.publishIntDeadband(MqttTopic::Rssi, -60, 3);
+    EXPECT_TRUE(outbox.empty());
+
+    pub.drainOutbox(10);
+    ASSERT_EQ(1u, mqtt.getPublishCalls());
+    EXPECT_EQ(String("-60"), mqtt.getPublishedPayload("wordclock/rssi"));
+}
+
+TEST_F(MqttOutboxTest, DrainedStateFeedsDiffCache) {
+    mqtt.setConnected(false);
+    pub.publish(MqttTopic::AnimState, "smart");
+    mqtt.setConnected(true);
+    drainAll(4);
+    ASSERT_EQ(1u, mqtt.getPublishCalls());
+
+    // Broker now retains "smart": the next identical round is suppressed
+    EXPECT_TRUE(pub.publish(MqttTopic::AnimState, "smart"));
+    EXPECT_EQ(1u, mqtt.getPublishCalls());
+    EXPECT_EQ(1u, pub.suppressedCount());
+}
+
+TEST_F(MqttOutboxTest, ValueRevertedWhileOfflineStillGoesOut) {
+    pub.publish(MqttTopic::AnimState, "classic");
+    mqtt.setConnected(false);
+    pub.publish(MqttTopic::AnimState, "smart");
+    // Back to what the broker had before the outage: must replace "smart"
+    pub.publish(MqttTopic::AnimState, "classic");
+    mqtt.setConnected(true);
+    drainAll(4);
+
+    ASSERT_EQ(2u, mqtt.getPublishCalls());
+    EXPECT_EQ(String("classic"), mqtt.getPublishedMessages()[1].payload);
+}
+
+TEST_F(MqttOutboxTest, RepeatedOutagesKeepQueueBounded) {
+    for (int cycle = 0; cycle < 5; ++cycle) {
+        mqtt.setConnected(false);
+        for (int i = 0; i < 10; ++i) {
+            pub.publishInt(MqttTopic::NightDimState, cycle * 10 + i);
+            pub.publishSwitch(MqttTopic::UpdateRunning, i % 2 == 0);
+        }
+        EXPECT_LE(outbox.depth(), outbox.capacity());
+        mqtt.setConnected(true);
+        drainAll(4);
+        EXPECT_TRUE(outbox.empty());
+    }
+    // Per cycle: one coalesced brightness and one coalesced switch
+    EXPECT_EQ(10u, mqtt.getPublishCalls());
+    EXPECT_EQ(0u, outbox.droppedCount());
+    EXPECT_EQ(90u, outbox.coalescedCount());
+    String last;
+    for (const auto& m : mqtt.getPublishedMessages()) {
+        if (m.topic == String(topics.get(MqttTopic::NightDimState))) last = m.payload;
+    }
+    EXPECT_EQ(String("49"), last);
+}
+
+TEST_F(MqttOutboxTest, WithoutOutboxOfflinePublishesFail) {
+    pub.setOutbox(nullptr);
+    mqtt.setConnected(false);
+    EXPECT_FALSE(pub.publish(MqttTopic::Version, "1"));
+    EXPECT_EQ(1u, pub.failedCount());
+    EXPECT_EQ(0u, pub.queuedCount());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
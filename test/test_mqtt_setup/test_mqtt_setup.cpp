@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/mock_preferences.h"
+#include <PubSubClient.h>
+
+// Include production code
+#include "../../src/mqtt_setup.cpp"
+
+namespace {
+
+// Each step publishes one message per item, so the mock's publish cost
+// stands in for the time a real socket write takes.
+PubSubClient g_client;
+size_t g_counts[3] = {0, 0, 0};
+int g_failAt = -1;
+std::vector<std::string> g_trace;
+
+size_t countA() { return g_counts[0]; }
+size_t countB() { return g_counts[1]; }
+size_t countC() { return g_counts[2]; }
+
+bool runItem(const char* step, size_t index) {
+  char topic[32];
+  snprintf(topic, sizeof(topic), "%s/%u", step, (unsigned)index);
+  g_trace.push_back(topic);
+  g_client.publish(topic, "x");
+  return g_failAt < 0 || static_cast<int>(g_trace.size()) != g_failAt;
+}
+
+bool runA(size_t i) { return runItem("a", i); }
+bool runB(size_t i) { return runItem("b", i); }
+bool runC(size_t i) { return runItem("c", i); }
+
+size_t traceOfTick(MqttSetupSequence& seq) {
+  size_t before = g_trace.size();
+  seq.tick();
+  return g_trace.size() - before;
+}
+
+}  // namespace
+
+class MqttSetupTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    setMockMillis(0);
+    g_client.clear();
+    g_client.setRecording(false);
+    g_trace.clear();
+    g_failAt = -1;
+    g_counts[0] = g_counts[1] = g_counts[2] = 0;
+    Preferences::reset();
+  }
+};
+
+TEST_F(MqttSetupTest, RunsEveryItemInOrder) {
+  const MqttSetupStep steps[] = {
+    {"a", countA, runA, false},
+    {"b", countB, runB, false},
+  };
+  g_counts[0] = 2;
+  g_counts[1] = 3;
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 2, {100, 10});
+  while (seq.tick()) {}
+
+  ASSERT_TRUE(seq.finished());
+  ASSERT_FALSE(seq.failed());
+  std::vector<std::string> expected = {"a/0", "a/1", "b/0", "b/1", "b/2"};
+  EXPECT_EQ(expected, g_trace);
+  EXPECT_EQ(5u, seq.itemsRun());
+  EXPECT_EQ(1u, seq.ticks());
+}
+
+TEST_F(MqttSetupTest, CapsItemsPerTick) {
+  const MqttSetupStep steps[] = {{"a", countA, runA, false}};
+  g_counts[0] = 10;
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 1, {1000, 4});
+
+  EXPECT_EQ(4u, traceOfTick(seq));
+  EXPECT_EQ(4u, traceOfTick(seq));
+  EXPECT_EQ(2u, traceOfTick(seq));
+  EXPECT_TRUE(seq.finished());
+  EXPECT_EQ(3u, seq.ticks());
+}
+
+TEST_F(MqttSetupTest, StopsAtTimeBudget) {
+  const MqttSetupStep steps[] = {{"a", countA, runA, false}};
+  g_counts[0] = 30;
+  g_client.setPublishCostMs(4);
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 1, {10, 100});
+  while (seq.tick()) {}
+
+  // 4 ms per item against a 10 ms budget: three items fit before the check trips
+  EXPECT_EQ(30u, seq.itemsRun());
+  EXPECT_EQ(10u, seq.ticks());
+  EXPECT_EQ(12u, seq.longestTickMs());
+  EXPECT_EQ(120u, seq.elapsedMs());
+}
+
+TEST_F(MqttSetupTest, SlowItemStillMakesProgress) {
+  const MqttSetupStep steps[] = {{"a", countA, runA, false}};
+  g_counts[0] = 3;
+  g_client.setPublishCostMs(50);
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 1, {10, 4});
+
+  EXPECT_EQ(1u, traceOfTick(seq));
+  EXPECT_EQ(1u, traceOfTick(seq));
+  EXPECT_EQ(1u, traceOfTick(seq));
+  EXPECT_TRUE(seq.finished());
+}
+
+TEST_F(MqttSetupTest, ExclusiveItemRunsAlone) {
+  const MqttSetupStep steps[] = {
+    {"a", countA, runA, false},
+    {"b", countB, runB, true},
+    {"c", countC, runC, false},
+  };
+  g_counts[0] = 1;
+  g_counts[1] = 1;
+  g_counts[2] = 2;
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 3, {1000, 10});
+
+  EXPECT_EQ(1u, traceOfTick(seq));  // a/0, then stops before the exclusive item
+  EXPECT_EQ(1u, traceOfTick(seq));  // b/0 on its own
+  EXPECT_EQ(2u, traceOfTick(seq));  // c/0, c/1
+  EXPECT_TRUE(seq.finished());
+}
+
+TEST_F(MqttSetupTest, CountIsEvaluatedOnStepEntry) {
+  const MqttSetupStep steps[] = {
+    {"a", countA, runA, false},
+    {"b", countB, runB, false},
+  };
+  g_counts[0] = 2;
+  g_counts[1] = 0;
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 2, {1000, 1});
+  seq.tick();
+  // Step b has not been entered yet, so it picks up the new count
+  g_counts[1] = 2;
+  while (seq.tick()) {}
+
+  std::vector<std::string> expected = {"a/0", "a/1", "b/0", "b/1"};
+  EXPECT_EQ(expected, g_trace);
+}
+
+TEST_F(MqttSetupTest, EmptyStepsAreSkipped) {
+  const MqttSetupStep steps[] = {
+    {"a", countA, runA, false},
+    {"b", countB, runB, false},
+    {"c", countC, runC, false},
+  };
+  g_counts[0] = 1;
+  g_counts[2] = 1;
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 3, {1000, 10});
+  EXPECT_FALSE(seq.tick());
+
+  std::vector<std::string> expected = {"a/0", "c/0"};
+  EXPECT_EQ(expected, g_trace);
+  EXPECT_TRUE(seq.finished());
+}
+
+TEST_F(MqttSetupTest, FailureStopsTheSequence) {
+  const MqttSetupStep steps[] = {
+    {"a", countA, runA, false},
+    {"b", countB, runB, false},
+  };
+  g_counts[0] = 3;
+  g_counts[1] = 3;
+  g_failAt = 4;  // b/0
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 2, {1000, 10});
+  EXPECT_FALSE(seq.tick());
+
+  EXPECT_TRUE(seq.failed());
+  EXPECT_FALSE(seq.finished());
+  EXPECT_STREQ("b", seq.stepName());
+  EXPECT_EQ(4u, g_trace.size());
+  EXPECT_FALSE(seq.tick());
+  EXPECT_EQ(4u, g_trace.size());
+}
+
+TEST_F(MqttSetupTest, AbortLeavesNothingToDo) {
+  const MqttSetupStep steps[] = {{"a", countA, runA, false}};
+  g_counts[0] = 10;
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 1, {1000, 2});
+  seq.tick();
+  seq.abort();
+
+  EXPECT_FALSE(seq.active());
+  EXPECT_FALSE(seq.finished());
+  EXPECT_FALSE(seq.tick());
+  EXPECT_EQ(2u, g_trace.size());
+}
+
+TEST_F(MqttSetupTest, StepWithoutCountRunsOnce) {
+  const MqttSetupStep steps[] = {{"a", nullptr, runA, false}};
+
+  MqttSetupSequence seq;
+  seq.begin(steps, 1, {1000, 10});
+  while (seq.tick()) {}
+
+  EXPECT_EQ(1u, g_trace.size());
+  EXPECT_TRUE(seq.finished());
+}
+
+TEST_F(MqttSetupTest, DiscoveryCacheMatchesStoredHash) {
+  MqttDiscoveryCache cache;
+  uint32_t h = MqttDiscoveryCache::hashString(MqttDiscoveryCache::kSeed, "payload");
+
+  EXPECT_FALSE(cache.matches(h));
+  cache.store(h);
+  EXPECT_TRUE(cache.matches(h));
+  EXPECT_FALSE(cache.matches(h + 1));
+
+  cache.forget();
+  EXPECT_FALSE(cache.matches(h));
+}
+
+TEST_F(MqttSetupTest, DiscoveryCacheDoesNotMatchZeroWhenEmpty) {
+  MqttDiscoveryCache cache;
+  EXPECT_FALSE(cache.matches(0));
+}
+
+TEST_F(MqttSetupTest, HashStringSeparatesFieldBoundaries) {
+  uint32_t seed = MqttDiscoveryCache::kSeed;
+  uint32_t ab_c = MqttDiscoveryCache::hashString(MqttDiscoveryCache::hashString(seed, "ab"), "c");
+  uint32_t a_bc = MqttDiscoveryCache::hashString(MqttDiscoveryCache::hashString(seed, "a"), "bc");
+  EXPECT_NE(ab_c, a_bc);
+  EXPECT_EQ(seed, MqttDiscoveryCache::hashString(seed, nullptr));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,263 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/PubSubClient.h"
+#include "../helpers/alloc_counter.h"
+
+// Include production code
+#include "../../src/mqtt_topics.cpp"
+#include "../../src/mem_pool.cpp"
+#include "../../src/mqtt_outbox.cpp"
+#include "../../src/mqtt_publisher.cpp"
+
+class MqttTopicsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mqtt.clear();
+        ASSERT_TRUE(topics.build("wordclock"));
+    }
+
+    PubSubClient mqtt;
+    MqttTopicTable topics;
+};
+
+TEST_F(MqttTopicsTest, RendersEveryTopicBelowBase) {
+    EXPECT_STREQ("wordclock", topics.base());
+    EXPECT_STREQ("wordclock/availability", topics.get(MqttTopic::Availability));
+    EXPECT_STREQ("wordclock/light/state", topics.get(MqttTopic::LightState));
+    EXPECT_STREQ("wordclock/nightmode/active", topics.get(MqttTopic::NightActive));
+    EXPECT_STREQ("wordclock/laststartup", topics.get(MqttTopic::LastStartup));
+    EXPECT_STREQ("wordclock/update/running", topics.get(MqttTopic::UpdateRunning));
+
+    for (size_t i = 0; i < kMqttTopicCount; ++i) {
+        MqttTopic t = static_cast<MqttTopic>(i);
+        std::string expected = std::string("wordclock/") + mqttTopicSuffix(t);
+        EXPECT_EQ(expected, topics.get(t));
+    }
+}
+
+TEST_F(MqttTopicsTest, SuffixesAreUnique) {
+    for (size_t i = 0; i < kMqttTopicCount; ++i) {
+        for (size_t j = i + 1; j < kMqttTopicCount; ++j) {
+            EXPECT_STRNE(mqttTopicSuffix(static_cast<MqttTopic>(i)),
+                         mqttTopicSuffix(static_cast<MqttTopic>(j)));
+        }
+    }
+}
+
+TEST_F(MqttTopicsTest, MatchesInboundTopics) {
+    MqttTopic t;
+    ASSERT_TRUE(topics.match("wordclock/light/set", t));
+    EXPECT_EQ(MqttTopic::LightSet, t);
+    ASSERT_TRUE(topics.match("wordclock/nightmode/end/set", t));
+    EXPECT_EQ(MqttTopic::NightEndSet, t);
+
+    for (size_t i = 0; i < kMqttTopicCount; ++i) {
+        ASSERT_TRUE(topics.match(topics.get(static_cast<MqttTopic>(i)), t));
+        EXPECT_EQ(i, static_cast<size_t>(t));
+    }
+}
+
+TEST_F(MqttTopicsTest, RejectsForeignTopics) {
+    MqttTopic t;
+    EXPECT_FALSE(topics.match("other/light/set", t));
+    EXPECT_FALSE(topics.match("wordclockX/light/set", t));
+    EXPECT_FALSE(topics.match("wordclock", t));
+    EXPECT_FALSE(topics.match("wordclock/light", t));
+    EXPECT_FALSE(topics.match("wordclock/light/set/extra", t));
+    EXPECT_FALSE(topics.match(nullptr, t));
+    EXPECT_EQ(nullptr, topics.suffixOf("other/x"));
+    EXPECT_STREQ("light/set", topics.suffixOf("wordclock/light/set"));
+}
+
+TEST_F(MqttTopicsTest, RebuildReplacesBase) {
+    ASSERT_TRUE(topics.build("home/clock2"));
+    EXPECT_STREQ("home/clock2/light/state", topics.get(MqttTopic::LightState));
+    MqttTopic t;
+    EXPECT_FALSE(topics.match("wordclock/light/set", t));
+    EXPECT_TRUE(topics.match("home/clock2/light/set", t));
+}
+
+TEST_F(MqttTopicsTest, OverlongBaseFailsWithoutTruncating) {
+    std::string base(MQTT_TOPIC_ARENA_SIZE / 8, 'b');
+    EXPECT_FALSE(topics.build(base.c_str()));
+    EXPECT_FALSE(topics.isBuilt());
+    EXPECT_STREQ("", topics.get(MqttTopic::LightState));
+    MqttTopic t;
+    EXPECT_FALSE(topics.match((base + "/light/set").c_str(), t));
+
+    MqttPublisher pub(mqtt, topics);
+    EXPECT_FALSE(pub.publishSwitch(MqttTopic::AnimState, true));
+    EXPECT_EQ(0u, mqtt.getPublishCalls());
+}
+
+TEST_F(MqttTopicsTest, ArenaFitsTypicalBase) {
+    // A realistic "home/<room>/<device>" base must fit with room to spare
+    ASSERT_TRUE(topics.build("home/livingroom/wordclock_AABBCCDDEEFF"));
+    EXPECT_LT(topics.used(), (size_t)MQTT_TOPIC_ARENA_SIZE);
+}
+
+TEST_F(MqttTopicsTest, BuildAndMatchDoNotAllocate) {
+    AllocCounter counter;
+    ASSERT_TRUE(topics.build("wordclock/kitchen"));
+    MqttTopic t;
+    for (size_t i = 0; i < kMqttTopicCount; ++i) {
+        ASSERT_TRUE(topics.match(topics.get(static_cast<MqttTopic>(i)), t));
+    }
+    EXPECT_EQ(0u, counter.allocations());
+}
+
+TEST_F(MqttTopicsTest, PublishesPayloadsToTableTopics) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publishSwitch(MqttTopic::AnimState, true);
+    pub.publishSwitch(MqttTopic::NightActive, false);
+    pub.publishInt(MqttTopic::Rssi, -67);
+    pub.publishUInt(MqttTopic::Heap, 123456UL);
+    pub.publish(MqttTopic::Version, "1.2.3");
+
+    EXPECT_EQ(String("ON"), mqtt.getPublishedPayload("wordclock/animate/state"));
+    EXPECT_EQ(String("OFF"), mqtt.getPublishedPayload("wordclock/nightmode/active"));
+    EXPECT_EQ(String("-67"), mqtt.getPublishedPayload("wordclock/rssi"));
+    EXPECT_EQ(String("123456"), mqtt.getPublishedPayload("wordclock/heap"));
+    EXPECT_EQ(String("1.2.3"), mqtt.getPublishedPayload("wordclock/version"));
+    for (const auto& msg : mqtt.getPublishedMessages()) {
+        EXPECT_TRUE(msg.retained);
+    }
+    EXPECT_EQ(5u, pub.publishedCount());
+    EXPECT_EQ(0u, pub.failedCount());
+}
+
+TEST_F(MqttTopicsTest, LightStateMatchesPreviousJson) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publishLightState(true, 128, 255, 10, 0, 42);
+    EXPECT_EQ(String("{\"state\":\"ON\",\"brightness\":128,\"color_mode\":\"rgbw\","
+                     "\"color\":{\"r\":255,\"g\":10,\"b\":0,\"w\":42}}"),
+              mqtt.getPublishedPayload("wordclock/light/state"));
+}
+
+TEST_F(MqttTopicsTest, LightStateWorstCaseFitsBuffer) {
+    char buf[128];
+    size_t n = MqttPublisher::formatLightState(buf, sizeof(buf), false, 255, 255, 255, 255, 255);
+    EXPECT_GT(n, 0u);
+    EXPECT_EQ(strlen(buf), n);
+    EXPECT_EQ(0u, MqttPublisher::formatLightState(buf, 16, true, 1, 2, 3, 4, 5));
+}
+
+TEST_F(MqttTopicsTest, StateRoundDoesNotAllocate) {
+    MqttPublisher pub(mqtt, topics);
+    mqtt.setRecording(false);
+
+    // Mirrors the shape of mqtt_publish_state(): light JSON, switches,
+    // numbers and short strings, one publish per topic.
+    AllocCounter counter;
+    for (int round = 0; round < 10; ++round) {
+        pub.publishLightState(true, 200, 1, 2, 3, 4);
+        pub.publishSwitch(MqttTopic::AnimState, true);
+        pub.publishSwitch(MqttTopic::AutoUpdateState, false);
+        pub.publishInt(MqttTopic::HetIsState, 10);
+        pub.publishSwitch(MqttTopic::NightEnabledState, true);
+        pub.publish(MqttTopic::NightEffectState, "DIM");
+        pub.publishInt(MqttTopic::NightDimState, 20);
+        pub.publish(MqttTopic::NightStartState, "22:00");
+        pub.publish(MqttTopic::NightEndState, "06:30");
+        pub.publish(MqttTopic::NightOverrideState, "AUTO");
+        pub.publishSwitch(MqttTopic::NightActive, false);
+        pub.publish(MqttTopic::LogLevelState, "INFO");
+        pub.publish(MqttTopic::Version, "1.0.0");
+        pub.publish(MqttTopic::Ip, "192.168.1.20");
+        pub.publishInt(MqttTopic::Rssi, -60);
+        pub.publishUInt(MqttTopic::Heap, 150000UL);
+        pub.publishInt(MqttTopic::WifiChannel, 6);
+        pub.publish(MqttTopic::BootReason, "POWERON");
+        pub.publishUInt(MqttTopic::ResetCount, 3UL);
+    }
+    EXPECT_EQ(0u, counter.allocations());
+    // Identical rounds: only the first one reaches the client
+    EXPECT_EQ(19u, mqtt.getPublishCalls());
+    EXPECT_EQ(171u, pub.suppressedCount());
+    EXPECT_GT(mqtt.getPublishBytes(), 0u);
+}
+
+TEST_F(MqttTopicsTest, UnchangedRetainedPayloadIsSuppressed) {
+    MqttPublisher pub(mqtt, topics);
+    EXPECT_TRUE(pub.publishSwitch(MqttTopic::AnimState, true));
+    EXPECT_TRUE(pub.publishSwitch(MqttTopic::AnimState, true));
+    EXPECT_EQ(1u, mqtt.getPublishCalls());
+    EXPECT_EQ(1u, pub.suppressedCount());
+
+    EXPECT_TRUE(pub.publishSwitch(MqttTopic::AnimState, false));
+    EXPECT_EQ(2u, mqtt.getPublishCalls());
+    EXPECT_EQ(String("OFF"), mqtt.getPublishedMessages().back().payload);
+}
+
+TEST_F(MqttTopicsTest, CacheIsPerTopic) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publishSwitch(MqttTopic::AnimState, true);
+    pub.publishSwitch(MqttTopic::NightEnabledState, true);
+    EXPECT_EQ(2u, mqtt.getPublishCalls());
+    EXPECT_EQ(0u, pub.suppressedCount());
+}
+
+TEST_F(MqttTopicsTest, InvalidateResendsEverything) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publishInt(MqttTopic::NightDimState, 20);
+    pub.publish(MqttTopic::Version, "1.0.0");
+    pub.invalidate();
+    pub.publishInt(MqttTopic::NightDimState, 20);
+    pub.publish(MqttTopic::Version, "1.0.0");
+    EXPECT_EQ(4u, mqtt.getPublishCalls());
+
+    pub.invalidate(MqttTopic::Version);
+    pub.publishInt(MqttTopic::NightDimState, 20);
+    pub.publish(MqttTopic::Version, "1.0.0");
+    EXPECT_EQ(5u, mqtt.getPublishCalls());
+}
+
+TEST_F(MqttTopicsTest, NonRetainedEventsAlwaysGoOut) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publish(MqttTopic::Birth, "{}", false);
+    pub.publish(MqttTopic::Birth, "{}", false);
+    EXPECT_EQ(2u, mqtt.getPublishCalls());
+    EXPECT_EQ(0u, pub.suppressedCount());
+}
+
+TEST_F(MqttTopicsTest, RebuildKeepsCacheForSameTopicIds) {
+    // A new base only changes where topics live; mqtt_client invalidates on
+    // connect, which is the only time a rebuild reaches the broker.
+    MqttPublisher pub(mqtt, topics);
+    pub.publishSwitch(MqttTopic::AnimState, true);
+    ASSERT_TRUE(topics.build("other"));
+    pub.invalidate();
+    pub.publishSwitch(MqttTopic::AnimState, true);
+    EXPECT_TRUE(mqtt.wasPublished("other/animate/state"));
+}
+
+TEST_F(MqttTopicsTest, DeadbandHoldsBackSmallMoves) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publishIntDeadband(MqttTopic::Rssi, -60, 3);   // first value always goes
+    pub.publishIntDeadband(MqttTopic::Rssi, -62, 3);   // |2| < 3: held
+    pub.publishIntDeadband(MqttTopic::Rssi, -58, 3);   // |2| from -60: held
+    EXPECT_EQ(1u, mqtt.getPublishCalls());
+    pub.publishIntDeadband(MqttTopic::Rssi, -63, 3);   // |3|: sent
+    EXPECT_EQ(2u, mqtt.getPublishCalls());
+    EXPECT_EQ(String("-63"), mqtt.getPublishedMessages().back().payload);
+
+    pub.publishIntDeadband(MqttTopic::Heap, 150000, 4096);
+    pub.publishIntDeadband(MqttTopic::Heap, 147000, 4096); // 3000 from last sent: held
+    pub.publishIntDeadband(MqttTopic::Heap, 145000, 4096); // 5000 from last sent: sent
+    EXPECT_EQ(4u, mqtt.getPublishCalls());
+    EXPECT_EQ(3u, pub.suppressedCount());
+}
+
+TEST_F(MqttTopicsTest, DeadbandResetsOnInvalidate) {
+    MqttPublisher pub(mqtt, topics);
+    pub.publishIntDeadband(MqttTopic::Rssi, -60, 3);
+    pub.invalidate();
+    pub.publishIntDeadband(MqttTopic::Rssi, -61, 3);
+    EXPECT_EQ(2u, mqtt.getPublishCalls());
+    EXPECT_EQ(String("-61"), mqtt.getPublishedMessages().back().payload);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -9,6 +9,7 @@
 
 // Include production code
 #include "../../src/night_mode.cpp"
+#include "../../src/settings_store.cpp"
 
 class NightModeTest : public ::testing::Test {
 protected:
@@ -362,6 +363,27 @@ TEST_F(NightModeTest, ZeroLengthSchedule) {
     ASSERT_FALSE(nightMode.isActive()) << "Zero-length schedule should never be active";
 }
 
+static int g_nightChanges = 0;
+static void countNightChanges(StateChange change) {
+    if (change == StateChange::NightMode) g_nightChanges++;
+}
+
+TEST_F(NightModeTest, SettersNotifyStateChange) {
+    g_nightChanges = 0;
+    ASSERT_TRUE(addStateChangeListener(countNightChanges));
+
+    nightMode.setDimPercent(55);
+    ASSERT_GT(g_nightChanges, 0);
+    int afterDim = g_nightChanges;
+    nightMode.setDimPercent(55);  // no change
+    ASSERT_EQ(afterDim, g_nightChanges);
+
+    nightMode.setEnabled(true);
+    ASSERT_GT(g_nightChanges, afterDim);
+
+    removeStateChangeListener(countNightChanges);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+
+// Include production code
+#include "../../src/retained_clock.cpp"
+
+static const int64_t kNoon = 1760788800LL * 1000000LL;  // 2025-10-18 12:00 UTC
+static const int64_t kSecond = 1000000LL;
+
+class RetainedClockTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_retainedClockPowerOn();
+        setMockMillis(0);
+        restoreRetainedTime();
+    }
+
+    // A warm restart `uptimeMs` into the new boot
+    static bool rebootAt(unsigned long uptimeMs) {
+        test_retainedClockReboot();
+        setMockMillis(uptimeMs);
+        return restoreRetainedTime();
+    }
+};
+
+TEST_F(RetainedClockTest, PowerOnHasNoTime) {
+    EXPECT_EQ(TimeConfidence::None, timeConfidence());
+    EXPECT_FALSE(timeWasRestored());
+    EXPECT_EQ(0, test_wallClockUs());
+    retainTime();  // nothing to keep
+    EXPECT_FALSE(rebootAt(500));
+    EXPECT_EQ(TimeConfidence::None, timeConfidence());
+}
+
+TEST_F(RetainedClockTest, SntpMakesItSynced) {
+    setMockMillis(4000);
+    test_sntpSynced(kNoon);
+    EXPECT_EQ(TimeConfidence::Synced, timeConfidence());
+    EXPECT_STREQ("synced", timeConfidenceName(timeConfidence()));
+}
+
+TEST_F(RetainedClockTest, WarmRestartSeedsTheClockUnconfirmed) {
+    setMockMillis(4000);
+    test_sntpSynced(kNoon);
+    setMockMillis(64000);
+    retainTime();  // the clock's once-a-second save, at 12:01:00
+
+    ASSERT_TRUE(rebootAt(700));
+    EXPECT_TRUE(timeWasRestored());
+    EXPECT_EQ(TimeConfidence::Retained, timeConfidence());
+    // 12:01:00 plus the reset estimate and this boot's 0.7 s
+    int64_t expected = kNoon + 60 * kSecond + kResetGapUs + 700 * 1000;
+    EXPECT_EQ(expected, test_wallClockUs());
+
+    // SNTP confirms
+    setMockMillis(3000);
+    test_sntpSynced(kNoon + 63 * kSecond);
+    EXPECT_EQ(TimeConfidence::Synced, timeConfidence());
+}
+
+TEST_F(RetainedClockTest, RecordIsKeptCurrentAcrossRestarts) {
+    setMockMillis(1000);
+    test_sntpSynced(kNoon);
+    retainTime();
+    ASSERT_TRUE(rebootAt(500));
+    setMockMillis(2500);
+    retainTime();  // running on retained time, a restart later still carries it
+
+    ASSERT_TRUE(rebootAt(500));
+    EXPECT_EQ(TimeConfidence::Retained, timeConfidence());
+    EXPECT_GT(test_wallClockUs(), kNoon + 2 * kSecond);
+    EXPECT_LT(test_wallClockUs(), kNoon + 4 * kSecond);
+}
+
+TEST_F(RetainedClockTest, CorruptRecordIsIgnored) {
+    setMockMillis(1000);
+    test_sntpSynced(kNoon);
+    reinterpret_cast<uint8_t*>(&s_record)[3] ^= 0x40;
+    EXPECT_FALSE(rebootAt(500));
+    EXPECT_EQ(TimeConfidence::None, timeConfidence());
+    EXPECT_EQ(0, test_wallClockUs());
+}
+
+TEST_F(RetainedClockTest, DriftComesFromTwoSyncs) {
+    setMockMillis(1000);
+    test_sntpSynced(kNoon);
+    EXPECT_EQ(TimeConfidence::Synced, timeConfidence());
+    EXPECT_EQ(0, timeDriftPpm());
+    // esp_timer counted 3600.036 s while SNTP says 3600 s passed: 10 ppm fast
+    setMockMillis(1000 + 3600036);
+    test_sntpSynced(kNoon + 3600 * kSecond);
+    EXPECT_EQ(TimeConfidence::Synced, timeConfidence());
+    EXPECT_EQ(10, timeDriftPpm());
+
+    // Carried over a restart
+    ASSERT_TRUE(rebootAt(500));
+    EXPECT_EQ(10, timeDriftPpm());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,359 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/mock_preferences.h"
+
+// Include production code
+#include "../../src/settings_store.cpp"
+
+class SettingsStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Preferences::reset();
+        setMockMillis(0);
+        settingsStore.test_reset();
+    }
+
+    static void putStored(const char* ns, const char* key, uint8_t v) {
+        Preferences prefs;
+        prefs.begin(ns, false);
+        prefs.putUChar(key, v);
+        prefs.end();
+    }
+
+    static std::string readStored(const char* ns, const char* key) {
+        Preferences prefs;
+        prefs.begin(ns, true);
+        String v = prefs.isKey(key) ? prefs.getString(key, "") : String("<none>");
+        prefs.end();
+        return v.c_str();
+    }
+};
+
+TEST_F(SettingsStoreTest, LoadsStoredValuesOrDefaults) {
+    putStored("ns", "stored", 7);
+    SettingKey stored = settingsStore.addU8("ns", "stored", 1);
+    SettingKey fresh = settingsStore.addU8("ns", "fresh", 3);
+    EXPECT_EQ(7, settingsStore.getU8(stored));
+    EXPECT_EQ(3, settingsStore.getU8(fresh));
+    EXPECT_TRUE(settingsStore.isStored(stored));
+    EXPECT_FALSE(settingsStore.isStored(fresh));
+    EXPECT_FALSE(settingsStore.pending());
+}
+
+TEST_F(SettingsStoreTest, SettingTheSameStoredValueIsNotAChange) {
+    putStored("ns", "k", 7);
+    SettingKey k = settingsStore.addU8("ns", "k", 0);
+    settingsStore.setU8(k, 7);
+    EXPECT_FALSE(settingsStore.pending());
+    settingsStore.setU8(k, 8);
+    EXPECT_TRUE(settingsStore.pending());
+    EXPECT_TRUE(settingsStore.pending("ns"));
+    EXPECT_FALSE(settingsStore.pending("other"));
+}
+
+TEST_F(SettingsStoreTest, DefaultIsWrittenOnceSetEvenIfUnchanged) {
+    SettingKey k = settingsStore.addBool("ns", "flag", true);
+    settingsStore.setBool(k, true);
+    EXPECT_TRUE(settingsStore.pending());
+    ASSERT_TRUE(settingsStore.commit());
+    EXPECT_EQ("1", readStored("ns", "flag"));
+    settingsStore.setBool(k, true);
+    EXPECT_FALSE(settingsStore.pending());
+}
+
+TEST_F(SettingsStoreTest, LoopWaitsForTheOldestChangeToAge) {
+    SettingKey a = settingsStore.addU8("ns", "a", 0);
+    SettingKey b = settingsStore.addU8("ns", "b", 0);
+    setMockMillis(1000);
+    settingsStore.setU8(a, 1);
+    setMockMillis(4000);
+    settingsStore.setU8(b, 2);  // does not push the commit out
+    EXPECT_EQ(1000u, settingsStore.pendingSinceMs());
+
+    settingsStore.loop(1000 + SETTINGS_COMMIT_DELAY_MS - 1);
+    EXPECT_TRUE(settingsStore.pending());
+    setMockMillis(1000 + SETTINGS_COMMIT_DELAY_MS);
+    settingsStore.loop(1000 + SETTINGS_COMMIT_DELAY_MS);
+    EXPECT_FALSE(settingsStore.pending());
+    EXPECT_EQ("1", readStored("ns", "a"));
+    EXPECT_EQ("2", readStored("ns", "b"));
+    EXPECT_EQ(1u, settingsStore.stats(millis()).commits);
+}
+
+TEST_F(SettingsStoreTest, CommitWritesOnlyPendingKeys) {
+    putStored("ns", "a", 1);
+    putStored("ns", "b", 2);
+    SettingKey a = settingsStore.addU8("ns", "a", 0);
+    settingsStore.addU8("ns", "b", 0);
+    settingsStore.setU8(a, 5);
+
+    // Something else changes b behind the store's back; it must survive
+    putStored("ns", "b", 9);
+    ASSERT_TRUE(settingsStore.commit());
+    EXPECT_EQ("5", readStored("ns", "a"));
+    EXPECT_EQ("9", readStored("ns", "b"));
+
+    SettingsStoreStats st = settingsStore.stats(millis());
+    EXPECT_EQ(1u, st.commits);
+    EXPECT_EQ(1u, st.keysWritten);
+    EXPECT_EQ(32u, st.bytesWritten);
+}
+
+TEST_F(SettingsStoreTest, OneCommitCoversEveryNamespace) {
+    SettingKey led = settingsStore.addU8("wc_led", "br", 64);
+    SettingKey night = settingsStore.addU16("wc_night", "start", 1320);
+    SettingKey channel = settingsStore.addString("wc_display", "upd_ch", "stable");
+    SettingKey retention = settingsStore.addU32("wc_log", "retention", 1);
+    settingsStore.setU8(led, 200);
+    settingsStore.setU16(night, 1380);
+    settingsStore.setString(channel, "early");
+    settingsStore.setU32(retention, 7);
+
+    ASSERT_TRUE(settingsStore.commit());
+    SettingsStoreStats st = settingsStore.stats(millis());
+    EXPECT_EQ(1u, st.commits);
+    EXPECT_EQ(4u, st.keysWritten);
+    // Three numbers plus "early\0" in a header entry and one data entry
+    EXPECT_EQ(3u * 32u + 64u, st.bytesWritten);
+    EXPECT_EQ("200", readStored("wc_led", "br"));
+    EXPECT_EQ("1380", readStored("wc_night", "start"));
+    EXPECT_EQ("early", readStored("wc_display", "upd_ch"));
+    EXPECT_EQ("7", readStored("wc_log", "retention"));
+
+    // Nothing pending: no commit counted
+    ASSERT_TRUE(settingsStore.commit());
+    EXPECT_EQ(1u, settingsStore.stats(millis()).commits);
+}
+
+TEST_F(SettingsStoreTest, ReRegisteringReloadsAndDropsUnsavedChanges) {
+    SettingKey k = settingsStore.addString("ns", "s", "one");
+    settingsStore.setString(k, "two");
+    settingsStore.commit();
+    settingsStore.setString(k, "three");
+
+    SettingKey again = settingsStore.addString("ns", "s", "one");
+    EXPECT_EQ(k, again);
+    EXPECT_STREQ("two", settingsStore.getString(again).c_str());
+    EXPECT_FALSE(settingsStore.pending());
+    EXPECT_EQ(1u, settingsStore.stats(millis()).keys);
+}
+
+TEST_F(SettingsStoreTest, BytesUseTheCallersBuffer) {
+    uint8_t colors[6] = {};
+    SettingKey k = settingsStore.addBytes("logo", "clr", colors, sizeof(colors));
+    EXPECT_EQ(0u, settingsStore.storedLength(k));
+    colors[0] = 10;
+    colors[3] = 40;
+    settingsStore.bytesChanged(k, 4);
+    ASSERT_TRUE(settingsStore.commit());
+
+    uint8_t reloaded[6] = {};
+    SettingKey again = settingsStore.addBytes("logo", "clr", reloaded, sizeof(reloaded));
+    EXPECT_EQ(4u, settingsStore.storedLength(again));
+    EXPECT_EQ(10, reloaded[0]);
+    EXPECT_EQ(40, reloaded[3]);
+}
+
+TEST_F(SettingsStoreTest, WrongTypeOrUnknownKeyIsIgnored) {
+    SettingKey k = settingsStore.addU8("ns", "k", 5);
+    settingsStore.setU16(k, 9);
+    settingsStore.setU8(SETTING_NONE, 9);
+    EXPECT_FALSE(settingsStore.pending());
+    EXPECT_EQ(0, settingsStore.getU16(k));
+    EXPECT_EQ(5, settingsStore.getU8(k));
+    EXPECT_EQ(0, settingsStore.getU8(SETTING_NONE));
+}
+
+TEST_F(SettingsStoreTest, FullTableIsCounted) {
+    static char names[SETTINGS_MAX_KEYS + 1][8];
+    for (int i = 0; i < SETTINGS_MAX_KEYS; ++i) {
+        snprintf(names[i], sizeof(names[i]), "k%d", i);
+        ASSERT_NE(SETTING_NONE, settingsStore.addU8("ns", names[i], 0));
+    }
+    snprintf(names[SETTINGS_MAX_KEYS], sizeof(names[0]), "extra");
+    EXPECT_EQ(SETTING_NONE, settingsStore.addU8("ns", names[SETTINGS_MAX_KEYS], 0));
+    EXPECT_EQ(1u, settingsStore.stats(millis()).overflows);
+}
+
+TEST_F(SettingsStoreTest, DayCountersRollOver) {
+    const unsigned long day = 24UL * 60 * 60 * 1000;
+    SettingKey k = settingsStore.addU8("ns", "k", 0);
+    settingsStore.setU8(k, 1);
+    settingsStore.commit();
+    settingsStore.setU8(k, 2);
+    settingsStore.commit();
+    EXPECT_EQ(2u, settingsStore.stats(day - 1).commitsDay);
+
+    setMockMillis(day + 10);
+    settingsStore.setU8(k, 3);
+    settingsStore.commit();
+    SettingsStoreStats st = settingsStore.stats(day + 10);
+    EXPECT_EQ(1u, st.commitsDay);
+    EXPECT_EQ(32u, st.bytesDay);
+    EXPECT_EQ(2u, st.commitsPrevDay);
+    EXPECT_EQ(64u, st.bytesPrevDay);
+    EXPECT_EQ(3u, st.commits);
+
+    // A quiet day in between leaves nothing for the previous window
+    st = settingsStore.stats(3 * day + 10);
+    EXPECT_EQ(0u, st.commitsDay);
+    EXPECT_EQ(0u, st.commitsPrevDay);
+}
+
+// Boot through the snapshot: register a typical key set, as setup() would
+struct BootKeys {
+    SettingKey brightness, channel, retention;
+    uint8_t colors[6] = {};
+    SettingKey colorsKey;
+
+    void registerAll() {
+        brightness = settingsStore.addU8("wc_led", "br", 64);
+        channel = settingsStore.addString("wc_display", "upd_ch", "stable");
+        retention = settingsStore.addU32("wc_log", "retention", 1);
+        colorsKey = settingsStore.addBytes("logo", "clr", colors, sizeof(colors));
+    }
+};
+
+static void corruptSnapshot(size_t offset) {
+    Preferences prefs;
+    prefs.begin("wc_snap", false);
+    uint8_t image[512];
+    size_t length = prefs.getBytes("v", image, sizeof(image));
+    ASSERT_GT(length, offset);
+    image[offset] ^= 0xFF;
+    prefs.putBytes("v", image, length);
+    prefs.end();
+}
+
+static void bootOnce(BootKeys& keys) {
+    settingsStore.test_reset();
+    settingsStore.loadSnapshot();
+    keys.registerAll();
+    settingsStore.finishBoot();
+}
+
+TEST_F(SettingsStoreTest, SnapshotServesTheNextBoot) {
+    BootKeys first;
+    bootOnce(first);
+    EXPECT_FALSE(settingsStore.stats(0).snapshotLoaded);
+    settingsStore.setU8(first.brightness, 200);
+    settingsStore.setString(first.channel, "early");
+    first.colors[2] = 99;
+    settingsStore.bytesChanged(first.colorsKey, 3);
+    settingsStore.commit();
+    ASSERT_TRUE(settingsStore.saveSnapshot());
+
+    // Change the namespaces behind the store's back: values that still come
+    // back prove they were read from the snapshot
+    putStored("wc_led", "br", 5);
+
+    BootKeys second;
+    bootOnce(second);
+    SettingsStoreStats st = settingsStore.stats(0);
+    EXPECT_TRUE(st.snapshotLoaded);
+    EXPECT_EQ(4, st.snapshotHits);
+    EXPECT_EQ(200, settingsStore.getU8(second.brightness));
+    EXPECT_STREQ("early", settingsStore.getString(second.channel).c_str());
+    EXPECT_EQ(1u, settingsStore.getU32(second.retention));
+    EXPECT_FALSE(settingsStore.isStored(second.retention));
+    EXPECT_EQ(3u, settingsStore.storedLength(second.colorsKey));
+    EXPECT_EQ(99, second.colors[2]);
+}
+
+TEST_F(SettingsStoreTest, CorruptOrOutdatedSnapshotFallsBackToKeys) {
+    BootKeys first;
+    bootOnce(first);
+    settingsStore.setU8(first.brightness, 200);
+    settingsStore.commit();
+    ASSERT_TRUE(settingsStore.saveSnapshot());
+
+    corruptSnapshot(20);  // inside the records: the CRC catches it
+    BootKeys second;
+    bootOnce(second);
+    EXPECT_FALSE(settingsStore.stats(0).snapshotLoaded);
+    EXPECT_EQ(200, settingsStore.getU8(second.brightness));
+
+    // finishBoot() wrote a good one again; now age its version
+    corruptSnapshot(0);
+    BootKeys third;
+    bootOnce(third);
+    EXPECT_FALSE(settingsStore.stats(0).snapshotLoaded);
+    EXPECT_EQ(200, settingsStore.getU8(third.brightness));
+
+    BootKeys fourth;
+    bootOnce(fourth);
+    EXPECT_TRUE(settingsStore.stats(0).snapshotLoaded);
+}
+
+TEST_F(SettingsStoreTest, CommitRetiresTheSnapshotFirst) {
+    BootKeys first;
+    bootOnce(first);
+    ASSERT_TRUE(settingsStore.saveSnapshot());
+    settingsStore.setU8(first.brightness, 10);
+    settingsStore.commit();
+    EXPECT_EQ("<none>", readStored("wc_snap", "v"));
+
+    // A power cut now: the next boot reads the keys, never old values
+    BootKeys second;
+    bootOnce(second);
+    EXPECT_FALSE(settingsStore.stats(0).snapshotLoaded);
+    EXPECT_EQ(10, settingsStore.getU8(second.brightness));
+}
+
+TEST_F(SettingsStoreTest, NewKeyIsReadAndTheSnapshotRewritten) {
+    BootKeys first;
+    bootOnce(first);
+    putStored("wc_night", "dim_pct", 33);
+
+    settingsStore.test_reset();
+    settingsStore.loadSnapshot();
+    BootKeys second;
+    second.registerAll();
+    SettingKey added = settingsStore.addU8("wc_night", "dim_pct", 20);
+    EXPECT_EQ(33, settingsStore.getU8(added));
+    settingsStore.finishBoot();
+
+    settingsStore.test_reset();
+    settingsStore.loadSnapshot();
+    EXPECT_TRUE(settingsStore.snapshotLoaded());
+    settingsStore.addU8("wc_night", "dim_pct", 20);
+    EXPECT_EQ(1, settingsStore.stats(0).snapshotHits);
+}
+
+TEST_F(SettingsStoreTest, ReinstalledImageIgnoresItsOldSnapshot) {
+    BootKeys first;
+    bootOnce(first);
+    settingsStore.setU8(first.brightness, 200);
+    settingsStore.commit();
+    ASSERT_TRUE(settingsStore.saveSnapshot());
+
+    // Roll back to an image without snapshots; it changes a setting
+    test_settingsInstall();
+    putStored("wc_led", "br", 5);
+
+    // The same build installed again: its intact snapshot is stale
+    test_settingsInstall();
+    BootKeys second;
+    bootOnce(second);
+    EXPECT_FALSE(settingsStore.stats(0).snapshotLoaded);
+    EXPECT_EQ(5, settingsStore.getU8(second.brightness));
+
+    // finishBoot() wrote one for this install; a plain reboot uses it
+    BootKeys third;
+    bootOnce(third);
+    EXPECT_TRUE(settingsStore.stats(0).snapshotLoaded);
+    EXPECT_EQ(5, settingsStore.getU8(third.brightness));
+}
+
+TEST_F(SettingsStoreTest, InvalidatedSnapshotStaysGoneUntilReboot) {
+    BootKeys first;
+    bootOnce(first);
+    settingsStore.invalidateSnapshot();
+    EXPECT_FALSE(settingsStore.saveSnapshot());
+    EXPECT_EQ("<none>", readStored("wc_snap", "v"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "../mocks/mock_arduino.h"
+#include "../mocks/mock_preferences.h"
+#include "../mocks/mock_time.h"
+#include "../mocks/mock_mqtt.h"
+
+// Include production log implementation (with PIO_UNIT_TESTING stubs)
+#include "../../src/log.cpp"
+
+// Every setter that feeds /api/state, compiled as in the firmware. The grid
+// variants are needed for the language and dialect setters.
+#include "../../src/phrase_rules.cpp"
+#include "../../src/grid_variants/de_50x50_v1.cpp"
+#include "../../src/grid_variants/nl_105x105_logo_v1.cpp"
+#include "../../src/grid_variants/nl_20x20_v1.cpp"
+#include "../../src/grid_variants/nl_50x50_v3.cpp"
+#include "../../src/grid_variants/nl_55x50_logo_v1.cpp"
+#include "../../src/grid_variants/nl_v4.cpp"
+#include "../../src/grid_layout.cpp"
+#include "../../src/language_settings.cpp"
+#include "../../src/led_state.h"
+#include "../../src/led_state.cpp"
+#include "../../src/display_settings.h"
+#include "../../src/night_mode.cpp"
+#include "../../src/update_status.cpp"
+#include "../../src/settings_store.cpp"
+
+DisplaySettings displaySettings;
+
+class StateGenerationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Preferences::reset();
+        setMockMillis(0);
+        ledState.begin();
+        displaySettings.begin();
+        nightMode.begin();
+        set_update_running(false);
+        ASSERT_TRUE(setActiveGridVariant(GridVariant::NL_V4));
+        start = stateGeneration();
+    }
+
+    void TearDown() override {
+        Preferences::reset();
+    }
+
+    // Generations since SetUp (or the last call)
+    uint32_t bumps() {
+        uint32_t now = stateGeneration();
+        uint32_t n = now - start;
+        start = now;
+        return n;
+    }
+
+    uint32_t start = 0;
+};
+
+TEST_F(StateGenerationTest, LightSettersBumpOnChangeOnly) {
+    ledState.setBrightness(77);
+    EXPECT_EQ(1u, bumps());
+    ledState.setBrightness(77);
+    EXPECT_EQ(0u, bumps());
+    ledState.setRGB(10, 20, 30);
+    EXPECT_EQ(1u, bumps());
+    ledState.setRGB(10, 20, 30);
+    EXPECT_EQ(0u, bumps());
+    ledState.setRGBW(1, 2, 3, 4);
+    EXPECT_EQ(1u, bumps());
+    ledState.setRGBW(1, 2, 3, 4);
+    EXPECT_EQ(0u, bumps());
+}
+
+TEST_F(StateGenerationTest, DisplaySettersBumpOnChangeOnly) {
+    bool animate = displaySettings.getAnimateWords();
+    displaySettings.setAnimateWords(!animate);
+    EXPECT_EQ(1u, bumps());
+    displaySettings.setAnimateWords(!animate);
+    EXPECT_EQ(0u, bumps());
+
+    uint16_t het = displaySettings.getHetIsDurationSec();
+    displaySettings.setHetIsDurationSec(het == 90 ? 120 : 90);
+    EXPECT_EQ(1u, bumps());
+    displaySettings.setHetIsDurationSec(displaySettings.getHetIsDurationSec());
+    EXPECT_EQ(0u, bumps());
+
+    bool sell = displaySettings.isSellMode();
+    displaySettings.setSellMode(!sell);
+    EXPECT_EQ(1u, bumps());
+
+    bool autoUpd = displaySettings.getAutoUpdate();
+    displaySettings.setAutoUpdate(!autoUpd);
+    EXPECT_EQ(1u, bumps());
+    displaySettings.setAutoUpdate(!autoUpd);
+    EXPECT_EQ(0u, bumps());
+
+    displaySettings.setUpdateChannel("early");
+    EXPECT_GE(bumps(), 1u);
+    displaySettings.setUpdateChannel("early");
+    EXPECT_EQ(0u, bumps());
+}
+
+TEST_F(StateGenerationTest, NightModeSettersBump) {
+    nightMode.setEnabled(!nightMode.isEnabled());
+    EXPECT_GE(bumps(), 1u);
+    nightMode.setDimPercent(nightMode.getDimPercent() == 30 ? 40 : 30);
+    EXPECT_GE(bumps(), 1u);
+    nightMode.setEffect(nightMode.getEffect() == NightModeEffect::Off ? NightModeEffect::Dim
+                                                                      : NightModeEffect::Off);
+    EXPECT_GE(bumps(), 1u);
+    nightMode.setSchedule(21 * 60, 6 * 60);
+    EXPECT_GE(bumps(), 1u);
+    nightMode.setOverride(NightModeOverride::ForceOn);
+    EXPECT_GE(bumps(), 1u);
+}
+
+TEST_F(StateGenerationTest, LanguageAndDialectBump) {
+    EXPECT_TRUE(LanguageSettings::setLanguage("de"));
+    EXPECT_EQ(1u, bumps());
+    // Unknown codes change nothing
+    EXPECT_FALSE(LanguageSettings::setLanguage("xx"));
+    EXPECT_EQ(0u, bumps());
+
+    const ClockDialect* d = getDialect(0);
+    ASSERT_NE(nullptr, d);
+    EXPECT_TRUE(LanguageSettings::setDialect(d->id));
+    EXPECT_EQ(1u, bumps());
+    EXPECT_FALSE(LanguageSettings::setDialect("no-such-dialect"));
+    EXPECT_EQ(0u, bumps());
+}
+
+TEST_F(StateGenerationTest, UpdateRunningBumpsOnTransitions) {
+    set_update_running(true);
+    EXPECT_EQ(1u, bumps());
+    set_update_running(true);
+    EXPECT_EQ(0u, bumps());
+    set_update_running(false);
+    EXPECT_EQ(1u, bumps());
+}
+
+TEST_F(StateGenerationTest, EveryNotificationBumpsEvenWithoutListeners) {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(StateChange::Count); ++i) {
+        notifyStateChanged(static_cast<StateChange>(i));
+    }
+    EXPECT_EQ(static_cast<uint32_t>(StateChange::Count), bumps());
+}
+
+TEST_F(StateGenerationTest, ListenersSeeTheNewGeneration) {
+    static uint32_t seen = 0;
+    StateChangeListener fn = [](StateChange) { seen = stateGeneration(); };
+    ASSERT_TRUE(addStateChangeListener(fn));
+    ledState.setBrightness(ledState.getBrightness() == 5 ? 6 : 5);
+    EXPECT_EQ(stateGeneration(), seen);
+    removeStateChangeListener(fn);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
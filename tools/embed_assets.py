@@ -0,0 +1,159 @@
+Import("env")
+
+import gzip
+import hashlib
+import io
+import os
+
+try:
+    import brotli  # optional: pip install brotli
+except ImportError:
+    brotli = None
+
+
+# Pack data/ into src/generated/asset_bundle_data.cpp so the web UI is part of
+# the firmware image (see src/asset_bundle.h). Text assets are stored gzip -9
+# (plus brotli when the module is installed) and nothing else; the firmware
+# inflates the gzip for a client that refuses compression. Each asset is
+# tagged with a hash of its plain bytes, and identical blobs are stored once.
+#
+# WORDCLOCK_DISABLE_EMBED_ASSETS=1 writes an empty bundle, which makes
+# serveFile() fall back to LittleFS for everything as before.
+
+TEXT_EXTS = {
+    ".html", ".htm", ".css", ".js", ".json", ".svg", ".txt", ".map"
+}
+
+HASH_CHARS = 16
+
+
+def source_data_dir():
+    data_dir = env.subst("$PROJECT_DATA_DIR")
+    if not data_dir or data_dir == "$PROJECT_DATA_DIR":
+        data_dir = os.path.join(env["PROJECT_DIR"], "data")
+    return data_dir
+
+
+def gzip_bytes(name, data):
+    # Same settings as gzip_data.py: mtime=0 keeps the firmware reproducible
+    buf = io.BytesIO()
+    with gzip.GzipFile(filename=name, mode='wb', fileobj=buf, compresslevel=9, mtime=0) as f:
+        f.write(data)
+    return buf.getvalue()
+
+
+def collect_assets(data_dir):
+    assets = []
+    for root, dirs, files in os.walk(data_dir):
+        dirs.sort()
+        for name in sorted(files):
+            if name.startswith('.') or name.endswith('.gz') or name.endswith('.br'):
+                continue
+            src = os.path.join(root, name)
+            rel = os.path.relpath(src, data_dir).replace(os.sep, '/')
+            with open(src, 'rb') as f:
+                plain = f.read()
+            variants = {}
+            if os.path.splitext(name)[1].lower() in TEXT_EXTS:
+                variants["gzip"] = gzip_bytes(name, plain)
+                if brotli is not None:
+                    variants["br"] = brotli.compress(plain, quality=11, lgwin=16)
+            else:
+                variants["identity"] = plain
+            assets.append({
+                "path": "/" + rel,
+                "hash": hashlib.sha256(plain).hexdigest()[:HASH_CHARS],
+                "plain_size": len(plain),
+                "variants": variants,
+            })
+    # findEmbeddedAsset() bisects with strcmp
+    assets.sort(key=lambda a: a["path"].encode())
+    return assets
+
+
+def c_bytes(data, indent="  ", per_line=20):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append(indent + ",".join("0x%02x" % b for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def render(assets):
+    bundle = hashlib.sha256()
+    for a in assets:
+        bundle.update(a["path"].encode() + b"\0" + a["hash"].encode() + b"\0")
+    bundle_id = bundle.hexdigest()[:HASH_CHARS] if assets else ""
+
+    out = [
+        "// Generated by tools/embed_assets.py from data/ - do not edit.",
+        "#include \"asset_bundle.h\"",
+        "",
+    ]
+    blobs = {}
+    for a in assets:
+        for coding, data in a["variants"].items():
+            key = hashlib.sha256(data).hexdigest()
+            if key in blobs:
+                continue
+            blobs[key] = "kBlob%d" % len(blobs)
+            out.append("alignas(4) static const uint8_t %s[%d] = {" % (blobs[key], len(data)))
+            out.append(c_bytes(data))
+            out.append("};")
+    out.append("")
+
+    def ref(a, coding):
+        data = a["variants"].get(coding)
+        if data is None:
+            return "nullptr", "0"
+        return blobs[hashlib.sha256(data).hexdigest()], str(len(data))
+
+    if assets:
+        out.append("const EmbeddedAsset kEmbeddedAssets[] = {")
+        for a in assets:
+            # Order matches ContentCoding: Identity, Gzip, Brotli
+            refs = [ref(a, c) for c in ("identity", "gzip", "br")]
+            out.append("  {\"%s\", \"%s\", {%s}, {%s}}," % (
+                a["path"], a["hash"],
+                ", ".join(r[0] for r in refs), ", ".join(r[1] for r in refs)))
+        out.append("};")
+        out.append("const size_t kEmbeddedAssetCount = %d;" % len(assets))
+    else:
+        out.append("const EmbeddedAsset kEmbeddedAssets[1] = {};")
+        out.append("const size_t kEmbeddedAssetCount = 0;")
+    out.append("const char kEmbeddedBundleId[] = \"%s\";" % bundle_id)
+    out.append("")
+    return "\n".join(out), bundle_id
+
+
+def write_bundle():
+    out_dir = os.path.join(env.subst("$PROJECT_SRC_DIR"), "generated")
+    out_path = os.path.join(out_dir, "asset_bundle_data.cpp")
+    data_dir = source_data_dir()
+
+    assets = []
+    if os.environ.get("WORDCLOCK_DISABLE_EMBED_ASSETS"):
+        print("[embed_assets] WORDCLOCK_DISABLE_EMBED_ASSETS set; writing an empty bundle")
+    elif not os.path.isdir(data_dir):
+        print(f"[embed_assets] No data dir: {data_dir}; writing an empty bundle")
+    else:
+        assets = collect_assets(data_dir)
+
+    text, bundle_id = render(assets)
+    os.makedirs(out_dir, exist_ok=True)
+    # Rewriting an unchanged file would recompile ~500 KB of initialisers
+    if os.path.exists(out_path):
+        with open(out_path, "r", encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+    stored = sum(len(d) for a in assets for d in a["variants"].values())
+    plain = sum(a["plain_size"] for a in assets)
+    print(f"[embed_assets] {len(assets)} asset(s), bundle {bundle_id or '<empty>'}: "
+          f"{plain} -> {stored} bytes of flash")
+
+
+# Runs at script load (pre:), so the generated source exists before SCons
+# scans src/ for files to compile
+write_bundle()
@@ -4,55 +4,118 @@ import os
 import gzip
 import shutil
 
+from SCons.Script import COMMAND_LINE_TARGETS
+
+try:
+    import brotli  # optional: pip install brotli
+except ImportError:
+    brotli = None
+
+
+# Stage data/ into the build dir with text assets stored compressed only.
+# The firmware negotiates Accept-Encoding per request (web_routes.h
+# serveFile) and inflates the .gz for the rare client that refuses gzip, so
+# the plain copies would only waste LittleFS space.
 
 TEXT_EXTS = {
     ".html", ".htm", ".css", ".js", ".json", ".svg", ".txt", ".map"
 }
 
+FS_TARGETS = {"buildfs", "uploadfs", "uploadfsota", "upload_all"}
+
 
 def should_compress(path):
     if os.environ.get("WORDCLOCK_DISABLE_GZIP"):
         return False
-    if path.endswith('.gz'):
+    if path.endswith('.gz') or path.endswith('.br'):
         return False
     _, ext = os.path.splitext(path)
     return ext.lower() in TEXT_EXTS
 
 
-def compress_if_needed(src):
-    dst = src + ".gz"
-    try:
-        if os.path.exists(dst) and os.path.getmtime(dst) >= os.path.getmtime(src):
-            return False
-        os.makedirs(os.path.dirname(dst), exist_ok=True)
-        with open(src, 'rb') as fin, open(dst, 'wb') as raw_out:
-            with gzip.GzipFile(filename=os.path.basename(src), mode='wb',
-                               fileobj=raw_out, compresslevel=9, mtime=0) as fout:
-                shutil.copyfileobj(fin, fout)
-        print(f"[gzip_data] Compressed: {src} -> {dst}")
-        return True
-    except Exception as e:
-        print(f"[gzip_data] Failed to compress {src}: {e}")
-        return False
+def is_stale(src, dst):
+    return not os.path.exists(dst) or os.path.getmtime(dst) < os.path.getmtime(src)
+
+
+def write_gzip(src, dst):
+    with open(src, 'rb') as fin, open(dst, 'wb') as raw_out:
+        with gzip.GzipFile(filename=os.path.basename(src), mode='wb',
+                           fileobj=raw_out, compresslevel=9, mtime=0) as fout:
+            shutil.copyfileobj(fin, fout)
+
+
+def write_brotli(src, dst):
+    with open(src, 'rb') as fin:
+        data = fin.read()
+    with open(dst, 'wb') as fout:
+        fout.write(brotli.compress(data, quality=11, lgwin=16))
 
 
-def run_gzip_on_data(*args, **kwargs):
+def source_data_dir():
     data_dir = env.subst("$PROJECT_DATA_DIR")
     if not data_dir or data_dir == "$PROJECT_DATA_DIR":
         data_dir = os.path.join(env["PROJECT_DIR"], "data")
-    if not os.path.isdir(data_dir):
-        print(f"[gzip_data] No data dir: {data_dir}")
-        return
-    changed = 0
+    return data_dir
+
+
+def stage_data(data_dir, stage_dir):
+    plain = 0
+    packed = 0
+    before = 0
+    after = 0
+    wanted = set()
     for root, _, files in os.walk(data_dir):
+        rel_root = os.path.relpath(root, data_dir)
+        out_root = os.path.normpath(os.path.join(stage_dir, rel_root))
+        os.makedirs(out_root, exist_ok=True)
         for name in files:
             src = os.path.join(root, name)
-            if should_compress(src):
-                if compress_if_needed(src):
-                    changed += 1
-    print(f"[gzip_data] Done. {changed} file(s) compressed.")
+            size = os.path.getsize(src)
+            before += size
+            if not should_compress(src):
+                dst = os.path.join(out_root, name)
+                if is_stale(src, dst):
+                    shutil.copy2(src, dst)
+                wanted.add(dst)
+                after += size
+                plain += 1
+                continue
+            gz = os.path.join(out_root, name + ".gz")
+            if is_stale(src, gz):
+                write_gzip(src, gz)
+            wanted.add(gz)
+            after += os.path.getsize(gz)
+            if brotli is not None:
+                br = os.path.join(out_root, name + ".br")
+                if is_stale(src, br):
+                    write_brotli(src, br)
+                wanted.add(br)
+                after += os.path.getsize(br)
+            packed += 1
 
+    # Files removed from data/ must not linger in the image
+    for root, _, files in os.walk(stage_dir):
+        for name in files:
+            path = os.path.join(root, name)
+            if path not in wanted:
+                os.remove(path)
 
-# Run before building or uploading FS so .gz files are included
-env.AddPreAction("buildfs", run_gzip_on_data)
-env.AddPreAction("uploadfs", run_gzip_on_data)
+    variants = "gzip+br" if brotli is not None else "gzip"
+    print(f"[gzip_data] {packed} text file(s) stored as {variants}, {plain} copied as-is; "
+          f"{before} -> {after} bytes")
+
+
+if set(COMMAND_LINE_TARGETS) & FS_TARGETS:
+    data_dir = source_data_dir()
+    if not os.path.isdir(data_dir):
+        print(f"[gzip_data] No data dir: {data_dir}")
+    elif os.environ.get("WORDCLOCK_DISABLE_GZIP"):
+        print("[gzip_data] WORDCLOCK_DISABLE_GZIP set; packing data/ uncompressed")
+    else:
+        stage_dir = os.path.join(env.subst("$BUILD_DIR"), "fsdata")
+        try:
+            stage_data(data_dir, stage_dir)
+            # mklittlefs packs whatever PROJECT_DATA_DIR points at
+            env.Replace(PROJECT_DATA_DIR=stage_dir)
+        except Exception as e:
+            print(f"[gzip_data] Staging failed, packing data/ uncompressed: {e}")
@@ -0,0 +1,58 @@
+#!/usr/bin/env bash
+# Measure what a first dashboard load costs on the wire, with and without
+# compression, against a running device. serveFile() negotiates
+# Accept-Encoding (see ROADMAP.md, "Precompressed static assets"), so the
+# same URLs are fetched twice: once as a browser would ask, once as a client
+# that refuses compression (which the device answers by inflating the .gz).
+#
+#   ./tools/measure-first-load.sh [host] [lang]
+#
+# Defaults to wordclock.local and nl. Requests are sequential, one fresh
+# connection each, which is close to what the sync WebServer does anyway.
+# ral-classic.json is left out: the colour picker fetches it on first open.
+set -uo pipefail
+
+HOST="${1:-wordclock.local}"
+LANG_CODE="${2:-nl}"
+ASSETS=(
+  /dashboard.html
+  /chronolett.css
+  /chronolett-compact.css
+  /i18n/i18n.js
+  /ral-picker.js
+  "/i18n/${LANG_CODE}.json"
+)
+
+curl -s -o /dev/null -m 10 "http://${HOST}/dashboard.html" || {
+  echo "device unreachable at ${HOST} — pass an IP as the first argument"; exit 1; }
+
+# $1 = label, $2 = Accept-Encoding value
+measure() {
+  local label="$1" accept="$2" total_bytes=0 total_ms=0
+  echo "==> ${label} (Accept-Encoding: ${accept})"
+  printf '    %-26s %8s %8s  %s\n' "asset" "bytes" "ms" "encoding"
+  for path in "${ASSETS[@]}"; do
+    # Not --compressed: that sends curl's own header; count wire bytes instead
+    out="$(curl -s -o /dev/null -m 30 -H "Accept-Encoding: ${accept}" -D - \
+             -w 'WC_STATS:%{http_code} %{size_download} %{time_total}\n' "http://${HOST}${path}")"
+    enc="$(printf '%s' "$out" | grep -i '^Content-Encoding:' | head -1 | sed 's/^[^:]*: *//' | tr -d '\r')"
+    read -r code size secs <<<"$(printf '%s' "$out" | sed -n 's/^WC_STATS://p' | tail -1)"
+    ms="$(awk -v s="$secs" 'BEGIN { printf "%d", s * 1000 }')"
+    [ "$code" = "200" ] || enc="HTTP ${code}"
+    printf '    %-26s %8s %8s  %s\n' "$path" "$size" "$ms" "${enc:-identity}"
+    total_bytes=$((total_bytes + size))
+    total_ms=$((total_ms + ms))
+  done
+  printf '    %-26s %8s %8s\n' "total" "$total_bytes" "$total_ms"
+  eval "${3}_bytes=${total_bytes}; ${3}_ms=${total_ms}"
+}
+
+measure "Browser" "gzip, deflate, br" compressed
+echo
+measure "No compression" "identity" plain
+echo
+if [ "${plain_bytes:-0}" -gt 0 ]; then
+  awk -v cb="$compressed_bytes" -v pb="$plain_bytes" -v cm="$compressed_ms" -v pm="$plain_ms" 'BEGIN {
+    printf "  compressed first load: %d of %d bytes (%.0f%% less), %d of %d ms\n",
+           cb, pb, 100 * (1 - cb / pb), cm, pm }'
+fi